@@ -127,18 +127,18 @@ __kernel void TSDFVolume_sliceZ( write_only image2d_t out, int v, global float2*
 
 static inline float TSDFVolume_rayStart( const float3 origin, const float3 direction, int width, int height, int depth )
 {
-	float xmin = ( ( direction.x > 0.0f ? 0.0f : width )  - origin.x ) / direction.x;
-	float ymin = ( ( direction.y > 0.0f ? 0.0f : height ) - origin.y ) / direction.y;
-	float zmin = ( ( direction.z > 0.0f ? 0.0f : depth )  - origin.z ) / direction.z;
+	float xmin = ( ( direction.x >= 0.0f ? 0.0f : width )  - origin.x ) / direction.x;
+	float ymin = ( ( direction.y >= 0.0f ? 0.0f : height ) - origin.y ) / direction.y;
+	float zmin = ( ( direction.z >= 0.0f ? 0.0f : depth )  - origin.z ) / direction.z;
 
 	return fmax( fmax( xmin, ymin ), zmin );
 }
 
 static inline float TSDFVolume_rayEnd( const float3 origin, const float3 direction, int width, int height, int depth )
 {
-	float xmin = ( ( direction.x > 0.0f ? width : 0.0f )  - origin.x ) / direction.x;
-	float ymin = ( ( direction.y > 0.0f ? height : 0.0f ) - origin.y ) / direction.y;
-	float zmin = ( ( direction.z > 0.0f ? depth : 0.0f )  - origin.z ) / direction.z;
+	float xmin = ( ( direction.x >= 0.0f ? width : 0.0f )  - origin.x ) / direction.x;
+	float ymin = ( ( direction.y >= 0.0f ? height : 0.0f ) - origin.y ) / direction.y;
+	float zmin = ( ( direction.z >= 0.0f ? depth : 0.0f )  - origin.z ) / direction.z;
 
 	return fmin( fmin( xmin, ymin ), zmin );
 }
@@ -225,10 +225,10 @@ __kernel void TSDFVolume_rayCastDepthmap( write_only image2d_t out, global float
 				break;
 			}
 
-			if ( val_prev > 0.0f && val < 0.0f) {
+			if ( val_prev > 0.0f && val <= 0.0f) {
 				float alpha = -val / ( val_prev - val );
-				float3 gpos = ( mix( pos.z, pos_prev.z, alpha ) );
-				ret = fmax( -( mat4f_transform( &TG2CAM, ( float4 ) ( gpos, 1.0f ) ).z ) * scale, 0.0f );
+				float3 gpos = mix( pos, pos_prev, alpha );
+				ret = fmax( mat4f_transform( &TG2CAM, ( float4 ) ( gpos, 1.0f ) ).z * scale, 0.0f );
 				break;
 			}
 			val_prev = val;
@@ -0,0 +1,684 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/com/ImageStream.h>
+#include <cvt/util/Time.h>
+#include <cvt/math/Math.h>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <limits.h>
+#include <string.h>
+#include <errno.h>
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace cvt
+{
+	static const uint32_t IMAGESTREAM_TCP_MAGIC = 0x43565453; /* CVTS */
+	static const uint32_t IMAGESTREAM_UDP_MAGIC = 0x43565455; /* CVTU */
+	static const uint32_t IMAGESTREAM_VERSION	= 1;
+	/* magic, version/images/image, sequence, width, height, format, row, rows, offset, length */
+	static const size_t	  IMAGESTREAM_UDP_HEADER = 10 * sizeof( uint32_t );
+
+	const size_t ImageStreamSender::MAX_IMAGES;
+
+	static void _throwErrno( const char* what )
+	{
+		String msg( what );
+		msg += strerror( errno );
+		throw CVTException( msg.c_str() );
+	}
+
+	/* adler32 */
+	static uint32_t _checksum( const uint8_t* data, size_t len )
+	{
+		uint32_t a = 1, b = 0;
+		while( len ) {
+			size_t n = Math::min<size_t>( len, 5552 );
+			len -= n;
+			while( n-- ) {
+				a += *data++;
+				b += a;
+			}
+			a %= 65521;
+			b %= 65521;
+		}
+		return ( b << 16 ) | a;
+	}
+
+	static bool _validFormat( uint32_t id )
+	{
+		return id >= IFORMAT_GRAY_UINT8 && id <= IFORMAT_UYVY_UINT8;
+	}
+
+	static void _waitWriteable( int fd )
+	{
+		struct pollfd pfd;
+		pfd.fd = fd;
+		pfd.events = POLLOUT;
+		pfd.revents = 0;
+		poll( &pfd, 1, 10 );
+	}
+
+	static void _sendAll( int fd, std::vector<struct iovec>& iov )
+	{
+		size_t first = 0;
+
+		while( first < iov.size() ) {
+			struct msghdr msg;
+			memset( &msg, 0, sizeof( msg ) );
+			msg.msg_iov = &iov[ first ];
+			msg.msg_iovlen = Math::min<size_t>( iov.size() - first, IOV_MAX );
+
+			ssize_t n = sendmsg( fd, &msg, MSG_NOSIGNAL );
+			if( n < 0 ) {
+				if( errno == EINTR )
+					continue;
+				if( errno == EAGAIN || errno == EWOULDBLOCK ) {
+					_waitWriteable( fd );
+					continue;
+				}
+				_throwErrno( "Send: " );
+			}
+
+			/* skip what was written, partial writes end in the middle of a vector */
+			size_t left = n;
+			while( first < iov.size() && left >= iov[ first ].iov_len ) {
+				left -= iov[ first ].iov_len;
+				first++;
+			}
+			if( left ) {
+				iov[ first ].iov_base = ( uint8_t* ) iov[ first ].iov_base + left;
+				iov[ first ].iov_len -= left;
+			}
+		}
+	}
+
+	static void _receiveAll( int fd, std::vector<struct iovec>& iov )
+	{
+		size_t first = 0;
+
+		while( first < iov.size() ) {
+			struct msghdr msg;
+			memset( &msg, 0, sizeof( msg ) );
+			msg.msg_iov = &iov[ first ];
+			msg.msg_iovlen = Math::min<size_t>( iov.size() - first, IOV_MAX );
+
+			ssize_t n = recvmsg( fd, &msg, MSG_WAITALL );
+			if( n == 0 )
+				throw CVTException( "Connection closed by peer" );
+			if( n < 0 ) {
+				if( errno == EINTR )
+					continue;
+				if( errno == EAGAIN || errno == EWOULDBLOCK ) {
+					struct pollfd pfd;
+					pfd.fd = fd;
+					pfd.events = POLLIN;
+					pfd.revents = 0;
+					poll( &pfd, 1, 10 );
+					continue;
+				}
+				_throwErrno( "Receive: " );
+			}
+
+			size_t left = n;
+			while( first < iov.size() && left >= iov[ first ].iov_len ) {
+				left -= iov[ first ].iov_len;
+				first++;
+			}
+			if( left ) {
+				iov[ first ].iov_base = ( uint8_t* ) iov[ first ].iov_base + left;
+				iov[ first ].iov_len -= left;
+			}
+		}
+	}
+
+	static void _receiveAll( int fd, void* data, size_t len )
+	{
+		std::vector<struct iovec> iov( 1 );
+		iov[ 0 ].iov_base = data;
+		iov[ 0 ].iov_len = len;
+		_receiveAll( fd, iov );
+	}
+
+	/* one vector for contiguous images, one per row otherwise */
+	static void _addRows( std::vector<struct iovec>& iov, const uint8_t* ptr, size_t stride, size_t rowbytes, size_t rows )
+	{
+		struct iovec v;
+		if( stride == rowbytes ) {
+			v.iov_base = ( void* ) ptr;
+			v.iov_len = rowbytes * rows;
+			iov.push_back( v );
+			return;
+		}
+		while( rows-- ) {
+			v.iov_base = ( void* ) ptr;
+			v.iov_len = rowbytes;
+			iov.push_back( v );
+			ptr += stride;
+		}
+	}
+
+	ImageStreamFrame::ImageStreamFrame() : _sequence( 0 ), _size( 0 )
+	{
+	}
+
+	ImageStreamFrame::~ImageStreamFrame()
+	{
+		for( size_t i = 0; i < _images.size(); i++ )
+			delete _images[ i ];
+	}
+
+	void ImageStreamFrame::resize( size_t n )
+	{
+		while( _images.size() < n )
+			_images.push_back( new Image() );
+		_size = n;
+		_rowBytes.resize( n );
+		_fragments.resize( n );
+		_validRows.assign( n, 0 );
+		_seen.assign( n, false );
+	}
+
+	bool ImageStreamFrame::rowValid( size_t image, size_t row ) const
+	{
+		if( _rowBytes.empty() )
+			return true;
+		const Image& img = *_images[ image ];
+		return _seen[ image ] && _rowBytes[ image ][ row ] == img.width() * img.format().bpp;
+	}
+
+	bool ImageStreamFrame::complete() const
+	{
+		if( _rowBytes.empty() )
+			return true;
+		for( size_t i = 0; i < _size; i++ ) {
+			if( !_seen[ i ] || _validRows[ i ] != _images[ i ]->height() )
+				return false;
+		}
+		return true;
+	}
+
+	ImageStreamFramePool::ImageStreamFramePool( size_t size )
+	{
+		for( size_t i = 0; i < size; i++ ) {
+			_frames.push_back( new ImageStreamFrame() );
+			_free.push_back( _frames.back() );
+		}
+	}
+
+	ImageStreamFramePool::~ImageStreamFramePool()
+	{
+		for( size_t i = 0; i < _frames.size(); i++ )
+			delete _frames[ i ];
+	}
+
+	ImageStreamFrame* ImageStreamFramePool::acquire()
+	{
+		ScopeLock lock( &_mutex );
+		if( _free.empty() ) {
+			_frames.push_back( new ImageStreamFrame() );
+			return _frames.back();
+		}
+		ImageStreamFrame* frame = _free.back();
+		_free.pop_back();
+		return frame;
+	}
+
+	void ImageStreamFramePool::release( const ImageStreamFrame* frame )
+	{
+		ScopeLock lock( &_mutex );
+		_free.push_back( const_cast<ImageStreamFrame*>( frame ) );
+	}
+
+	ImageStreamSender::ImageStreamSender( TCPClient& socket ) : _socket( socket ), _sequence( 0 )
+	{
+	}
+
+	uint32_t ImageStreamSender::send( const Image& image )
+	{
+		const Image* images[] = { &image };
+		return send( images, 1 );
+	}
+
+	uint32_t ImageStreamSender::send( const Image& left, const Image& right )
+	{
+		const Image* images[] = { &left, &right };
+		return send( images, 2 );
+	}
+
+	uint32_t ImageStreamSender::send( const Image* const* images, size_t n )
+	{
+		if( !n || n > MAX_IMAGES )
+			throw CVTException( "Invalid number of images" );
+
+		std::vector<uint32_t> header( 3 + 4 * n );
+		std::vector<struct iovec> iov( 1 );
+		std::vector<const uint8_t*> mapped( n, ( const uint8_t* ) NULL );
+
+		header[ 0 ] = htonl( IMAGESTREAM_TCP_MAGIC );
+		header[ 1 ] = htonl( ( IMAGESTREAM_VERSION << 16 ) | n );
+		header[ 2 ] = htonl( _sequence );
+		iov[ 0 ].iov_base = &header[ 0 ];
+		iov[ 0 ].iov_len = header.size() * sizeof( uint32_t );
+
+		try {
+			for( size_t i = 0; i < n; i++ ) {
+				const Image& img = *images[ i ];
+				size_t stride;
+				size_t rowbytes = img.width() * img.format().bpp;
+
+				mapped[ i ] = img.map( &stride );
+				header[ 3 + 4 * i ] = htonl( img.width() );
+				header[ 4 + 4 * i ] = htonl( img.height() );
+				header[ 5 + 4 * i ] = htonl( img.format().formatID );
+				header[ 6 + 4 * i ] = htonl( rowbytes );
+				_addRows( iov, mapped[ i ], stride, rowbytes, img.height() );
+			}
+
+			_sendAll( _socket.socketDescriptor(), iov );
+		} catch( ... ) {
+			for( size_t i = 0; i < n; i++ ) {
+				if( mapped[ i ] )
+					images[ i ]->unmap( mapped[ i ] );
+			}
+			throw;
+		}
+
+		for( size_t i = 0; i < n; i++ )
+			images[ i ]->unmap( mapped[ i ] );
+
+		return _sequence++;
+	}
+
+	ImageStreamReceiver::ImageStreamReceiver( TCPClient& socket, size_t poolSize ) :
+		_socket( socket ),
+		_pool( poolSize )
+	{
+	}
+
+	const ImageStreamFrame* ImageStreamReceiver::receive()
+	{
+		int fd = _socket.socketDescriptor();
+		uint32_t header[ 3 ];
+		uint32_t iheader[ 4 * ImageStreamSender::MAX_IMAGES ];
+
+		_receiveAll( fd, header, sizeof( header ) );
+		size_t n = ntohl( header[ 1 ] ) & 0xffff;
+		if( ntohl( header[ 0 ] ) != IMAGESTREAM_TCP_MAGIC || ( ntohl( header[ 1 ] ) >> 16 ) != IMAGESTREAM_VERSION )
+			throw CVTException( "Invalid image stream header" );
+		if( !n || n > ImageStreamSender::MAX_IMAGES )
+			throw CVTException( "Invalid number of images" );
+		_receiveAll( fd, iheader, 4 * n * sizeof( uint32_t ) );
+
+		ImageStreamFrame* frame = _pool.acquire();
+		std::vector<uint8_t*> mapped( n, ( uint8_t* ) NULL );
+		try {
+			std::vector<struct iovec> iov;
+
+			frame->resize( n );
+			frame->_rowBytes.clear();
+			frame->_sequence = ntohl( header[ 2 ] );
+
+			for( size_t i = 0; i < n; i++ ) {
+				size_t w = ntohl( iheader[ 4 * i ] );
+				size_t h = ntohl( iheader[ 4 * i + 1 ] );
+				uint32_t id = ntohl( iheader[ 4 * i + 2 ] );
+				size_t rowbytes = ntohl( iheader[ 4 * i + 3 ] );
+
+				if( !_validFormat( id ) )
+					throw CVTException( "Invalid image format" );
+				const IFormat& format = IFormat::formatForId( ( IFormatID ) id );
+				if( !w || !h || rowbytes != w * format.bpp )
+					throw CVTException( "Invalid image size" );
+
+				Image& img = *frame->_images[ i ];
+				size_t stride;
+				img.reallocate( w, h, format );
+				mapped[ i ] = img.map( &stride );
+				_addRows( iov, mapped[ i ], stride, rowbytes, h );
+			}
+
+			_receiveAll( fd, iov );
+		} catch( ... ) {
+			for( size_t i = 0; i < n; i++ ) {
+				if( mapped[ i ] )
+					frame->_images[ i ]->unmap( mapped[ i ] );
+			}
+			_pool.release( frame );
+			throw;
+		}
+
+		for( size_t i = 0; i < n; i++ )
+			frame->_images[ i ]->unmap( mapped[ i ] );
+
+		return frame;
+	}
+
+	void ImageStreamReceiver::release( const ImageStreamFrame* frame )
+	{
+		_pool.release( frame );
+	}
+
+	UDPImageStreamSender::UDPImageStreamSender( UDPClient& socket, size_t maxDatagramSize ) :
+		_socket( socket ),
+		_maxDatagramSize( maxDatagramSize ),
+		_sequence( 0 )
+	{
+		if( _maxDatagramSize < IMAGESTREAM_UDP_HEADER + 64 )
+			throw CVTException( "Datagram size too small" );
+	}
+
+	uint32_t UDPImageStreamSender::send( const Image& image )
+	{
+		const Image* images[] = { &image };
+		return send( images, 1 );
+	}
+
+	uint32_t UDPImageStreamSender::send( const Image& left, const Image& right )
+	{
+		const Image* images[] = { &left, &right };
+		return send( images, 2 );
+	}
+
+	static void _sendDatagram( int fd, std::vector<struct iovec>& iov )
+	{
+		struct msghdr msg;
+		memset( &msg, 0, sizeof( msg ) );
+		msg.msg_iov = &iov[ 0 ];
+		msg.msg_iovlen = iov.size();
+
+		while( sendmsg( fd, &msg, MSG_NOSIGNAL ) < 0 ) {
+			if( errno == EINTR )
+				continue;
+			if( errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS ) {
+				_waitWriteable( fd );
+				continue;
+			}
+			/* nobody listening ( yet ), the stream is lossy anyway */
+			if( errno == ECONNREFUSED )
+				return;
+			_throwErrno( "Send: " );
+		}
+	}
+
+	uint32_t UDPImageStreamSender::send( const Image* const* images, size_t n )
+	{
+		if( !n || n > ImageStreamSender::MAX_IMAGES )
+			throw CVTException( "Invalid number of images" );
+
+		int fd = _socket.socketDescriptor();
+		size_t maxPayload = _maxDatagramSize - IMAGESTREAM_UDP_HEADER;
+		uint32_t header[ 10 ];
+		std::vector<uint32_t> checksums;
+		std::vector<struct iovec> iov;
+
+		header[ 0 ] = htonl( IMAGESTREAM_UDP_MAGIC );
+		header[ 2 ] = htonl( _sequence );
+
+		for( size_t i = 0; i < n; i++ ) {
+			const Image& img = *images[ i ];
+			size_t stride;
+			size_t rowbytes = img.width() * img.format().bpp;
+			size_t h = img.height();
+			const uint8_t* ptr = img.map( &stride );
+
+			header[ 1 ] = htonl( ( IMAGESTREAM_VERSION << 16 ) | ( n << 8 ) | i );
+			header[ 3 ] = htonl( img.width() );
+			header[ 4 ] = htonl( h );
+			header[ 5 ] = htonl( img.format().formatID );
+
+			try {
+				if( rowbytes + sizeof( uint32_t ) <= maxPayload ) {
+					/* whole rows, one checksum per row */
+					size_t rowsPerDatagram = maxPayload / ( rowbytes + sizeof( uint32_t ) );
+					for( size_t row = 0; row < h; row += rowsPerDatagram ) {
+						size_t k = Math::min( rowsPerDatagram, h - row );
+						header[ 6 ] = htonl( row );
+						header[ 7 ] = htonl( k );
+						header[ 8 ] = 0;
+						header[ 9 ] = htonl( k * rowbytes );
+
+						checksums.resize( k );
+						for( size_t j = 0; j < k; j++ )
+							checksums[ j ] = htonl( _checksum( ptr + ( row + j ) * stride, rowbytes ) );
+
+						iov.resize( 2 );
+						iov[ 0 ].iov_base = header;
+						iov[ 0 ].iov_len = sizeof( header );
+						iov[ 1 ].iov_base = &checksums[ 0 ];
+						iov[ 1 ].iov_len = k * sizeof( uint32_t );
+						_addRows( iov, ptr + row * stride, stride, rowbytes, k );
+						_sendDatagram( fd, iov );
+					}
+				} else {
+					/* wide rows are split into fragments */
+					size_t fragment = maxPayload - sizeof( uint32_t );
+					for( size_t row = 0; row < h; row++ ) {
+						for( size_t offset = 0; offset < rowbytes; offset += fragment ) {
+							size_t len = Math::min( fragment, rowbytes - offset );
+							const uint8_t* src = ptr + row * stride + offset;
+							uint32_t checksum = htonl( _checksum( src, len ) );
+							header[ 6 ] = htonl( row );
+							header[ 7 ] = htonl( 1 );
+							header[ 8 ] = htonl( offset );
+							header[ 9 ] = htonl( len );
+
+							iov.resize( 3 );
+							iov[ 0 ].iov_base = header;
+							iov[ 0 ].iov_len = sizeof( header );
+							iov[ 1 ].iov_base = &checksum;
+							iov[ 1 ].iov_len = sizeof( uint32_t );
+							iov[ 2 ].iov_base = ( void* ) src;
+							iov[ 2 ].iov_len = len;
+							_sendDatagram( fd, iov );
+						}
+					}
+				}
+			} catch( ... ) {
+				img.unmap( ptr );
+				throw;
+			}
+			img.unmap( ptr );
+		}
+
+		return _sequence++;
+	}
+
+	UDPImageStreamReceiver::UDPImageStreamReceiver( UDPClient& socket, size_t poolSize ) :
+		_socket( socket ),
+		_pool( poolSize ),
+		_current( NULL ),
+		_buffer( 65536 )
+	{
+	}
+
+	UDPImageStreamReceiver::~UDPImageStreamReceiver()
+	{
+		if( _current )
+			_pool.release( _current );
+	}
+
+	const ImageStreamFrame* UDPImageStreamReceiver::receive( ssize_t timeoutms )
+	{
+		int fd = _socket.socketDescriptor();
+		ImageStreamFrame* done = NULL;
+		Time start;
+
+		while( true ) {
+			int wait = -1;
+			if( timeoutms >= 0 )
+				wait = ( int ) Math::max( ( double ) timeoutms - start.elapsedMilliSeconds(), 0.0 );
+
+			struct pollfd pfd;
+			pfd.fd = fd;
+			pfd.events = POLLIN;
+			pfd.revents = 0;
+			int ret = poll( &pfd, 1, wait );
+			if( ret < 0 ) {
+				if( errno == EINTR )
+					continue;
+				_throwErrno( "Receive: " );
+			}
+			if( ret == 0 ) {
+				done = _current;
+				_current = NULL;
+				return done;
+			}
+
+			ssize_t len = recv( fd, &_buffer[ 0 ], _buffer.size(), 0 );
+			if( len < 0 ) {
+				if( errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK || errno == ECONNREFUSED )
+					continue;
+				_throwErrno( "Receive: " );
+			}
+
+			if( process( &_buffer[ 0 ], len, done ) )
+				return done;
+		}
+	}
+
+	void UDPImageStreamReceiver::release( const ImageStreamFrame* frame )
+	{
+		_pool.release( frame );
+	}
+
+	bool UDPImageStreamReceiver::process( const uint8_t* data, size_t len, ImageStreamFrame*& done )
+	{
+		if( len < IMAGESTREAM_UDP_HEADER )
+			return false;
+
+		uint32_t header[ 10 ];
+		for( size_t i = 0; i < 10; i++ ) {
+			uint32_t v;
+			memcpy( &v, data + i * sizeof( uint32_t ), sizeof( uint32_t ) );
+			header[ i ] = ntohl( v );
+		}
+
+		size_t numImages = ( header[ 1 ] >> 8 ) & 0xff;
+		size_t image = header[ 1 ] & 0xff;
+		uint32_t sequence = header[ 2 ];
+		size_t w = header[ 3 ];
+		size_t h = header[ 4 ];
+		uint32_t id = header[ 5 ];
+		size_t row = header[ 6 ];
+		size_t numRows = header[ 7 ];
+		size_t offset = header[ 8 ];
+		size_t length = header[ 9 ];
+
+		/* drop anything malformed */
+		if( header[ 0 ] != IMAGESTREAM_UDP_MAGIC || ( header[ 1 ] >> 16 ) != IMAGESTREAM_VERSION )
+			return false;
+		if( !numImages || numImages > ImageStreamSender::MAX_IMAGES || image >= numImages || !_validFormat( id ) )
+			return false;
+		const IFormat& format = IFormat::formatForId( ( IFormatID ) id );
+		size_t rowbytes = w * format.bpp;
+		if( !w || !h || !numRows || row >= h || numRows > h - row )
+			return false;
+		if( numRows == 1 ) {
+			if( !length || offset >= rowbytes || length > rowbytes - offset )
+				return false;
+		} else if( offset || length != numRows * rowbytes )
+			return false;
+		if( len != IMAGESTREAM_UDP_HEADER + numRows * sizeof( uint32_t ) + length )
+			return false;
+
+		if( _current && _current->_sequence != sequence ) {
+			/* late datagram of an already delivered frame */
+			if( ( int32_t ) ( sequence - _current->_sequence ) < 0 )
+				return false;
+			done = _current;
+			_current = NULL;
+		}
+
+		if( !_current ) {
+			_current = _pool.acquire();
+			_current->resize( numImages );
+			_current->_sequence = sequence;
+		}
+		if( _current->_size != numImages )
+			return done != NULL;
+
+		Image& img = *_current->_images[ image ];
+		std::vector<uint32_t>& rowBytes = _current->_rowBytes[ image ];
+		std::vector<ImageStreamFrame::FragmentList>& fragments = _current->_fragments[ image ];
+		if( !_current->_seen[ image ] ) {
+			img.reallocate( w, h, format );
+			rowBytes.assign( h, 0 );
+			for( size_t y = 0; y < fragments.size(); y++ )
+				fragments[ y ].clear();
+			_current->_seen[ image ] = true;
+		} else if( img.width() != w || img.height() != h || img.format() != format )
+			return done != NULL;
+
+		const uint8_t* checksums = data + IMAGESTREAM_UDP_HEADER;
+		const uint8_t* src = checksums + numRows * sizeof( uint32_t );
+		size_t piece = numRows == 1 ? length : rowbytes;
+		size_t stride;
+		uint8_t* dst = img.map( &stride );
+		for( size_t j = 0; j < numRows; j++ ) {
+			uint32_t expected;
+			memcpy( &expected, checksums + j * sizeof( uint32_t ), sizeof( uint32_t ) );
+			if( _checksum( src, piece ) == ntohl( expected ) && rowBytes[ row + j ] != rowbytes ) {
+				memcpy( dst + ( row + j ) * stride + offset, src, piece );
+				/* whole rows are set, fragments add up unless they overlap one received before */
+				if( piece == rowbytes ) {
+					rowBytes[ row + j ] = rowbytes;
+				} else {
+					if( fragments.size() != h )
+						fragments.resize( h );
+					ImageStreamFrame::FragmentList& list = fragments[ row + j ];
+					bool overlap = false;
+					for( size_t f = 0; f < list.size() && !overlap; f += 2 )
+						overlap = offset < list[ f ] + list[ f + 1 ] && list[ f ] < offset + piece;
+					if( !overlap ) {
+						list.push_back( offset );
+						list.push_back( piece );
+						rowBytes[ row + j ] += piece;
+					}
+				}
+				if( rowBytes[ row + j ] == rowbytes )
+					_current->_validRows[ image ]++;
+			}
+			src += piece;
+		}
+		img.unmap( dst );
+
+		if( !done && _current->complete() ) {
+			done = _current;
+			_current = NULL;
+		}
+		return done != NULL;
+	}
+}
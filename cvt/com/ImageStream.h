@@ -0,0 +1,179 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_IMAGESTREAM_H
+#define CVT_IMAGESTREAM_H
+
+#include <cvt/com/TCPClient.h>
+#include <cvt/com/UDPClient.h>
+#include <cvt/gfx/Image.h>
+#include <cvt/util/Mutex.h>
+
+#include <vector>
+
+namespace cvt
+{
+	/**
+	  @brief Frame of one or more images received from an image stream ( e.g. a rectified stereo pair ).
+
+	  Frames belong to the pool of the receiver and have to be handed back with release().
+	 */
+	class ImageStreamFrame
+	{
+		friend class ImageStreamFramePool;
+		friend class ImageStreamReceiver;
+		friend class UDPImageStreamReceiver;
+
+		public:
+			uint32_t		sequence() const { return _sequence; }
+			size_t			size() const { return _size; }
+			const Image&	operator[]( size_t i ) const { return *_images[ i ]; }
+
+			/* rows lost or corrupted on an UDP stream are invalid, TCP frames are always complete */
+			bool			rowValid( size_t image, size_t row ) const;
+			bool			complete() const;
+
+		private:
+			ImageStreamFrame();
+			~ImageStreamFrame();
+			ImageStreamFrame( const ImageStreamFrame& );
+
+			void			resize( size_t n );
+
+			uint32_t				_sequence;
+			size_t					_size;
+			std::vector<Image*>		_images;
+			/* offset and length pairs of the fragments received for a row */
+			typedef std::vector<uint32_t> FragmentList;
+
+			/* UDP: number of valid bytes per row, empty for TCP */
+			std::vector<std::vector<uint32_t> > _rowBytes;
+			/* UDP: fragments of wide rows, only allocated for images sent in fragments */
+			std::vector<std::vector<FragmentList> > _fragments;
+			/* UDP: number of complete rows per image */
+			std::vector<size_t>		_validRows;
+			std::vector<bool>		_seen;
+	};
+
+	class ImageStreamFramePool
+	{
+		public:
+			ImageStreamFramePool( size_t size );
+			~ImageStreamFramePool();
+
+			/* the pool grows if all frames are in use */
+			ImageStreamFrame*	acquire();
+			void				release( const ImageStreamFrame* frame );
+
+		private:
+			ImageStreamFramePool( const ImageStreamFramePool& );
+
+			Mutex							_mutex;
+			std::vector<ImageStreamFrame*>	_frames;
+			std::vector<ImageStreamFrame*>	_free;
+	};
+
+	/**
+	  @brief Sends images over a connected TCP socket.
+
+	  Each frame consists of a header with the sequence number, the size, IFormat and row size of
+	  every image followed by the pixel rows. The rows are sent with a single scatter-gather
+	  sendmsg directly from the mapped image memory, nothing is copied.
+	 */
+	class ImageStreamSender
+	{
+		public:
+			ImageStreamSender( TCPClient& socket );
+
+			uint32_t send( const Image& image );
+			uint32_t send( const Image& left, const Image& right );
+			uint32_t send( const Image* const* images, size_t n );
+
+			static const size_t MAX_IMAGES = 8;
+
+		private:
+			TCPClient&	_socket;
+			uint32_t	_sequence;
+	};
+
+	class ImageStreamReceiver
+	{
+		public:
+			ImageStreamReceiver( TCPClient& socket, size_t poolSize = 4 );
+
+			/* blocks until the next frame was received, throws if the connection was closed */
+			const ImageStreamFrame* receive();
+			void					release( const ImageStreamFrame* frame );
+
+		private:
+			TCPClient&				_socket;
+			ImageStreamFramePool	_pool;
+	};
+
+	/**
+	  @brief Sends images over a connected UDP socket.
+
+	  The images are split into datagrams of whole rows ( or row fragments for wide images ),
+	  every datagram carries a checksum for each of its rows. Lost or corrupted rows are reported
+	  as invalid by the receiver instead of dropping the whole frame.
+	 */
+	class UDPImageStreamSender
+	{
+		public:
+			UDPImageStreamSender( UDPClient& socket, size_t maxDatagramSize = 1400 );
+
+			uint32_t send( const Image& image );
+			uint32_t send( const Image& left, const Image& right );
+			uint32_t send( const Image* const* images, size_t n );
+
+		private:
+			UDPClient&	_socket;
+			size_t		_maxDatagramSize;
+			uint32_t	_sequence;
+	};
+
+	class UDPImageStreamReceiver
+	{
+		public:
+			UDPImageStreamReceiver( UDPClient& socket, size_t poolSize = 4 );
+			~UDPImageStreamReceiver();
+
+			/**
+			  Returns a frame as soon as it is complete or a datagram of a newer frame arrives.
+			  If no datagram arrives within timeoutms the pending frame is returned, or NULL if there is none.
+			 */
+			const ImageStreamFrame* receive( ssize_t timeoutms = -1 );
+			void					release( const ImageStreamFrame* frame );
+
+		private:
+			bool					process( const uint8_t* data, size_t len, ImageStreamFrame*& done );
+
+			UDPClient&				_socket;
+			ImageStreamFramePool	_pool;
+			ImageStreamFrame*		_current;
+			std::vector<uint8_t>	_buffer;
+	};
+}
+
+#endif
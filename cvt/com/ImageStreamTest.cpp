@@ -0,0 +1,193 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/com/ImageStream.h>
+#include <cvt/com/TCPServer.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/util/Thread.h>
+#include <cvt/util/CVTTest.h>
+#include <cvt/util/CVTTestImage.h>
+
+#include <string.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+using namespace cvt;
+
+struct StreamData {
+	TCPClient* socket;
+	Image* left;
+	Image* right;
+	size_t frames;
+};
+
+class SenderThread : public Thread<StreamData> {
+	public:
+		void execute( StreamData* data )
+		{
+			ImageStreamSender sender( *data->socket );
+			for( size_t i = 0; i < data->frames; i++ )
+				sender.send( *data->left, *data->right );
+		}
+};
+
+static bool _tcpTest()
+{
+	const uint16_t port = 47231;
+	bool ret = true;
+
+	TCPServer server( "127.0.0.1", port );
+	server.listen();
+	TCPClient client;
+	client.connect( "127.0.0.1", port );
+	TCPClient* peer = server.accept();
+	if( !peer )
+		return false;
+
+	/* odd width: row-wise scatter-gather if the allocator pads the rows */
+	Image left( 641, 480, IFormat::GRAY_UINT8 );
+	Image right( 641, 480, IFormat::RGBA_UINT8 );
+	testFillRandom( left );
+	testFillRandom( right );
+
+	StreamData data;
+	data.socket = &client;
+	data.left = &left;
+	data.right = &right;
+	data.frames = 5;
+
+	SenderThread thread;
+	thread.run( &data );
+
+	ImageStreamReceiver receiver( *peer, 2 );
+	for( size_t i = 0; i < data.frames; i++ ) {
+		const ImageStreamFrame* frame = receiver.receive();
+		ret &= frame->sequence() == i;
+		ret &= frame->size() == 2;
+		ret &= frame->complete();
+		ret &= testEqualImages( ( *frame )[ 0 ], left ) && testEqualImages( ( *frame )[ 1 ], right );
+		receiver.release( frame );
+	}
+	thread.join();
+
+	delete peer;
+	return ret;
+}
+
+static bool _udpTest()
+{
+	const uint16_t port = 47232;
+	bool ret = true;
+
+	UDPClient receiverSocket( "127.0.0.1", port );
+	UDPClient senderSocket;
+	senderSocket.connect( "127.0.0.1", port );
+
+	/* the RGBA rows do not fit into one datagram and get fragmented */
+	Image left( 64, 48, IFormat::GRAY_UINT8 );
+	Image right( 200, 8, IFormat::RGBA_UINT8 );
+	testFillRandom( left );
+	testFillRandom( right );
+
+	UDPImageStreamSender sender( senderSocket, 512 );
+	UDPImageStreamReceiver receiver( receiverSocket );
+
+	sender.send( left, right );
+	const ImageStreamFrame* frame = receiver.receive( 1000 );
+	ret &= frame != NULL;
+	if( frame ) {
+		ret &= frame->sequence() == 0 && frame->complete();
+		ret &= testEqualImages( ( *frame )[ 0 ], left ) && testEqualImages( ( *frame )[ 1 ], right );
+		receiver.release( frame );
+	}
+
+	/* nothing pending */
+	ret &= receiver.receive( 10 ) == NULL;
+	return ret;
+}
+
+/* duplicated fragments must not make up for a lost one */
+static bool _udpFragmentTest()
+{
+	const uint16_t port = 47233;
+	const uint16_t proxyPort = 47234;
+	bool ret = true;
+
+	UDPClient receiverSocket( "127.0.0.1", port );
+	UDPClient proxySocket( "127.0.0.1", proxyPort );
+	UDPClient senderSocket;
+	UDPClient forwardSocket;
+	senderSocket.connect( "127.0.0.1", proxyPort );
+	forwardSocket.connect( "127.0.0.1", port );
+
+	Image img( 200, 4, IFormat::RGBA_UINT8 );
+	testFillRandom( img );
+
+	UDPImageStreamSender sender( senderSocket, 512 );
+	UDPImageStreamReceiver receiver( receiverSocket );
+	sender.send( img );
+
+	/* row 0 is sent as two fragments: send the first one twice, drop the second */
+	std::vector<uint8_t> buffer( 65536 );
+	ssize_t len;
+	while( ( len = recv( proxySocket.socketDescriptor(), &buffer[ 0 ], buffer.size(), MSG_DONTWAIT ) ) > 0 ) {
+		uint32_t row, offset;
+		memcpy( &row, &buffer[ 6 * sizeof( uint32_t ) ], sizeof( uint32_t ) );
+		memcpy( &offset, &buffer[ 8 * sizeof( uint32_t ) ], sizeof( uint32_t ) );
+		if( ntohl( row ) == 0 && ntohl( offset ) != 0 )
+			continue;
+		send( forwardSocket.socketDescriptor(), &buffer[ 0 ], len, 0 );
+		if( ntohl( row ) == 0 )
+			send( forwardSocket.socketDescriptor(), &buffer[ 0 ], len, 0 );
+	}
+
+	const ImageStreamFrame* frame = receiver.receive( 100 );
+	ret &= frame != NULL;
+	if( frame ) {
+		ret &= !frame->complete() && !frame->rowValid( 0, 0 );
+		for( size_t y = 1; y < img.height(); y++ )
+			ret &= frame->rowValid( 0, y );
+		receiver.release( frame );
+	}
+	return ret;
+}
+
+BEGIN_CVTTEST( ImageStream )
+	bool result = true;
+	bool b;
+
+	b = _tcpTest();
+	CVTTEST_PRINT( "TCP image stream", b );
+	result &= b;
+
+	b = _udpTest();
+	CVTTEST_PRINT( "UDP image stream", b );
+	result &= b;
+
+	b = _udpFragmentTest();
+	CVTTEST_PRINT( "UDP duplicate fragments", b );
+	result &= b;
+
+	return result;
+END_CVTTEST
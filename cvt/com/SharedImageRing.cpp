@@ -0,0 +1,412 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/com/SharedImageRing.h>
+#include <cvt/math/Math.h>
+#include <cvt/util/Time.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#ifdef LINUX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+namespace cvt
+{
+	static const uint32_t SHAREDIMAGERING_MAGIC	  = 0x43565452; /* CVTR */
+	static const uint32_t SHAREDIMAGERING_VERSION = 2;
+	static const size_t	  SHAREDIMAGERING_READERS = 32;
+
+	/* slot sequence while the producer writes, 0 means empty */
+	static const uint64_t SLOT_WRITING = ~( ( uint64_t ) 0 );
+	/* reader without pinned slot */
+	static const uint32_t READER_IDLE = ~( ( uint32_t ) 0 );
+
+	/* attached consumer, pid 0 marks a free entry */
+	struct SharedImageRingReader {
+		uint32_t pid;
+		uint32_t pinned;
+	};
+
+	struct SharedImageRingHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t numSlots;
+		uint32_t futex;
+		uint64_t slotBytes;
+		uint64_t dataOffset;
+		uint64_t latest;
+		SharedImageRingReader readers[ SHAREDIMAGERING_READERS ];
+	};
+
+	struct SharedImageRingSlot {
+		uint64_t sequence;
+		uint32_t width;
+		uint32_t height;
+		uint32_t format;
+		uint32_t stride;
+	};
+
+	static String _shmName( const String& name )
+	{
+		if( name.length() && name[ 0 ] == '/' )
+			return name;
+		String ret( "/" );
+		ret += name;
+		return ret;
+	}
+
+	static void _throwErrno( const char* what )
+	{
+		String msg( what );
+		msg += strerror( errno );
+		throw CVTException( msg.c_str() );
+	}
+
+	static void _wait( uint32_t* futex, uint32_t value, ssize_t ms )
+	{
+#ifdef LINUX
+		struct timespec ts;
+		struct timespec* pts = NULL;
+		if( ms >= 0 ) {
+			ts.tv_sec = ms / 1000;
+			ts.tv_nsec = ( ms % 1000 ) * 1000000L;
+			pts = &ts;
+		}
+		syscall( SYS_futex, futex, FUTEX_WAIT, value, pts, NULL, 0 );
+#else
+		struct timespec ts;
+		ts.tv_sec = 0;
+		ts.tv_nsec = 200000L;
+		if( __atomic_load_n( futex, __ATOMIC_ACQUIRE ) == value )
+			nanosleep( &ts, NULL );
+#endif
+	}
+
+	static void _wake( uint32_t* futex )
+	{
+		__atomic_add_fetch( futex, 1, __ATOMIC_SEQ_CST );
+#ifdef LINUX
+		syscall( SYS_futex, futex, FUTEX_WAKE, 0x7fffffff, NULL, NULL, 0 );
+#endif
+	}
+
+	static bool _slotPinned( SharedImageRingHeader* header, size_t idx )
+	{
+		for( size_t i = 0; i < SHAREDIMAGERING_READERS; i++ ) {
+			if( __atomic_load_n( &header->readers[ i ].pinned, __ATOMIC_SEQ_CST ) == idx )
+				return true;
+		}
+		return false;
+	}
+
+	/* frees the entries of consumers that died without detaching, returns true if there were any */
+	static bool _reclaimReaders( SharedImageRingHeader* header )
+	{
+		bool ret = false;
+		for( size_t i = 0; i < SHAREDIMAGERING_READERS; i++ ) {
+			SharedImageRingReader& reader = header->readers[ i ];
+			uint32_t pid = __atomic_load_n( &reader.pid, __ATOMIC_SEQ_CST );
+			if( !pid || kill( ( pid_t ) pid, 0 ) == 0 || errno != ESRCH )
+				continue;
+			__atomic_store_n( &reader.pinned, READER_IDLE, __ATOMIC_SEQ_CST );
+			if( __atomic_compare_exchange_n( &reader.pid, &pid, 0, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ) )
+				ret = true;
+		}
+		return ret;
+	}
+
+	SharedImageRingProducer::SharedImageRingProducer( const String& name, size_t numSlots, size_t slotBytes ) :
+		_name( _shmName( name ) ),
+		_base( NULL ),
+		_size( 0 ),
+		_next( 0 ),
+		_writing( numSlots ),
+		_sequence( 0 ),
+		_image( NULL )
+	{
+		if( !numSlots || !slotBytes )
+			throw CVTException( "Invalid ring size" );
+
+		slotBytes = ( slotBytes + 63 ) & ~( ( size_t ) 63 );
+		size_t pagesize = sysconf( _SC_PAGESIZE );
+		size_t dataOffset = sizeof( SharedImageRingHeader ) + numSlots * sizeof( SharedImageRingSlot );
+		dataOffset = ( dataOffset + pagesize - 1 ) / pagesize * pagesize;
+		_size = dataOffset + numSlots * slotBytes;
+
+		/* a stale segment of a crashed producer is replaced */
+		shm_unlink( _name.c_str() );
+		int fd = shm_open( _name.c_str(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR );
+		if( fd < 0 )
+			_throwErrno( "shm_open: " );
+		if( ftruncate( fd, _size ) ) {
+			int err = errno;
+			close( fd );
+			shm_unlink( _name.c_str() );
+			errno = err;
+			_throwErrno( "ftruncate: " );
+		}
+		void* ptr = mmap( NULL, _size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+		close( fd );
+		if( ptr == MAP_FAILED ) {
+			shm_unlink( _name.c_str() );
+			_throwErrno( "mmap: " );
+		}
+
+		_base = ( uint8_t* ) ptr;
+		_header = ( SharedImageRingHeader* ) _base;
+		_slots = ( SharedImageRingSlot* ) ( _base + sizeof( SharedImageRingHeader ) );
+
+		memset( _base, 0, dataOffset );
+		for( size_t i = 0; i < SHAREDIMAGERING_READERS; i++ )
+			_header->readers[ i ].pinned = READER_IDLE;
+		_header->version = SHAREDIMAGERING_VERSION;
+		_header->numSlots = numSlots;
+		_header->slotBytes = slotBytes;
+		_header->dataOffset = dataOffset;
+		/* consumers only accept the segment once the magic is set */
+		__atomic_store_n( &_header->magic, SHAREDIMAGERING_MAGIC, __ATOMIC_RELEASE );
+	}
+
+	SharedImageRingProducer::~SharedImageRingProducer()
+	{
+		delete _image;
+		munmap( _base, _size );
+		shm_unlink( _name.c_str() );
+	}
+
+	size_t SharedImageRingProducer::numSlots() const
+	{
+		return _header->numSlots;
+	}
+
+	size_t SharedImageRingProducer::slotBytes() const
+	{
+		return _header->slotBytes;
+	}
+
+	Image* SharedImageRingProducer::beginWrite( size_t width, size_t height, const IFormat& format )
+	{
+		size_t stride = Math::pad16( width * format.bpp );
+		if( stride * height > _header->slotBytes )
+			throw CVTException( "Image does not fit into ring slot" );
+		if( _writing != _header->numSlots )
+			throw CVTException( "Previous write not finished" );
+
+		size_t n = _header->numSlots;
+		do {
+			for( size_t i = 0; i < n; i++ ) {
+				size_t idx = ( _next + i ) % n;
+				SharedImageRingSlot& slot = _slots[ idx ];
+
+				/* claim the slot first, then check for readers: either we see the reader or it sees the claim */
+				uint64_t old = __atomic_load_n( &slot.sequence, __ATOMIC_SEQ_CST );
+				__atomic_store_n( &slot.sequence, SLOT_WRITING, __ATOMIC_SEQ_CST );
+				if( _slotPinned( _header, idx ) ) {
+					__atomic_store_n( &slot.sequence, old, __ATOMIC_SEQ_CST );
+					continue;
+				}
+
+				slot.width = width;
+				slot.height = height;
+				slot.format = format.formatID;
+				slot.stride = stride;
+
+				_writing = idx;
+				_next = idx + 1;
+				delete _image;
+				_image = new Image( width, height, format, _base + _header->dataOffset + idx * _header->slotBytes, stride );
+				return _image;
+			}
+			/* all slots pinned, retry if crashed consumers held some of them */
+		} while( _reclaimReaders( _header ) );
+		return NULL;
+	}
+
+	uint64_t SharedImageRingProducer::endWrite()
+	{
+		if( _writing == _header->numSlots )
+			throw CVTException( "No write in progress" );
+
+		_sequence++;
+		__atomic_store_n( &_slots[ _writing ].sequence, _sequence, __ATOMIC_RELEASE );
+		__atomic_store_n( &_header->latest, _sequence, __ATOMIC_RELEASE );
+		_writing = _header->numSlots;
+		_wake( &_header->futex );
+		return _sequence;
+	}
+
+	SharedImageRingConsumer::SharedImageRingConsumer( const String& name ) :
+		_base( NULL ),
+		_size( 0 ),
+		_reader( SHAREDIMAGERING_READERS ),
+		_pinned( 0 ),
+		_sequence( 0 ),
+		_dropped( 0 ),
+		_image( NULL )
+	{
+		String shmname( _shmName( name ) );
+		int fd = shm_open( shmname.c_str(), O_RDWR, 0 );
+		if( fd < 0 )
+			_throwErrno( "shm_open: " );
+
+		struct stat st;
+		if( fstat( fd, &st ) || ( size_t ) st.st_size < sizeof( SharedImageRingHeader ) ) {
+			close( fd );
+			throw CVTException( "Shared image ring not initialized" );
+		}
+		_size = st.st_size;
+
+		void* ptr = mmap( NULL, _size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+		close( fd );
+		if( ptr == MAP_FAILED )
+			_throwErrno( "mmap: " );
+
+		_base = ( uint8_t* ) ptr;
+		_header = ( SharedImageRingHeader* ) _base;
+		_slots = ( SharedImageRingSlot* ) ( _base + sizeof( SharedImageRingHeader ) );
+
+		if( __atomic_load_n( &_header->magic, __ATOMIC_ACQUIRE ) != SHAREDIMAGERING_MAGIC ||
+			_header->version != SHAREDIMAGERING_VERSION ||
+			_header->dataOffset + _header->numSlots * _header->slotBytes > _size ) {
+			munmap( _base, _size );
+			throw CVTException( "Shared image ring not initialized" );
+		}
+		_pinned = _header->numSlots;
+
+		uint32_t pid = ( uint32_t ) getpid();
+		for( size_t pass = 0; pass < 2 && _reader == SHAREDIMAGERING_READERS; pass++ ) {
+			if( pass )
+				_reclaimReaders( _header );
+			for( size_t i = 0; i < SHAREDIMAGERING_READERS; i++ ) {
+				uint32_t none = 0;
+				if( __atomic_compare_exchange_n( &_header->readers[ i ].pid, &none, pid, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ) ) {
+					_reader = i;
+					break;
+				}
+			}
+		}
+		if( _reader == SHAREDIMAGERING_READERS ) {
+			munmap( _base, _size );
+			throw CVTException( "Too many shared image ring consumers" );
+		}
+
+		/* start at the newest frame published so far, earlier ones do not count as dropped */
+		uint64_t latest = __atomic_load_n( &_header->latest, __ATOMIC_ACQUIRE );
+		_sequence = latest ? latest - 1 : 0;
+	}
+
+	SharedImageRingConsumer::~SharedImageRingConsumer()
+	{
+		release();
+		__atomic_store_n( &_header->readers[ _reader ].pid, 0, __ATOMIC_SEQ_CST );
+		munmap( _base, _size );
+	}
+
+	void SharedImageRingConsumer::release()
+	{
+		delete _image;
+		_image = NULL;
+		if( _pinned != _header->numSlots ) {
+			__atomic_store_n( &_header->readers[ _reader ].pinned, READER_IDLE, __ATOMIC_SEQ_CST );
+			_pinned = _header->numSlots;
+		}
+	}
+
+	bool SharedImageRingConsumer::pin( size_t idx, uint64_t sequence )
+	{
+		SharedImageRingReader& reader = _header->readers[ _reader ];
+		__atomic_store_n( &reader.pinned, ( uint32_t ) idx, __ATOMIC_SEQ_CST );
+		if( __atomic_load_n( &_slots[ idx ].sequence, __ATOMIC_SEQ_CST ) != sequence ) {
+			__atomic_store_n( &reader.pinned, READER_IDLE, __ATOMIC_SEQ_CST );
+			return false;
+		}
+		_pinned = idx;
+		return true;
+	}
+
+	const Image* SharedImageRingConsumer::acquire( ssize_t timeoutms )
+	{
+		return acquire( timeoutms, false );
+	}
+
+	const Image* SharedImageRingConsumer::acquireLatest( ssize_t timeoutms )
+	{
+		return acquire( timeoutms, true );
+	}
+
+	const Image* SharedImageRingConsumer::acquire( ssize_t timeoutms, bool latest )
+	{
+		Time start;
+		size_t n = _header->numSlots;
+
+		release();
+
+		while( true ) {
+			uint32_t futex = __atomic_load_n( &_header->futex, __ATOMIC_ACQUIRE );
+
+			if( __atomic_load_n( &_header->latest, __ATOMIC_ACQUIRE ) > _sequence ) {
+				/* the wanted frame or the oldest newer one */
+				size_t best = n;
+				uint64_t bestSeq = 0;
+				for( size_t i = 0; i < n; i++ ) {
+					uint64_t seq = __atomic_load_n( &_slots[ i ].sequence, __ATOMIC_ACQUIRE );
+					if( !seq || seq == SLOT_WRITING || seq <= _sequence )
+						continue;
+					if( best == n || ( latest ? seq > bestSeq : seq < bestSeq ) ) {
+						best = i;
+						bestSeq = seq;
+					}
+				}
+
+				if( best != n && pin( best, bestSeq ) ) {
+					const SharedImageRingSlot& slot = _slots[ best ];
+					_dropped += bestSeq - _sequence - 1;
+					_sequence = bestSeq;
+					_image = new Image( slot.width, slot.height, IFormat::formatForId( ( IFormatID ) slot.format ),
+										_base + _header->dataOffset + best * _header->slotBytes, slot.stride );
+					return _image;
+				}
+				/* overwritten in between, look again */
+				if( best != n )
+					continue;
+			}
+
+			ssize_t wait = -1;
+			if( timeoutms >= 0 ) {
+				wait = timeoutms - ( ssize_t ) start.elapsedMilliSeconds();
+				if( wait <= 0 )
+					return NULL;
+			}
+			_wait( &_header->futex, futex, wait );
+		}
+	}
+}
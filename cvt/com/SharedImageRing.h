@@ -0,0 +1,125 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_SHAREDIMAGERING_H
+#define CVT_SHAREDIMAGERING_H
+
+#include <cvt/gfx/Image.h>
+#include <cvt/util/String.h>
+
+namespace cvt
+{
+	struct SharedImageRingHeader;
+	struct SharedImageRingSlot;
+
+	/**
+	  @brief Producer side of a POSIX shared-memory ring of image slots.
+
+	  The producer writes directly into a slot mapped as Image and publishes it with an atomic
+	  sequence number, consumers in other processes map the same slots without copying.
+	  Slots pinned by a consumer are skipped, no locks are involved on either side.
+	  Every consumer registers with its pid ( at most 32 at a time ); when all slots are pinned
+	  the producer frees the pins of consumers whose process no longer exists. Consumers in
+	  another pid namespace or a reused pid keep their pin until the entry is released.
+	 */
+	class SharedImageRingProducer
+	{
+		public:
+			/* creates the segment, slotBytes has to hold the largest image including row padding */
+			SharedImageRingProducer( const String& name, size_t numSlots, size_t slotBytes );
+			~SharedImageRingProducer();
+
+			/* returns NULL if all slots are pinned by consumers */
+			Image*		beginWrite( size_t width, size_t height, const IFormat& format );
+			uint64_t	endWrite();
+
+			size_t		numSlots() const;
+			size_t		slotBytes() const;
+
+		private:
+			SharedImageRingProducer( const SharedImageRingProducer& );
+
+			String					_name;
+			uint8_t*				_base;
+			size_t					_size;
+			SharedImageRingHeader*	_header;
+			SharedImageRingSlot*	_slots;
+			size_t					_next;
+			size_t					_writing;
+			uint64_t				_sequence;
+			Image*					_image;
+	};
+
+	/**
+	  @brief Consumer side of a SharedImageRingProducer.
+
+	  The image returned by acquire refers to the shared slot, it stays valid and is not
+	  overwritten by the producer until release or the next acquire. A new consumer starts
+	  at the newest frame published before it attached.
+	 */
+	class SharedImageRingConsumer
+	{
+		public:
+			SharedImageRingConsumer( const String& name );
+			~SharedImageRingConsumer();
+
+			/* next frame in order ( or the oldest one still available ), NULL on timeout */
+			const Image*	acquire( ssize_t timeoutms = -1 );
+			/* newest frame, skipping everything in between */
+			const Image*	acquireLatest( ssize_t timeoutms = -1 );
+			void			release();
+
+			uint64_t		sequence() const;
+			/* frames skipped since the consumer was created, earlier frames are not counted */
+			uint64_t		dropped() const;
+
+		private:
+			SharedImageRingConsumer( const SharedImageRingConsumer& );
+
+			const Image*	acquire( ssize_t timeoutms, bool latest );
+			bool			pin( size_t slot, uint64_t sequence );
+
+			uint8_t*				_base;
+			size_t					_size;
+			SharedImageRingHeader*	_header;
+			SharedImageRingSlot*	_slots;
+			size_t					_reader;
+			size_t					_pinned;
+			uint64_t				_sequence;
+			uint64_t				_dropped;
+			Image*					_image;
+	};
+
+	inline uint64_t SharedImageRingConsumer::sequence() const
+	{
+		return _sequence;
+	}
+
+	inline uint64_t SharedImageRingConsumer::dropped() const
+	{
+		return _dropped;
+	}
+}
+
+#endif
@@ -0,0 +1,206 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/com/SharedImageRing.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/util/CVTTest.h>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace cvt;
+
+static void _fill( Image& img, uint8_t value )
+{
+	IMapScoped<uint8_t> map( img );
+	for( size_t y = 0; y < img.height(); y++ ) {
+		memset( map.ptr(), value, img.width() * img.format().bpp );
+		map++;
+	}
+}
+
+static bool _check( const Image& img, uint8_t value )
+{
+	IMapScoped<const uint8_t> map( img );
+	for( size_t y = 0; y < img.height(); y++ ) {
+		const uint8_t* ptr = map.ptr();
+		for( size_t x = 0; x < img.width() * img.format().bpp; x++ ) {
+			if( ptr[ x ] != value )
+				return false;
+		}
+		map++;
+	}
+	return true;
+}
+
+static uint64_t _publish( SharedImageRingProducer& producer, uint8_t value )
+{
+	Image* img = producer.beginWrite( 61, 40, IFormat::GRAY_UINT8 );
+	if( !img )
+		return 0;
+	_fill( *img, value );
+	return producer.endWrite();
+}
+
+static bool _ringTest()
+{
+	bool ret = true;
+	SharedImageRingProducer producer( "cvt_sharedimagering_test", 3, 64 * 40 );
+	SharedImageRingConsumer consumer( "cvt_sharedimagering_test" );
+
+	ret &= consumer.acquire( 0 ) == NULL;
+
+	_publish( producer, 1 );
+	_publish( producer, 2 );
+	const Image* img = consumer.acquire( 0 );
+	ret &= img && consumer.sequence() == 1 && _check( *img, 1 );
+
+	/* the pinned slot is skipped, the other two are reused */
+	ret &= _publish( producer, 3 ) == 3;
+	ret &= _publish( producer, 4 ) == 4;
+	ret &= img && _check( *img, 1 );
+	ret &= _publish( producer, 5 ) == 5;
+	ret &= img && _check( *img, 1 );
+
+	/* frame 2 and 3 are gone */
+	img = consumer.acquire( 0 );
+	ret &= img && consumer.sequence() == 4 && _check( *img, 4 );
+	ret &= consumer.dropped() == 2;
+
+	/* pin all slots */
+	SharedImageRingConsumer consumer2( "cvt_sharedimagering_test" );
+	img = consumer2.acquireLatest( 0 );
+	ret &= img && consumer2.sequence() == 5 && _check( *img, 5 );
+	/* frames published before attaching are not dropped ones */
+	ret &= consumer2.dropped() == 0;
+	ret &= _publish( producer, 6 ) == 6;
+	SharedImageRingConsumer consumer3( "cvt_sharedimagering_test" );
+	img = consumer3.acquireLatest( 0 );
+	ret &= img && consumer3.sequence() == 6 && _check( *img, 6 );
+	ret &= _publish( producer, 7 ) == 0;
+
+	consumer.release();
+	consumer2.release();
+	consumer3.release();
+	ret &= _publish( producer, 7 ) == 7;
+	img = consumer.acquireLatest( 0 );
+	ret &= img && consumer.sequence() == 7 && _check( *img, 7 );
+	return ret;
+}
+
+static bool _processTest()
+{
+	const size_t frames = 20;
+	SharedImageRingProducer producer( "cvt_sharedimagering_proc", 4, 64 * 40 );
+	int fds[ 2 ];
+	if( pipe( fds ) )
+		return false;
+
+	pid_t pid = fork();
+	if( pid < 0 )
+		return false;
+
+	if( pid == 0 ) {
+		int status = 0;
+		try {
+			SharedImageRingConsumer consumer( "cvt_sharedimagering_proc" );
+			/* attached, the producer may start */
+			char c = 0;
+			if( write( fds[ 1 ], &c, 1 ) != 1 )
+				_exit( 3 );
+			for( size_t i = 1; i <= frames; i++ ) {
+				const Image* img = consumer.acquire( 2000 );
+				if( !img || consumer.sequence() != i || !_check( *img, ( uint8_t ) i ) ) {
+					status = 1;
+					break;
+				}
+			}
+		} catch( ... ) {
+			status = 2;
+		}
+		_exit( status );
+	}
+
+	char c;
+	bool attached = read( fds[ 0 ], &c, 1 ) == 1;
+	close( fds[ 0 ] );
+	close( fds[ 1 ] );
+	for( size_t i = 1; attached && i <= frames; i++ ) {
+		/* wait for the consumer if all slots are in use */
+		while( !_publish( producer, ( uint8_t ) i ) )
+			usleep( 100 );
+		usleep( 1000 );
+	}
+
+	int status;
+	waitpid( pid, &status, 0 );
+	return attached && WIFEXITED( status ) && WEXITSTATUS( status ) == 0;
+}
+
+/* the pin of a consumer that exits without releasing is reclaimed */
+static bool _stalePinTest()
+{
+	bool ret = true;
+	SharedImageRingProducer producer( "cvt_sharedimagering_stale", 2, 64 * 40 );
+	_publish( producer, 1 );
+
+	pid_t pid = fork();
+	if( pid < 0 )
+		return false;
+	if( pid == 0 ) {
+		SharedImageRingConsumer* consumer = new SharedImageRingConsumer( "cvt_sharedimagering_stale" );
+		_exit( consumer->acquireLatest( 0 ) ? 0 : 1 );
+	}
+	int status;
+	waitpid( pid, &status, 0 );
+	ret &= WIFEXITED( status ) && WEXITSTATUS( status ) == 0;
+
+	SharedImageRingConsumer consumer( "cvt_sharedimagering_stale" );
+	ret &= _publish( producer, 2 ) == 2;
+	const Image* img = consumer.acquireLatest( 0 );
+	ret &= img && consumer.sequence() == 2;
+	/* frame 1 is still pinned by the dead consumer, frame 2 by the live one */
+	ret &= _publish( producer, 3 ) == 3;
+	ret &= img && _check( *img, 2 );
+	return ret;
+}
+
+BEGIN_CVTTEST( SharedImageRing )
+	bool result = true;
+	bool b;
+
+	b = _ringTest();
+	CVTTEST_PRINT( "slots, pinning and dropped frames", b );
+	result &= b;
+
+	b = _processTest();
+	CVTTEST_PRINT( "handoff between processes", b );
+	result &= b;
+
+	b = _stalePinTest();
+	CVTTEST_PRINT( "reclaim pins of dead consumers", b );
+	result &= b;
+
+	return result;
+END_CVTTEST
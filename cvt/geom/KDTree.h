@@ -26,238 +26,409 @@
 #define CVT_KDTREE_H
 
 #include <vector>
+#include <algorithm>
+#include <limits>
+#include <sys/types.h>
 
 #include <cvt/math/Vector.h>
+#include <cvt/geom/PointSet.h>
+#include <cvt/util/TaskGroup.h>
+#include <cvt/util/ParallelFor.h>
 
 namespace cvt
 {
-
-#define PT( n ) _pts[ _ptidx[ n ] ][ idx ]
-#define SWAP( a, b ) do { ssize_t t = _ptidx[ a ]; _ptidx[ a ] = _ptidx[ b ]; _ptidx[ b ] = t; } while( 0 )
-
-    template<class _T=Point2f>
+	/**
+	  \brief Implicit, balanced KD-tree.
+
+	  The points are copied and reordered, so that every node covers a contiguous
+	  range of the point array and the tree needs no pointers: node i has the
+	  children 2i+1 and 2i+2, only the split dimension and value are stored.
+	  Leaves hold up to leafSize points whose coordinates are additionally kept
+	  per dimension, so the distance evaluation of a leaf is a vectorizable loop.
+	  All search results are indices into the point set the tree was built from.
+	 */
+	template<class _T=Point2f>
 	class KDTree {
 		public:
-			KDTree( const std::vector<_T> & pts );
+			typedef typename _T::TYPE SCALAR;
+
+			KDTree( const std::vector<_T>& pts, size_t leafSize = 16 );
+			template<int dim>
+			KDTree( const PointSet<dim, SCALAR>& pts, size_t leafSize = 16 );
 			~KDTree();
 
-			// return index of nearest neighbor
-			ssize_t locate( const _T & pt, float dist );
-            void rangeSearch( std::vector<_T> &output, const _T &pt, float dist );
+			size_t	size() const;
+
+			// return index of nearest neighbor within dist, -1 if there is none
+			ssize_t locate( const _T& pt, float dist ) const;
+			// the k nearest neighbors sorted by distance
+			void	knn( std::vector<size_t>& ids, std::vector<SCALAR>& sqrDists, const _T& pt, size_t k ) const;
+			// k nearest neighbors for all queries in parallel: ids[ i * k + j ], ( size_t ) -1 if there are less than k points
+			void	knn( std::vector<size_t>& ids, std::vector<SCALAR>& sqrDists, const std::vector<_T>& queries, size_t k ) const;
+			// all points within radius
+			void	radiusSearch( std::vector<size_t>& ids, const _T& pt, SCALAR radius ) const;
+			void	rangeSearch( std::vector<_T>& output, const _T& pt, float dist ) const;
 
 		private:
-            void build( ssize_t l, ssize_t h, ssize_t idx );
-            ssize_t partition( ssize_t l, ssize_t h, ssize_t x, ssize_t idx );
-			/* select the x-th element according to dimension idx */
-            void select(  ssize_t l, ssize_t h, ssize_t x, ssize_t idx );
+			KDTree( const KDTree& );
+			KDTree& operator=( const KDTree& );
+
+			enum { MAXLEAFSIZE = 64, PARALLELBUILDSIZE = 16384 };
+
+			struct DimCompare {
+				DimCompare( const std::vector<_T>& pts, size_t dim ) : _pts( pts ), _dim( dim ) {}
+				bool operator()( size_t a, size_t b ) const { return _pts[ a ][ _dim ] < _pts[ b ][ _dim ]; }
+				const std::vector<_T>& _pts;
+				size_t _dim;
+			};
+
+			class BuildTask;
+			struct KNNVisitor;
+			struct RadiusVisitor;
+			struct BatchKNN;
+
+			void	build( const std::vector<_T>& pts );
+			void	buildNode( const std::vector<_T>& pts, std::vector<size_t>& perm, size_t node, size_t l, size_t h, size_t level, TaskGroup* group );
+			void	leafDistances( SCALAR* dist, const _T& pt, size_t l, size_t h ) const;
+			template<class VISITOR>
+			void	search( VISITOR& visitor, const _T& pt, size_t node, size_t l, size_t h, size_t level ) const;
+
+			size_t				_dim;
+			size_t				_leafSize;
+			size_t				_depth;
+			std::vector<_T>		_pts;
+			std::vector<size_t>	_ids;
+			std::vector<SCALAR>	_coords;
+			std::vector<SCALAR>	_split;
+			std::vector<size_t>	_splitDim;
+	};
 
-            ssize_t visit( ssize_t low, ssize_t high, const _T & pt, float distance, ssize_t idx );
-            void visit( std::vector<_T> &output, const _T &pt, double *min, double *max, double distance, ssize_t low, ssize_t high, ssize_t idx );
+	template<class _T>
+	class KDTree<_T>::BuildTask : public Task {
+		public:
+			BuildTask( KDTree<_T>& tree, const std::vector<_T>& pts, std::vector<size_t>& perm, size_t node, size_t l, size_t h, size_t level, TaskGroup& group ) :
+				_tree( tree ), _pts( pts ), _perm( perm ), _node( node ), _l( l ), _h( h ), _level( level ), _group( group )
+			{
+			}
 
-			void print();
-            void check( ssize_t l, ssize_t h, ssize_t idx );
+			void execute()
+			{
+				_tree.buildNode( _pts, _perm, _node, _l, _h, _level, &_group );
+			}
 
+		private:
+			KDTree<_T>&				_tree;
 			const std::vector<_T>&	_pts;
-			ssize_t*				_ptidx;
-            size_t					_dim;
+			std::vector<size_t>&	_perm;
+			size_t					_node, _l, _h, _level;
+			TaskGroup&				_group;
+	};
+
+	template<class _T>
+	struct KDTree<_T>::KNNVisitor {
+		KNNVisitor( size_t* ids, SCALAR* dists, size_t k, SCALAR maxDist ) :
+			_ids( ids ), _dists( dists ), _k( k ), _num( 0 ), _maxDist( maxDist )
+		{
+		}
+
+		SCALAR bound() const
+		{
+			return _num < _k ? _maxDist : _dists[ _k - 1 ];
+		}
+
+		void add( size_t idx, SCALAR dist )
+		{
+			if( dist > bound() || ( _num == _k && dist == _dists[ _k - 1 ] ) )
+				return;
+			size_t i = _num < _k ? _num++ : _k - 1;
+			/* bounded priority list, sorted insertion from the back */
+			while( i > 0 && _dists[ i - 1 ] > dist ) {
+				_dists[ i ] = _dists[ i - 1 ];
+				_ids[ i ] = _ids[ i - 1 ];
+				i--;
+			}
+			_dists[ i ] = dist;
+			_ids[ i ] = idx;
+		}
+
+		size_t*	_ids;
+		SCALAR*	_dists;
+		size_t	_k;
+		size_t	_num;
+		SCALAR	_maxDist;
+	};
+
+	template<class _T>
+	struct KDTree<_T>::RadiusVisitor {
+		RadiusVisitor( std::vector<size_t>& ids, SCALAR sqrRadius ) : _ids( ids ), _sqrRadius( sqrRadius )
+		{
+		}
+
+		SCALAR bound() const
+		{
+			return _sqrRadius;
+		}
+
+		void add( size_t idx, SCALAR dist )
+		{
+			if( dist <= _sqrRadius )
+				_ids.push_back( idx );
+		}
+
+		std::vector<size_t>& _ids;
+		SCALAR				 _sqrRadius;
+	};
+
+	template<class _T>
+	struct KDTree<_T>::BatchKNN {
+		BatchKNN( const KDTree<_T>& tree, const std::vector<_T>& queries, size_t* ids, SCALAR* dists, size_t k ) :
+			_tree( tree ), _queries( queries ), _ids( ids ), _dists( dists ), _k( k )
+		{
+		}
+
+		void operator()( const Range<size_t>& r ) const
+		{
+			for( size_t q = r.min; q < r.max; q++ ) {
+				size_t* ids = _ids + q * _k;
+				SCALAR* dists = _dists + q * _k;
+				KNNVisitor visitor( ids, dists, _k, std::numeric_limits<SCALAR>::max() );
+				_tree.search( visitor, _queries[ q ], 0, 0, _tree._pts.size(), 0 );
+				for( size_t i = 0; i < visitor._num; i++ )
+					ids[ i ] = _tree._ids[ ids[ i ] ];
+				for( size_t i = visitor._num; i < _k; i++ ) {
+					ids[ i ] = ( size_t ) -1;
+					dists[ i ] = std::numeric_limits<SCALAR>::max();
+				}
+			}
+		}
+
+		const KDTree<_T>&		_tree;
+		const std::vector<_T>&	_queries;
+		size_t*					_ids;
+		SCALAR*					_dists;
+		size_t					_k;
 	};
 
-    template <class _T>
-    inline KDTree<_T>::KDTree( const std::vector<_T> & pts ) : _pts( pts )
-    {
-        size_t npts = _pts.size();
-        if( npts == 0 )
-            return;
-        _ptidx = new ssize_t[ npts ];
-        _dim = pts[0].dimension();
-
-        for( size_t i = 0; i < npts; i++ )
-            _ptidx[ i ] = i;
-
-        build( 0, npts - 1, 0 );
-    }
-
-    template<class _T>
-    inline KDTree<_T>::~KDTree()
-    {
-        delete[] _ptidx;
-    }
-
-    template <class _T>
-    inline ssize_t KDTree<_T>::locate( const _T & pt, float dist )
-    {
-        ssize_t nearestIndex = visit( 0, _pts.size() - 1, pt, dist, 0 );
-
-        return _ptidx[ nearestIndex ];
-    }
-
-    template <class _T>
-    inline void KDTree<_T>::build( ssize_t l, ssize_t h, ssize_t idx )
-    {
-        if (l<h)
-        {
-            ssize_t med = (l+h)>>1;
-            select( l, h, med, idx );
-
-            build( l, med-1, (idx+1)%_dim );
-            build( med+1, h, (idx+1)%_dim );
-        }
-    }
-
-    template <class _T>
-    inline ssize_t KDTree<_T>::partition( ssize_t l, ssize_t h, ssize_t x, ssize_t idx )
-    {
-        ssize_t pivot = l;
-
-        SWAP( x, h );
-
-        for ( ssize_t i = l; i < h; ++i )
-        {
-            if ( PT(i) < PT(h) )
-            {
-                SWAP( pivot, i );
-                pivot++;
-            }
-        }
-
-        SWAP( pivot, h );
-        return pivot;
-    }
-
-    template <class _T>
-    void KDTree<_T>::select( ssize_t l, ssize_t h, ssize_t x, ssize_t idx )
-    {
-        if (h>l)
-        {
-            ssize_t pivot = partition( l, h, x, idx );
-
-            if ( pivot > x )
-                select( l, pivot-1, x, idx );
-            if ( pivot < x )
-                select( pivot+1, h, x, idx );
-        }
-    }
-
-    template <class _T>
-    inline ssize_t KDTree<_T>::visit( ssize_t low, ssize_t high,
-                                       const _T & pt, float dist, ssize_t idx )
-    {
-        if( high - low < 2 ){
-            // check low and high
-            float nearest = ( _pts[ _ptidx[ low ] ] - pt ).length();
-            if( nearest <  ( _pts[ _ptidx[ high ] ] - pt ).length() )
-                return low;
-            else
-                return high;
-        }
-
-        ssize_t medianIdx = ( high + low ) >> 1;
-
-        float min = pt[ idx ] - dist;
-        float max = pt[ idx ] + dist;
-
-        if( PT( medianIdx ) > max ){
-            // search left half
-            return visit( low, medianIdx - 1, pt, dist, (idx+1)%_dim );
-        }
-
-        if( PT( medianIdx ) < min ){
-            // search right half
-            return visit( medianIdx + 1, high, pt, dist, (idx+1)%_dim );
-        }
-
-        // search both halfes and compare the results and also the median!:
-        ssize_t bestLow = visit( low, medianIdx - 1, pt, dist, (idx+1)%_dim );
-        ssize_t bestHigh = visit( medianIdx + 1, high, pt, dist, (idx+1)%_dim );
-
-        const _T & other = _pts[ _ptidx[ medianIdx ] ];
-        ssize_t bestIdx = medianIdx;
-        float nearestDistance = ( other - pt ).length();
-
-        float tmp = ( _pts[ _ptidx[ bestLow ] ] - pt ).length();
-        if( tmp < nearestDistance ){
-            nearestDistance = tmp;
-            bestIdx = bestLow;
-        }
-
-        tmp = ( _pts[ _ptidx[ bestHigh ] ] - pt ).length();
-        if( tmp < nearestDistance ){
-            nearestDistance = tmp;
-            bestIdx = bestHigh;
-        }
-
-        return bestIdx;
-    }
-
-    template<class _T>
-    void KDTree<_T>::rangeSearch( std::vector<_T> &output, const _T &pt, float distance )
-    {
-        double min[ _dim ];
-        double max[ _dim ];
-
-        for( size_t i = 0; i < _dim; ++i ){
-            min[i] = pt[i] - distance;
-            max[i] = pt[i] + distance;
-        }
-
-        visit( output, pt, min, max, distance, 0, _pts.size()-1, 0 );
-    }
-
-    template<class _T>
-    void KDTree<_T>::visit( std::vector<_T> &output, const _T &pt, double *min, double *max, double distance, ssize_t l, ssize_t h, ssize_t idx )
-    {
-        ssize_t med = (l+h) >> 1;
-        const _T &root = _pts[ _ptidx[ med ] ];
-
-        if (h >= l)
-        {
-            float dist = (root-pt).length();
-
-            if ( dist <= distance )
-            {
-                output.push_back(root);
-            }
-        }
-
-        if (h > l)
-        {
-            if (max[idx] >= root[idx])
-                visit( output, pt, min, max, distance, med+1, h, (idx+1)%_dim );
-
-            if (min[idx] <= root[idx])
-                visit( output, pt, min, max, distance, l, med-1, (idx+1)%_dim );
-        }
-    }
-
-    template<class _T>
-    inline void KDTree<_T>::check( ssize_t l, ssize_t h, ssize_t idx )
-    {
-        ssize_t med = ( l + h ) >> 1;
-
-        if( l >= h )
-            return;
-
-        for( ssize_t x = l; x < h; x++ ) {
-            if( x < med && PT( x ) > PT( med ) )
-                std::cout << "lower than median has bigger value" << std::endl;
-            if( x > med && PT( x ) < PT( med ) )
-                std::cout << "bigger than median has lower value" << std::endl;
-        }
-        check( l, med - 1, (idx+1)%_dim );
-        check( med + 1, h, (idx+1)%_dim );
-    }
-
-    template<class _T>
-    inline void KDTree<_T>::print()
-    {
-        for( size_t idx = 0; idx < _dim; ++idx ) {
-            printf( "dim %lu : ", idx );
-            for( ssize_t i = 0; i < _pts.size(); i++ ){
-                std::cout << PT( i ) << " ";
-            }
-            printf( "\n\n" );
-        }
-    }
+	template <class _T>
+	inline KDTree<_T>::KDTree( const std::vector<_T>& pts, size_t leafSize ) :
+		_dim( 0 ),
+		_leafSize( Math::clamp<size_t>( leafSize, 1, MAXLEAFSIZE ) ),
+		_depth( 0 )
+	{
+		build( pts );
+	}
+
+	template <class _T>
+	template <int dim>
+	inline KDTree<_T>::KDTree( const PointSet<dim, SCALAR>& pts, size_t leafSize ) :
+		_dim( 0 ),
+		_leafSize( Math::clamp<size_t>( leafSize, 1, MAXLEAFSIZE ) ),
+		_depth( 0 )
+	{
+		std::vector<_T> vpts( pts.begin(), pts.end() );
+		build( vpts );
+	}
+
+	template<class _T>
+	inline KDTree<_T>::~KDTree()
+	{
+	}
+
+	template<class _T>
+	inline size_t KDTree<_T>::size() const
+	{
+		return _pts.size();
+	}
+
+	template<class _T>
+	inline void KDTree<_T>::build( const std::vector<_T>& pts )
+	{
+		size_t n = pts.size();
+		if( !n )
+			return;
+		_dim = pts[ 0 ].dimension();
+
+		/* all leaves are on the same level and hold at most _leafSize points */
+		while( ( ( n + ( ( size_t ) 1 << _depth ) - 1 ) >> _depth ) > _leafSize )
+			_depth++;
+		size_t nodes = ( ( size_t ) 1 << _depth ) - 1;
+		_split.resize( nodes );
+		_splitDim.resize( nodes );
+
+		std::vector<size_t> perm( n );
+		for( size_t i = 0; i < n; i++ )
+			perm[ i ] = i;
+
+		ThreadPool& pool = ThreadPool::instance();
+		if( pool.numWorkers() && n > PARALLELBUILDSIZE ) {
+			TaskGroup group( pool );
+			buildNode( pts, perm, 0, 0, n, 0, &group );
+			group.join();
+		} else {
+			buildNode( pts, perm, 0, 0, n, 0, NULL );
+		}
+
+		_ids.swap( perm );
+		_pts.resize( n );
+		_coords.resize( n * _dim );
+		for( size_t i = 0; i < n; i++ ) {
+			_pts[ i ] = pts[ _ids[ i ] ];
+			for( size_t d = 0; d < _dim; d++ )
+				_coords[ d * n + i ] = _pts[ i ][ d ];
+		}
+	}
+
+	template<class _T>
+	inline void KDTree<_T>::buildNode( const std::vector<_T>& pts, std::vector<size_t>& perm, size_t node, size_t l, size_t h, size_t level, TaskGroup* group )
+	{
+		while( level < _depth ) {
+			/* split the dimension with the largest extent at the median */
+			_T min = pts[ perm[ l ] ];
+			_T max = min;
+			for( size_t i = l + 1; i < h; i++ ) {
+				const _T& p = pts[ perm[ i ] ];
+				for( size_t d = 0; d < _dim; d++ ) {
+					min[ d ] = Math::min( min[ d ], p[ d ] );
+					max[ d ] = Math::max( max[ d ], p[ d ] );
+				}
+			}
+			size_t dim = 0;
+			for( size_t d = 1; d < _dim; d++ ) {
+				if( max[ d ] - min[ d ] > max[ dim ] - min[ dim ] )
+					dim = d;
+			}
+
+			size_t mid = l + ( ( h - l ) >> 1 );
+			std::nth_element( perm.begin() + l, perm.begin() + mid, perm.begin() + h, DimCompare( pts, dim ) );
+			_splitDim[ node ] = dim;
+			_split[ node ] = pts[ perm[ mid ] ][ dim ];
+
+			if( group && h - l > PARALLELBUILDSIZE )
+				group->spawn( new BuildTask( *this, pts, perm, 2 * node + 2, mid, h, level + 1, *group ) );
+			else
+				buildNode( pts, perm, 2 * node + 2, mid, h, level + 1, group );
+
+			node = 2 * node + 1;
+			h = mid;
+			level++;
+		}
+	}
+
+	template<class _T>
+	inline void KDTree<_T>::leafDistances( SCALAR* dist, const _T& pt, size_t l, size_t h ) const
+	{
+		size_t n = h - l;
+		size_t stride = _pts.size();
+		for( size_t i = 0; i < n; i++ )
+			dist[ i ] = 0;
+		for( size_t d = 0; d < _dim; d++ ) {
+			const SCALAR* c = &_coords[ d * stride + l ];
+			SCALAR v = pt[ d ];
+			for( size_t i = 0; i < n; i++ ) {
+				SCALAR t = c[ i ] - v;
+				dist[ i ] += t * t;
+			}
+		}
+	}
+
+	template<class _T>
+	template<class VISITOR>
+	inline void KDTree<_T>::search( VISITOR& visitor, const _T& pt, size_t node, size_t l, size_t h, size_t level ) const
+	{
+		if( level == _depth ) {
+			SCALAR dist[ MAXLEAFSIZE ];
+			leafDistances( dist, pt, l, h );
+			for( size_t i = 0; i < h - l; i++ )
+				visitor.add( l + i, dist[ i ] );
+			return;
+		}
+
+		size_t mid = l + ( ( h - l ) >> 1 );
+		SCALAR diff = pt[ _splitDim[ node ] ] - _split[ node ];
+		if( diff < 0 ) {
+			search( visitor, pt, 2 * node + 1, l, mid, level + 1 );
+			if( diff * diff <= visitor.bound() )
+				search( visitor, pt, 2 * node + 2, mid, h, level + 1 );
+		} else {
+			search( visitor, pt, 2 * node + 2, mid, h, level + 1 );
+			if( diff * diff <= visitor.bound() )
+				search( visitor, pt, 2 * node + 1, l, mid, level + 1 );
+		}
+	}
+
+	template <class _T>
+	inline ssize_t KDTree<_T>::locate( const _T& pt, float dist ) const
+	{
+		if( _pts.empty() )
+			return -1;
+
+		size_t id;
+		SCALAR sqrDist;
+		KNNVisitor visitor( &id, &sqrDist, 1, ( SCALAR ) dist * ( SCALAR ) dist );
+		search( visitor, pt, 0, 0, _pts.size(), 0 );
+		if( !visitor._num )
+			return -1;
+		return _ids[ id ];
+	}
+
+	template <class _T>
+	inline void KDTree<_T>::knn( std::vector<size_t>& ids, std::vector<SCALAR>& sqrDists, const _T& pt, size_t k ) const
+	{
+		k = Math::min( k, _pts.size() );
+		ids.resize( k );
+		sqrDists.resize( k );
+		if( !k )
+			return;
+
+		KNNVisitor visitor( &ids[ 0 ], &sqrDists[ 0 ], k, std::numeric_limits<SCALAR>::max() );
+		search( visitor, pt, 0, 0, _pts.size(), 0 );
+		for( size_t i = 0; i < k; i++ )
+			ids[ i ] = _ids[ ids[ i ] ];
+	}
+
+	template <class _T>
+	inline void KDTree<_T>::knn( std::vector<size_t>& ids, std::vector<SCALAR>& sqrDists, const std::vector<_T>& queries, size_t k ) const
+	{
+		ids.resize( queries.size() * k );
+		sqrDists.resize( queries.size() * k );
+		if( ids.empty() )
+			return;
+
+		if( _pts.empty() ) {
+			std::fill( ids.begin(), ids.end(), ( size_t ) -1 );
+			std::fill( sqrDists.begin(), sqrDists.end(), std::numeric_limits<SCALAR>::max() );
+			return;
+		}
+
+		BatchKNN body( *this, queries, &ids[ 0 ], &sqrDists[ 0 ], k );
+		parallelFor( Range<size_t>( 0, queries.size() ), body, 256 );
+	}
+
+	template<class _T>
+	inline void KDTree<_T>::radiusSearch( std::vector<size_t>& ids, const _T& pt, SCALAR radius ) const
+	{
+		ids.clear();
+		if( _pts.empty() )
+			return;
+
+		RadiusVisitor visitor( ids, radius * radius );
+		search( visitor, pt, 0, 0, _pts.size(), 0 );
+		for( size_t i = 0; i < ids.size(); i++ )
+			ids[ i ] = _ids[ ids[ i ] ];
+	}
+
+	template<class _T>
+	inline void KDTree<_T>::rangeSearch( std::vector<_T>& output, const _T& pt, float dist ) const
+	{
+		if( _pts.empty() )
+			return;
+
+		std::vector<size_t> ids;
+		RadiusVisitor visitor( ids, ( SCALAR ) dist * ( SCALAR ) dist );
+		search( visitor, pt, 0, 0, _pts.size(), 0 );
+		for( size_t i = 0; i < ids.size(); i++ )
+			output.push_back( _pts[ ids[ i ] ] );
+	}
 }
 
 #endif
@@ -27,6 +27,9 @@
 #include <cvt/util/Time.h>
 #include <cvt/math/Vector.h>
 #include <cvt/geom/KDTree.h>
+#include <cvt/geom/PointSet.h>
+
+#include <algorithm>
 
 namespace cvt {
 
@@ -89,7 +92,7 @@ namespace cvt {
         std::vector<VecType> kresult;
         VecType  pt;
         for( size_t i = 0; i < dim; i++ )
-            pt[ dim ] = Math::rand( -50.0f, 50.0f );
+            pt[ i ] = Math::rand( -50.0f, 50.0f );
 
         float range = Math::rand( 0.0f, 50.0f );
         kdtree.rangeSearch( kresult, pt, range );
@@ -98,6 +101,64 @@ namespace cvt {
         return b;
     }
 
+    template <size_t dim>
+    static bool knnTest()
+    {
+        typedef typename Vector<dim, float >::TYPE VecType;
+        std::vector<VecType> data, queries;
+        generateVectors<dim>( data, 20000 );
+        generateVectors<dim>( queries, 200 );
+
+        KDTree<VecType> kdtree( data );
+        const size_t k = 7;
+
+        std::vector<size_t> ids, batchIds;
+        std::vector<float> dists, batchDists;
+        kdtree.knn( batchIds, batchDists, queries, k );
+
+        bool b = batchIds.size() == queries.size() * k;
+        for( size_t q = 0; b && q < queries.size(); q++ ){
+            std::vector<float> ref;
+            for( size_t i = 0; i < data.size(); i++ )
+                ref.push_back( ( data[ i ] - queries[ q ] ).lengthSqr() );
+            std::sort( ref.begin(), ref.end() );
+
+            kdtree.knn( ids, dists, queries[ q ], k );
+            for( size_t i = 0; i < k; i++ ){
+                b &= dists[ i ] == ref[ i ];
+                b &= ( data[ ids[ i ] ] - queries[ q ] ).lengthSqr() == dists[ i ];
+                b &= batchIds[ q * k + i ] == ids[ i ];
+            }
+
+            ssize_t nn = kdtree.locate( queries[ q ], 1e6f );
+            b &= nn >= 0 && ( data[ nn ] - queries[ q ] ).lengthSqr() == ref[ 0 ];
+        }
+
+        if( !b )
+            std::cout << "KNN test failed for dimension " << dim << std::endl;
+        return b;
+    }
+
+    static bool pointSetTest()
+    {
+        PointSet3f ptset;
+        for( size_t i = 0; i < 1000; i++ )
+            ptset.add( Vector3f( Math::rand( -1.0f, 1.0f ), Math::rand( -1.0f, 1.0f ), Math::rand( -1.0f, 1.0f ) ) );
+
+        KDTree<Vector3f> kdtree( ptset, 8 );
+        bool b = kdtree.size() == ptset.size();
+        for( size_t i = 0; i < ptset.size(); i += 10 )
+            b &= kdtree.locate( ptset[ i ], 0.0f ) == ( ssize_t ) i;
+
+        std::vector<size_t> ids;
+        kdtree.radiusSearch( ids, Vector3f( 0.0f, 0.0f, 0.0f ), 0.5f );
+        size_t num = 0;
+        for( size_t i = 0; i < ptset.size(); i++ )
+            num += ptset[ i ].lengthSqr() <= 0.25f ? 1 : 0;
+        b &= ids.size() == num;
+        return b;
+    }
+
 }
 
 BEGIN_CVTTEST( KDTree )
@@ -116,5 +177,14 @@ BEGIN_CVTTEST( KDTree )
     ret &= cvt::rangeTest<4>();
     CVTTEST_PRINT( "range test Vector 4", ret );
 
+    bool b = cvt::knnTest<2>();
+    b &= cvt::knnTest<3>();
+    CVTTEST_PRINT( "knn test", b );
+    ret &= b;
+
+    b = cvt::pointSetTest();
+    CVTTEST_PRINT( "PointSet3f", b );
+    ret &= b;
+
     return ret;
 END_CVTTEST
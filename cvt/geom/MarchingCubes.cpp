@@ -25,6 +25,9 @@
 
 #include "MarchingCubes.h"
 #include <cvt/math/Math.h>
+#include <cvt/util/ParallelFor.h>
+
+#include <algorithm>
 
 namespace cvt {
 
@@ -322,144 +325,137 @@ namespace cvt {
 
 
 
-	void MarchingCubes::triangulateDistance( SceneMesh& mesh, float isolevel ) const
-	{
-		float gridval[ 8 ];
-		Vector3f gridvtx[ 8 ];
-		int cubeindex;
-		Vector3f vertlist[ 12 ];
-		size_t vtxIdx = 0;
-		std::vector<Vector3f> vertices;
+	/* edge -> ( axis, offset of the lower end point ) in the cell, see the corner numbering above */
+	static const int _edgeAxis[ 12 ]   = { 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2 };
+	static const int _edgeOffset[ 12 ][ 3 ] = {
+		{ 0, 0, 0 }, { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 0 },
+		{ 0, 0, 1 }, { 1, 0, 1 }, { 0, 1, 1 }, { 0, 0, 1 },
+		{ 0, 0, 0 }, { 1, 0, 0 }, { 1, 1, 0 }, { 0, 1, 0 }
+	};
+
+	static const unsigned int MC_NOVERTEX = 0xffffffff;
+
+	struct MarchingCubes::SlabData {
+		/* vertices and faces with slab local indices */
+		std::vector<Vector3f>	  vertices;
+		std::vector<Vector3f>	  normals;
 		std::vector<unsigned int> faces;
 
-		size_t xend = _width - 1;
-		size_t yend = _height - 1;
-		size_t zend = _depth - 1;
-
-		for( size_t z = 0; z < zend; z++  ) {
-			for( size_t y = 0; y < yend; y++ ) {
-				for( size_t x = 0; x < xend; x++ ) {
-
-#define VOLUME( x, y, z ) _volume[ ( ( z ) * _height + ( y ) ) * _width + ( x ) ]
-					/* get the values of the current grid voxel */
-					gridval[ 0 ] = VOLUME( x, y, z );
-					gridval[ 1 ] = VOLUME( x + 1, y, z );
-					gridval[ 2 ] = VOLUME( x + 1, y + 1, z );
-					gridval[ 3 ] = VOLUME( x, y + 1, z );
-					gridval[ 4 ] = VOLUME( x, y, z + 1 );
-					gridval[ 5 ] = VOLUME( x + 1, y, z + 1 );
-					gridval[ 6 ] = VOLUME( x + 1, y + 1, z + 1);
-					gridval[ 7 ] = VOLUME( x, y + 1, z + 1 );
-#undef VOLUME
+		/* ( edge key, local vertex ) of the vertices on the bottom and top plane */
+		std::vector<std::pair<unsigned int, unsigned int> > bottom;
+		std::vector<std::pair<unsigned int, unsigned int> > top;
 
-					/*
-					   Determine the index into the edge table which
-					   tells us which vertices are inside of the surface
-					 */
-					cubeindex = 0;
-					if( gridval[ 0 ] < isolevel ) cubeindex |= 1;
-					if( gridval[ 1 ] < isolevel ) cubeindex |= 2;
-					if( gridval[ 2 ] < isolevel ) cubeindex |= 4;
-					if( gridval[ 3 ] < isolevel ) cubeindex |= 8;
-					if( gridval[ 4 ] < isolevel ) cubeindex |= 16;
-					if( gridval[ 5 ] < isolevel ) cubeindex |= 32;
-					if( gridval[ 6 ] < isolevel ) cubeindex |= 64;
-					if( gridval[ 7 ] < isolevel ) cubeindex |= 128;
+		/* edge caches: x- and y-edges of the lower and upper plane of the current layer and z-edges of the layer */
+		std::vector<unsigned int> lowx, lowy, upx, upy, zedge;
+	};
 
-					/* Cube is entirely in/out of the surface */
-					if ( _edgeTable[ cubeindex ] == 0)
-						continue;
+	class MarchingCubesSlabBody {
+		public:
+			MarchingCubesSlabBody( const MarchingCubes& mc, std::vector<MarchingCubes::SlabData>& slabs, size_t zbegin, size_t zend, size_t slabbegin, bool normals, float isolevel ) :
+				_mc( mc ), _slabs( slabs ), _zbegin( zbegin ), _zend( zend ), _slabbegin( slabbegin ), _normals( normals ), _isolevel( isolevel )
+			{
+			}
 
-					/* set the vertex positions of the current cell */
-					gridvtx[ 0 ].set( x, y, z );
-					gridvtx[ 1 ].set( x + 1, y, z );
-					gridvtx[ 2 ].set( x + 1, y + 1, z );
-					gridvtx[ 3 ].set( x, y + 1, z );
-					gridvtx[ 4 ].set( x, y, z + 1 );
-					gridvtx[ 5 ].set( x + 1, y, z + 1 );
-					gridvtx[ 6 ].set( x + 1, y + 1, z + 1);
-					gridvtx[ 7 ].set( x, y + 1, z + 1 );
-
-
-					/* Find the vertices where the surface intersects the cube */
-					if ( _edgeTable[ cubeindex ] & 1)
-						vertexInterp( vertlist[ 0 ], gridvtx[ 0 ], gridvtx[ 1 ], gridval[ 0 ], gridval[ 1 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 2)
-						vertexInterp( vertlist[ 1 ], gridvtx[ 1 ], gridvtx[ 2 ], gridval[ 1 ], gridval[ 2 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 4)
-						vertexInterp( vertlist[ 2 ], gridvtx[ 2 ], gridvtx[ 3 ], gridval[ 2 ], gridval[ 3 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 8)
-						vertexInterp( vertlist[ 3 ], gridvtx[ 3 ], gridvtx[ 0 ], gridval[ 3 ], gridval[ 0 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 16)
-						vertexInterp( vertlist[ 4 ], gridvtx[ 4 ], gridvtx[ 5 ], gridval[ 4 ], gridval[ 5 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 32)
-						vertexInterp( vertlist[ 5 ], gridvtx[ 5 ], gridvtx[ 6 ], gridval[ 5 ], gridval[ 6 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 64)
-						vertexInterp( vertlist[ 6 ], gridvtx[ 6 ], gridvtx[ 7 ], gridval[ 6 ], gridval[ 7 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 128)
-						vertexInterp( vertlist[ 7 ], gridvtx[ 7 ], gridvtx[ 4 ], gridval[ 7 ], gridval[ 4 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 256)
-						vertexInterp( vertlist[ 8 ], gridvtx[ 0 ], gridvtx[ 4 ], gridval[ 0 ], gridval[ 4 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 512)
-						vertexInterp( vertlist[ 9 ], gridvtx[ 1 ], gridvtx[ 5 ], gridval[ 1 ], gridval[ 5 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 1024)
-						vertexInterp( vertlist[ 10 ], gridvtx[ 2 ], gridvtx[ 6 ], gridval[ 2 ], gridval[ 6 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 2048)
-						vertexInterp( vertlist[ 11 ], gridvtx[ 3 ], gridvtx[ 7 ], gridval[ 3 ], gridval[ 7 ], isolevel );
-
-					/* Create the triangle */
-					for( int i = 0; _triTable[ cubeindex ][ i ] !=-1; i += 3 ) {
-						vertices.push_back( vertlist[ _triTable[ cubeindex ][ i     ] ] );
-						faces.push_back( vtxIdx++ );
-						vertices.push_back( vertlist[ _triTable[ cubeindex ][ i + 1 ] ] );
-						faces.push_back( vtxIdx++ );
-						vertices.push_back( vertlist[ _triTable[ cubeindex ][ i + 2 ] ] );
-						faces.push_back( vtxIdx++ );
-					}
+			void operator()( const Range<size_t>& r ) const
+			{
+				for( size_t i = r.min; i < r.max; i++ ) {
+					size_t z0 = _zbegin + ( _slabbegin + i ) * _mc._slabsize;
+					size_t z1 = Math::min( z0 + _mc._slabsize, _zend );
+					_mc.extractSlab( _slabs[ i ], z0, z1, _normals, _isolevel );
 				}
 			}
+
+		private:
+			const MarchingCubes&				   _mc;
+			std::vector<MarchingCubes::SlabData>&  _slabs;
+			size_t								   _zbegin, _zend;
+			size_t								   _slabbegin;
+			bool								   _normals;
+			float								   _isolevel;
+	};
+
+	Vector3f MarchingCubes::gradient( size_t x, size_t y, size_t z ) const
+	{
+		const size_t stride = _weighted ? 2 : 1;
+		const size_t sx = stride;
+		const size_t sy = stride * _width;
+		const size_t sz = stride * _width * _height;
+		const float* v = _volume + ( ( z * _height + y ) * _width + x ) * stride;
+		return -Vector3f( v[ sx ] - v[ -sx ], v[ sy ] - v[ -sy ], v[ sz ] - v[ -sz ] );
+	}
+
+	unsigned int MarchingCubes::edgeVertex( SlabData& data, size_t x, size_t y, size_t z, int axis, bool normals, float isolevel ) const
+	{
+		const size_t stride = _weighted ? 2 : 1;
+		size_t x2 = x + ( axis == 0 );
+		size_t y2 = y + ( axis == 1 );
+		size_t z2 = z + ( axis == 2 );
+		float val1 = _volume[ ( ( z * _height + y ) * _width + x ) * stride ];
+		float val2 = _volume[ ( ( z2 * _height + y2 ) * _width + x2 ) * stride ];
+		Vector3f p1( x, y, z );
+		Vector3f p2( x2, y2, z2 );
+		Vector3f vtx;
+
+		if( normals ) {
+			Vector3f norm;
+			vertexNormalInterp( vtx, p1, p2, norm, gradient( x, y, z ), gradient( x2, y2, z2 ), val1, val2, isolevel );
+			data.normals.push_back( norm );
+		} else {
+			vertexInterp( vtx, p1, p2, val1, val2, isolevel );
 		}
-		mesh.clear();
-		mesh.setVertices( &vertices[ 0 ], vertices.size() );
-		mesh.setFaces( &faces[ 0 ], faces.size(), SCENEMESH_TRIANGLES );
+		data.vertices.push_back( vtx );
+		return ( unsigned int ) data.vertices.size() - 1;
 	}
 
-	void MarchingCubes::triangulateWithNormalsDistance( SceneMesh& mesh, float isolevel ) const
+	void MarchingCubes::extractSlab( SlabData& data, size_t zstart, size_t zend, bool normals, float isolevel ) const
 	{
+		const size_t stride = _weighted ? 2 : 1;
+		const size_t begin = normals ? 1 : 0;
+		const size_t xend = normals ? _width - 2 : _width - 1;
+		const size_t yend = normals ? _height - 2 : _height - 1;
+		const size_t plane = _width * _height;
+
+		data.vertices.clear();
+		data.normals.clear();
+		data.faces.clear();
+		data.bottom.clear();
+		data.top.clear();
+		data.lowx.assign( plane, MC_NOVERTEX );
+		data.lowy.assign( plane, MC_NOVERTEX );
+		data.upx.assign( plane, MC_NOVERTEX );
+		data.upy.assign( plane, MC_NOVERTEX );
+		data.zedge.assign( plane, MC_NOVERTEX );
+
 		float gridval[ 8 ];
-		Vector3f gridvtx[ 8 ];
-		Vector3f gridnormal[ 8 ];
-		int cubeindex;
-		Vector3f vertlist[ 12 ];
-		Vector3f normlist[ 12 ];
-		size_t vtxIdx = 0;
-		std::vector<Vector3f> vertices;
-		std::vector<Vector3f> normals;
-		std::vector<unsigned int> faces;
+		unsigned int vidx[ 12 ];
+
+		for( size_t z = zstart; z < zend; z++ ) {
+			for( size_t y = begin; y < yend; y++ ) {
+				for( size_t x = begin; x < xend; x++ ) {
+					const float* v0 = _volume + ( ( z * _height + y ) * _width + x ) * stride;
+					const float* v4 = v0 + plane * stride;
+					const size_t sy = _width * stride;
+
+					if( _weighted ) {
+						if( v0[ 1 ] <= _minweight || v0[ 3 ] <= _minweight || v0[ sy + 3 ] <= _minweight || v0[ sy + 1 ] <= _minweight ||
+							v4[ 1 ] <= _minweight || v4[ 3 ] <= _minweight || v4[ sy + 3 ] <= _minweight || v4[ sy + 1 ] <= _minweight )
+							continue;
+					}
 
-		size_t xend = _width - 2;
-		size_t yend = _height - 2;
-		size_t zend = _depth - 2;
-		for( size_t z = 1; z < zend; z++  ) {
-			for( size_t y = 1; y < yend; y++ ) {
-				for( size_t x = 1; x < xend; x++ ) {
-
-#define VOLUME( x, y, z ) _volume[ ( ( z ) * _height + ( y ) ) * _width + ( x ) ]
-					/* get the values of the current grid voxel */
-					gridval[ 0 ] = VOLUME( x, y, z );
-					gridval[ 1 ] = VOLUME( x + 1, y, z );
-					gridval[ 2 ] = VOLUME( x + 1, y + 1, z );
-					gridval[ 3 ] = VOLUME( x, y + 1, z );
-					gridval[ 4 ] = VOLUME( x, y, z + 1 );
-					gridval[ 5 ] = VOLUME( x + 1, y, z + 1 );
-					gridval[ 6 ] = VOLUME( x + 1, y + 1, z + 1);
-					gridval[ 7 ] = VOLUME( x, y + 1, z + 1 );
+					gridval[ 0 ] = v0[ 0 ];
+					gridval[ 1 ] = v0[ stride ];
+					gridval[ 2 ] = v0[ sy + stride ];
+					gridval[ 3 ] = v0[ sy ];
+					gridval[ 4 ] = v4[ 0 ];
+					gridval[ 5 ] = v4[ stride ];
+					gridval[ 6 ] = v4[ sy + stride ];
+					gridval[ 7 ] = v4[ sy ];
 
 					/*
 					   Determine the index into the edge table which
 					   tells us which vertices are inside of the surface
 					 */
-					cubeindex = 0;
+					int cubeindex = 0;
 					if( gridval[ 0 ] < isolevel ) cubeindex |= 1;
 					if( gridval[ 1 ] < isolevel ) cubeindex |= 2;
 					if( gridval[ 2 ] < isolevel ) cubeindex |= 4;
@@ -470,376 +466,150 @@ namespace cvt {
 					if( gridval[ 7 ] < isolevel ) cubeindex |= 128;
 
 					/* Cube is entirely in/out of the surface */
-					if ( _edgeTable[ cubeindex ] == 0)
+					int edges = _edgeTable[ cubeindex ];
+					if( edges == 0 )
 						continue;
 
-					/* set the vertex positions of the current cell */
-					gridvtx[ 0 ].set( x, y, z );
-					gridvtx[ 1 ].set( x + 1, y, z );
-					gridvtx[ 2 ].set( x + 1, y + 1, z );
-					gridvtx[ 3 ].set( x, y + 1, z );
-					gridvtx[ 4 ].set( x, y, z + 1 );
-					gridvtx[ 5 ].set( x + 1, y, z + 1 );
-					gridvtx[ 6 ].set( x + 1, y + 1, z + 1);
-					gridvtx[ 7 ].set( x, y + 1, z + 1 );
-
-#define VOLNORMAL( x, y, z )   -Vector3f( VOLUME( ( x ) + 1, ( y ), ( z ) ) - VOLUME( ( x ) - 1, ( y ), ( z ) ), \
-										 VOLUME( ( x ), ( y ) + 1, ( z ) ) - VOLUME( ( x ) , ( y ) - 1, ( z ) ), \
-										 VOLUME( ( x ), ( y ), ( z ) + 1 ) - VOLUME( ( x ) , ( y ), ( z ) - 1 ) )
-
-					gridnormal[ 0 ] = VOLNORMAL( x, y, z );
-					gridnormal[ 1 ] = VOLNORMAL( x + 1, y, z );
-					gridnormal[ 2 ] = VOLNORMAL( x + 1, y + 1, z );
-					gridnormal[ 3 ] = VOLNORMAL( x, y + 1, z );
-					gridnormal[ 4 ] = VOLNORMAL( x, y, z + 1 );
-					gridnormal[ 5 ] = VOLNORMAL( x + 1, y, z + 1 );
-					gridnormal[ 6 ] = VOLNORMAL( x + 1, y + 1, z + 1);
-					gridnormal[ 7 ] = VOLNORMAL( x, y + 1, z + 1 );
-
-#undef VOLNORMAL
-#undef VOLUME
-					/* Find the vertices where the surface intersects the cube */
-					if ( _edgeTable[ cubeindex ] & 1)
-						vertexNormalInterp( vertlist[ 0 ], gridvtx[ 0 ], gridvtx[ 1 ],
-										    normlist[ 0 ], gridnormal[ 0 ], gridnormal[ 1 ],
-										    gridval[ 0 ], gridval[ 1 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 2)
-						vertexNormalInterp( vertlist[ 1 ], gridvtx[ 1 ], gridvtx[ 2 ],
-										    normlist[ 1 ], gridnormal[ 1 ], gridnormal[ 2 ],
-										    gridval[ 1 ], gridval[ 2 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 4)
-						vertexNormalInterp( vertlist[ 2 ], gridvtx[ 2 ], gridvtx[ 3 ],
-										    normlist[ 2 ], gridnormal[ 2 ], gridnormal[ 3 ],
-										    gridval[ 2 ], gridval[ 3 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 8)
-						vertexNormalInterp( vertlist[ 3 ], gridvtx[ 3 ], gridvtx[ 0 ],
-										    normlist[ 3 ], gridnormal[ 3 ], gridnormal[ 0 ],
-										    gridval[ 3 ], gridval[ 0 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 16)
-						vertexNormalInterp( vertlist[ 4 ], gridvtx[ 4 ], gridvtx[ 5 ],
-										    normlist[ 4 ], gridnormal[ 4 ], gridnormal[ 5 ],
-										    gridval[ 4 ], gridval[ 5 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 32)
-						vertexNormalInterp( vertlist[ 5 ], gridvtx[ 5 ], gridvtx[ 6 ],
-										    normlist[ 5 ], gridnormal[ 5 ], gridnormal[ 6 ],
-										    gridval[ 5 ], gridval[ 6 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 64)
-						vertexNormalInterp( vertlist[ 6 ], gridvtx[ 6 ], gridvtx[ 7 ],
-										    normlist[ 6 ], gridnormal[ 6 ], gridnormal[ 7 ],
-										    gridval[ 6 ], gridval[ 7 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 128)
-						vertexNormalInterp( vertlist[ 7 ], gridvtx[ 7 ], gridvtx[ 4 ],
-										    normlist[ 7 ], gridnormal[ 7 ], gridnormal[ 4 ],
-										    gridval[ 7 ], gridval[ 4 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 256)
-						vertexNormalInterp( vertlist[ 8 ], gridvtx[ 0 ], gridvtx[ 4 ],
-										    normlist[ 8 ], gridnormal[ 0 ], gridnormal[ 4 ],
-										    gridval[ 0 ], gridval[ 4 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 512)
-						vertexNormalInterp( vertlist[ 9 ], gridvtx[ 1 ], gridvtx[ 5 ],
-										    normlist[ 9 ], gridnormal[ 1 ], gridnormal[ 5 ],
-										    gridval[ 1 ], gridval[ 5 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 1024)
-						vertexNormalInterp( vertlist[ 10 ], gridvtx[ 2 ], gridvtx[ 6 ],
-										    normlist[ 10 ], gridnormal[ 2 ], gridnormal[ 6 ],
-										    gridval[ 2 ], gridval[ 6 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 2048)
-						vertexNormalInterp( vertlist[ 11 ], gridvtx[ 3 ], gridvtx[ 7 ],
-										    normlist[ 11 ], gridnormal[ 3 ], gridnormal[ 7 ],
-										    gridval[ 3 ], gridval[ 7 ], isolevel );
-
-					/* Create the triangle */
-					for( int i = 0; _triTable[ cubeindex ][ i ] !=-1; i += 3 ) {
-						vertices.push_back( vertlist[ _triTable[ cubeindex ][ i     ] ] );
-						normals.push_back( normlist[ _triTable[ cubeindex ][ i     ] ] );
-						faces.push_back( vtxIdx++ );
-						vertices.push_back( vertlist[ _triTable[ cubeindex ][ i + 1 ] ] );
-						normals.push_back( normlist[ _triTable[ cubeindex ][ i + 1 ] ] );
-						faces.push_back( vtxIdx++ );
-						vertices.push_back( vertlist[ _triTable[ cubeindex ][ i + 2 ] ] );
-						normals.push_back( normlist[ _triTable[ cubeindex ][ i + 2 ] ] );
-						faces.push_back( vtxIdx++ );
+					/* Find the vertices where the surface intersects the cube, reusing the ones of the neighbours */
+					for( int e = 0; e < 12; e++ ) {
+						if( !( edges & ( 1 << e ) ) )
+							continue;
+						size_t ex = x + _edgeOffset[ e ][ 0 ];
+						size_t ey = y + _edgeOffset[ e ][ 1 ];
+						size_t idx = ey * _width + ex;
+						unsigned int* slot;
+						switch( _edgeAxis[ e ] ) {
+							case 0: slot = _edgeOffset[ e ][ 2 ] ? &data.upx[ idx ] : &data.lowx[ idx ]; break;
+							case 1: slot = _edgeOffset[ e ][ 2 ] ? &data.upy[ idx ] : &data.lowy[ idx ]; break;
+							default: slot = &data.zedge[ idx ]; break;
+						}
+						if( *slot == MC_NOVERTEX )
+							*slot = edgeVertex( data, ex, ey, z + _edgeOffset[ e ][ 2 ], _edgeAxis[ e ], normals, isolevel );
+						vidx[ e ] = *slot;
 					}
+
+					/* Create the triangles */
+					for( int i = 0; _triTable[ cubeindex ][ i ] != -1; i++ )
+						data.faces.push_back( vidx[ _triTable[ cubeindex ][ i ] ] );
 				}
 			}
-		}
-		mesh.clear();
-		mesh.setVertices( &vertices[ 0 ], vertices.size() );
-		mesh.setNormals( &normals[ 0 ], normals.size() );
-		mesh.setFaces( &faces[ 0 ], faces.size(), SCENEMESH_TRIANGLES );
-	}
-
-	void MarchingCubes::triangulateWeightedDistance( SceneMesh& mesh, float isolevel ) const
-	{
-		const float WEIGHT_EPSILON = _minweight;
-		float gridval[ 8 ];
-		Vector3f gridvtx[ 8 ];
-		int cubeindex;
-		Vector3f vertlist[ 12 ];
-		size_t vtxIdx = 0;
-		std::vector<Vector3f> vertices;
-		std::vector<unsigned int> faces;
-
-		size_t xend = _width - 1;
-		size_t yend = _height - 1;
-		size_t zend = _depth - 1;
-
-		for( size_t z = 0; z < zend; z++  ) {
-			for( size_t y = 0; y < yend; y++ ) {
-				for( size_t x = 0; x < xend; x++ ) {
-
-#define VOLUME( x, y, z ) _volume[ ( ( ( z ) * _height + ( y ) ) * _width + ( x ) ) * 2 ]
-#define VOLUMEWEIGHT( x, y, z ) _volume[ ( ( ( z ) * _height + ( y ) ) * _width + ( x ) ) * 2 + 1 ]
-
-					/* get the values of the current grid voxel */
-					gridval[ 0 ] = VOLUME( x, y, z );
-					if( VOLUMEWEIGHT( x, y, z ) <= WEIGHT_EPSILON ) continue;
-					gridval[ 1 ] = VOLUME( x + 1, y, z );
-					if( VOLUMEWEIGHT( x + 1, y, z ) <= WEIGHT_EPSILON ) continue;
-					gridval[ 2 ] = VOLUME( x + 1, y + 1, z );
-					if( VOLUMEWEIGHT( x + 1, y + 1, z ) <= WEIGHT_EPSILON ) continue;
-					gridval[ 3 ] = VOLUME( x, y + 1, z );
-					if( VOLUMEWEIGHT( x, y + 1, z ) <= WEIGHT_EPSILON ) continue;
-					gridval[ 4 ] = VOLUME( x, y, z + 1 );
-					if( VOLUMEWEIGHT( x, y, z + 1 ) <= WEIGHT_EPSILON ) continue;
-					gridval[ 5 ] = VOLUME( x + 1, y, z + 1 );
-					if( VOLUMEWEIGHT( x + 1, y, z + 1 ) <= WEIGHT_EPSILON ) continue;
-					gridval[ 6 ] = VOLUME( x + 1, y + 1, z + 1);
-					if( VOLUMEWEIGHT( x + 1, y + 1, z + 1 ) <= WEIGHT_EPSILON ) continue;
-					gridval[ 7 ] = VOLUME( x, y + 1, z + 1 );
-					if( VOLUMEWEIGHT( x, y + 1, z + 1 ) <= WEIGHT_EPSILON ) continue;
-#undef VOLUME
-
-					/*
-					   Determine the index into the edge table which
-					   tells us which vertices are inside of the surface
-					 */
-					cubeindex = 0;
-					if( gridval[ 0 ] < isolevel ) cubeindex |= 1;
-					if( gridval[ 1 ] < isolevel ) cubeindex |= 2;
-					if( gridval[ 2 ] < isolevel ) cubeindex |= 4;
-					if( gridval[ 3 ] < isolevel ) cubeindex |= 8;
-					if( gridval[ 4 ] < isolevel ) cubeindex |= 16;
-					if( gridval[ 5 ] < isolevel ) cubeindex |= 32;
-					if( gridval[ 6 ] < isolevel ) cubeindex |= 64;
-					if( gridval[ 7 ] < isolevel ) cubeindex |= 128;
 
-					/* Cube is entirely in/out of the surface */
-					if ( _edgeTable[ cubeindex ] == 0)
-						continue;
+			if( z == zstart ) {
+				for( size_t i = 0; i < plane; i++ ) {
+					if( data.lowx[ i ] != MC_NOVERTEX )
+						data.bottom.push_back( std::make_pair( ( unsigned int ) ( 2 * i ), data.lowx[ i ] ) );
+					if( data.lowy[ i ] != MC_NOVERTEX )
+						data.bottom.push_back( std::make_pair( ( unsigned int ) ( 2 * i + 1 ), data.lowy[ i ] ) );
+				}
+			}
 
-					/* set the vertex positions of the current cell */
-					gridvtx[ 0 ].set( x, y, z );
-					gridvtx[ 1 ].set( x + 1, y, z );
-					gridvtx[ 2 ].set( x + 1, y + 1, z );
-					gridvtx[ 3 ].set( x, y + 1, z );
-					gridvtx[ 4 ].set( x, y, z + 1 );
-					gridvtx[ 5 ].set( x + 1, y, z + 1 );
-					gridvtx[ 6 ].set( x + 1, y + 1, z + 1);
-					gridvtx[ 7 ].set( x, y + 1, z + 1 );
-
-
-					/* Find the vertices where the surface intersects the cube */
-					if ( _edgeTable[ cubeindex ] & 1)
-						vertexInterp( vertlist[ 0 ], gridvtx[ 0 ], gridvtx[ 1 ], gridval[ 0 ], gridval[ 1 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 2)
-						vertexInterp( vertlist[ 1 ], gridvtx[ 1 ], gridvtx[ 2 ], gridval[ 1 ], gridval[ 2 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 4)
-						vertexInterp( vertlist[ 2 ], gridvtx[ 2 ], gridvtx[ 3 ], gridval[ 2 ], gridval[ 3 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 8)
-						vertexInterp( vertlist[ 3 ], gridvtx[ 3 ], gridvtx[ 0 ], gridval[ 3 ], gridval[ 0 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 16)
-						vertexInterp( vertlist[ 4 ], gridvtx[ 4 ], gridvtx[ 5 ], gridval[ 4 ], gridval[ 5 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 32)
-						vertexInterp( vertlist[ 5 ], gridvtx[ 5 ], gridvtx[ 6 ], gridval[ 5 ], gridval[ 6 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 64)
-						vertexInterp( vertlist[ 6 ], gridvtx[ 6 ], gridvtx[ 7 ], gridval[ 6 ], gridval[ 7 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 128)
-						vertexInterp( vertlist[ 7 ], gridvtx[ 7 ], gridvtx[ 4 ], gridval[ 7 ], gridval[ 4 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 256)
-						vertexInterp( vertlist[ 8 ], gridvtx[ 0 ], gridvtx[ 4 ], gridval[ 0 ], gridval[ 4 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 512)
-						vertexInterp( vertlist[ 9 ], gridvtx[ 1 ], gridvtx[ 5 ], gridval[ 1 ], gridval[ 5 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 1024)
-						vertexInterp( vertlist[ 10 ], gridvtx[ 2 ], gridvtx[ 6 ], gridval[ 2 ], gridval[ 6 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 2048)
-						vertexInterp( vertlist[ 11 ], gridvtx[ 3 ], gridvtx[ 7 ], gridval[ 3 ], gridval[ 7 ], isolevel );
-
-					/* Create the triangle */
-					for( int i = 0; _triTable[ cubeindex ][ i ] !=-1; i += 3 ) {
-						vertices.push_back( vertlist[ _triTable[ cubeindex ][ i     ] ] );
-						faces.push_back( vtxIdx++ );
-						vertices.push_back( vertlist[ _triTable[ cubeindex ][ i + 1 ] ] );
-						faces.push_back( vtxIdx++ );
-						vertices.push_back( vertlist[ _triTable[ cubeindex ][ i + 2 ] ] );
-						faces.push_back( vtxIdx++ );
-					}
+			if( z + 1 == zend ) {
+				for( size_t i = 0; i < plane; i++ ) {
+					if( data.upx[ i ] != MC_NOVERTEX )
+						data.top.push_back( std::make_pair( ( unsigned int ) ( 2 * i ), data.upx[ i ] ) );
+					if( data.upy[ i ] != MC_NOVERTEX )
+						data.top.push_back( std::make_pair( ( unsigned int ) ( 2 * i + 1 ), data.upy[ i ] ) );
 				}
+			} else {
+				data.lowx.swap( data.upx );
+				data.lowy.swap( data.upy );
+				std::fill( data.upx.begin(), data.upx.end(), MC_NOVERTEX );
+				std::fill( data.upy.begin(), data.upy.end(), MC_NOVERTEX );
+				std::fill( data.zedge.begin(), data.zedge.end(), MC_NOVERTEX );
 			}
 		}
-		mesh.clear();
-		mesh.setVertices( &vertices[ 0 ], vertices.size() );
-		mesh.setFaces( &faces[ 0 ], faces.size(), SCENEMESH_TRIANGLES );
+
+		/* release the caches, the slab data lives until it is merged */
+		std::vector<unsigned int>().swap( data.lowx );
+		std::vector<unsigned int>().swap( data.lowy );
+		std::vector<unsigned int>().swap( data.upx );
+		std::vector<unsigned int>().swap( data.upy );
+		std::vector<unsigned int>().swap( data.zedge );
 	}
 
-	void MarchingCubes::triangulateWithNormalsWeightedDistance( SceneMesh& mesh, float isolevel ) const
+	void MarchingCubes::triangulateSlabs( SceneMesh* mesh, const Delegate<void ( const MarchingCubesSlab& )>* slabfunc, bool normals, float isolevel ) const
 	{
-		const float WEIGHT_EPSILON = _minweight;
-		float gridval[ 8 ];
-		Vector3f gridvtx[ 8 ];
-		Vector3f gridnormal[ 8 ];
-		int cubeindex;
-		Vector3f vertlist[ 12 ];
-		Vector3f normlist[ 12 ];
-		size_t vtxIdx = 0;
+		/* number of slabs extracted in parallel before they are merged */
+		const size_t BATCH = 16;
+
 		std::vector<Vector3f> vertices;
-		std::vector<Vector3f> normals;
+		std::vector<Vector3f> vnormals;
 		std::vector<unsigned int> faces;
 
-		size_t xend = _width - 2;
-		size_t yend = _height - 2;
-		size_t zend = _depth - 2;
-		for( size_t z = 1; z < zend; z++  ) {
-			for( size_t y = 1; y < yend; y++ ) {
-				for( size_t x = 1; x < xend; x++ ) {
-
-#define VOLUME( x, y, z ) _volume[ ( ( ( z ) * _height + ( y ) ) * _width + ( x ) ) * 2 ]
-#define VOLUMEWEIGHT( x, y, z ) _volume[ ( ( ( z ) * _height + ( y ) ) * _width + ( x ) ) * 2 + 1 ]
-
-					/* get the values of the current grid voxel */
-					gridval[ 0 ] = VOLUME( x, y, z );
-					if( VOLUMEWEIGHT( x, y, z ) <= WEIGHT_EPSILON ) continue;
-					gridval[ 1 ] = VOLUME( x + 1, y, z );
-					if( VOLUMEWEIGHT( x + 1, y, z ) <= WEIGHT_EPSILON ) continue;
-					gridval[ 2 ] = VOLUME( x + 1, y + 1, z );
-					if( VOLUMEWEIGHT( x + 1, y + 1, z ) <= WEIGHT_EPSILON ) continue;
-					gridval[ 3 ] = VOLUME( x, y + 1, z );
-					if( VOLUMEWEIGHT( x, y + 1, z ) <= WEIGHT_EPSILON ) continue;
-					gridval[ 4 ] = VOLUME( x, y, z + 1 );
-					if( VOLUMEWEIGHT( x, y, z + 1 ) <= WEIGHT_EPSILON ) continue;
-					gridval[ 5 ] = VOLUME( x + 1, y, z + 1 );
-					if( VOLUMEWEIGHT( x + 1, y, z + 1 ) <= WEIGHT_EPSILON ) continue;
-					gridval[ 6 ] = VOLUME( x + 1, y + 1, z + 1);
-					if( VOLUMEWEIGHT( x + 1, y + 1, z + 1 ) <= WEIGHT_EPSILON ) continue;
-					gridval[ 7 ] = VOLUME( x, y + 1, z + 1 );
-					if( VOLUMEWEIGHT( x, y + 1, z + 1 ) <= WEIGHT_EPSILON ) continue;
+		const size_t border = normals ? 2 : 1;
+		size_t zbegin = normals ? 1 : 0;
+		size_t zend = _depth > border ? _depth - border : 0;
+		if( _width <= border + 1 || _height <= border + 1 )
+			zend = zbegin;
+
+		size_t nslabs = zend > zbegin ? ( zend - zbegin + _slabsize - 1 ) / _slabsize : 0;
+		size_t nvertices = 0;
+
+		/* global index of the vertices on the top plane of the previous slab, indexed by edge key */
+		std::vector<unsigned int> prevtop( 2 * _width * _height, MC_NOVERTEX );
+		std::vector<std::pair<unsigned int, unsigned int> > prevtoplist;
+		std::vector<unsigned int> remap;
+		std::vector<SlabData> slabs;
+		MarchingCubesSlab out;
+
+		for( size_t sbegin = 0; sbegin < nslabs; sbegin += BATCH ) {
+			size_t n = Math::min( BATCH, nslabs - sbegin );
+			slabs.resize( n );
+			MarchingCubesSlabBody body( *this, slabs, zbegin, zend, sbegin, normals, isolevel );
+			parallelFor( Range<size_t>( 0, n ), body, 1 );
+
+			for( size_t s = 0; s < n; s++ ) {
+				SlabData& slab = slabs[ s ];
+
+				/* vertices on the bottom plane were already emitted by the previous slab */
+				remap.assign( slab.vertices.size(), MC_NOVERTEX );
+				for( size_t i = 0; i < slab.bottom.size(); i++ )
+					remap[ slab.bottom[ i ].second ] = prevtop[ slab.bottom[ i ].first ];
+				for( size_t i = 0; i < prevtoplist.size(); i++ )
+					prevtop[ prevtoplist[ i ].first ] = MC_NOVERTEX;
+
+				out.zstart = zbegin + ( sbegin + s ) * _slabsize;
+				out.zend = Math::min( out.zstart + _slabsize, zend );
+				out.vertexOffset = nvertices;
+				out.vertices.clear();
+				out.normals.clear();
+				out.faces.clear();
+
+				std::vector<Vector3f>& dstvertices = slabfunc ? out.vertices : vertices;
+				std::vector<Vector3f>& dstnormals = slabfunc ? out.normals : vnormals;
+				std::vector<unsigned int>& dstfaces = slabfunc ? out.faces : faces;
+
+				for( size_t i = 0; i < slab.vertices.size(); i++ ) {
+					if( remap[ i ] != MC_NOVERTEX )
+						continue;
+					remap[ i ] = ( unsigned int ) nvertices++;
+					dstvertices.push_back( slab.vertices[ i ] );
+					if( normals )
+						dstnormals.push_back( slab.normals[ i ] );
+				}
+				for( size_t i = 0; i < slab.faces.size(); i++ )
+					dstfaces.push_back( remap[ slab.faces[ i ] ] );
 
-					/*
-					   Determine the index into the edge table which
-					   tells us which vertices are inside of the surface
-					 */
-					cubeindex = 0;
-					if( gridval[ 0 ] < isolevel ) cubeindex |= 1;
-					if( gridval[ 1 ] < isolevel ) cubeindex |= 2;
-					if( gridval[ 2 ] < isolevel ) cubeindex |= 4;
-					if( gridval[ 3 ] < isolevel ) cubeindex |= 8;
-					if( gridval[ 4 ] < isolevel ) cubeindex |= 16;
-					if( gridval[ 5 ] < isolevel ) cubeindex |= 32;
-					if( gridval[ 6 ] < isolevel ) cubeindex |= 64;
-					if( gridval[ 7 ] < isolevel ) cubeindex |= 128;
+				for( size_t i = 0; i < slab.top.size(); i++ )
+					prevtop[ slab.top[ i ].first ] = remap[ slab.top[ i ].second ];
+				prevtoplist.swap( slab.top );
 
-					/* Cube is entirely in/out of the surface */
-					if ( _edgeTable[ cubeindex ] == 0)
-						continue;
+				if( slabfunc )
+					( *slabfunc )( out );
 
-					/* set the vertex positions of the current cell */
-					gridvtx[ 0 ].set( x, y, z );
-					gridvtx[ 1 ].set( x + 1, y, z );
-					gridvtx[ 2 ].set( x + 1, y + 1, z );
-					gridvtx[ 3 ].set( x, y + 1, z );
-					gridvtx[ 4 ].set( x, y, z + 1 );
-					gridvtx[ 5 ].set( x + 1, y, z + 1 );
-					gridvtx[ 6 ].set( x + 1, y + 1, z + 1);
-					gridvtx[ 7 ].set( x, y + 1, z + 1 );
-
-#define VOLNORMAL( x, y, z )   -Vector3f( VOLUME( ( x ) + 1, ( y ), ( z ) ) - VOLUME( ( x ) - 1, ( y ), ( z ) ), \
-										 VOLUME( ( x ), ( y ) + 1, ( z ) ) - VOLUME( ( x ) , ( y ) - 1, ( z ) ), \
-										 VOLUME( ( x ), ( y ), ( z ) + 1 ) - VOLUME( ( x ) , ( y ), ( z ) - 1 ) )
-
-					gridnormal[ 0 ] = VOLNORMAL( x, y, z );
-					gridnormal[ 1 ] = VOLNORMAL( x + 1, y, z );
-					gridnormal[ 2 ] = VOLNORMAL( x + 1, y + 1, z );
-					gridnormal[ 3 ] = VOLNORMAL( x, y + 1, z );
-					gridnormal[ 4 ] = VOLNORMAL( x, y, z + 1 );
-					gridnormal[ 5 ] = VOLNORMAL( x + 1, y, z + 1 );
-					gridnormal[ 6 ] = VOLNORMAL( x + 1, y + 1, z + 1);
-					gridnormal[ 7 ] = VOLNORMAL( x, y + 1, z + 1 );
-
-#undef VOLNORMAL
-#undef VOLUME
-#undef VOLUMEWEIGHT
-
-					/* Find the vertices where the surface intersects the cube */
-					if ( _edgeTable[ cubeindex ] & 1)
-						vertexNormalInterp( vertlist[ 0 ], gridvtx[ 0 ], gridvtx[ 1 ],
-										    normlist[ 0 ], gridnormal[ 0 ], gridnormal[ 1 ],
-										    gridval[ 0 ], gridval[ 1 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 2)
-						vertexNormalInterp( vertlist[ 1 ], gridvtx[ 1 ], gridvtx[ 2 ],
-										    normlist[ 1 ], gridnormal[ 1 ], gridnormal[ 2 ],
-										    gridval[ 1 ], gridval[ 2 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 4)
-						vertexNormalInterp( vertlist[ 2 ], gridvtx[ 2 ], gridvtx[ 3 ],
-										    normlist[ 2 ], gridnormal[ 2 ], gridnormal[ 3 ],
-										    gridval[ 2 ], gridval[ 3 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 8)
-						vertexNormalInterp( vertlist[ 3 ], gridvtx[ 3 ], gridvtx[ 0 ],
-										    normlist[ 3 ], gridnormal[ 3 ], gridnormal[ 0 ],
-										    gridval[ 3 ], gridval[ 0 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 16)
-						vertexNormalInterp( vertlist[ 4 ], gridvtx[ 4 ], gridvtx[ 5 ],
-										    normlist[ 4 ], gridnormal[ 4 ], gridnormal[ 5 ],
-										    gridval[ 4 ], gridval[ 5 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 32)
-						vertexNormalInterp( vertlist[ 5 ], gridvtx[ 5 ], gridvtx[ 6 ],
-										    normlist[ 5 ], gridnormal[ 5 ], gridnormal[ 6 ],
-										    gridval[ 5 ], gridval[ 6 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 64)
-						vertexNormalInterp( vertlist[ 6 ], gridvtx[ 6 ], gridvtx[ 7 ],
-										    normlist[ 6 ], gridnormal[ 6 ], gridnormal[ 7 ],
-										    gridval[ 6 ], gridval[ 7 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 128)
-						vertexNormalInterp( vertlist[ 7 ], gridvtx[ 7 ], gridvtx[ 4 ],
-										    normlist[ 7 ], gridnormal[ 7 ], gridnormal[ 4 ],
-										    gridval[ 7 ], gridval[ 4 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 256)
-						vertexNormalInterp( vertlist[ 8 ], gridvtx[ 0 ], gridvtx[ 4 ],
-										    normlist[ 8 ], gridnormal[ 0 ], gridnormal[ 4 ],
-										    gridval[ 0 ], gridval[ 4 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 512)
-						vertexNormalInterp( vertlist[ 9 ], gridvtx[ 1 ], gridvtx[ 5 ],
-										    normlist[ 9 ], gridnormal[ 1 ], gridnormal[ 5 ],
-										    gridval[ 1 ], gridval[ 5 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 1024)
-						vertexNormalInterp( vertlist[ 10 ], gridvtx[ 2 ], gridvtx[ 6 ],
-										    normlist[ 10 ], gridnormal[ 2 ], gridnormal[ 6 ],
-										    gridval[ 2 ], gridval[ 6 ], isolevel );
-					if ( _edgeTable[ cubeindex ] & 2048)
-						vertexNormalInterp( vertlist[ 11 ], gridvtx[ 3 ], gridvtx[ 7 ],
-										    normlist[ 11 ], gridnormal[ 3 ], gridnormal[ 7 ],
-										    gridval[ 3 ], gridval[ 7 ], isolevel );
-
-					/* Create the triangle */
-					for( int i = 0; _triTable[ cubeindex ][ i ] !=-1; i += 3 ) {
-						vertices.push_back( vertlist[ _triTable[ cubeindex ][ i     ] ] );
-						normals.push_back( normlist[ _triTable[ cubeindex ][ i     ] ] );
-						faces.push_back( vtxIdx++ );
-						vertices.push_back( vertlist[ _triTable[ cubeindex ][ i + 1 ] ] );
-						normals.push_back( normlist[ _triTable[ cubeindex ][ i + 1 ] ] );
-						faces.push_back( vtxIdx++ );
-						vertices.push_back( vertlist[ _triTable[ cubeindex ][ i + 2 ] ] );
-						normals.push_back( normlist[ _triTable[ cubeindex ][ i + 2 ] ] );
-						faces.push_back( vtxIdx++ );
-					}
-				}
+				SlabData empty;
+				std::swap( slab, empty );
+			}
+		}
+
+		if( mesh ) {
+			mesh->clear();
+			if( !vertices.empty() ) {
+				mesh->setVertices( &vertices[ 0 ], vertices.size() );
+				if( normals )
+					mesh->setNormals( &vnormals[ 0 ], vnormals.size() );
+				mesh->setFaces( &faces[ 0 ], faces.size(), SCENEMESH_TRIANGLES );
 			}
 		}
-		mesh.clear();
-		mesh.setVertices( &vertices[ 0 ], vertices.size() );
-		mesh.setNormals( &normals[ 0 ], normals.size() );
-		mesh.setFaces( &faces[ 0 ], faces.size(), SCENEMESH_TRIANGLES );
 	}
 }
-
-
-
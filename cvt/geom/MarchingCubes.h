@@ -27,10 +27,35 @@
 
 #include <cvt/geom/scene/SceneMesh.h>
 #include <cvt/math/Vector.h>
+#include <cvt/util/Delegate.h>
+
+#include <vector>
 
 namespace cvt {
 
+	/**
+	  Part of a mesh extracted by MarchingCubes for the cell layers [ zstart, zend ).
+	  Faces use global vertex indices and only refer to vertices of this or of previous slabs.
+	 */
+	struct MarchingCubesSlab {
+		size_t					  zstart;
+		size_t					  zend;
+		size_t					  vertexOffset;
+		std::vector<Vector3f>	  vertices;
+		std::vector<Vector3f>	  normals;
+		std::vector<unsigned int> faces;
+	};
+
+	class MarchingCubesSlabBody;
+
+	/**
+	  Extracts a welded, indexed triangle mesh. The volume is split into slabs of cell layers which
+	  are triangulated in parallel, vertices are shared via per slab edge caches and merged across
+	  slab borders.
+	 */
 	class MarchingCubes {
+		friend class MarchingCubesSlabBody;
+
 		public:
 				  MarchingCubes( const float* volume, size_t width, size_t height, size_t depth, bool weighted = false, float minweight = 20.0f );
 				  ~MarchingCubes();
@@ -38,15 +63,22 @@ namespace cvt {
 			void  triangulate( SceneMesh& mesh, float isolevel = 0.0f ) const;
 			void  triangulateWithNormals( SceneMesh& mesh, float isolevel = 0.0f ) const;
 
+			/* stream the mesh slab by slab in z order instead of collecting it */
+			void  triangulate( const Delegate<void ( const MarchingCubesSlab& )>& slabfunc, bool normals, float isolevel = 0.0f ) const;
+
 			void  setMinimumWeight( float weight );
 			float minimumWeight() const;
 
+			void   setSlabSize( size_t layers );
+			size_t slabSize() const;
+
 		private:
-			void triangulateDistance( SceneMesh& mesh, float isolevel ) const;
-			void triangulateWithNormalsDistance( SceneMesh& mesh, float isolevel ) const;
+			struct SlabData;
 
-			void triangulateWeightedDistance( SceneMesh& mesh, float isolevel ) const;
-			void triangulateWithNormalsWeightedDistance( SceneMesh& mesh, float isolevel ) const;
+			void triangulateSlabs( SceneMesh* mesh, const Delegate<void ( const MarchingCubesSlab& )>* slabfunc, bool normals, float isolevel ) const;
+			void extractSlab( SlabData& data, size_t zstart, size_t zend, bool normals, float isolevel ) const;
+			unsigned int edgeVertex( SlabData& data, size_t x, size_t y, size_t z, int axis, bool normals, float isolevel ) const;
+			Vector3f gradient( size_t x, size_t y, size_t z ) const;
 
 			void vertexInterp( Vector3f& vtx, const Vector3f& p1, const Vector3f& p2, float val1, float val2, float isolevel ) const;
 			void vertexNormalInterp( Vector3f& vtx, const Vector3f& p1, const Vector3f& p2, Vector3f& norm, const Vector3f& n1, const Vector3f& n2, float val1, float val2, float isolevel ) const;
@@ -57,6 +89,7 @@ namespace cvt {
 			size_t		 _depth;
 			bool		 _weighted;
 			float		 _minweight;
+			size_t		 _slabsize;
 	};
 
 	inline MarchingCubes::MarchingCubes( const float* volume, size_t width, size_t height, size_t depth, bool weighted, float minweight) :
@@ -65,7 +98,8 @@ namespace cvt {
 		_height( height ),
 		_depth( depth ),
 		_weighted( weighted ),
-		_minweight( minweight )
+		_minweight( minweight ),
+		_slabsize( 16 )
 	{
 	}
 
@@ -75,20 +109,28 @@ namespace cvt {
 
 	inline void MarchingCubes::triangulate( SceneMesh& mesh, float isolevel ) const
 	{
-		if( _weighted )
-			triangulateWeightedDistance( mesh, isolevel );
-		else
-			triangulateDistance( mesh, isolevel );
+		triangulateSlabs( &mesh, NULL, false, isolevel );
 	}
 
 	inline void MarchingCubes::triangulateWithNormals( SceneMesh& mesh, float isolevel ) const
 	{
-		if( _weighted )
-			triangulateWithNormalsWeightedDistance( mesh, isolevel );
-		else
-			triangulateWithNormalsWeightedDistance( mesh, isolevel );
+		triangulateSlabs( &mesh, NULL, true, isolevel );
 	}
 
+	inline void MarchingCubes::triangulate( const Delegate<void ( const MarchingCubesSlab& )>& slabfunc, bool normals, float isolevel ) const
+	{
+		triangulateSlabs( NULL, &slabfunc, normals, isolevel );
+	}
+
+	inline void MarchingCubes::setSlabSize( size_t layers )
+	{
+		_slabsize = Math::max<size_t>( layers, 1 );
+	}
+
+	inline size_t MarchingCubes::slabSize() const
+	{
+		return _slabsize;
+	}
 
 	inline void MarchingCubes::setMinimumWeight( float weight )
 	{
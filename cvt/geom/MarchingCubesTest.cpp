@@ -0,0 +1,161 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/geom/MarchingCubes.h>
+#include <cvt/util/CVTTest.h>
+
+#include <map>
+
+using namespace cvt;
+
+static void _mcSphere( std::vector<float>& vol, size_t n, float radius, bool weighted )
+{
+	size_t stride = weighted ? 2 : 1;
+	float c = ( float ) ( n - 1 ) * 0.5f;
+	vol.resize( n * n * n * stride );
+	float* ptr = &vol[ 0 ];
+	for( size_t z = 0; z < n; z++ ) {
+		for( size_t y = 0; y < n; y++ ) {
+			for( size_t x = 0; x < n; x++ ) {
+				*ptr++ = Vector3f( x - c, y - c, z - c ).length() - radius;
+				if( weighted )
+					*ptr++ = 30.0f;
+			}
+		}
+	}
+}
+
+/* a welded sphere is a closed 2-manifold: every edge has two faces and V - E + F = 2 */
+static bool _mcClosed( const SceneMesh& mesh )
+{
+	std::map<std::pair<unsigned int, unsigned int>, int> edges;
+	const unsigned int* f = mesh.faces();
+	for( size_t i = 0; i < mesh.faceSize(); i++, f += 3 ) {
+		for( int k = 0; k < 3; k++ ) {
+			unsigned int a = f[ k ], b = f[ ( k + 1 ) % 3 ];
+			if( a == b || a >= mesh.vertexSize() || b >= mesh.vertexSize() )
+				return false;
+			edges[ std::make_pair( Math::min( a, b ), Math::max( a, b ) ) ]++;
+		}
+	}
+
+	for( std::map<std::pair<unsigned int, unsigned int>, int>::const_iterator it = edges.begin(); it != edges.end(); ++it ) {
+		if( it->second != 2 )
+			return false;
+	}
+	return ( long ) mesh.vertexSize() - ( long ) edges.size() + ( long ) mesh.faceSize() == 2;
+}
+
+static bool _mcOnSphere( const SceneMesh& mesh, size_t n, float radius )
+{
+	float c = ( float ) ( n - 1 ) * 0.5f;
+	for( size_t i = 0; i < mesh.vertexSize(); i++ ) {
+		if( Math::abs( ( mesh.vertex( i ) - Vector3f( c, c, c ) ).length() - radius ) > 0.1f )
+			return false;
+	}
+	return true;
+}
+
+class MCSlabCollector {
+	public:
+		MCSlabCollector( size_t zstart ) : vertices( 0 ), faces( 0 ), ok( true ), zend( zstart ) {}
+
+		void slab( const MarchingCubesSlab& s )
+		{
+			ok &= s.vertexOffset == vertices && s.zstart == zend;
+			for( size_t i = 0; i < s.faces.size(); i++ )
+				ok &= s.faces[ i ] < vertices + s.vertices.size();
+			ok &= s.normals.size() == s.vertices.size();
+			vertices += s.vertices.size();
+			faces += s.faces.size() / 3;
+			zend = s.zend;
+		}
+
+		size_t vertices;
+		size_t faces;
+		bool   ok;
+		size_t zend;
+};
+
+BEGIN_CVTTEST( MarchingCubes )
+	bool ret = true;
+	bool b;
+	const size_t n = 40;
+	const float radius = 14.3f;
+
+	std::vector<float> vol;
+	_mcSphere( vol, n, radius, false );
+
+	MarchingCubes mc( &vol[ 0 ], n, n, n );
+	mc.setSlabSize( 3 );
+
+	SceneMesh mesh( "sphere" );
+	mc.triangulate( mesh );
+	b = mesh.faceSize() > 0 && _mcClosed( mesh ) && _mcOnSphere( mesh, n, radius );
+	CVTTEST_PRINT( "welded mesh", b );
+	ret &= b;
+
+	SceneMesh nmesh( "sphere" );
+	mc.triangulateWithNormals( nmesh );
+	b = _mcClosed( nmesh ) && _mcOnSphere( nmesh, n, radius ) && nmesh.normalSize() == nmesh.vertexSize();
+	for( size_t i = 0; b && i < nmesh.vertexSize(); i++ ) {
+		float c = ( n - 1 ) * 0.5f;
+		Vector3f dir = nmesh.vertex( i ) - Vector3f( c, c, c );
+		dir.normalize();
+		/* the distance increases outwards, the normals point inwards */
+		b &= nmesh.normal( i ).dot( dir ) < -0.9f;
+	}
+	CVTTEST_PRINT( "welded mesh with normals", b );
+	ret &= b;
+
+	/* the slab size must not change the result */
+	SceneMesh mesh2( "sphere" );
+	mc.setSlabSize( 64 );
+	mc.triangulate( mesh2 );
+	b = mesh2.vertexSize() == mesh.vertexSize() && mesh2.faceSize() == mesh.faceSize();
+	CVTTEST_PRINT( "slab size independent", b );
+	ret &= b;
+
+	/* with normals the first and last layer are skipped */
+	MCSlabCollector collector( 1 );
+	mc.setSlabSize( 5 );
+	mc.triangulate( Delegate<void ( const MarchingCubesSlab& )>( &collector, &MCSlabCollector::slab ), true );
+	b = collector.ok && collector.vertices == nmesh.vertexSize() && collector.faces == nmesh.faceSize();
+	CVTTEST_PRINT( "slab streaming", b );
+	ret &= b;
+
+	std::vector<float> wvol;
+	_mcSphere( wvol, n, radius, true );
+	MarchingCubes wmc( &wvol[ 0 ], n, n, n, true );
+	SceneMesh wmesh( "sphere" );
+	wmc.triangulate( wmesh );
+	b = wmesh.vertexSize() == mesh.vertexSize() && wmesh.faceSize() == mesh.faceSize();
+	wmc.setMinimumWeight( 30.0f );
+	wmc.triangulate( wmesh );
+	b &= wmesh.isEmpty();
+	CVTTEST_PRINT( "weighted volume", b );
+	ret &= b;
+
+	return ret;
+END_CVTTEST
@@ -0,0 +1,159 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/geom/scene/Scene.h>
+#include <cvt/geom/scene/SceneMesh.h>
+#include <cvt/util/CVTTest.h>
+
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace cvt;
+
+/*
+   Round trip of a small mesh through the PLY loader plugin in all three formats:
+   5 coloured vertices, one triangle and one quad.
+ */
+
+static const size_t _numVertices = 5;
+static const unsigned int _faces[] = { 3, 0, 1, 2, 4, 1, 2, 3, 4 };
+static const unsigned int _triangles[] = { 0, 1, 2, 1, 2, 3, 1, 3, 4 };
+
+static Vector3f _vertex( size_t i )
+{
+	return Vector3f( ( float ) i, 2.0f * i + 0.5f, -( float ) i );
+}
+
+static uint8_t _red( size_t i )
+{
+	return ( uint8_t ) ( i * 50 );
+}
+
+static void _put( FILE* f, const void* data, size_t size, bool bigendian )
+{
+	const uint8_t* p = ( const uint8_t* ) data;
+	uint16_t one = 1;
+	bool swap = ( *( ( uint8_t* ) &one ) == 1 ) == bigendian;
+	for( size_t i = 0; i < size; i++ )
+		fputc( p[ swap ? size - 1 - i : i ], f );
+}
+
+static void _writePly( const String& path, const char* format )
+{
+	FILE* f = fopen( path.c_str(), "wb" );
+	bool ascii = !strcmp( format, "ascii" );
+	bool bigendian = !strcmp( format, "binary_big_endian" );
+
+	fprintf( f, "ply\nformat %s 1.0\ncomment cvt test\n", format );
+	fprintf( f, "element vertex %d\nproperty float x\nproperty float y\nproperty float z\n", ( int ) _numVertices );
+	fprintf( f, "property uchar red\nproperty uchar green\nproperty uchar blue\n" );
+	/* the big endian file uses the generic face path with an additional property */
+	if( bigendian )
+		fprintf( f, "element face 2\nproperty list uchar uint vertex_indices\nproperty uchar flags\nend_header\n" );
+	else
+		fprintf( f, "element face 2\nproperty list uchar int vertex_indices\nend_header\n" );
+
+	for( size_t i = 0; i < _numVertices; i++ ) {
+		Vector3f v = _vertex( i );
+		uint8_t rgb[ 3 ] = { _red( i ), 255, 0 };
+		if( ascii ) {
+			fprintf( f, "%g %g %g %d %d %d\n", v.x, v.y, v.z, rgb[ 0 ], rgb[ 1 ], rgb[ 2 ] );
+		} else {
+			for( int k = 0; k < 3; k++ )
+				_put( f, &v[ k ], sizeof( float ), bigendian );
+			fwrite( rgb, 1, 3, f );
+		}
+	}
+
+	for( size_t i = 0; i < sizeof( _faces ) / sizeof( _faces[ 0 ] ); ) {
+		uint8_t n = _faces[ i++ ];
+		if( ascii ) {
+			fprintf( f, "%d", n );
+			for( size_t k = 0; k < n; k++ )
+				fprintf( f, " %d", _faces[ i + k ] );
+			fprintf( f, "\n" );
+		} else {
+			fputc( n, f );
+			for( size_t k = 0; k < n; k++ ) {
+				uint32_t idx = _faces[ i + k ];
+				_put( f, &idx, sizeof( idx ), bigendian );
+			}
+			if( bigendian )
+				fputc( 0x7f, f );
+		}
+		i += n;
+	}
+	fclose( f );
+}
+
+static bool _loadTest( const char* format )
+{
+	String path;
+	path.sprintf( "/tmp/cvt_ply_%d_%s.ply", ( int ) getpid(), format );
+	_writePly( path, format );
+
+	bool b = true;
+	Scene scene;
+	try {
+		scene.load( path );
+	} catch( const Exception& e ) {
+		b = false;
+	}
+	unlink( path.c_str() );
+
+	b &= scene.geometrySize() == 1;
+	if( !b )
+		return false;
+
+	const SceneMesh& mesh = *( const SceneMesh* ) scene.geometry( 0 );
+	b &= mesh.type() == SCENEGEOMETRY_MESH && mesh.meshType() == SCENEMESH_TRIANGLES;
+	b &= mesh.vertexSize() == _numVertices && mesh.colorSize() == _numVertices;
+	b &= mesh.faceSize() == 3;
+	for( size_t i = 0; b && i < _numVertices; i++ ) {
+		b &= mesh.vertex( i ) == _vertex( i );
+		b &= Math::abs( mesh.color( i ).x - _red( i ) / 255.0f ) < 1e-6f && mesh.color( i ).y == 1.0f && mesh.color( i ).z == 0.0f;
+	}
+	for( size_t i = 0; b && i < 9; i++ )
+		b &= mesh.faces()[ i ] == _triangles[ i ];
+	return b;
+}
+
+BEGIN_CVTTEST( PlyLoader )
+	bool result = true;
+	bool b;
+
+	b = _loadTest( "ascii" );
+	CVTTEST_PRINT( "ascii", b );
+	result &= b;
+
+	b = _loadTest( "binary_little_endian" );
+	CVTTEST_PRINT( "binary_little_endian", b );
+	result &= b;
+
+	b = _loadTest( "binary_big_endian" );
+	CVTTEST_PRINT( "binary_big_endian", b );
+	result &= b;
+
+	return result;
+END_CVTTEST
@@ -23,52 +23,867 @@
 */
 
 #include <cvt/geom/scene/SceneMesh.h>
+#include <cvt/util/ParallelFor.h>
+#include <algorithm>
 #include <set>
+#include <string.h>
 
 namespace cvt {
 
 
-	void SceneMesh::removeRedundancy( float vepsilon, float nepsilon, float tepsilon )
+	/*
+	   Vertex welding on a hash grid. Positions are quantised to cells of at least the position
+	   epsilon, so every candidate lies in one of the 27 neighbouring cells. Cells are distributed
+	   over partitions by hash, every partition owns its own open-addressing table and the tables
+	   are built and queried in parallel. Each vertex is welded to the lowest representative matching
+	   it, a vertex without one becomes a representative itself, so welded vertices are always within
+	   epsilon of their representative. The parallel pass finds the lowest earlier match, which
+	   already is the answer for most vertices; the rest is resolved in index order - the result does
+	   not depend on the number of threads.
+	 */
+	class SceneMeshWeld {
+		public:
+			SceneMeshWeld( const Vector3f* vertices, const Vector3f* normals, const Vector2f* texcoords, size_t size,
+						   float vepsilon, float nepsilon, float tepsilon );
+
+			/* remap old vertex index to new index, returns the number of remaining vertices */
+			size_t weld( std::vector<unsigned int>& remap );
+
+		private:
+			static const unsigned int NONE = ( unsigned int ) -1;
+
+			friend class SceneMeshWeldKeyBody;
+			friend class SceneMeshWeldBuildBody;
+			friend class SceneMeshWeldMatchBody;
+
+			static uint32_t hash( int64_t x, int64_t y, int64_t z );
+			unsigned int	find( int64_t x, int64_t y, int64_t z ) const;
+			bool			match( size_t a, size_t b ) const;
+			unsigned int	representative( size_t i ) const;
+
+			const Vector3f*				_vertices;
+			const Vector3f*				_normals;
+			const Vector2f*				_texcoords;
+			size_t						_size;
+			float						_vepsilon;
+			float						_nepsilon;
+			float						_tepsilon;
+			float						_cellsize; /* 0 for exact matching */
+
+			std::vector<int64_t>		_cells;
+			std::vector<uint32_t>		_hash;
+			size_t						_partbits;
+			std::vector<size_t>			_partstart;
+			std::vector<unsigned int>	_partverts;
+			std::vector<size_t>			_tablestart;
+			std::vector<unsigned int>	_table;
+			std::vector<unsigned int>	_next;
+			std::vector<unsigned int>	_rep;
+	};
+
+	const unsigned int SceneMeshWeld::NONE;
+
+	class SceneMeshWeldKeyBody {
+		public:
+			SceneMeshWeldKeyBody( SceneMeshWeld& weld ) : _weld( weld ) {}
+
+			void operator()( const Range<size_t>& r ) const
+			{
+				for( size_t i = r.min; i < r.max; i++ ) {
+					int64_t* cell = &_weld._cells[ 3 * i ];
+					const Vector3f& v = _weld._vertices[ i ];
+					if( _weld._cellsize > 0.0f ) {
+						float inv = 1.0f / _weld._cellsize;
+						cell[ 0 ] = ( int64_t ) Math::floor( v.x * inv );
+						cell[ 1 ] = ( int64_t ) Math::floor( v.y * inv );
+						cell[ 2 ] = ( int64_t ) Math::floor( v.z * inv );
+					} else {
+						/* exact matching - key on the bits, +0 and -0 are the same */
+						for( int k = 0; k < 3; k++ ) {
+							float f = v[ k ] == 0.0f ? 0.0f : v[ k ];
+							uint32_t bits;
+							memcpy( &bits, &f, sizeof( bits ) );
+							cell[ k ] = bits;
+						}
+					}
+					_weld._hash[ i ] = SceneMeshWeld::hash( cell[ 0 ], cell[ 1 ], cell[ 2 ] );
+				}
+			}
+
+		private:
+			SceneMeshWeld& _weld;
+	};
+
+	class SceneMeshWeldBuildBody {
+		public:
+			SceneMeshWeldBuildBody( SceneMeshWeld& weld ) : _weld( weld ) {}
+
+			void operator()( const Range<size_t>& r ) const
+			{
+				for( size_t p = r.min; p < r.max; p++ ) {
+					unsigned int* table = &_weld._table[ _weld._tablestart[ p ] ];
+					size_t mask = _weld._tablestart[ p + 1 ] - _weld._tablestart[ p ] - 1;
+
+					/* insert backwards, so every cell list is sorted by ascending vertex index */
+					for( size_t j = _weld._partstart[ p + 1 ]; j-- > _weld._partstart[ p ]; ) {
+						unsigned int v = _weld._partverts[ j ];
+						const int64_t* cell = &_weld._cells[ 3 * v ];
+						size_t slot = ( _weld._hash[ v ] >> _weld._partbits ) & mask;
+
+						while( 1 ) {
+							unsigned int head = table[ slot ];
+							if( head == SceneMeshWeld::NONE ) {
+								table[ slot ] = v;
+								_weld._next[ v ] = SceneMeshWeld::NONE;
+								break;
+							}
+							const int64_t* hcell = &_weld._cells[ 3 * head ];
+							if( hcell[ 0 ] == cell[ 0 ] && hcell[ 1 ] == cell[ 1 ] && hcell[ 2 ] == cell[ 2 ] ) {
+								table[ slot ] = v;
+								_weld._next[ v ] = head;
+								break;
+							}
+							slot = ( slot + 1 ) & mask;
+						}
+					}
+				}
+			}
+
+		private:
+			SceneMeshWeld& _weld;
+	};
+
+	class SceneMeshWeldMatchBody {
+		public:
+			SceneMeshWeldMatchBody( SceneMeshWeld& weld ) : _weld( weld ) {}
+
+			void operator()( const Range<size_t>& r ) const
+			{
+				int range = _weld._cellsize > 0.0f ? 1 : 0;
+
+				for( size_t i = r.min; i < r.max; i++ ) {
+					const int64_t* cell = &_weld._cells[ 3 * i ];
+					unsigned int best = ( unsigned int ) i;
+
+					for( int dz = -range; dz <= range; dz++ ) {
+						for( int dy = -range; dy <= range; dy++ ) {
+							for( int dx = -range; dx <= range; dx++ ) {
+								unsigned int u = _weld.find( cell[ 0 ] + dx, cell[ 1 ] + dy, cell[ 2 ] + dz );
+								for( ; u != SceneMeshWeld::NONE && u < best; u = _weld._next[ u ] ) {
+									if( _weld.match( u, i ) ) {
+										best = u;
+										break;
+									}
+								}
+							}
+						}
+					}
+					_weld._rep[ i ] = best;
+				}
+			}
+
+		private:
+			SceneMeshWeld& _weld;
+	};
+
+	SceneMeshWeld::SceneMeshWeld( const Vector3f* vertices, const Vector3f* normals, const Vector2f* texcoords, size_t size,
+								  float vepsilon, float nepsilon, float tepsilon ) :
+		_vertices( vertices ),
+		_normals( normals ),
+		_texcoords( texcoords ),
+		_size( size ),
+		_vepsilon( Math::max( vepsilon, 0.0f ) ),
+		_nepsilon( nepsilon ),
+		_tepsilon( tepsilon ),
+		_cellsize( 0.0f ),
+		_partbits( 0 )
+	{
+		if( _vepsilon > 0.0f ) {
+			/* keep the cell coordinates in a sane range for tiny epsilons */
+			float maxabs = 0.0f;
+			for( size_t i = 0; i < _size; i++ )
+				maxabs = Math::max( maxabs, Math::max( Math::abs( _vertices[ i ].x ), Math::max( Math::abs( _vertices[ i ].y ), Math::abs( _vertices[ i ].z ) ) ) );
+			_cellsize = Math::max( _vepsilon, maxabs * 1e-12f );
+		}
+	}
+
+	inline uint32_t SceneMeshWeld::hash( int64_t x, int64_t y, int64_t z )
+	{
+		uint64_t h = ( ( uint64_t ) x * 73856093ULL ) ^ ( ( uint64_t ) y * 19349663ULL ) ^ ( ( uint64_t ) z * 83492791ULL );
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		return ( uint32_t ) h;
+	}
+
+	inline unsigned int SceneMeshWeld::find( int64_t x, int64_t y, int64_t z ) const
 	{
-		std::vector<Vector3f>		nvertices;
-		std::vector<Vector3f>		nnormals;
-		std::vector<Vector2f>		ntexcoords;
-		std::vector<unsigned int>	nvindices;
-
-		for( size_t idx = 0; idx < _vertices.size(); idx++ ) {
-			Vector3f v( _vertices[ idx ] );
-			bool added = false;
-
-			for( size_t i = 0; i < nvertices.size() && !added; i++ ) {
-				if( v.isEqual( nvertices[ i ], vepsilon ) ) {
-					if( normalSize() ) {
-						Vector3f n( _normals[ idx ] );
-						if( !n.isEqual( nnormals[ i ], nepsilon ) )
-							continue;
+		uint32_t h = hash( x, y, z );
+		size_t p = h & ( ( 1 << _partbits ) - 1 );
+		const unsigned int* table = &_table[ _tablestart[ p ] ];
+		size_t mask = _tablestart[ p + 1 ] - _tablestart[ p ] - 1;
+		size_t slot = ( h >> _partbits ) & mask;
+
+		while( table[ slot ] != NONE ) {
+			const int64_t* cell = &_cells[ 3 * table[ slot ] ];
+			if( cell[ 0 ] == x && cell[ 1 ] == y && cell[ 2 ] == z )
+				return table[ slot ];
+			slot = ( slot + 1 ) & mask;
+		}
+		return NONE;
+	}
+
+	inline bool SceneMeshWeld::match( size_t a, size_t b ) const
+	{
+		if( !_vertices[ a ].isEqual( _vertices[ b ], _vepsilon ) )
+			return false;
+		if( _normals && !_normals[ a ].isEqual( _normals[ b ], _nepsilon ) )
+			return false;
+		if( _texcoords && !_texcoords[ a ].isEqual( _texcoords[ b ], _tepsilon ) )
+			return false;
+		return true;
+	}
+
+	/* lowest representative before i matching i, or i - all vertices before i must be resolved */
+	unsigned int SceneMeshWeld::representative( size_t i ) const
+	{
+		int range = _cellsize > 0.0f ? 1 : 0;
+		const int64_t* cell = &_cells[ 3 * i ];
+		unsigned int best = ( unsigned int ) i;
+
+		for( int dz = -range; dz <= range; dz++ ) {
+			for( int dy = -range; dy <= range; dy++ ) {
+				for( int dx = -range; dx <= range; dx++ ) {
+					unsigned int u = find( cell[ 0 ] + dx, cell[ 1 ] + dy, cell[ 2 ] + dz );
+					for( ; u != NONE && u < best; u = _next[ u ] ) {
+						if( _rep[ u ] == u && match( u, i ) ) {
+							best = u;
+							break;
+						}
 					}
-					if( texcoordSize() ) {
-						Vector2f t = _texcoords[ idx ];
-						if( !t.isEqual( ntexcoords[ i ], tepsilon ) )
-							continue;
+				}
+			}
+		}
+		return best;
+	}
+
+	size_t SceneMeshWeld::weld( std::vector<unsigned int>& remap )
+	{
+		remap.resize( _size );
+		if( !_size )
+			return 0;
+
+		_cells.resize( 3 * _size );
+		_hash.resize( _size );
+		_next.resize( _size );
+		_rep.resize( _size );
+
+		SceneMeshWeldKeyBody keybody( *this );
+		parallelFor( Range<size_t>( 0, _size ), keybody, 4096 );
+
+		/* stable partitioning by the lower hash bits */
+		_partbits = 0;
+		while( _partbits < 6 && ( ( size_t ) 1 << _partbits ) * 8192 < _size )
+			_partbits++;
+		size_t npart = ( size_t ) 1 << _partbits;
+
+		_partstart.assign( npart + 1, 0 );
+		for( size_t i = 0; i < _size; i++ )
+			_partstart[ ( _hash[ i ] & ( npart - 1 ) ) + 1 ]++;
+		for( size_t p = 0; p < npart; p++ )
+			_partstart[ p + 1 ] += _partstart[ p ];
+
+		std::vector<size_t> fill( _partstart.begin(), _partstart.end() - 1 );
+		_partverts.resize( _size );
+		for( size_t i = 0; i < _size; i++ )
+			_partverts[ fill[ _hash[ i ] & ( npart - 1 ) ]++ ] = i;
+
+		_tablestart.resize( npart + 1 );
+		_tablestart[ 0 ] = 0;
+		for( size_t p = 0; p < npart; p++ ) {
+			size_t tsize = 1;
+			while( tsize < 2 * ( _partstart[ p + 1 ] - _partstart[ p ] ) )
+				tsize <<= 1;
+			_tablestart[ p + 1 ] = _tablestart[ p ] + tsize;
+		}
+		_table.assign( _tablestart[ npart ], NONE );
+
+		SceneMeshWeldBuildBody buildbody( *this );
+		parallelFor( Range<size_t>( 0, npart ), buildbody, 1 );
+
+		SceneMeshWeldMatchBody matchbody( *this );
+		parallelFor( Range<size_t>( 0, _size ), matchbody, 4096 );
+
+		/* representatives always precede their vertices */
+		size_t count = 0;
+		for( size_t i = 0; i < _size; i++ ) {
+			/* the lowest match is the answer if it is a representative, there is none lower */
+			if( _rep[ i ] != i && _rep[ _rep[ i ] ] != _rep[ i ] )
+				_rep[ i ] = representative( i );
+
+			if( _rep[ i ] == i )
+				remap[ i ] = count++;
+			else
+				remap[ i ] = remap[ _rep[ i ] ];
+		}
+		return count;
+	}
+
+	void SceneMesh::removeRedundancy( float vepsilon, float nepsilon, float tepsilon )
+	{
+		std::vector<unsigned int> remap;
+		SceneMeshWeld weld( _vertices.empty() ? NULL : &_vertices[ 0 ],
+						    normalSize() && normalSize() == vertexSize() ? &_normals[ 0 ] : NULL,
+						    texcoordSize() && texcoordSize() == vertexSize() ? &_texcoords[ 0 ] : NULL,
+						    _vertices.size(), vepsilon, nepsilon, tepsilon );
+		size_t count = weld.weld( remap );
+
+		compactVertices( remap, count );
+	}
+
+	void SceneMesh::simplify( float vepsilon )
+	{
+		std::vector<unsigned int> remap;
+		SceneMeshWeld weld( _vertices.empty() ? NULL : &_vertices[ 0 ], NULL, NULL,
+						    _vertices.size(), vepsilon, 0.0f, 0.0f );
+		size_t count = weld.weld( remap );
+
+		compactVertices( remap, count );
+
+		/* remove the faces collapsed by clustering */
+		size_t nface = _meshtype == SCENEMESH_TRIANGLES ? 3 : 4;
+		size_t out = 0;
+		for( size_t n = 0; n + nface <= _vindices.size(); n += nface ) {
+			bool degenerate = false;
+			for( size_t k = 0; k < nface && !degenerate; k++ )
+				for( size_t l = k + 1; l < nface && !degenerate; l++ )
+					degenerate = _vindices[ n + k ] == _vindices[ n + l ];
+			if( degenerate )
+				continue;
+			for( size_t k = 0; k < nface; k++ )
+				_vindices[ out++ ] = _vindices[ n + k ];
+		}
+		_vindices.resize( out );
+	}
+
+	/*
+	   Quadric error metric edge collapse (Garland & Heckbert). The connectivity is an implicit
+	   half-edge structure on the triangle list: half-edge h is the corner h of _vindices and points
+	   from vertex h to the next corner of its face, so only the twin of every half-edge and one
+	   outgoing half-edge per vertex are stored. Collapses are taken from a heap, outdated entries
+	   are detected by vertex version stamps. Boundary vertices stay in place, non-manifold parts
+	   are left untouched.
+	 */
+	class SceneMeshDecimator {
+		public:
+			SceneMeshDecimator( std::vector<Vector3f>& vertices, std::vector<unsigned int>& vindices );
+
+			void	decimate( size_t targetfaces, float maxerror );
+
+			/* remove the collapsed faces, remap old vertex index to new (NONE if removed) */
+			size_t	finish( std::vector<unsigned int>& remap );
+
+		private:
+			static const unsigned int NONE = ( unsigned int ) -1;
+
+			enum VertexFlags { BOUNDARY = 1, LOCKED = 2, REMOVED = 4 };
+
+			struct Quadric {
+				double q[ 10 ];
+			};
+
+			struct Collapse {
+				float			cost;
+				unsigned int	from;
+				unsigned int	to;
+				unsigned int	stamp;
+
+				bool operator<( const Collapse& c ) const { return cost > c.cost; }
+			};
+
+			static inline unsigned int next( unsigned int h ) { return h % 3 == 2 ? h - 2 : h + 1; }
+			static inline unsigned int prev( unsigned int h ) { return h % 3 == 0 ? h + 2 : h - 1; }
+
+			void	buildConnectivity();
+			void	buildQuadrics();
+			void	ring( unsigned int v, std::vector<unsigned int>& hedges ) const;
+			void	neighbours( const std::vector<unsigned int>& hedges, std::vector<unsigned int>& verts ) const;
+			bool	evaluate( unsigned int u, unsigned int v, Collapse& c, Vector3f& pos ) const;
+			double	error( const Quadric& q, const Vector3f& p ) const;
+			void	push( unsigned int u, unsigned int v );
+			void	purge();
+			bool	flips( const std::vector<unsigned int>& hedges, unsigned int f0, unsigned int f1, const Vector3f& pos ) const;
+			void	collapse( unsigned int h, const Vector3f& pos );
+
+			std::vector<Vector3f>&		_vertices;
+			std::vector<unsigned int>&	_vindices;
+			std::vector<unsigned int>	_twin;
+			std::vector<unsigned int>	_out;
+			std::vector<uint8_t>		_flags;
+			std::vector<unsigned int>	_version;
+			std::vector<Quadric>		_quadrics;
+			std::vector<Collapse>		_heap;
+			size_t						_faces;
+
+			std::vector<unsigned int>	_ringFrom, _ringTo, _nbFrom, _nbTo;
+	};
+
+	const unsigned int SceneMeshDecimator::NONE;
+
+	SceneMeshDecimator::SceneMeshDecimator( std::vector<Vector3f>& vertices, std::vector<unsigned int>& vindices ) :
+		_vertices( vertices ),
+		_vindices( vindices ),
+		_faces( vindices.size() / 3 )
+	{
+		buildConnectivity();
+		buildQuadrics();
+	}
+
+	void SceneMeshDecimator::buildConnectivity()
+	{
+		size_t nv = _vertices.size();
+		size_t nh = _faces * 3;
+
+		_flags.assign( nv, 0 );
+		_version.assign( nv, 0 );
+		_out.assign( nv, NONE );
+		_twin.assign( nh, NONE );
+
+		/* outgoing half-edges per vertex, temporary */
+		std::vector<unsigned int> start( nv + 1, 0 );
+		std::vector<unsigned int> outgoing( nh );
+		for( size_t h = 0; h < nh; h++ )
+			start[ _vindices[ h ] + 1 ]++;
+		for( size_t v = 0; v < nv; v++ )
+			start[ v + 1 ] += start[ v ];
+		std::vector<unsigned int> fill( start.begin(), start.end() - 1 );
+		for( size_t h = 0; h < nh; h++ ) {
+			outgoing[ fill[ _vindices[ h ] ]++ ] = h;
+			_out[ _vindices[ h ] ] = h;
+		}
+
+		for( size_t h = 0; h < nh; h++ ) {
+			unsigned int a = _vindices[ h ];
+			unsigned int b = _vindices[ next( h ) ];
+
+			if( a == b || a == _vindices[ prev( h ) ] ) {
+				/* degenerate face */
+				_flags[ a ] |= LOCKED;
+				_flags[ b ] |= LOCKED;
+				continue;
+			}
+
+			unsigned int twin = NONE;
+			size_t opposite = 0, same = 0;
+			for( unsigned int i = start[ b ]; i < start[ b + 1 ]; i++ ) {
+				if( _vindices[ next( outgoing[ i ] ) ] == a ) {
+					twin = outgoing[ i ];
+					opposite++;
+				}
+			}
+			for( unsigned int i = start[ a ]; i < start[ a + 1 ]; i++ )
+				if( _vindices[ next( outgoing[ i ] ) ] == b )
+					same++;
+
+			if( opposite == 1 && same == 1 )
+				_twin[ h ] = twin;
+			else if( opposite || same > 1 ) {
+				/* non-manifold edge */
+				_flags[ a ] |= LOCKED;
+				_flags[ b ] |= LOCKED;
+			}
+			if( _twin[ h ] == NONE ) {
+				_flags[ a ] |= BOUNDARY;
+				_flags[ b ] |= BOUNDARY;
+			}
+		}
+
+		/* a vertex whose fan does not cover all its faces is non-manifold */
+		std::vector<unsigned int> hedges;
+		for( size_t v = 0; v < nv; v++ ) {
+			if( _out[ v ] == NONE ) {
+				_flags[ v ] |= REMOVED;
+				continue;
+			}
+			if( _flags[ v ] & LOCKED )
+				continue;
+			ring( v, hedges );
+			if( hedges.size() != start[ v + 1 ] - start[ v ] )
+				_flags[ v ] |= LOCKED;
+		}
+	}
+
+	void SceneMeshDecimator::buildQuadrics()
+	{
+		Quadric zero;
+		for( int i = 0; i < 10; i++ )
+			zero.q[ i ] = 0.0;
+		_quadrics.assign( _vertices.size(), zero );
+
+		/* area weighted face planes */
+		for( size_t f = 0; f < _faces; f++ ) {
+			const Vector3f& p0 = _vertices[ _vindices[ 3 * f ] ];
+			const Vector3f& p1 = _vertices[ _vindices[ 3 * f + 1 ] ];
+			const Vector3f& p2 = _vertices[ _vindices[ 3 * f + 2 ] ];
+			Vector3f n = ( p1 - p0 ).cross( p2 - p0 );
+			double len = n.length();
+			if( len <= 0.0 )
+				continue;
+			double a = n.x / len, b = n.y / len, c = n.z / len;
+			double d = -( a * p0.x + b * p0.y + c * p0.z );
+			double w = 0.5 * len;
+			double plane[ 10 ] = { a * a, a * b, a * c, a * d, b * b, b * c, b * d, c * c, c * d, d * d };
+
+			for( int k = 0; k < 3; k++ ) {
+				double* q = _quadrics[ _vindices[ 3 * f + k ] ].q;
+				for( int i = 0; i < 10; i++ )
+					q[ i ] += w * plane[ i ];
+			}
+		}
+	}
+
+	/* all outgoing half-edges of v, in both directions around boundary vertices */
+	void SceneMeshDecimator::ring( unsigned int v, std::vector<unsigned int>& hedges ) const
+	{
+		unsigned int start = _out[ v ];
+		unsigned int h = start;
+		size_t limit = _vindices.size();
+
+		hedges.clear();
+		do {
+			hedges.push_back( h );
+			h = _twin[ prev( h ) ];
+		} while( h != NONE && h != start && hedges.size() < limit );
+
+		if( h == NONE ) {
+			for( h = _twin[ start ]; h != NONE && hedges.size() < limit; h = _twin[ h ] ) {
+				h = next( h );
+				hedges.push_back( h );
+			}
+		}
+	}
+
+	void SceneMeshDecimator::neighbours( const std::vector<unsigned int>& hedges, std::vector<unsigned int>& verts ) const
+	{
+		verts.clear();
+		for( size_t i = 0; i < hedges.size(); i++ ) {
+			verts.push_back( _vindices[ next( hedges[ i ] ) ] );
+			verts.push_back( _vindices[ prev( hedges[ i ] ) ] );
+		}
+		std::sort( verts.begin(), verts.end() );
+		verts.erase( std::unique( verts.begin(), verts.end() ), verts.end() );
+	}
+
+	inline double SceneMeshDecimator::error( const Quadric& quadric, const Vector3f& p ) const
+	{
+		const double* q = quadric.q;
+		double x = p.x, y = p.y, z = p.z;
+		return q[ 0 ] * x * x + 2.0 * q[ 1 ] * x * y + 2.0 * q[ 2 ] * x * z + 2.0 * q[ 3 ] * x +
+			   q[ 4 ] * y * y + 2.0 * q[ 5 ] * y * z + 2.0 * q[ 6 ] * y +
+			   q[ 7 ] * z * z + 2.0 * q[ 8 ] * z + q[ 9 ];
+	}
+
+	bool SceneMeshDecimator::evaluate( unsigned int u, unsigned int v, Collapse& c, Vector3f& pos ) const
+	{
+		uint8_t fu = _flags[ u ];
+		uint8_t fv = _flags[ v ];
+
+		if( ( fu | fv ) & ( LOCKED | REMOVED ) )
+			return false;
+		if( fu & fv & BOUNDARY )
+			return false;
+
+		Quadric q;
+		for( int i = 0; i < 10; i++ )
+			q.q[ i ] = _quadrics[ u ].q[ i ] + _quadrics[ v ].q[ i ];
+
+		if( fu & BOUNDARY ) {
+			/* boundary vertices do not move */
+			c.from = v;
+			c.to = u;
+			pos = _vertices[ u ];
+		} else if( fv & BOUNDARY ) {
+			c.from = u;
+			c.to = v;
+			pos = _vertices[ v ];
+		} else {
+			c.from = u;
+			c.to = v;
+
+			/* minimise the quadric, fall back to end- and midpoint if singular or far off */
+			const double* m = q.q;
+			double det = m[ 0 ] * ( m[ 4 ] * m[ 7 ] - m[ 5 ] * m[ 5 ] ) -
+						 m[ 1 ] * ( m[ 1 ] * m[ 7 ] - m[ 5 ] * m[ 2 ] ) +
+						 m[ 2 ] * ( m[ 1 ] * m[ 5 ] - m[ 4 ] * m[ 2 ] );
+			double trace = m[ 0 ] + m[ 4 ] + m[ 7 ];
+			bool solved = false;
+
+			if( Math::abs( det ) > 1e-6 * trace * trace * trace ) {
+				double inv = 1.0 / det;
+				double bx = -m[ 3 ], by = -m[ 6 ], bz = -m[ 8 ];
+				Vector3f p( ( float ) ( inv * ( bx * ( m[ 4 ] * m[ 7 ] - m[ 5 ] * m[ 5 ] ) - m[ 1 ] * ( by * m[ 7 ] - m[ 5 ] * bz ) + m[ 2 ] * ( by * m[ 5 ] - m[ 4 ] * bz ) ) ),
+							( float ) ( inv * ( m[ 0 ] * ( by * m[ 7 ] - bz * m[ 5 ] ) - bx * ( m[ 1 ] * m[ 7 ] - m[ 5 ] * m[ 2 ] ) + m[ 2 ] * ( m[ 1 ] * bz - by * m[ 2 ] ) ) ),
+							( float ) ( inv * ( m[ 0 ] * ( m[ 4 ] * bz - m[ 5 ] * by ) - m[ 1 ] * ( m[ 1 ] * bz - by * m[ 2 ] ) + bx * ( m[ 1 ] * m[ 5 ] - m[ 4 ] * m[ 2 ] ) ) ) );
+				Vector3f mid = 0.5f * ( _vertices[ u ] + _vertices[ v ] );
+				if( ( p - mid ).length() <= ( _vertices[ u ] - _vertices[ v ] ).length() ) {
+					pos = p;
+					solved = true;
+				}
+			}
+
+			if( !solved ) {
+				Vector3f cand[ 3 ] = { _vertices[ u ], _vertices[ v ], 0.5f * ( _vertices[ u ] + _vertices[ v ] ) };
+				double best = error( q, cand[ 0 ] );
+				pos = cand[ 0 ];
+				for( int i = 1; i < 3; i++ ) {
+					double e = error( q, cand[ i ] );
+					if( e < best ) {
+						best = e;
+						pos = cand[ i ];
 					}
-					added = true;
-					nvindices.push_back( i );
 				}
 			}
-			if( !added ) {
-				nvertices.push_back( v );
-				if( normalSize() )
-					nnormals.push_back( _normals[ idx ] );
-				if( texcoordSize() )
-					ntexcoords.push_back( _texcoords[ idx ] );
-				nvindices.push_back( nvertices.size() - 1 );
+		}
+
+		c.cost = ( float ) Math::max( error( q, pos ), 0.0 );
+		c.stamp = _version[ u ] + _version[ v ];
+		return true;
+	}
+
+	void SceneMeshDecimator::push( unsigned int u, unsigned int v )
+	{
+		Collapse c;
+		Vector3f pos;
+		if( evaluate( u, v, c, pos ) ) {
+			_heap.push_back( c );
+			std::push_heap( _heap.begin(), _heap.end() );
+		}
+	}
+
+	/* reject collapses folding over or degenerating one of the remaining faces */
+	bool SceneMeshDecimator::flips( const std::vector<unsigned int>& hedges, unsigned int f0, unsigned int f1, const Vector3f& pos ) const
+	{
+		for( size_t i = 0; i < hedges.size(); i++ ) {
+			unsigned int h = hedges[ i ];
+			unsigned int f = h / 3;
+			if( f == f0 || f == f1 )
+				continue;
+			const Vector3f& p0 = _vertices[ _vindices[ h ] ];
+			const Vector3f& p1 = _vertices[ _vindices[ next( h ) ] ];
+			const Vector3f& p2 = _vertices[ _vindices[ prev( h ) ] ];
+			Vector3f n0 = ( p1 - p0 ).cross( p2 - p0 );
+			Vector3f n1 = ( p1 - pos ).cross( p2 - pos );
+			float l0 = n0.length();
+			float l1 = n1.length();
+			if( l1 <= 1e-12f * ( p1 - p2 ).lengthSqr() || n0 * n1 < 0.2f * l0 * l1 )
+				return true;
+		}
+		return false;
+	}
+
+	void SceneMeshDecimator::collapse( unsigned int h, const Vector3f& pos )
+	{
+		unsigned int u = _vindices[ h ];
+		unsigned int v = _vindices[ next( h ) ];
+		unsigned int n0 = next( h ), p0 = prev( h );
+		unsigned int ht = _twin[ h ];
+		unsigned int n1 = next( ht ), p1 = prev( ht );
+		unsigned int a = _vindices[ p0 ];
+		unsigned int b = _vindices[ p1 ];
+
+		for( size_t i = 0; i < _ringFrom.size(); i++ )
+			_vindices[ _ringFrom[ i ] ] = v;
+
+		/* glue the remaining edges of both removed faces */
+		unsigned int tn0 = _twin[ n0 ], tp0 = _twin[ p0 ];
+		unsigned int tn1 = _twin[ n1 ], tp1 = _twin[ p1 ];
+		if( tn0 != NONE )
+			_twin[ tn0 ] = tp0;
+		_twin[ tp0 ] = tn0;
+		_twin[ tn1 ] = tp1;
+		if( tp1 != NONE )
+			_twin[ tp1 ] = tn1;
+
+		_out[ v ] = tp0;
+		_out[ a ] = tn0 != NONE ? tn0 : next( tp0 );
+		_out[ b ] = tn1;
+
+		for( int k = 0; k < 3; k++ ) {
+			_vindices[ h - h % 3 + k ] = NONE;
+			_vindices[ ht - ht % 3 + k ] = NONE;
+		}
+		_faces -= 2;
+
+		for( int i = 0; i < 10; i++ )
+			_quadrics[ v ].q[ i ] += _quadrics[ u ].q[ i ];
+		_vertices[ v ] = pos;
+		_flags[ u ] |= REMOVED;
+		_version[ u ]++;
+		_version[ v ]++;
+	}
+
+	/* drop outdated collapses, every live edge has at most one valid entry */
+	void SceneMeshDecimator::purge()
+	{
+		size_t out = 0;
+		for( size_t i = 0; i < _heap.size(); i++ ) {
+			const Collapse& c = _heap[ i ];
+			if( !( ( _flags[ c.from ] | _flags[ c.to ] ) & REMOVED ) && c.stamp == _version[ c.from ] + _version[ c.to ] )
+				_heap[ out++ ] = c;
+		}
+		_heap.resize( out );
+		std::make_heap( _heap.begin(), _heap.end() );
+	}
+
+	void SceneMeshDecimator::decimate( size_t targetfaces, float maxerror )
+	{
+		size_t nh = _vindices.size();
+
+		_heap.clear();
+		for( size_t h = 0; h < nh; h++ ) {
+			Collapse c;
+			Vector3f pos;
+			if( ( _twin[ h ] == NONE || h < _twin[ h ] ) && evaluate( _vindices[ h ], _vindices[ next( h ) ], c, pos ) )
+				_heap.push_back( c );
+		}
+		std::make_heap( _heap.begin(), _heap.end() );
+
+		while( _faces > targetfaces && !_heap.empty() ) {
+			Collapse c = _heap.front();
+			std::pop_heap( _heap.begin(), _heap.end() );
+			_heap.pop_back();
+
+			if( c.cost > maxerror )
+				break;
+			if( ( _flags[ c.from ] | _flags[ c.to ] ) & REMOVED )
+				continue;
+			if( c.stamp != _version[ c.from ] + _version[ c.to ] )
+				continue;
+
+			ring( c.from, _ringFrom );
+			unsigned int h = NONE;
+			for( size_t i = 0; i < _ringFrom.size() && h == NONE; i++ )
+				if( _vindices[ next( _ringFrom[ i ] ) ] == c.to )
+					h = _ringFrom[ i ];
+			if( h == NONE || _twin[ h ] == NONE )
+				continue;
+
+			/* link condition: the only common neighbours are the two opposite vertices */
+			ring( c.to, _ringTo );
+			neighbours( _ringFrom, _nbFrom );
+			neighbours( _ringTo, _nbTo );
+			size_t common = 0;
+			for( size_t i = 0, j = 0; i < _nbFrom.size() && j < _nbTo.size(); ) {
+				if( _nbFrom[ i ] < _nbTo[ j ] )
+					i++;
+				else if( _nbFrom[ i ] > _nbTo[ j ] )
+					j++;
+				else {
+					common++;
+					i++;
+					j++;
+				}
 			}
+			if( common != 2 || ( _nbFrom.size() <= 3 && _nbTo.size() <= 3 ) )
+				continue;
+
+			Collapse cur;
+			Vector3f pos;
+			evaluate( c.from, c.to, cur, pos );
+			unsigned int f0 = h / 3;
+			unsigned int f1 = _twin[ h ] / 3;
+			if( flips( _ringFrom, f0, f1, pos ) || flips( _ringTo, f0, f1, pos ) )
+				continue;
+
+			collapse( h, pos );
+			if( _heap.size() > 4 * _faces )
+				purge();
+
+			ring( c.to, _ringTo );
+			neighbours( _ringTo, _nbTo );
+			for( size_t i = 0; i < _nbTo.size(); i++ )
+				push( c.to, _nbTo[ i ] );
 		}
+		std::vector<Collapse>().swap( _heap );
+	}
 
-		_vertices = nvertices;
-		_normals = nnormals;
-		_texcoords = ntexcoords;
-		_vindices = nvindices;
+	size_t SceneMeshDecimator::finish( std::vector<unsigned int>& remap )
+	{
+		size_t out = 0;
+		size_t count = 0;
+
+		remap.assign( _vertices.size(), NONE );
+		for( size_t h = 0; h < _vindices.size(); h += 3 ) {
+			if( _vindices[ h ] == NONE )
+				continue;
+			for( int k = 0; k < 3; k++ ) {
+				unsigned int v = _vindices[ h + k ];
+				if( remap[ v ] == NONE )
+					remap[ v ] = count++;
+				_vindices[ out++ ] = v;
+			}
+		}
+		_vindices.resize( out );
+		return count;
+	}
+
+	void SceneMesh::decimate( size_t targetfaces, float maxerror )
+	{
+		if( _meshtype == SCENEMESH_QUADS )
+			quadsToTriangles();
+
+		bool normals = normalSize() > 0;
+		std::vector<unsigned int> remap;
+		size_t count;
+		{
+			SceneMeshDecimator decimator( _vertices, _vindices );
+			decimator.decimate( targetfaces, maxerror );
+			count = decimator.finish( remap );
+		}
+		compactVertices( remap, count );
+
+		if( normals )
+			calculateNormals();
+	}
+
+	void SceneMesh::compactVertices( const std::vector<unsigned int>& remap, size_t count )
+	{
+		/* attributes not matching the vertex count are dropped */
+		bool normals = normalSize() && normalSize() == vertexSize();
+		bool tangents = tangentSize() && tangentSize() == vertexSize();
+		bool texcoords = texcoordSize() && texcoordSize() == vertexSize();
+		bool colors = colorSize() && colorSize() == vertexSize();
+
+		std::vector<Vector3f>		nvertices( count );
+		std::vector<Vector3f>		nnormals( normals ? count : 0 );
+		std::vector<Vector3f>		ntangents( tangents ? count : 0 );
+		std::vector<Vector2f>		ntexcoords( texcoords ? count : 0 );
+		std::vector<Vector4f>		ncolors( colors ? count : 0 );
+
+		/* the first vertex of every group is kept */
+		for( size_t idx = _vertices.size(); idx-- > 0; ) {
+			unsigned int i = remap[ idx ];
+			if( i == ( unsigned int ) -1 )
+				continue;
+			nvertices[ i ] = _vertices[ idx ];
+			if( normals )
+				nnormals[ i ] = _normals[ idx ];
+			if( tangents )
+				ntangents[ i ] = _tangents[ idx ];
+			if( texcoords )
+				ntexcoords[ i ] = _texcoords[ idx ];
+			if( colors )
+				ncolors[ i ] = _colors[ idx ];
+		}
+
+		for( size_t n = 0; n < _vindices.size(); n++ )
+			_vindices[ n ] = remap[ _vindices[ n ] ];
+
+		_vertices.swap( nvertices );
+		_normals.swap( nnormals );
+		_tangents.swap( ntangents );
+		_texcoords.swap( ntexcoords );
+		_colors.swap( ncolors );
 	}
 
 	void SceneMesh::quadsToTriangles()
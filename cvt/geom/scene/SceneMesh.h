@@ -50,23 +50,27 @@ namespace cvt {
 			size_t				normalSize() const;
 			size_t				tangentSize() const;
 			size_t				texcoordSize() const;
+			size_t				colorSize() const;
 			size_t				faceSize() const;
 
 			const Vector3f&		vertex( size_t i ) const;
 			const Vector3f&		normal( size_t i ) const;
 			const Vector3f&		tangent( size_t i ) const;
 			const Vector2f&		texcoord( size_t i ) const;
+			const Vector4f&		color( size_t i ) const;
 
 			void				setVertices( const Vector3f* data, size_t size );
 			void				setNormals( const Vector3f* data, size_t size );
 			void				setTangents( const Vector3f* data, size_t size );
 			void				setTexcoords( const Vector2f* data, size_t size );
+			void				setColors( const Vector4f* data, size_t size );
 			void				setFaces( const unsigned int* data, size_t size, SceneMeshType type );
 
 			const Vector3f*		vertices() const;
 			const Vector3f*		normals() const;
 			const Vector3f*		tangents() const;
 			const Vector2f*		texcoords() const;
+			const Vector4f*		colors() const;
 			const unsigned int* faces() const;
 			void				facesTriangles( std::vector<unsigned int>& output ) const;
 
@@ -83,6 +87,7 @@ namespace cvt {
 			void				calculateAdjacency();
 			void				removeRedundancy( float vepsilon = 0.0f, float nepsilon = 0.0f, float tepsilon = 0.0f );
 			void				simplify( float vepsilon );
+			void				decimate( size_t targetfaces, float maxerror = Math::MAXF );
 			void				addNoise( float amount );
 			void				flipNormals( );
 			void				quadsToTriangles();
@@ -90,10 +95,13 @@ namespace cvt {
 
 
 		private:
+			void				compactVertices( const std::vector<unsigned int>& remap, size_t count );
+
 			std::vector<Vector3f>		_vertices;
 			std::vector<Vector3f>		_normals;
 			std::vector<Vector3f>		_tangents;
 			std::vector<Vector2f>		_texcoords;
+			std::vector<Vector4f>		_colors;
 			std::vector<unsigned int>	_vindices;
 			SceneMeshType				_meshtype;
 	};
@@ -116,6 +124,7 @@ namespace cvt {
 		_vertices.clear();
 		_normals.clear();
 		_texcoords.clear();
+		_colors.clear();
 		_vindices.clear();
 		_meshtype = SCENEMESH_TRIANGLES;
 	}
@@ -145,6 +154,11 @@ namespace cvt {
 		return _texcoords.size();
 	}
 
+	inline size_t SceneMesh::colorSize() const
+	{
+		return _colors.size();
+	}
+
 	inline size_t SceneMesh::faceSize() const
 	{
 		size_t nface = _meshtype == SCENEMESH_TRIANGLES ? 3 : 4;
@@ -171,6 +185,11 @@ namespace cvt {
 		return _texcoords[ i ];
 	}
 
+	inline const Vector4f& SceneMesh::color( size_t i ) const
+	{
+		return _colors[ i ];
+	}
+
 	inline void SceneMesh::setVertices( const Vector3f* data, size_t size )
 	{
 		_vertices.assign( data, data + size );
@@ -191,6 +210,11 @@ namespace cvt {
 		_texcoords.assign( data, data + size );
 	}
 
+	inline void SceneMesh::setColors( const Vector4f* data, size_t size )
+	{
+		_colors.assign( data, data + size );
+	}
+
 	inline void SceneMesh::setFaces( const unsigned int* data, size_t size, SceneMeshType meshtype )
 	{
 		_meshtype = meshtype;
@@ -217,6 +241,11 @@ namespace cvt {
 		return &_texcoords[ 0 ];
 	}
 
+	inline const Vector4f* SceneMesh::colors() const
+	{
+		return &_colors[ 0 ];
+	}
+
 	inline const unsigned int* SceneMesh::faces() const
 	{
 		return &_vindices[ 0 ];
@@ -332,6 +361,7 @@ namespace cvt {
 		out << "\tVertices: " << mesh.vertexSize();
 		out << "\n\tNormals: " << mesh.normalSize();
 		out << "\n\tTexCoords: " << mesh.texcoordSize();
+		out << "\n\tColors: " << mesh.colorSize();
 		out << "\n\tFaces: " << mesh.faceSize() << "\n";
 		return out;
 	}
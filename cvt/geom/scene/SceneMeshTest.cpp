@@ -0,0 +1,192 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/geom/scene/SceneMesh.h>
+#include <cvt/geom/MarchingCubes.h>
+#include <cvt/util/CVTTest.h>
+
+#include <map>
+
+using namespace cvt;
+
+/* grid of n x n quads as triangle soup, every quad has its own 6 vertices */
+static void _meshSoup( SceneMesh& mesh, size_t n, float jitter )
+{
+	std::vector<Vector3f> vertices;
+	std::vector<Vector3f> normals;
+	std::vector<unsigned int> faces;
+	const size_t quad[ 6 ][ 2 ] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 1, 1 }, { 0, 1 }, { 0, 0 } };
+
+	for( size_t y = 0; y < n; y++ ) {
+		for( size_t x = 0; x < n; x++ ) {
+			for( size_t k = 0; k < 6; k++ ) {
+				Vector3f v( ( float ) ( x + quad[ k ][ 0 ] ), ( float ) ( y + quad[ k ][ 1 ] ), 0.0f );
+				if( jitter > 0.0f ) {
+					v.x += Math::rand( -jitter, jitter );
+					v.y += Math::rand( -jitter, jitter );
+				}
+				faces.push_back( vertices.size() );
+				vertices.push_back( v );
+				normals.push_back( Vector3f( 0.0f, 0.0f, 1.0f ) );
+			}
+		}
+	}
+
+	/* flip the normal of one corner */
+	normals[ 2 ].set( 0.0f, 0.0f, -1.0f );
+
+	mesh.clear();
+	mesh.setVertices( &vertices[ 0 ], vertices.size() );
+	mesh.setNormals( &normals[ 0 ], normals.size() );
+	mesh.setFaces( &faces[ 0 ], faces.size(), SCENEMESH_TRIANGLES );
+}
+
+static bool _meshFacesValid( const SceneMesh& mesh, float epsilon )
+{
+	const unsigned int* faces = mesh.faces();
+	for( size_t i = 0; i < mesh.faceSize() * 3; i++ ) {
+		if( faces[ i ] >= mesh.vertexSize() )
+			return false;
+	}
+	/* the faces must still span unit quads */
+	for( size_t f = 0; f < mesh.faceSize(); f++ ) {
+		const Vector3f& a = mesh.vertex( faces[ 3 * f ] );
+		const Vector3f& b = mesh.vertex( faces[ 3 * f + 1 ] );
+		if( Math::abs( ( a - b ).length() - 1.0f ) > 4.0f * epsilon )
+			return false;
+	}
+	return true;
+}
+
+/* closed two-manifold: every edge is shared by exactly two faces with opposite orientation */
+static bool _meshClosedManifold( const SceneMesh& mesh )
+{
+	std::map<std::pair<unsigned int, unsigned int>, int> edges;
+	const unsigned int* faces = mesh.faces();
+	for( size_t f = 0; f < mesh.faceSize(); f++ ) {
+		for( int k = 0; k < 3; k++ ) {
+			unsigned int a = faces[ 3 * f + k ];
+			unsigned int b = faces[ 3 * f + ( k + 1 ) % 3 ];
+			if( a == b || ++edges[ std::make_pair( a, b ) ] != 1 )
+				return false;
+		}
+	}
+	for( std::map<std::pair<unsigned int, unsigned int>, int>::const_iterator it = edges.begin(); it != edges.end(); ++it ) {
+		if( edges.find( std::make_pair( it->first.second, it->first.first ) ) == edges.end() )
+			return false;
+	}
+	return ( long ) mesh.vertexSize() - ( long ) edges.size() / 2 + ( long ) mesh.faceSize() == 2;
+}
+
+BEGIN_CVTTEST( SceneMesh )
+	bool ret = true;
+	bool b;
+	SceneMesh mesh( "test" );
+	const size_t n = 200;
+
+	_meshSoup( mesh, n, 0.0f );
+	mesh.removeRedundancy( 0.0f, 0.0f, 0.0f );
+	/* the vertex with the flipped normal stays separate */
+	b = mesh.vertexSize() == ( n + 1 ) * ( n + 1 ) + 1 && mesh.normalSize() == mesh.vertexSize();
+	b &= mesh.faceSize() == 2 * n * n && _meshFacesValid( mesh, 0.0f );
+	CVTTEST_PRINT( "removeRedundancy exact", b );
+	ret &= b;
+
+	_meshSoup( mesh, n, 0.0f );
+	mesh.removeRedundancy( 0.0f, 2.0f, 0.0f );
+	b = mesh.vertexSize() == ( n + 1 ) * ( n + 1 ) && _meshFacesValid( mesh, 0.0f );
+	CVTTEST_PRINT( "removeRedundancy normal epsilon", b );
+	ret &= b;
+
+	_meshSoup( mesh, n, 1e-4f );
+	mesh.removeRedundancy( 1e-3f, 2.0f, 0.0f );
+	b = mesh.vertexSize() == ( n + 1 ) * ( n + 1 ) && _meshFacesValid( mesh, 1e-3f );
+	CVTTEST_PRINT( "removeRedundancy position epsilon", b );
+	ret &= b;
+
+	/* no transitive chains, 1.2 is further than epsilon from the representative 0 */
+	Vector3f line[ 3 ] = { Vector3f( 0.0f, 0.0f, 0.0f ), Vector3f( 0.6f, 0.0f, 0.0f ), Vector3f( 1.2f, 0.0f, 0.0f ) };
+	unsigned int lineface[ 3 ] = { 0, 1, 2 };
+	mesh.clear();
+	mesh.setVertices( line, 3 );
+	mesh.setFaces( lineface, 3, SCENEMESH_TRIANGLES );
+	mesh.removeRedundancy( 1.0f, 0.0f, 0.0f );
+	b = mesh.vertexSize() == 2 && mesh.faces()[ 1 ] == 0 && mesh.faces()[ 2 ] == 1;
+	CVTTEST_PRINT( "removeRedundancy no chaining", b );
+	ret &= b;
+
+	_meshSoup( mesh, n, 0.0f );
+	mesh.simplify( 0.0f );
+	b = mesh.vertexSize() == ( n + 1 ) * ( n + 1 ) && mesh.faceSize() == 2 * n * n;
+	CVTTEST_PRINT( "simplify", b );
+	ret &= b;
+
+	/* clustering with epsilon 1 merges neighbours into their representative and removes collapsed
+	   faces, the counts are those of greedy clustering in vertex order */
+	_meshSoup( mesh, n, 0.0f );
+	mesh.simplify( 1.0f );
+	b = mesh.vertexSize() == 10101 && mesh.faceSize() == 19801;
+	for( size_t f = 0; f < mesh.faceSize() && b; f++ ) {
+		const unsigned int* face = mesh.faces() + 3 * f;
+		b = face[ 0 ] != face[ 1 ] && face[ 1 ] != face[ 2 ] && face[ 0 ] != face[ 2 ];
+	}
+	CVTTEST_PRINT( "simplify clustering", b );
+	ret &= b;
+
+	/* decimate a marching cubes sphere */
+	const size_t dim = 64;
+	const float radius = 25.0f;
+	std::vector<float> vol( dim * dim * dim );
+	for( size_t z = 0; z < dim; z++ )
+		for( size_t y = 0; y < dim; y++ )
+			for( size_t x = 0; x < dim; x++ )
+				vol[ ( z * dim + y ) * dim + x ] = ( Vector3f( ( float ) x, ( float ) y, ( float ) z ) - Vector3f( 31.5f, 31.5f, 31.5f ) ).length() - radius;
+	MarchingCubes mc( &vol[ 0 ], dim, dim, dim );
+	mc.triangulate( mesh );
+	size_t nfaces = mesh.faceSize();
+	mesh.decimate( nfaces / 10 );
+	b = mesh.faceSize() <= nfaces / 10 && mesh.faceSize() > nfaces / 20 && _meshClosedManifold( mesh );
+	for( size_t i = 0; i < mesh.vertexSize() && b; i++ )
+		b = Math::abs( ( mesh.vertex( i ) - Vector3f( 31.5f, 31.5f, 31.5f ) ).length() - radius ) < 0.25f;
+	CVTTEST_PRINT( "decimate sphere", b );
+	ret &= b;
+
+	/* a plane is reduced with zero error, the boundary is kept */
+	_meshSoup( mesh, 32, 0.0f );
+	mesh.removeRedundancy( 0.0f, 2.0f, 0.0f );
+	mesh.decimate( 0, 1e-6f );
+	b = mesh.faceSize() > 0 && mesh.faceSize() < 2 * 32 * 32 / 4;
+	size_t border = 0;
+	for( size_t i = 0; i < mesh.vertexSize(); i++ ) {
+		const Vector3f& v = mesh.vertex( i );
+		b &= v.z == 0.0f;
+		if( v.x == 0.0f || v.y == 0.0f || v.x == 32.0f || v.y == 32.0f )
+			border++;
+	}
+	b &= border == 4 * 32;
+	CVTTEST_PRINT( "decimate plane", b );
+	ret &= b;
+
+	return ret;
+END_CVTTEST
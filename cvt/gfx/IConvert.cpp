@@ -25,6 +25,7 @@
 #include <cvt/gfx/IConvert.h>
 #include <cvt/gfx/Image.h>
 #include <cvt/util/SIMD.h>
+#include <cvt/util/ParallelFor.h>
 
 namespace cvt {
 
@@ -35,16 +36,53 @@ namespace cvt {
     IConvert* IConvert::_instance = 0;
 
 
+    /* convert the image line by line, bands of lines are converted in parallel */
+    template<typename DSTTYPE, typename SRCTYPE>
+    class ConvLinesBody {
+        public:
+            typedef void ( SIMD::*ConvFunc )( DSTTYPE*, const SRCTYPE*, const size_t ) const;
+
+            ConvLinesBody( ConvFunc func, uint8_t* dst, size_t dstride, const uint8_t* src, size_t sstride, size_t width ) :
+                _func( func ), _dst( dst ), _dstride( dstride ), _src( src ), _sstride( sstride ), _width( width )
+            {
+            }
+
+            void operator()( const Range<size_t>& range ) const
+            {
+                SIMD* simd = SIMD::instance();
+                const uint8_t* src = _src + _sstride * range.min;
+                uint8_t* dst = _dst + _dstride * range.min;
+                size_t h = range.max - range.min;
+                while( h-- ) {
+                    ( simd->*_func )( ( DSTTYPE* ) dst, ( const SRCTYPE* ) src, _width );
+                    src += _sstride;
+                    dst += _dstride;
+                }
+            }
+
+        private:
+            ConvFunc        _func;
+            uint8_t*        _dst;
+            size_t          _dstride;
+            const uint8_t*  _src;
+            size_t          _sstride;
+            size_t          _width;
+    };
+
+    template<typename DSTTYPE, typename SRCTYPE>
+    static inline void convLines( void ( SIMD::*func )( DSTTYPE*, const SRCTYPE*, const size_t ) const,
+                                  uint8_t* dst, size_t dstride, const uint8_t* src, size_t sstride, size_t height, size_t width )
+    {
+        ConvLinesBody<DSTTYPE, SRCTYPE> body( func, dst, dstride, src, sstride, width );
+        /* a few thousand pixels per task at least */
+        parallelFor( Range<size_t>( 0, height ), body, Math::max<size_t>( 16384 / ( width + 1 ), height / ( 4 * ThreadPool::instance().concurrency() ) ) );
+    }
+
     #define CONV( func, dI, dsttype, sI, srctype, width )				\
     {																	\
-        sbase = src = sI.map( &sstride );								\
-        dbase = dst = dI.map( &dstride );								\
-        h = sI.height();												\
-        while( h-- ) {													\
-            simd->func( ( dsttype ) dst, ( const srctype ) src, width );\
-            src += sstride;												\
-            dst += dstride;												\
-        }																\
+        sbase = sI.map( &sstride );										\
+        dbase = dI.map( &dstride );										\
+        convLines( &SIMD::func, dbase, dstride, sbase, sstride, sI.height(), width ); \
         sI.unmap( sbase );												\
         dI.unmap( dbase );												\
         return;															\
@@ -52,147 +90,103 @@ namespace cvt {
 
     static void Conv_XYZAf_to_ZYXAf( Image & dstImage, const Image & sourceImage, IConvertFlags )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
         const uint8_t* sbase;
         size_t sstride;
         size_t dstride;
-        uint8_t* dst;
         uint8_t* dbase;
-        size_t h;
         CONV( Conv_XYZAf_to_ZYXAf, dstImage, float*, sourceImage, float*, sourceImage.width() )
     }
 
     static void Conv_XYZAu8_to_ZYXAu8( Image & dstImage, const Image & sourceImage, IConvertFlags )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
         const uint8_t* sbase;
         size_t sstride;
         size_t dstride;
-        uint8_t* dst;
         uint8_t* dbase;
-        size_t h;
         CONV( Conv_XYZAu8_to_ZYXAu8, dstImage, uint8_t*, sourceImage, uint8_t*, sourceImage.width() )
     }
 
     static void Conv_u8_to_f( Image & dstImage, const Image & sourceImage, IConvertFlags )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
         const uint8_t* sbase;
         size_t sstride;
         size_t dstride;
-        uint8_t* dst;
         uint8_t* dbase;
-        size_t h;
         CONV( Conv_u8_to_f, dstImage, float*, sourceImage, uint8_t*, sourceImage.width() * dstImage.channels() )
     }
 
     static void Conv_u16_to_u8( Image& dstImage, const Image& sourceImage, IConvertFlags )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
         const uint8_t* sbase;
         size_t sstride;
         size_t dstride;
-        uint8_t* dst;
         uint8_t* dbase;
-        size_t h;
         CONV( Conv_u16_to_u8, dstImage, uint8_t*, sourceImage, uint16_t*, sourceImage.width() * dstImage.channels() )
     }
     static void Conv_u16_to_XXXAu8( Image& dstImage, const Image& sourceImage, IConvertFlags )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
         const uint8_t* sbase;
         size_t sstride;
         size_t dstride;
-        uint8_t* dst;
         uint8_t* dbase;
-        size_t h;
         CONV( Conv_u16_to_XXXAu8, dstImage, uint8_t*, sourceImage, uint16_t*, sourceImage.width() )
     }
 
     static void Conv_u16_to_f( Image & dstImage, const Image & sourceImage, IConvertFlags )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
         const uint8_t* sbase;
         size_t sstride;
         size_t dstride;
-        uint8_t* dst;
         uint8_t* dbase;
-        size_t h;
         CONV( Conv_u16_to_f, dstImage, float*, sourceImage, uint16_t*, sourceImage.width() * dstImage.channels() )
     }
 
     static void Conv_f_to_u8( Image & dstImage, const Image & sourceImage, IConvertFlags )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
         const uint8_t* sbase;
         size_t sstride;
         size_t dstride;
-        uint8_t* dst;
         uint8_t* dbase;
-        size_t h;
 
         CONV( Conv_f_to_u8, dstImage, uint8_t*, sourceImage, float*, sourceImage.width() * dstImage.channels() )
     }
 
     static void Conv_f_to_u16( Image & dstImage, const Image & sourceImage, IConvertFlags )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
         const uint8_t* sbase;
         size_t sstride;
         size_t dstride;
-        uint8_t* dst;
         uint8_t* dbase;
-        size_t h;
 
         CONV( Conv_f_to_u16, dstImage, uint16_t*, sourceImage, float*, sourceImage.width() * dstImage.channels() )
     }
 
     static void Conv_s16_to_u8( Image & dstImage, const Image & sourceImage, IConvertFlags )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
         const uint8_t* sbase;
         size_t sstride;
         size_t dstride;
-        uint8_t* dst;
         uint8_t* dbase;
-        size_t h;
 
         CONV( Conv_s16_to_u8, dstImage, uint8_t*, sourceImage, int16_t*, sourceImage.width() * dstImage.channels() )
     }
 
     static void Conv_GRAYf_to_GRAYu8( Image & dstImage, const Image & sourceImage, IConvertFlags )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
         const uint8_t* sbase;
         size_t sstride;
         size_t dstride;
-        uint8_t* dst;
         uint8_t* dbase;
-        size_t h;
 
         CONV( Conv_GRAYf_to_GRAYu8, dstImage, uint8_t*, sourceImage, float*, sourceImage.width() * dstImage.channels() )
     }
 
     static void Conv_GRAYALPHAf_to_GRAYf( Image & dstImage, const Image & sourceImage, IConvertFlags )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
         const uint8_t* sbase;
         size_t sstride;
         size_t dstride;
-        uint8_t* dst;
         uint8_t* dbase;
-        size_t h;
 
         CONV( Conv_GRAYALPHAf_to_GRAYf, dstImage, float*, sourceImage, float*, sourceImage.width() )
     }
@@ -200,14 +194,10 @@ namespace cvt {
 
     static void Conv_GRAYf_to_XXXAf( Image & dstImage, const Image & sourceImage, IConvertFlags )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
         const uint8_t* sbase;
         size_t sstride;
         size_t dstride;
-        uint8_t* dst;
         uint8_t* dbase;
-        size_t h;
 
         CONV( Conv_GRAYf_to_XXXAf, dstImage, float*, sourceImage, float*, sourceImage.width() )
     }
@@ -215,112 +205,80 @@ namespace cvt {
 
     static void Conv_RGBAu8_to_GRAYf( Image & dstImage, const Image & sourceImage, IConvertFlags )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
         const uint8_t* sbase;
         size_t sstride;
         size_t dstride;
-        uint8_t* dst;
         uint8_t* dbase;
-        size_t h;
 
         CONV( Conv_RGBAu8_to_GRAYf, dstImage, float*, sourceImage, uint8_t*, sourceImage.width() )
     }
 
     static void Conv_GRAYu8_to_XXXAu8( Image & dstImage, const Image & sourceImage, IConvertFlags )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
         const uint8_t* sbase;
         size_t sstride;
         size_t dstride;
-        uint8_t* dst;
         uint8_t* dbase;
-        size_t h;
 
         CONV( Conv_GRAYu8_to_XXXAu8, dstImage, uint8_t*, sourceImage, uint8_t*, sourceImage.width() )
     }
 
     static void Conv_XXXAu8_to_XXXAf( Image & dstImage, const Image & sourceImage, IConvertFlags )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
         const uint8_t* sbase;
         size_t sstride;
         size_t dstride;
-        uint8_t* dst;
         uint8_t* dbase;
-        size_t h;
 
         CONV( Conv_XXXAu8_to_XXXAf, dstImage, float*, sourceImage, uint8_t*, sourceImage.width() )
     }
 
     static void Conv_XXXAf_to_XXXAu8( Image & dstImage, const Image & sourceImage, IConvertFlags )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
         const uint8_t* sbase;
         size_t sstride;
         size_t dstride;
-        uint8_t* dst;
         uint8_t* dbase;
-        size_t h;
 
         CONV( Conv_XXXAf_to_XXXAu8, dstImage, uint8_t*, sourceImage, float*, sourceImage.width() )
     }
 
     static void Conv_XYZAu8_to_ZYXAf( Image & dstImage, const Image & sourceImage, IConvertFlags )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
         const uint8_t* sbase;
         size_t sstride;
         size_t dstride;
-        uint8_t* dst;
         uint8_t* dbase;
-        size_t h;
 
         CONV( Conv_XYZAu8_to_ZYXAf, dstImage, float*, sourceImage, uint8_t*, sourceImage.width() )
     }
 
     static void Conv_XYZAf_to_ZYXAu8( Image & dstImage, const Image & sourceImage, IConvertFlags )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
         const uint8_t* sbase;
         size_t sstride;
         size_t dstride;
-        uint8_t* dst;
         uint8_t* dbase;
-        size_t h;
 
         CONV( Conv_XYZAf_to_ZYXAu8, dstImage, uint8_t*, sourceImage, float*, sourceImage.width() )
     }
 
     static void Conv_BGRAu8_to_GRAYu8( Image & dstImage, const Image & sourceImage, IConvertFlags )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
         const uint8_t* sbase;
         size_t sstride;
         size_t dstride;
-        uint8_t* dst;
         uint8_t* dbase;
-        size_t h;
 
         CONV( Conv_BGRAu8_to_GRAYu8, dstImage, uint8_t*, sourceImage, uint8_t*, sourceImage.width() )
     }
 
     static void Conv_RGBAu8_to_GRAYu8( Image & dstImage, const Image & sourceImage, IConvertFlags )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
         const uint8_t* sbase;
         size_t sstride;
         size_t dstride;
-        uint8_t* dst;
         uint8_t* dbase;
-        size_t h;
 
         CONV( Conv_RGBAu8_to_GRAYu8, dstImage, uint8_t*, sourceImage, uint8_t*, sourceImage.width() )
     }
@@ -328,42 +286,30 @@ namespace cvt {
 
     static void Conv_BGRAu8_to_GRAYf( Image & dstImage, const Image & sourceImage, IConvertFlags )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
         const uint8_t* sbase;
         size_t sstride;
         size_t dstride;
-        uint8_t* dst;
         uint8_t* dbase;
-        size_t h;
 
         CONV( Conv_BGRAu8_to_GRAYf, dstImage, float*, sourceImage, uint8_t*, sourceImage.width() )
     }
 
     static void Conv_BGRAf_to_GRAYf( Image & dstImage, const Image & sourceImage, IConvertFlags )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
         const uint8_t* sbase;
         size_t sstride;
         size_t dstride;
-        uint8_t* dst;
         uint8_t* dbase;
-        size_t h;
 
         CONV( Conv_BGRAf_to_GRAYf, dstImage, float*, sourceImage, float*, sourceImage.width() )
     }
 
     static void Conv_RGBAf_to_GRAYf( Image & dstImage, const Image & sourceImage, IConvertFlags )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
         const uint8_t* sbase;
         size_t sstride;
         size_t dstride;
-        uint8_t* dst;
         uint8_t* dbase;
-        size_t h;
 
         CONV( Conv_RGBAf_to_GRAYf, dstImage, float*, sourceImage, float*, sourceImage.width() )
     }
@@ -371,56 +317,40 @@ namespace cvt {
 
     static void Conv_YUYVu8_to_RGBAu8( Image & dstImage, const Image & sourceImage, IConvertFlags )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
         const uint8_t* sbase;
         size_t sstride;
         size_t dstride;
-        uint8_t* dst;
         uint8_t* dbase;
-        size_t h;
 
         CONV( Conv_YUYVu8_to_RGBAu8, dstImage, uint8_t*, sourceImage, uint8_t*, sourceImage.width() )
     }
 
     static void Conv_YUYVu8_to_BGRAu8( Image & dstImage, const Image & sourceImage, IConvertFlags )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
         const uint8_t* sbase;
         size_t sstride;
         size_t dstride;
-        uint8_t* dst;
         uint8_t* dbase;
-        size_t h;
 
         CONV( Conv_YUYVu8_to_BGRAu8, dstImage, uint8_t*, sourceImage, uint8_t*, sourceImage.width() )
     }
 
     static void Conv_UYVYu8_to_RGBAu8( Image & dstImage, const Image & sourceImage, IConvertFlags )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
         const uint8_t* sbase;
         size_t sstride;
         size_t dstride;
-        uint8_t* dst;
         uint8_t* dbase;
-        size_t h;
 
         CONV( Conv_UYVYu8_to_RGBAu8, dstImage, uint8_t*, sourceImage, uint8_t*, sourceImage.width() )
     }
 
     static void Conv_UYVYu8_to_BGRAu8( Image & dstImage, const Image & sourceImage, IConvertFlags )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
         const uint8_t* sbase;
         size_t sstride;
         size_t dstride;
-        uint8_t* dst;
         uint8_t* dbase;
-        size_t h;
 
         CONV( Conv_UYVYu8_to_BGRAu8, dstImage, uint8_t*, sourceImage, uint8_t*, sourceImage.width() )
     }
@@ -428,28 +358,20 @@ namespace cvt {
 
     static void Conv_UYVYu8_to_GRAYu8( Image & dstImage, const Image & sourceImage, IConvertFlags )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
         const uint8_t* sbase;
         size_t sstride;
         size_t dstride;
-        uint8_t* dst;
         uint8_t* dbase;
-        size_t h;
 
         CONV( Conv_UYVYu8_to_GRAYu8, dstImage, uint8_t*, sourceImage, uint8_t*, sourceImage.width() )
     }
 
     static void Conv_UYVYu8_to_GRAYf( Image & dstImage, const Image & sourceImage, IConvertFlags )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
         const uint8_t* sbase;
         size_t sstride;
         size_t dstride;
-        uint8_t* dst;
         uint8_t* dbase;
-        size_t h;
 
         CONV( Conv_UYVYu8_to_GRAYf, dstImage, float*, sourceImage, uint8_t*, sourceImage.width() )
     }
@@ -458,56 +380,40 @@ namespace cvt {
 
     static void Conv_UYVYu8_to_GRAYALPHAu8( Image & dstImage, const Image & sourceImage, IConvertFlags )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
         const uint8_t* sbase;
         size_t sstride;
         size_t dstride;
-        uint8_t* dst;
         uint8_t* dbase;
-        size_t h;
 
         CONV( Conv_UYVYu8_to_GRAYALPHAu8, dstImage, uint8_t*, sourceImage, uint8_t*, sourceImage.width() )
     }
 
     static void Conv_YUYVu8_to_GRAYu8( Image & dstImage, const Image & sourceImage, IConvertFlags )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
         const uint8_t* sbase;
         size_t sstride;
         size_t dstride;
-        uint8_t* dst;
         uint8_t* dbase;
-        size_t h;
 
         CONV( Conv_YUYVu8_to_GRAYu8, dstImage, uint8_t*, sourceImage, uint8_t*, sourceImage.width() )
     }
 
     static void Conv_YUYVu8_to_GRAYALPHAu8( Image & dstImage, const Image & sourceImage, IConvertFlags )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
         const uint8_t* sbase;
         size_t sstride;
         size_t dstride;
-        uint8_t* dst;
         uint8_t* dbase;
-        size_t h;
 
         CONV( Conv_YUYVu8_to_GRAYALPHAu8, dstImage, uint8_t*, sourceImage, uint8_t*, sourceImage.width() )
     }
 
     static void Conv_YUYVu8_to_GRAYf( Image & dstImage, const Image & sourceImage, IConvertFlags )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
         const uint8_t* sbase;
         size_t sstride;
         size_t dstride;
-        uint8_t* dst;
         uint8_t* dbase;
-        size_t h;
 
         CONV( Conv_YUYVu8_to_GRAYf, dstImage, float*, sourceImage, uint8_t*, sourceImage.width() )
     }
@@ -28,10 +28,91 @@
 #include <cvt/gfx/IBorder.h>
 #include <cvt/util/SIMD.h>
 #include <cvt/util/ScopedBuffer.h>
+#include <cvt/util/ParallelFor.h>
 
 namespace cvt {
 
-	/* general template use for separable convolution ( except the constant border case ) */
+	size_t IConvolve::_tileHeight = 0;
+
+	/*
+	   band [ range.min, range.max ) of the separable convolution: the ring buffer of horizontally
+	   filtered rows is initialized with the halo rows above the band, so every band produces exactly
+	   the same rows as a single sweep over the whole image
+	 */
+	template<typename DSTTYPE, typename SRCTYPE, typename BUFTYPE, typename KERNTYPE>
+	class ConvolveSeparableBandBody {
+		public:
+			typedef void ( SIMD::*HConvFunc )( BUFTYPE*, const SRCTYPE*, size_t, const KERNTYPE* , size_t, IBorderType type ) const;
+			typedef void ( SIMD::*VConvFunc )( DSTTYPE*, const BUFTYPE**, const KERNTYPE* , size_t, size_t ) const;
+
+			ConvolveSeparableBandBody( uint8_t* dst, size_t dstride, const uint8_t* src, size_t sstride, ssize_t w, ssize_t h, size_t channels,
+									   const KERNTYPE* hkern, size_t kw, const KERNTYPE* vkern, size_t kh, HConvFunc hconv, VConvFunc vconv, IBorderType btype ) :
+				_dst( dst ), _dstride( dstride ), _src( src ), _sstride( sstride ), _w( w ), _h( h ), _channels( channels ),
+				_hkern( hkern ), _kw( kw ), _vkern( vkern ), _kh( kh ), _hconv( hconv ), _vconv( vconv ), _btype( btype )
+			{
+			}
+
+			void operator()( const Range<size_t>& range ) const
+			{
+				SIMD* simd = SIMD::instance();
+				size_t widthchannels = _w * _channels;
+				size_t bstride = Math::pad16( sizeof( BUFTYPE ) * widthchannels ) / sizeof( BUFTYPE ); //FIXME: does this always work - it should
+				BUFTYPE** buf;
+				ssize_t cy = range.min;
+
+				ssize_t b1 = ( _kh >> 1 );
+				ssize_t b2 = _kh - b1 - 1;
+
+				/* allocate buffers and fill buffer*/
+				ScopedBuffer<BUFTYPE,true> bufmem( bstride * _kh );
+				ScopedBuffer<BUFTYPE*,true> bufptr( _kh );
+
+				buf = bufptr.ptr();
+				buf[ 0 ] = bufmem.ptr();
+				for( size_t i = 1; i < _kh; i++ )
+					buf[ i ] = buf[ i - 1 ] + bstride;
+
+				/* halo rows and first line of the band */
+				for( ssize_t k = -b1; k <= b2; k++ ) {
+					( simd->*_hconv )( buf[ k + b1 ], line( cy + k ), _w, _hkern, _kw, _btype );
+				}
+				( simd->*_vconv )( ( DSTTYPE* ) ( _dst + _dstride * cy ), ( const BUFTYPE** ) buf, _vkern, _kh, widthchannels );
+
+				for( cy++; cy < ( ssize_t ) range.max; cy++ ) {
+					BUFTYPE* tmp = buf[ 0 ];
+					for( size_t k = 0; k < _kh - 1; k++ )
+						buf[ k ] = buf[ k + 1 ];
+					buf[ _kh - 1 ] = tmp;
+					( simd->*_hconv )( tmp, line( cy + b2 ), _w, _hkern, _kw, _btype );
+					( simd->*_vconv )( ( DSTTYPE* ) ( _dst + _dstride * cy ), ( const BUFTYPE** ) buf, _vkern, _kh, widthchannels );
+				}
+			}
+
+		private:
+			const SRCTYPE* line( ssize_t y ) const
+			{
+				if( y < 0 || y >= _h )
+					y = IBorder::value( y, _h, _btype );
+				return ( const SRCTYPE* ) ( _src + _sstride * y );
+			}
+
+			uint8_t*		_dst;
+			size_t			_dstride;
+			const uint8_t*	_src;
+			size_t			_sstride;
+			ssize_t			_w;
+			ssize_t			_h;
+			size_t			_channels;
+			const KERNTYPE*	_hkern;
+			size_t			_kw;
+			const KERNTYPE*	_vkern;
+			size_t			_kh;
+			HConvFunc		_hconv;
+			VConvFunc		_vconv;
+			IBorderType		_btype;
+	};
+
+	/* general template use for separable convolution ( except the constant border case ), horizontal bands are processed in parallel */
 	template<typename DSTTYPE, typename SRCTYPE, typename BUFTYPE, typename KERNTYPE>
 	static void convolveSeparableTemplate( Image& dst, const Image& src, const KERNTYPE* hkern, size_t kw, const KERNTYPE* vkern, size_t kh,
 										   void ( SIMD::*hconv )( BUFTYPE*, const SRCTYPE*, size_t, const KERNTYPE* , size_t, IBorderType type ) const,
@@ -39,67 +120,84 @@ namespace cvt {
 										   IBorderType btype
 										 )
 	{
-		SIMD* simd = SIMD::instance();
-		ssize_t w = src.width();
-		ssize_t h = src.height();
-		size_t widthchannels = w * src.channels();
-		size_t bstride = Math::pad16( sizeof( BUFTYPE ) * widthchannels ) / sizeof( BUFTYPE ); //FIXME: does this always work - it should
-		BUFTYPE** buf;
-		ssize_t cy;
-
-		IMapScoped<DSTTYPE> mapdst( dst );
-		IMapScoped<const SRCTYPE> mapsrc( src );
-
-		ssize_t b1 = ( kh >> 1 );
-		ssize_t b2 = kh - b1 - 1;
-
-		/* allocate buffers and fill buffer*/
-		ScopedBuffer<BUFTYPE,true> bufmem( bstride * kh );
-		ScopedBuffer<BUFTYPE*,true> bufptr( kh );
-
-		buf = bufptr.ptr();
-		buf[ 0 ] = bufmem.ptr();
-		for( size_t i = 1; i < kh; i++ )
-			buf[ i ] = buf[ i - 1 ] + bstride;
-
-		for( ssize_t k = -b1; k <= b2; k++ ) {
-			ssize_t y = IBorder::value( k, h, btype );
-			( simd->*hconv )( buf[ k + b1 ], mapsrc.line( y ), w, hkern, kw, btype );
-		}
-		/* process first line */
-		( simd->*vconv )( mapdst.ptr(), ( const BUFTYPE** ) buf, vkern, kh, widthchannels );
-		mapdst++;
-
-		mapsrc.setLine( b2 + 1 );
-		/* main part */
-		for( cy = 1; cy < h - b2; cy++ )
-		{
-				BUFTYPE* tmp = buf[ 0 ];
-				for( size_t k = 0; k < kh - 1; k++ )
-					buf[ k ] = buf[ k + 1 ];
-				buf[ kh - 1 ] = tmp;
-				( simd->*hconv )( tmp, mapsrc.ptr(), w, hkern, kw, btype );
-				( simd->*vconv )( mapdst.ptr(), ( const BUFTYPE** ) buf, vkern, kh, widthchannels );
-				mapdst++;
-				mapsrc++;
-
-		}
+		size_t sstride, dstride;
+		uint8_t* pdst = dst.map( &dstride );
+		const uint8_t* psrc = src.map( &sstride );
+		size_t h = src.height();
+
+		ConvolveSeparableBandBody<DSTTYPE, SRCTYPE, BUFTYPE, KERNTYPE> body( pdst, dstride, psrc, sstride, src.width(), h, src.channels(),
+																			 hkern, kw, vkern, kh, hconv, vconv, btype );
+
+		/* every band recomputes kh - 1 halo rows, keep the bands large compared to the kernel */
+		size_t band = IConvolve::tileHeight();
+		if( !band )
+			band = Math::max<size_t>( 8 * kh, ( h + ThreadPool::instance().concurrency() - 1 ) / ThreadPool::instance().concurrency() );
+		parallelFor( Range<size_t>( 0, h ), body, band );
+
+		src.unmap( psrc );
+		dst.unmap( pdst );
+	}
 
-		/* lower border */
-		for( ; cy < h; cy++ ) {
-			BUFTYPE* tmp = buf[ 0 ];
-			for( size_t k = 0; k < kh - 1; k++ )
-				buf[ k ] = buf[ k + 1 ];
-			buf[ kh - 1 ] = tmp;
-			ssize_t y = IBorder::value( cy + b2, h, btype );
-			( simd->*hconv )( tmp, mapsrc.line( y ), w, hkern, kw, btype );
-			( simd->*vconv )( mapdst.ptr(), ( const BUFTYPE** ) buf, vkern, kh, widthchannels );
-			mapdst++;
-		}
+	/* rows [ range.min, range.max ) of the general 2D convolution, every band uses its own line buffers */
+	template<typename DSTTYPE, typename SRCTYPE, typename BUFTYPE, typename KERNTYPE>
+	class ConvolveRowsBody {
+		public:
+			typedef void ( SIMD::*ConvFunc )( BUFTYPE*, const SRCTYPE*, size_t, const KERNTYPE* , size_t, IBorderType type ) const;
+			typedef void ( SIMD::*AvgFunc )( DSTTYPE*, const BUFTYPE**, size_t, size_t ) const;
+
+			ConvolveRowsBody( uint8_t* dst, size_t dstride, const uint8_t* src, size_t sstride, ssize_t w, ssize_t h, size_t channels,
+							  const KERNTYPE* kern, ssize_t kw, ssize_t kh, ConvFunc conv, AvgFunc avg, IBorderType btype ) :
+				_dst( dst ), _dstride( dstride ), _src( src ), _sstride( sstride ), _w( w ), _h( h ), _channels( channels ),
+				_kern( kern ), _kw( kw ), _kh( kh ), _conv( conv ), _avg( avg ), _btype( btype )
+			{
+			}
 
-	}
+			void operator()( const Range<size_t>& range ) const
+			{
+				SIMD* simd = SIMD::instance();
+				size_t widthchannels = _w * _channels;
+				size_t bstride = Math::pad16( sizeof( BUFTYPE ) * widthchannels ) / sizeof( BUFTYPE ); //FIXME: does this always work - it should
+				BUFTYPE** buf;
+
+				ssize_t b1 = ( _kh >> 1 );
+				ssize_t b2 = _kh - b1 - 1;
+
+				/* allocate buffers */
+				ScopedBuffer<BUFTYPE,true> bufmem( bstride * _kh );
+				ScopedBuffer<BUFTYPE*,true> bufptr( _kh );
+
+				buf = bufptr.ptr();
+				buf[ 0 ] = bufmem.ptr();
+				for( ssize_t i = 1; i < _kh; i++ )
+					buf[ i ] = buf[ i - 1 ] + bstride;
+
+				for( ssize_t cy = range.min; cy < ( ssize_t ) range.max; cy++ ) {
+					bool border = cy < b1 || cy >= _h - b2;
+					for( ssize_t k = 0; k < _kh; k++ ) {
+						ssize_t y = border ? IBorder::value( cy - b1 + k, _h, _btype ) : cy - b1 + k;
+						( simd->*_conv )( buf[ k ], ( const SRCTYPE* ) ( _src + _sstride * y ), _w, _kern + _kw * k, _kw, _btype );
+					}
+					( simd->*_avg )( ( DSTTYPE* ) ( _dst + _dstride * cy ), ( const BUFTYPE** ) buf, _kh, widthchannels );
+				}
+			}
 
-	/* general template use for convolution ( except the constant border case ) */
+		private:
+			uint8_t*		_dst;
+			size_t			_dstride;
+			const uint8_t*	_src;
+			size_t			_sstride;
+			ssize_t			_w;
+			ssize_t			_h;
+			size_t			_channels;
+			const KERNTYPE*	_kern;
+			ssize_t			_kw;
+			ssize_t			_kh;
+			ConvFunc		_conv;
+			AvgFunc			_avg;
+			IBorderType		_btype;
+	};
+
+	/* general template use for convolution ( except the constant border case ), the rows are processed in parallel */
 	template<typename DSTTYPE, typename SRCTYPE, typename BUFTYPE, typename KERNTYPE>
 	static void convolveTemplate( Image& dst, const Image& src, const KERNTYPE* kern, ssize_t kw, ssize_t kh,
 										   void ( SIMD::*conv )( BUFTYPE*, const SRCTYPE*, size_t, const KERNTYPE* , size_t, IBorderType type ) const,
@@ -107,60 +205,16 @@ namespace cvt {
 										   IBorderType btype
 										 )
 	{
-		SIMD* simd = SIMD::instance();
-		ssize_t w = src.width();
-		ssize_t h = src.height();
-		size_t widthchannels = w * src.channels();
-		size_t bstride = Math::pad16( sizeof( BUFTYPE ) * widthchannels ) / sizeof( BUFTYPE ); //FIXME: does this always work - it should
-		BUFTYPE** buf;
-		ssize_t cy;
-
-		IMapScoped<DSTTYPE> mapdst( dst );
-		IMapScoped<const SRCTYPE> mapsrc( src );
-
-		ssize_t b1 = ( kh >> 1 );
-		ssize_t b2 = kh - b1 - 1;
-
-		/* allocate buffers and fill buffer*/
-		ScopedBuffer<BUFTYPE,true> bufmem( bstride * kh );
-		ScopedBuffer<BUFTYPE*,true> bufptr( kh );
-
-		buf = bufptr.ptr();
-		buf[ 0 ] = bufmem.ptr();
-		for( ssize_t i = 1; i < kh; i++ )
-			buf[ i ] = buf[ i - 1 ] + bstride;
-
-
-		/* upper border */
-		for( cy = 0; cy < b1; cy++ ) {
-			for( ssize_t k = 0; k < kh; k++ ) {
-				ssize_t y = IBorder::value( cy - b1 + k, h, btype );
-				( simd->*conv )( buf[ k ], mapsrc.line( y ), w, kern + kw * k, kw, btype );
-			}
-			( simd->*avg )( mapdst.ptr(), ( const BUFTYPE** ) buf, kh, widthchannels );
-			mapdst++;
-		}
-
-		/* main part */
-		for( ; cy < h - b2; cy++ )
-		{
-			for( ssize_t k = 0; k < kh; k++ ) {
-				( simd->*conv )( buf[ k ], mapsrc.line( cy - b1 + k ), w, kern + kw * k, kw, btype );
-			}
-			( simd->*avg )( mapdst.ptr(), ( const BUFTYPE** ) buf, kh, widthchannels );
-			mapdst++;
-		}
+		size_t sstride, dstride;
+		uint8_t* pdst = dst.map( &dstride );
+		const uint8_t* psrc = src.map( &sstride );
 
-		/* lower border */
-		for( ; cy < h; cy++ ) {
-			for( ssize_t k = 0; k < kh; k++ ) {
-				ssize_t y = IBorder::value( cy - b1 + k, h, btype );
-				( simd->*conv )( buf[ k ], mapsrc.line( y ), w, kern + kw * k, kw, btype );
-			}
-			( simd->*avg )( mapdst.ptr(), ( const BUFTYPE** ) buf, kh, widthchannels );
-			mapdst++;
-		}
+		ConvolveRowsBody<DSTTYPE, SRCTYPE, BUFTYPE, KERNTYPE> body( pdst, dstride, psrc, sstride, src.width(), src.height(), src.channels(),
+																	 kern, kw, kh, conv, avg, btype );
+		parallelFor( Range<size_t>( 0, src.height() ), body );
 
+		src.unmap( psrc );
+		dst.unmap( pdst );
 	}
 
 	void IConvolve::convolve( Image& dst, const Image& src, const IKernel& kernel, IBorderType btype, const Color& )
@@ -27,6 +27,7 @@
 
 #include <cvt/gfx/IBorder.h>
 #include <cvt/gfx/Color.h>
+#include <stdlib.h>
 
 namespace cvt
 {
@@ -38,10 +39,30 @@ namespace cvt
 			static void convolve( Image& dst, const Image& src, const IKernel& kernel, IBorderType btype = IBORDER_CLAMP, const Color& = Color::BLACK );
 			static void convolve( Image& dst, const Image& src, const IKernel& hkernel, const IKernel& vkernel, IBorderType btype = IBORDER_CLAMP, const Color& = Color::BLACK );
 
+			/*
+			   Maximal number of rows of the horizontal bands the separable convolution is split into.
+			   The bands are processed in parallel, 0 selects the height depending on the number of threads.
+			   The value is accessed atomically, it may be changed while other threads convolve.
+			 */
+			static void	  setTileHeight( size_t rows );
+			static size_t tileHeight();
+
 		private:
 			IConvolve() {}
 			IConvolve( const IConvolve& ) {}
+
+			static size_t _tileHeight;
 	};
+
+	inline void IConvolve::setTileHeight( size_t rows )
+	{
+		__atomic_store_n( &_tileHeight, rows, __ATOMIC_RELAXED );
+	}
+
+	inline size_t IConvolve::tileHeight()
+	{
+		return __atomic_load_n( &_tileHeight, __ATOMIC_RELAXED );
+	}
 }
 
 #endif
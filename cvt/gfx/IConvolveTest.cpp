@@ -0,0 +1,147 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/gfx/IConvolve.h>
+#include <cvt/gfx/Image.h>
+#include <cvt/gfx/IKernel.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/gfx/IBorder.h>
+#include <cvt/util/CVTTest.h>
+#include <cvt/util/CVTTestImage.h>
+#include <vector>
+
+using namespace cvt;
+
+/* straightforward separable convolution in double precision, independent of the SIMD kernels */
+static void _referenceConvolve( std::vector<double>& dst, const Image& src, const IKernel& hkernel, const IKernel& vkernel, IBorderType btype )
+{
+	ssize_t w = src.width();
+	ssize_t h = src.height();
+	ssize_t c = src.channels();
+	ssize_t kw = hkernel.width();
+	ssize_t kh = vkernel.height();
+	std::vector<double> in( w * h * c );
+	std::vector<double> tmp( w * h * c );
+
+	IMapScoped<const uint8_t> map( src );
+	for( ssize_t y = 0; y < h; y++ ) {
+		for( ssize_t x = 0; x < w * c; x++ ) {
+			if( src.format().type == IFORMAT_TYPE_FLOAT )
+				in[ y * w * c + x ] = ( ( const float* ) map.ptr() )[ x ];
+			else
+				in[ y * w * c + x ] = map.ptr()[ x ];
+		}
+		map++;
+	}
+
+	for( ssize_t y = 0; y < h; y++ ) {
+		for( ssize_t x = 0; x < w; x++ ) {
+			for( ssize_t ch = 0; ch < c; ch++ ) {
+				double sum = 0;
+				for( ssize_t k = 0; k < kw; k++ ) {
+					ssize_t sx = IBorder::value<ssize_t>( x - ( kw >> 1 ) + k, w, btype );
+					sum += hkernel.ptr()[ k ] * in[ ( y * w + sx ) * c + ch ];
+				}
+				tmp[ ( y * w + x ) * c + ch ] = sum;
+			}
+		}
+	}
+
+	dst.resize( w * h * c );
+	for( ssize_t y = 0; y < h; y++ ) {
+		for( ssize_t x = 0; x < w * c; x++ ) {
+			double sum = 0;
+			for( ssize_t k = 0; k < kh; k++ ) {
+				ssize_t sy = IBorder::value<ssize_t>( y - ( kh >> 1 ) + k, h, btype );
+				sum += vkernel.ptr()[ k ] * tmp[ sy * w * c + x ];
+			}
+			dst[ y * w * c + x ] = sum;
+		}
+	}
+}
+
+/* float results have to match up to rounding, uint8 results up to the fixed-point precision of the uint8 path */
+static bool _compareReference( const Image& img, const std::vector<double>& ref )
+{
+	IMapScoped<const uint8_t> map( img );
+	size_t n = img.width() * img.channels();
+	for( size_t y = 0; y < img.height(); y++ ) {
+		for( size_t x = 0; x < n; x++ ) {
+			double r = ref[ y * n + x ];
+			if( img.format().type == IFORMAT_TYPE_FLOAT ) {
+				if( Math::abs( ( ( const float* ) map.ptr() )[ x ] - r ) > 1e-5 )
+					return false;
+			} else {
+				r = Math::clamp( r, 0.0, 255.0 );
+				if( Math::abs( ( double ) map.ptr()[ x ] - r ) > 1.0 )
+					return false;
+			}
+		}
+		map++;
+	}
+	return true;
+}
+
+static bool _tiledConvolveTest( const IFormat& format, const IKernel& hkernel, const IKernel& vkernel, IBorderType btype )
+{
+	Image src( 321, 203, format );
+	Image first( 321, 203, format );
+	Image out( 321, 203, format );
+	std::vector<double> ref;
+	bool ret = true;
+
+	testFillRandom( src );
+	_referenceConvolve( ref, src, hkernel, vkernel, btype );
+
+	/* every band height has to match the reference and produce bit-identical results */
+	size_t tiles[] = { 0, 1, 2, 7, 64, 203 };
+	for( size_t i = 0; i < sizeof( tiles ) / sizeof( tiles[ 0 ] ); i++ ) {
+		IConvolve::setTileHeight( tiles[ i ] );
+		IConvolve::convolve( i ? out : first, src, hkernel, vkernel, btype );
+		ret &= _compareReference( i ? out : first, ref );
+		if( i )
+			ret &= testEqualImages( first, out );
+	}
+	IConvolve::setTileHeight( 0 );
+	return ret;
+}
+
+BEGIN_CVTTEST( IConvolve )
+	bool result = true;
+	bool b;
+
+	b = _tiledConvolveTest( IFormat::GRAY_FLOAT, IKernel::GAUSS_HORIZONTAL_7, IKernel::GAUSS_VERTICAL_7, IBORDER_CLAMP );
+	CVTTEST_PRINT( "tiled separable convolution GRAY_FLOAT", b );
+	result &= b;
+
+	b = _tiledConvolveTest( IFormat::RGBA_FLOAT, IKernel::GAUSS_HORIZONTAL_5, IKernel::GAUSS_VERTICAL_5, IBORDER_MIRROR );
+	CVTTEST_PRINT( "tiled separable convolution RGBA_FLOAT", b );
+	result &= b;
+
+	b = _tiledConvolveTest( IFormat::GRAY_UINT8, IKernel::HAAR_HORIZONTAL_3, IKernel::GAUSS_VERTICAL_3, IBORDER_CLAMP );
+	CVTTEST_PRINT( "tiled separable convolution GRAY_UINT8", b );
+	result &= b;
+
+	return result;
+END_CVTTEST
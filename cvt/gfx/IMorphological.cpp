@@ -23,122 +23,360 @@
 */
 
 
-#include <cvt/gfx/IMapScoped.h>
+#include <cvt/gfx/IMorphological.h>
+#include <cvt/gfx/Image.h>
 #include <cvt/util/SIMD.h>
 #include <cvt/util/ScopedBuffer.h>
-#include <cvt/gfx/IMorphological.h>
+#include <cvt/util/ParallelFor.h>
+#include <cvt/util/ThreadPool.h>
+#include <cvt/util/Exception.h>
+#include <cvt/math/Math.h>
+
+#include <limits>
+#include <vector>
+#include <string.h>
 
 namespace cvt
 {
+	enum MorphMode {
+		MORPH_ERODE,
+		MORPH_DILATE,
+		MORPH_OPEN,
+		MORPH_CLOSE,
+		MORPH_TOPHAT,
+		MORPH_BLACKHAT
+	};
+
+	template<typename T> struct MorphLimits;
+
+	template<> struct MorphLimits<uint8_t> {
+		static uint8_t lowest()  { return 0; }
+		static uint8_t highest() { return 0xff; }
+	};
+
+	template<> struct MorphLimits<uint16_t> {
+		static uint16_t lowest()  { return 0; }
+		static uint16_t highest() { return 0xffff; }
+	};
+
+	template<> struct MorphLimits<float> {
+		static float lowest()  { return -std::numeric_limits<float>::infinity(); }
+		static float highest() { return std::numeric_limits<float>::infinity(); }
+	};
+
+	static inline void morphMinRow( const SIMD* simd, uint8_t* dst, const uint8_t* a, const uint8_t* b, size_t n ) { simd->MinValueU8( dst, a, b, n ); }
+	static inline void morphMinRow( const SIMD* simd, uint16_t* dst, const uint16_t* a, const uint16_t* b, size_t n ) { simd->MinValueU16( dst, a, b, n ); }
+	static inline void morphMinRow( const SIMD* simd, float* dst, const float* a, const float* b, size_t n ) { simd->MinValue1f( dst, a, b, n ); }
+	static inline void morphMaxRow( const SIMD* simd, uint8_t* dst, const uint8_t* a, const uint8_t* b, size_t n ) { simd->MaxValueU8( dst, a, b, n ); }
+	static inline void morphMaxRow( const SIMD* simd, uint16_t* dst, const uint16_t* a, const uint16_t* b, size_t n ) { simd->MaxValueU16( dst, a, b, n ); }
+	static inline void morphMaxRow( const SIMD* simd, float* dst, const float* a, const float* b, size_t n ) { simd->MaxValue1f( dst, a, b, n ); }
+
+	template<typename T>
+	struct MorphErode {
+		static T identity() { return MorphLimits<T>::highest(); }
+		static T apply( T a, T b ) { return a < b ? a : b; }
+		static void row( const SIMD* simd, T* dst, const T* a, const T* b, size_t n ) { morphMinRow( simd, dst, a, b, n ); }
+	};
+
+	template<typename T>
+	struct MorphDilate {
+		static T identity() { return MorphLimits<T>::lowest(); }
+		static T apply( T a, T b ) { return a > b ? a : b; }
+		static void row( const SIMD* simd, T* dst, const T* a, const T* b, size_t n ) { morphMaxRow( simd, dst, a, b, n ); }
+	};
 
-	template<typename TYPE>
-	static void morphTemplate( Image& dst, const Image& src, size_t radius,
-								void ( SIMD::*hfunc )( TYPE*, const TYPE*, size_t, size_t ) const,
-								void ( SIMD::*hfuncborder )( TYPE*, const TYPE*, const TYPE*, size_t ) const,
-								void ( SIMD::*vfunc )( TYPE*, const TYPE**, size_t, size_t ) const
-							 )
+	/*
+	   van Herk/Gil-Werman: the identity padded line is split into blocks of k = 2r + 1,
+	   g holds the running min/max from the start of each block, h the one to its end.
+	   Every window covers the tail of one block and the head of the next, so it costs
+	   three comparisons per pixel independent of the radius.
+	 */
+	template<typename T, class OP>
+	static void morphHorizontal( T* dst, const T* src, size_t n, size_t r, T* p, T* g, T* h )
 	{
-		SIMD* simd = SIMD::instance();
-		const size_t boxsize = radius * 2 + 1;
-		size_t curbuf;
-		size_t w = src.width();
-		size_t h = src.height();
-		size_t bstride = Math::pad16( sizeof( TYPE ) * w ) / sizeof( TYPE ); //FIXME: does this always work - it should
-		TYPE** buf;
-		size_t i;
-
-		IMapScoped<TYPE> mapdst( dst );
-		IMapScoped<const TYPE> mapsrc( src );
-
-		/* allocate and fill buffer */
-		ScopedBuffer<TYPE,true> bufmem( bstride * boxsize );
-		ScopedBuffer<TYPE*,true> bufptr( boxsize );
-
-		buf = bufptr.ptr();
-		buf[ 0 ] = bufmem.ptr();
-		for( i = 0; i < boxsize; i++ ) {
-			if( i != 0 )
-				buf[ i ] = buf[ i - 1 ] + bstride;
-			( simd->*hfunc )( buf[ i ], mapsrc.ptr(), w, radius );
-			mapsrc++;
+		const size_t k = 2 * r + 1;
+		const size_t N = n + 2 * r;
+
+		for( size_t i = 0; i < r; i++ ) {
+			p[ i ] = OP::identity();
+			p[ r + n + i ] = OP::identity();
 		}
+		memcpy( p + r, src, sizeof( T ) * n );
 
-		/* upper border */
-		( simd->*vfunc )( mapdst.ptr(), ( const TYPE** ) buf, radius + 1, w );
-		for( i = 1; i < radius; i++ ) {
-			TYPE* prev = mapdst.ptr();
-			mapdst++;
-			( simd->*hfuncborder )( mapdst.ptr(), ( const TYPE* ) prev, ( const TYPE* ) buf[ radius + 1 + i ], w );
+		for( size_t b = 0; b < N; b += k ) {
+			const size_t e = Math::min( N, b + k );
+			g[ b ] = p[ b ];
+			for( size_t i = b + 1; i < e; i++ )
+				g[ i ] = OP::apply( g[ i - 1 ], p[ i ] );
+			h[ e - 1 ] = p[ e - 1 ];
+			for( size_t i = e - 1; i > b; i-- )
+				h[ i - 1 ] = OP::apply( h[ i ], p[ i - 1 ] );
 		}
-		mapdst++;
-
-		/* center */
-		curbuf = 0;
-		i = h - 2 * radius - 1;
-		( simd->*vfunc )( mapdst.ptr(), ( const TYPE** ) buf, boxsize, w );
-		mapdst++;
-		while( i-- ) {
-			( simd->*hfunc )( buf[ curbuf ], mapsrc.ptr(), w, radius );
-			curbuf = ( curbuf + 1 ) % boxsize;
-			( simd->*vfunc )( mapdst.ptr(), ( const TYPE** ) buf, boxsize, w );
-			mapdst++;
-			mapsrc++;
+
+		for( size_t x = 0; x < n; x++ )
+			dst[ x ] = OP::apply( h[ x ], g[ x + k - 1 ] );
+	}
+
+	/*
+	   The same recursion along the columns, evaluated with whole row operations on strips of
+	   'strip' columns. The k rows of a block are streamed once: the forward pass emits the
+	   windows ending in this block against the backward values of the previous block, the
+	   backward values of the current block are kept for the next one.
+	   in holds the n + 2r (identity padded) rows, out the n result rows.
+	 */
+	template<typename T, class OP>
+	static void morphVertical( T* const* out, const T* const* in, size_t n, size_t r, size_t width, size_t strip, T* mem, const T** hprev )
+	{
+		const SIMD* simd = SIMD::instance();
+		const size_t k = 2 * r + 1;
+		const size_t N = n + 2 * r;
+		T* gbuf = mem;
+
+		for( size_t c0 = 0; c0 < width; c0 += strip ) {
+			const size_t len = Math::min( strip, width - c0 );
+
+			for( size_t bk = 0; bk < N; bk += k ) {
+				const size_t L = Math::min( k, N - bk );
+				const T* g = in[ bk ] + c0;
+
+				for( size_t t = 0; t < L; t++ ) {
+					if( t ) {
+						OP::row( simd, gbuf, g, in[ bk + t ] + c0, len );
+						g = gbuf;
+					}
+					if( bk && t + 1 < k && bk - k + t + 1 < n )
+						OP::row( simd, out[ bk - k + t + 1 ] + c0, hprev[ t + 1 ], g, len );
+				}
+
+				/* window aligned with the block */
+				if( L == k && bk < n )
+					memcpy( out[ bk ] + c0, g, sizeof( T ) * len );
+
+				if( bk + k < N ) {
+					hprev[ k - 1 ] = in[ bk + k - 1 ] + c0;
+					for( size_t t = k - 2; t > 0; t-- ) {
+						T* hrow = mem + ( t + 1 ) * strip;
+						OP::row( simd, hrow, in[ bk + t ] + c0, hprev[ t + 1 ], len );
+						hprev[ t ] = hrow;
+					}
+				}
+			}
 		}
+	}
+
+	/* erosion/dilation of the rows [ y0, y1 ), in[ y ] has to be valid for all rows within radius r of the band */
+	template<typename T, class OP>
+	static void morphRows( T* const* out, const T* const* in, size_t y0, size_t y1, size_t width, size_t height, size_t r )
+	{
+		const size_t k = 2 * r + 1;
+		const size_t n = y1 - y0;
+		const size_t ya = y0 > r ? y0 - r : 0;
+		const size_t yb = Math::min( height, y1 + r );
+		const size_t hstride = Math::pad16( sizeof( T ) * width ) / sizeof( T );
+		/* keep the k rows of backward values of a strip in cache */
+		const size_t strip = Math::min( hstride, Math::max<size_t>( 64, ( ( 1 << 17 ) / ( sizeof( T ) * ( k + 1 ) ) ) & ~( size_t ) 0xf ) );
+
+		ScopedBuffer<T, true> hmem( hstride * ( yb - ya + 1 ) );
+		ScopedBuffer<T, true> line( 3 * ( width + 2 * r ) );
+		ScopedBuffer<T, true> vmem( strip * k );
+		ScopedBuffer<const T*, true> vin( n + 2 * r );
+		ScopedBuffer<const T*, true> hprev( k );
 
-		/* lower border */
-		/* reorder buffer */
-		ScopedBuffer<TYPE*,true> bufptr2( boxsize );
-		TYPE** buf2 = bufptr2.ptr();
-		for( i = 0; i < boxsize; i++ )
-			buf2[ i ] = buf[ ( curbuf + i ) % boxsize ];
+		T* identity = hmem.ptr() + hstride * ( yb - ya );
+		for( size_t x = 0; x < width; x++ )
+			identity[ x ] = OP::identity();
 
-		for( i = 1; i <= radius; i++ ) {
-			( simd->*vfunc )( mapdst.ptr(), ( const TYPE** ) ( buf2 + i ), boxsize - i, w );
-			mapdst++;
+		T* p = line.ptr();
+		for( size_t y = ya; y < yb; y++ )
+			morphHorizontal<T, OP>( hmem.ptr() + ( y - ya ) * hstride, in[ y ], width, r, p, p + width + 2 * r, p + 2 * ( width + 2 * r ) );
+
+		/* virtual row q corresponds to image row y0 + q - r */
+		const T** v = vin.ptr();
+		for( size_t q = 0; q < n + 2 * r; q++ ) {
+			const size_t y = y0 + q;
+			v[ q ] = ( y >= r && y - r < height ) ? hmem.ptr() + ( y - r - ya ) * hstride : identity;
 		}
+
+		morphVertical<T, OP>( out, v, n, r, width, strip, vmem.ptr(), hprev.ptr() );
 	}
 
-	void IMorphological::dilate( Image& dst, const Image& src, size_t radius )
+	/* FIRST followed by SECOND, only the rows of the band plus radius r are kept in between */
+	template<typename T, class FIRST, class SECOND>
+	static void morphRows2( T* const* out, const T* const* in, size_t y0, size_t y1, size_t width, size_t height, size_t r )
 	{
-		if( src.channels() != 1 )
-			throw CVTException( "Not implemented IMorphological::dilate" );
+		const size_t ma = y0 > r ? y0 - r : 0;
+		const size_t mb = Math::min( height, y1 + r );
+		const size_t stride = Math::pad16( sizeof( T ) * width ) / sizeof( T );
 
-		dst.reallocate( src.width(), src.height(), src.format() );
+		ScopedBuffer<T, true> mid( stride * ( mb - ma ) );
+		std::vector<T*> rows( height, ( T* ) NULL );
+		for( size_t y = ma; y < mb; y++ )
+			rows[ y ] = mid.ptr() + ( y - ma ) * stride;
 
-		switch( src.format().formatID ) {
-			case IFORMAT_GRAY_UINT8:
-				morphTemplate<uint8_t>( dst, src, radius, &SIMD::dilateSpanU8, &SIMD::MaxValueU8, &SIMD::MaxValueVertU8 );
-				return;
-			case IFORMAT_GRAY_UINT16:
-				morphTemplate<uint16_t>( dst, src, radius, &SIMD::dilateSpanU16, &SIMD::MaxValueU16, &SIMD::MaxValueVertU16 );
-				break;
-			case IFORMAT_GRAY_FLOAT:
-				morphTemplate<float>( dst, src, radius, &SIMD::dilateSpan1f, &SIMD::MaxValue1f, &SIMD::MaxValueVert1f );
-				break;
-			default:
-				throw CVTException( "Not implemented" );
+		morphRows<T, FIRST>( &rows[ ma ], in, ma, mb, width, height, r );
+		morphRows<T, SECOND>( out, &rows[ 0 ], y0, y1, width, height, r );
+	}
+
+	template<typename T>
+	class MorphBody
+	{
+		public:
+			MorphBody( T* const* dst, const T* const* src, size_t width, size_t height, size_t radius, MorphMode mode, size_t bandRows ) :
+				_dst( dst ), _src( src ), _width( width ), _height( height ), _radius( radius ), _mode( mode ), _bandRows( bandRows )
+			{
+			}
+
+			void operator()( const Range<size_t>& r ) const
+			{
+				for( size_t b = r.min; b < r.max; b++ )
+					band( b );
+			}
+
+		private:
+			void band( size_t b ) const
+			{
+				const size_t y0 = b * _bandRows;
+				const size_t y1 = Math::min( _height, y0 + _bandRows );
+				T* const* out = _dst + y0;
+
+				switch( _mode ) {
+					case MORPH_ERODE:
+						morphRows<T, MorphErode<T> >( out, _src, y0, y1, _width, _height, _radius );
+						break;
+					case MORPH_DILATE:
+						morphRows<T, MorphDilate<T> >( out, _src, y0, y1, _width, _height, _radius );
+						break;
+					case MORPH_OPEN:
+					case MORPH_TOPHAT:
+						morphRows2<T, MorphErode<T>, MorphDilate<T> >( out, _src, y0, y1, _width, _height, _radius );
+						break;
+					case MORPH_CLOSE:
+					case MORPH_BLACKHAT:
+						morphRows2<T, MorphDilate<T>, MorphErode<T> >( out, _src, y0, y1, _width, _height, _radius );
+						break;
+				}
+
+				if( _mode == MORPH_TOPHAT ) {
+					for( size_t y = y0; y < y1; y++ ) {
+						T* d = _dst[ y ];
+						const T* s = _src[ y ];
+						for( size_t x = 0; x < _width; x++ )
+							d[ x ] = s[ x ] - d[ x ];
+					}
+				} else if( _mode == MORPH_BLACKHAT ) {
+					for( size_t y = y0; y < y1; y++ ) {
+						T* d = _dst[ y ];
+						const T* s = _src[ y ];
+						for( size_t x = 0; x < _width; x++ )
+							d[ x ] = d[ x ] - s[ x ];
+					}
+				}
+			}
+
+			T* const*		_dst;
+			const T* const*	_src;
+			size_t			_width;
+			size_t			_height;
+			size_t			_radius;
+			MorphMode		_mode;
+			size_t			_bandRows;
+	};
+
+	template<typename T>
+	static void morphTemplate( Image& dst, const Image& src, size_t radius, MorphMode mode )
+	{
+		const size_t w = src.width();
+		const size_t h = src.height();
+		size_t sstride, dstride;
+
+		const T* s = src.map<T>( &sstride );
+		T* d = dst.map<T>( &dstride );
+
+		if( !radius ) {
+			for( size_t y = 0; y < h; y++ ) {
+				if( mode == MORPH_TOPHAT || mode == MORPH_BLACKHAT )
+					memset( d + y * dstride, 0, sizeof( T ) * w );
+				else
+					memcpy( d + y * dstride, s + y * sstride, sizeof( T ) * w );
+			}
+		} else {
+			std::vector<const T*> srcrows( h );
+			std::vector<T*> dstrows( h );
+			for( size_t y = 0; y < h; y++ ) {
+				srcrows[ y ] = s + y * sstride;
+				dstrows[ y ] = d + y * dstride;
+			}
+
+			/* every band recomputes the rows within reach of its border, keep the bands considerably higher */
+			const size_t reach = ( mode == MORPH_ERODE || mode == MORPH_DILATE ) ? radius : 2 * radius;
+			const size_t threads = ThreadPool::hardwareConcurrency();
+			const size_t bandRows = Math::max( Math::max<size_t>( 16, 4 * reach ), ( h + 4 * threads - 1 ) / ( 4 * threads ) );
+			const size_t bands = ( h + bandRows - 1 ) / bandRows;
+
+			parallelFor( Range<size_t>( 0, bands ), MorphBody<T>( &dstrows[ 0 ], &srcrows[ 0 ], w, h, radius, mode, bandRows ), 1 );
 		}
+
+		dst.unmap( d );
+		src.unmap( s );
 	}
 
-	void IMorphological::erode( Image& dst, const Image& src, size_t radius )
+	static void morphDispatch( Image& dst, const Image& src, size_t radius, MorphMode mode )
 	{
 		if( src.channels() != 1 )
-			throw CVTException( "Not implemented IMorphological::erode" );
+			throw CVTException( "Not implemented IMorphological for multi-channel images" );
+
+		/* the bands read rows written by their neighbours */
+		if( &dst == &src ) {
+			Image tmp;
+			morphDispatch( tmp, src, radius, mode );
+			dst.swap( tmp );
+			return;
+		}
 
 		dst.reallocate( src.width(), src.height(), src.format() );
 
 		switch( src.format().formatID ) {
 			case IFORMAT_GRAY_UINT8:
-				morphTemplate<uint8_t>( dst, src, radius, &SIMD::erodeSpanU8, &SIMD::MinValueU8, &SIMD::MinValueVertU8 );
-				return;
+				morphTemplate<uint8_t>( dst, src, radius, mode );
+				break;
 			case IFORMAT_GRAY_UINT16:
-				morphTemplate<uint16_t>( dst, src, radius, &SIMD::erodeSpanU16, &SIMD::MinValueU16, &SIMD::MinValueVertU16 );
+				morphTemplate<uint16_t>( dst, src, radius, mode );
 				break;
 			case IFORMAT_GRAY_FLOAT:
-				morphTemplate<float>( dst, src, radius, &SIMD::erodeSpan1f, &SIMD::MinValue1f, &SIMD::MinValueVert1f );
+				morphTemplate<float>( dst, src, radius, mode );
 				break;
 			default:
 				throw CVTException( "Not implemented" );
 		}
 	}
+
+	void IMorphological::dilate( Image& dst, const Image& src, size_t radius )
+	{
+		morphDispatch( dst, src, radius, MORPH_DILATE );
+	}
+
+	void IMorphological::erode( Image& dst, const Image& src, size_t radius )
+	{
+		morphDispatch( dst, src, radius, MORPH_ERODE );
+	}
+
+	void IMorphological::open( Image& dst, const Image& src, size_t radius )
+	{
+		morphDispatch( dst, src, radius, MORPH_OPEN );
+	}
+
+	void IMorphological::close( Image& dst, const Image& src, size_t radius )
+	{
+		morphDispatch( dst, src, radius, MORPH_CLOSE );
+	}
+
+	void IMorphological::tophat( Image& dst, const Image& src, size_t radius )
+	{
+		morphDispatch( dst, src, radius, MORPH_TOPHAT );
+	}
+
+	void IMorphological::blackhat( Image& dst, const Image& src, size_t radius )
+	{
+		morphDispatch( dst, src, radius, MORPH_BLACKHAT );
+	}
 }
@@ -25,6 +25,8 @@
 #ifndef CVT_IMORPHOLOGICAL_H
 #define CVT_IMORPHOLOGICAL_H
 
+#include <stddef.h>
+
 namespace cvt
 {
 	class Image;
@@ -34,8 +36,12 @@ namespace cvt
 		public:
 			static void dilate( Image& dst, const Image& src, size_t radius );
 			static void erode( Image& dst, const Image& src, size_t radius );
-//			static void open( Image& dst, const Image& src, size_t radius );
-//			static void close( Image& dst, const Image& src, size_t radius );
+			static void open( Image& dst, const Image& src, size_t radius );
+			static void close( Image& dst, const Image& src, size_t radius );
+			/* src - open( src ) */
+			static void tophat( Image& dst, const Image& src, size_t radius );
+			/* close( src ) - src */
+			static void blackhat( Image& dst, const Image& src, size_t radius );
 		private:
 			IMorphological() {}
 			IMorphological( const IMorphological& ) {}
@@ -0,0 +1,143 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/gfx/IMorphological.h>
+#include <cvt/gfx/Image.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/util/CVTTest.h>
+
+#include <vector>
+#include <stdlib.h>
+
+using namespace cvt;
+
+static const size_t _width = 53;
+static const size_t _height = 41;
+
+template<typename T>
+static void _fill( Image& img, double scale )
+{
+	IMapScoped<T> map( img );
+	for( size_t y = 0; y < img.height(); y++ ) {
+		T* ptr = map.ptr();
+		for( size_t x = 0; x < img.width(); x++ )
+			ptr[ x ] = ( T ) ( scale * ( double ) rand() / ( double ) RAND_MAX );
+		map++;
+	}
+}
+
+template<typename T>
+static std::vector<T> _plane( const Image& img )
+{
+	std::vector<T> p( img.width() * img.height() );
+	IMapScoped<const T> map( img );
+	for( size_t y = 0; y < img.height(); y++ ) {
+		for( size_t x = 0; x < img.width(); x++ )
+			p[ y * img.width() + x ] = map.ptr()[ x ];
+		map++;
+	}
+	return p;
+}
+
+/* min or max over the square window clipped at the image borders */
+template<typename T>
+static std::vector<T> _reference( const std::vector<T>& p, int r, bool erode )
+{
+	std::vector<T> m( p.size() );
+	for( int y = 0; y < ( int ) _height; y++ ) {
+		for( int x = 0; x < ( int ) _width; x++ ) {
+			T v = p[ y * _width + x ];
+			for( int yy = Math::max( 0, y - r ); yy <= Math::min( ( int ) _height - 1, y + r ); yy++ ) {
+				for( int xx = Math::max( 0, x - r ); xx <= Math::min( ( int ) _width - 1, x + r ); xx++ ) {
+					T c = p[ yy * _width + xx ];
+					v = erode ? Math::min( v, c ) : Math::max( v, c );
+				}
+			}
+			m[ y * _width + x ] = v;
+		}
+	}
+	return m;
+}
+
+template<typename T>
+static bool _test( const IFormat& format, double scale )
+{
+	bool result = true;
+	const size_t radii[] = { 0, 1, 2, 5, 23, 60 };
+	Image src( _width, _height, format );
+	Image dst;
+	_fill<T>( src, scale );
+	std::vector<T> p = _plane<T>( src );
+
+	for( size_t i = 0; i < sizeof( radii ) / sizeof( radii[ 0 ] ); i++ ) {
+		int r = ( int ) radii[ i ];
+		std::vector<T> ero = _reference( p, r, true );
+		std::vector<T> dil = _reference( p, r, false );
+		std::vector<T> open = _reference( ero, r, false );
+		std::vector<T> close = _reference( dil, r, true );
+		std::vector<T> tophat( p.size() ), blackhat( p.size() );
+		for( size_t k = 0; k < p.size(); k++ ) {
+			tophat[ k ] = p[ k ] - open[ k ];
+			blackhat[ k ] = close[ k ] - p[ k ];
+		}
+
+		IMorphological::erode( dst, src, r );
+		result &= dst.format() == format && _plane<T>( dst ) == ero;
+		IMorphological::dilate( dst, src, r );
+		result &= _plane<T>( dst ) == dil;
+		IMorphological::open( dst, src, r );
+		result &= _plane<T>( dst ) == open;
+		IMorphological::close( dst, src, r );
+		result &= _plane<T>( dst ) == close;
+		IMorphological::tophat( dst, src, r );
+		result &= _plane<T>( dst ) == tophat;
+		IMorphological::blackhat( dst, src, r );
+		result &= _plane<T>( dst ) == blackhat;
+
+		dst = src;
+		IMorphological::erode( dst, dst, r );
+		result &= _plane<T>( dst ) == ero;
+	}
+	return result;
+}
+
+BEGIN_CVTTEST( IMorphological )
+	bool result = true;
+	bool b;
+
+	srand( 1 );
+	b = _test<uint8_t>( IFormat::GRAY_UINT8, 255.0 );
+	CVTTEST_PRINT( "GRAY_UINT8", b );
+	result &= b;
+
+	b = _test<uint16_t>( IFormat::GRAY_UINT16, 65535.0 );
+	CVTTEST_PRINT( "GRAY_UINT16", b );
+	result &= b;
+
+	b = _test<float>( IFormat::GRAY_FLOAT, 1.0 );
+	CVTTEST_PRINT( "GRAY_FLOAT", b );
+	result &= b;
+
+	return result;
+END_CVTTEST
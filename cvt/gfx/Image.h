@@ -89,6 +89,8 @@ namespace cvt {
 
 			void reallocate( size_t w, size_t h, const IFormat & format = IFormat::RGBA_UINT8, IAllocatorType memtype = IALLOCATOR_MEM );
 			void reallocate( const Image& i, IAllocatorType memtype = IALLOCATOR_MEM );
+			/* exchange the image memory of both images, no data is copied */
+			void swap( Image& other );
 
 			void copyRect( int x, int y, const Image& i, const Recti & roi );
 
@@ -182,6 +184,13 @@ namespace cvt {
 
 	std::ostream& operator<<(std::ostream &out, const Image &f);
 
+	inline void Image::swap( Image& other )
+	{
+		ImageAllocator* tmp = _mem;
+		_mem = other._mem;
+		other._mem = tmp;
+	}
+
 	inline Image* Image::clone() const
 	{
 		return new Image( *this );
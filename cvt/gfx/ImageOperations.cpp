@@ -27,6 +27,7 @@
 #include <cvt/util/SIMD.h>
 #include <cvt/util/Exception.h>
 #include <cvt/util/ScopedBuffer.h>
+#include <cvt/util/ParallelFor.h>
 #include <cvt/gfx/IMapScoped.h>
 
 #include <iomanip>
@@ -536,25 +537,175 @@ namespace cvt {
 		}
 	}
 
+	/*
+	   Vertical weights of the adaptive convolution: the first source row and the offset
+	   into the weights for every destination row, so bands of destination rows can be
+	   processed independently
+	 */
+	static void scaleRowOffsets( size_t* rowStart, size_t* weightOffset, const IConvolveAdaptiveSize* sizes, size_t height )
+	{
+		ssize_t row = 0;
+		size_t woffset = 0;
+		for( size_t y = 0; y < height; y++ ) {
+			row += sizes[ y ].incr;
+			rowStart[ y ] = row;
+			weightOffset[ y ] = woffset;
+			woffset += sizes[ y ].numw;
+		}
+	}
+
+	class ScaleFloatRowsBody {
+		public:
+			typedef void (SIMD::*ScaleXFunc)( float* _dst, float const* _src, const size_t width, IConvolveAdaptivef* conva ) const;
+
+			ScaleFloatRowsBody( uint8_t* dst, size_t dstride, const uint8_t* src, size_t sstride, size_t srcheight, size_t width, size_t channels,
+							    IConvolveAdaptivef* scalerx, const IConvolveAdaptivef& scalery, const size_t* rowStart, const size_t* weightOffset,
+								size_t bufsize, ScaleXFunc scalex ) :
+				_dst( dst ), _dstride( dstride ), _src( src ), _sstride( sstride ), _srcheight( srcheight ), _width( width ), _channels( channels ),
+				_scalerx( scalerx ), _scalery( scalery ), _rowStart( rowStart ), _weightOffset( weightOffset ), _bufsize( bufsize ), _scalex( scalex )
+			{
+			}
+
+			void operator()( const Range<size_t>& range ) const
+			{
+				SIMD* simd = SIMD::instance();
+				size_t n = _width * _channels;
+				size_t bstride = Math::pad16( sizeof( float ) * n ) / sizeof( float );
+				ScopedBuffer<float, true> bufmem( bstride * _bufsize );
+				ScopedBuffer<float*, true> bufptr( _bufsize );
+				float** buf = bufptr.ptr();
+				size_t next = 0;
+
+				for( size_t i = 0; i < _bufsize; i++ )
+					buf[ i ] = bufmem.ptr() + i * bstride;
+
+				for( size_t y = range.min; y < range.max; y++ ) {
+					const IConvolveAdaptiveSize* pysw = _scalery.size + y;
+					const float* pyw = _scalery.weights + _weightOffset[ y ];
+					size_t row = _rowStart[ y ];
+					float* dst = ( float* ) ( _dst + _dstride * y );
+					size_t l;
+
+					/* horizontally scaled source rows are kept in a ring buffer indexed by row modulo bufsize */
+					if( next < row )
+						next = row;
+					for( ; next < row + pysw->numw && next < _srcheight; next++ )
+						( simd->*_scalex )( buf[ next % _bufsize ], ( const float* ) ( _src + _sstride * next ), _width, _scalerx );
+
+					l = 0;
+					while( Math::abs( *pyw ) < Math::EPSILONF ) {
+						l++;
+						pyw++;
+					}
+					simd->MulValue1f( dst, buf[ ( row + l ) % _bufsize ], *pyw++, n );
+					l++;
+					for( ; l < pysw->numw; l++ ) {
+						if( Math::abs( *pyw ) > Math::EPSILONF )
+							simd->MulAddValue1f( dst, buf[ ( row + l ) % _bufsize ], *pyw, n );
+						pyw++;
+					}
+				}
+			}
+
+		private:
+			uint8_t*				  _dst;
+			size_t					  _dstride;
+			const uint8_t*			  _src;
+			size_t					  _sstride;
+			size_t					  _srcheight;
+			size_t					  _width;
+			size_t					  _channels;
+			IConvolveAdaptivef*		  _scalerx;
+			const IConvolveAdaptivef& _scalery;
+			const size_t*			  _rowStart;
+			const size_t*			  _weightOffset;
+			size_t					  _bufsize;
+			ScaleXFunc				  _scalex;
+	};
+
+	class ScaleU8RowsBody {
+		public:
+			typedef void (SIMD::*ScaleXFunc)( Fixed* _dst, uint8_t const* _src, const size_t width, IConvolveAdaptiveFixed* conva ) const;
+
+			ScaleU8RowsBody( uint8_t* dst, size_t dstride, const uint8_t* src, size_t sstride, size_t srcheight, size_t width, size_t channels,
+							 IConvolveAdaptiveFixed* scalerx, const IConvolveAdaptiveFixed& scalery, const size_t* rowStart, const size_t* weightOffset,
+							 size_t bufsize, ScaleXFunc scalex ) :
+				_dst( dst ), _dstride( dstride ), _src( src ), _sstride( sstride ), _srcheight( srcheight ), _width( width ), _channels( channels ),
+				_scalerx( scalerx ), _scalery( scalery ), _rowStart( rowStart ), _weightOffset( weightOffset ), _bufsize( bufsize ), _scalex( scalex )
+			{
+			}
+
+			void operator()( const Range<size_t>& range ) const
+			{
+				SIMD* simd = SIMD::instance();
+				size_t n = _width * _channels;
+				size_t bstride = Math::pad16( sizeof( Fixed ) * n ) / sizeof( Fixed );
+				ScopedBuffer<Fixed, true> bufmem( bstride * ( _bufsize + 1 ) );
+				ScopedBuffer<Fixed*, true> bufptr( _bufsize );
+				Fixed** buf = bufptr.ptr();
+				Fixed* accumBuf = bufmem.ptr() + _bufsize * bstride;
+				size_t next = 0;
+
+				for( size_t i = 0; i < _bufsize; i++ )
+					buf[ i ] = bufmem.ptr() + i * bstride;
+
+				for( size_t y = range.min; y < range.max; y++ ) {
+					const IConvolveAdaptiveSize* pysw = _scalery.size + y;
+					const Fixed* pyw = _scalery.weights + _weightOffset[ y ];
+					size_t row = _rowStart[ y ];
+					uint8_t* dst = _dst + _dstride * y;
+					size_t l;
+
+					/* horizontally scaled source rows are kept in a ring buffer indexed by row modulo bufsize */
+					if( next < row )
+						next = row;
+					for( ; next < row + pysw->numw && next < _srcheight; next++ )
+						( simd->*_scalex )( buf[ next % _bufsize ], _src + _sstride * next, _width, _scalerx );
+
+					l = 0;
+					while( *pyw == ( Fixed )0.0f ) {
+						l++;
+						pyw++;
+					}
+					simd->MulValue1fx( accumBuf, buf[ ( row + l ) % _bufsize ], *pyw++, n );
+					l++;
+					for( ; l < pysw->numw; l++ ) {
+						if( *pyw != ( Fixed )0.0f )
+							simd->MulAddValue1fx( accumBuf, buf[ ( row + l ) % _bufsize ], *pyw, n );
+						pyw++;
+					}
+
+					for( size_t w = 0;  w < n; w++ ){
+						dst[ w ] = Math::clamp( accumBuf[ w ].round(), 0, 255 );
+					}
+				}
+			}
+
+		private:
+			uint8_t*					  _dst;
+			size_t						  _dstride;
+			const uint8_t*				  _src;
+			size_t						  _sstride;
+			size_t						  _srcheight;
+			size_t						  _width;
+			size_t						  _channels;
+			IConvolveAdaptiveFixed*		  _scalerx;
+			const IConvolveAdaptiveFixed& _scalery;
+			const size_t*				  _rowStart;
+			const size_t*				  _weightOffset;
+			size_t						  _bufsize;
+			ScaleXFunc					  _scalex;
+	};
+
 	void Image::scaleFloat( Image& idst, size_t width, size_t height, const IScaleFilter& filter ) const
 	{
 		IConvolveAdaptivef scalerx;
 		IConvolveAdaptivef scalery;
-		IConvolveAdaptiveSize* pysw;
-		float* pyw;
 		const uint8_t* src;
-		const uint8_t* osrc;
-		const uint8_t* send;
 		uint8_t* dst;
-		uint8_t* odst;
 		size_t sstride, dstride;
-		size_t i, l;
-		int32_t k;
-		float** buf;
 		size_t bufsize;
-		size_t curbuf;
 		void (SIMD::*scalex_func)( float* _dst, float const* _src, const size_t width, IConvolveAdaptivef* conva ) const;
-		SIMD* simd = SIMD::instance();
 
 
 		if( _mem->_format.channels == 1 ) {
@@ -569,57 +720,24 @@ namespace cvt {
 		//checkSize( idst, __PRETTY_FUNCTION__, __LINE__, width, height );
 		idst.reallocate( width, height, this->format() );
 
-		osrc = src = map( &sstride );
-		odst = dst = idst.map( &dstride );
-		send = src + sstride * _mem->_height;
+		src = map( &sstride );
+		dst = idst.map( &dstride );
 
 		bufsize = filter.getAdaptiveConvolutionWeights( height, _mem->_height, scalery, true );
 		filter.getAdaptiveConvolutionWeights( width, _mem->_width, scalerx, false );
 
-		buf = new float*[ bufsize ];
-		/* allocate and fill buffer */
-		for( i = 0; i < bufsize; i++ ) {
-			if( posix_memalign( ( void** ) &buf[ i ], 16, sizeof( float ) * width * _mem->_format.channels) )
-				throw CVTException("Out of memory");
-			( simd->*scalex_func )( ( float* ) buf[ i ], ( float* ) src, width, &scalerx );
-			src += sstride;
-		}
-		curbuf = 0;
+		ScopedBuffer<size_t, true> rowStart( height );
+		ScopedBuffer<size_t, true> weightOffset( height );
+		scaleRowOffsets( rowStart.ptr(), weightOffset.ptr(), scalery.size, height );
 
-		pysw = scalery.size;
-		pyw = scalery.weights;
+		/* bands of destination rows are processed in parallel, each with its own ring buffer */
+		ScaleFloatRowsBody body( dst, dstride, src, sstride, _mem->_height, width, _mem->_format.channels,
+								 &scalerx, scalery, rowStart.ptr(), weightOffset.ptr(), bufsize, scalex_func );
+		parallelFor( Range<size_t>( 0, height ), body );
 
-		while( height-- ) {
-			if( pysw->incr ) {
-				for( k = 0; k < pysw->incr && src < send ; k++ ) {
-					( simd->*scalex_func )( ( float* ) buf[ ( curbuf + k ) % bufsize ], ( float* ) src, width, &scalerx );
-					src += sstride;
-				}
-				curbuf = ( curbuf + pysw->incr ) % bufsize;
-			}
-
-			l = 0;
-			while( Math::abs( *pyw ) < Math::EPSILONF ) {
-				l++;
-				pyw++;
-			}
-			simd->MulValue1f( ( float* ) dst, buf[ ( curbuf + l ) % bufsize ], *pyw++, width * _mem->_format.channels );
-			l++;
-			for( ; l < pysw->numw; l++ ) {
-				if( Math::abs( *pyw ) > Math::EPSILONF )
-					simd->MulAddValue1f( ( float* ) dst, buf[ ( curbuf + l ) % bufsize ], *pyw, width * _mem->_format.channels );
-				pyw++;
-			}
-			pysw++;
-			dst += dstride;
-		}
-
-		idst.unmap( odst );
-		unmap( osrc );
+		idst.unmap( dst );
+		unmap( src );
 
-		for( i = 0; i < bufsize; i++ )
-			free( buf[ i ] );
-		delete[] buf;
 		delete[] scalerx.size;
 		delete[] scalerx.weights;
 		delete[] scalery.size;
@@ -630,24 +748,11 @@ namespace cvt {
 	{
 		IConvolveAdaptiveFixed scalerx;
 		IConvolveAdaptiveFixed scalery;
-
-		IConvolveAdaptiveSize* pysw;
-		Fixed* pyw;
-
 		const uint8_t* src;
-		const uint8_t* osrc;
-		const uint8_t* send;
 		uint8_t* dst;
-		uint8_t* odst;
 		size_t sstride, dstride;
-		size_t i, l;
-		int32_t k;
-		Fixed** buf;
-		Fixed* accumBuf;
 		size_t bufsize;
-		size_t curbuf;
 		void (SIMD::*scalex_func)( Fixed* _dst, uint8_t const* _src, const size_t width, IConvolveAdaptiveFixed* conva ) const;
-		SIMD* simd = SIMD::instance();
 
 		if( _mem->_format.channels == 1 ) {
 			scalex_func = &SIMD::ConvolveAdaptive1Fixed;
@@ -659,66 +764,24 @@ namespace cvt {
 
 		idst.reallocate( width, height, this->format() );
 
-		osrc = src = map( &sstride );
-		odst = dst = idst.map( &dstride );
-		send = src + sstride * _mem->_height;
+		src = map( &sstride );
+		dst = idst.map( &dstride );
 
 		bufsize = filter.getAdaptiveConvolutionWeights( height, _mem->_height, scalery, true );
 		filter.getAdaptiveConvolutionWeights( width, _mem->_width, scalerx, false );
 
-		buf = new Fixed*[ bufsize ];
-		// allocate and fill buffer
-		for( i = 0; i < bufsize; i++ ) {
-			if( posix_memalign( ( void** ) &buf[ i ], 16, sizeof( Fixed ) * width * _mem->_format.channels) )
-				throw CVTException("Out of memory");
-			( simd->*scalex_func )( buf[ i ], src, width, &scalerx );
-			src += sstride;
-		}
-		curbuf = 0;
-
-		pysw = scalery.size;
-		pyw = scalery.weights;
+		ScopedBuffer<size_t, true> rowStart( height );
+		ScopedBuffer<size_t, true> weightOffset( height );
+		scaleRowOffsets( rowStart.ptr(), weightOffset.ptr(), scalery.size, height );
 
-		if( posix_memalign( ( void** ) &accumBuf, 16, sizeof( Fixed ) * width * _mem->_format.channels ) )
-			throw CVTException("Out of memory");
+		/* bands of destination rows are processed in parallel, each with its own ring buffer */
+		ScaleU8RowsBody body( dst, dstride, src, sstride, _mem->_height, width, _mem->_format.channels,
+							  &scalerx, scalery, rowStart.ptr(), weightOffset.ptr(), bufsize, scalex_func );
+		parallelFor( Range<size_t>( 0, height ), body );
 
-		while( height-- ) {
-			if( pysw->incr ) {
-				for( k = 0; k < pysw->incr && src < send ; k++ ) {
-					( simd->*scalex_func )( buf[ ( curbuf + k ) % bufsize ], src, width, &scalerx );
-					src += sstride;
-				}
-				curbuf = ( curbuf + pysw->incr ) % bufsize;
-			}
-
-			l = 0;
-			while( *pyw == ( Fixed )0.0f ) {
-				l++;
-				pyw++;
-			}
-			simd->MulValue1fx( accumBuf, buf[ ( curbuf + l ) % bufsize ], *pyw++, width * _mem->_format.channels );
-			l++;
-			for( ; l < pysw->numw; l++ ) {
-				if( *pyw != ( Fixed )0.0f )
-					simd->MulAddValue1fx( accumBuf, buf[ ( curbuf + l ) % bufsize ], *pyw, width * _mem->_format.channels );
-				pyw++;
-			}
-
-			for( size_t w = 0;  w < width * _mem->_format.channels; w++ ){
-				dst[ w ] = Math::clamp( accumBuf[ w ].round(), 0, 255 );
-			}
-
-			pysw++;
-			dst += dstride;
-		}
-
-		idst.unmap( odst );
-		unmap( osrc );
+		idst.unmap( dst );
+		unmap( src );
 
-		free( accumBuf );
-		for( i = 0; i < bufsize; i++ )
-			free( buf[ i ] );
-		delete[] buf;
 		delete[] scalerx.size;
 		delete[] scalerx.weights;
 		delete[] scalery.size;
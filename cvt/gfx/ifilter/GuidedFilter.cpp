@@ -47,18 +47,43 @@ namespace cvt {
 
 	GuidedFilter::GuidedFilter() :
 		IFilter( "GuidedFilter", _params, 5, IFILTER_CPU | IFILTER_OPENCL ),
-		_clguidedfilter_calcab( _guidedfilter_calcab_source, "guidedfilter_calcab" ),
-		_clguidedfilter_calcab_outerrgb( _guidedfilter_calcab_outerrgb_source, "guidedfilter_calcab_outerrgb" ),
-		_clguidedfilter_applyab_gc( _guidedfilter_applyab_gc_source, "guidedfilter_applyab_gc" ),
-		_clguidedfilter_applyab_gc_outer( _guidedfilter_applyab_gc_outer_source, "guidedfilter_applyab_gc_outer" ),
-		_clguidedfilter_applyab_cc( _guidedfilter_applyab_cc_source, "guidedfilter_applyab_cc" )
+		_clInitialized( false ),
+		_intfilter( NULL ),
+		_boxfilter( NULL )
 	{
 	}
 
-	void GuidedFilter::apply( Image& dst, const Image& src, const Image& guide, const int radius, const float epsilon, bool rgbcovariance ) const
+	GuidedFilter::~GuidedFilter()
+	{
+		delete _intfilter;
+		delete _boxfilter;
+	}
+
+	void GuidedFilter::initCL() const
+	{
+		if( _clInitialized )
+			return;
+		_clguidedfilter_calcab = CLKernel( _guidedfilter_calcab_source, "guidedfilter_calcab" );
+		_clguidedfilter_calcab_outerrgb = CLKernel( _guidedfilter_calcab_outerrgb_source, "guidedfilter_calcab_outerrgb" );
+		_clguidedfilter_applyab_gc = CLKernel( _guidedfilter_applyab_gc_source, "guidedfilter_applyab_gc" );
+		_clguidedfilter_applyab_gc_outer = CLKernel( _guidedfilter_applyab_gc_outer_source, "guidedfilter_applyab_gc_outer" );
+		_clguidedfilter_applyab_cc = CLKernel( _guidedfilter_applyab_cc_source, "guidedfilter_applyab_cc" );
+		_intfilter = new IntegralFilter();
+		_boxfilter = new BoxFilter();
+		_clInitialized = true;
+	}
+
+	void GuidedFilter::apply( Image& dst, const Image& src, const Image& guide, const int radius, const float epsilon, bool rgbcovariance, IFilterType type ) const
 	{
 		// G guidance image, S source image
 
+		if( type == IFILTER_CPU ) {
+			_cpu.apply( dst, src, guide, radius, epsilon, rgbcovariance );
+			return;
+		}
+
+		initCL();
+
 		if( rgbcovariance ) {
 			applyGC_COV( dst, src, guide, radius, epsilon );
 		} else if( src.format().channels <= 2 ) {
@@ -78,14 +103,14 @@ namespace cvt {
 		Image imeanGS( src.width(), src.height(), IFormat::RGBA_FLOAT, IALLOCATOR_CL ); // FIXME: use only RGBA/GRAY/GRAYALPHA for SRC * GUIDE
 		Image imeanGG( src.width(), src.height(), IFormat::floatEquivalent( guide.format() ), IALLOCATOR_CL );
 
-		_intfilter.apply( iint, guide );
-		_boxfilter.apply( imeanG, iint, radius, IFILTER_OPENCL );
-		_intfilter.apply( iint, src );
-		_boxfilter.apply( imeanS, iint, radius, IFILTER_OPENCL );
-		_intfilter.apply( iint, guide, &src );
-		_boxfilter.apply( imeanGS, iint, radius, IFILTER_OPENCL );
-		_intfilter.apply( iint, guide, &guide );
-		_boxfilter.apply( imeanGG, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, guide );
+		_boxfilter->apply( imeanG, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, src );
+		_boxfilter->apply( imeanS, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, guide, &src );
+		_boxfilter->apply( imeanGS, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, guide, &guide );
+		_boxfilter->apply( imeanGG, iint, radius, IFILTER_OPENCL );
 
 		CLNDRange global( Math::pad16( src.width() ), Math::pad16( src.height() ) );
 		CLNDRange local( 16, 16 );
@@ -99,10 +124,10 @@ namespace cvt {
 		_clguidedfilter_calcab.setArg( 6, epsilon );
 		_clguidedfilter_calcab.run( global, local);
 
-		_intfilter.apply( iint, ia );
-		_boxfilter.apply( ia, iint, radius, IFILTER_OPENCL );
-		_intfilter.apply( iint, ib );
-		_boxfilter.apply( ib, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, ia );
+		_boxfilter->apply( ia, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, ib );
+		_boxfilter->apply( ib, iint, radius, IFILTER_OPENCL );
 
 		dst.reallocate( src.width(), src.height(), src.format(), IALLOCATOR_CL );
 		_clguidedfilter_applyab_gc.setArg( 0, dst );
@@ -125,15 +150,15 @@ namespace cvt {
 		Image imean_RR_RG_RB( src.width(), src.height(), IFormat::RGBA_FLOAT, IALLOCATOR_CL );
 		Image imean_GG_GB_BB( src.width(), src.height(), IFormat::RGBA_FLOAT, IALLOCATOR_CL );
 
-		_intfilter.apply( iint, guide );
-		_boxfilter.apply( imeanG, iint, radius, IFILTER_OPENCL );
-		_intfilter.apply( iint, src );
-		_boxfilter.apply( imeanS, iint, radius, IFILTER_OPENCL );
-		_intfilter.apply( iint, guide, &src );
-		_boxfilter.apply( imeanGS, iint, radius, IFILTER_OPENCL );
-		_intfilter.applyOuterRGB( iint, iint2, guide );
-		_boxfilter.apply( imean_RR_RG_RB, iint, radius, IFILTER_OPENCL );
-		_boxfilter.apply( imean_GG_GB_BB, iint2, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, guide );
+		_boxfilter->apply( imeanG, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, src );
+		_boxfilter->apply( imeanS, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, guide, &src );
+		_boxfilter->apply( imeanGS, iint, radius, IFILTER_OPENCL );
+		_intfilter->applyOuterRGB( iint, iint2, guide );
+		_boxfilter->apply( imean_RR_RG_RB, iint, radius, IFILTER_OPENCL );
+		_boxfilter->apply( imean_GG_GB_BB, iint2, radius, IFILTER_OPENCL );
 
 
 		CLNDRange global( Math::pad16( src.width() ), Math::pad16( src.height() ) );
@@ -149,10 +174,10 @@ namespace cvt {
 		_clguidedfilter_calcab_outerrgb.setArg( 7, epsilon );
 		_clguidedfilter_calcab_outerrgb.run( global, local );
 
-		_intfilter.apply( iint, ia );
-		_boxfilter.apply( ia, iint, radius, IFILTER_OPENCL );
-		_intfilter.apply( iint, ib );
-		_boxfilter.apply( ib, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, ia );
+		_boxfilter->apply( ia, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, ib );
+		_boxfilter->apply( ib, iint, radius, IFILTER_OPENCL );
 
 		dst.reallocate( src.width(), src.height(), src.format(), IALLOCATOR_CL );
 		_clguidedfilter_applyab_gc_outer.setArg( 0, dst );
@@ -173,14 +198,14 @@ namespace cvt {
 		Image imeanGS( src.width(), src.height(), IFormat::RGBA_FLOAT, IALLOCATOR_CL );
 		Image imeanGG( src.width(), src.height(), IFormat::RGBA_FLOAT, IALLOCATOR_CL );
 
-		_intfilter.apply( iint, guide );
-		_boxfilter.apply( imeanG, iint, radius, IFILTER_OPENCL );
-		_intfilter.apply( iint, src );
-		_boxfilter.apply( imeanS, iint, radius, IFILTER_OPENCL );
-		_intfilter.apply( iint, guide, &src );
-		_boxfilter.apply( imeanGS, iint, radius, IFILTER_OPENCL );
-		_intfilter.apply( iint, guide, &guide );
-		_boxfilter.apply( imeanGG, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, guide );
+		_boxfilter->apply( imeanG, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, src );
+		_boxfilter->apply( imeanS, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, guide, &src );
+		_boxfilter->apply( imeanGS, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, guide, &guide );
+		_boxfilter->apply( imeanGG, iint, radius, IFILTER_OPENCL );
 
 		CLNDRange global( Math::pad16( src.width() ), Math::pad16( src.height() ) );
 		CLNDRange local( 16, 16 );
@@ -194,10 +219,10 @@ namespace cvt {
 		_clguidedfilter_calcab.setArg( 6, epsilon );
 		_clguidedfilter_calcab.run( global, local );
 
-		_intfilter.apply( iint, ia );
-		_boxfilter.apply( ia, iint, radius, IFILTER_OPENCL );
-		_intfilter.apply( iint, ib );
-		_boxfilter.apply( ib, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, ia );
+		_boxfilter->apply( ia, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, ib );
+		_boxfilter->apply( ib, iint, radius, IFILTER_OPENCL );
 
 		dst.reallocate( src.width(), src.height(), src.format(), IALLOCATOR_CL );
 		_clguidedfilter_applyab_cc.setArg( 0, dst );
@@ -218,8 +243,9 @@ namespace cvt {
 
 
 		switch ( t ) {
+			case IFILTER_CPU:
 			case IFILTER_OPENCL:
-				this->apply( *out, *in, guide?*guide:*in, radius, epsilon );
+				this->apply( *out, *in, guide?*guide:*in, radius, epsilon, false, t );
 				break;
 			default:
 				throw CVTException( "Not implemented" );
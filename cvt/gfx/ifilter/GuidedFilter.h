@@ -32,31 +32,37 @@
 
 #include <cvt/gfx/ifilter/IntegralFilter.h>
 #include <cvt/gfx/ifilter/BoxFilter.h>
+#include <cvt/gfx/ifilter/GuidedFilterCPU.h>
 
 namespace cvt {
 	class GuidedFilter : public IFilter {
 		public:
 			GuidedFilter();
-			~GuidedFilter() {};
+			~GuidedFilter();
 
-			void apply( Image& dst, const Image& src, const Image& guide, const int radius, const float epsilon, bool rgbcovariance = false ) const;
+			void apply( Image& dst, const Image& src, const Image& guide, const int radius, const float epsilon, bool rgbcovariance = false, IFilterType type = IFILTER_OPENCL ) const;
 
 			void apply( const ParamSet* attribs, IFilterType iftype ) const;
 
 		private:
+			void initCL() const;
 			void applyGC( Image& dst, const Image& src, const Image& guide, const int radius, const float epsilon ) const;
 			void applyGC_COV( Image& dst, const Image& src, const Image& guide, const int radius, const float epsilon ) const;
 			void applyCC( Image& dst, const Image& src, const Image& guide, const int radius, const float epsilon ) const;
 
 			GuidedFilter( const GuidedFilter& t );
+			GuidedFilter& operator=( const GuidedFilter& t );
 
-			CLKernel	   _clguidedfilter_calcab;
-			CLKernel	   _clguidedfilter_calcab_outerrgb;
-			CLKernel	   _clguidedfilter_applyab_gc;
-			CLKernel	   _clguidedfilter_applyab_gc_outer;
-			CLKernel	   _clguidedfilter_applyab_cc;
-			IntegralFilter _intfilter;
-			BoxFilter	   _boxfilter;
+			/* OpenCL resources are created on first use */
+			mutable bool			_clInitialized;
+			mutable CLKernel		_clguidedfilter_calcab;
+			mutable CLKernel		_clguidedfilter_calcab_outerrgb;
+			mutable CLKernel		_clguidedfilter_applyab_gc;
+			mutable CLKernel		_clguidedfilter_applyab_gc_outer;
+			mutable CLKernel		_clguidedfilter_applyab_cc;
+			mutable IntegralFilter* _intfilter;
+			mutable BoxFilter*		_boxfilter;
+			GuidedFilterCPU			_cpu;
 	};
 }
 
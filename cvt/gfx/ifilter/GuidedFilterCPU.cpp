@@ -0,0 +1,450 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/gfx/ifilter/GuidedFilterCPU.h>
+#include <cvt/util/ParallelFor.h>
+#include <cvt/util/ThreadPool.h>
+#include <cvt/util/SIMD.h>
+#include <cvt/util/Exception.h>
+#include <cvt/math/Math.h>
+
+namespace cvt {
+
+	/* one linear model q = a * I_guide + b, solved for a single source channel */
+	struct GuidedFilterCPU::System {
+		size_t	guide[ 3 ];
+		size_t	nguide;
+		size_t	src;
+		size_t	coeff;		// first coefficient plane: a[ 0 ... nguide - 1 ], b
+	};
+
+	enum QuantityType {
+		QUANTITY_G,
+		QUANTITY_S,
+		QUANTITY_GS,
+		QUANTITY_GG
+	};
+
+	struct Quantity {
+		QuantityType	type;
+		size_t			c0;
+		size_t			c1;
+	};
+
+	struct GuidedFilterCPU::Context {
+		size_t					width;
+		size_t					height;
+		size_t					radius;
+		float					epsilon;
+
+		/* interleaved float images, the values are centered around the channel means */
+		const float*			guide;
+		size_t					gstride;
+		size_t					gstep;
+		size_t					K;
+		float					gcenter[ 3 ];
+		const float*			src;
+		size_t					sstride;
+		size_t					sstep;
+		size_t					S;
+		float					scenter[ 3 ];
+		float*					dst;
+		size_t					dstride;
+		size_t					dstep;
+
+		std::vector<System>		systems;
+		float					weight[ 3 ];	// 1 / number of systems per source channel
+
+		std::vector<Quantity>	quantities;
+		int						qG[ 3 ];
+		int						qS[ 3 ];
+		int						qGS[ 3 ][ 3 ];
+		int						qGG[ 3 ][ 3 ];
+
+		size_t					ncoeff;
+		std::vector<float>		coeff;			// ncoeff planes of width * height
+
+		size_t					bandRows;
+		size_t					bands;
+
+		float guideAt( size_t x, size_t y, size_t k ) const { return guide[ y * gstride + x * gstep + k ] - gcenter[ k ]; }
+		float srcAt( size_t x, size_t y, size_t s ) const { return src[ y * sstride + x * sstep + s ] - scenter[ s ]; }
+
+		int addQuantity( QuantityType type, size_t c0, size_t c1 )
+		{
+			Quantity q;
+			q.type = type;
+			q.c0 = c0;
+			q.c1 = c1;
+			quantities.push_back( q );
+			return ( int ) quantities.size() - 1;
+		}
+
+		void addSystem( const size_t* g, size_t ng, size_t s )
+		{
+			System sys;
+			sys.nguide = ng;
+			sys.src = s;
+			sys.coeff = ncoeff;
+			ncoeff += ng + 1;
+			for( size_t i = 0; i < ng; i++ ) {
+				sys.guide[ i ] = g[ i ];
+				if( qG[ g[ i ] ] < 0 )
+					qG[ g[ i ] ] = addQuantity( QUANTITY_G, g[ i ], 0 );
+				if( qGS[ g[ i ] ][ s ] < 0 )
+					qGS[ g[ i ] ][ s ] = addQuantity( QUANTITY_GS, g[ i ], s );
+				for( size_t j = i; j < ng; j++ ) {
+					size_t k = Math::min( g[ i ], g[ j ] ), l = Math::max( g[ i ], g[ j ] );
+					if( qGG[ k ][ l ] < 0 )
+						qGG[ k ][ l ] = addQuantity( QUANTITY_GG, k, l );
+				}
+			}
+			if( qS[ s ] < 0 )
+				qS[ s ] = addQuantity( QUANTITY_S, s, 0 );
+			systems.push_back( sys );
+		}
+
+		/* fill rows [ y0, y1 ) of a quantity into a dense plane */
+		void fill( float* plane, const Quantity& q, size_t y0, size_t y1 ) const
+		{
+			const size_t w = width;
+			for( size_t y = y0; y < y1; y++ ) {
+				float* p = plane + ( y - y0 ) * w;
+				switch( q.type ) {
+					case QUANTITY_G:
+						for( size_t x = 0; x < w; x++ )
+							p[ x ] = guideAt( x, y, q.c0 );
+						break;
+					case QUANTITY_S:
+						for( size_t x = 0; x < w; x++ )
+							p[ x ] = srcAt( x, y, q.c0 );
+						break;
+					case QUANTITY_GS:
+						for( size_t x = 0; x < w; x++ )
+							p[ x ] = guideAt( x, y, q.c0 ) * srcAt( x, y, q.c1 );
+						break;
+					case QUANTITY_GG:
+						for( size_t x = 0; x < w; x++ )
+							p[ x ] = guideAt( x, y, q.c0 ) * guideAt( x, y, q.c1 );
+						break;
+				}
+			}
+		}
+	};
+
+	/*
+	   box means of rows [ y0, y1 ) from a band-local integral with a leading zero row and column,
+	   whose first row corresponds to image row ya; the window is clipped at the image borders
+	 */
+	static void boxMeans( float* dst, const float* integral, size_t istride, size_t width, size_t height, size_t radius,
+						  size_t ya, size_t y0, size_t y1 )
+	{
+		size_t xa = Math::min( radius, width );
+		size_t xb = Math::max( xa, width > radius ? width - radius : 0 );
+
+		for( size_t y = y0; y < y1; y++ ) {
+			size_t t = ( y > radius ? y - radius : 0 ) - ya;
+			size_t b = Math::min( height - 1, y + radius ) + 1 - ya;
+			const float* T = integral + t * istride;
+			const float* B = integral + b * istride;
+			float invh = 1.0f / ( float ) ( b - t );
+			float* d = dst + ( y - y0 ) * width;
+			size_t x;
+
+			for( x = 0; x < xa; x++ ) {
+				size_t x1 = 0, x2 = Math::min( width - 1, x + radius ) + 1;
+				d[ x ] = ( B[ x2 ] - B[ x1 ] - T[ x2 ] + T[ x1 ] ) * invh / ( float ) ( x2 - x1 );
+			}
+			float scale = invh / ( float ) ( 2 * radius + 1 );
+			for( ; x < xb; x++ )
+				d[ x ] = ( B[ x + radius + 1 ] - B[ x - radius ] - T[ x + radius + 1 ] + T[ x - radius ] ) * scale;
+			for( ; x < width; x++ ) {
+				size_t x1 = x - radius, x2 = width;
+				d[ x ] = ( B[ x2 ] - B[ x1 ] - T[ x2 ] + T[ x1 ] ) * invh / ( float ) ( x2 - x1 );
+			}
+		}
+	}
+
+	/* a = ( Sigma + eps * Id )^-1 cov for a symmetric 3x3 Sigma */
+	static inline void solve3x3( float* a, const float s[ 3 ][ 3 ], const float* cov )
+	{
+		float c00 = s[ 1 ][ 1 ] * s[ 2 ][ 2 ] - s[ 1 ][ 2 ] * s[ 1 ][ 2 ];
+		float c01 = s[ 0 ][ 2 ] * s[ 1 ][ 2 ] - s[ 0 ][ 1 ] * s[ 2 ][ 2 ];
+		float c02 = s[ 0 ][ 1 ] * s[ 1 ][ 2 ] - s[ 0 ][ 2 ] * s[ 1 ][ 1 ];
+		float c11 = s[ 0 ][ 0 ] * s[ 2 ][ 2 ] - s[ 0 ][ 2 ] * s[ 0 ][ 2 ];
+		float c12 = s[ 0 ][ 2 ] * s[ 0 ][ 1 ] - s[ 0 ][ 0 ] * s[ 1 ][ 2 ];
+		float c22 = s[ 0 ][ 0 ] * s[ 1 ][ 1 ] - s[ 0 ][ 1 ] * s[ 0 ][ 1 ];
+		float det = s[ 0 ][ 0 ] * c00 + s[ 0 ][ 1 ] * c01 + s[ 0 ][ 2 ] * c02;
+
+		if( Math::abs( det ) < 1e-20f ) {
+			a[ 0 ] = a[ 1 ] = a[ 2 ] = 0.0f;
+			return;
+		}
+		float inv = 1.0f / det;
+		a[ 0 ] = ( c00 * cov[ 0 ] + c01 * cov[ 1 ] + c02 * cov[ 2 ] ) * inv;
+		a[ 1 ] = ( c01 * cov[ 0 ] + c11 * cov[ 1 ] + c12 * cov[ 2 ] ) * inv;
+		a[ 2 ] = ( c02 * cov[ 0 ] + c12 * cov[ 1 ] + c22 * cov[ 2 ] ) * inv;
+	}
+
+	/* first pass: all box means of the band, then the coefficients a, b */
+	class GuidedFilterCPU::StatisticsBody {
+		public:
+			StatisticsBody( Context& ctx ) : _ctx( ctx )
+			{
+			}
+
+			void operator()( const Range<size_t>& r ) const
+			{
+				for( size_t b = r.min; b < r.max; b++ )
+					band( b );
+			}
+
+		private:
+			void band( size_t band ) const
+			{
+				const Context& c = _ctx;
+				const size_t w = c.width;
+				const size_t y0 = band * c.bandRows;
+				const size_t y1 = Math::min( c.height, y0 + c.bandRows );
+				const size_t ya = y0 > c.radius ? y0 - c.radius : 0;
+				const size_t yb = Math::min( c.height, y1 + c.radius );
+				const size_t n = ( y1 - y0 ) * w;
+				SIMD* simd = SIMD::instance();
+
+				std::vector<float> plane( ( yb - ya ) * w );
+				std::vector<float> integral( ( yb - ya + 1 ) * ( w + 1 ), 0.0f );
+				std::vector<float> means( c.quantities.size() * n );
+
+				for( size_t q = 0; q < c.quantities.size(); q++ ) {
+					c.fill( &plane[ 0 ], c.quantities[ q ], ya, yb );
+					simd->prefixSum1_f_to_f( &integral[ w + 2 ], w + 1, &plane[ 0 ], w, w, yb - ya );
+					boxMeans( &means[ q * n ], &integral[ 0 ], w + 1, w, c.height, c.radius, ya, y0, y1 );
+				}
+
+				const float* M = &means[ 0 ];
+				float* coeff = &_ctx.coeff[ 0 ];
+				const size_t planeSize = w * c.height;
+				for( size_t i = 0; i < n; i++ ) {
+					size_t offset = y0 * w + i;
+					for( size_t j = 0; j < c.systems.size(); j++ ) {
+						const System& sys = c.systems[ j ];
+						float mS = M[ c.qS[ sys.src ] * n + i ];
+						float mG[ 3 ], cov[ 3 ], a[ 3 ];
+						for( size_t k = 0; k < sys.nguide; k++ ) {
+							size_t g = sys.guide[ k ];
+							mG[ k ] = M[ c.qG[ g ] * n + i ];
+							cov[ k ] = M[ c.qGS[ g ][ sys.src ] * n + i ] - mG[ k ] * mS;
+						}
+
+						if( sys.nguide == 1 ) {
+							size_t g = sys.guide[ 0 ];
+							float var = M[ c.qGG[ g ][ g ] * n + i ] - mG[ 0 ] * mG[ 0 ];
+							a[ 0 ] = cov[ 0 ] / ( var + c.epsilon );
+						} else {
+							float sigma[ 3 ][ 3 ];
+							for( size_t k = 0; k < 3; k++ ) {
+								for( size_t l = k; l < 3; l++ ) {
+									size_t gk = sys.guide[ k ], gl = sys.guide[ l ];
+									int q = c.qGG[ Math::min( gk, gl ) ][ Math::max( gk, gl ) ];
+									sigma[ k ][ l ] = sigma[ l ][ k ] = M[ q * n + i ] - mG[ k ] * mG[ l ];
+								}
+								sigma[ k ][ k ] += c.epsilon;
+							}
+							solve3x3( a, sigma, cov );
+						}
+
+						float bval = mS;
+						for( size_t k = 0; k < sys.nguide; k++ ) {
+							coeff[ ( sys.coeff + k ) * planeSize + offset ] = a[ k ];
+							bval -= a[ k ] * mG[ k ];
+						}
+						coeff[ ( sys.coeff + sys.nguide ) * planeSize + offset ] = bval;
+					}
+				}
+			}
+
+			Context& _ctx;
+	};
+
+	/* second pass: box means of the coefficients applied to the guide */
+	class GuidedFilterCPU::ApplyBody {
+		public:
+			ApplyBody( const Context& ctx ) : _ctx( ctx )
+			{
+			}
+
+			void operator()( const Range<size_t>& r ) const
+			{
+				for( size_t b = r.min; b < r.max; b++ )
+					band( b );
+			}
+
+		private:
+			void band( size_t band ) const
+			{
+				const Context& c = _ctx;
+				const size_t w = c.width;
+				const size_t y0 = band * c.bandRows;
+				const size_t y1 = Math::min( c.height, y0 + c.bandRows );
+				const size_t ya = y0 > c.radius ? y0 - c.radius : 0;
+				const size_t yb = Math::min( c.height, y1 + c.radius );
+				const size_t n = ( y1 - y0 ) * w;
+				const size_t planeSize = w * c.height;
+				SIMD* simd = SIMD::instance();
+
+				std::vector<float> integral( ( yb - ya + 1 ) * ( w + 1 ), 0.0f );
+				std::vector<float> means( c.ncoeff * n );
+
+				for( size_t p = 0; p < c.ncoeff; p++ ) {
+					simd->prefixSum1_f_to_f( &integral[ w + 2 ], w + 1, &c.coeff[ p * planeSize + ya * w ], w, w, yb - ya );
+					boxMeans( &means[ p * n ], &integral[ 0 ], w + 1, w, c.height, c.radius, ya, y0, y1 );
+				}
+
+				const float* M = &means[ 0 ];
+				for( size_t y = y0; y < y1; y++ ) {
+					float* d = c.dst + y * c.dstride;
+					for( size_t x = 0; x < w; x++ ) {
+						size_t i = ( y - y0 ) * w + x;
+						float out[ 3 ] = { c.scenter[ 0 ], c.scenter[ 1 ], c.scenter[ 2 ] };
+						for( size_t j = 0; j < c.systems.size(); j++ ) {
+							const System& sys = c.systems[ j ];
+							float v = M[ ( sys.coeff + sys.nguide ) * n + i ];
+							for( size_t k = 0; k < sys.nguide; k++ )
+								v += M[ ( sys.coeff + k ) * n + i ] * c.guideAt( x, y, sys.guide[ k ] );
+							out[ sys.src ] += v * c.weight[ sys.src ];
+						}
+						for( size_t s = 0; s < c.S; s++ )
+							d[ x * c.dstep + s ] = out[ s ];
+						if( c.dstep == 4 )
+							d[ x * c.dstep + 3 ] = 1.0f;
+					}
+				}
+			}
+
+			const Context& _ctx;
+	};
+
+	/* mean of each channel, used to center the values before the prefix sums */
+	static void channelMeans( float* mean, const float* data, size_t stride, size_t step, size_t channels, size_t width, size_t height )
+	{
+		for( size_t c = 0; c < channels; c++ ) {
+			double sum = 0.0;
+			for( size_t y = 0; y < height; y++ ) {
+				const float* p = data + y * stride + c;
+				for( size_t x = 0; x < width; x++ )
+					sum += p[ x * step ];
+			}
+			mean[ c ] = ( float ) ( sum / ( double ) ( width * height ) );
+		}
+	}
+
+	void GuidedFilterCPU::apply( Image& dst, const Image& src, const Image& guide, int radius, float epsilon, bool rgbcovariance ) const
+	{
+		if( src.width() != guide.width() || src.height() != guide.height() )
+			throw CVTException( "Image do not match in size!" );
+		if( radius < 0 )
+			throw CVTException( "Invalid radius!" );
+
+		const IFormat srcFormat = src.format();
+		const IFormat& sfmt = src.format().channels <= 2 ? IFormat::GRAY_FLOAT : IFormat::RGBA_FLOAT;
+		const IFormat& gfmt = guide.format().channels <= 2 ? IFormat::GRAY_FLOAT : IFormat::RGBA_FLOAT;
+
+		Image stmp, gtmp;
+		const Image* s = &src;
+		const Image* g = &guide;
+		if( src.format() != sfmt ) {
+			src.convert( stmp, sfmt );
+			s = &stmp;
+		}
+		if( guide.format() != gfmt ) {
+			guide.convert( gtmp, gfmt );
+			g = &gtmp;
+		}
+		Image out( src.width(), src.height(), sfmt );
+
+		Context ctx;
+		ctx.width = src.width();
+		ctx.height = src.height();
+		ctx.radius = radius;
+		ctx.epsilon = epsilon;
+		ctx.K = gfmt == IFormat::GRAY_FLOAT ? 1 : 3;
+		ctx.gstep = gfmt.channels;
+		ctx.S = sfmt == IFormat::GRAY_FLOAT ? 1 : 3;
+		ctx.sstep = sfmt.channels;
+		ctx.dstep = sfmt.channels;
+		ctx.ncoeff = 0;
+		for( size_t i = 0; i < 3; i++ ) {
+			ctx.qG[ i ] = ctx.qS[ i ] = -1;
+			for( size_t j = 0; j < 3; j++ )
+				ctx.qGS[ i ][ j ] = ctx.qGG[ i ][ j ] = -1;
+			ctx.weight[ i ] = 0.0f;
+			ctx.gcenter[ i ] = ctx.scenter[ i ] = 0.0f;
+		}
+
+		const size_t rgb[ 3 ] = { 0, 1, 2 };
+		if( ctx.K == 1 ) {
+			for( size_t c = 0; c < ctx.S; c++ )
+				ctx.addSystem( rgb, 1, c );
+		} else if( rgbcovariance ) {
+			for( size_t c = 0; c < ctx.S; c++ )
+				ctx.addSystem( rgb, 3, c );
+		} else if( ctx.S == 1 ) {
+			for( size_t k = 0; k < 3; k++ )
+				ctx.addSystem( rgb + k, 1, 0 );
+		} else {
+			for( size_t c = 0; c < 3; c++ )
+				ctx.addSystem( rgb + c, 1, c );
+		}
+		for( size_t j = 0; j < ctx.systems.size(); j++ )
+			ctx.weight[ ctx.systems[ j ].src ] += 1.0f;
+		for( size_t c = 0; c < ctx.S; c++ )
+			ctx.weight[ c ] = 1.0f / ctx.weight[ c ];
+
+		/* every band recomputes radius rows above and below, keep the bands considerably higher */
+		size_t threads = ThreadPool::hardwareConcurrency();
+		ctx.bandRows = Math::max( Math::max<size_t>( 16, 4 * ctx.radius ), ( ctx.height + 4 * threads - 1 ) / ( 4 * threads ) );
+		ctx.bands = ( ctx.height + ctx.bandRows - 1 ) / ctx.bandRows;
+		ctx.coeff.resize( ctx.ncoeff * ctx.width * ctx.height );
+
+		ctx.guide = g->map<float>( &ctx.gstride );
+		ctx.src = s->map<float>( &ctx.sstride );
+		ctx.dst = out.map<float>( &ctx.dstride );
+
+		channelMeans( ctx.gcenter, ctx.guide, ctx.gstride, ctx.gstep, ctx.K, ctx.width, ctx.height );
+		channelMeans( ctx.scenter, ctx.src, ctx.sstride, ctx.sstep, ctx.S, ctx.width, ctx.height );
+
+		parallelFor( Range<size_t>( 0, ctx.bands ), StatisticsBody( ctx ), 1 );
+		parallelFor( Range<size_t>( 0, ctx.bands ), ApplyBody( ctx ), 1 );
+
+		out.unmap( ctx.dst );
+		s->unmap( ctx.src );
+		g->unmap( ctx.guide );
+
+		if( srcFormat == sfmt )
+			dst.swap( out );
+		else
+			out.convert( dst, srcFormat );
+	}
+
+}
@@ -0,0 +1,213 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/gfx/ifilter/GuidedFilter.h>
+#include <cvt/gfx/Image.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/util/CVTTest.h>
+
+#include <Eigen/Dense>
+#include <vector>
+#include <stdlib.h>
+
+using namespace cvt;
+
+typedef std::vector<double> Plane;
+
+static const size_t _width = 37;
+static const size_t _height = 29;
+
+static double _noise()
+{
+	return ( double ) rand() / ( double ) RAND_MAX - 0.5;
+}
+
+/* smooth structure with an edge plus noise, channel c of an interleaved float image */
+static void _fill( Image& img, float scale, float offset )
+{
+	IMapScoped<float> map( img );
+	size_t c = img.format().channels;
+	for( size_t y = 0; y < img.height(); y++ ) {
+		float* ptr = map.ptr();
+		for( size_t x = 0; x < img.width(); x++ ) {
+			for( size_t i = 0; i < c; i++ ) {
+				double v = ( x > 15 + i ? 0.6 : 0.2 ) + 0.2 * Math::sin( 0.2 * y + i ) + 0.1 * _noise();
+				ptr[ x * c + i ] = i == 3 ? 1.0f : ( float ) ( offset + scale * v );
+			}
+		}
+		map++;
+	}
+}
+
+static Plane _plane( const Image& img, size_t c )
+{
+	Plane p( _width * _height );
+	IMapScoped<const float> map( img );
+	size_t n = img.format().channels;
+	for( size_t y = 0; y < _height; y++ ) {
+		for( size_t x = 0; x < _width; x++ )
+			p[ y * _width + x ] = map.ptr()[ x * n + c ];
+		map++;
+	}
+	return p;
+}
+
+/* box mean with the window clipped at the image borders */
+static Plane _mean( const Plane& p, int r )
+{
+	Plane m( p.size() );
+	for( int y = 0; y < ( int ) _height; y++ ) {
+		for( int x = 0; x < ( int ) _width; x++ ) {
+			double sum = 0;
+			int n = 0;
+			for( int yy = Math::max( 0, y - r ); yy <= Math::min( ( int ) _height - 1, y + r ); yy++ ) {
+				for( int xx = Math::max( 0, x - r ); xx <= Math::min( ( int ) _width - 1, x + r ); xx++ ) {
+					sum += p[ yy * _width + xx ];
+					n++;
+				}
+			}
+			m[ y * _width + x ] = sum / n;
+		}
+	}
+	return m;
+}
+
+static Plane _mul( const Plane& a, const Plane& b )
+{
+	Plane m( a.size() );
+	for( size_t i = 0; i < a.size(); i++ )
+		m[ i ] = a[ i ] * b[ i ];
+	return m;
+}
+
+/* textbook guided filter of source p with the guide channels I */
+static Plane _reference( const std::vector<Plane>& I, const Plane& p, int r, double eps )
+{
+	size_t K = I.size(), N = p.size();
+	Plane mp = _mean( p, r );
+	std::vector<Plane> mI( K ), mIp( K ), a( K );
+	std::vector<std::vector<Plane> > mII( K, std::vector<Plane>( K ) );
+	for( size_t k = 0; k < K; k++ ) {
+		mI[ k ] = _mean( I[ k ], r );
+		mIp[ k ] = _mean( _mul( I[ k ], p ), r );
+		for( size_t l = 0; l < K; l++ )
+			mII[ k ][ l ] = _mean( _mul( I[ k ], I[ l ] ), r );
+		a[ k ].resize( N );
+	}
+
+	Plane b( N );
+	for( size_t i = 0; i < N; i++ ) {
+		Eigen::MatrixXd sigma( K, K );
+		Eigen::VectorXd cov( K );
+		for( size_t k = 0; k < K; k++ ) {
+			cov[ k ] = mIp[ k ][ i ] - mI[ k ][ i ] * mp[ i ];
+			for( size_t l = 0; l < K; l++ )
+				sigma( k, l ) = mII[ k ][ l ][ i ] - mI[ k ][ i ] * mI[ l ][ i ] + ( k == l ? eps : 0.0 );
+		}
+		Eigen::VectorXd sol = sigma.ldlt().solve( cov );
+		b[ i ] = mp[ i ];
+		for( size_t k = 0; k < K; k++ ) {
+			a[ k ][ i ] = sol[ k ];
+			b[ i ] -= sol[ k ] * mI[ k ][ i ];
+		}
+	}
+
+	Plane q = _mean( b, r );
+	for( size_t k = 0; k < K; k++ ) {
+		Plane ma = _mean( a[ k ], r );
+		for( size_t i = 0; i < N; i++ )
+			q[ i ] += ma[ i ] * I[ k ][ i ];
+	}
+	return q;
+}
+
+static double _maxDiff( const Image& img, size_t c, const Plane& ref )
+{
+	Plane p = _plane( img, c );
+	double diff = 0;
+	for( size_t i = 0; i < p.size(); i++ )
+		diff = Math::max( diff, Math::abs( p[ i ] - ref[ i ] ) );
+	return diff;
+}
+
+BEGIN_CVTTEST( GuidedFilterCPU )
+	bool result = true;
+	bool b;
+	const int r = 3;
+	const float eps = 0.01f;
+	GuidedFilter gf;
+	Image guideGray( _width, _height, IFormat::GRAY_FLOAT );
+	Image guideRGB( _width, _height, IFormat::RGBA_FLOAT );
+	Image srcGray( _width, _height, IFormat::GRAY_FLOAT );
+	Image srcRGB( _width, _height, IFormat::RGBA_FLOAT );
+	Image depth( _width, _height, IFormat::GRAY_FLOAT );
+	Image dst;
+
+	srand( 1 );
+	_fill( guideGray, 1.0f, 0.0f );
+	_fill( guideRGB, 1.0f, 0.0f );
+	_fill( srcGray, 1.0f, 0.0f );
+	_fill( srcRGB, 1.0f, 0.0f );
+	_fill( depth, 1000.0f, 2000.0f );
+
+	std::vector<Plane> G( 1, _plane( guideGray, 0 ) ), RGB;
+	for( size_t c = 0; c < 3; c++ )
+		RGB.push_back( _plane( guideRGB, c ) );
+
+	gf.apply( dst, srcGray, guideGray, r, eps, false, IFILTER_CPU );
+	b = dst.format() == IFormat::GRAY_FLOAT && _maxDiff( dst, 0, _reference( G, _plane( srcGray, 0 ), r, eps ) ) < 1e-4;
+	CVTTEST_PRINT( "gray guide", b );
+	result &= b;
+
+	/* depth in millimetres, the values are large compared to the float precision of the sums */
+	gf.apply( dst, depth, guideGray, r, eps, false, IFILTER_CPU );
+	b = _maxDiff( dst, 0, _reference( G, _plane( depth, 0 ), r, eps ) ) < 1e-1;
+	CVTTEST_PRINT( "gray guide, depth in mm", b );
+	result &= b;
+
+	gf.apply( dst, srcGray, guideRGB, r, eps, true, IFILTER_CPU );
+	b = _maxDiff( dst, 0, _reference( RGB, _plane( srcGray, 0 ), r, eps ) ) < 1e-4;
+	CVTTEST_PRINT( "colour guide with covariance", b );
+	result &= b;
+
+	gf.apply( dst, srcGray, guideRGB, r, eps, false, IFILTER_CPU );
+	Plane avg( _width * _height, 0.0 );
+	for( size_t c = 0; c < 3; c++ ) {
+		Plane q = _reference( std::vector<Plane>( 1, RGB[ c ] ), _plane( srcGray, 0 ), r, eps );
+		for( size_t i = 0; i < avg.size(); i++ )
+			avg[ i ] += q[ i ] / 3.0;
+	}
+	b = _maxDiff( dst, 0, avg ) < 1e-4;
+	CVTTEST_PRINT( "colour guide, gray source", b );
+	result &= b;
+
+	gf.apply( dst, srcRGB, guideRGB, r, eps, false, IFILTER_CPU );
+	b = dst.format() == IFormat::RGBA_FLOAT;
+	for( size_t c = 0; c < 3; c++ )
+		b &= _maxDiff( dst, c, _reference( std::vector<Plane>( 1, RGB[ c ] ), _plane( srcRGB, c ), r, eps ) ) < 1e-4;
+	CVTTEST_PRINT( "colour guide, colour source", b );
+	result &= b;
+
+	return result;
+END_CVTTEST
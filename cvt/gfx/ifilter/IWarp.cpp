@@ -24,6 +24,7 @@
 
 #include <cvt/gfx/ifilter/IWarp.h>
 #include <cvt/math/Vector.h>
+#include <cvt/util/ScopedBuffer.h>
 
 namespace cvt {
 
@@ -64,6 +65,77 @@ namespace cvt {
 		}
 	}
 
+	void IWarp::apply( Image& dst, const Image& src, const IWarpTable& table )
+	{
+		if( src.width() > 0x7fff || src.height() > 0x7fff )
+			throw CVTException( "Image too large for fixed-point warp" );
+
+		dst.reallocate( table.width(), table.height(), src.format() );
+
+		switch( src.format().formatID ) {
+			case IFORMAT_GRAY_UINT8: return applyU8C1( dst, src, table );
+			case IFORMAT_RGBA_UINT8:
+			case IFORMAT_BGRA_UINT8: return applyU8C4( dst, src, table );
+			default: throw CVTException( "Unsupported image format!" );
+		}
+	}
+
+	void IWarp::applyPyrdown( Image& idst, Image& idsthalf, const Image& isrc, const IWarpTable& table )
+	{
+		if( isrc.format() != IFormat::GRAY_UINT8 )
+			throw CVTException( "Unsupported image format!" );
+		if( isrc.width() > 0x7fff || isrc.height() > 0x7fff )
+			throw CVTException( "Image too large for fixed-point warp" );
+		if( table.width() < 4 || table.height() < 4 )
+			throw CVTException( "Warp too small for pyrdown" );
+
+		size_t w = table.width();
+		size_t h = table.height();
+		size_t hw = w / 2;
+		size_t hh = h / 2;
+
+		idst.reallocate( w, h, isrc.format() );
+		idsthalf.reallocate( hw, hh, isrc.format() );
+
+		size_t sstride, dstride, hstride;
+		const uint8_t* src = isrc.map( &sstride );
+		uint8_t* dst = idst.map( &dstride );
+		uint8_t* dsthalf = idsthalf.map( &hstride );
+
+		SIMD* simd = SIMD::instance();
+
+		/* ring of the last five horizontally filtered rows, row y lives in slot y % 5 */
+		size_t bstride = Math::pad16( hw );
+		ScopedBuffer<uint16_t, true> scopebuf( bstride * 5 );
+		uint16_t* buf = scopebuf.ptr();
+		uint16_t* rows[ 5 ];
+
+		uint8_t* pdst = dst;
+		uint8_t* phalf = dsthalf;
+		size_t j = 0;
+
+		for( size_t y = 0; y < h; y++ ) {
+			simd->warpBilinearFixed1u8( pdst, table.coords( y ), table.fractions( y ), src, sstride, isrc.width(), isrc.height(), 0, w );
+			simd->pyrdownHalfHorizontal_1u8_to_1u16( buf + ( y % 5 ) * bstride, pdst, w );
+			pdst += dstride;
+
+			/* half row j needs the rows 2j - 1 ... 2j + 3 clamped to the image */
+			while( j < hh && Math::min( 2 * j + 3, h - 1 ) <= y ) {
+				for( size_t t = 0; t < 5; t++ ) {
+					size_t r = Math::min( 2 * j + t, h ) - ( ( 2 * j + t ) ? 1 : 0 );
+					rows[ t ] = buf + ( r % 5 ) * bstride;
+				}
+				simd->pyrdownHalfVertical_1u16_to_1u8( phalf, rows, hw );
+				phalf += hstride;
+				j++;
+			}
+		}
+
+		isrc.unmap( src );
+		idst.unmap( dst );
+		idsthalf.unmap( dsthalf );
+	}
+
 
 	void IWarp::apply( const ParamSet* attribs, IFilterType iftype ) const
 	{
@@ -373,4 +445,55 @@ namespace cvt {
 		iwarp.unmap( wrp );
 	}
 
+	void IWarp::applyU8C1( Image& idst, const Image& isrc, const IWarpTable& table )
+	{
+		const uint8_t* src;
+		uint8_t* dst;
+		uint8_t* pdst;
+		size_t sstride, dstride, w, h, sw, sh;
+
+		pdst = dst = idst.map( &dstride );
+		src = isrc.map( &sstride );
+
+		SIMD* simd = SIMD::instance();
+
+		sw = isrc.width();
+		sh = isrc.height();
+		w = table.width();
+		h = table.height();
+		for( size_t y = 0; y < h; y++ ) {
+			simd->warpBilinearFixed1u8( pdst, table.coords( y ), table.fractions( y ), src, sstride, sw, sh, 0, w );
+			pdst += dstride;
+		}
+
+		idst.unmap( dst );
+		isrc.unmap( src );
+	}
+
+	void IWarp::applyU8C4( Image& idst, const Image& isrc, const IWarpTable& table )
+	{
+		const uint8_t* src;
+		uint8_t* dst;
+		uint8_t* pdst;
+		size_t sstride, dstride, w, h, sw, sh;
+		uint32_t black = 0xff000000;
+
+		pdst = dst = idst.map( &dstride );
+		src = isrc.map( &sstride );
+
+		SIMD* simd = SIMD::instance();
+
+		sw = isrc.width();
+		sh = isrc.height();
+		w = table.width();
+		h = table.height();
+		for( size_t y = 0; y < h; y++ ) {
+			simd->warpBilinearFixed4u8( pdst, table.coords( y ), table.fractions( y ), src, sstride, sw, sh, black, w );
+			pdst += dstride;
+		}
+
+		idst.unmap( dst );
+		isrc.unmap( src );
+	}
+
 }
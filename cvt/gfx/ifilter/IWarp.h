@@ -27,6 +27,7 @@
 
 #include <cvt/gfx/IFilter.h>
 #include <cvt/gfx/IMapScoped.h>
+#include <cvt/gfx/ifilter/IWarpTable.h>
 #include <cvt/util/Plugin.h>
 #include <cvt/util/PluginManager.h>
 #include <cvt/vision/CameraCalibration.h>
@@ -39,6 +40,16 @@ namespace cvt {
 			void apply( const ParamSet* attribs, IFilterType iftype ) const;
 
 			static void apply( Image& dst, const Image& src, const Image& warp );
+			static void apply( Image& dst, const Image& src, const IWarpTable& table );
+
+			/**
+			  @brief Warp a GRAY_UINT8 image and create the next pyramid level in the same pass.
+			  @param dst the warped image
+			  @param dsthalf the warped image downsampled with the same filter as Image::pyrdown
+			  @param src the source image
+			  @param table the fixed-point warp, at least 4 rows high
+			 */
+			static void applyPyrdown( Image& dst, Image& dsthalf, const Image& src, const IWarpTable& table );
 
 			static void warpTunnel( Image& dst, float radius, float cx, float cy );
 			static void warpFishEye( Image& idst, float strength, float cx, float cy );
@@ -68,6 +79,8 @@ namespace cvt {
 			static void applyFC4( Image& dst, const Image& src, const Image& warp );
 			static void applyU8C1( Image& dst, const Image& src, const Image& warp );
 			static void applyU8C4( Image& dst, const Image& src, const Image& warp );
+			static void applyU8C1( Image& dst, const Image& src, const IWarpTable& table );
+			static void applyU8C4( Image& dst, const Image& src, const IWarpTable& table );
 
 			IWarp( const IWarp& t );
 	};
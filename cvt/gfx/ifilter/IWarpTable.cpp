@@ -0,0 +1,110 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/gfx/ifilter/IWarpTable.h>
+#include <cvt/gfx/IMapScoped.h>
+
+namespace cvt {
+
+	const size_t IWarpTable::FRACTION_BITS;
+
+	IWarpTable::IWarpTable() : _width( 0 ), _height( 0 )
+	{
+	}
+
+	IWarpTable::IWarpTable( const Image& warp ) : _width( 0 ), _height( 0 )
+	{
+		set( warp );
+	}
+
+	IWarpTable::IWarpTable( const IWarpTable& other ) :
+		_width( other._width ),
+		_height( other._height ),
+		_coords( other._coords ),
+		_fractions( other._fractions )
+	{
+	}
+
+	IWarpTable::~IWarpTable()
+	{
+	}
+
+	IWarpTable& IWarpTable::operator=( const IWarpTable& other )
+	{
+		if( this != &other ) {
+			_width = other._width;
+			_height = other._height;
+			_coords = other._coords;
+			_fractions = other._fractions;
+		}
+		return *this;
+	}
+
+	static inline void quantizeCoord( int& ipos, int& fpos, float v )
+	{
+		const float scale = ( float ) ( 1 << IWarpTable::FRACTION_BITS );
+		const int mask = ( 1 << IWarpTable::FRACTION_BITS ) - 1;
+
+		/* anything left/above of -1 is fill anyway, keep the upper bound representable */
+		if( !( v > -2.0f && v < 32766.0f ) ) {
+			ipos = -2;
+			fpos = 0;
+			return;
+		}
+		int fixed = ( int ) Math::floor( v * scale + 0.5f );
+		ipos = fixed >> IWarpTable::FRACTION_BITS;
+		fpos = fixed & mask;
+	}
+
+	void IWarpTable::set( const Image& warp )
+	{
+		if( warp.format() != IFormat::GRAYALPHA_FLOAT )
+			throw CVTException( "Unsupported warp image type" );
+
+		_width = warp.width();
+		_height = warp.height();
+		_coords.resize( 2 * _width * _height );
+		_fractions.resize( _width * _height );
+		if( _fractions.empty() )
+			return;
+
+		IMapScoped<const float> map( warp );
+		int16_t* pcoords = &_coords[ 0 ];
+		uint16_t* pfrac = &_fractions[ 0 ];
+
+		for( size_t y = 0; y < _height; y++ ) {
+			const float* pwarp = map.ptr();
+			for( size_t x = 0; x < _width; x++ ) {
+				int ix, iy, fx, fy;
+				quantizeCoord( ix, fx, *pwarp++ );
+				quantizeCoord( iy, fy, *pwarp++ );
+				*pcoords++ = ( int16_t ) ix;
+				*pcoords++ = ( int16_t ) iy;
+				*pfrac++   = ( uint16_t ) ( ( fy << FRACTION_BITS ) | fx );
+			}
+			map++;
+		}
+	}
+
+}
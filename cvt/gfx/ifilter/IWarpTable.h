@@ -0,0 +1,88 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_IWARPTABLE_H
+#define CVT_IWARPTABLE_H
+
+#include <cvt/gfx/Image.h>
+#include <vector>
+
+namespace cvt {
+
+	/**
+	  @brief Compact fixed-point version of a GRAYALPHA_FLOAT warp image.
+
+	  Every destination pixel stores the integer top-left source position as two int16 values
+	  and the bilinear fractions with 5 bit precision packed into one uint16 ( ( fy << 5 ) | fx ),
+	  6 bytes instead of the 8 bytes of the float warp. Positions outside the representable
+	  range are mapped to fill.
+	 */
+	class IWarpTable {
+		public:
+			IWarpTable();
+			IWarpTable( const Image& warp );
+			IWarpTable( const IWarpTable& other );
+			~IWarpTable();
+
+			IWarpTable& operator=( const IWarpTable& other );
+
+			void			set( const Image& warp );
+
+			size_t			width() const;
+			size_t			height() const;
+
+			const int16_t*	coords( size_t y ) const;
+			const uint16_t* fractions( size_t y ) const;
+
+			static const size_t FRACTION_BITS = 5;
+
+		private:
+			size_t				  _width;
+			size_t				  _height;
+			std::vector<int16_t>  _coords;
+			std::vector<uint16_t> _fractions;
+	};
+
+	inline size_t IWarpTable::width() const
+	{
+		return _width;
+	}
+
+	inline size_t IWarpTable::height() const
+	{
+		return _height;
+	}
+
+	inline const int16_t* IWarpTable::coords( size_t y ) const
+	{
+		return &_coords[ 2 * _width * y ];
+	}
+
+	inline const uint16_t* IWarpTable::fractions( size_t y ) const
+	{
+		return &_fractions[ _width * y ];
+	}
+}
+
+#endif
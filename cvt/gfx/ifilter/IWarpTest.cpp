@@ -0,0 +1,184 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/gfx/ifilter/IWarp.h>
+#include <cvt/gfx/ifilter/IWarpTable.h>
+#include <cvt/gfx/Image.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/util/SIMD.h>
+#include <cvt/util/CVTTest.h>
+#include <cvt/util/CVTTestImage.h>
+#include <string.h>
+
+using namespace cvt;
+
+static void _fillSmooth( Image& img )
+{
+	IMapScoped<uint8_t> map( img );
+	size_t c = img.bpp();
+	for( size_t y = 0; y < img.height(); y++ ) {
+		uint8_t* ptr = map.ptr();
+		for( size_t x = 0; x < img.width(); x++ ) {
+			for( size_t i = 0; i < c; i++ )
+				ptr[ x * c + i ] = ( uint8_t ) ( 127.5f + 127.0f * Math::sin( 0.05f * x + 0.07f * y + i ) );
+		}
+		map++;
+	}
+}
+
+static int _maxDifference( const Image& a, const Image& b )
+{
+	IMapScoped<const uint8_t> mapa( a );
+	IMapScoped<const uint8_t> mapb( b );
+	size_t bytes = a.width() * a.bpp();
+	int diff = 0;
+	for( size_t y = 0; y < a.height(); y++ ) {
+		for( size_t x = 0; x < bytes; x++ )
+			diff = Math::max( diff, Math::abs( ( int ) mapa.ptr()[ x ] - ( int ) mapb.ptr()[ x ] ) );
+		mapa++;
+		mapb++;
+	}
+	return diff;
+}
+
+/* rotation plus scale, partially outside of the source image */
+static void _createWarp( Image& warp, size_t w, size_t h )
+{
+	warp.reallocate( w, h, IFormat::GRAYALPHA_FLOAT );
+	IMapScoped<float> map( warp );
+	float c = Math::cos( 0.2f ) * 1.1f;
+	float s = Math::sin( 0.2f ) * 1.1f;
+	for( size_t y = 0; y < h; y++ ) {
+		float* ptr = map.ptr();
+		for( size_t x = 0; x < w; x++ ) {
+			*ptr++ = c * x - s * y + 15.3f;
+			*ptr++ = s * x + c * y - 20.7f;
+		}
+		map++;
+	}
+}
+
+static bool _tableTest( const IFormat& format )
+{
+	Image src( 320, 240, format );
+	Image warp, ref, out;
+
+	_fillSmooth( src );
+	_createWarp( warp, 301, 217 );
+	IWarpTable table( warp );
+
+	IWarp::apply( ref, src, warp );
+	IWarp::apply( out, src, table );
+
+	/* 1/64 pixel position error at the fill border plus the truncation of the float path */
+	return _maxDifference( ref, out ) <= 6;
+}
+
+static bool _simdTest( bool rgba )
+{
+	const size_t sw = 67, sh = 45, n = 203;
+	size_t bpp = rgba ? 4 : 1;
+	uint8_t* src = new uint8_t[ sw * sh * bpp ];
+	int16_t* coords = new int16_t[ 2 * n ];
+	uint16_t* frac = new uint16_t[ n ];
+	uint8_t* ref = new uint8_t[ n * bpp ];
+	uint8_t* out = new uint8_t[ n * bpp ];
+	bool result = true;
+
+	for( size_t i = 0; i < sw * sh * bpp; i++ )
+		src[ i ] = ( uint8_t ) Math::rand( 0, 255 );
+	for( size_t i = 0; i < n; i++ ) {
+		coords[ 2 * i ] = ( int16_t ) Math::rand( -3, sw + 2 );
+		coords[ 2 * i + 1 ] = ( int16_t ) Math::rand( -3, sh + 2 );
+		frac[ i ] = ( uint16_t ) Math::rand( 0, 1023 );
+	}
+
+	SIMD* base = SIMD::get( SIMD_BASE );
+	if( rgba )
+		base->warpBilinearFixed4u8( ref, coords, frac, src, sw * bpp, sw, sh, 0xff000000, n );
+	else
+		base->warpBilinearFixed1u8( ref, coords, frac, src, sw * bpp, sw, sh, 0, n );
+
+	SIMDType bestType = SIMD::bestSupportedType();
+	for( int st = SIMD_BASE; st <= bestType; st++ ) {
+		SIMD* simd = SIMD::get( ( SIMDType ) st );
+		memset( out, 0x55, n * bpp );
+		if( rgba )
+			simd->warpBilinearFixed4u8( out, coords, frac, src, sw * bpp, sw, sh, 0xff000000, n );
+		else
+			simd->warpBilinearFixed1u8( out, coords, frac, src, sw * bpp, sw, sh, 0, n );
+		if( memcmp( ref, out, n * bpp ) ) {
+			std::cout << simd->name() << " differs" << std::endl;
+			result = false;
+		}
+		delete simd;
+	}
+	delete base;
+
+	delete[] src;
+	delete[] coords;
+	delete[] frac;
+	delete[] ref;
+	delete[] out;
+	return result;
+}
+
+static bool _pyrdownTest( size_t w, size_t h )
+{
+	Image src( 320, 240, IFormat::GRAY_UINT8 );
+	Image warp, ref, refhalf, out, outhalf;
+
+	_fillSmooth( src );
+	_createWarp( warp, w, h );
+	IWarpTable table( warp );
+
+	IWarp::apply( ref, src, table );
+	ref.pyrdown( refhalf );
+	IWarp::applyPyrdown( out, outhalf, src, table );
+
+	return testEqualImages( ref, out ) && testEqualImages( refhalf, outhalf );
+}
+
+BEGIN_CVTTEST( IWarp )
+	bool result = true;
+	bool b;
+
+	b = _tableTest( IFormat::GRAY_UINT8 );
+	CVTTEST_PRINT( "fixed-point warp GRAY_UINT8", b );
+	result &= b;
+
+	b = _tableTest( IFormat::RGBA_UINT8 );
+	CVTTEST_PRINT( "fixed-point warp RGBA_UINT8", b );
+	result &= b;
+
+	b = _simdTest( false ) && _simdTest( true );
+	CVTTEST_PRINT( "fixed-point warp SIMD", b );
+	result &= b;
+
+	b = _pyrdownTest( 301, 217 ) && _pyrdownTest( 300, 216 ) && _pyrdownTest( 7, 4 );
+	CVTTEST_PRINT( "fused warp pyrdown", b );
+	result &= b;
+
+	return result;
+END_CVTTEST
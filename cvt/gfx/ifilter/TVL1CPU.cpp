@@ -0,0 +1,626 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/gfx/ifilter/TVL1CPU.h>
+#include <cvt/gfx/IScaleFilter.h>
+#include <cvt/util/ParallelFor.h>
+#include <cvt/util/ThreadPool.h>
+#include <cvt/util/Exception.h>
+#include <cvt/math/Math.h>
+
+#include <emmintrin.h>
+#include <string.h>
+
+namespace cvt {
+
+	/* mapped plane pointers of the current level, strides in floats */
+	struct TVL1CPU::Planes {
+		size_t			n;
+		size_t			width;
+		size_t			height;
+		size_t			stride;
+		float*			u[ 2 ];
+		float*			u0[ 2 ];
+		float*			px[ 2 ];
+		float*			py[ 2 ];
+		float*			it;
+		float*			g[ 2 ];
+		float*			w;
+		const float*	i1;
+		size_t			i1stride;
+		const float*	i2;
+		size_t			i2stride;
+
+		float* row( float* p, size_t y ) const { return p + y * stride; }
+	};
+
+	static inline float vmin( float a, float b ) { return a < b ? a : b; }
+	static inline float vmax( float a, float b ) { return a > b ? a : b; }
+	static inline __m128 vmin( __m128 a, __m128 b ) { return _mm_min_ps( a, b ); }
+	static inline __m128 vmax( __m128 a, __m128 b ) { return _mm_max_ps( a, b ); }
+
+	template<typename T>
+	static inline void sort2( T& a, T& b )
+	{
+		T t = a;
+		a = vmin( a, b );
+		b = vmax( t, b );
+	}
+
+	template<typename T>
+	static inline void sort3( T& a, T& b, T& c )
+	{
+		sort2( a, b );
+		sort2( b, c );
+		sort2( a, b );
+	}
+
+	template<typename T>
+	static inline T median9( T v0, T v1, T v2, T v3, T v4, T v5, T v6, T v7, T v8 )
+	{
+		sort3( v0, v1, v2 );
+		sort3( v3, v4, v5 );
+		sort3( v6, v7, v8 );
+		v3 = vmax( vmax( v0, v3 ), v6 );
+		v5 = vmin( vmin( v2, v5 ), v8 );
+		sort3( v1, v4, v7 );
+		sort3( v3, v4, v5 );
+		return v4;
+	}
+
+	static inline float medianAt( const float* r0, const float* r1, const float* r2, size_t x, size_t width )
+	{
+		size_t xl = x ? x - 1 : 0;
+		size_t xr = Math::min( x + 1, width - 1 );
+		return median9( r0[ xl ], r0[ x ], r0[ xr ], r1[ xl ], r1[ x ], r1[ xr ], r2[ xl ], r2[ x ], r2[ xr ] );
+	}
+
+	/* 3x3 median of the rows r0, r1, r2 with replicated left/right border */
+	static void medianRow( float* dst, const float* r0, const float* r1, const float* r2, size_t width )
+	{
+		size_t x;
+
+		dst[ 0 ] = medianAt( r0, r1, r2, 0, width );
+		for( x = 1; x + 4 < width; x += 4 ) {
+			__m128 m = median9( _mm_loadu_ps( r0 + x - 1 ), _mm_loadu_ps( r0 + x ), _mm_loadu_ps( r0 + x + 1 ),
+								_mm_loadu_ps( r1 + x - 1 ), _mm_loadu_ps( r1 + x ), _mm_loadu_ps( r1 + x + 1 ),
+								_mm_loadu_ps( r2 + x - 1 ), _mm_loadu_ps( r2 + x ), _mm_loadu_ps( r2 + x + 1 ) );
+			_mm_storeu_ps( dst + x, m );
+		}
+		for( ; x < width; x++ )
+			dst[ x ] = medianAt( r0, r1, r2, x, width );
+	}
+
+	/* thresholding of the linearised data term followed by u + theta * div( p ), backward differences */
+	static inline void thresholdPixel( float* const* v, size_t n, size_t x, const float* const* u, const float* const* u0,
+									   const float* const* px, const float* const* py, const float* const* pyPrev,
+									   const float* it, const float* const* g, float lt, float theta )
+	{
+		float rho = it[ x ];
+		float g2 = 0.0f;
+		for( size_t c = 0; c < n; c++ ) {
+			rho += g[ c ][ x ] * ( u[ c ][ x ] - u0[ c ][ x ] );
+			g2 += g[ c ][ x ] * g[ c ][ x ];
+		}
+		float s = Math::clamp( rho / Math::max( g2, 1e-4f ), -lt, lt );
+		for( size_t c = 0; c < n; c++ ) {
+			float div = px[ c ][ x ] - ( x ? px[ c ][ x - 1 ] : 0.0f ) + py[ c ][ x ] - pyPrev[ c ][ x ];
+			v[ c ][ x ] = u[ c ][ x ] - s * g[ c ][ x ] + theta * div;
+		}
+	}
+
+	static void thresholdRow( float* const* v, size_t n, size_t width, const float* const* u, const float* const* u0,
+							  const float* const* px, const float* const* py, const float* const* pyPrev,
+							  const float* it, const float* const* g, float lt, float theta )
+	{
+		const __m128 mlt = _mm_set1_ps( lt );
+		const __m128 mnlt = _mm_set1_ps( -lt );
+		const __m128 mtheta = _mm_set1_ps( theta );
+		const __m128 meps = _mm_set1_ps( 1e-4f );
+		size_t x;
+
+		thresholdPixel( v, n, 0, u, u0, px, py, pyPrev, it, g, lt, theta );
+		for( x = 1; x + 4 <= width; x += 4 ) {
+			__m128 rho = _mm_loadu_ps( it + x );
+			__m128 g2 = _mm_setzero_ps();
+			for( size_t c = 0; c < n; c++ ) {
+				__m128 gc = _mm_loadu_ps( g[ c ] + x );
+				rho = _mm_add_ps( rho, _mm_mul_ps( gc, _mm_sub_ps( _mm_loadu_ps( u[ c ] + x ), _mm_loadu_ps( u0[ c ] + x ) ) ) );
+				g2 = _mm_add_ps( g2, _mm_mul_ps( gc, gc ) );
+			}
+			__m128 s = _mm_min_ps( _mm_max_ps( _mm_div_ps( rho, _mm_max_ps( g2, meps ) ), mnlt ), mlt );
+			for( size_t c = 0; c < n; c++ ) {
+				__m128 div = _mm_add_ps( _mm_sub_ps( _mm_loadu_ps( px[ c ] + x ), _mm_loadu_ps( px[ c ] + x - 1 ) ),
+										 _mm_sub_ps( _mm_loadu_ps( py[ c ] + x ), _mm_loadu_ps( pyPrev[ c ] + x ) ) );
+				__m128 val = _mm_sub_ps( _mm_loadu_ps( u[ c ] + x ), _mm_mul_ps( s, _mm_loadu_ps( g[ c ] + x ) ) );
+				_mm_storeu_ps( v[ c ] + x, _mm_add_ps( val, _mm_mul_ps( mtheta, div ) ) );
+			}
+		}
+		for( ; x < width; x++ )
+			thresholdPixel( v, n, x, u, u0, px, py, pyPrev, it, g, lt, theta );
+	}
+
+	/* Huber-TV dual step with forward differences and the weighted joint projection |p| <= w */
+	static void dualRow( float* const* px, float* const* py, const float* const* v, const float* const* vNext,
+						 const float* w, size_t n, size_t width, float tau, float eps )
+	{
+		const float decay = 1.0f - tau * eps;
+		const __m128 mdecay = _mm_set1_ps( decay );
+		const __m128 mtau = _mm_set1_ps( tau );
+		const __m128 mone = _mm_set1_ps( 1.0f );
+		size_t x;
+
+		for( x = 0; x + 4 < width; x += 4 ) {
+			__m128 nx[ 2 ], ny[ 2 ];
+			__m128 norm = _mm_setzero_ps();
+			for( size_t c = 0; c < n; c++ ) {
+				__m128 vc = _mm_loadu_ps( v[ c ] + x );
+				__m128 gx = _mm_sub_ps( _mm_loadu_ps( v[ c ] + x + 1 ), vc );
+				__m128 gy = _mm_sub_ps( _mm_loadu_ps( vNext[ c ] + x ), vc );
+				nx[ c ] = _mm_add_ps( _mm_mul_ps( _mm_loadu_ps( px[ c ] + x ), mdecay ), _mm_mul_ps( mtau, gx ) );
+				ny[ c ] = _mm_add_ps( _mm_mul_ps( _mm_loadu_ps( py[ c ] + x ), mdecay ), _mm_mul_ps( mtau, gy ) );
+				norm = _mm_add_ps( norm, _mm_add_ps( _mm_mul_ps( nx[ c ], nx[ c ] ), _mm_mul_ps( ny[ c ], ny[ c ] ) ) );
+			}
+			__m128 scale = _mm_div_ps( mone, _mm_max_ps( mone, _mm_div_ps( _mm_sqrt_ps( norm ), _mm_loadu_ps( w + x ) ) ) );
+			for( size_t c = 0; c < n; c++ ) {
+				_mm_storeu_ps( px[ c ] + x, _mm_mul_ps( nx[ c ], scale ) );
+				_mm_storeu_ps( py[ c ] + x, _mm_mul_ps( ny[ c ], scale ) );
+			}
+		}
+		for( ; x < width; x++ ) {
+			float nx[ 2 ], ny[ 2 ];
+			float norm = 0.0f;
+			for( size_t c = 0; c < n; c++ ) {
+				float gx = x + 1 < width ? v[ c ][ x + 1 ] - v[ c ][ x ] : 0.0f;
+				float gy = vNext[ c ][ x ] - v[ c ][ x ];
+				nx[ c ] = px[ c ][ x ] * decay + tau * gx;
+				ny[ c ] = py[ c ][ x ] * decay + tau * gy;
+				norm += nx[ c ] * nx[ c ] + ny[ c ] * ny[ c ];
+			}
+			float scale = 1.0f / Math::max( 1.0f, Math::sqrt( norm ) / w[ x ] );
+			for( size_t c = 0; c < n; c++ ) {
+				px[ c ][ x ] = nx[ c ] * scale;
+				py[ c ][ x ] = ny[ c ] * scale;
+			}
+		}
+	}
+
+	static inline float sampleBilinear( const float* img, size_t stride, size_t width, size_t height, float x, float y )
+	{
+		x = Math::clamp( x, 0.0f, ( float ) ( width - 1 ) );
+		y = Math::clamp( y, 0.0f, ( float ) ( height - 1 ) );
+		size_t x0 = ( size_t ) x;
+		size_t y0 = ( size_t ) y;
+		size_t x1 = Math::min( x0 + 1, width - 1 );
+		size_t y1 = Math::min( y0 + 1, height - 1 );
+		float ax = x - ( float ) x0;
+		float ay = y - ( float ) y0;
+		const float* r0 = img + y0 * stride;
+		const float* r1 = img + y1 * stride;
+		float top = Math::mix( r0[ x0 ], r0[ x1 ], ax );
+		float bottom = Math::mix( r1[ x0 ], r1[ x1 ], ax );
+		return Math::mix( top, bottom, ay );
+	}
+
+	/* copies the rows of the neighbouring bands read by a sweep, before any band modifies them */
+	class TVL1CPU::SnapshotBody {
+		public:
+			SnapshotBody( TVL1CPU& tvl1, const Planes& planes ) : _tvl1( tvl1 ), _p( planes )
+			{
+			}
+
+			void operator()( const Range<size_t>& r ) const
+			{
+				const size_t n = _p.n;
+				const size_t w = _p.width;
+				for( size_t b = r.min; b < r.max; b++ ) {
+					Band& band = _tvl1._bands[ b ];
+					float* halo = &band.halo[ 0 ];
+					if( band.y0 > 0 ) {
+						size_t y = band.y0 - 1;
+						for( size_t c = 0; c < n; c++ ) {
+							memcpy( halo + ( 0 * n + c ) * w, _p.row( _p.u[ c ], y ), sizeof( float ) * w );
+							memcpy( halo + ( 1 * n + c ) * w, _p.row( _p.px[ c ], y ), sizeof( float ) * w );
+							memcpy( halo + ( 2 * n + c ) * w, _p.row( _p.py[ c ], y ), sizeof( float ) * w );
+							if( y > 0 )
+								memcpy( halo + ( 3 * n + c ) * w, _p.row( _p.py[ c ], y - 1 ), sizeof( float ) * w );
+						}
+					}
+					if( band.y1 < _p.height ) {
+						size_t y = band.y1;
+						for( size_t c = 0; c < n; c++ ) {
+							memcpy( halo + ( 4 * n + c ) * w, _p.row( _p.u[ c ], y ), sizeof( float ) * w );
+							memcpy( halo + ( 5 * n + c ) * w, _p.row( _p.px[ c ], y ), sizeof( float ) * w );
+							memcpy( halo + ( 6 * n + c ) * w, _p.row( _p.py[ c ], y ), sizeof( float ) * w );
+						}
+					}
+				}
+			}
+
+		private:
+			TVL1CPU&		_tvl1;
+			const Planes&	_p;
+	};
+
+	/*
+	   One fused iteration over a band: for row y the primal v( y + 1 ) is computed from the old dual
+	   variables, then p( y ) is updated and u( y ) is set to the median of v( y - 1 ... y + 1 ).
+	 */
+	class TVL1CPU::SweepBody {
+		public:
+			SweepBody( TVL1CPU& tvl1, const Planes& planes, float lambdaTheta, float theta, float tau, float eps ) :
+				_tvl1( tvl1 ), _p( planes ), _lt( lambdaTheta ), _theta( theta ), _tau( tau ), _eps( eps )
+			{
+			}
+
+			void operator()( const Range<size_t>& r ) const
+			{
+				for( size_t b = r.min; b < r.max; b++ )
+					sweep( _tvl1._bands[ b ] );
+			}
+
+		private:
+			void computeV( Band& band, size_t slot, size_t y ) const
+			{
+				const size_t n = _p.n;
+				const size_t w = _p.width;
+				float* halo = &band.halo[ 0 ];
+				const float* zero = halo + 7 * n * w;
+				float* v[ 2 ];
+				const float* u[ 2 ];
+				const float* u0[ 2 ];
+				const float* px[ 2 ];
+				const float* py[ 2 ];
+				const float* pyPrev[ 2 ];
+				const float* g[ 2 ];
+
+				for( size_t c = 0; c < n; c++ ) {
+					v[ c ] = &band.v[ ( slot * n + c ) * w ];
+					u0[ c ] = _p.row( _p.u0[ c ], y );
+					g[ c ] = _p.row( _p.g[ c ], y );
+					if( y < band.y0 ) {
+						u[ c ] = halo + ( 0 * n + c ) * w;
+						px[ c ] = halo + ( 1 * n + c ) * w;
+						py[ c ] = halo + ( 2 * n + c ) * w;
+						pyPrev[ c ] = y ? halo + ( 3 * n + c ) * w : zero;
+					} else if( y >= band.y1 ) {
+						u[ c ] = halo + ( 4 * n + c ) * w;
+						px[ c ] = halo + ( 5 * n + c ) * w;
+						py[ c ] = halo + ( 6 * n + c ) * w;
+						pyPrev[ c ] = _p.row( _p.py[ c ], y - 1 );
+					} else {
+						u[ c ] = _p.row( _p.u[ c ], y );
+						px[ c ] = _p.row( _p.px[ c ], y );
+						py[ c ] = _p.row( _p.py[ c ], y );
+						if( y == band.y0 )
+							pyPrev[ c ] = y ? halo + ( 2 * n + c ) * w : zero;
+						else
+							pyPrev[ c ] = _p.row( _p.py[ c ], y - 1 );
+					}
+				}
+				thresholdRow( v, n, w, u, u0, px, py, pyPrev, _p.row( _p.it, y ), g, _lt, _theta );
+			}
+
+			void sweep( Band& band ) const
+			{
+				const size_t n = _p.n;
+				const size_t w = _p.width;
+				size_t prev = 0, cur = 1, next = 2;
+				bool hasPrev = band.y0 > 0;
+
+				if( hasPrev )
+					computeV( band, prev, band.y0 - 1 );
+				computeV( band, cur, band.y0 );
+
+				for( size_t y = band.y0; y < band.y1; y++ ) {
+					bool hasNext = y + 1 < _p.height;
+					if( hasNext )
+						computeV( band, next, y + 1 );
+
+					const float* vc[ 2 ];
+					const float* vp[ 2 ];
+					const float* vn[ 2 ];
+					float* px[ 2 ];
+					float* py[ 2 ];
+					for( size_t c = 0; c < n; c++ ) {
+						vc[ c ] = &band.v[ ( cur * n + c ) * w ];
+						vp[ c ] = hasPrev ? &band.v[ ( prev * n + c ) * w ] : vc[ c ];
+						vn[ c ] = hasNext ? &band.v[ ( next * n + c ) * w ] : vc[ c ];
+						px[ c ] = _p.row( _p.px[ c ], y );
+						py[ c ] = _p.row( _p.py[ c ], y );
+					}
+
+					dualRow( px, py, vc, vn, _p.row( _p.w, y ), n, w, _tau, _eps );
+					for( size_t c = 0; c < n; c++ )
+						medianRow( _p.row( _p.u[ c ], y ), vp[ c ], vc[ c ], vn[ c ], w );
+
+					size_t tmp = prev;
+					prev = cur;
+					cur = next;
+					next = tmp;
+					hasPrev = true;
+				}
+			}
+
+			TVL1CPU&		_tvl1;
+			const Planes&	_p;
+			float			_lt;
+			float			_theta;
+			float			_tau;
+			float			_eps;
+	};
+
+	/* u0 = median3( u ) */
+	class TVL1CPU::MedianBody {
+		public:
+			MedianBody( const Planes& planes ) : _p( planes )
+			{
+			}
+
+			void operator()( const Range<size_t>& r ) const
+			{
+				for( size_t y = r.min; y < r.max; y++ ) {
+					size_t ym = y ? y - 1 : 0;
+					size_t yp = Math::min( y + 1, _p.height - 1 );
+					for( size_t c = 0; c < _p.n; c++ )
+						medianRow( _p.row( _p.u0[ c ], y ), _p.row( _p.u[ c ], ym ), _p.row( _p.u[ c ], y ), _p.row( _p.u[ c ], yp ), _p.width );
+				}
+			}
+
+		private:
+			const Planes&	_p;
+	};
+
+	/* linearisation of the data term at u0: It, the mixed gradient and the edge weight */
+	class TVL1CPU::WarpBody {
+		public:
+			WarpBody( const Planes& planes, float beta, float mix ) : _p( planes ), _beta( beta ), _mix( mix )
+			{
+			}
+
+			void operator()( const Range<size_t>& r ) const
+			{
+				const size_t w = _p.width;
+				const size_t h = _p.height;
+				const float maxx = ( float ) ( w - 1 );
+				const float maxy = ( float ) ( h - 1 );
+
+				for( size_t y = r.min; y < r.max; y++ ) {
+					const float* r1 = _p.i1 + y * _p.i1stride;
+					const float* r1m = _p.i1 + ( y ? y - 1 : 0 ) * _p.i1stride;
+					const float* r1p = _p.i1 + Math::min( y + 1, h - 1 ) * _p.i1stride;
+					const float* ux = _p.row( _p.u0[ 0 ], y );
+					const float* uy = _p.n == 2 ? _p.row( _p.u0[ 1 ], y ) : NULL;
+					float* it = _p.row( _p.it, y );
+					float* gx = _p.row( _p.g[ 0 ], y );
+					float* gy = _p.n == 2 ? _p.row( _p.g[ 1 ], y ) : NULL;
+					float* weight = _p.row( _p.w, y );
+
+					for( size_t x = 0; x < w; x++ ) {
+						float d1x = r1[ Math::min( x + 1, w - 1 ) ] - r1[ x ? x - 1 : 0 ];
+						float d1y = r1p[ x ] - r1m[ x ];
+						float e = Math::abs( d1x ) + ( gy ? Math::abs( d1y ) : 0.0f );
+						weight[ x ] = Math::max( 1e-4f, Math::exp( -_beta * e ) );
+
+						float xs = ( float ) x + ux[ x ];
+						float ys = ( float ) y + ( uy ? uy[ x ] : 0.0f );
+						if( xs < 0.0f || xs > maxx || ys < 0.0f || ys > maxy ) {
+							it[ x ] = 0.0f;
+							gx[ x ] = 0.0f;
+							if( gy )
+								gy[ x ] = 0.0f;
+							continue;
+						}
+
+						float warped = sampleBilinear( _p.i2, _p.i2stride, w, h, xs, ys );
+						float d2x = sampleBilinear( _p.i2, _p.i2stride, w, h, xs + 1.0f, ys ) - sampleBilinear( _p.i2, _p.i2stride, w, h, xs - 1.0f, ys );
+						it[ x ] = warped - r1[ x ];
+						gx[ x ] = 0.5f * ( d2x + ( d1x - d2x ) * _mix );
+						if( gy ) {
+							float d2y = sampleBilinear( _p.i2, _p.i2stride, w, h, xs, ys + 1.0f ) - sampleBilinear( _p.i2, _p.i2stride, w, h, xs, ys - 1.0f );
+							gy[ x ] = 0.5f * ( d2y + ( d1y - d2y ) * _mix );
+						}
+					}
+				}
+			}
+
+		private:
+			const Planes&	_p;
+			float			_beta;
+			float			_mix;
+	};
+
+	static void clearPlane( Image& img )
+	{
+		size_t stride;
+		uint8_t* ptr = img.map( &stride );
+		memset( ptr, 0, stride * img.height() );
+		img.unmap( ptr );
+	}
+
+	TVL1CPU::TVL1CPU( size_t components, const Parameters& params ) :
+		_components( components ),
+		_params( params ),
+		_width( 0 ),
+		_height( 0 )
+	{
+		if( components != 1 && components != 2 )
+			throw CVTException( "TVL1CPU supports one or two components" );
+	}
+
+	void TVL1CPU::apply( Image& flow, const Image& src1, const Image& src2, float scalefactor, size_t levels )
+	{
+		if( src1.width() != src2.width() ||
+			src1.height() != src2.height() )
+			throw CVTException( "Image do not match in size!" );
+
+		levels = Math::max<size_t>( levels, 1 );
+		std::vector<Image> pyr1( levels ), pyr2( levels );
+		src1.convert( pyr1[ 0 ], IFormat::GRAY_FLOAT );
+		src2.convert( pyr2[ 0 ], IFormat::GRAY_FLOAT );
+		for( size_t l = 1; l < levels; l++ ) {
+			size_t w = Math::max<size_t>( ( size_t ) ( pyr1[ l - 1 ].width() * scalefactor ), 1 );
+			size_t h = _components == 2 ? Math::max<size_t>( ( size_t ) ( pyr1[ l - 1 ].height() * scalefactor ), 1 ) : pyr1[ l - 1 ].height();
+			pyr1[ l - 1 ].scale( pyr1[ l ], w, h, IScaleFilterBilinear() );
+			pyr2[ l - 1 ].scale( pyr2[ l ], w, h, IScaleFilterBilinear() );
+		}
+
+		for( int l = ( int ) levels - 1; l >= 0; l-- ) {
+			size_t w = pyr1[ l ].width();
+			size_t h = pyr1[ l ].height();
+
+			if( l == ( int ) levels - 1 ) {
+				allocateLevel( w, h );
+				for( size_t c = 0; c < _components; c++ )
+					clearPlane( _u[ c ] );
+			} else {
+				Image up[ 2 ];
+				float ratio[ 2 ] = { ( float ) w / ( float ) _width, ( float ) h / ( float ) _height };
+				for( size_t c = 0; c < _components; c++ ) {
+					_u[ c ].scale( up[ c ], w, h, IScaleFilterBilinear() );
+					up[ c ].mul( ratio[ c ] );
+				}
+				allocateLevel( w, h );
+				for( size_t c = 0; c < _components; c++ )
+					_u[ c ] = up[ c ];
+			}
+
+			solveLevel( pyr1[ l ], pyr2[ l ] );
+		}
+
+		flow.reallocate( _width, _height, _components == 2 ? IFormat::GRAYALPHA_FLOAT : IFormat::GRAY_FLOAT );
+		size_t dstride, stride[ 2 ];
+		float* dst = flow.map<float>( &dstride );
+		const float* src[ 2 ];
+		for( size_t c = 0; c < _components; c++ )
+			src[ c ] = _u[ c ].map<float>( &stride[ c ] );
+
+		for( size_t y = 0; y < _height; y++ ) {
+			float* drow = dst + y * dstride;
+			for( size_t c = 0; c < _components; c++ ) {
+				const float* srow = src[ c ] + y * stride[ c ];
+				for( size_t x = 0; x < _width; x++ )
+					drow[ x * _components + c ] = srow[ x ];
+			}
+		}
+
+		for( size_t c = 0; c < _components; c++ )
+			_u[ c ].unmap( src[ c ] );
+		flow.unmap( dst );
+	}
+
+	void TVL1CPU::allocateLevel( size_t width, size_t height )
+	{
+		_width = width;
+		_height = height;
+
+		for( size_t c = 0; c < _components; c++ ) {
+			_u[ c ].reallocate( width, height, IFormat::GRAY_FLOAT );
+			_u0[ c ].reallocate( width, height, IFormat::GRAY_FLOAT );
+			_px[ c ].reallocate( width, height, IFormat::GRAY_FLOAT );
+			_py[ c ].reallocate( width, height, IFormat::GRAY_FLOAT );
+		}
+		for( size_t i = 0; i < 4; i++ )
+			_warp[ i ].reallocate( width, height, IFormat::GRAY_FLOAT );
+
+		/* a few bands per thread, but not so thin that the halo rows dominate */
+		size_t threads = ThreadPool::hardwareConcurrency();
+		size_t rows = Math::max<size_t>( 16, ( height + 4 * threads - 1 ) / ( 4 * threads ) );
+		size_t nbands = ( height + rows - 1 ) / rows;
+		_bands.resize( nbands );
+		for( size_t b = 0; b < nbands; b++ ) {
+			_bands[ b ].y0 = b * rows;
+			_bands[ b ].y1 = Math::min( height, ( b + 1 ) * rows );
+			_bands[ b ].v.assign( 3 * _components * width, 0.0f );
+			_bands[ b ].halo.assign( ( 7 * _components + 1 ) * width, 0.0f );
+		}
+	}
+
+	void TVL1CPU::solveLevel( const Image& i1, const Image& i2 )
+	{
+		const size_t n = _components;
+		Planes p;
+		size_t stride;
+
+		for( size_t c = 0; c < n; c++ ) {
+			clearPlane( _px[ c ] );
+			clearPlane( _py[ c ] );
+		}
+
+		p.n = n;
+		p.width = _width;
+		p.height = _height;
+		p.stride = 0;
+		for( size_t c = 0; c < n; c++ ) {
+			p.u[ c ] = _u[ c ].map<float>( &stride );
+			p.stride = stride;
+			p.u0[ c ] = _u0[ c ].map<float>( &stride );
+			p.px[ c ] = _px[ c ].map<float>( &stride );
+			p.py[ c ] = _py[ c ].map<float>( &stride );
+		}
+		p.it = _warp[ 0 ].map<float>( &stride );
+		p.g[ 0 ] = _warp[ 1 ].map<float>( &stride );
+		p.g[ 1 ] = _warp[ 2 ].map<float>( &stride );
+		p.w = _warp[ 3 ].map<float>( &stride );
+		/* all planes share format and width and therefore the stride */
+		if( stride != p.stride )
+			throw CVTException( "TVL1CPU: unexpected plane stride" );
+		p.i1 = i1.map<float>( &p.i1stride );
+		p.i2 = i2.map<float>( &p.i2stride );
+
+		const float theta = _params.theta;
+		const float tau = 1.0f / ( 4.0f * ( float ) n * theta );
+		const Range<size_t> rows( 0, _height );
+		const Range<size_t> bands( 0, _bands.size() );
+
+		for( size_t i = 0; i < _params.warps; i++ ) {
+			parallelFor( rows, MedianBody( p ) );
+			parallelFor( rows, WarpBody( p, _params.beta, _params.gradientMix ) );
+
+			for( size_t k = 0; k < _params.iterations; k++ ) {
+				float lambda = _params.lambda;
+				if( _params.annealLambda ) {
+					float t = ( float ) k / ( float ) _params.iterations;
+					lambda *= Math::exp( -t * t * 6.0f );
+				}
+				parallelFor( bands, SnapshotBody( *this, p ), 1 );
+				parallelFor( bands, SweepBody( *this, p, lambda * theta, theta, tau, _params.epsilon ), 1 );
+			}
+		}
+
+		i2.unmap( p.i2 );
+		i1.unmap( p.i1 );
+		_warp[ 3 ].unmap( p.w );
+		_warp[ 2 ].unmap( p.g[ 1 ] );
+		_warp[ 1 ].unmap( p.g[ 0 ] );
+		_warp[ 0 ].unmap( p.it );
+		for( size_t c = 0; c < n; c++ ) {
+			_py[ c ].unmap( p.py[ c ] );
+			_px[ c ].unmap( p.px[ c ] );
+			_u0[ c ].unmap( p.u0[ c ] );
+			_u[ c ].unmap( p.u[ c ] );
+		}
+	}
+
+}
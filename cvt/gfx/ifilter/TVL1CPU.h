@@ -0,0 +1,93 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_TVL1CPU_H
+#define CVT_TVL1CPU_H
+
+#include <cvt/gfx/Image.h>
+
+#include <vector>
+
+namespace cvt {
+
+	/**
+	  @brief Coarse-to-fine TV-L1 solver on the CPU, shared by TVL1Flow and TVL1Stereo.
+
+	  Solves for one ( horizontal disparity ) or two ( optical flow ) components with the same scheme as the
+	  OpenCL kernels: per warp the data term is linearised, then thresholding, the edge weighted ( Huber ) TV
+	  dual step and a 3x3 median are applied. These three steps of an iteration are fused into a single
+	  sweep over the rows of an image band, the bands are processed in parallel.
+	 */
+	class TVL1CPU {
+		public:
+			struct Parameters {
+				float	lambda;
+				float	theta;
+				float	epsilon;		/* Huber epsilon */
+				float	beta;			/* edge weight exp( -beta * |grad I| ) */
+				float	gradientMix;	/* weight of the first image in the linearisation gradient */
+				size_t	warps;
+				size_t	iterations;
+				bool	annealLambda;	/* reduce lambda over the iterations of a warp */
+			};
+
+			TVL1CPU( size_t components, const Parameters& params );
+
+			/* flow: GRAYALPHA_FLOAT for two components, GRAY_FLOAT for one */
+			void apply( Image& flow, const Image& src1, const Image& src2, float scalefactor, size_t levels );
+
+		private:
+			struct Band {
+				size_t				y0, y1;
+				std::vector<float>	v;		// ring of three rows per component
+				std::vector<float>	halo;	// rows owned by the neighbouring bands
+			};
+
+			struct Planes;
+
+			class SnapshotBody;
+			class SweepBody;
+			class MedianBody;
+			class WarpBody;
+
+			void	solveLevel( const Image& i1, const Image& i2 );
+			void	allocateLevel( size_t width, size_t height );
+
+			size_t				_components;
+			Parameters			_params;
+
+			size_t				_width;
+			size_t				_height;
+			/* planes: u, u0 and dual p ( x, y ) per component, warp: It, Ix, Iy, weight */
+			Image				_u[ 2 ];
+			Image				_u0[ 2 ];
+			Image				_px[ 2 ];
+			Image				_py[ 2 ];
+			Image				_warp[ 4 ];
+			std::vector<Band>	_bands;
+	};
+
+}
+
+#endif
@@ -0,0 +1,113 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/gfx/ifilter/TVL1Flow.h>
+#include <cvt/gfx/ifilter/TVL1Stereo.h>
+#include <cvt/gfx/Image.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/util/CVTTest.h>
+
+using namespace cvt;
+
+/* smooth texture translated by ( dx, dy ), so that I2( x + dx, y + dy ) = I1( x, y ) */
+static void _fillShifted( Image& img, float dx, float dy )
+{
+	img.reallocate( 96, 80, IFormat::GRAY_FLOAT );
+	IMapScoped<float> map( img );
+	for( size_t y = 0; y < img.height(); y++ ) {
+		float* ptr = map.ptr();
+		for( size_t x = 0; x < img.width(); x++ ) {
+			float fx = ( float ) x - dx;
+			float fy = ( float ) y - dy;
+			ptr[ x ] = 0.5f + 0.2f * Math::sin( 0.11f * fx + 0.07f * fy ) + 0.15f * Math::cos( 0.05f * fx - 0.13f * fy );
+		}
+		map++;
+	}
+}
+
+/* mean of each component over the interior, away from the occluded borders */
+static void _meanInterior( const Image& flow, size_t components, float* mean )
+{
+	IMapScoped<const float> map( flow );
+	size_t border = 12, count = 0;
+	mean[ 0 ] = mean[ 1 ] = 0.0f;
+	map.setLine( border );
+	for( size_t y = border; y < flow.height() - border; y++ ) {
+		const float* ptr = map.ptr();
+		for( size_t x = border; x < flow.width() - border; x++ ) {
+			for( size_t c = 0; c < components; c++ )
+				mean[ c ] += ptr[ x * components + c ];
+			count++;
+		}
+		map++;
+	}
+	for( size_t c = 0; c < components; c++ )
+		mean[ c ] /= ( float ) count;
+}
+
+BEGIN_CVTTEST( TVL1CPU )
+	bool result = true;
+	bool b;
+	Image i1, i2, flow;
+	float mean[ 2 ];
+
+	_fillShifted( i1, 0.0f, 0.0f );
+	_fillShifted( i2, 1.3f, -0.7f );
+	TVL1Flow tvl1flow( 0.5f, 3 );
+	tvl1flow.apply( flow, i1, i2, IFILTER_CPU );
+	_meanInterior( flow, 2, mean );
+	b = flow.format() == IFormat::GRAYALPHA_FLOAT && flow.width() == i1.width() && flow.height() == i1.height();
+	b &= Math::abs( mean[ 0 ] - 1.3f ) < 0.15f && Math::abs( mean[ 1 ] + 0.7f ) < 0.15f;
+	CVTTEST_PRINT( "TVL1Flow CPU translation", b );
+	if( !b )
+		std::cerr << "mean flow: " << mean[ 0 ] << " " << mean[ 1 ] << std::endl;
+	result &= b;
+
+	_fillShifted( i2, 2.4f, 0.0f );
+	TVL1Stereo tvl1stereo( 0.5f, 3 );
+	tvl1stereo.apply( flow, i1, i2, IFILTER_CPU );
+	_meanInterior( flow, 1, mean );
+	b = flow.format() == IFormat::GRAY_FLOAT && flow.width() == i1.width() && flow.height() == i1.height();
+	b &= Math::abs( mean[ 0 ] - 2.4f ) < 0.15f;
+	CVTTEST_PRINT( "TVL1Stereo CPU translation", b );
+	if( !b )
+		std::cerr << "mean disparity: " << mean[ 0 ] << std::endl;
+	result &= b;
+
+	Image pflow;
+	const IFilter& filter = tvl1stereo;
+	ParamSet* set = filter.parameterSet();
+	set->setArg<Image*>( set->paramHandle( "Input0" ), &i1 );
+	set->setArg<Image*>( set->paramHandle( "Input1" ), &i2 );
+	set->setArg<Image*>( set->paramHandle( "Output" ), &pflow );
+	filter.apply( set, IFILTER_CPU );
+	delete set;
+	_meanInterior( pflow, 1, mean );
+	b = pflow.format() == IFormat::GRAY_FLOAT && pflow.width() == i1.width() && pflow.height() == i1.height();
+	b &= Math::abs( mean[ 0 ] - 2.4f ) < 0.15f;
+	CVTTEST_PRINT( "TVL1Stereo ParamSet apply", b );
+	result &= b;
+
+	return result;
+END_CVTTEST
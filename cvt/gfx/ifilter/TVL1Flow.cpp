@@ -37,27 +37,37 @@
 #include <cvt/vision/Flow.h>
 
 namespace cvt {
-		static ParamInfoTyped<Image*> pin( "Input", true );
+		static ParamInfoTyped<Image*> pin0( "Input0", true );
+		static ParamInfoTyped<Image*> pin1( "Input1", true );
 		static ParamInfoTyped<Image*> pout( "Output", false );
 
-		static ParamInfo * _params[ 2 ] = {
-			&pin,
+		static ParamInfo * _params[ 3 ] = {
+			&pin0,
+			&pin1,
 			&pout,
 		};
 
-		TVL1Flow::TVL1Flow( float scalefactor, size_t levels ) : IFilter( "TVL1Flow", _params, 2, IFILTER_OPENCL ),
+		static TVL1CPU::Parameters flowParameters()
+		{
+			TVL1CPU::Parameters p;
+			p.lambda = 70.0f;
+			p.theta = 0.08f;
+			p.epsilon = 0.04f;
+			p.beta = 15.0f;
+			p.gradientMix = 0.0f;
+			p.warps = 5;
+			p.iterations = 10;
+			p.annealLambda = true;
+			return p;
+		}
+
+		TVL1Flow::TVL1Flow( float scalefactor, size_t levels ) : IFilter( "TVL1Flow", _params, 3, IFILTER_CPU | IFILTER_OPENCL ),
 			_toggle( false ),
 			_scalefactor( scalefactor ),
 			_levels( levels ),
-			_pyrup( _pyrupmul_source, "pyrup_mul" ),
-//			_pyrdown( _pyrdown_source, "pyrdown" ),
-			_pyrdown( _pyrdown_source, "pyrdown" ),
-			_tvl1( _tvl1_source, "tvl1" ),
-			_tvl1_warp( _tvl1_warp_source, "tvl1_warp" ),
-//			_tvl1_dataadd( _tvl1_dataadd_source, "tvl1_dataadd" ),
-			_clear( _clear_source, "clear" ),
-			_median3( _median3_source, "median3" ),
-			_lambda( 70.0f )
+			_lambda( 70.0f ),
+			_clInitialized( false ),
+			_cpu( 2, flowParameters() )
 		{
 			_pyr[ 0 ] = new Image[ levels ];
 			_pyr[ 1 ] = new Image[ levels ];
@@ -69,12 +79,33 @@ namespace cvt {
 			delete[ ] _pyr[ 1 ];
 		}
 
-		void TVL1Flow::apply( Image& output, const Image& src1, const Image& src2 )
+		/* the kernels are built on first use, so CPU-only users never touch OpenCL */
+		void TVL1Flow::initCL() const
+		{
+			if( _clInitialized )
+				return;
+			_pyrup = CLKernel( _pyrupmul_source, "pyrup_mul" );
+			_pyrdown = CLKernel( _pyrdown_source, "pyrdown" );
+			_tvl1 = CLKernel( _tvl1_source, "tvl1" );
+			_tvl1_warp = CLKernel( _tvl1_warp_source, "tvl1_warp" );
+			_clear = CLKernel( _clear_source, "clear" );
+			_median3 = CLKernel( _median3_source, "median3" );
+			_clInitialized = true;
+		}
+
+		void TVL1Flow::apply( Image& output, const Image& src1, const Image& src2, IFilterType type ) const
 		{
 			if( src1.width() != src2.width() ||
 			    src1.height() != src2.height() )
 				throw CVTException( "Image do not match in size!" );
 
+			if( type == IFILTER_CPU ) {
+				_cpu.apply( output, src1, src2, _scalefactor, _levels );
+				return;
+			}
+
+			initCL();
+
 			fillPyramidCL( src1, 0 );
 			fillPyramidCL( src2, 1 );
 
@@ -121,7 +152,23 @@ namespace cvt {
 			delete flow;
 		}
 
-		void TVL1Flow::solveTVL1( Image& flow, const Image& src1, const Image& src2, bool median )
+		void TVL1Flow::apply( const ParamSet* set, IFilterType t ) const
+		{
+			Image* in0 = set->arg<Image*>( 0 );
+			Image* in1 = set->arg<Image*>( 1 );
+			Image* out = set->arg<Image*>( 2 );
+
+			switch( t ) {
+				case IFILTER_CPU:
+				case IFILTER_OPENCL:
+					this->apply( *out, *in0, *in1, t );
+					break;
+				default:
+					throw CVTException( "Not implemented" );
+			}
+		}
+
+		void TVL1Flow::solveTVL1( Image& flow, const Image& src1, const Image& src2, bool median ) const
 		{
 			Image flowtmp( flow.width(), flow.height(), IFormat::GRAYALPHA_FLOAT, IALLOCATOR_CL );
 			Image flow0( flow.width(), flow.height(), IFormat::GRAYALPHA_FLOAT, IALLOCATOR_CL );
@@ -214,7 +261,7 @@ namespace cvt {
 					flow = *us[ 1 ];
 		}
 
-		void TVL1Flow::fillPyramidCL( const Image& img, size_t index )
+		void TVL1Flow::fillPyramidCL( const Image& img, size_t index ) const
 		{
 			Image* pyr = _pyr[ index ];
 
@@ -28,6 +28,7 @@
 #include <cvt/gfx/IFilter.h>
 //#include <cvt/gfx/ifilter/ROFFGPFilter.h>
 //#include <cvt/gfx/ifilter/GuidedFilter.h>
+#include <cvt/gfx/ifilter/TVL1CPU.h>
 #include <cvt/cl/CLKernel.h>
 
 namespace cvt {
@@ -35,27 +36,31 @@ namespace cvt {
 		public:
 			TVL1Flow( float scalefactor, size_t levels );
 			~TVL1Flow();
-			void apply( Image& flow, const Image& src1, const Image& src2 );
-			void apply( const ParamSet* set, IFilterType t = IFILTER_CPU ) const {};
+			void apply( Image& flow, const Image& src1, const Image& src2, IFilterType type = IFILTER_OPENCL ) const;
+			/* Input0, Input1 and Output as in apply( flow, src1, src2, type ) */
+			void apply( const ParamSet* set, IFilterType t = IFILTER_CPU ) const;
 
 		private:
-			void fillPyramidCL( const Image& img, size_t index );
-			void solveTVL1( Image& flow, const Image& src1, const Image& src2, bool median );
-
-			bool		 _toggle;
-			float		 _scalefactor;
-			size_t		 _levels;
-			CLKernel	 _pyrup;
-			CLKernel	 _pyrdown;
-			CLKernel	 _tvl1;
-			CLKernel	 _tvl1_warp;
-//			CLKernel	 _tvl1_dataadd;
-			CLKernel	 _clear;
-			CLKernel	 _median3;
-			float		 _lambda;
-//			ROFFGPFilter _rof;
-//			GuidedFilter _gf;
-			Image*		 _pyr[ 2 ];
+			void initCL() const;
+			void fillPyramidCL( const Image& img, size_t index ) const;
+			void solveTVL1( Image& flow, const Image& src1, const Image& src2, bool median ) const;
+
+			mutable bool		_toggle;
+			float				_scalefactor;
+			size_t				_levels;
+			mutable CLKernel	_pyrup;
+			mutable CLKernel	_pyrdown;
+			mutable CLKernel	_tvl1;
+			mutable CLKernel	_tvl1_warp;
+//			CLKernel			_tvl1_dataadd;
+			mutable CLKernel	_clear;
+			mutable CLKernel	_median3;
+			float				_lambda;
+			mutable bool		_clInitialized;
+			mutable TVL1CPU		_cpu;
+//			ROFFGPFilter		_rof;
+//			GuidedFilter		_gf;
+			Image*				_pyr[ 2 ];
 	};
 }
 
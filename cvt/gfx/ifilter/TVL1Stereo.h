@@ -26,6 +26,7 @@
 #define CVT_TVL1STEREO_H
 
 #include <cvt/gfx/IFilter.h>
+#include <cvt/gfx/ifilter/TVL1CPU.h>
 #include <cvt/cl/CLKernel.h>
 
 namespace cvt {
@@ -33,24 +34,28 @@ namespace cvt {
 		public:
 			TVL1Stereo( float scalefactor, size_t levels );
 			~TVL1Stereo();
-			void apply( Image& flow, const Image& src1, const Image& src2 );
-			void apply( const ParamSet* set, IFilterType t = IFILTER_CPU ) const {};
+			void apply( Image& flow, const Image& src1, const Image& src2, IFilterType type = IFILTER_OPENCL ) const;
+			/* Input0, Input1 and Output as in apply( flow, src1, src2, type ) */
+			void apply( const ParamSet* set, IFilterType t = IFILTER_CPU ) const;
 
 		private:
-			void fillPyramidCL( const Image& img, size_t index );
-			void solveTVL1( Image& flow, const Image& src1, const Image& src2, bool median );
-
-			float		 _scalefactor;
-			size_t		 _levels;
-			CLKernel	 _pyrup;
-			CLKernel	 _pyrdown;
-			CLKernel	 _pyrdownbinom;
-			CLKernel	 _tvl1;
-			CLKernel	 _tvl1_warp;
-			CLKernel	 _clear;
-			CLKernel	 _median3;
-			float		 _lambda;
-			Image*		 _pyr[ 2 ];
+			void initCL() const;
+			void fillPyramidCL( const Image& img, size_t index ) const;
+			void solveTVL1( Image& flow, const Image& src1, const Image& src2, bool median ) const;
+
+			float				_scalefactor;
+			size_t				_levels;
+			mutable CLKernel	_pyrup;
+			mutable CLKernel	_pyrdown;
+			mutable CLKernel	_pyrdownbinom;
+			mutable CLKernel	_tvl1;
+			mutable CLKernel	_tvl1_warp;
+			mutable CLKernel	_clear;
+			mutable CLKernel	_median3;
+			float				_lambda;
+			mutable bool		_clInitialized;
+			mutable TVL1CPU		_cpu;
+			Image*				_pyr[ 2 ];
 	};
 }
 
@@ -31,6 +31,7 @@ namespace cvt {
 
 	class IOHandler {
 		friend class IOSelect;
+		friend class IOSelectPool;
 
 		public:
 			IOHandler( int fd = -1 );
@@ -42,40 +43,76 @@ namespace cvt {
 			void notifyWriteable( bool b );
 			void notifyException( bool b );
 
+			/* edge-triggered handlers are only notified on state changes and have to drain the descriptor */
+			void setEdgeTriggered( bool b );
+			bool isEdgeTriggered() const;
+
 		private:
 			IOHandler( const IOHandler& );
+			void update();
 
 			bool _read;
 			bool _write;
 			bool _except;
+			bool _edge;
+			/* the loop the handler is registered with and whether the fd is added to its poll set */
+			IOSelect* _select;
+			bool _armed;
 		protected:
 			int _fd;
 	};
 
-	inline IOHandler::IOHandler( int fd ) : _read( false ), _write( false ), _except( false ), _fd( fd )
+	inline IOHandler::IOHandler( int fd ) : _read( false ), _write( false ), _except( false ), _edge( false ), _select( NULL ), _armed( false ), _fd( fd )
 	{
 	}
 
 	inline IOHandler::~IOHandler()
 	{
+		if( _select )
+			_select->unregisterIOHandler( this );
+	}
+
+	inline void IOHandler::update()
+	{
+		if( _select )
+			_select->updateIOHandler( this );
 	}
 
 	inline void IOHandler::notifyReadable( bool b )
 	{
-		if( _fd >= 0 )
+		if( _fd >= 0 && _read != b ) {
 			_read = b;
+			update();
+		}
 	}
 
 	inline void IOHandler::notifyWriteable( bool b )
 	{
-		if( _fd >= 0 )
+		if( _fd >= 0 && _write != b ) {
 			_write = b;
+			update();
+		}
 	}
 
 	inline void IOHandler::notifyException( bool b )
 	{
-		if( _fd >= 0 )
+		if( _fd >= 0 && _except != b ) {
 			_except = b;
+			update();
+		}
+	}
+
+	inline void IOHandler::setEdgeTriggered( bool b )
+	{
+		if( _edge != b ) {
+			_edge = b;
+			update();
+		}
+	}
+
+	inline bool IOHandler::isEdgeTriggered() const
+	{
+		return _edge;
 	}
 
 	inline void IOHandler::onDataReadable()
@@ -24,36 +24,369 @@
 
 #include <cvt/io/IOSelect.h>
 #include <cvt/io/IOHandler.h>
+#include <cvt/gui/TimeoutHandler.h>
 #include <cvt/math/Math.h>
+#include <cvt/util/Exception.h>
 
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#ifdef LINUX
+#include <sys/eventfd.h>
+#endif
 
 namespace cvt {
 
-	IOSelect::IOSelect()
+	IOSelect::IOSelect() : _timerID( 0 ), _stop( false )
 	{
+#ifdef LINUX
+		_epfd = epoll_create1( EPOLL_CLOEXEC );
+		if( _epfd < 0 )
+			throw CVTException( errno );
+
+		_wakefd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+		if( _wakefd < 0 ) {
+			int err = errno;
+			close( _epfd );
+			throw CVTException( err );
+		}
+
+		/* the wakeup descriptor is the only one without handler */
+		struct epoll_event ev;
+		ev.events = EPOLLIN;
+		ev.data.ptr = NULL;
+		epoll_ctl( _epfd, EPOLL_CTL_ADD, _wakefd, &ev );
+
+		_events.resize( 64 );
+#else
+		if( pipe( _wakepipe ) )
+			throw CVTException( errno );
+		fcntl( _wakepipe[ 0 ], F_SETFL, O_NONBLOCK );
+		fcntl( _wakepipe[ 1 ], F_SETFL, O_NONBLOCK );
+#endif
 	}
 
 	IOSelect::~IOSelect()
 	{
+		for( std::set<IOHandler*>::iterator it = _handlers.begin(), end = _handlers.end(); it != end; ++it ) {
+			( *it )->_select = NULL;
+			( *it )->_armed = false;
+		}
+#ifdef LINUX
+		close( _wakefd );
+		close( _epfd );
+#else
+		close( _wakepipe[ 0 ] );
+		close( _wakepipe[ 1 ] );
+#endif
+	}
+
+	void IOSelect::registerIOHandler( IOHandler* ioh )
+	{
+		{
+			ScopeLock lock( &_mutex );
+			if( ioh->_select == this )
+				return;
+			if( ioh->_select )
+				throw CVTException( "IOHandler is already registered with another IOSelect" );
 
+			ioh->_select = this;
+			_handlers.insert( ioh );
+			arm( ioh );
+		}
+#ifndef LINUX
+		/* the fd sets are rebuilt on every call */
+		wakeup();
+#endif
+	}
+
+	void IOSelect::unregisterIOHandler( IOHandler* ioh )
+	{
+		ScopeLock lock( &_mutex );
+		if( ioh->_select != this )
+			return;
+
+#ifdef LINUX
+		/* the descriptor may already be closed, ignore errors */
+		if( ioh->_armed )
+			epoll_ctl( _epfd, EPOLL_CTL_DEL, ioh->_fd, NULL );
+#endif
+		ioh->_armed = false;
+		ioh->_select = NULL;
+		_handlers.erase( ioh );
+
+		for( size_t i = 0; i < _pending.size(); i++ ) {
+			if( _pending[ i ] == ioh )
+				_pending[ i ] = NULL;
+		}
+	}
+
+	void IOSelect::updateIOHandler( IOHandler* ioh )
+	{
+		{
+			ScopeLock lock( &_mutex );
+			if( ioh->_select != this )
+				return;
+			arm( ioh );
+		}
+#ifndef LINUX
+		wakeup();
+#endif
+	}
+
+	void IOSelect::arm( IOHandler* ioh )
+	{
+#ifdef LINUX
+		uint32_t events = 0;
+		if( ioh->_fd >= 0 ) {
+			if( ioh->_read )
+				events |= EPOLLIN;
+			if( ioh->_write )
+				events |= EPOLLOUT;
+			if( ioh->_except )
+				events |= EPOLLPRI;
+		}
+
+		/* without interest the fd is removed, otherwise hangups would still be reported */
+		if( !events ) {
+			if( ioh->_armed ) {
+				epoll_ctl( _epfd, EPOLL_CTL_DEL, ioh->_fd, NULL );
+				ioh->_armed = false;
+			}
+			return;
+		}
+
+		if( ioh->_edge )
+			events |= EPOLLET;
+
+		struct epoll_event ev;
+		ev.events = events;
+		ev.data.ptr = ioh;
+
+		int ret = epoll_ctl( _epfd, ioh->_armed ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, ioh->_fd, &ev );
+		if( ret && errno == ENOENT )
+			ret = epoll_ctl( _epfd, EPOLL_CTL_ADD, ioh->_fd, &ev );
+		else if( ret && errno == EEXIST )
+			ret = epoll_ctl( _epfd, EPOLL_CTL_MOD, ioh->_fd, &ev );
+		if( ret )
+			throw CVTException( errno );
+		ioh->_armed = true;
+#else
+		ioh->_armed = ioh->_fd >= 0 && ( ioh->_read || ioh->_write || ioh->_except );
+#endif
+	}
+
+	uint32_t IOSelect::registerTimer( size_t intervalms, TimeoutHandler* th )
+	{
+		uint32_t id;
+		{
+			ScopeLock lock( &_mutex );
+			id = ++_timerID;
+			Timer& t = _timers[ id ];
+			t.interval = intervalms;
+			t.timeout.reset();
+			t.timeout += intervalms;
+			t.handler = th;
+		}
+		wakeup();
+		return id;
+	}
+
+	void IOSelect::unregisterTimer( uint32_t id )
+	{
+		ScopeLock lock( &_mutex );
+		_timers.erase( id );
 	}
 
 	int IOSelect::handleIO( ssize_t ms )
 	{
-		int maxfd = 0;
-		int numfd, ret, active;
+		{
+			ScopeLock lock( &_mutex );
+			if( _handlers.empty() && _timers.empty() )
+				return 0;
+		}
+		return wait( ms );
+	}
+
+	void IOSelect::run()
+	{
+		while( !_stop )
+			wait( -1 );
+		_stop = false;
+	}
+
+	void IOSelect::stop()
+	{
+		_stop = true;
+		wakeup();
+	}
+
+	void IOSelect::wakeup()
+	{
+#ifdef LINUX
+		uint64_t one = 1;
+		if( write( _wakefd, &one, sizeof( one ) ) < 0 )
+			return;
+#else
+		uint8_t one = 1;
+		if( write( _wakepipe[ 1 ], &one, sizeof( one ) ) < 0 )
+			return;
+#endif
+	}
+
+	void IOSelect::clearWakeup()
+	{
+#ifdef LINUX
+		uint64_t val;
+		if( read( _wakefd, &val, sizeof( val ) ) < 0 )
+			return;
+#else
+		uint8_t buf[ 64 ];
+		while( read( _wakepipe[ 0 ], buf, sizeof( buf ) ) > 0 )
+			;
+#endif
+	}
+
+	int IOSelect::nextTimeout( ssize_t ms )
+	{
+		ScopeLock lock( &_mutex );
+		if( _timers.empty() )
+			return ms < 0 ? -1 : ( int ) ms;
+
+		Time now;
+		double tmin = Math::MAXF;
+		for( std::map<uint32_t, Timer>::const_iterator it = _timers.begin(), end = _timers.end(); it != end; ++it )
+			tmin = Math::min( tmin, it->second.timeout - now );
 
-		if( _handlers.empty() )
-			return 0;
+		int t = ( int ) Math::ceil( Math::max( tmin, 0.0 ) );
+		return ms < 0 ? t : Math::min( t, ( int ) ms );
+	}
 
+	void IOSelect::handleTimers()
+	{
+		std::vector<std::pair<uint32_t, TimeoutHandler*> > due;
+		Time now;
+
+		_mutex.lock();
+		for( std::map<uint32_t, Timer>::iterator it = _timers.begin(), end = _timers.end(); it != end; ++it ) {
+			if( it->second.timeout.compare( now ) <= 0 ) {
+				due.push_back( std::make_pair( it->first, it->second.handler ) );
+				it->second.timeout.reset();
+				it->second.timeout += it->second.interval;
+			}
+		}
+		_mutex.unlock();
+
+		/* a timeout handler may unregister other timers */
+		for( size_t i = 0; i < due.size(); i++ ) {
+			_mutex.lock();
+			bool alive = _timers.find( due[ i ].first ) != _timers.end();
+			_mutex.unlock();
+			if( alive )
+				due[ i ].second->onTimeout();
+		}
+	}
+
+	void IOSelect::dispatch()
+	{
+		for( size_t i = 0; ; i++ ) {
+			IOHandler* ioh;
+			uint32_t events;
+
+			_mutex.lock();
+			if( i >= _pending.size() ) {
+				_mutex.unlock();
+				break;
+			}
+			ioh = _pending[ i ];
+			events = _pendingEvents[ i ];
+			_mutex.unlock();
+
+			/* every callback may unregister the handler, check the entry in between */
+			if( ioh && ( events & EVENT_READ ) && ioh->_read )
+				ioh->onDataReadable();
+
+			_mutex.lock();
+			ioh = _pending[ i ];
+			_mutex.unlock();
+			if( ioh && ( events & EVENT_WRITE ) && ioh->_write )
+				ioh->onDataWriteable();
+
+			_mutex.lock();
+			ioh = _pending[ i ];
+			_mutex.unlock();
+			if( ioh && ( events & EVENT_EXCEPT ) && ioh->_except )
+				ioh->onException();
+		}
+
+		_mutex.lock();
+		_pending.clear();
+		_pendingEvents.clear();
+		_mutex.unlock();
+	}
+
+#ifdef LINUX
+	int IOSelect::wait( ssize_t ms )
+	{
+		int ret, nready = 0;
+
+		ret = epoll_wait( _epfd, &_events[ 0 ], _events.size(), nextTimeout( ms ) );
+		if( ret < 0 ) {
+			if( errno != EINTR )
+				return ret;
+			ret = 0;
+		}
+
+		_mutex.lock();
+		for( int i = 0; i < ret; i++ ) {
+			IOHandler* ioh = ( IOHandler* ) _events[ i ].data.ptr;
+			if( !ioh ) {
+				clearWakeup();
+				continue;
+			}
+			/* unregistered from another thread after epoll_wait returned */
+			if( _handlers.find( ioh ) == _handlers.end() )
+				continue;
+
+			/* errors and hangups are reported like select does, as readable/writeable */
+			uint32_t e = _events[ i ].events;
+			uint32_t flags = 0;
+			if( e & ( EPOLLIN | EPOLLHUP | EPOLLERR ) )
+				flags |= EVENT_READ;
+			if( e & ( EPOLLOUT | EPOLLERR ) )
+				flags |= EVENT_WRITE;
+			if( e & EPOLLPRI )
+				flags |= EVENT_EXCEPT;
+
+			_pending.push_back( ioh );
+			_pendingEvents.push_back( flags );
+			nready++;
+		}
+		_mutex.unlock();
+
+		if( ( size_t ) ret == _events.size() )
+			_events.resize( 2 * _events.size() );
+
+		dispatch();
+		handleTimers();
+
+		return nready;
+	}
+#else
+	int IOSelect::wait( ssize_t ms )
+	{
+		int maxfd = _wakepipe[ 0 ];
+		int ret, nready = 0;
 
 		FD_ZERO( &_readfds );
 		FD_ZERO( &_writefds );
 		FD_ZERO( &_execeptfds );
+		FD_SET( _wakepipe[ 0 ], &_readfds );
 
-		for( std::list<IOHandler*>::iterator it = _handlers.begin(), end = _handlers.end(); it != end; ++it ) {
+		_mutex.lock();
+		for( std::set<IOHandler*>::iterator it = _handlers.begin(), end = _handlers.end(); it != end; ++it ) {
 			IOHandler* ioh = *it;
-			if( ioh->_read || ioh->_write || ioh->_except ) {
+			if( ioh->_armed && ioh->_fd < FD_SETSIZE ) {
 				maxfd = Math::max( maxfd, ioh->_fd );
 				if( ioh->_read )
 					FD_SET( ioh->_fd, &_readfds );
@@ -63,41 +396,50 @@ namespace cvt {
 					FD_SET( ioh->_fd, &_execeptfds );
 			}
 		}
+		_mutex.unlock();
 
-		if( ms < 0 ) {
+		int timeout = nextTimeout( ms );
+		if( timeout < 0 ) {
 			ret = pselect( maxfd + 1, &_readfds, &_writefds, &_execeptfds, NULL, NULL );
 		} else {
-			msToTimespec( ms, _timeout );
+			msToTimespec( timeout, _timeout );
 			ret = pselect( maxfd + 1, &_readfds, &_writefds, &_execeptfds, &_timeout, NULL );
 		}
-		/* FIXME: do error handling */
-		if( ret <= 0 )
-			return ret;
+		if( ret < 0 ) {
+			if( errno != EINTR )
+				return ret;
+			ret = 0;
+		}
 
-		numfd = ret;
+		if( ret > 0 ) {
+			if( FD_ISSET( _wakepipe[ 0 ], &_readfds ) )
+				clearWakeup();
 
-		for( std::list<IOHandler*>::iterator it = _handlers.begin(), end = _handlers.end(); it != end; ++it ) {
-			IOHandler* ioh = *it;
-			if( ioh->_read || ioh->_write || ioh->_except ) {
-				active = 0;
-				if( ioh->_read && FD_ISSET( ioh->_fd, &_readfds ) ) {
-					ioh->onDataReadable();
-					active = 1;
-				}
-				if( ioh->_write && FD_ISSET( ioh->_fd, &_writefds ) ) {
-					ioh->onDataWriteable();
-					active = 1;
+			_mutex.lock();
+			for( std::set<IOHandler*>::iterator it = _handlers.begin(), end = _handlers.end(); it != end; ++it ) {
+				IOHandler* ioh = *it;
+				if( !ioh->_armed || ioh->_fd >= FD_SETSIZE )
+					continue;
+				uint32_t flags = 0;
+				if( ioh->_read && FD_ISSET( ioh->_fd, &_readfds ) )
+					flags |= EVENT_READ;
+				if( ioh->_write && FD_ISSET( ioh->_fd, &_writefds ) )
+					flags |= EVENT_WRITE;
+				if( ioh->_except && FD_ISSET( ioh->_fd, &_execeptfds ) )
+					flags |= EVENT_EXCEPT;
+				if( flags ) {
+					_pending.push_back( ioh );
+					_pendingEvents.push_back( flags );
+					nready++;
 				}
-				if( ioh->_except && FD_ISSET( ioh->_fd, &_execeptfds ) ) {
-					ioh->onException();
-					active = 1;
-				}
-				numfd -= active;
-				if( !numfd )
-					break;
 			}
+			_mutex.unlock();
 		}
 
-		return ret;
+		dispatch();
+		handleTimers();
+
+		return nready;
 	}
+#endif
 }
@@ -26,44 +26,108 @@
 #define CVT_IOSELECT_H
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <sys/select.h>
 #include <time.h>
+#ifdef LINUX
+#include <sys/epoll.h>
+#endif
+
+#include <cvt/util/Mutex.h>
+#include <cvt/util/Time.h>
 
-#include <list>
+#include <map>
+#include <set>
+#include <vector>
 
 namespace cvt {
 	class IOHandler;
+	class TimeoutHandler;
+
+	/**
+	  @brief Event loop dispatching readiness of file descriptors to IOHandlers.
+
+	  On Linux the loop is backed by epoll: interest changes are pushed to the kernel when a handler
+	  calls notifyReadable/notifyWriteable/notifyException, so the cost of handleIO only depends on the
+	  number of ready descriptors and there is no FD_SETSIZE limit. Handlers can request edge-triggered
+	  notification, other platforms fall back to pselect with level-triggered semantics.
 
+	  Registering handlers and timers, unregistering and wakeup() may be called from any thread, the
+	  callbacks are always executed by the thread running handleIO/run.
+	 */
 	class IOSelect {
+		friend class IOHandler;
+
 		public:
 			IOSelect();
 			~IOSelect();
 			int handleIO( ssize_t timeout_ms );
 			void registerIOHandler( IOHandler* ioh );
 			void unregisterIOHandler( IOHandler* ion );
+			size_t numIOHandlers() const;
+
+			uint32_t registerTimer( size_t intervalms, TimeoutHandler* th );
+			void unregisterTimer( uint32_t id );
+
+			/* dispatch events until stop is called */
+			void run();
+			void stop();
+			/* interrupt a blocking handleIO */
+			void wakeup();
 
 		private:
+			IOSelect( const IOSelect& );
+
+			enum EventFlags {
+				EVENT_READ	 = ( 1 << 0 ),
+				EVENT_WRITE	 = ( 1 << 1 ),
+				EVENT_EXCEPT = ( 1 << 2 )
+			};
+
+			struct Timer {
+				size_t			interval;
+				Time			timeout;
+				TimeoutHandler* handler;
+			};
+
+			int  wait( ssize_t ms );
+			void updateIOHandler( IOHandler* ioh );
+			void dispatch();
+			int  nextTimeout( ssize_t ms );
+			void handleTimers();
+			void clearWakeup();
 			void msToTimespec( size_t ms, struct timespec& ts ) const;
 
-			fd_set _readfds;
-			fd_set _writefds;
-			fd_set _execeptfds;
-			struct timespec _timeout;
-			std::list<IOHandler*> _handlers;
+			void arm( IOHandler* ioh );
+
+			mutable Mutex			  _mutex;
+			std::set<IOHandler*>	  _handlers;
+			/* handlers of the current dispatch, unregistering clears the entry */
+			std::vector<IOHandler*>	  _pending;
+			std::vector<uint32_t>	  _pendingEvents;
+			std::map<uint32_t, Timer> _timers;
+			uint32_t				  _timerID;
+			volatile bool			  _stop;
+
+#ifdef LINUX
+			int						  _epfd;
+			int						  _wakefd;
+			std::vector<struct epoll_event> _events;
+#else
+			int						  _wakepipe[ 2 ];
+			fd_set					  _readfds;
+			fd_set					  _writefds;
+			fd_set					  _execeptfds;
+			struct timespec			  _timeout;
+#endif
 	};
 
-
-	inline void IOSelect::registerIOHandler( IOHandler* ioh )
-	{
-		_handlers.push_back( ioh );
-	}
-
-	inline void IOSelect::unregisterIOHandler( IOHandler* ion )
+	inline size_t IOSelect::numIOHandlers() const
 	{
-		_handlers.remove( ion );
+		ScopeLock lock( &_mutex );
+		return _handlers.size();
 	}
 
-
 	inline void IOSelect::msToTimespec( size_t ms, struct timespec& ts ) const
 	{
 		long ns;
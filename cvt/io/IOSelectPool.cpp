@@ -0,0 +1,80 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/io/IOSelectPool.h>
+#include <cvt/io/IOHandler.h>
+#include <cvt/util/ThreadPool.h>
+
+namespace cvt {
+
+	IOSelectPool::IOSelectPool( size_t numLoops )
+	{
+		if( !numLoops )
+			numLoops = ThreadPool::hardwareConcurrency();
+
+		for( size_t i = 0; i < numLoops; i++ ) {
+			IOSelect* select = new IOSelect();
+			Loop* loop = new Loop();
+			_selects.push_back( select );
+			_loops.push_back( loop );
+			loop->run( select );
+		}
+	}
+
+	IOSelectPool::~IOSelectPool()
+	{
+		for( size_t i = 0; i < _selects.size(); i++ )
+			_selects[ i ]->stop();
+
+		for( size_t i = 0; i < _loops.size(); i++ ) {
+			_loops[ i ]->join();
+			delete _loops[ i ];
+			delete _selects[ i ];
+		}
+	}
+
+	IOSelect& IOSelectPool::registerIOHandler( IOHandler* ioh )
+	{
+		size_t best = 0;
+		size_t bestNum = _selects[ 0 ]->numIOHandlers();
+		for( size_t i = 1; i < _selects.size() && bestNum; i++ ) {
+			size_t num = _selects[ i ]->numIOHandlers();
+			if( num < bestNum ) {
+				best = i;
+				bestNum = num;
+			}
+		}
+
+		_selects[ best ]->registerIOHandler( ioh );
+		return *_selects[ best ];
+	}
+
+	void IOSelectPool::unregisterIOHandler( IOHandler* ioh )
+	{
+		IOSelect* select = ioh->_select;
+		if( select )
+			select->unregisterIOHandler( ioh );
+	}
+
+}
@@ -0,0 +1,79 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_IOSELECTPOOL_H
+#define CVT_IOSELECTPOOL_H
+
+#include <cvt/io/IOSelect.h>
+#include <cvt/util/Thread.h>
+
+#include <vector>
+
+namespace cvt {
+	class IOHandler;
+
+	/**
+	  @brief Multi-reactor: one IOSelect event loop per thread.
+
+	  New handlers are assigned to the loop serving the fewest handlers, their callbacks are executed
+	  by the thread of that loop. A handler should be unregistered from its own loop ( e.g. in one of
+	  its callbacks ) or after the pool has been destroyed.
+	 */
+	class IOSelectPool {
+		public:
+			/* numLoops = 0: one loop per core */
+			IOSelectPool( size_t numLoops = 0 );
+			~IOSelectPool();
+
+			size_t		size() const;
+			IOSelect&	loop( size_t index );
+
+			IOSelect&	registerIOHandler( IOHandler* ioh );
+			void		unregisterIOHandler( IOHandler* ioh );
+
+		private:
+			class Loop : public Thread<IOSelect> {
+				public:
+					void execute( IOSelect* select ) { select->run(); }
+			};
+
+			IOSelectPool( const IOSelectPool& );
+			IOSelectPool& operator=( const IOSelectPool& );
+
+			std::vector<IOSelect*>	_selects;
+			std::vector<Loop*>		_loops;
+	};
+
+	inline size_t IOSelectPool::size() const
+	{
+		return _selects.size();
+	}
+
+	inline IOSelect& IOSelectPool::loop( size_t index )
+	{
+		return *_selects[ index ];
+	}
+}
+
+#endif
@@ -0,0 +1,226 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/io/IOSelect.h>
+#include <cvt/io/IOSelectPool.h>
+#include <cvt/io/IOHandler.h>
+#include <cvt/gui/TimeoutHandler.h>
+#include <cvt/util/CVTTest.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <vector>
+
+using namespace cvt;
+
+class PipeHandler : public IOHandler {
+	public:
+		PipeHandler( bool drain ) : IOHandler( -1 ), count( 0 ), other( NULL ), loop( NULL ), _drain( drain )
+		{
+			if( pipe( _pipe ) )
+				throw CVTException( "pipe failed" );
+			fcntl( _pipe[ 0 ], F_SETFL, O_NONBLOCK );
+			fcntl( _pipe[ 1 ], F_SETFL, O_NONBLOCK );
+			_fd = _pipe[ 0 ];
+			notifyReadable( true );
+		}
+
+		~PipeHandler()
+		{
+			close( _pipe[ 0 ] );
+			close( _pipe[ 1 ] );
+		}
+
+		void onDataReadable()
+		{
+			__atomic_add_fetch( &count, 1, __ATOMIC_SEQ_CST );
+			if( _drain ) {
+				char buf[ 64 ];
+				while( read( _pipe[ 0 ], buf, sizeof( buf ) ) > 0 )
+					;
+			}
+			if( other && other->loop )
+				other->loop->unregisterIOHandler( other );
+		}
+
+		void signal()
+		{
+			char c = 0;
+			if( write( _pipe[ 1 ], &c, 1 ) != 1 )
+				throw CVTException( "write failed" );
+		}
+
+		int			 count;
+		/* unregister this handler in the callback */
+		PipeHandler* other;
+		IOSelect*	 loop;
+
+	private:
+		int	 _pipe[ 2 ];
+		bool _drain;
+};
+
+class CountTimeout : public TimeoutHandler {
+	public:
+		CountTimeout() : count( 0 ) {}
+		void onTimeout() { count++; }
+		int count;
+};
+
+static bool _levelTest( bool edge )
+{
+	const size_t num = 200;
+	IOSelect select;
+	std::vector<PipeHandler*> handlers;
+	bool ret = true;
+
+	for( size_t i = 0; i < num; i++ ) {
+		PipeHandler* h = new PipeHandler( false );
+		h->setEdgeTriggered( edge );
+		select.registerIOHandler( h );
+		handlers.push_back( h );
+	}
+
+	size_t nsignaled = 0;
+	for( size_t i = 0; i < num; i += 7 ) {
+		handlers[ i ]->signal();
+		nsignaled++;
+	}
+
+	ret &= select.handleIO( 100 ) == ( int ) nsignaled;
+	/* nothing was read: level-triggered handlers fire again, edge-triggered ones don't */
+	ret &= select.handleIO( 10 ) == ( edge ? 0 : ( int ) nsignaled );
+
+	for( size_t i = 0; i < num; i++ ) {
+		int expected = ( i % 7 ) ? 0 : ( edge ? 1 : 2 );
+		ret &= handlers[ i ]->count == expected;
+		delete handlers[ i ];
+	}
+	ret &= select.numIOHandlers() == 0;
+	return ret;
+}
+
+static bool _unregisterTest()
+{
+	IOSelect select;
+	PipeHandler a( false ), b( false );
+	bool ret = true;
+
+	select.registerIOHandler( &a );
+	select.registerIOHandler( &b );
+	a.loop = b.loop = &select;
+	a.other = &b;
+	b.other = &a;
+
+	a.signal();
+	b.signal();
+	select.handleIO( 100 );
+
+	/* whichever handler runs first removes the other one */
+	ret &= a.count + b.count == 1;
+	ret &= select.numIOHandlers() == 1;
+	return ret;
+}
+
+static bool _timerTest()
+{
+	IOSelect select;
+	CountTimeout t1, t2;
+
+	uint32_t id1 = select.registerTimer( 5, &t1 );
+	uint32_t id2 = select.registerTimer( 1000000, &t2 );
+
+	Time start;
+	while( t1.count < 3 && start.elapsedMilliSeconds() < 2000 )
+		select.handleIO( -1 );
+
+	select.unregisterTimer( id1 );
+	select.unregisterTimer( id2 );
+	return t1.count >= 3 && t2.count == 0;
+}
+
+static bool _poolTest()
+{
+	const size_t num = 10;
+	std::vector<PipeHandler*> handlers;
+	bool ret = true;
+
+	IOSelectPool* pool = new IOSelectPool( 2 );
+	for( size_t i = 0; i < num; i++ ) {
+		PipeHandler* h = new PipeHandler( true );
+		h->setEdgeTriggered( true );
+		pool->registerIOHandler( h );
+		handlers.push_back( h );
+	}
+	ret &= pool->loop( 0 ).numIOHandlers() == num / 2;
+	ret &= pool->loop( 1 ).numIOHandlers() == num / 2;
+
+	for( size_t i = 0; i < num; i++ )
+		handlers[ i ]->signal();
+
+	Time start;
+	int total = 0;
+	while( total < ( int ) num && start.elapsedMilliSeconds() < 2000 ) {
+		usleep( 1000 );
+		total = 0;
+		for( size_t i = 0; i < num; i++ )
+			total += __atomic_load_n( &handlers[ i ]->count, __ATOMIC_SEQ_CST );
+	}
+	ret &= total == ( int ) num;
+
+	delete pool;
+	for( size_t i = 0; i < num; i++ )
+		delete handlers[ i ];
+	return ret;
+}
+
+BEGIN_CVTTEST( IOSelect )
+	bool result = true;
+	bool b;
+
+	b = _levelTest( false );
+	CVTTEST_PRINT( "level-triggered", b );
+	result &= b;
+
+#ifdef LINUX
+	/* the pselect fallback is always level-triggered */
+	b = _levelTest( true );
+	CVTTEST_PRINT( "edge-triggered", b );
+	result &= b;
+#endif
+
+	b = _unregisterTest();
+	CVTTEST_PRINT( "unregister during dispatch", b );
+	result &= b;
+
+	b = _timerTest();
+	CVTTEST_PRINT( "timers", b );
+	result &= b;
+
+	b = _poolTest();
+	CVTTEST_PRINT( "IOSelectPool", b );
+	result &= b;
+
+	return result;
+END_CVTTEST
@@ -0,0 +1,194 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/io/ImagePrefetcher.h>
+#include <cvt/util/Exception.h>
+#include <cvt/math/Math.h>
+#include <cvt/util/PluginManager.h>
+
+namespace cvt {
+
+	ImagePrefetcher::ImagePrefetcher( size_t depth, size_t numThreads ) :
+		_slots( depth ),
+		_numThreads( numThreads ),
+		_next( 0 ),
+		_scheduled( 0 ),
+		_generation( 0 ),
+		_started( false ),
+		_stop( false )
+	{
+		if( !depth )
+			throw CVTException( "Prefetch depth has to be at least one" );
+		if( !_numThreads )
+			_numThreads = Math::min<size_t>( depth, 2 );
+
+		for( size_t i = 0; i < _slots.size(); i++ ) {
+			_slots[ i ].state = SLOT_EMPTY;
+			_slots[ i ].index = 0;
+			_slots[ i ].generation = 0;
+		}
+
+		// the loaders are looked up from the worker threads, create the plugin manager here
+		PluginManager::instance();
+	}
+
+	ImagePrefetcher::~ImagePrefetcher()
+	{
+		_mutex.lock();
+		_stop = true;
+		_cond.notifyAll();
+		_mutex.unlock();
+
+		for( size_t i = 0; i < _workers.size(); i++ ) {
+			_workers[ i ]->join();
+			delete _workers[ i ];
+		}
+	}
+
+	void ImagePrefetcher::addChannel( const std::vector<String>& files )
+	{
+		ScopeLock lock( &_mutex );
+		if( _started )
+			throw CVTException( "Channels cannot be added while prefetching" );
+		if( _files.size() && _files[ 0 ].size() != files.size() )
+			throw CVTException( "All channels need the same number of files" );
+
+		_files.push_back( files );
+		for( size_t i = 0; i < _slots.size(); i++ )
+			_slots[ i ].images.resize( _files.size() );
+	}
+
+	size_t ImagePrefetcher::size() const
+	{
+		return _files.size() ? _files[ 0 ].size() : 0;
+	}
+
+	void ImagePrefetcher::seek( size_t index )
+	{
+		ScopeLock lock( &_mutex );
+		restart( index );
+	}
+
+	void ImagePrefetcher::fetch( size_t index, Image** dst )
+	{
+		_mutex.lock();
+		if( !_started || index != _next )
+			restart( index );
+
+		if( index >= size() ) {
+			_mutex.unlock();
+			throw CVTException( "Prefetch index out of range" );
+		}
+
+		Slot& slot = _slots[ index % _slots.size() ];
+		while( slot.state < SLOT_READY || slot.index != index || slot.generation != _generation )
+			_cond.wait( _mutex );
+
+		if( slot.state == SLOT_FAILED ) {
+			String msg( slot.error );
+			slot.state = SLOT_EMPTY;
+			_next++;
+			_cond.notifyAll();
+			_mutex.unlock();
+			throw CVTException( msg.c_str() );
+		}
+
+		for( size_t c = 0; c < slot.images.size(); c++ )
+			dst[ c ]->swap( slot.images[ c ] );
+		slot.state = SLOT_EMPTY;
+		_next++;
+		_cond.notifyAll();
+		_mutex.unlock();
+	}
+
+	/* called with _mutex held */
+	void ImagePrefetcher::restart( size_t index )
+	{
+		_generation++;
+		// slots in flight are dropped by their worker once it notices the generation change
+		for( size_t i = 0; i < _slots.size(); i++ ) {
+			if( _slots[ i ].state != SLOT_LOADING )
+				_slots[ i ].state = SLOT_EMPTY;
+		}
+		_next = index;
+		_scheduled = index;
+
+		if( !_started ) {
+			_started = true;
+			for( size_t i = 0; i < _numThreads; i++ ) {
+				Worker* w = new Worker();
+				w->run( this );
+				_workers.push_back( w );
+			}
+		}
+		_cond.notifyAll();
+	}
+
+	void ImagePrefetcher::work()
+	{
+		const size_t n = size();
+		const size_t depth = _slots.size();
+
+		_mutex.lock();
+		while( true ) {
+			while( !_stop && !( _scheduled < n && _scheduled < _next + depth && _slots[ _scheduled % depth ].state == SLOT_EMPTY ) )
+				_cond.wait( _mutex );
+			if( _stop )
+				break;
+
+			size_t index = _scheduled++;
+			Slot& slot = _slots[ index % depth ];
+			slot.state = SLOT_LOADING;
+			slot.index = index;
+			slot.generation = _generation;
+			_mutex.unlock();
+
+			// the slot is owned by this thread while loading
+			String error;
+			bool failed = false;
+			try {
+				for( size_t c = 0; c < _files.size(); c++ )
+					slot.images[ c ].load( _files[ c ][ index ] );
+			} catch( const Exception& e ) {
+				error = e.what();
+				failed = true;
+			} catch( ... ) {
+				error = "Unknown error while loading ";
+				error += _files[ 0 ][ index ];
+				failed = true;
+			}
+
+			_mutex.lock();
+			if( slot.generation != _generation ) {
+				slot.state = SLOT_EMPTY;
+			} else {
+				slot.state = failed ? SLOT_FAILED : SLOT_READY;
+				slot.error = error;
+			}
+			_cond.notifyAll();
+		}
+		_mutex.unlock();
+	}
+
+}
@@ -0,0 +1,114 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_IMAGEPREFETCHER_H
+#define CVT_IMAGEPREFETCHER_H
+
+#include <cvt/gfx/Image.h>
+#include <cvt/util/String.h>
+#include <cvt/util/Thread.h>
+#include <cvt/util/Mutex.h>
+#include <cvt/util/Condition.h>
+
+#include <vector>
+
+namespace cvt {
+
+	/**
+	  @brief Read-ahead loader for image sequences stored as files.
+
+	  A sequence consists of one or more channels ( e.g. rgb and depth, or left and right ), each channel is
+	  a list of filenames of equal length. Worker threads decode the samples following the last fetched
+	  one into a ring of depth slots, fetch() hands the decoded images out by swapping them with the
+	  destination images. The images passed to fetch() therefore flow back into the ring and are reused
+	  for decoding the following samples, no image memory is allocated once the pipeline is warm.
+	 */
+	class ImagePrefetcher {
+		public:
+			/* numThreads = 0: use min( depth, 2 ) decoding threads */
+			ImagePrefetcher( size_t depth = 4, size_t numThreads = 0 );
+			~ImagePrefetcher();
+
+			/* add a channel, all channels need to be added before the first call to fetch */
+			void	addChannel( const std::vector<String>& files );
+
+			size_t	channels() const { return _files.size(); }
+			size_t	size() const;
+			size_t	depth() const { return _slots.size(); }
+
+			/* discard the pending read-ahead and start decoding at index */
+			void	seek( size_t index );
+
+			/**
+			  @brief Retrieve the images of sample index, dst has to point to channels() images.
+
+			  Blocks until the sample is decoded. Sequential calls are served from the read-ahead ring,
+			  any other index restarts the read-ahead at this index. Throws if the sample could not be loaded.
+			 */
+			void	fetch( size_t index, Image** dst );
+
+		private:
+			enum SlotState {
+				SLOT_EMPTY,
+				SLOT_LOADING,
+				SLOT_READY,
+				SLOT_FAILED
+			};
+
+			struct Slot {
+				SlotState			state;
+				size_t				index;
+				size_t				generation;
+				std::vector<Image>	images;
+				String				error;
+			};
+
+			class Worker : public Thread<ImagePrefetcher> {
+				public:
+					void execute( ImagePrefetcher* prefetcher ) { prefetcher->work(); }
+			};
+
+			ImagePrefetcher( const ImagePrefetcher& );
+			ImagePrefetcher& operator=( const ImagePrefetcher& );
+
+			void	restart( size_t index );
+			void	work();
+
+			std::vector<std::vector<String> >	_files;
+			std::vector<Slot>					_slots;
+			std::vector<Worker*>				_workers;
+			size_t								_numThreads;
+
+			Mutex								_mutex;
+			Condition							_cond;
+			size_t								_next;		// next index handed out by fetch
+			size_t								_scheduled;	// next index to be decoded
+			size_t								_generation;
+			bool								_started;
+			bool								_stop;
+	};
+
+}
+
+#endif
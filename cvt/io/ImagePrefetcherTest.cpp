@@ -0,0 +1,122 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/io/ImagePrefetcher.h>
+#include <cvt/gfx/ILoader.h>
+#include <cvt/util/PluginManager.h>
+#include <cvt/util/CVTTest.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+using namespace cvt;
+
+/* synthetic loader: "<value>.pftest" yields a 4x4 gray image filled with value, "fail.pftest" throws */
+class PrefetchTestLoader : public ILoader {
+	public:
+		PrefetchTestLoader() : _ext( ".pftest" ), _name( "PrefetchTest" ) {}
+
+		void load( Image& dst, const String& file )
+		{
+			if( file == "fail.pftest" )
+				throw CVTException( "load failed" );
+			dst.reallocate( 4, 4, IFormat::GRAY_UINT8 );
+			size_t stride;
+			uint8_t* p = dst.map( &stride );
+			for( size_t y = 0; y < 4; y++ )
+				memset( p + y * stride, atoi( file.c_str() ), 4 );
+			dst.unmap( p );
+		}
+
+		const String& extension( size_t ) const { return _ext; }
+		size_t sizeExtensions() const { return 1; }
+		const String& name() const { return _name; }
+
+	private:
+		String _ext;
+		String _name;
+};
+
+static bool checkValue( const Image& img, size_t value )
+{
+	size_t stride;
+	const uint8_t* p = img.map( &stride );
+	bool ok = img.width() == 4 && img.height() == 4 && p[ 0 ] == value && p[ 3 * stride + 3 ] == value;
+	img.unmap( p );
+	return ok;
+}
+
+BEGIN_CVTTEST( ImagePrefetcher )
+	bool result = true;
+	bool b;
+
+	PluginManager::instance().registerPlugin( new PrefetchTestLoader() );
+
+	std::vector<String> a, c;
+	for( size_t i = 0; i < 50; i++ ) {
+		String s;
+		s.sprintf( "%d.pftest", ( int ) i );
+		a.push_back( s );
+		s.sprintf( "%d.pftest", ( int ) ( 100 + i ) );
+		c.push_back( s );
+	}
+	a[ 20 ] = "fail.pftest";
+
+	ImagePrefetcher prefetcher( 3 );
+	prefetcher.addChannel( a );
+	prefetcher.addChannel( c );
+
+	Image i0, i1;
+	Image* dst[ 2 ] = { &i0, &i1 };
+
+	b = true;
+	for( size_t i = 0; i < 20; i++ ) {
+		prefetcher.fetch( i, dst );
+		b &= checkValue( i0, i ) && checkValue( i1, 100 + i );
+	}
+	result &= b;
+	CVTTEST_PRINT( "sequential fetch", b );
+
+	b = false;
+	try {
+		prefetcher.fetch( 20, dst );
+	} catch( const Exception& ) {
+		b = true;
+	}
+	prefetcher.fetch( 21, dst );
+	b &= checkValue( i0, 21 );
+	result &= b;
+	CVTTEST_PRINT( "load error", b );
+
+	b = true;
+	size_t order[] = { 40, 41, 5, 6, 7, 49, 0 };
+	for( size_t i = 0; i < sizeof( order ) / sizeof( order[ 0 ] ); i++ ) {
+		prefetcher.fetch( order[ i ], dst );
+		b &= checkValue( i0, order[ i ] ) && checkValue( i1, 100 + order[ i ] );
+	}
+	result &= b;
+	CVTTEST_PRINT( "seek", b );
+
+	return result;
+END_CVTTEST
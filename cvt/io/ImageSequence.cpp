@@ -28,8 +28,10 @@
 namespace cvt {
     
     ImageSequence::ImageSequence( const String& basename,
-                                  const String& ext ) :
-	   _index( 0 )	
+                                  const String& ext,
+                                  size_t prefetchDepth ) :
+	   _index( 0 ),
+	   _prefetcher( 0 )
     {       
 		std::vector<String> filenames;
 
@@ -45,15 +47,30 @@ namespace cvt {
 				_files.push_back( filenames[ i ] );
 			}
 		}
+
+		if( prefetchDepth ){
+			_prefetcher = new ImagePrefetcher( prefetchDepth );
+			_prefetcher->addChannel( _files );
+		}
 		
 		nextFrame();
     }
+
+    ImageSequence::~ImageSequence()
+    {
+        delete _prefetcher;
+    }
     
     bool ImageSequence::nextFrame( size_t )
     {
         // build the string and load the frame
 		if( _index < _files.size() ){
-			_current.load( _files[ _index ] );
+			if( _prefetcher ){
+				Image* dst = &_current;
+				_prefetcher->fetch( _index, &dst );
+			} else {
+				_current.load( _files[ _index ] );
+			}
 			_index++;
 			return true;
 		} else {
@@ -26,6 +26,7 @@
 #define CVT_IMAGESEQUENCE_H
 
 #include <cvt/io/VideoInput.h>
+#include <cvt/io/ImagePrefetcher.h>
 #include <cvt/util/String.h>
 #include <vector>
 
@@ -34,10 +35,12 @@ namespace cvt
     class ImageSequence : public VideoInput
     {
         public:
+            /* prefetchDepth: number of files decoded ahead by background threads, 0 loads within nextFrame */
             ImageSequence( const String& basename,
-                           const String& ext );
+                           const String& ext,
+                           size_t prefetchDepth = 4 );
         
-            ~ImageSequence(){}
+            ~ImageSequence();
         
             size_t  width() const { return _current.width(); }
             size_t  height() const { return _current.height(); }
@@ -51,6 +54,10 @@ namespace cvt
             Image					_current;   
 			std::vector<String>		_files;
             size_t					_index;
+			ImagePrefetcher*		_prefetcher;
+
+			ImageSequence( const ImageSequence& );
+			ImageSequence& operator=( const ImageSequence& );
 	
 			bool extractFolder( String& folder, const String& basename ) const;
     };
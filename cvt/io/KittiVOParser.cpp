@@ -30,9 +30,10 @@
 
 namespace cvt {
 
-    KittiVOParser::KittiVOParser( const cvt::String& folder, bool useColorCams ) :
+    KittiVOParser::KittiVOParser( const cvt::String& folder, bool useColorCams, size_t prefetchDepth ) :
         _useColor( useColorCams ),
-        _iter( 0 )
+        _iter( 0 ),
+        _prefetcher( 0 )
     {
         cvt::String leftFolder( folder );
         cvt::String rightFolder( folder );
@@ -112,10 +113,18 @@ namespace cvt {
         // get the stereo calibration: we need the images sizes, that's why it has to be done after the load
         std::cout << "Loading calibFile: " << std::endl;
         loadCalibration( calibFile );
+
+        if( prefetchDepth ){
+            _prefetcher = new ImagePrefetcher( prefetchDepth );
+            _prefetcher->addChannel( filesLeft );
+            _prefetcher->addChannel( filesRight );
+            _prefetcher->seek( _iter + 1 );
+        }
     }
 
     KittiVOParser::~KittiVOParser()
     {
+        delete _prefetcher;
     }
 
     bool KittiVOParser::nextFrame( size_t /*timeout*/ )
@@ -145,6 +154,11 @@ namespace cvt {
 
     void KittiVOParser::loadImages()
     {
+        if( _prefetcher ){
+            Image* images[ 2 ] = { &_left, &_right };
+            _prefetcher->fetch( _iter, images );
+            return;
+        }
         _left.load( _curSample->leftFile );
         _right.load( _curSample->rightFile );
     }
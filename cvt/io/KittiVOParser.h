@@ -29,13 +29,15 @@
 #include <cvt/math/Matrix.h>
 #include <cvt/gfx/Image.h>
 #include <cvt/io/StereoInput.h>
+#include <cvt/io/ImagePrefetcher.h>
 
 namespace cvt {
 
     class KittiVOParser : public StereoInput
     {
         public:
-            KittiVOParser( const cvt::String& folder, bool useColorCams = false );
+            /* prefetchDepth: number of stereo pairs decoded ahead by background threads, 0 disables read-ahead */
+            KittiVOParser( const cvt::String& folder, bool useColorCams = false, size_t prefetchDepth = 4 );
             ~KittiVOParser();
 
             const Image&    left()  const { return _left; }
@@ -71,6 +73,10 @@ namespace cvt {
             Image                   _left;
             Image                   _right;
             Sample*                 _curSample;
+            ImagePrefetcher*        _prefetcher;
+
+            KittiVOParser( const KittiVOParser& );
+            KittiVOParser& operator=( const KittiVOParser& );
 
             void checkFileExistence( const cvt::String& file );
             void loadImageNames( std::vector<cvt::String>& names, const cvt::String& folder );
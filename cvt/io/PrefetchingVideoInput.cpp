@@ -0,0 +1,180 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/io/PrefetchingVideoInput.h>
+#include <cvt/util/Exception.h>
+
+namespace cvt {
+
+	PrefetchingVideoInput::PrefetchingVideoInput( VideoInput* input, bool finite, PrefetchMode mode, size_t depth, double maxLatency ) :
+		_input( input ),
+		_finite( finite ),
+		_mode( mode ),
+		_maxLatency( maxLatency ),
+		_frame( input->frame() ),
+		_latency( 0.0 ),
+		_slots( depth ),
+		_dropped( 0 ),
+		_stop( false ),
+		_eos( false ),
+		_failed( false )
+	{
+		if( !depth )
+			throw CVTException( "Prefetch depth has to be at least one" );
+
+		for( size_t i = depth; i--; )
+			_free.push_back( i );
+		_thread.run( this );
+	}
+
+	PrefetchingVideoInput::~PrefetchingVideoInput()
+	{
+		_mutex.lock();
+		_stop = true;
+		_cond.notifyAll();
+		_mutex.unlock();
+		_thread.join();
+	}
+
+	size_t PrefetchingVideoInput::dropped() const
+	{
+		ScopeLock lock( &_mutex );
+		return _dropped;
+	}
+
+	bool PrefetchingVideoInput::endOfStream() const
+	{
+		ScopeLock lock( &_mutex );
+		return _eos && !_failed && _ready.empty();
+	}
+
+	bool PrefetchingVideoInput::nextFrame( size_t timeOut )
+	{
+		Time timer;
+
+		_mutex.lock();
+		while( _ready.empty() ) {
+			if( _failed ) {
+				// report the error once, afterwards behave like the end of the stream
+				Exception e = _error;
+				_failed = false;
+				_mutex.unlock();
+				throw e;
+			}
+			if( _eos ) {
+				_mutex.unlock();
+				return false;
+			}
+			double left = ( double ) timeOut - timer.elapsedMilliSeconds();
+			if( left <= 0.0 ) {
+				_mutex.unlock();
+				return false;
+			}
+			_cond.wait( _mutex, ( size_t ) left + 1 );
+		}
+
+		if( _mode == PREFETCH_DROP ) {
+			// skip stale frames, but always deliver the newest one
+			while( _ready.size() > 1 && _slots[ _ready.front() ].stamp.elapsedMilliSeconds() > _maxLatency ) {
+				_free.push_back( _ready.front() );
+				_ready.pop_front();
+				_dropped++;
+			}
+		}
+
+		size_t idx = _ready.front();
+		_ready.pop_front();
+		_latency = _slots[ idx ].stamp.elapsedMilliSeconds();
+		_frame.swap( _slots[ idx ].image );
+		_free.push_back( idx );
+		_cond.notifyAll();
+		_mutex.unlock();
+		return true;
+	}
+
+	void PrefetchingVideoInput::capture()
+	{
+		_mutex.lock();
+		while( !_stop ) {
+			_mutex.unlock();
+			Time timer;
+			bool ok = false;
+			bool failed = true;
+			Exception error;
+			try {
+				ok = _input->nextFrame( CAPTURE_TIMEOUT );
+				failed = false;
+			} catch( const Exception& e ) {
+				error = e;
+			} catch( const std::exception& e ) {
+				error = Exception( e.what() );
+			} catch( ... ) {
+			}
+			double elapsed = timer.elapsedMilliSeconds();
+			Time stamp;
+			_mutex.lock();
+
+			if( failed || ( !ok && _finite ) ) {
+				_failed = failed;
+				_error = error;
+				_eos = true;
+				_cond.notifyAll();
+				break;
+			}
+
+			if( !ok ) {
+				// live sources may fail right away, e.g. while not capturing, do not spin on them
+				if( elapsed < CAPTURE_TIMEOUT && !_stop )
+					_cond.wait( _mutex, CAPTURE_TIMEOUT - ( size_t ) elapsed );
+				continue;
+			}
+
+			while( !_stop && _free.empty() && _mode == PREFETCH_LOSSLESS )
+				_cond.wait( _mutex );
+			if( _stop )
+				break;
+
+			size_t idx;
+			if( _free.empty() ) {
+				// overwrite the oldest frame
+				idx = _ready.front();
+				_ready.pop_front();
+				_dropped++;
+			} else {
+				idx = _free.back();
+				_free.pop_back();
+			}
+			_mutex.unlock();
+
+			_slots[ idx ].image = _input->frame();
+			_slots[ idx ].stamp = stamp;
+
+			_mutex.lock();
+			_ready.push_back( idx );
+			_cond.notifyAll();
+		}
+		_mutex.unlock();
+	}
+
+}
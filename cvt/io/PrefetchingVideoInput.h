@@ -0,0 +1,117 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_PREFETCHINGVIDEOINPUT_H
+#define CVT_PREFETCHINGVIDEOINPUT_H
+
+#include <cvt/io/VideoInput.h>
+#include <cvt/util/Thread.h>
+#include <cvt/util/Mutex.h>
+#include <cvt/util/Condition.h>
+#include <cvt/util/Time.h>
+#include <cvt/util/Exception.h>
+
+#include <vector>
+#include <deque>
+
+namespace cvt {
+
+	enum PrefetchMode {
+		PREFETCH_LOSSLESS,	/* every frame is delivered, the capture thread blocks if the ring is full */
+		PREFETCH_DROP		/* the capture thread never blocks, frames older than the max. latency are dropped */
+	};
+
+	/**
+	  @brief Decorator running nextFrame() of another VideoInput on a background thread.
+
+	  Captured frames are copied into a bounded ring of images, nextFrame() hands them out by swapping
+	  with the current frame, the previous frame returns to the ring. The wrapped input is not owned and
+	  must not be used by anyone else while it is wrapped. For finite inputs (files, image sequences) the
+	  first failing nextFrame() of the wrapped input marks the end of the stream, the capture thread stops
+	  and nextFrame() returns false without blocking once all prefetched frames were handed out. Live
+	  inputs are retried until destruction. An exception thrown by the wrapped input also stops the
+	  capture thread, it is rethrown by nextFrame() after the frames captured before it.
+	 */
+	class PrefetchingVideoInput : public VideoInput {
+		public:
+			/* finite: a failing nextFrame() of input means end of stream, maxLatency in ms, only used in PREFETCH_DROP mode */
+			PrefetchingVideoInput( VideoInput* input, bool finite, PrefetchMode mode = PREFETCH_LOSSLESS, size_t depth = 4, double maxLatency = 100.0 );
+			~PrefetchingVideoInput();
+
+			size_t			width() const { return _frame.width(); }
+			size_t			height() const { return _frame.height(); }
+			const IFormat&	format() const { return _frame.format(); }
+			const Image&	frame() const { return _frame; }
+			bool			nextFrame( size_t timeOut = 5 );
+
+			/* number of frames dropped so far */
+			size_t			dropped() const;
+			/* age of the current frame when it was handed out, in ms */
+			double			latency() const { return _latency; }
+			/* the wrapped input has no more frames and all prefetched frames were handed out */
+			bool			endOfStream() const;
+
+		private:
+			struct Slot {
+				Image	image;
+				Time	stamp;
+			};
+
+			class Capture : public Thread<PrefetchingVideoInput> {
+				public:
+					void execute( PrefetchingVideoInput* input ) { input->capture(); }
+			};
+
+			/* timeout passed to the wrapped input, in ms */
+			static const size_t	CAPTURE_TIMEOUT = 50;
+
+			PrefetchingVideoInput( const PrefetchingVideoInput& );
+			PrefetchingVideoInput& operator=( const PrefetchingVideoInput& );
+
+			void				capture();
+
+			VideoInput*			_input;
+			bool				_finite;
+			PrefetchMode		_mode;
+			double				_maxLatency;
+			Image				_frame;
+			double				_latency;
+
+			std::vector<Slot>	_slots;
+			std::vector<size_t>	_free;
+			std::deque<size_t>	_ready;
+			size_t				_dropped;
+			bool				_stop;
+			bool				_eos;
+			bool				_failed;
+			Exception			_error;
+
+			mutable Mutex		_mutex;
+			Condition			_cond;
+			Capture				_thread;
+	};
+
+}
+
+#endif
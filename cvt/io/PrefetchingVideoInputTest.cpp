@@ -0,0 +1,165 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/io/PrefetchingVideoInput.h>
+#include <cvt/util/CVTTest.h>
+
+#include <unistd.h>
+
+using namespace cvt;
+
+/* synthetic source: frame n is a 8x8 gray image filled with n, stops after 200 frames */
+class CountingVideoInput : public VideoInput {
+	public:
+		CountingVideoInput( size_t usecs ) : _frame( 8, 8, IFormat::GRAY_UINT8 ), _count( 0 ), _usecs( usecs )
+		{
+			setValue( 0 );
+		}
+
+		size_t width() const { return _frame.width(); }
+		size_t height() const { return _frame.height(); }
+		const IFormat& format() const { return _frame.format(); }
+		const Image& frame() const { return _frame; }
+
+		bool nextFrame( size_t )
+		{
+			if( _count == 200 )
+				return false;
+			if( _usecs )
+				usleep( _usecs );
+			setValue( ++_count );
+			return true;
+		}
+
+	private:
+		void setValue( size_t v )
+		{
+			size_t stride;
+			uint8_t* p = _frame.map( &stride );
+			for( size_t y = 0; y < 8; y++ )
+				for( size_t x = 0; x < 8; x++ )
+					p[ y * stride + x ] = ( uint8_t ) v;
+			_frame.unmap( p );
+		}
+
+		Image	_frame;
+		size_t	_count;
+		size_t	_usecs;
+};
+
+/* live source: fails right away while not started, then delivers 5 frames and throws */
+class FlakyVideoInput : public VideoInput {
+	public:
+		FlakyVideoInput() : _frame( 8, 8, IFormat::GRAY_UINT8 ), _calls( 0 ) {}
+
+		size_t width() const { return _frame.width(); }
+		size_t height() const { return _frame.height(); }
+		const IFormat& format() const { return _frame.format(); }
+		const Image& frame() const { return _frame; }
+
+		bool nextFrame( size_t )
+		{
+			_calls++;
+			if( _calls <= 3 )
+				return false;
+			if( _calls > 8 )
+				throw CVTException( "device lost" );
+			return true;
+		}
+
+	private:
+		Image	_frame;
+		size_t	_calls;
+};
+
+static size_t frameValue( const Image& img )
+{
+	size_t stride;
+	const uint8_t* p = img.map( &stride );
+	size_t v = p[ 7 * stride + 7 ];
+	img.unmap( p );
+	return v;
+}
+
+BEGIN_CVTTEST( PrefetchingVideoInput )
+	bool result = true;
+	bool b;
+
+	{
+		CountingVideoInput src( 0 );
+		PrefetchingVideoInput input( &src, true, PREFETCH_LOSSLESS, 3 );
+		b = input.width() == 8 && frameValue( input.frame() ) == 0;
+		for( size_t i = 1; i <= 200; i++ ) {
+			b &= input.nextFrame( 1000 );
+			b &= frameValue( input.frame() ) == i;
+		}
+		// the end of the source is reported right away instead of after the timeout
+		Time timer;
+		b &= !input.nextFrame( 2000 );
+		b &= timer.elapsedMilliSeconds() < 1000.0;
+		b &= input.endOfStream();
+		b &= input.dropped() == 0;
+		result &= b;
+		CVTTEST_PRINT( "lossless", b );
+	}
+
+	{
+		CountingVideoInput src( 1000 );
+		PrefetchingVideoInput input( &src, true, PREFETCH_DROP, 4, 5.0 );
+		size_t last = 0;
+		b = true;
+		while( input.nextFrame( 500 ) ) {
+			size_t v = frameValue( input.frame() );
+			b &= v > last;
+			last = v;
+			usleep( 10000 );
+		}
+		b &= last == 200;
+		b &= input.dropped() > 0;
+		result &= b;
+		CVTTEST_PRINT( "drop", b );
+	}
+
+	{
+		FlakyVideoInput src;
+		PrefetchingVideoInput input( &src, false, PREFETCH_LOSSLESS, 8 );
+		// failing right away does not end a live stream
+		b = true;
+		for( size_t i = 0; i < 5; i++ )
+			b &= input.nextFrame( 2000 );
+		bool thrown = false;
+		try {
+			input.nextFrame( 2000 );
+		} catch( const Exception& e ) {
+			thrown = strstr( e.what(), "device lost" ) != NULL;
+		}
+		b &= thrown;
+		b &= !input.nextFrame( 2000 );
+		b &= input.endOfStream();
+		result &= b;
+		CVTTEST_PRINT( "live source errors", b );
+	}
+
+	return result;
+END_CVTTEST
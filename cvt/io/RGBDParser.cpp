@@ -27,10 +27,11 @@
 namespace cvt
 {
 
-    RGBDParser::RGBDParser( const String& folder, double maxStampDiff ) :
+    RGBDParser::RGBDParser( const String& folder, double maxStampDiff, size_t prefetchDepth ) :
         _maxStampDiff( maxStampDiff ), // this is 50ms
         _folder( folder ),
-        _idx( 0 )
+        _idx( 0 ),
+        _prefetcher( 0 )
     {
         if( _folder[ _folder.length() - 1 ] != '/' )
             _folder += "/";
@@ -69,6 +70,18 @@ namespace cvt
         std::cout << "RGB: " << _rgbFiles.size() << std::endl;
         std::cout << "Depth: " << _depthFiles.size() << std::endl;
         std::cout << "Stamps: " << _stamps.size() << std::endl;
+
+        if( prefetchDepth ){
+            _prefetcher = new ImagePrefetcher( prefetchDepth );
+            _prefetcher->addChannel( _rgbFiles );
+            _prefetcher->addChannel( _depthFiles );
+            _prefetcher->seek( _idx );
+        }
+    }
+
+    RGBDParser::~RGBDParser()
+    {
+        delete _prefetcher;
     }
 
     void RGBDParser::next()
@@ -78,8 +91,14 @@ namespace cvt
             return;
         }
         _sample.stamp	= _stamps[ _idx ];
-        _sample.rgb.load( _rgbFiles[ _idx ] );
-        _sample.depth.load( _depthFiles[ _idx ] );
+        if( _prefetcher ){
+            // out of order indices (setIdx) restart the read-ahead
+            Image* images[ 2 ] = { &_sample.rgb, &_sample.depth };
+            _prefetcher->fetch( _idx, images );
+        } else {
+            _sample.rgb.load( _rgbFiles[ _idx ] );
+            _sample.depth.load( _depthFiles[ _idx ] );
+        }
         _sample.orientation = _orientations[ _idx ];
         _sample.position = _positions[ _idx ];
         _sample.poseValid = _poseValid[ _idx ];
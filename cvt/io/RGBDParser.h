@@ -30,6 +30,7 @@
 #include <cvt/util/DataIterator.h>
 #include <cvt/io/FileSystem.h>
 #include <cvt/io/RGBDInput.h>
+#include <cvt/io/ImagePrefetcher.h>
 #include <cvt/gfx/Image.h>
 #include <cvt/math/Matrix.h>
 
@@ -63,7 +64,12 @@ namespace cvt
                 }
             };
 
-            RGBDParser( const String& folder, double maxStampDiff = 0.05 );
+            /**
+             * @param prefetchDepth number of samples decoded ahead of next() by background threads,
+             *                      0 loads the images synchronously within next()
+             */
+            RGBDParser( const String& folder, double maxStampDiff = 0.05, size_t prefetchDepth = 4 );
+            ~RGBDParser();
 
             void next();
 
@@ -95,7 +101,10 @@ namespace cvt
 
             RGBDSample				_sample;
             size_t					_idx;
+            ImagePrefetcher*		_prefetcher;
 
+            RGBDParser( const RGBDParser& );
+            RGBDParser& operator=( const RGBDParser& );
 
             void loadGroundTruth();
             void loadRGBFilenames( std::vector<double> & stamps );
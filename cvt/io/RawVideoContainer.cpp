@@ -0,0 +1,114 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/io/RawVideoContainer.h>
+#include <cvt/util/LZ4.h>
+#include <cvt/util/SIMD.h>
+
+#include <string.h>
+
+namespace cvt {
+
+	const size_t	RawVideoContainer::ALIGNMENT;
+	const uint32_t	RawVideoContainer::VERSION;
+	const uint32_t	RawVideoContainer::BLOB_MAGIC;
+	const size_t	RawVideoContainer::BAND_BYTES;
+
+	template<typename T>
+	static void deltaRow( T* dst, const T* src, size_t n, size_t dist )
+	{
+		for( size_t i = 0; i < dist; i++ )
+			dst[ i ] = src[ i ];
+		for( size_t i = dist; i < n; i++ )
+			dst[ i ] = ( T ) ( src[ i ] - src[ i - dist ] );
+	}
+
+	template<typename T>
+	static void undeltaRow( T* row, size_t n, size_t dist )
+	{
+		for( size_t i = dist; i < n; i++ )
+			row[ i ] = ( T ) ( row[ i ] + row[ i - dist ] );
+	}
+
+	static void deltaRow( uint8_t* dst, const uint8_t* src, const RawVideoStreamInfo& info )
+	{
+		const IFormat& format = info.format();
+		size_t dist = format.bpp / format.bpc;
+		switch( format.bpc ) {
+			case 2: deltaRow<uint16_t>( ( uint16_t* ) dst, ( const uint16_t* ) src, info.rowBytes / 2, dist ); break;
+			case 4: deltaRow<uint32_t>( ( uint32_t* ) dst, ( const uint32_t* ) src, info.rowBytes / 4, dist ); break;
+			default: deltaRow<uint8_t>( dst, src, info.rowBytes, dist ); break;
+		}
+	}
+
+	static void undeltaRow( uint8_t* row, const RawVideoStreamInfo& info )
+	{
+		const IFormat& format = info.format();
+		size_t dist = format.bpp / format.bpc;
+		switch( format.bpc ) {
+			case 2: undeltaRow<uint16_t>( ( uint16_t* ) row, info.rowBytes / 2, dist ); break;
+			case 4: undeltaRow<uint32_t>( ( uint32_t* ) row, info.rowBytes / 4, dist ); break;
+			default: undeltaRow<uint8_t>( row, info.rowBytes, dist ); break;
+		}
+	}
+
+	size_t RawVideoContainer::encodeBand( uint8_t* dst, uint8_t* tmp, const uint8_t* src, size_t srcStride, size_t rows, const RawVideoStreamInfo& info )
+	{
+		const uint8_t* data = src;
+
+		if( info.codec == RAWVIDEO_CODEC_DELTA_LZ4 ) {
+			for( size_t y = 0; y < rows; y++ )
+				deltaRow( tmp + y * info.rowBytes, src + y * srcStride, info );
+			data = tmp;
+		} else if( srcStride != info.rowBytes ) {
+			SIMD* simd = SIMD::instance();
+			for( size_t y = 0; y < rows; y++ )
+				simd->Memcpy( tmp + y * info.rowBytes, src + y * srcStride, info.rowBytes );
+			data = tmp;
+		}
+
+		return LZ4::compress( dst, data, rows * info.rowBytes );
+	}
+
+	bool RawVideoContainer::decodeBand( uint8_t* dst, size_t dstStride, uint8_t* tmp, const uint8_t* src, size_t srcSize, size_t rows, const RawVideoStreamInfo& info )
+	{
+		if( dstStride == info.rowBytes ) {
+			if( !LZ4::decompress( dst, rows * info.rowBytes, src, srcSize ) )
+				return false;
+		} else {
+			if( !LZ4::decompress( tmp, rows * info.rowBytes, src, srcSize ) )
+				return false;
+			SIMD* simd = SIMD::instance();
+			for( size_t y = 0; y < rows; y++ )
+				simd->Memcpy( dst + y * dstStride, tmp + y * info.rowBytes, info.rowBytes );
+		}
+
+		if( info.codec == RAWVIDEO_CODEC_DELTA_LZ4 ) {
+			for( size_t y = 0; y < rows; y++ )
+				undeltaRow( dst + y * dstStride, info );
+		}
+		return true;
+	}
+
+}
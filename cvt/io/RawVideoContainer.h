@@ -0,0 +1,112 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_RAWVIDEOCONTAINER_H
+#define CVT_RAWVIDEOCONTAINER_H
+
+#include <cvt/gfx/IFormat.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+
+namespace cvt {
+
+	enum RawVideoCodec {
+		RAWVIDEO_CODEC_NONE = 0,	/* uncompressed rows, can be accessed directly in the mapped file */
+		RAWVIDEO_CODEC_LZ4,			/* LZ4 per band */
+		RAWVIDEO_CODEC_DELTA_LZ4	/* difference to the left pixel, then LZ4: suited for depth and smooth images */
+	};
+
+	struct RawVideoStreamInfo {
+		uint32_t	width;
+		uint32_t	height;
+		uint32_t	formatID;
+		uint32_t	codec;
+		uint32_t	rowBytes;
+		/* rows per independently compressed band */
+		uint32_t	bandRows;
+		uint32_t	reserved[ 2 ];
+
+		size_t		numBands() const { return ( height + bandRows - 1 ) / bandRows; }
+		size_t		frameBytes() const { return ( size_t ) height * rowBytes; }
+		const IFormat& format() const { return IFormat::formatForId( ( IFormatID ) formatID ); }
+	};
+
+	/**
+	  @brief On-disk layout of the chunked RawVideo container ( version 2 ).
+
+	  File header and stream table, followed by one blob per frame and stream. Every blob starts with a
+	  BlobHeader and is aligned to ALIGNMENT bytes, so uncompressed payloads can be used in place from a
+	  mapped file. Compressed payloads start with a table of the compressed band sizes, the bands of a
+	  frame can be decoded independently. The writer appends the index ( timestamps and blob offsets )
+	  and a Footer on close, files without a valid footer are recovered by scanning the blob headers.
+	 */
+	class RawVideoContainer {
+		public:
+			static const size_t		ALIGNMENT = 64;
+			static const uint32_t	VERSION = 2;
+			static const uint32_t	BLOB_MAGIC = 0x42545643; // "CVTB"
+			/* target size of an uncompressed band */
+			static const size_t		BAND_BYTES = 128 * 1024;
+
+			struct FileHeader {
+				char		magic[ 8 ];
+				uint32_t	version;
+				uint32_t	numStreams;
+				uint32_t	dataOffset;
+				uint32_t	reserved[ 11 ];
+			};
+
+			struct BlobHeader {
+				uint32_t	magic;
+				uint32_t	stream;
+				uint64_t	frame;
+				double		stamp;
+				uint64_t	payloadSize;
+				uint32_t	numBands;
+				uint32_t	reserved[ 7 ];
+			};
+
+			struct Footer {
+				char		magic[ 8 ];
+				uint64_t	numFrames;
+				uint64_t	indexOffset;
+				uint64_t	reserved;
+			};
+
+			static const char* fileMagic() { return "CVTRAWV2"; }
+			static const char* footerMagic() { return "CVTRAWIX"; }
+
+			static size_t	align( size_t n ) { return ( n + ALIGNMENT - 1 ) & ~( ALIGNMENT - 1 ); }
+
+			/* compress rows starting at src into dst ( LZ4::compressBound bytes ), tmp needs rows * rowBytes bytes */
+			static size_t	encodeBand( uint8_t* dst, uint8_t* tmp, const uint8_t* src, size_t srcStride, size_t rows, const RawVideoStreamInfo& info );
+
+			/* inverse of encodeBand, returns false for corrupt data */
+			static bool		decodeBand( uint8_t* dst, size_t dstStride, uint8_t* tmp, const uint8_t* src, size_t srcSize, size_t rows, const RawVideoStreamInfo& info );
+	};
+
+}
+
+#endif
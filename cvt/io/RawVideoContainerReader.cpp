@@ -0,0 +1,302 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/io/RawVideoContainerReader.h>
+#include <cvt/util/Exception.h>
+#include <cvt/util/ParallelFor.h>
+#include <cvt/util/SIMD.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+namespace cvt {
+
+	class RawVideoContainerReader::DecodeBody {
+		public:
+			DecodeBody( uint8_t* dst, size_t stride, const uint8_t* data, const std::vector<size_t>& bandOffsets,
+					    const RawVideoStreamInfo& info, bool* failed ) :
+				_dst( dst ), _stride( stride ), _data( data ), _bandOffsets( bandOffsets ), _info( info ), _failed( failed )
+			{
+			}
+
+			void operator()( const Range<size_t>& r ) const
+			{
+				std::vector<uint8_t> tmp;
+				if( _stride != _info.rowBytes )
+					tmp.resize( ( size_t ) _info.bandRows * _info.rowBytes );
+
+				for( size_t b = r.min; b < r.max; b++ ) {
+					size_t y0 = b * _info.bandRows;
+					size_t rows = Math::min<size_t>( _info.bandRows, _info.height - y0 );
+					if( !RawVideoContainer::decodeBand( _dst + y0 * _stride, _stride, tmp.empty() ? NULL : &tmp[ 0 ], _data + _bandOffsets[ b ],
+														_bandOffsets[ b + 1 ] - _bandOffsets[ b ], rows, _info ) )
+						__atomic_store_n( _failed, true, __ATOMIC_RELAXED );
+				}
+			}
+
+		private:
+			uint8_t*					_dst;
+			size_t						_stride;
+			const uint8_t*				_data;
+			const std::vector<size_t>&	_bandOffsets;
+			const RawVideoStreamInfo&	_info;
+			bool*						_failed;
+	};
+
+	RawVideoContainerReader::RawVideoContainerReader( const String& fileName, size_t stream ) :
+		_fd( -1 ),
+		_map( 0 ),
+		_mappedSize( 0 ),
+		_dataOffset( 0 ),
+		_stream( stream ),
+		_stamp( 0.0 ),
+		_position( 0 )
+	{
+		_fd = open( fileName.c_str(), O_RDONLY, 0 );
+		if( _fd < 0 ){
+			String msg( "Could not open file: " );
+			msg += strerror( errno );
+			throw CVTException( msg.c_str() );
+		}
+
+		struct stat fileInfo;
+		if( fstat( _fd, &fileInfo ) == -1 ){
+			String msg( "fstat error: " );
+			msg += strerror( errno );
+			::close( _fd );
+			throw CVTException( msg.c_str() );
+		}
+
+		_mappedSize = fileInfo.st_size;
+		if( _mappedSize < sizeof( RawVideoContainer::FileHeader ) ) {
+			::close( _fd );
+			throw CVTException( "File too small for a RawVideo container" );
+		}
+
+		_map = mmap( 0, _mappedSize, PROT_READ, MAP_PRIVATE, _fd, 0 );
+		if( _map == MAP_FAILED ){
+			String msg( "Could not map file: " );
+			msg += strerror( errno );
+			_map = 0;
+			::close( _fd );
+			throw CVTException( msg.c_str() );
+		}
+
+		try {
+			const uint8_t* base = ( const uint8_t* ) _map;
+			const RawVideoContainer::FileHeader* header = ( const RawVideoContainer::FileHeader* ) base;
+			if( memcmp( header->magic, RawVideoContainer::fileMagic(), sizeof( header->magic ) ) ||
+			    header->version != RawVideoContainer::VERSION )
+				throw CVTException( "Not a RawVideo container ( version 2 )" );
+
+			_dataOffset = header->dataOffset;
+			if( !header->numStreams ||
+				_dataOffset < sizeof( RawVideoContainer::FileHeader ) + header->numStreams * sizeof( RawVideoStreamInfo ) ||
+				_dataOffset > _mappedSize )
+				throw CVTException( "Corrupt RawVideo header" );
+
+			const RawVideoStreamInfo* infos = ( const RawVideoStreamInfo* ) ( header + 1 );
+			_streams.assign( infos, infos + header->numStreams );
+			for( size_t s = 0; s < _streams.size(); s++ ) {
+				const RawVideoStreamInfo& info = _streams[ s ];
+				if( info.formatID < IFORMAT_GRAY_UINT8 || info.formatID > IFORMAT_UYVY_UINT8 ||
+				    info.codec > RAWVIDEO_CODEC_DELTA_LZ4 || !info.bandRows ||
+				    info.rowBytes != info.width * info.format().bpp )
+					throw CVTException( "Corrupt RawVideo stream description" );
+			}
+			if( _stream >= _streams.size() )
+				throw CVTException( "Stream index out of range" );
+
+			readIndex();
+		} catch( const Exception& ) {
+			munmap( _map, _mappedSize );
+			::close( _fd );
+			throw;
+		}
+
+		_frames.resize( _streams.size() );
+		for( size_t s = 0; s < _streams.size(); s++ )
+			_frames[ s ].reallocate( _streams[ s ].width, _streams[ s ].height, _streams[ s ].format() );
+	}
+
+	RawVideoContainerReader::~RawVideoContainerReader()
+	{
+		if( munmap( _map, _mappedSize ) != 0 ){
+			String msg( "Could not unmap memory: " );
+			msg += strerror( errno );
+			throw CVTException( msg.c_str() );
+		}
+
+		if( ::close( _fd ) < 0 ){
+			String msg( "Could not close file: " );
+			msg += strerror( errno );
+			throw CVTException( msg.c_str() );
+		}
+	}
+
+	void RawVideoContainerReader::readIndex()
+	{
+		const uint8_t* base = ( const uint8_t* ) _map;
+		size_t n = _streams.size();
+
+		if( _mappedSize >= _dataOffset + sizeof( RawVideoContainer::Footer ) ) {
+			const RawVideoContainer::Footer* footer = ( const RawVideoContainer::Footer* ) ( base + _mappedSize - sizeof( RawVideoContainer::Footer ) );
+			uint64_t indexEnd = _mappedSize - sizeof( RawVideoContainer::Footer );
+			uint64_t entrySize = sizeof( double ) + n * sizeof( uint64_t );
+
+			// check the frame count against the file size first, a corrupt count must not overflow the index size
+			if( !memcmp( footer->magic, RawVideoContainer::footerMagic(), sizeof( footer->magic ) ) &&
+				footer->indexOffset >= _dataOffset && footer->indexOffset <= indexEnd &&
+				footer->numFrames <= ( indexEnd - footer->indexOffset ) / entrySize &&
+				footer->indexOffset + footer->numFrames * entrySize == indexEnd ) {
+				const double* stamps = ( const double* ) ( base + footer->indexOffset );
+				const uint64_t* offsets = ( const uint64_t* ) ( stamps + footer->numFrames );
+				_stamps.assign( stamps, stamps + footer->numFrames );
+				_offsets.assign( offsets, offsets + footer->numFrames * n );
+
+				for( size_t i = 0; i < _offsets.size(); i++ ) {
+					if( _offsets[ i ] < _dataOffset || _offsets[ i ] + sizeof( RawVideoContainer::BlobHeader ) > footer->indexOffset )
+						throw CVTException( "Corrupt RawVideo index" );
+				}
+				return;
+			}
+		}
+
+		// no index: recording was interrupted
+		recoverIndex();
+	}
+
+	void RawVideoContainerReader::recoverIndex()
+	{
+		const uint8_t* base = ( const uint8_t* ) _map;
+		size_t n = _streams.size();
+		size_t pos = _dataOffset;
+		size_t stream = 0;
+		uint64_t frame = 0;
+
+		while( pos + sizeof( RawVideoContainer::BlobHeader ) <= _mappedSize ) {
+			const RawVideoContainer::BlobHeader* header = ( const RawVideoContainer::BlobHeader* ) ( base + pos );
+			if( header->magic != RawVideoContainer::BLOB_MAGIC || header->stream != stream || header->frame != frame ||
+				header->payloadSize > _mappedSize - pos - sizeof( RawVideoContainer::BlobHeader ) )
+				break;
+
+			_offsets.push_back( pos );
+			if( ++stream == n ) {
+				_stamps.push_back( header->stamp );
+				stream = 0;
+				frame++;
+			}
+			pos += RawVideoContainer::align( sizeof( RawVideoContainer::BlobHeader ) + header->payloadSize );
+		}
+		// drop incomplete frames
+		_offsets.resize( _stamps.size() * n );
+	}
+
+	const RawVideoContainer::BlobHeader* RawVideoContainerReader::blob( size_t frame, size_t stream ) const
+	{
+		if( frame >= _stamps.size() || stream >= _streams.size() )
+			throw CVTException( "Frame or stream index out of range" );
+		size_t offset = _offsets[ frame * _streams.size() + stream ];
+		const RawVideoContainer::BlobHeader* header = ( const RawVideoContainer::BlobHeader* ) ( ( const uint8_t* ) _map + offset );
+		if( header->magic != RawVideoContainer::BLOB_MAGIC || header->stream != stream ||
+			header->payloadSize > _mappedSize - offset - sizeof( RawVideoContainer::BlobHeader ) )
+			throw CVTException( "Corrupt RawVideo frame header" );
+		if( _streams[ stream ].codec == RAWVIDEO_CODEC_NONE && header->payloadSize != _streams[ stream ].frameBytes() )
+			throw CVTException( "Corrupt RawVideo frame header" );
+		return header;
+	}
+
+	bool RawVideoContainerReader::nextFrame( size_t )
+	{
+		if( _position >= _stamps.size() )
+			return false;
+
+		for( size_t s = 0; s < _streams.size(); s++ )
+			readFrame( _frames[ s ], _position, s );
+		_stamp = _stamps[ _position ];
+		_position++;
+		return true;
+	}
+
+	void RawVideoContainerReader::seek( size_t frame )
+	{
+		if( frame > _stamps.size() )
+			throw CVTException( "Frame index out of range" );
+		_position = frame;
+	}
+
+	const uint8_t* RawVideoContainerReader::rawFrame( size_t frame, size_t stream, size_t& stride ) const
+	{
+		const RawVideoContainer::BlobHeader* header = blob( frame, stream );
+		if( _streams[ stream ].codec != RAWVIDEO_CODEC_NONE )
+			return NULL;
+		stride = _streams[ stream ].rowBytes;
+		return ( const uint8_t* ) ( header + 1 );
+	}
+
+	void RawVideoContainerReader::readFrame( Image& dst, size_t frame, size_t stream ) const
+	{
+		const RawVideoContainer::BlobHeader* header = blob( frame, stream );
+		const RawVideoStreamInfo& info = _streams[ stream ];
+		const uint8_t* data = ( const uint8_t* ) ( header + 1 );
+
+		dst.reallocate( info.width, info.height, info.format() );
+		size_t stride;
+		uint8_t* ptr = dst.map( &stride );
+
+		if( info.codec == RAWVIDEO_CODEC_NONE ) {
+			SIMD* simd = SIMD::instance();
+			if( stride == info.rowBytes ) {
+				simd->Memcpy( ptr, data, info.frameBytes() );
+			} else {
+				for( size_t y = 0; y < info.height; y++ )
+					simd->Memcpy( ptr + y * stride, data + y * info.rowBytes, info.rowBytes );
+			}
+			dst.unmap( ptr );
+			return;
+		}
+
+		size_t numBands = info.numBands();
+		std::vector<size_t> bandOffsets( numBands + 1 );
+		bool failed = header->numBands != numBands || header->payloadSize < numBands * sizeof( uint32_t );
+		if( !failed ) {
+			const uint32_t* bandSizes = ( const uint32_t* ) data;
+			bandOffsets[ 0 ] = numBands * sizeof( uint32_t );
+			for( size_t b = 0; b < numBands; b++ )
+				bandOffsets[ b + 1 ] = bandOffsets[ b ] + bandSizes[ b ];
+			failed = bandOffsets[ numBands ] != header->payloadSize;
+		}
+		if( !failed )
+			parallelFor( Range<size_t>( 0, numBands ), DecodeBody( ptr, stride, data, bandOffsets, info, &failed ), 1 );
+		dst.unmap( ptr );
+
+		if( failed )
+			throw CVTException( "Corrupt RawVideo frame data" );
+	}
+
+}
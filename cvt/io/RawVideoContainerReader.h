@@ -0,0 +1,102 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_RAWVIDEOCONTAINERREADER_H
+#define CVT_RAWVIDEOCONTAINERREADER_H
+
+#include <cvt/io/RawVideoContainer.h>
+#include <cvt/io/VideoInput.h>
+#include <cvt/util/String.h>
+#include <cvt/gfx/Image.h>
+
+#include <vector>
+
+namespace cvt {
+
+	/**
+	  @brief Reader for the chunked, indexed RawVideo container ( see RawVideoContainer ).
+
+	  The file is mapped, seeking is O(1) through the index. nextFrame() decodes all streams of the next
+	  frame, the VideoInput interface reports the stream selected in the constructor. readFrame() can be
+	  used concurrently from multiple threads, the bands of a compressed frame are decoded in parallel.
+	 */
+	class RawVideoContainerReader : public VideoInput {
+		public:
+			RawVideoContainerReader( const String& fileName, size_t stream = 0 );
+			~RawVideoContainerReader();
+
+			size_t			width() const { return _streams[ _stream ].width; }
+			size_t			height() const { return _streams[ _stream ].height; }
+			const IFormat&	format() const { return _streams[ _stream ].format(); }
+			const Image&	frame() const { return _frames[ _stream ]; }
+			bool			nextFrame( size_t timeout = 0 );
+
+			const Image&	frame( size_t stream ) const { return _frames[ stream ]; }
+			/* timestamp of the current frame */
+			double			stamp() const { return _stamp; }
+
+			size_t			numStreams() const { return _streams.size(); }
+			size_t			numFrames() const { return _stamps.size(); }
+			const RawVideoStreamInfo& streamInfo( size_t stream ) const { return _streams[ stream ]; }
+			double			timestamp( size_t frame ) const { return _stamps[ frame ]; }
+
+			/* the next call to nextFrame() delivers frame */
+			void			seek( size_t frame );
+			/* index of the frame delivered by the next call to nextFrame() */
+			size_t			position() const { return _position; }
+
+			/* decode a single stream of a frame into dst */
+			void			readFrame( Image& dst, size_t frame, size_t stream ) const;
+
+			/* pointer to the rows of an uncompressed stream inside the mapped file, NULL for compressed streams */
+			const uint8_t*	rawFrame( size_t frame, size_t stream, size_t& stride ) const;
+
+		private:
+			class DecodeBody;
+
+			RawVideoContainerReader( const RawVideoContainerReader& );
+			RawVideoContainerReader& operator=( const RawVideoContainerReader& );
+
+			const RawVideoContainer::BlobHeader* blob( size_t frame, size_t stream ) const;
+			void			readIndex();
+			void			recoverIndex();
+
+			int								_fd;
+			void*							_map;
+			size_t							_mappedSize;
+			size_t							_dataOffset;
+			size_t							_stream;
+
+			std::vector<RawVideoStreamInfo>	_streams;
+			std::vector<double>				_stamps;
+			std::vector<uint64_t>			_offsets;
+
+			std::vector<Image>				_frames;
+			double							_stamp;
+			size_t							_position;
+	};
+
+}
+
+#endif
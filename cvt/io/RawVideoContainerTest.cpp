@@ -0,0 +1,229 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/io/RawVideoContainerWriter.h>
+#include <cvt/io/RawVideoContainerReader.h>
+#include <cvt/util/LZ4.h>
+#include <cvt/util/RNG.h>
+#include <cvt/util/Exception.h>
+#include <cvt/util/CVTTest.h>
+#include <cvt/util/CVTTestImage.h>
+
+#include <stdio.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <string.h>
+
+using namespace cvt;
+
+static void fillPattern( Image& img, size_t frame, RNG& rng )
+{
+	size_t stride;
+	uint8_t* p = img.map( &stride );
+	size_t rowBytes = img.width() * img.bpp();
+	for( size_t y = 0; y < img.height(); y++ ) {
+		for( size_t x = 0; x < rowBytes; x++ ) {
+			// smooth ramp with some noise, compresses but not trivially
+			p[ y * stride + x ] = ( uint8_t ) ( ( x / 3 + y + frame ) + ( rng.uint32() & 0x3 ) );
+		}
+	}
+	img.unmap( p );
+}
+
+static bool testLZ4()
+{
+	RNG rng( 17 );
+	bool ok = true;
+	size_t sizes[] = { 0, 1, 12, 13, 100, 70000, 300000 };
+	for( size_t i = 0; i < sizeof( sizes ) / sizeof( sizes[ 0 ] ); i++ ) {
+		size_t n = sizes[ i ];
+		std::vector<uint8_t> src( n + 1 ), enc( LZ4::compressBound( n ) ), dec( n + 1 );
+		for( size_t k = 0; k < n; k++ )
+			src[ k ] = ( i & 1 ) ? ( uint8_t ) rng.uint32() : ( uint8_t ) ( ( k / 7 ) % 13 );
+		size_t len = LZ4::compress( &enc[ 0 ], &src[ 0 ], n );
+		ok &= len <= enc.size();
+		ok &= LZ4::decompress( &dec[ 0 ], n, &enc[ 0 ], len );
+		ok &= !n || !memcmp( &src[ 0 ], &dec[ 0 ], n );
+		// truncated input has to be rejected
+		if( len > 1 )
+			ok &= !LZ4::decompress( &dec[ 0 ], n, &enc[ 0 ], len - 1 );
+	}
+	return ok;
+}
+
+BEGIN_CVTTEST( RawVideoContainer )
+	bool result = true;
+	bool b;
+
+	b = testLZ4();
+	result &= b;
+	CVTTEST_PRINT( "LZ4 roundtrip", b );
+
+	String file;
+	file.sprintf( "/tmp/cvt_rawvideo_%d.rawv", ( int ) getpid() );
+
+	const size_t numFrames = 12;
+	std::vector<Image> left, right, depth;
+	RNG rng( 5 );
+	for( size_t i = 0; i < numFrames; i++ ) {
+		left.push_back( Image( 61, 47, IFormat::GRAY_UINT8 ) );
+		right.push_back( Image( 320, 240, IFormat::RGBA_UINT8 ) );
+		depth.push_back( Image( 160, 120, IFormat::GRAY_UINT16 ) );
+		fillPattern( left.back(), i, rng );
+		fillPattern( right.back(), i, rng );
+		fillPattern( depth.back(), i, rng );
+	}
+
+	{
+		RawVideoContainerWriter writer( file );
+		writer.addStream( 61, 47, IFormat::GRAY_UINT8, RAWVIDEO_CODEC_NONE );
+		writer.addStream( 320, 240, IFormat::RGBA_UINT8, RAWVIDEO_CODEC_LZ4 );
+		writer.addStream( 160, 120, IFormat::GRAY_UINT16, RAWVIDEO_CODEC_DELTA_LZ4 );
+		for( size_t i = 0; i < numFrames; i++ ) {
+			const Image* images[ 3 ] = { &left[ i ], &right[ i ], &depth[ i ] };
+			writer.write( images, 0.1 * i );
+		}
+	}
+
+	{
+		RawVideoContainerReader reader( file, 1 );
+		b = reader.numStreams() == 3 && reader.numFrames() == numFrames && reader.width() == 320;
+		for( size_t i = 0; i < numFrames; i++ ) {
+			b &= reader.nextFrame();
+			b &= reader.stamp() == 0.1 * i;
+			b &= testEqualImages( reader.frame( 0 ), left[ i ] );
+			b &= testEqualImages( reader.frame(), right[ i ] );
+			b &= testEqualImages( reader.frame( 2 ), depth[ i ] );
+		}
+		b &= !reader.nextFrame();
+		result &= b;
+		CVTTEST_PRINT( "sequential read", b );
+
+		reader.seek( 7 );
+		b = reader.nextFrame() && testEqualImages( reader.frame( 2 ), depth[ 7 ] ) && reader.position() == 8;
+		Image tmp;
+		reader.readFrame( tmp, 3, 1 );
+		b &= testEqualImages( tmp, right[ 3 ] );
+
+		size_t stride;
+		const uint8_t* raw = reader.rawFrame( 5, 0, stride );
+		Image view( 61, 47, IFormat::GRAY_UINT8, ( uint8_t* ) raw, stride );
+		b &= raw && testEqualImages( view, left[ 5 ] );
+		b &= reader.rawFrame( 5, 1, stride ) == NULL;
+		result &= b;
+		CVTTEST_PRINT( "seek and random access", b );
+	}
+
+	// simulate an interrupted recording: no index and an incomplete last frame
+	{
+		RawVideoContainerWriter writer( file );
+		writer.addStream( 160, 120, IFormat::GRAY_UINT16, RAWVIDEO_CODEC_DELTA_LZ4 );
+		for( size_t i = 0; i < numFrames; i++ )
+			writer.write( depth[ i ], i );
+	}
+	struct stat st;
+	b = stat( file.c_str(), &st ) == 0;
+	size_t indexSize = numFrames * ( sizeof( double ) + sizeof( uint64_t ) ) + sizeof( RawVideoContainer::Footer );
+	b &= truncate( file.c_str(), st.st_size - indexSize - 100 ) == 0;
+	{
+		RawVideoContainerReader reader( file );
+		b &= reader.numFrames() == numFrames - 1;
+		for( size_t i = 0; i + 1 < numFrames; i++ ) {
+			b &= reader.nextFrame();
+			b &= testEqualImages( reader.frame(), depth[ i ] ) && reader.stamp() == i;
+		}
+	}
+	result &= b;
+	CVTTEST_PRINT( "index recovery", b );
+
+	// a corrupt frame count in the footer must not overflow the index size
+	{
+		RawVideoContainerWriter writer( file );
+		writer.addStream( 160, 120, IFormat::GRAY_UINT16, RAWVIDEO_CODEC_DELTA_LZ4 );
+		for( size_t i = 0; i < numFrames; i++ )
+			writer.write( depth[ i ], i );
+	}
+	b = stat( file.c_str(), &st ) == 0;
+	{
+		FILE* f = fopen( file.c_str(), "r+b" );
+		RawVideoContainer::Footer footer;
+		b &= f && fseek( f, st.st_size - sizeof( footer ), SEEK_SET ) == 0 && fread( &footer, sizeof( footer ), 1, f ) == 1;
+		// 16 * numFrames wraps around to the size of the real index
+		footer.numFrames += 1ULL << 60;
+		b &= f && fseek( f, st.st_size - sizeof( footer ), SEEK_SET ) == 0 && fwrite( &footer, sizeof( footer ), 1, f ) == 1;
+		if( f )
+			fclose( f );
+	}
+	{
+		RawVideoContainerReader reader( file );
+		b &= reader.numFrames() == numFrames;
+		reader.seek( numFrames - 1 );
+		b &= reader.nextFrame() && testEqualImages( reader.frame(), depth[ numFrames - 1 ] );
+	}
+	result &= b;
+	CVTTEST_PRINT( "corrupt index size", b );
+
+	// a frame that is only partially written is dropped, later frames are indexed correctly
+	{
+		RawVideoContainerWriter writer( file );
+		writer.addStream( 61, 47, IFormat::GRAY_UINT8, RAWVIDEO_CODEC_NONE );
+		for( size_t i = 0; i < 3; i++ )
+			writer.write( left[ i ], i );
+
+		struct rlimit limit, old;
+		void ( *handler )( int ) = signal( SIGXFSZ, SIG_IGN );
+		b = stat( file.c_str(), &st ) == 0 && getrlimit( RLIMIT_FSIZE, &old ) == 0;
+		limit = old;
+		limit.rlim_cur = st.st_size + 1000;
+		b &= setrlimit( RLIMIT_FSIZE, &limit ) == 0;
+		bool failed = false;
+		try {
+			writer.write( left[ 3 ], 3 );
+		} catch( const Exception& ) {
+			failed = true;
+		}
+		setrlimit( RLIMIT_FSIZE, &old );
+		signal( SIGXFSZ, handler );
+		b &= failed;
+
+		for( size_t i = 3; i < 6; i++ )
+			writer.write( left[ i ], i );
+	}
+	{
+		RawVideoContainerReader reader( file );
+		b &= reader.numFrames() == 6;
+		for( size_t i = 0; i < 6; i++ ) {
+			b &= reader.nextFrame();
+			b &= testEqualImages( reader.frame(), left[ i ] ) && reader.stamp() == i;
+		}
+	}
+	result &= b;
+	CVTTEST_PRINT( "partial write", b );
+
+	unlink( file.c_str() );
+
+	return result;
+END_CVTTEST
@@ -0,0 +1,341 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/io/RawVideoContainerWriter.h>
+#include <cvt/util/Exception.h>
+#include <cvt/util/ParallelFor.h>
+#include <cvt/util/LZ4.h>
+#include <cvt/util/SIMD.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <limits.h>
+#include <string.h>
+#include <errno.h>
+
+namespace cvt {
+
+	class RawVideoContainerWriter::EncodeBody {
+		public:
+			EncodeBody( RawVideoContainerWriter& writer, const std::vector<const uint8_t*>& ptrs, const std::vector<size_t>& strides ) :
+				_writer( writer ), _ptrs( ptrs ), _strides( strides )
+			{
+			}
+
+			void operator()( const Range<size_t>& r ) const
+			{
+				for( size_t t = r.min; t < r.max; t++ ) {
+					size_t s = _writer._taskStream[ t ];
+					const RawVideoStreamInfo& info = _writer._streams[ s ];
+					size_t y0 = _writer._taskBand[ t ] * info.bandRows;
+					size_t rows = Math::min<size_t>( info.bandRows, info.height - y0 );
+					_writer._taskSize[ t ] = RawVideoContainer::encodeBand( &_writer._taskData[ t ][ 0 ], &_writer._taskTmp[ t ][ 0 ],
+																		  _ptrs[ s ] + y0 * _strides[ s ], _strides[ s ], rows, info );
+				}
+			}
+
+		private:
+			RawVideoContainerWriter&			_writer;
+			const std::vector<const uint8_t*>&	_ptrs;
+			const std::vector<size_t>&			_strides;
+	};
+
+	RawVideoContainerWriter::RawVideoContainerWriter( const String& fileName ) :
+		_fd( -1 ),
+		_offset( 0 ),
+		_started( false ),
+		_failed( false )
+	{
+		_fd = open( fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP );
+		if( _fd < 0 ){
+			String msg( "Could not open file: " );
+			msg += strerror( errno );
+			throw CVTException( msg.c_str() );
+		}
+	}
+
+	RawVideoContainerWriter::~RawVideoContainerWriter()
+	{
+		try {
+			close();
+		} catch( const Exception& ) {
+			// the index is lost, the reader recovers the frames written so far
+		}
+	}
+
+	size_t RawVideoContainerWriter::addStream( size_t width, size_t height, const IFormat& format, RawVideoCodec codec )
+	{
+		if( _started )
+			throw CVTException( "Streams have to be added before the first frame is written" );
+		if( !width || !height )
+			throw CVTException( "Invalid stream size" );
+
+		RawVideoStreamInfo info;
+		memset( &info, 0, sizeof( info ) );
+		info.width		= width;
+		info.height		= height;
+		info.formatID	= format.formatID;
+		info.codec		= codec;
+		info.rowBytes	= width * format.bpp;
+		info.bandRows	= codec == RAWVIDEO_CODEC_NONE ? height : Math::clamp<size_t>( RawVideoContainer::BAND_BYTES / info.rowBytes, 1, height );
+		_streams.push_back( info );
+		return _streams.size() - 1;
+	}
+
+	void RawVideoContainerWriter::write( const Image& image, double stamp )
+	{
+		const Image* images = &image;
+		write( &images, stamp );
+	}
+
+	void RawVideoContainerWriter::write( const Image* const* images, double stamp )
+	{
+		if( _fd < 0 )
+			throw CVTException( "Writer already closed" );
+		if( _failed )
+			throw CVTException( "Writer failed, the file could not be restored after a write error" );
+		if( _streams.empty() )
+			throw CVTException( "No streams added" );
+
+		for( size_t s = 0; s < _streams.size(); s++ ) {
+			const RawVideoStreamInfo& info = _streams[ s ];
+			if( images[ s ]->width() != info.width || images[ s ]->height() != info.height ||
+			    ( uint32_t ) images[ s ]->format().formatID != info.formatID )
+				throw CVTException( "Image does not match the stream resolution or format" );
+		}
+
+		if( !_started )
+			writeFileHeader();
+
+		std::vector<const uint8_t*> ptrs( _streams.size() );
+		std::vector<size_t> strides( _streams.size() );
+		for( size_t s = 0; s < _streams.size(); s++ )
+			ptrs[ s ] = images[ s ]->map( &strides[ s ] );
+
+		parallelFor( Range<size_t>( 0, _taskStream.size() ), EncodeBody( *this, ptrs, strides ), 1 );
+
+		static const uint8_t padding[ RawVideoContainer::ALIGNMENT ] = { 0 };
+		std::vector<const uint8_t*> bufs;
+		std::vector<size_t>			sizes;
+		size_t frame = _stamps.size();
+		size_t task = 0;
+		uint64_t offset = _offset;
+
+		for( size_t s = 0; s < _streams.size(); s++ ) {
+			const RawVideoStreamInfo& info = _streams[ s ];
+			RawVideoContainer::BlobHeader* header = ( RawVideoContainer::BlobHeader* ) &_headers[ s ][ 0 ];
+			uint32_t* bandSizes = ( uint32_t* ) ( header + 1 );
+
+			header->frame = frame;
+			header->stamp = stamp;
+			_offsets.push_back( offset );
+
+			size_t payload;
+			bufs.push_back( &_headers[ s ][ 0 ] );
+			if( info.codec == RAWVIDEO_CODEC_NONE ) {
+				payload = info.frameBytes();
+				sizes.push_back( sizeof( RawVideoContainer::BlobHeader ) );
+				if( strides[ s ] == info.rowBytes ) {
+					bufs.push_back( ptrs[ s ] );
+				} else {
+					SIMD* simd = SIMD::instance();
+					for( size_t y = 0; y < info.height; y++ )
+						simd->Memcpy( &_rawData[ s ][ y * info.rowBytes ], ptrs[ s ] + y * strides[ s ], info.rowBytes );
+					bufs.push_back( &_rawData[ s ][ 0 ] );
+				}
+				sizes.push_back( payload );
+			} else {
+				size_t numBands = info.numBands();
+				payload = numBands * sizeof( uint32_t );
+				sizes.push_back( sizeof( RawVideoContainer::BlobHeader ) + payload );
+				for( size_t b = 0; b < numBands; b++, task++ ) {
+					bandSizes[ b ] = _taskSize[ task ];
+					bufs.push_back( &_taskData[ task ][ 0 ] );
+					sizes.push_back( _taskSize[ task ] );
+					payload += _taskSize[ task ];
+				}
+			}
+			header->payloadSize = payload;
+
+			size_t blobSize = sizeof( RawVideoContainer::BlobHeader ) + payload;
+			size_t pad = RawVideoContainer::align( blobSize ) - blobSize;
+			if( pad ) {
+				bufs.push_back( padding );
+				sizes.push_back( pad );
+			}
+			offset += blobSize + pad;
+		}
+
+		try {
+			writeBuffers( bufs, sizes );
+		} catch( const Exception& ) {
+			rewind();
+			_offsets.resize( _stamps.size() * _streams.size() );
+			for( size_t s = 0; s < _streams.size(); s++ )
+				images[ s ]->unmap( ptrs[ s ] );
+			throw;
+		}
+
+		for( size_t s = 0; s < _streams.size(); s++ )
+			images[ s ]->unmap( ptrs[ s ] );
+
+		_stamps.push_back( stamp );
+		_offset = offset;
+	}
+
+	void RawVideoContainerWriter::close()
+	{
+		if( _fd < 0 )
+			return;
+
+		if( _started && !_failed ) {
+			RawVideoContainer::Footer footer;
+			memset( &footer, 0, sizeof( footer ) );
+			memcpy( footer.magic, RawVideoContainer::footerMagic(), sizeof( footer.magic ) );
+			footer.numFrames	= _stamps.size();
+			footer.indexOffset	= _offset;
+
+			std::vector<const uint8_t*> bufs;
+			std::vector<size_t>			sizes;
+			if( _stamps.size() ) {
+				bufs.push_back( ( const uint8_t* ) &_stamps[ 0 ] );
+				sizes.push_back( _stamps.size() * sizeof( double ) );
+				bufs.push_back( ( const uint8_t* ) &_offsets[ 0 ] );
+				sizes.push_back( _offsets.size() * sizeof( uint64_t ) );
+			}
+			bufs.push_back( ( const uint8_t* ) &footer );
+			sizes.push_back( sizeof( footer ) );
+			try {
+				writeBuffers( bufs, sizes );
+			} catch( const Exception& ) {
+				rewind();
+				::close( _fd );
+				_fd = -1;
+				throw;
+			}
+		}
+
+		int fd = _fd;
+		_fd = -1;
+		if( ::close( fd ) < 0 ){
+			String msg( "Could not close file: " );
+			msg += strerror( errno );
+			throw CVTException( msg.c_str() );
+		}
+	}
+
+	void RawVideoContainerWriter::writeFileHeader()
+	{
+		size_t streamBytes = _streams.size() * sizeof( RawVideoStreamInfo );
+		size_t dataOffset = RawVideoContainer::align( sizeof( RawVideoContainer::FileHeader ) + streamBytes );
+		std::vector<uint8_t> buf( dataOffset, 0 );
+
+		RawVideoContainer::FileHeader* header = ( RawVideoContainer::FileHeader* ) &buf[ 0 ];
+		memcpy( header->magic, RawVideoContainer::fileMagic(), sizeof( header->magic ) );
+		header->version		= RawVideoContainer::VERSION;
+		header->numStreams	= _streams.size();
+		header->dataOffset	= dataOffset;
+		memcpy( header + 1, &_streams[ 0 ], streamBytes );
+
+		std::vector<const uint8_t*> bufs( 1, &buf[ 0 ] );
+		std::vector<size_t>			sizes( 1, buf.size() );
+		try {
+			writeBuffers( bufs, sizes );
+		} catch( const Exception& ) {
+			rewind();
+			throw;
+		}
+		_offset = dataOffset;
+
+		// per stream blob headers and encode buffers
+		_headers.resize( _streams.size() );
+		_rawData.resize( _streams.size() );
+		for( size_t s = 0; s < _streams.size(); s++ ) {
+			const RawVideoStreamInfo& info = _streams[ s ];
+			size_t numBands = info.codec == RAWVIDEO_CODEC_NONE ? 0 : info.numBands();
+
+			_headers[ s ].resize( sizeof( RawVideoContainer::BlobHeader ) + numBands * sizeof( uint32_t ), 0 );
+			RawVideoContainer::BlobHeader* blob = ( RawVideoContainer::BlobHeader* ) &_headers[ s ][ 0 ];
+			blob->magic		= RawVideoContainer::BLOB_MAGIC;
+			blob->stream	= s;
+			blob->numBands	= numBands;
+
+			if( info.codec == RAWVIDEO_CODEC_NONE )
+				_rawData[ s ].resize( info.frameBytes() );
+
+			size_t bandBytes = ( size_t ) info.bandRows * info.rowBytes;
+			for( size_t b = 0; b < numBands; b++ ) {
+				_taskStream.push_back( s );
+				_taskBand.push_back( b );
+				_taskData.push_back( std::vector<uint8_t>( LZ4::compressBound( bandBytes ) ) );
+				_taskTmp.push_back( std::vector<uint8_t>( bandBytes ) );
+			}
+		}
+		_taskSize.resize( _taskStream.size() );
+		_started = true;
+	}
+
+	void RawVideoContainerWriter::writeBuffers( const std::vector<const uint8_t*>& ptrs, const std::vector<size_t>& sizes )
+	{
+		std::vector<struct iovec> iov( ptrs.size() );
+		for( size_t i = 0; i < ptrs.size(); i++ ) {
+			iov[ i ].iov_base = ( void* ) ptrs[ i ];
+			iov[ i ].iov_len = sizes[ i ];
+		}
+
+		size_t first = 0;
+		while( first < iov.size() ) {
+			int count = ( int ) Math::min<size_t>( iov.size() - first, IOV_MAX );
+			ssize_t n = ::writev( _fd, &iov[ first ], count );
+			if( n < 0 ) {
+				if( errno == EINTR )
+					continue;
+				String msg( "Could not write to file: " );
+				msg += strerror( errno );
+				throw CVTException( msg.c_str() );
+			}
+
+			// advance over the written data, partial writes continue in the middle of a buffer
+			size_t written = n;
+			while( first < iov.size() && written >= iov[ first ].iov_len ) {
+				written -= iov[ first ].iov_len;
+				first++;
+			}
+			if( written ) {
+				iov[ first ].iov_base = ( uint8_t* ) iov[ first ].iov_base + written;
+				iov[ first ].iov_len -= written;
+			}
+		}
+	}
+
+	/* drop the data of a partially written frame, so the file ends at _offset again */
+	void RawVideoContainerWriter::rewind()
+	{
+		if( ftruncate( _fd, _offset ) < 0 || lseek( _fd, _offset, SEEK_SET ) < 0 )
+			_failed = true;
+	}
+
+}
@@ -0,0 +1,94 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_RAWVIDEOCONTAINERWRITER_H
+#define CVT_RAWVIDEOCONTAINERWRITER_H
+
+#include <cvt/io/RawVideoContainer.h>
+#include <cvt/util/String.h>
+#include <cvt/gfx/Image.h>
+
+#include <vector>
+
+namespace cvt {
+
+	/**
+	  @brief Writer for the chunked, indexed RawVideo container ( see RawVideoContainer ).
+
+	  Multiple synchronized streams ( e.g. left, right and depth ) with individual codecs are stored per
+	  frame together with a timestamp. The bands of compressed streams are encoded in parallel.
+	 */
+	class RawVideoContainerWriter {
+		public:
+			RawVideoContainerWriter( const String& fileName );
+			~RawVideoContainerWriter();
+
+			/* add a stream, all streams have to be added before the first frame is written, returns the stream index */
+			size_t	addStream( size_t width, size_t height, const IFormat& format, RawVideoCodec codec = RAWVIDEO_CODEC_NONE );
+
+			/* write one frame, images points to numStreams() images */
+			void	write( const Image* const* images, double stamp );
+			void	write( const Image& image, double stamp );
+
+			/* write the index and close the file, called by the destructor */
+			void	close();
+
+			size_t	numStreams() const { return _streams.size(); }
+			size_t	numFrames() const { return _stamps.size(); }
+
+		private:
+			class EncodeBody;
+
+			RawVideoContainerWriter( const RawVideoContainerWriter& );
+			RawVideoContainerWriter& operator=( const RawVideoContainerWriter& );
+
+			void	writeFileHeader();
+			void	writeBuffers( const std::vector<const uint8_t*>& ptrs, const std::vector<size_t>& sizes );
+			void	rewind();
+
+			int									_fd;
+			uint64_t							_offset;
+			bool								_started;
+			/* set if the file could not be restored after a failed write */
+			bool								_failed;
+
+			std::vector<RawVideoStreamInfo>		_streams;
+			std::vector<double>					_stamps;
+			std::vector<uint64_t>				_offsets;
+
+			/* one encode task per band of the compressed streams */
+			std::vector<size_t>					_taskStream;
+			std::vector<size_t>					_taskBand;
+			std::vector<std::vector<uint8_t> >	_taskData;
+			std::vector<std::vector<uint8_t> >	_taskTmp;
+			std::vector<size_t>					_taskSize;
+
+			/* blob header and band size table per stream */
+			std::vector<std::vector<uint8_t> >	_headers;
+			std::vector<std::vector<uint8_t> >	_rawData;
+	};
+
+}
+
+#endif
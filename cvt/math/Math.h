@@ -120,6 +120,8 @@ namespace cvt {
             return ( std::numeric_limits<T>::has_infinity &&
                      v == std::numeric_limits<T>::infinity() );
         }
+        /* false for NaN and +/- infinity */
+        template<typename T> static inline bool isFinite( T v ) { return v - v == ( T ) 0; }
 
         size_t solveQuadratic( float a, float b, float c, float (&result)[ 2 ] );
         size_t solveQuadratic( double a, double b, double c, double (&result)[ 2 ] );
@@ -40,40 +40,66 @@ namespace cvt {
 		CPU_SSE4_1 = ( 1 << 6 ),
 		CPU_SSE4_2 = ( 1 << 7 ),
 		CPU_AVX    = ( 1 << 8 ),
+		CPU_AVX2   = ( 1 << 9 ),
+		CPU_FMA    = ( 1 << 10 ),
+		CPU_POPCNT = ( 1 << 11 ),
 	};
 
 	CVT_ENUM_TO_FLAGS( CPUFeatureFlags, CPUFeatures )
 
-	static inline CPUFeatures cpuFeatures( void )
+	static inline void cpuid( uint32_t leaf, uint32_t subleaf, uint32_t& eax, uint32_t& ebx, uint32_t& ecx, uint32_t& edx )
 	{
-		CPUFeatures ret = CPU_BASE;
-		uint32_t eax, ebx, ecx, edx;
-
 #ifdef ARCH_x86_64
-		/* FIXME: what a clusterfuck - this works only for x86_64, we need to save ebx on x86
-				  BUT cpuid on x86_64 destroys rbx and not only ebx
-		 */
 		asm volatile(
-			"movl $1, %%eax;\n\t"
 			"cpuid;\n\t"
 				: "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx)
-				:
+				: "a"(leaf), "c"(subleaf)
 				:
 			);
 #elif ARCH_x86
+		/* save ebx, it may be used as the PIC register */
 		asm volatile(
 			"movl %%ebx, %%esi;\n\t"
-			"movl $1, %%eax;\n\t"
 			"cpuid;\n\t"
 			"xchgl %%ebx, %%esi;\n\t"
 				: "=a"(eax), "=S"(ebx), "=c"(ecx), "=d"(edx)
-				:
+				: "a"(leaf), "c"(subleaf)
 				:
 			);
-
 #else
+		( void ) leaf; ( void ) subleaf;
 		eax = ebx = ecx = edx = 0;
 #endif
+	}
+
+	/* the OS has to save the YMM state on context switches, otherwise AVX is unusable */
+	static inline bool cpuOSSupportsYMM( uint32_t ecx )
+	{
+#if defined( ARCH_x86_64 ) || defined( ARCH_x86 )
+		uint32_t xcr0, xcr0hi;
+		if( !( ecx & ( 1 << 27 ) ) )
+			return false;
+		asm volatile(
+			"xgetbv;\n\t"
+				: "=a"(xcr0), "=d"(xcr0hi)
+				: "c"(0)
+				:
+			);
+		return ( xcr0 & 0x6 ) == 0x6;
+#else
+		( void ) ecx;
+		return false;
+#endif
+	}
+
+	static inline CPUFeatures cpuFeatures( void )
+	{
+		CPUFeatures ret = CPU_BASE;
+		uint32_t eax, ebx, ecx, edx;
+		uint32_t maxleaf;
+
+		cpuid( 0, 0, maxleaf, ebx, ecx, edx );
+		cpuid( 1, 0, eax, ebx, ecx, edx );
 
 		if( edx & ( 1 << 23 ) )
 			ret |= CPU_MMX;
@@ -83,16 +109,25 @@ namespace cvt {
 			ret |= CPU_SSE2;
 		if( ecx & ( 1 <<  0 ) )
 			ret |= CPU_SSE3;
-		if( ecx & ( 1 <<  0 ) )
-			ret |= CPU_SSE3;
 		if( ecx & ( 1 <<  9 ) )
 			ret |= CPU_SSSE3;
 		if( ecx & ( 1 << 19 ) )
 			ret |= CPU_SSE4_1;
 		if( ecx & ( 1 << 20 ) )
 			ret |= CPU_SSE4_2;
-		if( ecx & ( 1 << 28 ) )
+		if( ecx & ( 1 << 23 ) )
+			ret |= CPU_POPCNT;
+
+		if( ( ecx & ( 1 << 28 ) ) && cpuOSSupportsYMM( ecx ) ) {
 			ret |= CPU_AVX;
+			if( ecx & ( 1 << 12 ) )
+				ret |= CPU_FMA;
+			if( maxleaf >= 7 ) {
+				cpuid( 7, 0, eax, ebx, ecx, edx );
+				if( ebx & ( 1 << 5 ) )
+					ret |= CPU_AVX2;
+			}
+		}
 		return ret;
 	}
 
@@ -115,8 +150,14 @@ namespace cvt {
 			std::cout << "SSE4.1 ";
 		if( f & CPU_SSE4_2 )
 			std::cout << "SSE4.2 ";
+		if( f & CPU_POPCNT )
+			std::cout << "POPCNT ";
 		if( f & CPU_AVX )
 			std::cout << "AVX ";
+		if( f & CPU_AVX2 )
+			std::cout << "AVX2 ";
+		if( f & CPU_FMA )
+			std::cout << "FMA ";
 		std::cout << std::endl;
 	}
 
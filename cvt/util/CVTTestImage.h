@@ -0,0 +1,76 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVTTESTIMAGE_H
+#define CVTTESTIMAGE_H
+
+#include <cvt/gfx/Image.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/math/Math.h>
+
+#include <string.h>
+
+/* image helpers shared by the tests */
+
+namespace cvt {
+
+	/* random values in [ 0, 1 ] for float formats, in [ 0, 255 ) otherwise */
+	inline void testFillRandom( Image& img )
+	{
+		IMapScoped<uint8_t> map( img );
+		size_t bytes = img.width() * img.bpp();
+		for( size_t y = 0; y < img.height(); y++ ) {
+			if( img.format().type == IFORMAT_TYPE_FLOAT ) {
+				float* ptr = ( float* ) map.ptr();
+				for( size_t x = 0; x < bytes / sizeof( float ); x++ )
+					ptr[ x ] = Math::rand( 0.0f, 1.0f );
+			} else {
+				uint8_t* ptr = map.ptr();
+				for( size_t x = 0; x < bytes; x++ )
+					ptr[ x ] = ( uint8_t ) Math::rand( 0, 255 );
+			}
+			map++;
+		}
+	}
+
+	/* same size, format and bit-identical pixels, the strides may differ */
+	inline bool testEqualImages( const Image& a, const Image& b )
+	{
+		if( a.width() != b.width() || a.height() != b.height() || a.format() != b.format() )
+			return false;
+		IMapScoped<const uint8_t> mapa( a );
+		IMapScoped<const uint8_t> mapb( b );
+		size_t bytes = a.width() * a.bpp();
+		for( size_t y = 0; y < a.height(); y++ ) {
+			if( memcmp( mapa.ptr(), mapb.ptr(), bytes ) )
+				return false;
+			mapa++;
+			mapb++;
+		}
+		return true;
+	}
+
+}
+
+#endif
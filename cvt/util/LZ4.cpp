@@ -0,0 +1,198 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/util/LZ4.h>
+
+#include <string.h>
+
+namespace cvt {
+
+#define LZ4_HASHBITS	12
+#define LZ4_MINMATCH	4
+#define LZ4_LASTLITERALS 5
+#define LZ4_MFLIMIT		12
+#define LZ4_MAXOFFSET	65535
+
+	static inline uint32_t lz4Read32( const uint8_t* p )
+	{
+		uint32_t v;
+		memcpy( &v, p, sizeof( v ) );
+		return v;
+	}
+
+	static inline uint32_t lz4Hash( uint32_t v )
+	{
+		return ( v * 2654435761U ) >> ( 32 - LZ4_HASHBITS );
+	}
+
+	static inline uint8_t* lz4WriteLength( uint8_t* op, size_t len )
+	{
+		while( len >= 255 ) {
+			*op++ = 255;
+			len -= 255;
+		}
+		*op++ = ( uint8_t ) len;
+		return op;
+	}
+
+	static inline uint8_t* lz4WriteSequence( uint8_t* op, const uint8_t* literals, size_t numLiterals, size_t offset, size_t matchLength )
+	{
+		uint8_t* token = op++;
+		size_t ml = matchLength - LZ4_MINMATCH;
+
+		*token = ( uint8_t ) ( ( numLiterals < 15 ? numLiterals : 15 ) << 4 );
+		if( numLiterals >= 15 )
+			op = lz4WriteLength( op, numLiterals - 15 );
+		memcpy( op, literals, numLiterals );
+		op += numLiterals;
+
+		*op++ = ( uint8_t ) ( offset & 0xff );
+		*op++ = ( uint8_t ) ( offset >> 8 );
+
+		*token |= ( uint8_t ) ( ml < 15 ? ml : 15 );
+		if( ml >= 15 )
+			op = lz4WriteLength( op, ml - 15 );
+		return op;
+	}
+
+	size_t LZ4::compress( uint8_t* dst, const uint8_t* src, size_t size )
+	{
+		uint8_t* op = dst;
+		size_t anchor = 0;
+
+		if( size > LZ4_MFLIMIT ) {
+			// positions + 1, 0 marks an empty entry
+			uint32_t table[ 1 << LZ4_HASHBITS ];
+			memset( table, 0, sizeof( table ) );
+
+			const size_t limit = size - LZ4_MFLIMIT;
+			const size_t matchLimit = size - LZ4_LASTLITERALS;
+			size_t ip = 0;
+
+			while( ip < limit ) {
+				uint32_t seq = lz4Read32( src + ip );
+				uint32_t h = lz4Hash( seq );
+				size_t ref = table[ h ];
+				table[ h ] = ( uint32_t ) ( ip + 1 );
+
+				if( !ref || ip + 1 - ref > LZ4_MAXOFFSET || lz4Read32( src + ref - 1 ) != seq ) {
+					// skip faster through incompressible data
+					ip += 1 + ( ( ip - anchor ) >> 6 );
+					continue;
+				}
+				ref--;
+
+				// extend backwards into the pending literals
+				while( ip > anchor && ref > 0 && src[ ip - 1 ] == src[ ref - 1 ] ) {
+					ip--;
+					ref--;
+				}
+
+				size_t len = LZ4_MINMATCH;
+				while( ip + len < matchLimit && src[ ref + len ] == src[ ip + len ] )
+					len++;
+
+				op = lz4WriteSequence( op, src + anchor, ip - anchor, ip - ref, len );
+				ip += len;
+				anchor = ip;
+
+				if( ip < limit )
+					table[ lz4Hash( lz4Read32( src + ip - 2 ) ) ] = ( uint32_t ) ( ip - 1 );
+			}
+		}
+
+		// last literals
+		size_t numLiterals = size - anchor;
+		*op++ = ( uint8_t ) ( ( numLiterals < 15 ? numLiterals : 15 ) << 4 );
+		if( numLiterals >= 15 )
+			op = lz4WriteLength( op, numLiterals - 15 );
+		memcpy( op, src + anchor, numLiterals );
+		op += numLiterals;
+
+		return op - dst;
+	}
+
+	static inline bool lz4ReadLength( size_t& len, const uint8_t*& ip, const uint8_t* iend )
+	{
+		uint8_t b;
+		do {
+			if( ip >= iend )
+				return false;
+			b = *ip++;
+			len += b;
+		} while( b == 255 );
+		return true;
+	}
+
+	bool LZ4::decompress( uint8_t* dst, size_t dstSize, const uint8_t* src, size_t srcSize )
+	{
+		const uint8_t* ip = src;
+		const uint8_t* iend = src + srcSize;
+		uint8_t* op = dst;
+		uint8_t* oend = dst + dstSize;
+
+		while( ip < iend ) {
+			uint8_t token = *ip++;
+
+			size_t numLiterals = token >> 4;
+			if( numLiterals == 15 && !lz4ReadLength( numLiterals, ip, iend ) )
+				return false;
+			if( numLiterals > ( size_t ) ( iend - ip ) || numLiterals > ( size_t ) ( oend - op ) )
+				return false;
+			memcpy( op, ip, numLiterals );
+			ip += numLiterals;
+			op += numLiterals;
+
+			// the last sequence has no match
+			if( ip == iend )
+				break;
+
+			if( iend - ip < 2 )
+				return false;
+			size_t offset = ip[ 0 ] | ( ip[ 1 ] << 8 );
+			ip += 2;
+			if( !offset || offset > ( size_t ) ( op - dst ) )
+				return false;
+
+			size_t len = token & 0x0f;
+			if( len == 15 && !lz4ReadLength( len, ip, iend ) )
+				return false;
+			len += LZ4_MINMATCH;
+			if( len > ( size_t ) ( oend - op ) )
+				return false;
+
+			const uint8_t* match = op - offset;
+			if( offset >= len ) {
+				memcpy( op, match, len );
+				op += len;
+			} else {
+				// overlapping copy repeats the pattern
+				while( len-- )
+					*op++ = *match++;
+			}
+		}
+		return op == oend;
+	}
+
+}
@@ -0,0 +1,59 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_LZ4_H
+#define CVT_LZ4_H
+
+#include <stdlib.h>
+#include <stdint.h>
+
+namespace cvt {
+
+	/**
+	  @brief Compressor / decompressor for the LZ4 block format.
+
+	  Greedy single-pass LZ77 with a 4-byte hash table, no entropy coding: fast enough to keep up with
+	  camera streams on a single core. Only the raw block format is supported, the LZ4 frame format
+	  ( magic, checksums ) is left to the container using the blocks.
+	 */
+	class LZ4 {
+		public:
+			/* maximal size of the compressed data for size input bytes */
+			static size_t	compressBound( size_t size );
+
+			/* compress size bytes from src to dst, dst has to provide compressBound( size ) bytes, returns the compressed size */
+			static size_t	compress( uint8_t* dst, const uint8_t* src, size_t size );
+
+			/* decompress srcSize bytes to exactly dstSize bytes, returns false for corrupt input */
+			static bool		decompress( uint8_t* dst, size_t dstSize, const uint8_t* src, size_t srcSize );
+	};
+
+	inline size_t LZ4::compressBound( size_t size )
+	{
+		return size + size / 255 + 16;
+	}
+
+}
+
+#endif
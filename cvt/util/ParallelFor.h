@@ -0,0 +1,95 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_PARALLELFOR_H
+#define CVT_PARALLELFOR_H
+
+#include <cvt/util/TaskGroup.h>
+#include <cvt/util/Range.h>
+#include <cvt/math/Math.h>
+
+namespace cvt {
+
+	/**
+	  \brief Task recursively splitting a range until it is smaller than the grain size.
+
+	  The upper half is spawned, so idle workers steal big chunks first, while the
+	  lower half is processed by the current thread.
+	 */
+	template<typename BODY>
+	class ParallelForTask : public Task {
+		public:
+			ParallelForTask( TaskGroup& group, const BODY& body, size_t begin, size_t end, size_t grain ) :
+				_group( group ), _body( body ), _begin( begin ), _end( end ), _grain( grain )
+			{
+			}
+
+			void execute()
+			{
+				while( _end - _begin > _grain ) {
+					size_t mid = _begin + ( ( _end - _begin ) >> 1 );
+					_group.spawn( new ParallelForTask<BODY>( _group, _body, mid, _end, _grain ) );
+					_end = mid;
+				}
+				_body( Range<size_t>( _begin, _end ) );
+			}
+
+		private:
+			TaskGroup&	_group;
+			const BODY& _body;
+			size_t		_begin;
+			size_t		_end;
+			size_t		_grain;
+	};
+
+	/**
+	  \brief Execute body( Range<size_t> ) on sub-ranges of range in parallel.
+	  \param range	the range [ min, max ) to process, e.g. the rows of an image
+	  \param body	functor with a const operator()( const Range<size_t>& )
+	  \param grain	the maximal size of a sub-range, 0 selects a size resulting in a few chunks per thread
+	 */
+	template<typename BODY>
+	inline void parallelFor( const Range<size_t>& range, const BODY& body, size_t grain = 0 )
+	{
+		if( range.max <= range.min )
+			return;
+
+		ThreadPool& pool = ThreadPool::instance();
+		size_t n = range.max - range.min;
+
+		if( !grain )
+			grain = Math::max<size_t>( n / ( 4 * pool.concurrency() ), 1 );
+
+		if( !pool.numWorkers() || n <= grain ) {
+			body( range );
+			return;
+		}
+
+		TaskGroup group( pool );
+		group.spawn( new ParallelForTask<BODY>( group, body, range.min, range.max, grain ) );
+		group.join();
+	}
+}
+
+#endif
@@ -45,7 +45,7 @@ class Range
 public:
 	Range(T min, T max);
 
-	T size();
+	T size() const;
 
 	T min;
 	T max;
@@ -68,7 +68,7 @@ Range<T>::Range(T min, T max):
 }
 
 template<typename T>
-T Range<T>::size()
+T Range<T>::size() const
 {
 	return ( max - min );
 }
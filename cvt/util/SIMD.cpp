@@ -33,6 +33,7 @@
 #include <cvt/util/SIMDSSE41.h>
 #include <cvt/util/SIMDSSE42.h>
 #include <cvt/util/SIMDAVX.h>
+#include <cvt/util/SIMDAVX2.h>
 #include <cvt/util/CPU.h>
 
 
@@ -745,9 +746,11 @@ namespace cvt {
         if( type == SIMD_BEST ) {
             CPUFeatures cpuf;
             cpuf = cpuFeatures();
-            if( cpuf & CPU_AVX ){
+            if( ( cpuf & CPU_AVX2 ) && ( cpuf & CPU_FMA ) ){
+                return new SIMDAVX2();
+            } else if( cpuf & CPU_AVX ){
                 return new SIMDAVX();
-            } else if( cpuf & CPU_SSE4_2 ){
+            } else if( ( cpuf & CPU_SSE4_2 ) && ( cpuf & CPU_POPCNT ) ){
                 return new SIMDSSE42();
             } else if( cpuf & CPU_SSE4_1 ) {
                 return new SIMDSSE41();
@@ -771,8 +774,13 @@ namespace cvt {
                 case SIMD_SSE3: return new SIMDSSE3();
                 case SIMD_SSSE3: return new SIMDSSSE3();
                 case SIMD_SSE41: return new SIMDSSE41();
-                case SIMD_SSE42: return new SIMDSSE42();
+                case SIMD_SSE42:
+                    /* the SSE4.2 code is compiled with -mpopcnt, without POPCNT use the SSE4.1 instance */
+                    if( !( cpuFeatures() & CPU_POPCNT ) )
+                        return new SIMDSSE41();
+                    return new SIMDSSE42();
                 case SIMD_AVX: return new SIMDAVX();
+                case SIMD_AVX2: return new SIMDAVX2();
             }
         }
     }
@@ -781,9 +789,11 @@ namespace cvt {
     {
         CPUFeatures cpuf;
         cpuf = cpuFeatures();
-        if( cpuf & CPU_AVX ){
+        if( ( cpuf & CPU_AVX2 ) && ( cpuf & CPU_FMA ) ){
+            return SIMD_AVX2;
+        } else if( cpuf & CPU_AVX ){
             return SIMD_AVX;
-        } else if( cpuf & CPU_SSE4_2 ){
+        } else if( ( cpuf & CPU_SSE4_2 ) && ( cpuf & CPU_POPCNT ) ){
             return SIMD_SSE42;
         } else if( cpuf & CPU_SSE4_1 ) {
             return SIMD_SSE41;
@@ -4706,6 +4716,79 @@ namespace cvt {
 
     }
 
+    void SIMD::warpBilinearFixed1u8( uint8_t* dst, const int16_t* coords, const uint16_t* frac, const uint8_t* src, size_t srcStride, size_t srcWidth, size_t srcHeight, uint8_t fill, size_t n ) const
+    {
+        int endx = ( ( int ) srcWidth ) - 1;
+        int endy = ( ( int ) srcHeight ) - 1;
+
+        while( n-- )
+        {
+            int lx = *coords++;
+            int ly = *coords++;
+            int32_t ax = *frac & 0x1f;
+            int32_t ay = *frac++ >> 5;
+            int32_t g0, g1, g2, g3;
+
+            if( lx >= 0 && lx < endx && ly >= 0 && ly < endy ) {
+                const uint8_t* ptr = src + srcStride * ly + lx;
+                g0 = *ptr;
+                g1 = *( ptr + 1 );
+                ptr += srcStride;
+                g2 = *ptr;
+                g3 = *( ptr + 1 );
+            } else if( lx >= -1 && lx < ( int ) srcWidth && ly >= -1 && ly < ( int ) srcHeight ) {
+#define VAL( fx, fy ) ( ( fx ) >= 0 && ( fx ) < ( int ) srcWidth && ( fy ) >= 0 && ( fy ) < ( int ) srcHeight ) ? *( src + srcStride * ( fy ) + ( fx ) ) : fill
+                g0 = VAL( lx, ly );
+                g1 = VAL( lx + 1, ly );
+                g2 = VAL( lx, ly + 1 );
+                g3 = VAL( lx + 1, ly + 1 );
+#undef VAL
+            } else {
+                *dst++ = fill;
+                continue;
+            }
+
+            *dst++ = ( uint8_t ) ( ( ( g0 * ( 32 - ax ) + g1 * ax ) * ( 32 - ay ) + ( g2 * ( 32 - ax ) + g3 * ax ) * ay + 512 ) >> 10 );
+        }
+    }
+
+    void SIMD::warpBilinearFixed4u8( uint8_t* dst, const int16_t* coords, const uint16_t* frac, const uint8_t* src, size_t srcStride, size_t srcWidth, size_t srcHeight, uint32_t fill, size_t n ) const
+    {
+        int endx = ( ( int ) srcWidth ) - 1;
+        int endy = ( ( int ) srcHeight ) - 1;
+        const uint8_t* pfill = ( const uint8_t* ) &fill;
+
+        while( n-- )
+        {
+            int lx = *coords++;
+            int ly = *coords++;
+            int32_t ax = *frac & 0x1f;
+            int32_t ay = *frac++ >> 5;
+            const uint8_t* g[ 4 ];
+
+            if( lx >= 0 && lx < endx && ly >= 0 && ly < endy ) {
+                g[ 0 ] = src + srcStride * ly + sizeof( uint32_t ) * lx;
+                g[ 1 ] = g[ 0 ] + sizeof( uint32_t );
+                g[ 2 ] = g[ 0 ] + srcStride;
+                g[ 3 ] = g[ 2 ] + sizeof( uint32_t );
+            } else if( lx >= -1 && lx < ( int ) srcWidth && ly >= -1 && ly < ( int ) srcHeight ) {
+#define VAL( fx, fy ) ( ( fx ) >= 0 && ( fx ) < ( int ) srcWidth && ( fy ) >= 0 && ( fy ) < ( int ) srcHeight ) ? src + srcStride * ( fy ) + sizeof( uint32_t ) * ( fx ) : pfill
+                g[ 0 ] = VAL( lx, ly );
+                g[ 1 ] = VAL( lx + 1, ly );
+                g[ 2 ] = VAL( lx, ly + 1 );
+                g[ 3 ] = VAL( lx + 1, ly + 1 );
+#undef VAL
+            } else {
+                *( ( uint32_t* ) dst ) = fill;
+                dst += sizeof( uint32_t );
+                continue;
+            }
+
+            for( int c = 0; c < 4; c++ )
+                *dst++ = ( uint8_t ) ( ( ( g[ 0 ][ c ] * ( 32 - ax ) + g[ 1 ][ c ] * ax ) * ( 32 - ay ) + ( g[ 2 ][ c ] * ( 32 - ax ) + g[ 3 ][ c ] * ax ) * ay + 512 ) >> 10 );
+        }
+    }
+
 	void SIMD::harrisScore1f( float* dst, const float* boxdx2, const float* boxdy2, const float* boxdxdy, float k, size_t width ) const
 	{
 		size_t x;
@@ -5749,6 +5832,32 @@ namespace cvt {
         }
     }
 
+    void SIMD::boxTests_u32( uint8_t* dst, const uint32_t* table, const int32_t* offsets0, const int32_t* offsets1, size_t n, int32_t dx, int32_t dy ) const
+    {
+        for( size_t i = 0; i < n; i += 8 ) {
+            uint8_t bits = 0;
+            for( size_t k = 0; k < 8 && i + k < n; k++ ) {
+                const uint32_t* a = table + offsets0[ i + k ];
+                const uint32_t* b = table + offsets1[ i + k ];
+                /* the unsigned wrap-around cancels */
+                uint32_t suma = a[ 0 ] - a[ dx ] - a[ dy ] + a[ dx + dy ];
+                uint32_t sumb = b[ 0 ] - b[ dx ] - b[ dy ] + b[ dx + dy ];
+                bits |= ( uint8_t ) ( ( suma < sumb ) << k );
+            }
+            *dst++ = bits;
+        }
+    }
+
+    void SIMD::tsdfFuse( float* voxels, const float* pos, const float* step, const float* depth, size_t depthStride,
+                         size_t depthWidth, size_t depthHeight, float scale, float trunc, size_t n ) const
+    {
+        for( size_t i = 0; i < n; i++, voxels += 2 ) {
+            float fi = ( float ) i;
+            tsdfFuseVoxel( voxels, step[ 0 ] * fi + pos[ 0 ], step[ 1 ] * fi + pos[ 1 ], step[ 2 ] * fi + pos[ 2 ],
+                           ( const uint8_t* ) depth, depthStride, ( float ) depthWidth, ( float ) depthHeight, scale, trunc );
+        }
+    }
+
     size_t SIMD::hammingDistance( const uint8_t* src1, const uint8_t* src2, size_t n ) const
     {
         size_t d = 0;
@@ -5795,6 +5904,18 @@ namespace cvt {
         return d;
     }
 
+    void SIMD::hammingDistanceBest( size_t& best, size_t& bestDist, size_t& second, size_t& secondDist,
+                                    const uint8_t* query, const uint8_t* descs, size_t stride, size_t num, size_t n ) const
+    {
+        best = second = num;
+        bestDist = secondDist = ( size_t ) -1;
+
+        for( size_t i = 0; i < num; i++ ) {
+            hammingUpdateBest( best, bestDist, second, secondDist, i, hammingDistance( query, descs, n ) );
+            descs += stride;
+        }
+    }
+
     /*
     {
         size_t d = 0;
@@ -5834,6 +5955,32 @@ namespace cvt {
     }
 
 
+    void SIMD::prefixSum1_u8_to_u32( uint32_t* dst, size_t dstStride, const uint8_t* src, size_t srcStride, size_t width, size_t height ) const
+    {
+        // first row
+        dst[ 0 ] = src[ 0 ];
+        for( size_t i = 1; i < width; i++ ){
+            dst[ i ] = dst[ i - 1 ] + src[ i ];
+        }
+        height--;
+
+        uint32_t * prevRow = dst;
+        dst+=dstStride;
+        src+=srcStride;
+
+        uint32_t currRow;
+        while( height-- ){
+            currRow = 0;
+            for( size_t i = 0; i < width; i++ ){
+                currRow += src[ i ];
+                dst[ i ] = currRow + prevRow[ i ];
+            }
+            prevRow = dst;
+            dst += dstStride;
+            src += srcStride;
+        }
+    }
+
     void SIMD::prefixSum1_f_to_f( float * dst, size_t dstStride, const float* src, size_t srcStride, size_t width, size_t height ) const
     {
         // first row
@@ -44,6 +44,7 @@ namespace cvt {
         SIMD_SSE41,
         SIMD_SSE42,
         SIMD_AVX,
+        SIMD_AVX2,
         SIMD_BEST
     };
 
@@ -314,6 +315,9 @@ namespace cvt {
             virtual void warpBilinear4f( float* dst, const float* coords, const float* src, size_t srcStride, size_t srcWidth, size_t srcHeight, const float* fillcolor, size_t n ) const;
             virtual void warpBilinear1u8( uint8_t* dst, const float* coords, const uint8_t* src, size_t srcStride, size_t srcWidth, size_t srcHeight, uint8_t fill, size_t n ) const;
             virtual void warpBilinear4u8( uint8_t* dst, const float* coords, const uint8_t* src, size_t srcStride, size_t srcWidth, size_t srcHeight, uint32_t fill, size_t n ) const;
+            /* coords: integer top-left sample position ( x, y ) as int16, frac: packed 5 bit fractions ( fy << 5 ) | fx */
+            virtual void warpBilinearFixed1u8( uint8_t* dst, const int16_t* coords, const uint16_t* frac, const uint8_t* src, size_t srcStride, size_t srcWidth, size_t srcHeight, uint8_t fill, size_t n ) const;
+            virtual void warpBilinearFixed4u8( uint8_t* dst, const int16_t* coords, const uint16_t* frac, const uint8_t* src, size_t srcStride, size_t srcWidth, size_t srcHeight, uint32_t fill, size_t n ) const;
 
 			virtual void harrisScore1f( float* dst, const float* boxdx2, const float* boxdy2, const float* boxdxdy, float kappa, size_t width ) const;
 
@@ -337,10 +341,47 @@ namespace cvt {
 
             virtual size_t hammingDistance( const uint8_t* src1, const uint8_t* src2, size_t n ) const;
 
+            /**
+             * @brief hammingDistanceBest - compare one descriptor against a block of descriptors
+             * @param best       index of the closest descriptor, num if there is none
+             * @param bestDist   distance of the closest descriptor
+             * @param second     index of the second closest descriptor, num if there is none
+             * @param secondDist distance of the second closest descriptor
+             * @param query      descriptor of n bytes
+             * @param descs      num descriptors of n bytes each, stride bytes apart
+             * On equal distances the lower index wins.
+             */
+            virtual void hammingDistanceBest( size_t& best, size_t& bestDist, size_t& second, size_t& secondDist,
+                                              const uint8_t* query, const uint8_t* descs, size_t stride, size_t num, size_t n ) const;
+
+            /**
+             * @brief boxTests_u32 - binary box comparisons on an uint32 summed area table, e.g. for BRIEF/ORB
+             * @param dst        n / 8 bytes, bit i % 8 of byte i / 8 is set if box i of offsets0 has a smaller sum than box i of offsets1
+             * @param table      the table entry the offsets are relative to
+             * @param dx         the box width
+             * @param dy         the box height times the table stride
+             * The box at offset o has the sum table[ o ] - table[ o + dx ] - table[ o + dy ] + table[ o + dx + dy ].
+             */
+            virtual void boxTests_u32( uint8_t* dst, const uint32_t* table, const int32_t* offsets0, const int32_t* offsets1, size_t n, int32_t dx, int32_t dy ) const;
+
+            /**
+             * @brief tsdfFuse - fuse a depth map into a row of n voxels, e.g. for TSDFVolume
+             * @param voxels     n interleaved ( tsdf, weight ) pairs
+             * @param pos        camera position ( x * z, y * z, z ) of the first voxel, x and y in pixels
+             * @param step       change of pos from one voxel to the next
+             * @param depth      float depth map, stride in bytes, the values are multiplied by scale
+             * Voxels in front of the camera which project into the depth map onto a positive depth d with
+             * | d - z | <= trunc add ( d - z ) / trunc to their running average and increase their weight by one.
+             */
+            virtual void tsdfFuse( float* voxels, const float* pos, const float* step, const float* depth, size_t depthStride,
+                                   size_t depthWidth, size_t depthHeight, float scale, float trunc, size_t n ) const;
+
 			// prefix sum for 1 channel images
 			virtual void prefixSum1_u8_to_f( float * dst, size_t dstStride, const uint8_t* src, size_t srcStride, size_t width, size_t height ) const;
 			virtual void prefixSum1_f_to_f( float * dst, size_t dstStride, const float* src, size_t srcStride, size_t width, size_t height ) const;
 			virtual void prefixSum1_xxxxu8_to_f( float * dst, size_t dstStride, const uint8_t * src, size_t srcStride, size_t width, size_t height ) const;
+			/* exact sums, strides in elements */
+			virtual void prefixSum1_u8_to_u32( uint32_t* dst, size_t dstStride, const uint8_t* src, size_t srcStride, size_t width, size_t height ) const;
 
 			// prefix sum and square sum
 			virtual void prefixSumSqr1_u8_to_f( float * dst, size_t dStride, const uint8_t * src, size_t srcStride, size_t width, size_t height ) const;
@@ -396,6 +437,11 @@ namespace cvt {
             static SIMD* instance();
             static SIMDType bestSupportedType();
 
+        protected:
+            static inline void hammingUpdateBest( size_t& best, size_t& bestDist, size_t& second, size_t& secondDist, size_t idx, size_t dist );
+            static inline void tsdfFuseVoxel( float* voxel, float px, float py, float pz, const uint8_t* depth, size_t depthStride,
+                                              float depthWidth, float depthHeight, float scale, float trunc );
+
         private:
             static void cleanup();
 
@@ -407,6 +453,36 @@ namespace cvt {
         ::memcpy( dst, src, n );
     }
 
+    inline void SIMD::hammingUpdateBest( size_t& best, size_t& bestDist, size_t& second, size_t& secondDist, size_t idx, size_t dist )
+    {
+        if( dist < bestDist ) {
+            second = best;
+            secondDist = bestDist;
+            best = idx;
+            bestDist = dist;
+        } else if( dist < secondDist ) {
+            second = idx;
+            secondDist = dist;
+        }
+    }
+
+    inline void SIMD::tsdfFuseVoxel( float* voxel, float px, float py, float pz, const uint8_t* depth, size_t depthStride,
+                                     float depthWidth, float depthHeight, float scale, float trunc )
+    {
+        if( !( pz > 0.0f ) )
+            return;
+        float ix = px / pz;
+        float iy = py / pz;
+        if( ix < depthWidth && iy < depthHeight && ix >= 0.0f && iy >= 0.0f ) {
+            float d = ( ( const float* ) ( depth + ( size_t ) iy * depthStride ) )[ ( size_t ) ix ] * scale;
+            float sdf = d - pz;
+            if( d > 0.0f && Math::abs( sdf ) <= trunc ) {
+                voxel[ 0 ] = ( voxel[ 0 ] * voxel[ 1 ] + sdf / trunc ) / ( voxel[ 1 ] + 1.0f );
+                voxel[ 1 ] += 1.0f;
+            }
+        }
+    }
+
     inline std::string SIMD::name() const
     {
         return "SIMD-BASE";
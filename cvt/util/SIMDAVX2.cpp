@@ -0,0 +1,943 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/util/SIMDAVX2.h>
+#include <cvt/math/Math.h>
+#include <immintrin.h>
+
+namespace cvt
+{
+	static inline float _avx2_hsum( __m256 v )
+	{
+		float ret;
+		__m128 sum = _mm_add_ps( _mm256_castps256_ps128( v ), _mm256_extractf128_ps( v, 1 ) );
+		sum = _mm_add_ps( sum, _mm_movehl_ps( sum, sum ) );
+		sum = _mm_add_ps( sum, _mm_shuffle_ps( sum, sum, _MM_SHUFFLE( 0, 0, 0, 1 ) ) );
+		_mm_store_ss( &ret, sum );
+		return ret;
+	}
+
+	/* inclusive prefix sum of the 8 floats in v */
+	static inline __m256 _avx2_scan( __m256 v )
+	{
+		v = _mm256_add_ps( v, _mm256_castsi256_ps( _mm256_slli_si256( _mm256_castps_si256( v ), 4 ) ) );
+		v = _mm256_add_ps( v, _mm256_castsi256_ps( _mm256_slli_si256( _mm256_castps_si256( v ), 8 ) ) );
+		__m256 t = _mm256_shuffle_ps( v, v, _MM_SHUFFLE( 3, 3, 3, 3 ) );
+		return _mm256_add_ps( v, _mm256_permute2f128_ps( t, t, 0x08 ) );
+	}
+
+	/* broadcast the last element of v */
+	static inline __m256 _avx2_last( __m256 v )
+	{
+		__m256 t = _mm256_shuffle_ps( v, v, _MM_SHUFFLE( 3, 3, 3, 3 ) );
+		return _mm256_permute2f128_ps( t, t, 0x11 );
+	}
+
+	/* 16 rounded floats to 16 saturated uint8 values */
+	static inline __m128i _avx2_pack_u8( __m256 a, __m256 b )
+	{
+		__m256i p = _mm256_packs_epi32( _mm256_cvtps_epi32( a ), _mm256_cvtps_epi32( b ) );
+		p = _mm256_permute4x64_epi64( p, _MM_SHUFFLE( 3, 1, 2, 0 ) );
+		return _mm_packus_epi16( _mm256_castsi256_si128( p ), _mm256_extracti128_si256( p, 1 ) );
+	}
+
+	/* rounds like _floor in SIMD.cpp, negative zero included */
+	static inline int _avx2_floor( float v )
+	{
+		Math::_flint32 fl;
+		fl.f = v;
+		return ( int ) v - ( int ) ( ( ( uint32_t ) fl.i ) >> 31 );
+	}
+
+	float SIMDAVX2::SAD( const float* src1, const float* src2, const size_t n ) const
+	{
+		size_t i = n >> 4;
+		const __m256 absmask = _mm256_castsi256_ps( _mm256_set1_epi32( 0x7fffffff ) );
+		__m256 sum0 = _mm256_setzero_ps();
+		__m256 sum1 = _mm256_setzero_ps();
+
+		while( i-- ) {
+			sum0 = _mm256_add_ps( sum0, _mm256_and_ps( _mm256_sub_ps( _mm256_loadu_ps( src1 ), _mm256_loadu_ps( src2 ) ), absmask ) );
+			sum1 = _mm256_add_ps( sum1, _mm256_and_ps( _mm256_sub_ps( _mm256_loadu_ps( src1 + 8 ), _mm256_loadu_ps( src2 + 8 ) ), absmask ) );
+			src1 += 16; src2 += 16;
+		}
+
+		float sad = _avx2_hsum( _mm256_add_ps( sum0, sum1 ) );
+		_mm256_zeroupper();
+
+		i = n & 0xf;
+		while( i-- ) {
+			sad += Math::abs( *src1++ - *src2++ );
+		}
+		return sad;
+	}
+
+	size_t SIMDAVX2::SAD( uint8_t const* src1, uint8_t const* src2, const size_t n ) const
+	{
+		size_t i = n >> 5;
+		__m256i sum = _mm256_setzero_si256();
+
+		while( i-- ) {
+			__m256i a = _mm256_loadu_si256( ( const __m256i* ) src1 );
+			__m256i b = _mm256_loadu_si256( ( const __m256i* ) src2 );
+			sum = _mm256_add_epi64( sum, _mm256_sad_epu8( a, b ) );
+			src1 += 32; src2 += 32;
+		}
+
+		__m128i s = _mm_add_epi64( _mm256_castsi256_si128( sum ), _mm256_extracti128_si256( sum, 1 ) );
+		s = _mm_add_epi64( s, _mm_unpackhi_epi64( s, s ) );
+		size_t sad = ( size_t ) _mm_cvtsi128_si64( s );
+		_mm256_zeroupper();
+
+		i = n & 0x1f;
+		while( i-- ) {
+			sad += Math::abs( ( int16_t ) *src1++ - ( int16_t ) *src2++ );
+		}
+		return sad;
+	}
+
+	float SIMDAVX2::SSD( const float* src1, const float* src2, const size_t n ) const
+	{
+		size_t i = n >> 4;
+		__m256 sum0 = _mm256_setzero_ps();
+		__m256 sum1 = _mm256_setzero_ps();
+		__m256 d0, d1;
+
+		while( i-- ) {
+			d0 = _mm256_sub_ps( _mm256_loadu_ps( src1 ), _mm256_loadu_ps( src2 ) );
+			d1 = _mm256_sub_ps( _mm256_loadu_ps( src1 + 8 ), _mm256_loadu_ps( src2 + 8 ) );
+			sum0 = _mm256_fmadd_ps( d0, d0, sum0 );
+			sum1 = _mm256_fmadd_ps( d1, d1, sum1 );
+			src1 += 16; src2 += 16;
+		}
+
+		float ssd = _avx2_hsum( _mm256_add_ps( sum0, sum1 ) );
+		_mm256_zeroupper();
+
+		i = n & 0xf;
+		while( i-- ) {
+			ssd += Math::sqr( *src1++ - *src2++ );
+		}
+		return ssd;
+	}
+
+	float SIMDAVX2::SSD( uint8_t const* src1, uint8_t const* src2, const size_t n ) const
+	{
+		size_t i = n >> 4;
+		uint64_t ssd = 0;
+
+		/* each madd lane adds at most 2 * 255^2, flush the 32bit sums before they can overflow */
+		while( i ) {
+			size_t block = Math::min<size_t>( i, 4096 );
+			__m256i sum = _mm256_setzero_si256();
+			i -= block;
+			while( block-- ) {
+				__m256i a = _mm256_cvtepu8_epi16( _mm_loadu_si128( ( const __m128i* ) src1 ) );
+				__m256i b = _mm256_cvtepu8_epi16( _mm_loadu_si128( ( const __m128i* ) src2 ) );
+				__m256i d = _mm256_sub_epi16( a, b );
+				sum = _mm256_add_epi32( sum, _mm256_madd_epi16( d, d ) );
+				src1 += 16; src2 += 16;
+			}
+			__m128i s = _mm_add_epi32( _mm256_castsi256_si128( sum ), _mm256_extracti128_si256( sum, 1 ) );
+			s = _mm_add_epi32( s, _mm_unpackhi_epi64( s, s ) );
+			s = _mm_add_epi32( s, _mm_shuffle_epi32( s, _MM_SHUFFLE( 0, 0, 0, 1 ) ) );
+			ssd += ( uint32_t ) _mm_cvtsi128_si32( s );
+		}
+		_mm256_zeroupper();
+
+		i = n & 0xf;
+		while( i-- ) {
+			ssd += Math::sqr( ( int ) *src1++ - ( int ) *src2++ );
+		}
+		return ( float ) ssd;
+	}
+
+	template<int C>
+	static inline void _avx2_convolveHorizontalPixel( float* dst, const float* src, ssize_t x, const size_t width, const float* weights, const size_t wn, IBorderType btype, bool border )
+	{
+		ssize_t b1 = ( wn >> 1 );
+		float tmp[ C ];
+		for( int c = 0; c < C; c++ )
+			tmp[ c ] = 0.0f;
+		for( size_t k = 0; k < wn; k++ ) {
+			ssize_t pos = x - b1 + k;
+			if( border )
+				pos = IBorder::value<ssize_t>( pos, width, btype );
+			pos *= C;
+			for( int c = 0; c < C; c++ )
+				tmp[ c ] += weights[ k ] * src[ pos + c ];
+		}
+		for( int c = 0; c < C; c++ )
+			dst[ c ] = tmp[ c ];
+	}
+
+	/* C channels, 16 floats ( 16 / C pixels ) per iteration */
+	template<int C>
+	static inline void _avx2_convolveHorizontal( float* dst, const float* src, const size_t width, const float* weights, const size_t wn, IBorderType btype )
+	{
+		const ssize_t step = 16 / C;
+		ssize_t b1 = ( wn >> 1 );
+		ssize_t b2 = wn - b1 - 1;
+		ssize_t x;
+
+		for( x = 0; x < b1 && x < ( ssize_t ) width; x++ ) {
+			_avx2_convolveHorizontalPixel<C>( dst, src, x, width, weights, wn, btype, true );
+			dst += C;
+		}
+
+		for( ; x + step + b2 <= ( ssize_t ) width; x += step ) {
+			__m256 s0 = _mm256_setzero_ps(), s1 = s0;
+			const float* psrc = src + ( x - b1 ) * C;
+
+			for( size_t k = 0; k < wn; k++ ) {
+				__m256 f = _mm256_broadcast_ss( weights + k );
+				s0 = _mm256_fmadd_ps( _mm256_loadu_ps( psrc ), f, s0 );
+				s1 = _mm256_fmadd_ps( _mm256_loadu_ps( psrc + 8 ), f, s1 );
+				psrc += C;
+			}
+			_mm256_storeu_ps( dst, s0 );
+			_mm256_storeu_ps( dst + 8, s1 );
+			dst += 16;
+		}
+
+		for( ; x < ( ssize_t ) width - b2; x++ ) {
+			_avx2_convolveHorizontalPixel<C>( dst, src, x, width, weights, wn, btype, false );
+			dst += C;
+		}
+
+		for( ; x < ( ssize_t ) width; x++ ) {
+			_avx2_convolveHorizontalPixel<C>( dst, src, x, width, weights, wn, btype, true );
+			dst += C;
+		}
+		_mm256_zeroupper();
+	}
+
+	/* symmetric kernel with odd size, weights[ b1 - k ] == weights[ b1 + k ] */
+	template<int C>
+	static inline void _avx2_convolveHorizontalSym( float* dst, const float* src, const size_t width, const float* weights, const size_t wn, IBorderType btype )
+	{
+		const ssize_t step = 16 / C;
+		ssize_t b1 = ( wn >> 1 );
+		ssize_t b2 = wn - b1 - 1;
+		const float* wsym = weights + b1;
+		ssize_t x;
+
+		for( x = 0; x < b1 && x < ( ssize_t ) width; x++ ) {
+			_avx2_convolveHorizontalPixel<C>( dst, src, x, width, weights, wn, btype, true );
+			dst += C;
+		}
+
+		for( ; x + step + b2 <= ( ssize_t ) width; x += step ) {
+			const float* psrc = src + x * C;
+			__m256 f = _mm256_broadcast_ss( wsym );
+			__m256 s0 = _mm256_mul_ps( _mm256_loadu_ps( psrc ), f );
+			__m256 s1 = _mm256_mul_ps( _mm256_loadu_ps( psrc + 8 ), f );
+
+			for( ssize_t k = 1; k <= b1; k++ ) {
+				const float* l = psrc - k * C;
+				const float* r = psrc + k * C;
+				f = _mm256_broadcast_ss( wsym + k );
+				s0 = _mm256_fmadd_ps( _mm256_add_ps( _mm256_loadu_ps( l ), _mm256_loadu_ps( r ) ), f, s0 );
+				s1 = _mm256_fmadd_ps( _mm256_add_ps( _mm256_loadu_ps( l + 8 ), _mm256_loadu_ps( r + 8 ) ), f, s1 );
+			}
+			_mm256_storeu_ps( dst, s0 );
+			_mm256_storeu_ps( dst + 8, s1 );
+			dst += 16;
+		}
+
+		for( ; x < ( ssize_t ) width - b2; x++ ) {
+			_avx2_convolveHorizontalPixel<C>( dst, src, x, width, weights, wn, btype, false );
+			dst += C;
+		}
+
+		for( ; x < ( ssize_t ) width; x++ ) {
+			_avx2_convolveHorizontalPixel<C>( dst, src, x, width, weights, wn, btype, true );
+			dst += C;
+		}
+		_mm256_zeroupper();
+	}
+
+	void SIMDAVX2::ConvolveHorizontal1f( float* dst, const float* src, const size_t width, float const* weights, const size_t wn, IBorderType btype ) const
+	{
+		if( wn == 1 ) {
+			MulValue1f( dst, src, *weights, width );
+			return;
+		}
+		_avx2_convolveHorizontal<1>( dst, src, width, weights, wn, btype );
+	}
+
+	void SIMDAVX2::ConvolveHorizontal2f( float* dst, const float* src, const size_t width, float const* weights, const size_t wn, IBorderType btype ) const
+	{
+		if( wn == 1 ) {
+			MulValue1f( dst, src, *weights, width * 2 );
+			return;
+		}
+		_avx2_convolveHorizontal<2>( dst, src, width, weights, wn, btype );
+	}
+
+	void SIMDAVX2::ConvolveHorizontal4f( float* dst, const float* src, const size_t width, float const* weights, const size_t wn, IBorderType btype ) const
+	{
+		if( wn == 1 ) {
+			MulValue1f( dst, src, *weights, width * 4 );
+			return;
+		}
+		_avx2_convolveHorizontal<4>( dst, src, width, weights, wn, btype );
+	}
+
+	void SIMDAVX2::ConvolveHorizontalSym1f( float* dst, const float* src, const size_t width, float const* weights, const size_t wn, IBorderType btype ) const
+	{
+		if( wn == 1 ) {
+			MulValue1f( dst, src, *weights, width );
+			return;
+		}
+		_avx2_convolveHorizontalSym<1>( dst, src, width, weights, wn, btype );
+	}
+
+	void SIMDAVX2::ConvolveHorizontalSym2f( float* dst, const float* src, const size_t width, float const* weights, const size_t wn, IBorderType btype ) const
+	{
+		if( wn == 1 ) {
+			MulValue1f( dst, src, *weights, width * 2 );
+			return;
+		}
+		_avx2_convolveHorizontalSym<2>( dst, src, width, weights, wn, btype );
+	}
+
+	void SIMDAVX2::ConvolveHorizontalSym4f( float* dst, const float* src, const size_t width, float const* weights, const size_t wn, IBorderType btype ) const
+	{
+		if( wn == 1 ) {
+			MulValue1f( dst, src, *weights, width * 4 );
+			return;
+		}
+		_avx2_convolveHorizontalSym<4>( dst, src, width, weights, wn, btype );
+	}
+
+	/* vertical weighted sum of 16 floats at offset x */
+	static inline void _avx2_convolveVert16( __m256& s0, __m256& s1, const float** bufs, const float* weights, size_t numw, size_t x )
+	{
+		__m256 f = _mm256_broadcast_ss( weights );
+		s0 = _mm256_mul_ps( _mm256_loadu_ps( bufs[ 0 ] + x ), f );
+		s1 = _mm256_mul_ps( _mm256_loadu_ps( bufs[ 0 ] + x + 8 ), f );
+		for( size_t k = 1; k < numw; k++ ) {
+			f = _mm256_broadcast_ss( weights + k );
+			s0 = _mm256_fmadd_ps( _mm256_loadu_ps( bufs[ k ] + x ), f, s0 );
+			s1 = _mm256_fmadd_ps( _mm256_loadu_ps( bufs[ k ] + x + 8 ), f, s1 );
+		}
+	}
+
+	static inline void _avx2_convolveVertSym16( __m256& s0, __m256& s1, const float** bufs, const float* weights, size_t numw, size_t x )
+	{
+		ssize_t b1 = ( numw >> 1 );
+		const float* wsym = weights + b1;
+		__m256 f = _mm256_broadcast_ss( wsym );
+		s0 = _mm256_mul_ps( _mm256_loadu_ps( bufs[ b1 ] + x ), f );
+		s1 = _mm256_mul_ps( _mm256_loadu_ps( bufs[ b1 ] + x + 8 ), f );
+		for( ssize_t k = 1; k <= b1; k++ ) {
+			const float* l = bufs[ b1 - k ] + x;
+			const float* r = bufs[ b1 + k ] + x;
+			f = _mm256_broadcast_ss( wsym + k );
+			s0 = _mm256_fmadd_ps( _mm256_add_ps( _mm256_loadu_ps( l ), _mm256_loadu_ps( r ) ), f, s0 );
+			s1 = _mm256_fmadd_ps( _mm256_add_ps( _mm256_loadu_ps( l + 8 ), _mm256_loadu_ps( r + 8 ) ), f, s1 );
+		}
+	}
+
+	static inline float _avx2_convolveVert1( const float** bufs, const float* weights, size_t numw, size_t x )
+	{
+		float tmp = bufs[ 0 ][ x ] * *weights;
+		for( size_t k = 1; k < numw; k++ )
+			tmp += bufs[ k ][ x ] * weights[ k ];
+		return tmp;
+	}
+
+	void SIMDAVX2::ConvolveClampVert_f( float* dst, const float** bufs, const float* weights, size_t numw, size_t width ) const
+	{
+		size_t x;
+		__m256 s0, s1;
+
+		for( x = 0; x + 16 <= width; x += 16 ) {
+			_avx2_convolveVert16( s0, s1, bufs, weights, numw, x );
+			_mm256_storeu_ps( dst, s0 );
+			_mm256_storeu_ps( dst + 8, s1 );
+			dst += 16;
+		}
+		_mm256_zeroupper();
+
+		for( ; x < width; x++ )
+			*dst++ = _avx2_convolveVert1( bufs, weights, numw, x );
+	}
+
+	void SIMDAVX2::ConvolveClampVert_f_to_u8( uint8_t* dst, const float** bufs, const float* weights, size_t numw, size_t width ) const
+	{
+		size_t x;
+		__m256 s0, s1;
+
+		for( x = 0; x + 16 <= width; x += 16 ) {
+			_avx2_convolveVert16( s0, s1, bufs, weights, numw, x );
+			_mm_storeu_si128( ( __m128i* ) dst, _avx2_pack_u8( s0, s1 ) );
+			dst += 16;
+		}
+		_mm256_zeroupper();
+
+		for( ; x < width; x++ )
+			*dst++ = ( uint8_t ) Math::clamp( _avx2_convolveVert1( bufs, weights, numw, x ), 0.0f, 255.0f );
+	}
+
+	void SIMDAVX2::ConvolveClampVertSym_f( float* dst, const float** bufs, const float* weights, size_t numw, size_t width ) const
+	{
+		size_t x;
+		__m256 s0, s1;
+
+		for( x = 0; x + 16 <= width; x += 16 ) {
+			_avx2_convolveVertSym16( s0, s1, bufs, weights, numw, x );
+			_mm256_storeu_ps( dst, s0 );
+			_mm256_storeu_ps( dst + 8, s1 );
+			dst += 16;
+		}
+		_mm256_zeroupper();
+
+		for( ; x < width; x++ )
+			*dst++ = _avx2_convolveVert1( bufs, weights, numw, x );
+	}
+
+	void SIMDAVX2::ConvolveClampVertSym_f_to_u8( uint8_t* dst, const float** bufs, const float* weights, size_t numw, size_t width ) const
+	{
+		size_t x;
+		__m256 s0, s1;
+
+		for( x = 0; x + 16 <= width; x += 16 ) {
+			_avx2_convolveVertSym16( s0, s1, bufs, weights, numw, x );
+			_mm_storeu_si128( ( __m128i* ) dst, _avx2_pack_u8( s0, s1 ) );
+			dst += 16;
+		}
+		_mm256_zeroupper();
+
+		for( ; x < width; x++ )
+			*dst++ = ( uint8_t ) Math::clamp( _avx2_convolveVert1( bufs, weights, numw, x ), 0.0f, 255.0f );
+	}
+
+	void SIMDAVX2::Conv_f_to_u8( uint8_t* dst, float const* src, const size_t n ) const
+	{
+		const __m256 scale = _mm256_set1_ps( 255.0f );
+		const __m256 half  = _mm256_set1_ps( 0.5f );
+		const __m256 zero  = _mm256_setzero_ps();
+		size_t i = n >> 4;
+
+		while( i-- ) {
+			/* same rounding as the scalar version: truncate( clamp( x * 255 + 0.5 ) ) */
+			__m256 a = _mm256_add_ps( _mm256_mul_ps( _mm256_loadu_ps( src ), scale ), half );
+			__m256 b = _mm256_add_ps( _mm256_mul_ps( _mm256_loadu_ps( src + 8 ), scale ), half );
+			a = _mm256_min_ps( _mm256_max_ps( a, zero ), scale );
+			b = _mm256_min_ps( _mm256_max_ps( b, zero ), scale );
+			__m256i p = _mm256_packs_epi32( _mm256_cvttps_epi32( a ), _mm256_cvttps_epi32( b ) );
+			p = _mm256_permute4x64_epi64( p, _MM_SHUFFLE( 3, 1, 2, 0 ) );
+			_mm_storeu_si128( ( __m128i* ) dst, _mm_packus_epi16( _mm256_castsi256_si128( p ), _mm256_extracti128_si256( p, 1 ) ) );
+			src += 16;
+			dst += 16;
+		}
+		_mm256_zeroupper();
+
+		i = n & 0xf;
+		while( i-- )
+			*dst++ = ( uint8_t ) Math::clamp( *src++ * 255.0f + 0.5f, 0.0f, 255.0f );
+	}
+
+	void SIMDAVX2::Conv_f_to_u16( uint16_t* dst, const float* src, const size_t n ) const
+	{
+		const __m256 scale = _mm256_set1_ps( 65535.0f );
+		const __m256 half  = _mm256_set1_ps( 0.5f );
+		const __m256 zero  = _mm256_setzero_ps();
+		size_t i = n >> 4;
+
+		while( i-- ) {
+			__m256 a = _mm256_add_ps( _mm256_mul_ps( _mm256_loadu_ps( src ), scale ), half );
+			__m256 b = _mm256_add_ps( _mm256_mul_ps( _mm256_loadu_ps( src + 8 ), scale ), half );
+			a = _mm256_min_ps( _mm256_max_ps( a, zero ), scale );
+			b = _mm256_min_ps( _mm256_max_ps( b, zero ), scale );
+			__m256i p = _mm256_packus_epi32( _mm256_cvttps_epi32( a ), _mm256_cvttps_epi32( b ) );
+			_mm256_storeu_si256( ( __m256i* ) dst, _mm256_permute4x64_epi64( p, _MM_SHUFFLE( 3, 1, 2, 0 ) ) );
+			src += 16;
+			dst += 16;
+		}
+		_mm256_zeroupper();
+
+		i = n & 0xf;
+		while( i-- )
+			*dst++ = ( uint16_t ) Math::clamp( *src++ * 65535.0f + 0.5f, 0.0f, 65535.0f );
+	}
+
+	void SIMDAVX2::Conv_u8_to_f( float* dst, const uint8_t* src, const size_t n ) const
+	{
+		const __m256 scale = _mm256_set1_ps( 255.0f );
+		size_t i = n >> 4;
+
+		/* divide instead of multiplying with the reciprocal to match the lookup table exactly */
+		while( i-- ) {
+			__m128i in = _mm_loadu_si128( ( const __m128i* ) src );
+			__m256 a = _mm256_cvtepi32_ps( _mm256_cvtepu8_epi32( in ) );
+			__m256 b = _mm256_cvtepi32_ps( _mm256_cvtepu8_epi32( _mm_unpackhi_epi64( in, in ) ) );
+			_mm256_storeu_ps( dst, _mm256_div_ps( a, scale ) );
+			_mm256_storeu_ps( dst + 8, _mm256_div_ps( b, scale ) );
+			src += 16;
+			dst += 16;
+		}
+		_mm256_zeroupper();
+
+		i = n & 0xf;
+		while( i-- )
+			*dst++ = ( float ) *src++ / 255.0f;
+	}
+
+	void SIMDAVX2::Conv_u16_to_f( float* dst, const uint16_t* src, const size_t n ) const
+	{
+		const float scale = 1.0f / ( float ) 0xffff;
+		const __m256 scale8 = _mm256_set1_ps( scale );
+		size_t i = n >> 4;
+
+		while( i-- ) {
+			__m256i in = _mm256_loadu_si256( ( const __m256i* ) src );
+			__m256 a = _mm256_cvtepi32_ps( _mm256_cvtepu16_epi32( _mm256_castsi256_si128( in ) ) );
+			__m256 b = _mm256_cvtepi32_ps( _mm256_cvtepu16_epi32( _mm256_extracti128_si256( in, 1 ) ) );
+			_mm256_storeu_ps( dst, _mm256_mul_ps( a, scale8 ) );
+			_mm256_storeu_ps( dst + 8, _mm256_mul_ps( b, scale8 ) );
+			src += 16;
+			dst += 16;
+		}
+		_mm256_zeroupper();
+
+		i = n & 0xf;
+		while( i-- )
+			*dst++ = scale * ( float ) ( *src++ );
+	}
+
+	void SIMDAVX2::BoxFilterHorizontal_1f( float* dst, const float* src, size_t radius, size_t width ) const
+	{
+		size_t x;
+		float accum;
+		float invmean = 1.0f / ( float ) ( 2 * radius + 1 );
+
+		accum = *src * ( float ) ( radius + 1 );
+		for( x = 1; x <= radius; x++ )
+			accum += src[ x ];
+
+		*dst++ = accum * invmean;
+
+		for( x = 1; x <= radius; x++ ) {
+			accum -= src[ 0 ];
+			accum += src[ x + radius ];
+			*dst++ = accum * invmean;
+		}
+
+		const __m256 mul = _mm256_set1_ps( invmean );
+		__m256 y = _mm256_set1_ps( accum );
+		for( ; x + radius + 8 <= width; x += 8 ) {
+			__m256 xf = _mm256_sub_ps( _mm256_loadu_ps( src + x + radius ), _mm256_loadu_ps( src + x - radius - 1 ) );
+			xf = _mm256_add_ps( _avx2_scan( xf ), y );
+			_mm256_storeu_ps( dst, _mm256_mul_ps( xf, mul ) );
+			y = _avx2_last( xf );
+			dst += 8;
+		}
+		_mm_store_ss( &accum, _mm256_castps256_ps128( y ) );
+		_mm256_zeroupper();
+
+		for( ; x + radius < width; x++ ) {
+			accum -= src[ x - radius - 1 ];
+			accum += src[ x + radius ];
+			*dst++ = accum * invmean;
+		}
+
+		for( ; x < width; x++ ) {
+			accum -= src[ x - radius - 1 ];
+			accum += src[ width - 1 ];
+			*dst++ = accum * invmean;
+		}
+	}
+
+	void SIMDAVX2::BoxFilterVert_f_to_u8( uint8_t* dst, float* accum, const float* add, const float* sub, size_t radius, size_t width ) const
+	{
+		size_t x;
+		float invmean = 1.0f / ( float ) ( 2 * radius + 1 );
+		const __m256 mul = _mm256_set1_ps( invmean );
+
+		for( x = 0; x + 16 <= width; x += 16 ) {
+			__m256 acc0 = _mm256_sub_ps( _mm256_add_ps( _mm256_loadu_ps( accum ), _mm256_loadu_ps( add ) ), _mm256_loadu_ps( sub ) );
+			__m256 acc1 = _mm256_sub_ps( _mm256_add_ps( _mm256_loadu_ps( accum + 8 ), _mm256_loadu_ps( add + 8 ) ), _mm256_loadu_ps( sub + 8 ) );
+			_mm256_storeu_ps( accum, acc0 );
+			_mm256_storeu_ps( accum + 8, acc1 );
+			_mm_storeu_si128( ( __m128i* ) dst, _avx2_pack_u8( _mm256_mul_ps( acc0, mul ), _mm256_mul_ps( acc1, mul ) ) );
+			accum += 16;
+			add += 16;
+			sub += 16;
+			dst += 16;
+		}
+		_mm256_zeroupper();
+
+		for( ; x < width; x++ ) {
+			float tmp;
+			tmp = *accum + *add++ - *sub++;
+			*accum++ = tmp;
+			*dst++ = ( uint8_t ) Math::clamp( tmp * invmean, 0.0f, 255.0f );
+		}
+	}
+
+	void SIMDAVX2::BoxFilterVert_f( float* dst, float* accum, const float* add, const float* sub, size_t radius, size_t width ) const
+	{
+		size_t x;
+		float invmean = 1.0f / ( float ) ( 2 * radius + 1 );
+		const __m256 mul = _mm256_set1_ps( invmean );
+
+		for( x = 0; x + 16 <= width; x += 16 ) {
+			__m256 acc0 = _mm256_sub_ps( _mm256_add_ps( _mm256_loadu_ps( accum ), _mm256_loadu_ps( add ) ), _mm256_loadu_ps( sub ) );
+			__m256 acc1 = _mm256_sub_ps( _mm256_add_ps( _mm256_loadu_ps( accum + 8 ), _mm256_loadu_ps( add + 8 ) ), _mm256_loadu_ps( sub + 8 ) );
+			_mm256_storeu_ps( accum, acc0 );
+			_mm256_storeu_ps( accum + 8, acc1 );
+			_mm256_storeu_ps( dst, _mm256_mul_ps( acc0, mul ) );
+			_mm256_storeu_ps( dst + 8, _mm256_mul_ps( acc1, mul ) );
+			accum += 16;
+			add += 16;
+			sub += 16;
+			dst += 16;
+		}
+		_mm256_zeroupper();
+
+		for( ; x < width; x++ ) {
+			float tmp;
+			tmp = *accum + *add++ - *sub++;
+			*accum++ = tmp;
+			*dst++ = tmp * invmean;
+		}
+	}
+
+	void SIMDAVX2::warpBilinear1f( float* dst, const float* coords, const float* src, size_t srcStride, size_t srcWidth, size_t srcHeight, float fillcolor, size_t n ) const
+	{
+		const __m256i maxx = _mm256_set1_epi32( ( int ) srcWidth - 2 );
+		const __m256i maxy = _mm256_set1_epi32( ( int ) srcHeight - 2 );
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i stride = _mm256_set1_epi32( ( int ) srcStride );
+		const float* src2 = ( const float* ) ( ( const uint8_t* ) src + srcStride );
+		size_t i = n >> 3;
+
+		/* the gathers use 32bit byte offsets */
+		if( srcStride * srcHeight >= ( ( size_t ) 1 << 31 ) ) {
+			SIMDAVX::warpBilinear1f( dst, coords, src, srcStride, srcWidth, srcHeight, fillcolor, n );
+			return;
+		}
+
+		while( i-- ) {
+			__m256 c0 = _mm256_loadu_ps( coords );
+			__m256 c1 = _mm256_loadu_ps( coords + 8 );
+			__m256 fx = _mm256_castpd_ps( _mm256_permute4x64_pd( _mm256_castps_pd( _mm256_shuffle_ps( c0, c1, _MM_SHUFFLE( 2, 0, 2, 0 ) ) ), _MM_SHUFFLE( 3, 1, 2, 0 ) ) );
+			__m256 fy = _mm256_castpd_ps( _mm256_permute4x64_pd( _mm256_castps_pd( _mm256_shuffle_ps( c0, c1, _MM_SHUFFLE( 3, 1, 3, 1 ) ) ), _MM_SHUFFLE( 3, 1, 2, 0 ) ) );
+
+			/* floor the same way the scalar version does */
+			__m256i lx = _mm256_add_epi32( _mm256_cvttps_epi32( fx ), _mm256_srai_epi32( _mm256_castps_si256( fx ), 31 ) );
+			__m256i ly = _mm256_add_epi32( _mm256_cvttps_epi32( fy ), _mm256_srai_epi32( _mm256_castps_si256( fy ), 31 ) );
+
+			__m256i outside = _mm256_or_si256( _mm256_cmpgt_epi32( zero, lx ), _mm256_cmpgt_epi32( zero, ly ) );
+			outside = _mm256_or_si256( outside, _mm256_cmpgt_epi32( lx, maxx ) );
+			outside = _mm256_or_si256( outside, _mm256_cmpgt_epi32( ly, maxy ) );
+
+			if( _mm256_testz_si256( outside, outside ) ) {
+				__m256 alpha1 = _mm256_sub_ps( fx, _mm256_cvtepi32_ps( lx ) );
+				__m256 alpha2 = _mm256_sub_ps( fy, _mm256_cvtepi32_ps( ly ) );
+				__m256i offset = _mm256_add_epi32( _mm256_mullo_epi32( ly, stride ), _mm256_slli_epi32( lx, 2 ) );
+
+				__m256 a = _mm256_i32gather_ps( src, offset, 1 );
+				__m256 b = _mm256_i32gather_ps( src + 1, offset, 1 );
+				__m256 v1 = _mm256_fmadd_ps( _mm256_sub_ps( b, a ), alpha1, a );
+				a = _mm256_i32gather_ps( src2, offset, 1 );
+				b = _mm256_i32gather_ps( src2 + 1, offset, 1 );
+				__m256 v2 = _mm256_fmadd_ps( _mm256_sub_ps( b, a ), alpha1, a );
+				_mm256_storeu_ps( dst, _mm256_fmadd_ps( _mm256_sub_ps( v2, v1 ), alpha2, v1 ) );
+			} else {
+				_mm256_zeroupper();
+				SIMDAVX::warpBilinear1f( dst, coords, src, srcStride, srcWidth, srcHeight, fillcolor, 8 );
+			}
+			coords += 16;
+			dst += 8;
+		}
+		_mm256_zeroupper();
+
+		SIMDAVX::warpBilinear1f( dst, coords, src, srcStride, srcWidth, srcHeight, fillcolor, n & 0x7 );
+	}
+
+	void SIMDAVX2::warpBilinear4f( float* dst, const float* coords, const float* src, size_t srcStride, size_t srcWidth, size_t srcHeight, const float* fillcolor, size_t n ) const
+	{
+		const int endx = ( ( int ) srcWidth ) - 1;
+		const int endy = ( ( int ) srcHeight ) - 1;
+
+		while( n-- ) {
+			float fx = coords[ 0 ];
+			float fy = coords[ 1 ];
+			int lx = _avx2_floor( fx );
+			int ly = _avx2_floor( fy );
+
+			if( lx >= 0 && lx < endx && ly >= 0 && ly < endy ) {
+				/* both neighbouring RGBA pixels of a row fit into one register */
+				const float* ptr1 = ( const float* ) ( ( const uint8_t* ) src + srcStride * ly ) + lx * 4;
+				const float* ptr2 = ( const float* ) ( ( const uint8_t* ) ptr1 + srcStride );
+				__m256 r1 = _mm256_loadu_ps( ptr1 );
+				__m256 r2 = _mm256_loadu_ps( ptr2 );
+				__m256 v = _mm256_fmadd_ps( _mm256_sub_ps( r2, r1 ), _mm256_set1_ps( fy - ( float ) ly ), r1 );
+				__m128 v1 = _mm256_castps256_ps128( v );
+				__m128 v2 = _mm256_extractf128_ps( v, 1 );
+				_mm_storeu_ps( dst, _mm_fmadd_ps( _mm_sub_ps( v2, v1 ), _mm_set1_ps( fx - ( float ) lx ), v1 ) );
+			} else {
+				_mm256_zeroupper();
+				SIMDAVX::warpBilinear4f( dst, coords, src, srcStride, srcWidth, srcHeight, fillcolor, 1 );
+			}
+			coords += 2;
+			dst += 4;
+		}
+		_mm256_zeroupper();
+	}
+
+	void SIMDAVX2::harrisScore1f( float* dst, const float* boxdx2, const float* boxdy2, const float* boxdxy, float k, size_t width ) const
+	{
+		const __m256 kappa = _mm256_set1_ps( k );
+		size_t x;
+
+		for( x = 0; x + 8 <= width; x += 8 ) {
+			__m256 a = _mm256_loadu_ps( boxdx2 );
+			__m256 b = _mm256_loadu_ps( boxdy2 );
+			__m256 c = _mm256_loadu_ps( boxdxy );
+			__m256 tr = _mm256_add_ps( a, b );
+			__m256 det = _mm256_fmsub_ps( a, b, _mm256_mul_ps( c, c ) );
+			_mm256_storeu_ps( dst, _mm256_fnmadd_ps( _mm256_mul_ps( tr, tr ), kappa, det ) );
+			dst += 8;
+			boxdx2 += 8;
+			boxdy2 += 8;
+			boxdxy += 8;
+		}
+		_mm256_zeroupper();
+
+		for( ; x < width; x++ ) {
+			float a, b, c;
+			a = *boxdx2++;
+			b = *boxdy2++;
+			c = *boxdxy++;
+			*dst++ = ( a * b - c * c ) - ( k * Math::sqr( a + b ) );
+		}
+	}
+
+	/* popcount of a ^ b for 32 bytes, returned as four 64bit partial sums */
+	static inline __m256i _avx2_popcnt_xor( __m256i a, __m256i b )
+	{
+		const __m256i lut = _mm256_setr_epi8( 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+											  0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 );
+		const __m256i mask = _mm256_set1_epi8( 0x0f );
+		__m256i x = _mm256_xor_si256( a, b );
+		__m256i cnt = _mm256_add_epi8( _mm256_shuffle_epi8( lut, _mm256_and_si256( x, mask ) ),
+									   _mm256_shuffle_epi8( lut, _mm256_and_si256( _mm256_srli_epi16( x, 4 ), mask ) ) );
+		return _mm256_sad_epu8( cnt, _mm256_setzero_si256() );
+	}
+
+	static inline size_t _avx2_popcnt_tail( const uint8_t* src1, const uint8_t* src2, size_t n )
+	{
+		size_t pcount = 0;
+		uint64_t a, b;
+
+		while( n >= 8 ) {
+			memcpy( &a, src1, 8 );
+			memcpy( &b, src2, 8 );
+			pcount += __builtin_popcountll( a ^ b );
+			src1 += 8;
+			src2 += 8;
+			n -= 8;
+		}
+		if( n ) {
+			a = b = 0;
+			memcpy( &a, src1, n );
+			memcpy( &b, src2, n );
+			pcount += __builtin_popcountll( a ^ b );
+		}
+		return pcount;
+	}
+
+	static inline __m256i _avx2_hamming( const uint8_t* src1, const uint8_t* src2, size_t n32 )
+	{
+		__m256i sum = _mm256_setzero_si256();
+		while( n32-- ) {
+			sum = _mm256_add_epi64( sum, _avx2_popcnt_xor( _mm256_loadu_si256( ( const __m256i* ) src1 ),
+														   _mm256_loadu_si256( ( const __m256i* ) src2 ) ) );
+			src1 += 32;
+			src2 += 32;
+		}
+		return sum;
+	}
+
+	size_t SIMDAVX2::hammingDistance( const uint8_t* src1, const uint8_t* src2, size_t n ) const
+	{
+		size_t n32 = n >> 5;
+		__m256i sum = _avx2_hamming( src1, src2, n32 );
+		__m128i s = _mm_add_epi64( _mm256_castsi256_si128( sum ), _mm256_extracti128_si256( sum, 1 ) );
+		s = _mm_add_epi64( s, _mm_unpackhi_epi64( s, s ) );
+		size_t pcount = ( size_t ) _mm_cvtsi128_si64( s );
+		_mm256_zeroupper();
+
+		return pcount + _avx2_popcnt_tail( src1 + ( n32 << 5 ), src2 + ( n32 << 5 ), n & 0x1f );
+	}
+
+	void SIMDAVX2::hammingDistanceBest( size_t& best, size_t& bestDist, size_t& second, size_t& secondDist,
+										const uint8_t* query, const uint8_t* descs, size_t stride, size_t num, size_t n ) const
+	{
+		size_t n32 = n >> 5;
+		size_t tail = n & 0x1f;
+		size_t i = 0;
+
+		best = second = num;
+		bestDist = secondDist = ( size_t ) -1;
+
+		/* four descriptors at a time, the partial sums are < 2^16 and fit into 32bit lanes */
+		for( ; i + 4 <= num; i += 4 ) {
+			__m256i s0 = _avx2_hamming( query, descs, n32 );
+			__m256i s1 = _avx2_hamming( query, descs + stride, n32 );
+			__m256i s2 = _avx2_hamming( query, descs + 2 * stride, n32 );
+			__m256i s3 = _avx2_hamming( query, descs + 3 * stride, n32 );
+			__m256i a = _mm256_or_si256( s0, _mm256_slli_epi64( s1, 32 ) );
+			__m256i b = _mm256_or_si256( s2, _mm256_slli_epi64( s3, 32 ) );
+			a = _mm256_add_epi32( a, _mm256_srli_si256( a, 8 ) );
+			b = _mm256_add_epi32( b, _mm256_srli_si256( b, 8 ) );
+			__m256i c = _mm256_unpacklo_epi64( a, b );
+			__m128i d = _mm_add_epi32( _mm256_castsi256_si128( c ), _mm256_extracti128_si256( c, 1 ) );
+
+			uint32_t dist[ 4 ];
+			_mm_storeu_si128( ( __m128i* ) dist, d );
+			for( size_t k = 0; k < 4; k++ ) {
+				size_t dk = dist[ k ];
+				if( tail )
+					dk += _avx2_popcnt_tail( query + ( n32 << 5 ), descs + ( n32 << 5 ), tail );
+				hammingUpdateBest( best, bestDist, second, secondDist, i + k, dk );
+				descs += stride;
+			}
+		}
+		_mm256_zeroupper();
+
+		for( ; i < num; i++ ) {
+			hammingUpdateBest( best, bestDist, second, secondDist, i, hammingDistance( query, descs, n ) );
+			descs += stride;
+		}
+	}
+
+	static inline __m256i _avx2_boxsum( const int* table, const int32_t* offsets, __m256i dx, __m256i dy, __m256i dxy )
+	{
+		__m256i o = _mm256_loadu_si256( ( const __m256i* ) offsets );
+		__m256i a = _mm256_add_epi32( _mm256_i32gather_epi32( table, o, 4 ), _mm256_i32gather_epi32( table, _mm256_add_epi32( o, dxy ), 4 ) );
+		__m256i b = _mm256_add_epi32( _mm256_i32gather_epi32( table, _mm256_add_epi32( o, dx ), 4 ), _mm256_i32gather_epi32( table, _mm256_add_epi32( o, dy ), 4 ) );
+		return _mm256_sub_epi32( a, b );
+	}
+
+	void SIMDAVX2::boxTests_u32( uint8_t* dst, const uint32_t* table, const int32_t* offsets0, const int32_t* offsets1, size_t n, int32_t dx, int32_t dy ) const
+	{
+		const int* t = ( const int* ) table;
+		const __m256i vdx = _mm256_set1_epi32( dx );
+		const __m256i vdy = _mm256_set1_epi32( dy );
+		const __m256i vdxy = _mm256_set1_epi32( dx + dy );
+		// unsigned compare through the signed one
+		const __m256i sign = _mm256_set1_epi32( 0x80000000 );
+
+		size_t n8 = n >> 3;
+		while( n8-- ) {
+			__m256i a = _mm256_xor_si256( _avx2_boxsum( t, offsets0, vdx, vdy, vdxy ), sign );
+			__m256i b = _mm256_xor_si256( _avx2_boxsum( t, offsets1, vdx, vdy, vdxy ), sign );
+			*dst++ = ( uint8_t ) _mm256_movemask_ps( _mm256_castsi256_ps( _mm256_cmpgt_epi32( b, a ) ) );
+			offsets0 += 8;
+			offsets1 += 8;
+		}
+		_mm256_zeroupper();
+
+		if( n & 0x7 )
+			SIMD::boxTests_u32( dst, table, offsets0, offsets1, n & 0x7, dx, dy );
+	}
+
+	struct _AVX2LoadU8 {
+		typedef uint8_t Type;
+		static inline __m256 load( const uint8_t* src ) { return _mm256_cvtepi32_ps( _mm256_cvtepu8_epi32( _mm_loadl_epi64( ( const __m128i* ) src ) ) ); }
+		static inline float value( uint8_t v ) { return ( float ) v; }
+	};
+
+	struct _AVX2LoadF {
+		typedef float Type;
+		static inline __m256 load( const float* src ) { return _mm256_loadu_ps( src ); }
+		static inline float value( float v ) { return v; }
+	};
+
+	template<typename LOAD>
+	struct _AVX2LoadSqr {
+		typedef typename LOAD::Type Type;
+		static inline __m256 load( const Type* src ) { __m256 v = LOAD::load( src ); return _mm256_mul_ps( v, v ); }
+		static inline float value( Type v ) { return Math::sqr( LOAD::value( v ) ); }
+	};
+
+	/* integral image, the first row has no predecessor */
+	template<typename LOAD>
+	static inline void _avx2_prefixSum( float* dst, size_t dstStride, const typename LOAD::Type* src, size_t srcStride, size_t width, size_t height )
+	{
+		const float* prev = 0;
+
+		while( height-- ) {
+			__m256 y = _mm256_setzero_ps();
+			size_t x;
+
+			for( x = 0; x + 8 <= width; x += 8 ) {
+				__m256 v = _mm256_add_ps( _avx2_scan( LOAD::load( src + x ) ), y );
+				y = _avx2_last( v );
+				if( prev )
+					v = _mm256_add_ps( v, _mm256_loadu_ps( prev + x ) );
+				_mm256_storeu_ps( dst + x, v );
+			}
+
+			float row;
+			_mm_store_ss( &row, _mm256_castps256_ps128( y ) );
+			for( ; x < width; x++ ) {
+				row += LOAD::value( src[ x ] );
+				dst[ x ] = prev ? row + prev[ x ] : row;
+			}
+
+			prev = dst;
+			dst += dstStride;
+			src += srcStride;
+		}
+		_mm256_zeroupper();
+	}
+
+	void SIMDAVX2::prefixSum1_u8_to_f( float * dst, size_t dstStride, const uint8_t* src, size_t srcStride, size_t width, size_t height ) const
+	{
+		_avx2_prefixSum<_AVX2LoadU8>( dst, dstStride, src, srcStride, width, height );
+	}
+
+	void SIMDAVX2::prefixSum1_f_to_f( float * dst, size_t dstStride, const float* src, size_t srcStride, size_t width, size_t height ) const
+	{
+		_avx2_prefixSum<_AVX2LoadF>( dst, dstStride, src, srcStride, width, height );
+	}
+
+	void SIMDAVX2::prefixSumSqr1_u8_to_f( float * dst, size_t dStride, const uint8_t * src, size_t srcStride, size_t width, size_t height ) const
+	{
+		_avx2_prefixSum<_AVX2LoadSqr<_AVX2LoadU8> >( dst, dStride, src, srcStride, width, height );
+	}
+
+	void SIMDAVX2::prefixSumSqr1_f_to_f( float * dst, size_t dStride, const float* src, size_t srcStride, size_t width, size_t height ) const
+	{
+		_avx2_prefixSum<_AVX2LoadSqr<_AVX2LoadF> >( dst, dStride, src, srcStride, width, height );
+	}
+
+}
@@ -0,0 +1,97 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef SIMDAVX2_H
+#define SIMDAVX2_H
+
+#include <cvt/util/SIMDAVX.h>
+
+namespace cvt {
+
+	class SIMDAVX2 : public SIMDAVX {
+		friend class SIMD;
+
+		protected:
+			SIMDAVX2() {}
+
+		public:
+            virtual float SAD( const float* src1, const float* src2, const size_t n ) const;
+            virtual size_t SAD( uint8_t const* src1, uint8_t const* src2, const size_t n ) const;
+            virtual float SSD( const float* src1, const float* src2, const size_t n ) const;
+            virtual float SSD( uint8_t const* src1, uint8_t const* src2, const size_t n ) const;
+
+            virtual void ConvolveHorizontal1f( float* dst, const float* src, const size_t width, float const* weights, const size_t wn, IBorderType btype ) const;
+            virtual void ConvolveHorizontal2f( float* dst, const float* src, const size_t width, float const* weights, const size_t wn, IBorderType btype ) const;
+            virtual void ConvolveHorizontal4f( float* dst, const float* src, const size_t width, float const* weights, const size_t wn, IBorderType btype ) const;
+
+            virtual void ConvolveHorizontalSym1f( float* dst, const float* src, const size_t width, float const* weights, const size_t wn, IBorderType btype ) const;
+            virtual void ConvolveHorizontalSym2f( float* dst, const float* src, const size_t width, float const* weights, const size_t wn, IBorderType btype ) const;
+            virtual void ConvolveHorizontalSym4f( float* dst, const float* src, const size_t width, float const* weights, const size_t wn, IBorderType btype ) const;
+
+			virtual void ConvolveClampVert_f( float* dst, const float** bufs, const float* weights, size_t numw, size_t width ) const;
+			virtual void ConvolveClampVert_f_to_u8( uint8_t* dst, const float** bufs, const float* weights, size_t numw, size_t width ) const;
+			virtual void ConvolveClampVertSym_f( float* dst, const float** bufs, const float* weights, size_t numw, size_t width ) const;
+			virtual void ConvolveClampVertSym_f_to_u8( uint8_t* dst, const float** bufs, const float* weights, size_t numw, size_t width ) const;
+
+			virtual void Conv_f_to_u8( uint8_t* dst, float const* src, const size_t n ) const;
+			virtual void Conv_f_to_u16( uint16_t* dst, const float* src, const size_t n ) const;
+			virtual void Conv_u8_to_f( float* dst, const uint8_t* src, const size_t n ) const;
+			virtual void Conv_u16_to_f( float* dst, const uint16_t* src, const size_t n ) const;
+
+			virtual void BoxFilterHorizontal_1f( float* dst, const float* src, size_t radius, size_t width ) const;
+			virtual void BoxFilterVert_f_to_u8( uint8_t* dst, float* accum, const float* add, const float* sub, size_t radius, size_t width ) const;
+			virtual void BoxFilterVert_f( float* dst, float* accum, const float* add, const float* sub, size_t radius, size_t width ) const;
+
+            virtual void warpBilinear1f( float* dst, const float* coords, const float* src, size_t srcStride, size_t srcWidth, size_t srcHeight, float fillcolor, size_t n ) const;
+            virtual void warpBilinear4f( float* dst, const float* coords, const float* src, size_t srcStride, size_t srcWidth, size_t srcHeight, const float* fillcolor, size_t n ) const;
+
+			virtual void harrisScore1f( float* dst, const float* boxdx2, const float* boxdy2, const float* boxdxdy, float kappa, size_t width ) const;
+
+			virtual void prefixSum1_u8_to_f( float * dst, size_t dstStride, const uint8_t* src, size_t srcStride, size_t width, size_t height ) const;
+			virtual void prefixSum1_f_to_f( float * dst, size_t dstStride, const float* src, size_t srcStride, size_t width, size_t height ) const;
+			virtual void prefixSumSqr1_u8_to_f( float * dst, size_t dStride, const uint8_t * src, size_t srcStride, size_t width, size_t height ) const;
+			virtual void prefixSumSqr1_f_to_f( float * dst, size_t dStride, const float* src, size_t srcStride, size_t width, size_t height ) const;
+
+			virtual size_t hammingDistance( const uint8_t* src1, const uint8_t* src2, size_t n ) const;
+			virtual void hammingDistanceBest( size_t& best, size_t& bestDist, size_t& second, size_t& secondDist,
+											  const uint8_t* query, const uint8_t* descs, size_t stride, size_t num, size_t n ) const;
+
+			virtual void boxTests_u32( uint8_t* dst, const uint32_t* table, const int32_t* offsets0, const int32_t* offsets1, size_t n, int32_t dx, int32_t dy ) const;
+
+			virtual std::string name() const;
+			virtual SIMDType type() const;
+	};
+
+	inline std::string SIMDAVX2::name() const
+	{
+		return "SIMD-AVX2";
+	}
+
+	inline SIMDType SIMDAVX2::type() const
+	{
+		return SIMD_AVX2;
+	}
+}
+
+#endif
@@ -779,6 +779,40 @@ SSE_ACOP1_AOP2_FLOAT( MulSubValue1f, _mm_mul_ps, *, _mm_sub_ps, - )
 
 	}
 
+	void SIMDSSE::MinValue1f( float* dst, const float* src1, const float* src2, size_t n ) const
+	{
+		size_t i = n >> 2;
+		while( i-- ) {
+			_mm_storeu_ps( dst, _mm_min_ps( _mm_loadu_ps( src1 ), _mm_loadu_ps( src2 ) ) );
+			dst += 4;
+			src1 += 4;
+			src2 += 4;
+		}
+		i = n & 0x03;
+		while( i-- ) {
+			*dst++ = *src1 < *src2 ? *src1 : *src2;
+			src1++;
+			src2++;
+		}
+	}
+
+	void SIMDSSE::MaxValue1f( float* dst, const float* src1, const float* src2, size_t n ) const
+	{
+		size_t i = n >> 2;
+		while( i-- ) {
+			_mm_storeu_ps( dst, _mm_max_ps( _mm_loadu_ps( src1 ), _mm_loadu_ps( src2 ) ) );
+			dst += 4;
+			src1 += 4;
+			src2 += 4;
+		}
+		i = n & 0x03;
+		while( i-- ) {
+			*dst++ = *src1 > *src2 ? *src1 : *src2;
+			src1++;
+			src2++;
+		}
+	}
+
 	void SIMDSSE::Memcpy( uint8_t* dst, uint8_t const* src, const size_t n ) const
 	{
 		size_t n2 = n >> 4;
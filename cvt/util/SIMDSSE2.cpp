@@ -219,6 +219,88 @@ namespace cvt
 	}
 
 
+	void SIMDSSE2::MinValueU8( uint8_t* dst, const uint8_t* src1, const uint8_t* src2, size_t n ) const
+	{
+		__m128i a, b;
+		size_t i = n / 16;
+		while( i-- ) {
+			a = _mm_loadu_si128( ( const __m128i* ) src1 );
+			b = _mm_loadu_si128( ( const __m128i* ) src2 );
+			_mm_storeu_si128( ( __m128i* ) dst, _mm_min_epu8( a, b ) );
+			dst += 16;
+			src1 += 16;
+			src2 += 16;
+		}
+		i = n % 16;
+		while( i-- ) {
+			*dst++ = *src1 < *src2 ? *src1 : *src2;
+			src1++;
+			src2++;
+		}
+	}
+
+	void SIMDSSE2::MaxValueU8( uint8_t* dst, const uint8_t* src1, const uint8_t* src2, size_t n ) const
+	{
+		__m128i a, b;
+		size_t i = n / 16;
+		while( i-- ) {
+			a = _mm_loadu_si128( ( const __m128i* ) src1 );
+			b = _mm_loadu_si128( ( const __m128i* ) src2 );
+			_mm_storeu_si128( ( __m128i* ) dst, _mm_max_epu8( a, b ) );
+			dst += 16;
+			src1 += 16;
+			src2 += 16;
+		}
+		i = n % 16;
+		while( i-- ) {
+			*dst++ = *src1 > *src2 ? *src1 : *src2;
+			src1++;
+			src2++;
+		}
+	}
+
+	void SIMDSSE2::MinValueU16( uint16_t* dst, const uint16_t* src1, const uint16_t* src2, size_t n ) const
+	{
+		/* no unsigned 16-bit min/max before SSE4.1: min( a, b ) = a - sat( a - b ) */
+		__m128i a, b;
+		size_t i = n / 8;
+		while( i-- ) {
+			a = _mm_loadu_si128( ( const __m128i* ) src1 );
+			b = _mm_loadu_si128( ( const __m128i* ) src2 );
+			_mm_storeu_si128( ( __m128i* ) dst, _mm_sub_epi16( a, _mm_subs_epu16( a, b ) ) );
+			dst += 8;
+			src1 += 8;
+			src2 += 8;
+		}
+		i = n % 8;
+		while( i-- ) {
+			*dst++ = *src1 < *src2 ? *src1 : *src2;
+			src1++;
+			src2++;
+		}
+	}
+
+	void SIMDSSE2::MaxValueU16( uint16_t* dst, const uint16_t* src1, const uint16_t* src2, size_t n ) const
+	{
+		/* max( a, b ) = b + sat( a - b ) */
+		__m128i a, b;
+		size_t i = n / 8;
+		while( i-- ) {
+			a = _mm_loadu_si128( ( const __m128i* ) src1 );
+			b = _mm_loadu_si128( ( const __m128i* ) src2 );
+			_mm_storeu_si128( ( __m128i* ) dst, _mm_add_epi16( b, _mm_subs_epu16( a, b ) ) );
+			dst += 8;
+			src1 += 8;
+			src2 += 8;
+		}
+		i = n % 8;
+		while( i-- ) {
+			*dst++ = *src1 > *src2 ? *src1 : *src2;
+			src1++;
+			src2++;
+		}
+	}
+
 	size_t SIMDSSE2::SAD( uint8_t const* src1, uint8_t const* src2, const size_t n ) const
 	{
 		size_t i = n >> 4;
@@ -3909,6 +3991,97 @@ namespace cvt
 		}
 	}
 
+	void SIMDSSE2::warpBilinearFixed1u8( uint8_t* dst, const int16_t* coords, const uint16_t* frac, const uint8_t* src, size_t srcStride, size_t srcWidth, size_t srcHeight, uint8_t fill, size_t n ) const
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i mask = _mm_set1_epi16( 0x1f );
+		const __m128i w32 = _mm_set1_epi16( 32 );
+		const __m128i round = _mm_set1_epi32( 512 );
+		const __m128i minus1 = _mm_set1_epi16( -1 );
+		/* top-left sample must be in [ 0, w - 2 ] x [ 0, h - 2 ] */
+		const __m128i end = _mm_set_epi16( srcHeight - 1, srcWidth - 1, srcHeight - 1, srcWidth - 1,
+										   srcHeight - 1, srcWidth - 1, srcHeight - 1, srcWidth - 1 );
+
+		size_t n4 = n >> 2;
+		while( n4-- ) {
+			__m128i c = _mm_loadu_si128( ( const __m128i* ) coords );
+			__m128i inside = _mm_and_si128( _mm_cmpgt_epi16( c, minus1 ), _mm_cmplt_epi16( c, end ) );
+
+			if( _mm_movemask_epi8( inside ) != 0xffff || srcWidth > 0x7fff || srcHeight > 0x7fff ) {
+				SIMD::warpBilinearFixed1u8( dst, coords, frac, src, srcStride, srcWidth, srcHeight, fill, 4 );
+			} else {
+				/* gather the 2x2 neighbourhoods */
+				const uint8_t* p0 = src + srcStride * coords[ 1 ] + coords[ 0 ];
+				const uint8_t* p1 = src + srcStride * coords[ 3 ] + coords[ 2 ];
+				const uint8_t* p2 = src + srcStride * coords[ 5 ] + coords[ 4 ];
+				const uint8_t* p3 = src + srcStride * coords[ 7 ] + coords[ 6 ];
+				__m128i top = _mm_set_epi16( 0, 0, 0, 0, *( const uint16_t* ) p3, *( const uint16_t* ) p2, *( const uint16_t* ) p1, *( const uint16_t* ) p0 );
+				__m128i bottom = _mm_set_epi16( 0, 0, 0, 0, *( const uint16_t* ) ( p3 + srcStride ), *( const uint16_t* ) ( p2 + srcStride ),
+												*( const uint16_t* ) ( p1 + srcStride ), *( const uint16_t* ) ( p0 + srcStride ) );
+				top = _mm_unpacklo_epi8( top, zero );
+				bottom = _mm_unpacklo_epi8( bottom, zero );
+
+				/* weights ( 32 - ax, ax ) * ( 32 - ay ) and ( 32 - ax, ax ) * ay */
+				__m128i f = _mm_loadl_epi64( ( const __m128i* ) frac );
+				__m128i ax = _mm_and_si128( f, mask );
+				__m128i ay = _mm_srli_epi16( f, 5 );
+				__m128i wx = _mm_unpacklo_epi16( _mm_sub_epi16( w32, ax ), ax );
+				__m128i wt = _mm_mullo_epi16( wx, _mm_unpacklo_epi16( _mm_sub_epi16( w32, ay ), _mm_sub_epi16( w32, ay ) ) );
+				__m128i wb = _mm_mullo_epi16( wx, _mm_unpacklo_epi16( ay, ay ) );
+
+				__m128i r = _mm_add_epi32( _mm_madd_epi16( top, wt ), _mm_madd_epi16( bottom, wb ) );
+				r = _mm_srai_epi32( _mm_add_epi32( r, round ), 10 );
+				r = _mm_packs_epi32( r, zero );
+				r = _mm_packus_epi16( r, zero );
+				*( ( uint32_t* ) dst ) = _mm_cvtsi128_si32( r );
+			}
+
+			dst += 4;
+			coords += 8;
+			frac += 4;
+		}
+
+		SIMD::warpBilinearFixed1u8( dst, coords, frac, src, srcStride, srcWidth, srcHeight, fill, n & 0x3 );
+	}
+
+	void SIMDSSE2::warpBilinearFixed4u8( uint8_t* dst, const int16_t* coords, const uint16_t* frac, const uint8_t* src, size_t srcStride, size_t srcWidth, size_t srcHeight, uint32_t fill, size_t n ) const
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i round = _mm_set1_epi32( 512 );
+		int endx = ( ( int ) srcWidth ) - 1;
+		int endy = ( ( int ) srcHeight ) - 1;
+
+		while( n-- ) {
+			int lx = coords[ 0 ];
+			int ly = coords[ 1 ];
+
+			if( lx >= 0 && lx < endx && ly >= 0 && ly < endy ) {
+				const uint8_t* ptr = src + srcStride * ly + sizeof( uint32_t ) * lx;
+				int32_t ax = *frac & 0x1f;
+				int32_t ay = *frac >> 5;
+				__m128i wt = _mm_set1_epi32( ( ( ax * ( 32 - ay ) ) << 16 ) | ( ( 32 - ax ) * ( 32 - ay ) ) );
+				__m128i wb = _mm_set1_epi32( ( ( ax * ay ) << 16 ) | ( ( 32 - ax ) * ay ) );
+
+				/* interleave the channels of both horizontal neighbours: c0 c1 per channel */
+				__m128i top = _mm_unpacklo_epi8( _mm_loadl_epi64( ( const __m128i* ) ptr ), zero );
+				__m128i bottom = _mm_unpacklo_epi8( _mm_loadl_epi64( ( const __m128i* ) ( ptr + srcStride ) ), zero );
+				top = _mm_unpacklo_epi16( top, _mm_srli_si128( top, 8 ) );
+				bottom = _mm_unpacklo_epi16( bottom, _mm_srli_si128( bottom, 8 ) );
+
+				__m128i r = _mm_add_epi32( _mm_madd_epi16( top, wt ), _mm_madd_epi16( bottom, wb ) );
+				r = _mm_srai_epi32( _mm_add_epi32( r, round ), 10 );
+				r = _mm_packs_epi32( r, zero );
+				r = _mm_packus_epi16( r, zero );
+				*( ( uint32_t* ) dst ) = _mm_cvtsi128_si32( r );
+			} else
+				SIMD::warpBilinearFixed4u8( dst, coords, frac, src, srcStride, srcWidth, srcHeight, fill, 1 );
+
+			dst += 4;
+			coords += 2;
+			frac++;
+		}
+	}
+
 	void SIMDSSE2::harrisScore1f( float* dst, const float* boxdx2, const float* boxdy2, const float* boxdxy, float k, size_t width ) const
 	{
 		size_t x;
@@ -4274,6 +4447,68 @@ return ( a * b - c * c ) - ( k * Math::sqr(a + b) );
 }
 
 
+void SIMDSSE2::prefixSum1_u8_to_u32( uint32_t* dst, size_t dstStride, const uint8_t* src, size_t srcStride, size_t width, size_t height ) const
+{
+	const __m128i zero = _mm_setzero_si128();
+	const uint32_t* prev = NULL;
+
+	while( height-- ) {
+		const uint8_t* s = src;
+		uint32_t* d = dst;
+		const uint32_t* p = prev;
+		__m128i run = zero;
+		__m128i x, lo, hi, r0, r1, r2, r3;
+
+		size_t n = width >> 4;
+		while( n-- ) {
+			x = _mm_loadu_si128( ( const __m128i* ) s );
+			lo = _mm_unpacklo_epi8( x, zero );
+			hi = _mm_unpackhi_epi8( x, zero );
+
+			// the prefix sums of 8 values fit into 16 bit
+			lo = _mm_add_epi16( lo, _mm_slli_si128( lo, 2 ) );
+			lo = _mm_add_epi16( lo, _mm_slli_si128( lo, 4 ) );
+			lo = _mm_add_epi16( lo, _mm_slli_si128( lo, 8 ) );
+			hi = _mm_add_epi16( hi, _mm_slli_si128( hi, 2 ) );
+			hi = _mm_add_epi16( hi, _mm_slli_si128( hi, 4 ) );
+			hi = _mm_add_epi16( hi, _mm_slli_si128( hi, 8 ) );
+
+			r0 = _mm_add_epi32( _mm_unpacklo_epi16( lo, zero ), run );
+			r1 = _mm_add_epi32( _mm_unpackhi_epi16( lo, zero ), run );
+			run = _mm_shuffle_epi32( r1, _MM_SHUFFLE( 3, 3, 3, 3 ) );
+			r2 = _mm_add_epi32( _mm_unpacklo_epi16( hi, zero ), run );
+			r3 = _mm_add_epi32( _mm_unpackhi_epi16( hi, zero ), run );
+			run = _mm_shuffle_epi32( r3, _MM_SHUFFLE( 3, 3, 3, 3 ) );
+
+			if( p ) {
+				r0 = _mm_add_epi32( r0, _mm_loadu_si128( ( const __m128i* ) p ) );
+				r1 = _mm_add_epi32( r1, _mm_loadu_si128( ( const __m128i* ) ( p + 4 ) ) );
+				r2 = _mm_add_epi32( r2, _mm_loadu_si128( ( const __m128i* ) ( p + 8 ) ) );
+				r3 = _mm_add_epi32( r3, _mm_loadu_si128( ( const __m128i* ) ( p + 12 ) ) );
+				p += 16;
+			}
+
+			_mm_storeu_si128( ( __m128i* ) d, r0 );
+			_mm_storeu_si128( ( __m128i* ) ( d + 4 ), r1 );
+			_mm_storeu_si128( ( __m128i* ) ( d + 8 ), r2 );
+			_mm_storeu_si128( ( __m128i* ) ( d + 12 ), r3 );
+			s += 16;
+			d += 16;
+		}
+
+		uint32_t sum = ( uint32_t ) _mm_cvtsi128_si32( run );
+		n = width & 0xf;
+		while( n-- ) {
+			sum += *s++;
+			*d++ = p ? sum + *p++ : sum;
+		}
+
+		prev = dst;
+		dst += dstStride;
+		src += srcStride;
+	}
+}
+
 void SIMDSSE2::prefixSum1_u8_to_f( float * _dst, size_t dstStride, const uint8_t * _src, size_t srcStride, size_t width, size_t height ) const
 {
 	// first row
@@ -6381,4 +6616,74 @@ void SIMDSSE2::projectPoints( Vector2f* dst, const Matrix4f& _mat, const Vector3
         }
 }
 
+void SIMDSSE2::tsdfFuse( float* voxels, const float* pos, const float* step, const float* depth, size_t depthStride,
+						 size_t depthWidth, size_t depthHeight, float scale, float trunc, size_t n ) const
+{
+	const uint8_t* dmap = ( const uint8_t* ) depth;
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps( 1.0f );
+	const __m128 four = _mm_set1_ps( 4.0f );
+	const __m128 absmask = _mm_castsi128_ps( _mm_set1_epi32( 0x7fffffff ) );
+	const __m128 width = _mm_set1_ps( ( float ) depthWidth );
+	const __m128 height = _mm_set1_ps( ( float ) depthHeight );
+	const __m128 mscale = _mm_set1_ps( scale );
+	const __m128 mtrunc = _mm_set1_ps( trunc );
+	const __m128 px = _mm_set1_ps( pos[ 0 ] );
+	const __m128 py = _mm_set1_ps( pos[ 1 ] );
+	const __m128 pz = _mm_set1_ps( pos[ 2 ] );
+	const __m128 sx = _mm_set1_ps( step[ 0 ] );
+	const __m128 sy = _mm_set1_ps( step[ 1 ] );
+	const __m128 sz = _mm_set1_ps( step[ 2 ] );
+	__m128 idx = _mm_set_ps( 3.0f, 2.0f, 1.0f, 0.0f );
+	size_t i;
+
+	for( i = 0; i + 4 <= n; i += 4, voxels += 8, idx = _mm_add_ps( idx, four ) ) {
+		__m128 gz = _mm_add_ps( _mm_mul_ps( sz, idx ), pz );
+		__m128 mask = _mm_cmpgt_ps( gz, zero );
+		if( !_mm_movemask_ps( mask ) )
+			continue;
+
+		__m128 ix = _mm_div_ps( _mm_add_ps( _mm_mul_ps( sx, idx ), px ), gz );
+		__m128 iy = _mm_div_ps( _mm_add_ps( _mm_mul_ps( sy, idx ), py ), gz );
+		mask = _mm_and_ps( mask, _mm_and_ps( _mm_cmplt_ps( ix, width ), _mm_cmplt_ps( iy, height ) ) );
+		mask = _mm_and_ps( mask, _mm_and_ps( _mm_cmpge_ps( ix, zero ), _mm_cmpge_ps( iy, zero ) ) );
+		int valid = _mm_movemask_ps( mask );
+		if( !valid )
+			continue;
+
+		/* gather the depth of the voxels inside the image, the others read 0 and are masked out */
+		int32_t cx[ 4 ] __attribute__ ( ( aligned ( 16 ) ) );
+		int32_t cy[ 4 ] __attribute__ ( ( aligned ( 16 ) ) );
+		float d[ 4 ] __attribute__ ( ( aligned ( 16 ) ) );
+		_mm_store_si128( ( __m128i* ) cx, _mm_cvttps_epi32( ix ) );
+		_mm_store_si128( ( __m128i* ) cy, _mm_cvttps_epi32( iy ) );
+		for( int k = 0; k < 4; k++ )
+			d[ k ] = ( valid & ( 1 << k ) ) ? ( ( const float* ) ( dmap + ( size_t ) cy[ k ] * depthStride ) )[ cx[ k ] ] : 0.0f;
+
+		__m128 dv = _mm_mul_ps( _mm_load_ps( d ), mscale );
+		__m128 sdf = _mm_sub_ps( dv, gz );
+		mask = _mm_and_ps( mask, _mm_and_ps( _mm_cmpgt_ps( dv, zero ), _mm_cmple_ps( _mm_and_ps( sdf, absmask ), mtrunc ) ) );
+		if( !_mm_movemask_ps( mask ) )
+			continue;
+
+		/* deinterleave ( tsdf, weight ) pairs, update the running average and blend by mask */
+		__m128 v0 = _mm_loadu_ps( voxels );
+		__m128 v1 = _mm_loadu_ps( voxels + 4 );
+		__m128 t = _mm_shuffle_ps( v0, v1, _MM_SHUFFLE( 2, 0, 2, 0 ) );
+		__m128 w = _mm_shuffle_ps( v0, v1, _MM_SHUFFLE( 3, 1, 3, 1 ) );
+		__m128 w1 = _mm_add_ps( w, one );
+		__m128 tn = _mm_div_ps( _mm_add_ps( _mm_mul_ps( t, w ), _mm_div_ps( sdf, mtrunc ) ), w1 );
+		t = _mm_or_ps( _mm_and_ps( mask, tn ), _mm_andnot_ps( mask, t ) );
+		w = _mm_or_ps( _mm_and_ps( mask, w1 ), _mm_andnot_ps( mask, w ) );
+		_mm_storeu_ps( voxels, _mm_unpacklo_ps( t, w ) );
+		_mm_storeu_ps( voxels + 4, _mm_unpackhi_ps( t, w ) );
+	}
+
+	for( ; i < n; i++, voxels += 2 ) {
+		float fi = ( float ) i;
+		tsdfFuseVoxel( voxels, step[ 0 ] * fi + pos[ 0 ], step[ 1 ] * fi + pos[ 1 ], step[ 2 ] * fi + pos[ 2 ],
+					   dmap, depthStride, ( float ) depthWidth, ( float ) depthHeight, scale, trunc );
+	}
+}
+
 }
@@ -49,6 +49,11 @@ namespace cvt {
 
             virtual float NCC( float const* src1, float const* src2, const size_t n ) const;
 
+			virtual void MinValueU8( uint8_t* dst, const uint8_t* src1, const uint8_t* src2, size_t n ) const;
+			virtual void MinValueU16( uint16_t* dst, const uint16_t* src1, const uint16_t* src2, size_t n ) const;
+			virtual void MaxValueU8( uint8_t* dst, const uint8_t* src1, const uint8_t* src2, size_t n ) const;
+			virtual void MaxValueU16( uint16_t* dst, const uint16_t* src1, const uint16_t* src2, size_t n ) const;
+
 			/* Add vertical */
 			virtual void AddVert_f( float* dst, const float**bufs, size_t numbufs, size_t width ) const;
 			virtual void AddVert_f_to_u8( uint8_t* dst, const float**bufs, size_t numbufs, size_t width ) const;
@@ -110,6 +115,9 @@ namespace cvt {
 			virtual void pyrdownHalfHorizontal_1u8_to_1u16( uint16_t* dst, const uint8_t* src, size_t n ) const;
 			virtual void pyrdownHalfVertical_1u16_to_1u8( uint8_t* dst, uint16_t* rows[ 5 ], size_t n ) const;
 
+			virtual void warpBilinearFixed1u8( uint8_t* dst, const int16_t* coords, const uint16_t* frac, const uint8_t* src, size_t srcStride, size_t srcWidth, size_t srcHeight, uint8_t fill, size_t n ) const;
+			virtual void warpBilinearFixed4u8( uint8_t* dst, const int16_t* coords, const uint16_t* frac, const uint8_t* src, size_t srcStride, size_t srcWidth, size_t srcHeight, uint32_t fill, size_t n ) const;
+
 			virtual void harrisScore1f( float* dst, const float* boxdx2, const float* boxdy2, const float* boxdxdy, float kappa, size_t width ) const;
 
 			virtual float harrisResponse1u8( const uint8_t* _src, size_t srcStride, size_t w, size_t h, const float k ) const;
@@ -117,6 +125,7 @@ namespace cvt {
 			virtual float harrisResponseCircular1u8( float & xx, float & xy, float & yy, const uint8_t* _src, size_t srcStride, const float k ) const;
 
             virtual void prefixSum1_u8_to_f( float * dst, size_t dstStride, const uint8_t * src, size_t srcStride, size_t width, size_t height ) const;
+            virtual void prefixSum1_u8_to_u32( uint32_t* dst, size_t dstStride, const uint8_t* src, size_t srcStride, size_t width, size_t height ) const;
             virtual void prefixSumSqr1_u8_to_f( float * dst, size_t dStride, const uint8_t * src, size_t srcStride, size_t width, size_t height ) const;
 
 			virtual void boxFilterPrefixSum1_f_to_u8( uint8_t* dst, size_t dstride, const float* src, size_t srcstride, size_t width, size_t height, size_t boxwidth, size_t boxheight ) const;
@@ -131,6 +140,9 @@ namespace cvt {
 			virtual void adaptiveThreshold1_f_to_u8( uint8_t* dst, const float* src, const float* srcmean, size_t n, float t ) const;
 			virtual void adaptiveThreshold1_f_to_f( float* dst, const float* src, const float* srcmean, size_t n, float t ) const;
 
+			virtual void tsdfFuse( float* voxels, const float* pos, const float* step, const float* depth, size_t depthStride,
+								   size_t depthWidth, size_t depthHeight, float scale, float trunc, size_t n ) const;
+
 			virtual void sumPoints( Vector2f& dst, const Vector2f* src, size_t n ) const;
 			virtual void sumPoints( Vector3f& dst, const Vector3f* src, size_t n ) const;
 
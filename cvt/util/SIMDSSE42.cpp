@@ -29,30 +29,59 @@
 
 namespace cvt
 {
-    /*
-	size_t SIMDSSE42::hammingDistance( const uint8_t* src1, const uint8_t* src2, size_t n ) const
-    {
-        size_t pcount = 0;
+	/* SSE4.2 is only instantiated together with POPCNT, see SIMD::get and SIMD::bestSupportedType */
+	static inline size_t _popcountXor( const uint8_t* src1, const uint8_t* src2, size_t n )
+	{
+		size_t pcount = 0;
+		uint64_t a, b;
 
-        size_t n8 = n >> 3;
-        size_t r  = n - ( n8 << 3 );
+		while( n >= 8 ) {
+			memcpy( &a, src1, 8 );
+			memcpy( &b, src2, 8 );
+			pcount += __builtin_popcountll( a ^ b );
+			src1 += 8;
+			src2 += 8;
+			n -= 8;
+		}
 
-        while ( n8-- ) {
-            pcount += _mm_popcnt_u64( *(uint64_t*)src1 ^ *(uint64_t*)src2 );
-            src1 += 8;
-            src2 += 8;
-        }
+		if( n ) {
+			a = b = 0;
+			memcpy( &a, src1, n );
+			memcpy( &b, src2, n );
+			pcount += __builtin_popcountll( a ^ b );
+		}
+		return pcount;
+	}
 
-        if( r ){
-            uint64_t  a = 0, b = 0;
+	size_t SIMDSSE42::hammingDistance( const uint8_t* src1, const uint8_t* src2, size_t n ) const
+	{
+		return _popcountXor( src1, src2, n );
+	}
 
-            Memcpy( ( uint8_t* ) &a, src1, r );
-            Memcpy( ( uint8_t* ) &b, src2, r );
+	void SIMDSSE42::hammingDistanceBest( size_t& best, size_t& bestDist, size_t& second, size_t& secondDist,
+										 const uint8_t* query, const uint8_t* descs, size_t stride, size_t num, size_t n ) const
+	{
+		best = second = num;
+		bestDist = secondDist = ( size_t ) -1;
 
-            pcount += _mm_popcnt_u64( a ^ b );
-        }
+		if( n == 32 ) {
+			/* ORB and BRIEF-32: keep the query in registers */
+			uint64_t q[ 4 ], d[ 4 ];
+			memcpy( q, query, 32 );
+			for( size_t i = 0; i < num; i++ ) {
+				memcpy( d, descs, 32 );
+				size_t dist = __builtin_popcountll( q[ 0 ] ^ d[ 0 ] ) + __builtin_popcountll( q[ 1 ] ^ d[ 1 ] ) +
+							  __builtin_popcountll( q[ 2 ] ^ d[ 2 ] ) + __builtin_popcountll( q[ 3 ] ^ d[ 3 ] );
+				hammingUpdateBest( best, bestDist, second, secondDist, i, dist );
+				descs += stride;
+			}
+			return;
+		}
 
-        return pcount;
-    }*/
+		for( size_t i = 0; i < num; i++ ) {
+			hammingUpdateBest( best, bestDist, second, secondDist, i, _popcountXor( query, descs, n ) );
+			descs += stride;
+		}
+	}
 
 }
@@ -36,7 +36,9 @@ namespace cvt {
 			SIMDSSE42()	{}
 
 		public:
-//			virtual size_t hammingDistance(const uint8_t* src1, const uint8_t* src2, size_t n) const;
+			virtual size_t hammingDistance( const uint8_t* src1, const uint8_t* src2, size_t n ) const;
+			virtual void hammingDistanceBest( size_t& best, size_t& bestDist, size_t& second, size_t& secondDist,
+											  const uint8_t* query, const uint8_t* descs, size_t stride, size_t num, size_t n ) const;
 
 			virtual std::string name() const;
 			virtual SIMDType type() const;
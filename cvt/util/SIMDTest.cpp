@@ -141,6 +141,60 @@ static bool _hammingTest()
     return result;
 }
 
+static bool _hammingBestTest()
+{
+	bool result = true;
+	const size_t num = 67;
+	const size_t stride = 80;
+	const size_t lens[ 3 ] = { 32, 64, 17 };
+	uint8_t query[ 64 ];
+	uint8_t* descs = new uint8_t[ num * stride ];
+
+	for( size_t i = 0; i < num * stride; i++ )
+		descs[ i ] = ( uint8_t ) rand();
+	for( size_t i = 0; i < 64; i++ )
+		query[ i ] = ( uint8_t ) rand();
+	/* force ties for the best and the second best distance */
+	memcpy( descs + 40 * stride, descs + 7 * stride, stride );
+	memcpy( descs + 41 * stride, descs + 7 * stride, stride );
+
+	SIMD* base = SIMD::get( SIMD_BASE );
+	SIMDType bestType = SIMD::bestSupportedType();
+	for( int st = SIMD_BASE; st <= bestType; st++ ) {
+		SIMD* simd = SIMD::get( ( SIMDType ) st );
+		for( size_t l = 0; l < 3; l++ ) {
+			size_t n = lens[ l ];
+			for( size_t cnt = 0; cnt <= num; cnt += 3 ) {
+				size_t rbest = cnt, rsecond = cnt, rbestDist = ( size_t ) -1, rsecondDist = ( size_t ) -1;
+				for( size_t i = 0; i < cnt; i++ ) {
+					size_t d = base->hammingDistance( query, descs + i * stride, n );
+					if( d < rbestDist ) {
+						rsecond = rbest;
+						rsecondDist = rbestDist;
+						rbest = i;
+						rbestDist = d;
+					} else if( d < rsecondDist ) {
+						rsecond = i;
+						rsecondDist = d;
+					}
+				}
+
+				size_t best, bestDist, second, secondDist;
+				simd->hammingDistanceBest( best, bestDist, second, secondDist, query, descs, stride, cnt, n );
+				if( best != rbest || bestDist != rbestDist || second != rsecond || secondDist != rsecondDist ) {
+					std::cout << simd->name() << " n=" << n << " num=" << cnt << ": " << best << "/" << bestDist << " "
+							  << second << "/" << secondDist << " expected " << rbest << "/" << rbestDist << " "
+							  << rsecond << "/" << rsecondDist << std::endl;
+					result = false;
+				}
+			}
+		}
+	}
+
+	delete[] descs;
+	return result;
+}
+
 static bool _projectTest()
 {
 	std::vector<Vector2f> gtProjected;
@@ -299,6 +353,171 @@ static void _NCCTest( float* src1, float* src2, size_t n )
 	delete[] constval;
 }
 
+static bool _compare( const float* a, const float* b, size_t n, float eps )
+{
+	for( size_t i = 0; i < n; i++ ) {
+		if( Math::abs( a[ i ] - b[ i ] ) > eps * Math::max( 1.0f, Math::abs( a[ i ] ) ) )
+			return false;
+	}
+	return true;
+}
+
+static bool _compare( const uint8_t* a, const uint8_t* b, size_t n, int eps )
+{
+	for( size_t i = 0; i < n; i++ ) {
+		if( Math::abs( ( int ) a[ i ] - ( int ) b[ i ] ) > eps )
+			return false;
+	}
+	return true;
+}
+
+/* compare the filter kernels of every SIMD level against the generic implementation */
+static void _kernelTest()
+{
+	const size_t w = 132, h = 11;
+	const size_t n = w * h * 4;
+	float* fsrc = new float[ n ];
+	float* fref = new float[ n ];
+	float* fdst = new float[ n ];
+	float* faccum = new float[ n ];
+	uint8_t* usrc = new uint8_t[ n ];
+	uint8_t* uref = new uint8_t[ n ];
+	uint8_t* udst = new uint8_t[ n ];
+	float* coords = new float[ w * h * 2 ];
+	const float* bufs[ 7 ];
+	float weights[ 7 ] = { 0.05f, 0.1f, 0.2f, 0.3f, 0.2f, 0.1f, 0.05f };
+	float fill[ 4 ] = { 0.1f, 0.2f, 0.3f, 0.4f };
+
+	for( size_t i = 0; i < n; i++ ) {
+		fsrc[ i ] = Math::rand( 0.0f, 1.0f );
+		usrc[ i ] = ( uint8_t ) Math::rand( 0, 256 );
+	}
+	for( size_t i = 0; i < w * h; i++ ) {
+		coords[ 2 * i ] = Math::rand( -2.0f, ( float ) w + 1.0f );
+		coords[ 2 * i + 1 ] = Math::rand( -2.0f, ( float ) h + 1.0f );
+	}
+	for( size_t k = 0; k < 7; k++ )
+		bufs[ k ] = fsrc + k * w;
+
+	SIMD* base = SIMD::get( SIMD_BASE );
+	SIMDType bestType = SIMD::bestSupportedType();
+	for( int st = SIMD_BASE + 1; st <= bestType; st++ ) {
+		SIMD* simd = SIMD::get( ( SIMDType ) st );
+		bool ok = true;
+
+		for( size_t c = 1; c <= 4; c <<= 1 ) {
+			for( size_t wn = 1; wn <= 7; wn += 2 ) {
+				if( c == 1 ) {
+					base->ConvolveHorizontal1f( fref, fsrc, w, weights + 3 - wn / 2, wn, IBORDER_CLAMP );
+					simd->ConvolveHorizontal1f( fdst, fsrc, w, weights + 3 - wn / 2, wn, IBORDER_CLAMP );
+					ok &= _compare( fref, fdst, w * c, 1e-5f );
+					simd->ConvolveHorizontalSym1f( fdst, fsrc, w, weights + 3 - wn / 2, wn, IBORDER_CLAMP );
+				} else if( c == 2 ) {
+					base->ConvolveHorizontal2f( fref, fsrc, w, weights + 3 - wn / 2, wn, IBORDER_MIRROR );
+					simd->ConvolveHorizontal2f( fdst, fsrc, w, weights + 3 - wn / 2, wn, IBORDER_MIRROR );
+					ok &= _compare( fref, fdst, w * c, 1e-5f );
+					simd->ConvolveHorizontalSym2f( fdst, fsrc, w, weights + 3 - wn / 2, wn, IBORDER_MIRROR );
+				} else {
+					base->ConvolveHorizontal4f( fref, fsrc, w, weights + 3 - wn / 2, wn, IBORDER_CLAMP );
+					simd->ConvolveHorizontal4f( fdst, fsrc, w, weights + 3 - wn / 2, wn, IBORDER_CLAMP );
+					ok &= _compare( fref, fdst, w * c, 1e-5f );
+					simd->ConvolveHorizontalSym4f( fdst, fsrc, w, weights + 3 - wn / 2, wn, IBORDER_CLAMP );
+				}
+				ok &= _compare( fref, fdst, w * c, 1e-5f );
+			}
+		}
+		CVTTEST_PRINT( simd->name() + " ConvolveHorizontal", ok );
+
+		ok = true;
+		base->ConvolveClampVert_f( fref, bufs, weights, 7, w );
+		simd->ConvolveClampVert_f( fdst, bufs, weights, 7, w );
+		ok &= _compare( fref, fdst, w, 1e-5f );
+		simd->ConvolveClampVertSym_f( fdst, bufs, weights, 7, w );
+		ok &= _compare( fref, fdst, w, 1e-5f );
+		CVTTEST_PRINT( simd->name() + " ConvolveClampVert", ok );
+
+		ok = true;
+		base->Conv_f_to_u8( uref, fsrc, n );
+		simd->Conv_f_to_u8( udst, fsrc, n );
+		ok &= _compare( uref, udst, n, 0 );
+		base->Conv_u8_to_f( fref, usrc, n );
+		simd->Conv_u8_to_f( fdst, usrc, n );
+		ok &= _compare( fref, fdst, n, 0.0f );
+		CVTTEST_PRINT( simd->name() + " Conv u8 <-> f", ok );
+
+		ok = true;
+		base->BoxFilterHorizontal_1f( fref, fsrc, 3, w );
+		simd->BoxFilterHorizontal_1f( fdst, fsrc, 3, w );
+		ok &= _compare( fref, fdst, w, 1e-5f );
+		for( size_t i = 0; i < w; i++ )
+			faccum[ i ] = fsrc[ 2 * w + i ];
+		base->BoxFilterVert_f( fref, faccum, fsrc, fsrc + w, 3, w );
+		for( size_t i = 0; i < w; i++ )
+			faccum[ i ] = fsrc[ 2 * w + i ];
+		simd->BoxFilterVert_f( fdst, faccum, fsrc, fsrc + w, 3, w );
+		ok &= _compare( fref, fdst, w, 1e-5f );
+		CVTTEST_PRINT( simd->name() + " BoxFilter", ok );
+
+		ok = true;
+		base->prefixSum1_u8_to_f( fref, w, usrc, w, w, h );
+		simd->prefixSum1_u8_to_f( fdst, w, usrc, w, w, h );
+		ok &= _compare( fref, fdst, w * h, 0.0f );
+		base->prefixSum1_f_to_f( fref, w, fsrc, w, w, h );
+		simd->prefixSum1_f_to_f( fdst, w, fsrc, w, w, h );
+		ok &= _compare( fref, fdst, w * h, 1e-5f );
+		base->prefixSumSqr1_u8_to_f( fref, w, usrc, w, w, h );
+		simd->prefixSumSqr1_u8_to_f( fdst, w, usrc, w, w, h );
+		ok &= _compare( fref, fdst, w * h, 1e-6f );
+		CVTTEST_PRINT( simd->name() + " prefixSum", ok );
+
+		ok = true;
+		base->warpBilinear1f( fref, coords, fsrc, w * sizeof( float ), w, h, 0.5f, w * h );
+		simd->warpBilinear1f( fdst, coords, fsrc, w * sizeof( float ), w, h, 0.5f, w * h );
+		ok &= _compare( fref, fdst, w * h, 1e-5f );
+		base->warpBilinear4f( fref, coords, fsrc, w * 4 * sizeof( float ), w, h, fill, w * h );
+		simd->warpBilinear4f( fdst, coords, fsrc, w * 4 * sizeof( float ), w, h, fill, w * h );
+		ok &= _compare( fref, fdst, w * h * 4, 1e-5f );
+		CVTTEST_PRINT( simd->name() + " warpBilinear", ok );
+
+		ok = true;
+		base->harrisScore1f( fref, fsrc, fsrc + w, fsrc + 2 * w, 0.04f, w );
+		simd->harrisScore1f( fdst, fsrc, fsrc + w, fsrc + 2 * w, 0.04f, w );
+		ok &= _compare( fref, fdst, w, 1e-5f );
+		CVTTEST_PRINT( simd->name() + " harrisScore", ok );
+
+		/* rows of 101 voxels crossing the image border and the camera plane */
+		ok = true;
+		size_t updated = 0;
+		for( size_t row = 0; row < 20; row++ ) {
+			float pos[ 3 ] = { Math::rand( -20.0f, 20.0f ), Math::rand( -2.0f, 4.0f ), Math::rand( -0.5f, 0.5f ) };
+			float step[ 3 ] = { Math::rand( 0.0f, 3.0f ), Math::rand( -0.1f, 0.1f ), Math::rand( 0.0f, 0.03f ) };
+			for( size_t i = 0; i < 101; i++ ) {
+				fref[ 2 * i ] = fdst[ 2 * i ] = Math::rand( -1.0f, 1.0f );
+				fref[ 2 * i + 1 ] = fdst[ 2 * i + 1 ] = ( float ) ( i % 5 );
+			}
+			base->tsdfFuse( fref, pos, step, fsrc, w * sizeof( float ), w, h, 2.0f, 0.5f, 101 );
+			simd->tsdfFuse( fdst, pos, step, fsrc, w * sizeof( float ), w, h, 2.0f, 0.5f, 101 );
+			ok &= _compare( fref, fdst, 202, 1e-6f );
+			for( size_t i = 0; i < 101; i++ )
+				updated += fref[ 2 * i + 1 ] != ( float ) ( i % 5 );
+		}
+		ok &= updated > 0;
+		CVTTEST_PRINT( simd->name() + " tsdfFuse", ok );
+
+		delete simd;
+	}
+	delete base;
+
+	delete[] fsrc;
+	delete[] fref;
+	delete[] fdst;
+	delete[] faccum;
+	delete[] usrc;
+	delete[] uref;
+	delete[] udst;
+	delete[] coords;
+}
+
 BEGIN_CVTTEST( simd )
 		float* fdst;
 		float* fsrc1;
@@ -335,10 +554,15 @@ BEGIN_CVTTEST( simd )
                 
         bool testResult = _hammingTest();
         CVTTEST_PRINT( "HammingDistance", testResult );
+
+		testResult = _hammingBestTest();
+		CVTTEST_PRINT( "HammingDistanceBest", testResult );
         
 		testResult = _projectTest();
         CVTTEST_PRINT( "Project Points 3d->2d", testResult );
 
+		_kernelTest();
+
 #define TESTSIZE ( 2048 * 2048 )
 		fdst = new float[ TESTSIZE ];
 		fsrc1 = new float[ TESTSIZE ];
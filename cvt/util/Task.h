@@ -0,0 +1,54 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_TASK_H
+#define CVT_TASK_H
+
+#include <stdlib.h>
+
+namespace cvt {
+	class TaskGroup;
+
+	/**
+	  \brief Unit of work executed by the ThreadPool.
+
+	  Tasks are spawned into a TaskGroup, which takes ownership and deletes
+	  the task after execute() returned.
+	 */
+	class Task {
+		friend class TaskGroup;
+		friend class ThreadPool;
+		public:
+			Task() : _group( NULL ) {}
+			virtual ~Task() {}
+			virtual void execute() = 0;
+
+		private:
+			Task( const Task& t );
+
+			TaskGroup* _group;
+	};
+}
+
+#endif
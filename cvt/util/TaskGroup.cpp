@@ -0,0 +1,89 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/util/TaskGroup.h>
+#include <sched.h>
+
+namespace cvt {
+
+	TaskGroup::TaskGroup( ThreadPool& pool ) :
+		_pool( pool ),
+		_pending( 0 ),
+		_failed( 0 )
+	{
+	}
+
+	TaskGroup::~TaskGroup()
+	{
+		wait();
+	}
+
+	void TaskGroup::spawn( Task* task )
+	{
+		task->_group = this;
+		__atomic_fetch_add( &_pending, 1, __ATOMIC_SEQ_CST );
+		_pool.submit( task );
+	}
+
+	void TaskGroup::join()
+	{
+		wait();
+		if( _failed ) {
+			_failed = 0;
+			throw CVTException( "Exception in task of TaskGroup" );
+		}
+	}
+
+	void TaskGroup::wait()
+	{
+		/* help executing tasks as long as there is work */
+		size_t idle = 0;
+		while( __atomic_load_n( &_pending, __ATOMIC_ACQUIRE ) > 0 && idle < 64 ) {
+			if( _pool.runOne() ) {
+				idle = 0;
+			} else {
+				idle++;
+				sched_yield();
+			}
+		}
+
+		/* the remaining tasks are running on other threads */
+		_mutex.lock();
+		while( _pending > 0 )
+			_cond.wait( _mutex );
+		_mutex.unlock();
+	}
+
+	void TaskGroup::taskDone( bool failed )
+	{
+		if( failed )
+			__atomic_store_n( &_failed, 1, __ATOMIC_SEQ_CST );
+
+		/* decrement under the lock, the group may be destroyed as soon as a waiting thread sees zero */
+		_mutex.lock();
+		if( __atomic_sub_fetch( &_pending, 1, __ATOMIC_SEQ_CST ) == 0 )
+			_cond.notifyAll();
+		_mutex.unlock();
+	}
+}
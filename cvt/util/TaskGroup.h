@@ -0,0 +1,69 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_TASKGROUP_H
+#define CVT_TASKGROUP_H
+
+#include <cvt/util/ThreadPool.h>
+
+namespace cvt {
+
+	/**
+	  \brief Set of tasks executed by a ThreadPool which can be joined.
+
+	  join() blocks until all spawned tasks, including tasks spawned by tasks
+	  of this group, are finished. While waiting the joining thread executes
+	  pending tasks itself. If a task threw an exception, join() throws.
+	 */
+	class TaskGroup {
+		friend class ThreadPool;
+		public:
+			TaskGroup( ThreadPool& pool = ThreadPool::instance() );
+			~TaskGroup();
+
+			void		spawn( Task* task );
+			void		join();
+			ThreadPool& pool() const;
+
+		private:
+			TaskGroup( const TaskGroup& );
+			TaskGroup& operator=( const TaskGroup& );
+
+			void		wait();
+			void		taskDone( bool failed );
+
+			ThreadPool&		_pool;
+			int				_pending;
+			int				_failed;
+			Mutex			_mutex;
+			Condition		_cond;
+	};
+
+	inline ThreadPool& TaskGroup::pool() const
+	{
+		return _pool;
+	}
+}
+
+#endif
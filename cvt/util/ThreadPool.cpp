@@ -0,0 +1,194 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/util/ThreadPool.h>
+#include <cvt/util/TaskGroup.h>
+#include <cvt/util/Util.h>
+#include <unistd.h>
+
+namespace cvt {
+
+	/* pool and queue index of the current thread, if it is a worker */
+	static __thread ThreadPool* _currentPool = NULL;
+	static __thread size_t		_currentIndex = 0;
+
+	ThreadPool::ThreadPool( size_t numThreads ) :
+		_pending( 0 ),
+		_sleeping( 0 ),
+		_stop( false )
+	{
+		if( !numThreads )
+			numThreads = hardwareConcurrency();
+
+		/* the thread joining a TaskGroup executes tasks as well */
+		size_t nworkers = numThreads - 1;
+
+		for( size_t i = 0; i <= nworkers; i++ )
+			_queues.push_back( new TaskQueue() );
+
+		for( size_t i = 0; i < nworkers; i++ ) {
+			Worker* w = new Worker( i );
+			_workers.push_back( w );
+			w->run( this );
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		_sleepMutex.lock();
+		_stop = true;
+		_sleepCond.notifyAll();
+		_sleepMutex.unlock();
+
+		for( size_t i = 0; i < _workers.size(); i++ ) {
+			_workers[ i ]->join();
+			delete _workers[ i ];
+		}
+
+		for( size_t i = 0; i < _queues.size(); i++ )
+			delete _queues[ i ];
+	}
+
+	ThreadPool& ThreadPool::instance()
+	{
+		static ThreadPool _instance;
+		return _instance;
+	}
+
+	size_t ThreadPool::hardwareConcurrency()
+	{
+		String env;
+		if( Util::getEnv( env, "CVT_NUM_THREADS" ) ) {
+			int n = env.toInteger();
+			if( n > 0 )
+				return n;
+		}
+
+		long n = sysconf( _SC_NPROCESSORS_ONLN );
+		return n > 0 ? ( size_t ) n : 1;
+	}
+
+	size_t ThreadPool::currentQueue() const
+	{
+		if( _currentPool == this )
+			return _currentIndex;
+		return _workers.size();
+	}
+
+	void ThreadPool::submit( Task* task )
+	{
+		TaskQueue* queue = _queues[ currentQueue() ];
+
+		/* count first, _pending is never smaller than the number of queued tasks */
+		__atomic_fetch_add( &_pending, 1, __ATOMIC_SEQ_CST );
+		queue->mutex.lock();
+		queue->tasks.push_back( task );
+		queue->mutex.unlock();
+
+		if( __atomic_load_n( &_sleeping, __ATOMIC_SEQ_CST ) ) {
+			_sleepMutex.lock();
+			_sleepCond.notify();
+			_sleepMutex.unlock();
+		}
+	}
+
+	Task* ThreadPool::findTask( size_t index )
+	{
+		Task* task = NULL;
+		size_t nqueues = _queues.size();
+
+		if( !__atomic_load_n( &_pending, __ATOMIC_ACQUIRE ) )
+			return NULL;
+
+		/* own queue: LIFO */
+		TaskQueue* own = _queues[ index ];
+		own->mutex.lock();
+		if( !own->tasks.empty() ) {
+			task = own->tasks.back();
+			own->tasks.pop_back();
+		}
+		own->mutex.unlock();
+
+		/* steal from the others: FIFO */
+		for( size_t i = 1; !task && i < nqueues; i++ ) {
+			TaskQueue* victim = _queues[ ( index + i ) % nqueues ];
+			victim->mutex.lock();
+			if( !victim->tasks.empty() ) {
+				task = victim->tasks.front();
+				victim->tasks.pop_front();
+			}
+			victim->mutex.unlock();
+		}
+
+		if( task )
+			__atomic_fetch_sub( &_pending, 1, __ATOMIC_SEQ_CST );
+		return task;
+	}
+
+	bool ThreadPool::runOne()
+	{
+		Task* task = findTask( currentQueue() );
+		if( !task )
+			return false;
+		run( task );
+		return true;
+	}
+
+	void ThreadPool::run( Task* task )
+	{
+		bool failed = false;
+		TaskGroup* group = task->_group;
+
+		try {
+			task->execute();
+		} catch( ... ) {
+			failed = true;
+		}
+		delete task;
+
+		if( group )
+			group->taskDone( failed );
+	}
+
+	void ThreadPool::workerLoop( size_t index )
+	{
+		_currentPool  = this;
+		_currentIndex = index;
+
+		while( !__atomic_load_n( &_stop, __ATOMIC_ACQUIRE ) ) {
+			Task* task = findTask( index );
+			if( task ) {
+				run( task );
+				continue;
+			}
+
+			_sleepMutex.lock();
+			__atomic_fetch_add( &_sleeping, 1, __ATOMIC_SEQ_CST );
+			while( !__atomic_load_n( &_pending, __ATOMIC_SEQ_CST ) && !_stop )
+				_sleepCond.wait( _sleepMutex );
+			__atomic_fetch_sub( &_sleeping, 1, __ATOMIC_SEQ_CST );
+			_sleepMutex.unlock();
+		}
+	}
+}
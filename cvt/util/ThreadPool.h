@@ -0,0 +1,107 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_THREADPOOL_H
+#define CVT_THREADPOOL_H
+
+#include <cvt/util/Mutex.h>
+#include <cvt/util/Condition.h>
+#include <cvt/util/Thread.h>
+#include <cvt/util/Task.h>
+#include <vector>
+#include <deque>
+
+namespace cvt {
+
+	/**
+	  \brief Work-stealing thread pool.
+
+	  Every worker owns a task deque: spawned tasks are pushed to the back of
+	  the deque of the spawning worker and popped LIFO by the owner, idle
+	  workers steal FIFO from the front of the other deques. Tasks spawned from
+	  threads outside the pool go to a separate injection queue.
+
+	  Tasks are submitted through a TaskGroup, a thread joining a group helps
+	  executing pending tasks, so the calling thread always contributes.
+	  The number of workers of the global instance can be set with the
+	  environment variable CVT_NUM_THREADS ( including the calling thread ).
+	 */
+	class ThreadPool {
+		friend class TaskGroup;
+		public:
+			ThreadPool( size_t numThreads = 0 );
+			~ThreadPool();
+
+			size_t				numWorkers() const;
+			size_t				concurrency() const;
+
+			static ThreadPool&	instance();
+			static size_t		hardwareConcurrency();
+
+		private:
+			class Worker : public Thread<ThreadPool> {
+				public:
+					Worker( size_t index ) : _index( index ) {}
+					void execute( ThreadPool* pool ) { pool->workerLoop( _index ); }
+				private:
+					size_t _index;
+			};
+
+			struct TaskQueue {
+				Mutex			 mutex;
+				std::deque<Task*> tasks;
+			};
+
+			ThreadPool( const ThreadPool& );
+			ThreadPool& operator=( const ThreadPool& );
+
+			void	submit( Task* task );
+			bool	runOne();
+			Task*	findTask( size_t index );
+			void	run( Task* task );
+			void	workerLoop( size_t index );
+			size_t	currentQueue() const;
+
+			std::vector<Worker*>	_workers;
+			/* one queue per worker + the injection queue for external threads */
+			std::vector<TaskQueue*> _queues;
+			Mutex					_sleepMutex;
+			Condition				_sleepCond;
+			int						_pending;
+			int						_sleeping;
+			bool					_stop;
+	};
+
+	inline size_t ThreadPool::numWorkers() const
+	{
+		return _workers.size();
+	}
+
+	inline size_t ThreadPool::concurrency() const
+	{
+		return _workers.size() + 1;
+	}
+}
+
+#endif
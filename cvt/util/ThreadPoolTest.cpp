@@ -0,0 +1,130 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/util/ParallelFor.h>
+#include <cvt/util/CVTTest.h>
+#include <vector>
+
+using namespace cvt;
+
+class SumTask : public Task {
+	public:
+		SumTask( volatile int* sum, int value ) : _sum( sum ), _value( value ) {}
+		void execute() { __sync_fetch_and_add( _sum, _value ); }
+
+	private:
+		volatile int* _sum;
+		int			  _value;
+};
+
+class NestedTask : public Task {
+	public:
+		NestedTask( volatile int* sum ) : _sum( sum ) {}
+		void execute()
+		{
+			TaskGroup group;
+			for( int i = 1; i <= 10; i++ )
+				group.spawn( new SumTask( _sum, i ) );
+			group.join();
+		}
+
+	private:
+		volatile int* _sum;
+};
+
+class ThrowTask : public Task {
+	public:
+		void execute() { throw CVTException( "test" ); }
+};
+
+class FillBody {
+	public:
+		FillBody( std::vector<size_t>& data ) : _data( data ) {}
+		void operator()( const Range<size_t>& r ) const
+		{
+			for( size_t i = r.min; i < r.max; i++ )
+				_data[ i ] += i;
+		}
+
+	private:
+		std::vector<size_t>& _data;
+};
+
+BEGIN_CVTTEST( ThreadPool )
+	bool result = true;
+
+	CVTTEST_LOG( "Threads: " << ThreadPool::instance().concurrency() );
+
+	{
+		volatile int sum = 0;
+		TaskGroup group;
+		for( int i = 1; i <= 1000; i++ )
+			group.spawn( new SumTask( &sum, i ) );
+		group.join();
+		bool b = sum == 500500;
+		CVTTEST_PRINT( "TaskGroup join", b );
+		result &= b;
+	}
+
+	{
+		volatile int sum = 0;
+		TaskGroup group;
+		for( int i = 0; i < 100; i++ )
+			group.spawn( new NestedTask( &sum ) );
+		group.join();
+		bool b = sum == 5500;
+		CVTTEST_PRINT( "TaskGroup nested", b );
+		result &= b;
+	}
+
+	{
+		TaskGroup group;
+		group.spawn( new ThrowTask() );
+		bool b = false;
+		try {
+			group.join();
+		} catch( const Exception& ) {
+			b = true;
+		}
+		CVTTEST_PRINT( "TaskGroup exception", b );
+		result &= b;
+	}
+
+	{
+		const size_t n = 100003;
+		std::vector<size_t> data( n, 0 );
+		bool b = true;
+		for( size_t grain = 0; grain < 64; grain += 7 ) {
+			for( size_t i = 0; i < n; i++ )
+				data[ i ] = 0;
+			parallelFor( Range<size_t>( 0, n ), FillBody( data ), grain );
+			for( size_t i = 0; i < n; i++ )
+				b &= data[ i ] == i;
+		}
+		CVTTEST_PRINT( "parallelFor", b );
+		result &= b;
+	}
+
+	return result;
+END_CVTTEST
@@ -0,0 +1,90 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/vision/IntegralPyramid.h>
+#include <cvt/util/SIMD.h>
+#include <cvt/util/Exception.h>
+
+#include <string.h>
+
+namespace cvt
+{
+	IntegralPyramid::IntegralPyramid() :
+		_octaves( 0 ),
+		_scaleFactor( 1.0f )
+	{
+	}
+
+	void IntegralPyramid::update( const ImagePyramid& pyr )
+	{
+		if( _tables.size() < pyr.octaves() )
+			_tables.resize( pyr.octaves() );
+
+		for( size_t i = 0; i < pyr.octaves(); i++ )
+			updateTable( _tables[ i ], pyr[ i ] );
+		_octaves = pyr.octaves();
+		_scaleFactor = pyr.scaleFactor();
+	}
+
+	void IntegralPyramid::update( const Image& img )
+	{
+		if( _tables.empty() )
+			_tables.resize( 1 );
+
+		updateTable( _tables[ 0 ], img );
+		_octaves = 1;
+		_scaleFactor = 1.0f;
+	}
+
+	void IntegralPyramid::updateTable( Table& table, const Image& img )
+	{
+		if( img.channels() != 1 )
+			throw CVTException( "IntegralPyramid: only single channel images are supported" );
+
+		Image tmp;
+		const Image* src = &img;
+		if( img.format() != IFormat::GRAY_UINT8 ) {
+			img.convert( tmp, IFormat::GRAY_UINT8 );
+			src = &tmp;
+		}
+
+		const size_t w = src->width();
+		const size_t h = src->height();
+		table.width = w;
+		table.height = h;
+		table.stride = w + 1;
+		if( table.data.size() < ( h + 1 ) * table.stride )
+			table.data.resize( ( h + 1 ) * table.stride );
+
+		uint32_t* dst = &table.data[ 0 ];
+		memset( dst, 0, sizeof( uint32_t ) * table.stride );
+		for( size_t y = 1; y <= h; y++ )
+			dst[ y * table.stride ] = 0;
+
+		size_t sstride;
+		const uint8_t* s = src->map( &sstride );
+		SIMD::instance()->prefixSum1_u8_to_u32( dst + table.stride + 1, table.stride, s, sstride, w, h );
+		src->unmap( s );
+	}
+}
@@ -0,0 +1,87 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_INTEGRAL_PYRAMID_H
+#define CVT_INTEGRAL_PYRAMID_H
+
+#include <cvt/gfx/Image.h>
+#include <cvt/vision/ImagePyramid.h>
+
+#include <vector>
+
+namespace cvt
+{
+	/**
+	  \brief Exact uint32 summed area tables of all octaves of a pyramid.
+
+	  Every table has a leading zero row and column, entry ( x, y ) holds the sum of all
+	  pixels left of and above pixel ( x, y ). Box sums are exact for any image size since
+	  the unsigned wrap-around cancels. The memory is kept across updates, so the tables
+	  can be cached and shared between consumers of the same pyramid.
+	  Non GRAY_UINT8 input is converted to GRAY_UINT8 first.
+	 */
+	class IntegralPyramid
+	{
+		public:
+			IntegralPyramid();
+
+			void			update( const ImagePyramid& pyr );
+			void			update( const Image& img );
+
+			size_t			octaves() const						{ return _octaves; }
+			float			scaleFactor() const					{ return _scaleFactor; }
+
+			size_t			width( size_t octave ) const		{ return _tables[ octave ].width; }
+			size_t			height( size_t octave ) const		{ return _tables[ octave ].height; }
+			/* in elements */
+			size_t			stride( size_t octave ) const		{ return _tables[ octave ].stride; }
+			const uint32_t*	table( size_t octave ) const		{ return &_tables[ octave ].data[ 0 ]; }
+
+			/* sum of the w x h pixels starting at ( x, y ) */
+			uint32_t		area( size_t octave, size_t x, size_t y, size_t w, size_t h ) const;
+
+		private:
+			struct Table {
+				std::vector<uint32_t>	data;
+				size_t					width;
+				size_t					height;
+				size_t					stride;
+			};
+
+			void updateTable( Table& table, const Image& img );
+
+			std::vector<Table>	_tables;
+			size_t				_octaves;
+			float				_scaleFactor;
+	};
+
+	inline uint32_t IntegralPyramid::area( size_t octave, size_t x, size_t y, size_t w, size_t h ) const
+	{
+		const size_t stride = _tables[ octave ].stride;
+		const uint32_t* p = table( octave ) + y * stride + x;
+		return p[ 0 ] - p[ w ] - p[ h * stride ] + p[ h * stride + w ];
+	}
+}
+
+#endif
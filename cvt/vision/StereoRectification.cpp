@@ -28,29 +28,72 @@
 namespace cvt {
 
 	StereoRectification::StereoRectification( const CameraCalibration& left,
-											  const CameraCalibration& right )
+											  const CameraCalibration& right ) :
+		_calibration( left, right )
 	{
-		StereoCameraCalibration scalib( left, right );
-		size_t w = 0;
-		size_t h = 0;
-		//_leftWarp.re
-		scalib.undistortRectify( _rectifiedCalibration, _leftWarp, _rightWarp, w, h );
+		Image leftWarp, rightWarp;
+		_calibration.undistortRectify( _rectifiedCalibration, leftWarp, rightWarp, 0, 0 );
+		_leftTable.set( leftWarp );
+		_rightTable.set( rightWarp );
 	}
 
 	StereoRectification::StereoRectification( const StereoRectification& other ):
+		_calibration( other._calibration ),
 		_rectifiedCalibration( other._rectifiedCalibration ),
-		_leftWarp( other._leftWarp ),
-		_rightWarp( other._rightWarp )
-	{}
+		_leftTable( other._leftTable ),
+		_rightTable( other._rightTable )
+	{
+		ScopeLock lock( &other._warpMutex );
+		if( other._leftWarp.width() ) {
+			_leftWarp = other._leftWarp;
+			_rightWarp = other._rightWarp;
+		}
+	}
+
+	const Image& StereoRectification::floatWarp( bool left ) const
+	{
+		ScopeLock lock( &_warpMutex );
+		if( !_leftWarp.width() ) {
+			StereoCameraCalibration rectified;
+			_calibration.undistortRectify( rectified, _leftWarp, _rightWarp, 0, 0 );
+		}
+		return left ? _leftWarp : _rightWarp;
+	}
+
+	bool StereoRectification::useTable( const Image& in )
+	{
+		switch( in.format().formatID ) {
+			case IFORMAT_GRAY_UINT8:
+			case IFORMAT_RGBA_UINT8:
+			case IFORMAT_BGRA_UINT8: return true;
+			default: return false;
+		}
+	}
 
 	void StereoRectification::undistortLeft( Image& out, const Image& in ) const
 	{
-		IWarp::apply( out, in, _leftWarp );
+		if( useTable( in ) )
+			IWarp::apply( out, in, _leftTable );
+		else
+			IWarp::apply( out, in, floatWarp( true ) );
 	}
 
 	void StereoRectification::undistortRight( Image& out, const Image& in ) const
 	{
-		IWarp::apply( out, in, _rightWarp );
+		if( useTable( in ) )
+			IWarp::apply( out, in, _rightTable );
+		else
+			IWarp::apply( out, in, floatWarp( false ) );
+	}
+
+	void StereoRectification::undistortLeft( Image& out, Image& outHalf, const Image& in ) const
+	{
+		IWarp::applyPyrdown( out, outHalf, in, _leftTable );
+	}
+
+	void StereoRectification::undistortRight( Image& out, Image& outHalf, const Image& in ) const
+	{
+		IWarp::applyPyrdown( out, outHalf, in, _rightTable );
 	}
 
 }
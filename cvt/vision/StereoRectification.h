@@ -26,9 +26,18 @@
 #define CVT_STEREO_RECTIFICATION_H
 
 #include <cvt/vision/StereoCameraCalibration.h>
+#include <cvt/gfx/ifilter/IWarpTable.h>
+#include <cvt/util/Mutex.h>
 
 namespace cvt {
 
+	/**
+	  @brief Undistortion and rectification of stereo image pairs.
+
+	  GRAY_UINT8, RGBA_UINT8 and BGRA_UINT8 images are warped with the fixed-point IWarpTable, the
+	  bilinear weights then only have IWarpTable::FRACTION_BITS ( 5 ) bits, i.e. 1/32 pixel, of
+	  precision. All other formats use the float warp, which is only computed on first use.
+	 */
 	class StereoRectification {
 		public:
 			StereoRectification( const CameraCalibration& left, const CameraCalibration& right );
@@ -37,10 +46,23 @@ namespace cvt {
 			void undistortLeft( Image& out, const Image& in ) const;
 			void undistortRight( Image& out, const Image& in ) const;
 
+			/* GRAY_UINT8 only: rectify and create the half resolution pyramid level in one pass */
+			void undistortLeft( Image& out, Image& outHalf, const Image& in ) const;
+			void undistortRight( Image& out, Image& outHalf, const Image& in ) const;
+
 		private:
+			StereoCameraCalibration _calibration;
 			StereoCameraCalibration _rectifiedCalibration;
-			Image	_leftWarp;
-			Image	_rightWarp;
+			IWarpTable _leftTable;
+			IWarpTable _rightTable;
+
+			/* float warps, empty until an image without fixed-point path is rectified */
+			mutable Image	_leftWarp;
+			mutable Image	_rightWarp;
+			mutable Mutex	_warpMutex;
+
+			const Image& floatWarp( bool left ) const;
+			static bool useTable( const Image& in );
 	};
 
 }
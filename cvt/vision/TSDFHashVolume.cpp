@@ -0,0 +1,689 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/vision/TSDFHashVolume.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/geom/MarchingCubes.h>
+#include <cvt/util/Exception.h>
+#include <cvt/util/ParallelFor.h>
+#include <cvt/util/SIMD.h>
+
+#include <math.h>
+
+namespace cvt
+{
+	static inline int _brickCoord( int v )
+	{
+		return v >= 0 ? v / TSDFHashVolume::BRICK_SIZE : -( ( -v + TSDFHashVolume::BRICK_SIZE - 1 ) / TSDFHashVolume::BRICK_SIZE );
+	}
+
+	TSDFHashVolume::TSDFHashVolume( float voxelsize, float truncation, const String& swapfile ) :
+		_voxelsize( voxelsize ),
+		_trunc( truncation ),
+		_numEntries( 0 ),
+		_numBricks( 0 ),
+		_swappath( swapfile ),
+		_swapfile( NULL ),
+		_swapend( 0 )
+	{
+		clear();
+	}
+
+	TSDFHashVolume::~TSDFHashVolume()
+	{
+		if( _swapfile ) {
+			fclose( _swapfile );
+			remove( _swappath.c_str() );
+		}
+	}
+
+	void TSDFHashVolume::clear()
+	{
+		HashEntry empty;
+		empty.key.x = empty.key.y = empty.key.z = 0;
+		empty.brick = -1;
+		_table.assign( 4096, empty );
+		_numEntries = 0;
+
+		_data.clear();
+		_keys.clear();
+		_used.clear();
+		_free.clear();
+		_numBricks = 0;
+
+		_bmin.x = _bmin.y = _bmin.z = 1;
+		_bmax.x = _bmax.y = _bmax.z = 0;
+
+		_swapped.clear();
+		_swapfree.clear();
+		_swapend = 0;
+	}
+
+	inline size_t TSDFHashVolume::hash( const BrickKey& key ) const
+	{
+		return ( ( uint32_t ) key.x * 73856093u ^ ( uint32_t ) key.y * 19349669u ^ ( uint32_t ) key.z * 83492791u ) & ( _table.size() - 1 );
+	}
+
+	int TSDFHashVolume::findBrick( const BrickKey& key ) const
+	{
+		size_t mask = _table.size() - 1;
+		size_t i = hash( key );
+		while( _table[ i ].brick >= 0 ) {
+			if( _table[ i ].key == key )
+				return _table[ i ].brick;
+			i = ( i + 1 ) & mask;
+		}
+		return -1;
+	}
+
+	void TSDFHashVolume::insertEntry( const BrickKey& key, int brick )
+	{
+		if( ( _numEntries + 1 ) * 2 > _table.size() )
+			resizeTable( _table.size() * 2 );
+
+		size_t mask = _table.size() - 1;
+		size_t i = hash( key );
+		while( _table[ i ].brick >= 0 )
+			i = ( i + 1 ) & mask;
+		_table[ i ].key = key;
+		_table[ i ].brick = brick;
+		_numEntries++;
+	}
+
+	void TSDFHashVolume::removeEntry( const BrickKey& key )
+	{
+		size_t mask = _table.size() - 1;
+		size_t i = hash( key );
+		while( !( _table[ i ].key == key ) ) {
+			if( _table[ i ].brick < 0 )
+				return;
+			i = ( i + 1 ) & mask;
+		}
+
+		/* backward shift deletion, keeps the probe sequences intact without tombstones */
+		size_t j = i;
+		while( true ) {
+			j = ( j + 1 ) & mask;
+			if( _table[ j ].brick < 0 )
+				break;
+			size_t k = hash( _table[ j ].key );
+			if( ( j > i && ( k <= i || k > j ) ) || ( j < i && ( k <= i && k > j ) ) ) {
+				_table[ i ] = _table[ j ];
+				i = j;
+			}
+		}
+		_table[ i ].brick = -1;
+		_numEntries--;
+	}
+
+	void TSDFHashVolume::resizeTable( size_t size )
+	{
+		std::vector<HashEntry> old;
+		old.swap( _table );
+
+		HashEntry empty;
+		empty.key.x = empty.key.y = empty.key.z = 0;
+		empty.brick = -1;
+		_table.assign( size, empty );
+		_numEntries = 0;
+
+		for( size_t i = 0; i < old.size(); i++ ) {
+			if( old[ i ].brick >= 0 )
+				insertEntry( old[ i ].key, old[ i ].brick );
+		}
+	}
+
+	int TSDFHashVolume::allocateBrick( const BrickKey& key )
+	{
+		int brick;
+		if( !_free.empty() ) {
+			brick = _free.back();
+			_free.pop_back();
+		} else {
+			brick = ( int ) _keys.size();
+			_keys.push_back( key );
+			_used.push_back( 0 );
+			_data.resize( _data.size() + BRICK_VOXELS * 2 );
+		}
+		_keys[ brick ] = key;
+		_used[ brick ] = 1;
+		_numBricks++;
+		insertEntry( key, brick );
+
+		if( _bmin.x > _bmax.x ) {
+			_bmin = _bmax = key;
+		} else {
+			_bmin.x = Math::min( _bmin.x, key.x );
+			_bmin.y = Math::min( _bmin.y, key.y );
+			_bmin.z = Math::min( _bmin.z, key.z );
+			_bmax.x = Math::max( _bmax.x, key.x );
+			_bmax.y = Math::max( _bmax.y, key.y );
+			_bmax.z = Math::max( _bmax.z, key.z );
+		}
+
+		float* data = brickData( brick );
+		if( _swapped.count( key ) ) {
+			swapIn( key, data );
+		} else {
+			for( size_t i = 0; i < BRICK_VOXELS; i++ ) {
+				*data++ = 1.0f;
+				*data++ = 0.0f;
+			}
+		}
+		return brick;
+	}
+
+	void TSDFHashVolume::releaseBrick( int brick )
+	{
+		removeEntry( _keys[ brick ] );
+		_used[ brick ] = 0;
+		_free.push_back( brick );
+		_numBricks--;
+	}
+
+	const float* TSDFHashVolume::voxel( int x, int y, int z ) const
+	{
+		BrickKey key = { _brickCoord( x ), _brickCoord( y ), _brickCoord( z ) };
+		int brick = findBrick( key );
+		if( brick < 0 )
+			return NULL;
+		x -= key.x * BRICK_SIZE;
+		y -= key.y * BRICK_SIZE;
+		z -= key.z * BRICK_SIZE;
+		return brickData( brick ) + 2 * ( ( z * BRICK_SIZE + y ) * BRICK_SIZE + x );
+	}
+
+	Vector3f TSDFHashVolume::brickCenter( const BrickKey& key ) const
+	{
+		float s = _voxelsize * ( float ) BRICK_SIZE;
+		return Vector3f( ( ( float ) key.x + 0.5f ) * s, ( ( float ) key.y + 0.5f ) * s, ( ( float ) key.z + 0.5f ) * s );
+	}
+
+	void TSDFHashVolume::swapOut( int brick )
+	{
+		if( !_swapfile ) {
+			if( _swappath.isEmpty() )
+				throw CVTException( "TSDFHashVolume: no swap file specified" );
+			_swapfile = fopen( _swappath.c_str(), "w+b" );
+			if( !_swapfile ) {
+				String msg( "TSDFHashVolume: unable to open swap file " );
+				msg += _swappath;
+				throw CVTException( msg.c_str() );
+			}
+		}
+
+		long offset;
+		if( !_swapfree.empty() ) {
+			offset = _swapfree.back();
+			_swapfree.pop_back();
+		} else {
+			offset = _swapend;
+			_swapend += sizeof( float ) * BRICK_VOXELS * 2;
+		}
+
+		if( fseek( _swapfile, offset, SEEK_SET ) ||
+			fwrite( brickData( brick ), sizeof( float ), BRICK_VOXELS * 2, _swapfile ) != BRICK_VOXELS * 2 )
+			throw CVTException( "TSDFHashVolume: writing to swap file failed" );
+
+		_swapped[ _keys[ brick ] ] = offset;
+		releaseBrick( brick );
+	}
+
+	void TSDFHashVolume::swapIn( const BrickKey& key, float* data )
+	{
+		std::map<BrickKey, long>::iterator it = _swapped.find( key );
+
+		fflush( _swapfile );
+		if( fseek( _swapfile, it->second, SEEK_SET ) ||
+			fread( data, sizeof( float ), BRICK_VOXELS * 2, _swapfile ) != BRICK_VOXELS * 2 )
+			throw CVTException( "TSDFHashVolume: reading from swap file failed" );
+
+		_swapfree.push_back( it->second );
+		_swapped.erase( it );
+	}
+
+	size_t TSDFHashVolume::streamOut( const Vector3f& center, float radius )
+	{
+		size_t n = 0;
+		for( size_t i = 0; i < _keys.size(); i++ ) {
+			if( _used[ i ] && ( brickCenter( _keys[ i ] ) - center ).length() > radius ) {
+				swapOut( ( int ) i );
+				n++;
+			}
+		}
+		return n;
+	}
+
+	size_t TSDFHashVolume::streamIn( const Vector3f& center, float radius )
+	{
+		std::vector<BrickKey> keys;
+		for( std::map<BrickKey, long>::const_iterator it = _swapped.begin(); it != _swapped.end(); ++it ) {
+			if( ( brickCenter( it->first ) - center ).length() <= radius )
+				keys.push_back( it->first );
+		}
+
+		for( size_t i = 0; i < keys.size(); i++ )
+			allocateBrick( keys[ i ] );
+		return keys.size();
+	}
+
+	class TSDFHashAddBody {
+		public:
+			TSDFHashAddBody( TSDFHashVolume& vol, const std::vector<int>& bricks, const Matrix4f& g2cam,
+							 const uint8_t* dmap, size_t dstride, size_t dwidth, size_t dheight, float scale ) :
+				_vol( vol ), _bricks( bricks ), _dmap( dmap ), _dstride( dstride ), _dwidth( dwidth ), _dheight( dheight ), _scale( scale )
+			{
+				for( int i = 0; i < 4; i++ )
+					for( int k = 0; k < 4; k++ )
+						_m[ i ][ k ] = g2cam[ i ][ k ];
+			}
+
+			void operator()( const Range<size_t>& r ) const
+			{
+				const int B = TSDFHashVolume::BRICK_SIZE;
+				SIMD* simd = SIMD::instance();
+				/* voxel ( x0 + lx, y, z ) is at camera position pos + lx * step */
+				float step[ 3 ] = { _m[ 0 ][ 0 ], _m[ 1 ][ 0 ], _m[ 2 ][ 0 ] };
+				float pos[ 3 ];
+
+				for( size_t b = r.min; b < r.max; b++ ) {
+					const TSDFHashVolume::BrickKey& key = _vol._keys[ _bricks[ b ] ];
+					float* ptr = _vol.brickData( _bricks[ b ] );
+					float x0 = ( float ) ( key.x * B );
+
+					for( int lz = 0; lz < B; lz++ ) {
+						float z = ( float ) ( key.z * B + lz );
+						for( int ly = 0; ly < B; ly++, ptr += 2 * B ) {
+							float y = ( float ) ( key.y * B + ly );
+							for( int i = 0; i < 3; i++ )
+								pos[ i ] = _m[ i ][ 0 ] * x0 + _m[ i ][ 1 ] * y + _m[ i ][ 2 ] * z + _m[ i ][ 3 ];
+							simd->tsdfFuse( ptr, pos, step, ( const float* ) _dmap, _dstride, _dwidth, _dheight, _scale, _vol._trunc, B );
+						}
+					}
+				}
+			}
+
+		private:
+			TSDFHashVolume&			_vol;
+			const std::vector<int>& _bricks;
+			float					_m[ 4 ][ 4 ];
+			const uint8_t*			_dmap;
+			size_t					_dstride, _dwidth, _dheight;
+			float					_scale;
+	};
+
+	void TSDFHashVolume::addDepthMap( const Matrix3f& intrinsics, const Matrix4f& extrinsics, const Image& depthmap, float scale )
+	{
+		Matrix4f proj = intrinsics.toMatrix4();
+		proj *= extrinsics;
+		addDepthMap( proj, depthmap, scale );
+	}
+
+	void TSDFHashVolume::addDepthMap( const Matrix4f& proj, const Image& depthmap, float scale )
+	{
+		Matrix4f g2w;
+		g2w.setIdentity();
+		g2w[ 0 ][ 0 ] = g2w[ 1 ][ 1 ] = g2w[ 2 ][ 2 ] = _voxelsize;
+		Matrix4f projall = proj * g2w;
+		Matrix4f cam2g = projall.inverse();
+
+		Image tmp;
+		const Image* dimg = &depthmap;
+		if( depthmap.format() != IFormat::GRAY_FLOAT ) {
+			depthmap.convert( tmp, IFormat::GRAY_FLOAT );
+			dimg = &tmp;
+		}
+		IMapScoped<const float> map( *dimg );
+
+		/*
+		   allocate all bricks intersected by the truncation band of the depth samples,
+		   the band is sampled with voxel spacing along each pixel ray
+		 */
+		std::vector<int> bricks;
+		std::vector<uint8_t> visible( _keys.size(), 0 );
+		for( size_t y = 0; y < dimg->height(); y++ ) {
+			const float* dptr = map.line( y );
+			for( size_t x = 0; x < dimg->width(); x++ ) {
+				float d = dptr[ x ] * scale;
+				if( !( d > 0.0f ) )
+					continue;
+				float dnear = Math::max( d - _trunc, 1e-3f * d );
+				float dfar = d + _trunc;
+				float u = ( float ) x + 0.5f;
+				float v = ( float ) y + 0.5f;
+				Vector4f p0 = cam2g * Vector4f( u * dnear, v * dnear, dnear, 1.0f );
+				Vector4f p1 = cam2g * Vector4f( u * dfar, v * dfar, dfar, 1.0f );
+				Vector3f start( p0.x, p0.y, p0.z );
+				Vector3f delta( p1.x - p0.x, p1.y - p0.y, p1.z - p0.z );
+				size_t n = ( size_t ) Math::ceil( delta.length() ) + 1;
+				delta /= ( float ) n;
+
+				BrickKey last = { 0, 0, 0 };
+				for( size_t i = 0; i <= n; i++ ) {
+					Vector3f p = start + delta * ( float ) i;
+					BrickKey key = { _brickCoord( ( int ) Math::floor( p.x ) ),
+									 _brickCoord( ( int ) Math::floor( p.y ) ),
+									 _brickCoord( ( int ) Math::floor( p.z ) ) };
+					if( i && key == last )
+						continue;
+					last = key;
+
+					int brick = findBrick( key );
+					if( brick < 0 )
+						brick = allocateBrick( key );
+					if( ( size_t ) brick >= visible.size() )
+						visible.resize( _keys.size(), 0 );
+					if( !visible[ brick ] ) {
+						visible[ brick ] = 1;
+						bricks.push_back( brick );
+					}
+				}
+			}
+		}
+
+		TSDFHashAddBody body( *this, bricks, projall, ( const uint8_t* ) map.ptr(), map.stride(),
+							  dimg->width(), dimg->height(), scale );
+		parallelFor( Range<size_t>( 0, bricks.size() ), body, 4 );
+	}
+
+	class TSDFHashRayCastBody {
+		public:
+			TSDFHashRayCastBody( const TSDFHashVolume& vol, const Matrix4f& cam2g, const Matrix4f& g2cam,
+								 uint8_t* dst, size_t dstride, size_t dwidth, float scale ) :
+				_vol( vol ), _cam2g( cam2g ), _g2cam( g2cam ), _dst( dst ), _dstride( dstride ), _dwidth( dwidth ), _scale( scale )
+			{
+				const int B = TSDFHashVolume::BRICK_SIZE;
+				_min.set( ( float ) ( vol._bmin.x * B ), ( float ) ( vol._bmin.y * B ), ( float ) ( vol._bmin.z * B ) );
+				_max.set( ( float ) ( ( vol._bmax.x + 1 ) * B ), ( float ) ( ( vol._bmax.y + 1 ) * B ), ( float ) ( ( vol._bmax.z + 1 ) * B ) );
+			}
+
+			void operator()( const Range<size_t>& r ) const
+			{
+				Vector3f origin( _cam2g[ 0 ][ 3 ], _cam2g[ 1 ][ 3 ], _cam2g[ 2 ][ 3 ] );
+				for( size_t y = r.min; y < r.max; y++ ) {
+					float* out = ( float* ) ( _dst + y * _dstride );
+					for( size_t x = 0; x < _dwidth; x++ )
+						out[ x ] = rayCast( origin, ( float ) x, ( float ) y );
+				}
+			}
+
+		private:
+			struct Cache {
+				TSDFHashVolume::BrickKey key;
+				const float*			 data;
+				bool					 valid;
+			};
+
+			const float* lookup( int x, int y, int z, Cache& cache ) const
+			{
+				const int B = TSDFHashVolume::BRICK_SIZE;
+				TSDFHashVolume::BrickKey key = { _brickCoord( x ), _brickCoord( y ), _brickCoord( z ) };
+				if( !cache.valid || !( key == cache.key ) ) {
+					int brick = _vol.findBrick( key );
+					cache.key = key;
+					cache.data = brick < 0 ? NULL : _vol.brickData( brick );
+					cache.valid = true;
+				}
+				if( !cache.data )
+					return NULL;
+				return cache.data + 2 * ( ( ( z - key.z * B ) * B + ( y - key.y * B ) ) * B + ( x - key.x * B ) );
+			}
+
+			/* trilinear interpolation, fails if a voxel is missing or was never observed */
+			bool value( float& val, const Vector3f& pos, Cache& cache ) const
+			{
+				float bx = Math::floor( pos.x );
+				float by = Math::floor( pos.y );
+				float bz = Math::floor( pos.z );
+				float ax = pos.x - bx;
+				float ay = pos.y - by;
+				float az = pos.z - bz;
+				int ix = ( int ) bx, iy = ( int ) by, iz = ( int ) bz;
+
+				float vals[ 8 ];
+				for( int i = 0; i < 8; i++ ) {
+					const float* v = lookup( ix + ( i & 1 ), iy + ( ( i >> 1 ) & 1 ), iz + ( i >> 2 ), cache );
+					if( !v || v[ 1 ] < 1.0f )
+						return false;
+					vals[ i ] = v[ 0 ];
+				}
+				float z0 = Math::mix( vals[ 0 ], vals[ 4 ], az );
+				float z1 = Math::mix( vals[ 1 ], vals[ 5 ], az );
+				float z2 = Math::mix( vals[ 2 ], vals[ 6 ], az );
+				float z3 = Math::mix( vals[ 3 ], vals[ 7 ], az );
+				float y0 = Math::mix( z0, z2, ay );
+				float y1 = Math::mix( z1, z3, ay );
+				val = Math::mix( y0, y1, ax );
+				return true;
+			}
+
+			/* distance along the ray to the exit of the brick containing pos */
+			float brickExit( const Vector3f& pos, const Vector3f& dir ) const
+			{
+				const int B = TSDFHashVolume::BRICK_SIZE;
+				float t = INFINITY;
+				for( int i = 0; i < 3; i++ ) {
+					float lo = ( float ) ( _brickCoord( ( int ) Math::floor( pos[ i ] ) ) * B );
+					if( dir[ i ] > 0.0f )
+						t = fminf( t, ( lo + B - pos[ i ] ) / dir[ i ] );
+					else if( dir[ i ] < 0.0f )
+						t = fminf( t, ( lo - pos[ i ] ) / dir[ i ] );
+				}
+				return t;
+			}
+
+			float rayCast( const Vector3f& origin, float x, float y ) const
+			{
+				Vector3f dir( _cam2g[ 0 ][ 0 ] * x + _cam2g[ 0 ][ 1 ] * y + _cam2g[ 0 ][ 2 ] + _cam2g[ 0 ][ 3 ],
+							  _cam2g[ 1 ][ 0 ] * x + _cam2g[ 1 ][ 1 ] * y + _cam2g[ 1 ][ 2 ] + _cam2g[ 1 ][ 3 ],
+							  _cam2g[ 2 ][ 0 ] * x + _cam2g[ 2 ][ 1 ] * y + _cam2g[ 2 ][ 2 ] + _cam2g[ 2 ][ 3 ] );
+				dir -= origin;
+				dir.normalize();
+
+				float start = -INFINITY, end = INFINITY;
+				for( int i = 0; i < 3; i++ ) {
+					start = fmaxf( start, ( ( dir[ i ] >= 0.0f ? _min[ i ] : _max[ i ] ) - origin[ i ] ) / dir[ i ] );
+					end = fminf( end, ( ( dir[ i ] >= 0.0f ? _max[ i ] : _min[ i ] ) - origin[ i ] ) / dir[ i ] );
+				}
+				start = fmaxf( start, 0.0f );
+
+				if( !( start < end ) || !Math::isFinite( end ) ||
+					!Math::isFinite( dir.x ) || !Math::isFinite( dir.y ) || !Math::isFinite( dir.z ) )
+					return 0.0f;
+
+				const float truncgrid = _vol._trunc / _vol._voxelsize;
+				Cache cache;
+				cache.key = _vol._bmin;
+				cache.data = NULL;
+				cache.valid = false;
+
+				bool prevValid = false;
+				float valPrev = 0.0f;
+				Vector3f posPrev( origin );
+				float lambda = start;
+				while( lambda <= end ) {
+					Vector3f pos = origin + dir * lambda;
+
+					if( !lookup( ( int ) Math::floor( pos.x ), ( int ) Math::floor( pos.y ), ( int ) Math::floor( pos.z ), cache ) ) {
+						/* empty space, skip the whole brick */
+						lambda += brickExit( pos, dir ) + 1e-3f;
+						prevValid = false;
+						continue;
+					}
+
+					float val;
+					if( !value( val, pos, cache ) ) {
+						lambda += 0.5f;
+						prevValid = false;
+						continue;
+					}
+
+					if( prevValid ) {
+						if( valPrev < 0.0f && val > 0.0f )
+							break;
+
+						if( valPrev > 0.0f && val <= 0.0f ) {
+							float alpha = -val / ( valPrev - val );
+							Vector3f g = pos + ( posPrev - pos ) * alpha;
+							float z = _g2cam[ 2 ][ 0 ] * g.x + _g2cam[ 2 ][ 1 ] * g.y + _g2cam[ 2 ][ 2 ] * g.z + _g2cam[ 2 ][ 3 ];
+							return Math::max( z * _scale, 0.0f );
+						}
+					}
+
+					valPrev = val;
+					posPrev = pos;
+					prevValid = true;
+					/* the surface is at least about val * truncation away */
+					lambda += Math::max( 0.5f, 0.8f * val * truncgrid );
+				}
+				return 0.0f;
+			}
+
+			const TSDFHashVolume&	_vol;
+			Matrix4f				_cam2g, _g2cam;
+			Vector3f				_min, _max;
+			uint8_t*				_dst;
+			size_t					_dstride, _dwidth;
+			float					_scale;
+	};
+
+	void TSDFHashVolume::rayCastDepthMap( Image& depthmap, const Matrix3f& intrinsics, const Matrix4f& extrinsics, float scale )
+	{
+		Matrix4f proj = intrinsics.toMatrix4();
+		proj *= extrinsics;
+		rayCastDepthMap( depthmap, proj, scale );
+	}
+
+	void TSDFHashVolume::rayCastDepthMap( Image& depthmap, const Matrix4f& proj, float scale )
+	{
+		depthmap.reallocate( depthmap.width(), depthmap.height(), IFormat::GRAY_FLOAT );
+
+		if( _bmin.x > _bmax.x ) {
+			depthmap.fill( Color( 0.0f ) );
+			return;
+		}
+
+		Matrix4f g2w;
+		g2w.setIdentity();
+		g2w[ 0 ][ 0 ] = g2w[ 1 ][ 1 ] = g2w[ 2 ][ 2 ] = _voxelsize;
+		Matrix4f projall = proj * g2w;
+
+		IMapScoped<float> map( depthmap );
+		TSDFHashRayCastBody body( *this, projall.inverse(), projall, ( uint8_t* ) map.ptr(), map.stride(), depthmap.width(), scale );
+		parallelFor( Range<size_t>( 0, depthmap.height() ), body );
+	}
+
+	class TSDFHashMeshBody {
+		public:
+			/* dense copy of a brick with a one voxel border in front and two behind, as needed by MarchingCubes */
+			enum { DENSE_SIZE = TSDFHashVolume::BRICK_SIZE + 3 };
+
+			TSDFHashMeshBody( const TSDFHashVolume& vol, std::vector<SceneMesh*>& meshes, float minweight ) :
+				_vol( vol ), _meshes( meshes ), _minweight( minweight )
+			{
+			}
+
+			void operator()( const Range<size_t>& r ) const
+			{
+				const int B = TSDFHashVolume::BRICK_SIZE;
+				std::vector<float> dense( DENSE_SIZE * DENSE_SIZE * DENSE_SIZE * 2 );
+
+				for( size_t b = r.min; b < r.max; b++ ) {
+					if( !_vol._used[ b ] || !hasWeight( _vol.brickData( ( int ) b ) ) )
+						continue;
+
+					const TSDFHashVolume::BrickKey& key = _vol._keys[ b ];
+					int x0 = key.x * B - 1;
+					int y0 = key.y * B - 1;
+					int z0 = key.z * B - 1;
+					float* dst = &dense[ 0 ];
+					for( int z = 0; z < DENSE_SIZE; z++ ) {
+						for( int y = 0; y < DENSE_SIZE; y++ ) {
+							for( int x = 0; x < DENSE_SIZE; x++ ) {
+								const float* v = _vol.voxel( x0 + x, y0 + y, z0 + z );
+								*dst++ = v ? v[ 0 ] : 1.0f;
+								*dst++ = v ? v[ 1 ] : 0.0f;
+							}
+						}
+					}
+
+					SceneMesh* mesh = new SceneMesh( "brick" );
+					MarchingCubes mc( &dense[ 0 ], DENSE_SIZE, DENSE_SIZE, DENSE_SIZE, true, _minweight );
+					mc.triangulateWithNormals( *mesh, 0.0f );
+					if( !mesh->isEmpty() ) {
+						mesh->translate( Vector3f( ( float ) x0, ( float ) y0, ( float ) z0 ) );
+						mesh->scale( _vol._voxelsize );
+					}
+					_meshes[ b ] = mesh;
+				}
+			}
+
+		private:
+			bool hasWeight( const float* data ) const
+			{
+				for( size_t i = 0; i < TSDFHashVolume::BRICK_VOXELS; i++ ) {
+					if( data[ 2 * i + 1 ] > _minweight )
+						return true;
+				}
+				return false;
+			}
+
+			const TSDFHashVolume&	  _vol;
+			std::vector<SceneMesh*>&  _meshes;
+			float					  _minweight;
+	};
+
+	void TSDFHashVolume::toSceneMesh( SceneMesh& mesh ) const
+	{
+		std::vector<SceneMesh*> meshes( _keys.size(), ( SceneMesh* ) NULL );
+		/* same minimum weight as the MarchingCubes default used by TSDFVolume */
+		TSDFHashMeshBody body( *this, meshes, 20.0f );
+		parallelFor( Range<size_t>( 0, _keys.size() ), body, 16 );
+
+		std::vector<Vector3f> vertices;
+		std::vector<Vector3f> normals;
+		std::vector<unsigned int> faces;
+		for( size_t i = 0; i < meshes.size(); i++ ) {
+			SceneMesh* m = meshes[ i ];
+			if( !m )
+				continue;
+			if( !m->isEmpty() ) {
+				unsigned int offset = ( unsigned int ) vertices.size();
+				vertices.insert( vertices.end(), m->vertices(), m->vertices() + m->vertexSize() );
+				normals.insert( normals.end(), m->normals(), m->normals() + m->normalSize() );
+				const unsigned int* f = m->faces();
+				for( size_t k = 0; k < m->faceSize() * 3; k++ )
+					faces.push_back( f[ k ] + offset );
+			}
+			delete m;
+		}
+
+		mesh.clear();
+		if( vertices.empty() )
+			return;
+		mesh.setVertices( &vertices[ 0 ], vertices.size() );
+		mesh.setNormals( &normals[ 0 ], normals.size() );
+		mesh.setFaces( &faces[ 0 ], faces.size(), SCENEMESH_TRIANGLES );
+	}
+}
@@ -0,0 +1,144 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_TSDFHASHVOLUME_H
+#define CVT_TSDFHASHVOLUME_H
+
+#include <cvt/gfx/Image.h>
+#include <cvt/math/Matrix.h>
+#include <cvt/math/Vector.h>
+#include <cvt/util/String.h>
+#include <cvt/geom/scene/SceneMesh.h>
+
+#include <stdio.h>
+#include <map>
+#include <vector>
+
+namespace cvt
+{
+	/**
+	  Sparse truncated signed distance volume.
+
+	  The volume is unbounded and stored as bricks of BRICK_SIZE^3 voxels in an
+	  open-addressing hash table, bricks are only allocated inside the truncation
+	  band of the fused depth maps. Voxel ( 0, 0, 0 ) is at the world origin, the
+	  voxel grid is axis aligned with the world frame.
+
+	  Bricks can be swapped out to a file and are loaded again by streamIn or as soon
+	  as a fused depth map touches them.
+	 */
+	class TSDFHashVolume
+	{
+		public:
+			enum { BRICK_SIZE = 8,
+				   BRICK_VOXELS = BRICK_SIZE * BRICK_SIZE * BRICK_SIZE };
+
+			TSDFHashVolume( float voxelsize, float truncation = 0.1f, const String& swapfile = "" );
+			~TSDFHashVolume();
+
+			void clear();
+			void addDepthMap( const Matrix4f& proj, const Image& depthmap, float scale );
+			void addDepthMap( const Matrix3f& intrinsics, const Matrix4f& extrinsics, const Image& depthmap, float scale = 1.0f );
+
+			void rayCastDepthMap( Image& depthmap, const Matrix4f& proj, float scale );
+			void rayCastDepthMap( Image& depthmap, const Matrix3f& intrinsics, const Matrix4f& extrinsics, float scale = 1.0f );
+
+			/* vertices are in world coordinates, duplicate vertices along brick borders are not merged */
+			void toSceneMesh( SceneMesh& mesh ) const;
+
+			/* swap bricks farther than radius from center out to the swap file / load closer ones back */
+			size_t streamOut( const Vector3f& center, float radius );
+			size_t streamIn( const Vector3f& center, float radius );
+
+			float  voxelSize() const { return _voxelsize; }
+			float  truncation() const { return _trunc; }
+			size_t numBricks() const { return _numBricks; }
+			size_t numSwappedBricks() const { return _swapped.size(); }
+
+		private:
+			struct BrickKey {
+				int x, y, z;
+
+				bool operator==( const BrickKey& other ) const { return x == other.x && y == other.y && z == other.z; }
+				bool operator<( const BrickKey& other ) const
+				{
+					if( x != other.x ) return x < other.x;
+					if( y != other.y ) return y < other.y;
+					return z < other.z;
+				}
+			};
+
+			struct HashEntry {
+				BrickKey key;
+				int		 brick;
+			};
+
+			TSDFHashVolume( const TSDFHashVolume& );
+			TSDFHashVolume& operator=( const TSDFHashVolume& );
+
+			size_t		 hash( const BrickKey& key ) const;
+			int			 findBrick( const BrickKey& key ) const;
+			int			 allocateBrick( const BrickKey& key );
+			void		 releaseBrick( int brick );
+			void		 insertEntry( const BrickKey& key, int brick );
+			void		 removeEntry( const BrickKey& key );
+			void		 resizeTable( size_t size );
+
+			void		 swapOut( int brick );
+			void		 swapIn( const BrickKey& key, float* data );
+			Vector3f	 brickCenter( const BrickKey& key ) const;
+
+			float*		 brickData( int brick ) { return &_data[ ( size_t ) brick * BRICK_VOXELS * 2 ]; }
+			const float* brickData( int brick ) const { return &_data[ ( size_t ) brick * BRICK_VOXELS * 2 ]; }
+			const float* voxel( int x, int y, int z ) const;
+
+			float					_voxelsize;
+			float					_trunc;
+
+			std::vector<HashEntry>	_table;
+			size_t					_numEntries;
+
+			/* brick storage, interleaved tsdf and weight per voxel */
+			std::vector<float>		_data;
+			std::vector<BrickKey>	_keys;
+			std::vector<uint8_t>	_used;
+			std::vector<int>		_free;
+			size_t					_numBricks;
+
+			/* bounds of all bricks ever allocated, in brick coordinates */
+			BrickKey				_bmin, _bmax;
+
+			String					_swappath;
+			FILE*					_swapfile;
+			std::map<BrickKey, long> _swapped;
+			std::vector<long>		_swapfree;
+			long					_swapend;
+
+			friend class TSDFHashAddBody;
+			friend class TSDFHashRayCastBody;
+			friend class TSDFHashMeshBody;
+	};
+}
+
+#endif
@@ -0,0 +1,134 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/vision/TSDFHashVolume.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/geom/scene/SceneMesh.h>
+#include <cvt/util/CVTTest.h>
+
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace cvt;
+
+/* camera at ( 32, 32, -40 ) looking along +z, a plane at depth 60 is at world z = 20 */
+static void _tsdfHashSetup( Matrix3f& K, Matrix4f& T, Image& dmap )
+{
+	K.setIdentity();
+	K[ 0 ][ 0 ] = 50.0f;
+	K[ 1 ][ 1 ] = 50.0f;
+	K[ 0 ][ 2 ] = 32.0f;
+	K[ 1 ][ 2 ] = 32.0f;
+
+	T.setIdentity();
+	T[ 0 ][ 3 ] = -32.0f;
+	T[ 1 ][ 3 ] = -32.0f;
+	T[ 2 ][ 3 ] = 40.0f;
+
+	dmap.reallocate( 64, 64, IFormat::GRAY_FLOAT );
+	dmap.fill( Color( 60.0f ) );
+}
+
+static bool _tsdfHashCheckDepth( const Image& depth )
+{
+	bool ret = true;
+	IMapScoped<const float> map( depth );
+	for( size_t y = 8; y < 56; y++ ) {
+		const float* ptr = map.line( y );
+		for( size_t x = 8; x < 56; x++ )
+			ret &= Math::abs( ptr[ x ] - 60.0f ) < 0.5f;
+	}
+	return ret;
+}
+
+BEGIN_CVTTEST( TSDFHashVolume )
+	bool ret = true;
+	bool b;
+
+	Matrix3f K;
+	Matrix4f T;
+	Image dmap;
+	_tsdfHashSetup( K, T, dmap );
+
+	String swap;
+	swap.sprintf( "/tmp/cvt_tsdfhash_%d.swap", ( int ) getpid() );
+	{
+		TSDFHashVolume vol( 1.0f, 4.0f, swap );
+
+		/* toSceneMesh only triangulates voxels with a weight above 20 */
+		for( int i = 0; i < 21; i++ )
+			vol.addDepthMap( K, T, dmap, 1.0f );
+
+		/* the band covers at most 12 x 12 bricks laterally and two in depth */
+		b = vol.numBricks() > 0 && vol.numBricks() <= 12 * 12 * 2;
+		CVTTEST_PRINT( "bricks only along the surface", b );
+		ret &= b;
+
+		Image depth( 64, 64, IFormat::GRAY_FLOAT );
+		vol.rayCastDepthMap( depth, K, T, 1.0f );
+		b = _tsdfHashCheckDepth( depth );
+		CVTTEST_PRINT( "fusion and raycast", b );
+		ret &= b;
+
+		SceneMesh mesh( "tsdf" );
+		vol.toSceneMesh( mesh );
+		b = mesh.vertexSize() > 0;
+		for( size_t i = 0; i < mesh.vertexSize(); i++ )
+			b &= Math::abs( mesh.vertex( i ).z - 20.0f ) < 0.1f;
+		CVTTEST_PRINT( "toSceneMesh", b );
+		ret &= b;
+
+		size_t nbricks = vol.numBricks();
+		Vector3f far( 10000.0f, 0.0f, 0.0f );
+		b = vol.streamOut( far, 10.0f ) == nbricks;
+		b &= vol.numBricks() == 0 && vol.numSwappedBricks() == nbricks;
+		vol.rayCastDepthMap( depth, K, T, 1.0f );
+		{
+			IMapScoped<const float> map( depth );
+			b &= map.line( 32 )[ 32 ] == 0.0f;
+		}
+		b &= vol.streamIn( Vector3f( 32.0f, 32.0f, 20.0f ), 1000.0f ) == nbricks;
+		b &= vol.numBricks() == nbricks && vol.numSwappedBricks() == 0;
+		vol.rayCastDepthMap( depth, K, T, 1.0f );
+		b &= _tsdfHashCheckDepth( depth );
+		CVTTEST_PRINT( "streaming", b );
+		ret &= b;
+
+		/* bricks swapped out are reloaded when new data touches them */
+		vol.streamOut( far, 10.0f );
+		vol.addDepthMap( K, T, dmap, 1.0f );
+		b = vol.numBricks() == nbricks && vol.numSwappedBricks() == 0;
+		vol.rayCastDepthMap( depth, K, T, 1.0f );
+		b &= _tsdfHashCheckDepth( depth );
+		CVTTEST_PRINT( "reload on fusion", b );
+		ret &= b;
+	}
+
+	b = access( swap.c_str(), F_OK ) != 0;
+	unlink( swap.c_str() );
+	CVTTEST_PRINT( "swap file removed", b );
+	ret &= b;
+
+	return ret;
+END_CVTTEST
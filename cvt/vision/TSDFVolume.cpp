@@ -24,37 +24,71 @@
 
 #include <cvt/vision/TSDFVolume.h>
 #include <cvt/cl/kernel/TSDFVolume/TSDFVolume.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/util/ParallelFor.h>
+#include <cvt/util/SIMD.h>
+
+#include <math.h>
 
 namespace cvt
 {
 
-	TSDFVolume::TSDFVolume( const Matrix4f& gridtoworld, size_t width, size_t height, size_t depth, float truncation ) :
+	TSDFVolume::TSDFVolume( const Matrix4f& gridtoworld, size_t width, size_t height, size_t depth, float truncation, TSDFVolumeBackend backend ) :
 		_width( width ),
 		_height( height ),
 		_depth( depth ),
 		_trunc( truncation ),
 		_g2w( gridtoworld ),
-		_clvolume( sizeof( cl_float2 ) * width * height * depth ),
-		_clproj( sizeof( float ) * 12 ),
-		_clvolclear( _TSDFVolume_source, "TSDFVolume_clear" ),
-		_clvoladd( _TSDFVolume_source, "TSDFVolume_add" ),
-		_clsliceX( _TSDFVolume_source, "TSDFVolume_sliceX"),
-		_clsliceY( _TSDFVolume_source, "TSDFVolume_sliceY"),
-		_clsliceZ( _TSDFVolume_source, "TSDFVolume_sliceZ"),
-		_clraycastdepth( _TSDFVolume_source, "TSDFVolume_rayCastDepthmap" )
+		_backend( backend ),
+		_volume( NULL ),
+		_clvolume( NULL ),
+		_clvolclear( NULL ),
+		_clvoladd( NULL ),
+		_clsliceX( NULL ),
+		_clsliceY( NULL ),
+		_clsliceZ( NULL ),
+		_clraycastdepth( NULL )
+	{
+		if( _backend == TSDFVOLUME_CPU ) {
+			_volume = new float[ 2 * width * height * depth ];
+		} else {
+			_clvolume = new CLBuffer( sizeof( cl_float2 ) * width * height * depth );
+			_clvolclear = new CLKernel( _TSDFVolume_source, "TSDFVolume_clear" );
+			_clvoladd = new CLKernel( _TSDFVolume_source, "TSDFVolume_add" );
+			_clsliceX = new CLKernel( _TSDFVolume_source, "TSDFVolume_sliceX" );
+			_clsliceY = new CLKernel( _TSDFVolume_source, "TSDFVolume_sliceY" );
+			_clsliceZ = new CLKernel( _TSDFVolume_source, "TSDFVolume_sliceZ" );
+			_clraycastdepth = new CLKernel( _TSDFVolume_source, "TSDFVolume_rayCastDepthmap" );
+		}
+	}
+
+	TSDFVolume::~TSDFVolume()
 	{
+		delete[] _volume;
+		delete _clvolume;
+		delete _clvolclear;
+		delete _clvoladd;
+		delete _clsliceX;
+		delete _clsliceY;
+		delete _clsliceZ;
+		delete _clraycastdepth;
 	}
 
 	void TSDFVolume::clear( float weight )
 	{
+		if( _backend == TSDFVOLUME_CPU ) {
+			clearCPU( weight );
+			return;
+		}
+
 		/* clear the volume */
-		_clvolclear.setArg( 0, _clvolume );
-		_clvolclear.setArg( 1, ( int ) _width);
-		_clvolclear.setArg( 2, ( int ) _height );
-		_clvolclear.setArg( 3, ( int ) _depth);
-		_clvolclear.setArg( 4, weight );
+		_clvolclear->setArg( 0, *_clvolume );
+		_clvolclear->setArg( 1, ( int ) _width);
+		_clvolclear->setArg( 2, ( int ) _height );
+		_clvolclear->setArg( 3, ( int ) _depth);
+		_clvolclear->setArg( 4, weight );
 		// FIXME: maybe 8 x 8 x ? for the local range is better
-		_clvolclear.run( CLNDRange( Math::pad16( _width ), Math::pad16( _height ), _depth ), CLNDRange( 16, 16, 1 ) );
+		_clvolclear->run( CLNDRange( Math::pad16( _width ), Math::pad16( _height ), _depth ), CLNDRange( 16, 16, 1 ) );
 	}
 
 
@@ -63,16 +97,21 @@ namespace cvt
 		// update projection matrix
 		Matrix4f projall = proj * _g2w;
 
+		if( _backend == TSDFVOLUME_CPU ) {
+			addDepthMapCPU( projall, depthmap, scale );
+			return;
+		}
+
 		// add depthmap
-		_clvoladd.setArg( 0, _clvolume );
-		_clvoladd.setArg( 1, ( int ) _width );
-		_clvoladd.setArg( 2, ( int ) _height );
-		_clvoladd.setArg( 3, ( int ) _depth );
-		_clvoladd.setArg( 4, depthmap );
-		_clvoladd.setArg( 5, scale );
-		_clvoladd.setArg( 6, sizeof( float ) * 16, projall.ptr() );
-		_clvoladd.setArg( 7, _trunc );
-		_clvoladd.run( CLNDRange( Math::pad16( _width ), Math::pad16( _height ), _depth ), CLNDRange( 16, 16, 1 ) );
+		_clvoladd->setArg( 0, *_clvolume );
+		_clvoladd->setArg( 1, ( int ) _width );
+		_clvoladd->setArg( 2, ( int ) _height );
+		_clvoladd->setArg( 3, ( int ) _depth );
+		_clvoladd->setArg( 4, depthmap );
+		_clvoladd->setArg( 5, scale );
+		_clvoladd->setArg( 6, sizeof( float ) * 16, projall.ptr() );
+		_clvoladd->setArg( 7, _trunc );
+		_clvoladd->run( CLNDRange( Math::pad16( _width ), Math::pad16( _height ), _depth ), CLNDRange( 16, 16, 1 ) );
 	}
 
 	void TSDFVolume::addDepthMap( const Matrix3f& intrinsics, const Matrix4f& extrinsics, const Image& depthmap, float scale )
@@ -94,44 +133,119 @@ namespace cvt
 	{
 		Matrix4f projall = proj * _g2w;
 
+		if( _backend == TSDFVOLUME_CPU ) {
+			rayCastDepthMapCPU( depthmap, projall, scale );
+			return;
+		}
+
 		depthmap.reallocate( depthmap.width(), depthmap.height(), IFormat::GRAY_FLOAT, IALLOCATOR_CL );
 
-		_clraycastdepth.setArg( 0, depthmap );
-		_clraycastdepth.setArg( 1, _clvolume );
-		_clraycastdepth.setArg( 2, ( int ) _width);
-		_clraycastdepth.setArg( 3, ( int ) _height );
-		_clraycastdepth.setArg( 4, ( int ) _depth);
-		_clraycastdepth.setArg( 5, sizeof( float ) * 16, projall.inverse().ptr() );
-		_clraycastdepth.setArg( 6, sizeof( float ) * 16, projall.ptr() );
-		_clraycastdepth.setArg( 7, scale );
-		_clraycastdepth.run( CLNDRange( Math::pad16( depthmap.width() ), Math::pad16( depthmap.height() ) ), CLNDRange( 16, 16 ) );
+		_clraycastdepth->setArg( 0, depthmap );
+		_clraycastdepth->setArg( 1, *_clvolume );
+		_clraycastdepth->setArg( 2, ( int ) _width);
+		_clraycastdepth->setArg( 3, ( int ) _height );
+		_clraycastdepth->setArg( 4, ( int ) _depth);
+		_clraycastdepth->setArg( 5, sizeof( float ) * 16, projall.inverse().ptr() );
+		_clraycastdepth->setArg( 6, sizeof( float ) * 16, projall.ptr() );
+		_clraycastdepth->setArg( 7, scale );
+		_clraycastdepth->run( CLNDRange( Math::pad16( depthmap.width() ), Math::pad16( depthmap.height() ) ), CLNDRange( 16, 16 ) );
 	}
 
+	float* TSDFVolume::mapVolume() const
+	{
+		if( _backend == TSDFVOLUME_CPU )
+			return _volume;
+		return ( float* ) _clvolume->map();
+	}
+
+	void TSDFVolume::unmapVolume( float* ptr ) const
+	{
+		if( _backend != TSDFVOLUME_CPU )
+			_clvolume->unmap( ptr );
+	}
 
 	void TSDFVolume::toSceneMesh( SceneMesh& mesh ) const
 	{
-		float* ptr = ( float* ) _clvolume.map();
+		float* ptr = mapVolume();
 		MarchingCubes mc( ptr, _width, _height, _depth, true );
 		mc.triangulateWithNormals( mesh, 0.0f );
-		_clvolume.unmap( ptr );
+		unmapVolume( ptr );
 	}
 
 	void TSDFVolume::sliceX( Image& img ) const
 	{
+		sliceX( img, _width / 2 );
 	}
 
 	void TSDFVolume::sliceY( Image& img ) const
 	{
+		sliceY( img, _height / 2 );
 	}
 
 	void TSDFVolume::sliceZ( Image& img ) const
 	{
+		sliceZ( img, _depth / 2 );
 	}
 
+	void TSDFVolume::sliceX( Image& img, size_t x ) const
+	{
+		slice( img, 0, x );
+	}
+
+	void TSDFVolume::sliceY( Image& img, size_t y ) const
+	{
+		slice( img, 1, y );
+	}
+
+	void TSDFVolume::sliceZ( Image& img, size_t z ) const
+	{
+		slice( img, 2, z );
+	}
+
+	void TSDFVolume::slice( Image& img, int axis, size_t v ) const
+	{
+		size_t dims[ 3 ] = { _width, _height, _depth };
+		size_t strides[ 3 ] = { 2, 2 * _width, 2 * _width * _height };
+		/* the image axes are the remaining volume axes in order */
+		int ax0 = axis == 0 ? 1 : 0;
+		int ax1 = axis == 2 ? 1 : 2;
+
+		if( v >= dims[ axis ] )
+			throw CVTException( "TSDFVolume: slice out of range" );
+
+		if( _backend != TSDFVOLUME_CPU ) {
+			CLKernel* kernel = axis == 0 ? _clsliceX : ( axis == 1 ? _clsliceY : _clsliceZ );
+			img.reallocate( dims[ ax0 ], dims[ ax1 ], IFormat::RGBA_FLOAT, IALLOCATOR_CL );
+			kernel->setArg( 0, img );
+			kernel->setArg( 1, ( int ) v );
+			kernel->setArg( 2, *_clvolume );
+			kernel->setArg( 3, ( int ) _width );
+			kernel->setArg( 4, ( int ) _height );
+			kernel->setArg( 5, ( int ) _depth );
+			kernel->run( CLNDRange( Math::pad16( dims[ ax0 ] ), Math::pad16( dims[ ax1 ] ) ), CLNDRange( 16, 16 ) );
+			return;
+		}
+
+		img.reallocate( dims[ ax0 ], dims[ ax1 ], IFormat::RGBA_FLOAT );
+		IMapScoped<float> map( img );
+		for( size_t j = 0; j < dims[ ax1 ]; j++ ) {
+			float* dst = map.ptr();
+			const float* src = _volume + v * strides[ axis ] + j * strides[ ax1 ];
+			for( size_t i = 0; i < dims[ ax0 ]; i++ ) {
+				float val = Math::clamp( *src + 0.5f, 0.0f, 1.0f );
+				*dst++ = val;
+				*dst++ = val;
+				*dst++ = val;
+				*dst++ = 1.0f;
+				src += strides[ ax0 ];
+			}
+			map++;
+		}
+	}
 
 	void TSDFVolume::saveRaw( const String& path, bool weighted ) const
 	{
-		float* ptr = ( float* ) _clvolume.map();
+		float* ptr = mapVolume();
 		float* origptr = ptr;
 		size_t n = _width * _height * _depth;
 
@@ -148,6 +262,212 @@ namespace cvt
 		}
 		fclose( f );
 
-		_clvolume.unmap( origptr );
+		unmapVolume( origptr );
+	}
+
+	/*
+	   CPU implementation, mirrors the kernels in cl/kernel/TSDFVolume/TSDFVolume.cl.
+	   The volume is processed in parallel over z-slices or image rows.
+	 */
+
+	class TSDFClearBody {
+		public:
+			TSDFClearBody( float* volume, size_t sliceSize, float weight ) :
+				_volume( volume ), _sliceSize( sliceSize ), _weight( weight )
+			{
+			}
+
+			void operator()( const Range<size_t>& r ) const
+			{
+				float* ptr = _volume + 2 * r.min * _sliceSize;
+				float* end = _volume + 2 * r.max * _sliceSize;
+				while( ptr < end ) {
+					ptr[ 0 ] = 1.0f;
+					ptr[ 1 ] = _weight;
+					ptr += 2;
+				}
+			}
+
+		private:
+			float*	_volume;
+			size_t	_sliceSize;
+			float	_weight;
+	};
+
+	class TSDFAddBody {
+		public:
+			TSDFAddBody( float* volume, size_t width, size_t height, const Matrix4f& g2cam,
+						 const uint8_t* dmap, size_t dstride, size_t dwidth, size_t dheight, float scale, float trunc ) :
+				_volume( volume ), _width( width ), _height( height ),
+				_dmap( dmap ), _dstride( dstride ), _dwidth( dwidth ), _dheight( dheight ), _scale( scale ), _trunc( trunc )
+			{
+				for( int i = 0; i < 4; i++ )
+					for( int k = 0; k < 4; k++ )
+						_m[ i ][ k ] = g2cam[ i ][ k ];
+			}
+
+			void operator()( const Range<size_t>& r ) const
+			{
+				SIMD* simd = SIMD::instance();
+				/* voxel ( x, y, z ) is at camera position pos + x * step */
+				float step[ 3 ] = { _m[ 0 ][ 0 ], _m[ 1 ][ 0 ], _m[ 2 ][ 0 ] };
+				float pos[ 3 ];
+
+				for( size_t z = r.min; z < r.max; z++ ) {
+					float* ptr = _volume + 2 * z * _width * _height;
+					for( size_t y = 0; y < _height; y++, ptr += 2 * _width ) {
+						for( int i = 0; i < 3; i++ )
+							pos[ i ] = _m[ i ][ 1 ] * ( float ) y + _m[ i ][ 2 ] * ( float ) z + _m[ i ][ 3 ];
+						simd->tsdfFuse( ptr, pos, step, ( const float* ) _dmap, _dstride, _dwidth, _dheight, _scale, _trunc, _width );
+					}
+				}
+			}
+
+		private:
+			float*			_volume;
+			size_t			_width, _height;
+			float			_m[ 4 ][ 4 ];
+			const uint8_t*	_dmap;
+			size_t			_dstride, _dwidth, _dheight;
+			float			_scale;
+			float			_trunc;
+	};
+
+	class TSDFRayCastBody {
+		public:
+			TSDFRayCastBody( const float* volume, size_t width, size_t height, size_t depth, const Matrix4f& cam2g, const Matrix4f& g2cam,
+							 uint8_t* dst, size_t dstride, size_t dwidth, float scale ) :
+				_volume( volume ), _width( width ), _height( height ), _depth( depth ),
+				_cam2g( cam2g ), _g2cam( g2cam ), _dst( dst ), _dstride( dstride ), _dwidth( dwidth ), _scale( scale )
+			{
+			}
+
+			void operator()( const Range<size_t>& r ) const
+			{
+				Vector3f origin( _cam2g[ 0 ][ 3 ], _cam2g[ 1 ][ 3 ], _cam2g[ 2 ][ 3 ] );
+				for( size_t y = r.min; y < r.max; y++ ) {
+					float* out = ( float* ) ( _dst + y * _dstride );
+					for( size_t x = 0; x < _dwidth; x++ )
+						out[ x ] = rayCast( origin, ( float ) x, ( float ) y );
+				}
+			}
+
+		private:
+			float value( const Vector3f& p ) const
+			{
+				Vector3f pos( Math::clamp( p.x, 0.0f, ( float ) _width - 2.0f ),
+							  Math::clamp( p.y, 0.0f, ( float ) _height - 2.0f ),
+							  Math::clamp( p.z, 0.0f, ( float ) _depth - 2.0f ) );
+				float bx = Math::floor( pos.x );
+				float by = Math::floor( pos.y );
+				float bz = Math::floor( pos.z );
+				float ax = pos.x - bx;
+				float ay = pos.y - by;
+				float az = pos.z - bz;
+				const float* base = _volume + 2 * ( ( ( size_t ) bz * _height + ( size_t ) by ) * _width + ( size_t ) bx );
+				size_t sy = 2 * _width;
+				size_t sz = 2 * _width * _height;
+				const float* v[ 8 ] = { base, base + 2, base + sy, base + sy + 2,
+										base + sz, base + sz + 2, base + sz + sy, base + sz + sy + 2 };
+				float vals[ 8 ];
+				for( int i = 0; i < 8; i++ ) {
+					if( v[ i ][ 1 ] < 1.0f )
+						return 1e10f;
+					vals[ i ] = v[ i ][ 0 ];
+				}
+				float z0 = Math::mix( vals[ 0 ], vals[ 4 ], az );
+				float z1 = Math::mix( vals[ 1 ], vals[ 5 ], az );
+				float z2 = Math::mix( vals[ 2 ], vals[ 6 ], az );
+				float z3 = Math::mix( vals[ 3 ], vals[ 7 ], az );
+				float y0 = Math::mix( z0, z2, ay );
+				float y1 = Math::mix( z1, z3, ay );
+				return Math::mix( y0, y1, ax );
+			}
+
+			float rayCast( const Vector3f& origin, float x, float y ) const
+			{
+				Vector3f dir( _cam2g[ 0 ][ 0 ] * x + _cam2g[ 0 ][ 1 ] * y + _cam2g[ 0 ][ 2 ] + _cam2g[ 0 ][ 3 ],
+							  _cam2g[ 1 ][ 0 ] * x + _cam2g[ 1 ][ 1 ] * y + _cam2g[ 1 ][ 2 ] + _cam2g[ 1 ][ 3 ],
+							  _cam2g[ 2 ][ 0 ] * x + _cam2g[ 2 ][ 1 ] * y + _cam2g[ 2 ][ 2 ] + _cam2g[ 2 ][ 3 ] );
+				dir -= origin;
+				dir.normalize();
+
+				float dims[ 3 ] = { ( float ) _width, ( float ) _height, ( float ) _depth };
+				float start = -INFINITY, end = INFINITY;
+				for( int i = 0; i < 3; i++ ) {
+					start = fmaxf( start, ( ( dir[ i ] >= 0.0f ? 0.0f : dims[ i ] ) - origin[ i ] ) / dir[ i ] );
+					end = fminf( end, ( ( dir[ i ] >= 0.0f ? dims[ i ] : 0.0f ) - origin[ i ] ) / dir[ i ] );
+				}
+
+				if( !( start < end ) || !Math::isFinite( start ) || !Math::isFinite( end ) ||
+					!Math::isFinite( dir.x ) || !Math::isFinite( dir.y ) || !Math::isFinite( dir.z ) )
+					return 0.0f;
+
+				Vector3f rayVec = dir * ( end - start );
+				rayVec.x = Math::abs( rayVec.x );
+				rayVec.y = Math::abs( rayVec.y );
+				rayVec.z = Math::abs( rayVec.z );
+				float step = 0.5f * rayVec.length() / Math::max( rayVec.x, Math::max( rayVec.y, rayVec.z ) );
+
+				Vector3f posPrev = origin + dir * start;
+				float valPrev = value( posPrev );
+
+				for( float lambda = start + step; lambda <= end; lambda += step ) {
+					Vector3f pos = origin + dir * lambda;
+					float val = value( pos );
+
+					if( valPrev < 0.0f && val > 0.0f )
+						break;
+
+					if( valPrev > 0.0f && val <= 0.0f ) {
+						float alpha = -val / ( valPrev - val );
+						Vector3f g = pos + ( posPrev - pos ) * alpha;
+						float z = _g2cam[ 2 ][ 0 ] * g.x + _g2cam[ 2 ][ 1 ] * g.y + _g2cam[ 2 ][ 2 ] * g.z + _g2cam[ 2 ][ 3 ];
+						return Math::max( z * _scale, 0.0f );
+					}
+					valPrev = val;
+					posPrev = pos;
+				}
+				return 0.0f;
+			}
+
+			const float*	_volume;
+			size_t			_width, _height, _depth;
+			Matrix4f		_cam2g, _g2cam;
+			uint8_t*		_dst;
+			size_t			_dstride, _dwidth;
+			float			_scale;
+	};
+
+	void TSDFVolume::clearCPU( float weight )
+	{
+		TSDFClearBody body( _volume, _width * _height, weight );
+		parallelFor( Range<size_t>( 0, _depth ), body );
+	}
+
+	void TSDFVolume::addDepthMapCPU( const Matrix4f& projall, const Image& depthmap, float scale )
+	{
+		/* the CL kernel reads normalized values for integer formats, convert does the same */
+		Image tmp;
+		const Image* dimg = &depthmap;
+		if( depthmap.format() != IFormat::GRAY_FLOAT ) {
+			depthmap.convert( tmp, IFormat::GRAY_FLOAT );
+			dimg = &tmp;
+		}
+
+		IMapScoped<const float> map( *dimg );
+		TSDFAddBody body( _volume, _width, _height, projall, ( const uint8_t* ) map.ptr(), map.stride(),
+						  dimg->width(), dimg->height(), scale, _trunc );
+		parallelFor( Range<size_t>( 0, _depth ), body, 1 );
+	}
+
+	void TSDFVolume::rayCastDepthMapCPU( Image& depthmap, const Matrix4f& projall, float scale )
+	{
+		depthmap.reallocate( depthmap.width(), depthmap.height(), IFormat::GRAY_FLOAT );
+
+		IMapScoped<float> map( depthmap );
+		TSDFRayCastBody body( _volume, _width, _height, _depth, projall.inverse(), projall,
+							  ( uint8_t* ) map.ptr(), map.stride(), depthmap.width(), scale );
+		parallelFor( Range<size_t>( 0, depthmap.height() ), body );
 	}
 }
@@ -33,10 +33,16 @@
 
 namespace cvt
 {
+	enum TSDFVolumeBackend {
+		TSDFVOLUME_CL = 0,
+		TSDFVOLUME_CPU
+	};
+
 	class TSDFVolume
 	{
 		public:
-			TSDFVolume( const Matrix4f& gridtoworld, size_t width, size_t height, size_t depth, float truncation = 0.1f );
+			TSDFVolume( const Matrix4f& gridtoworld, size_t width, size_t height, size_t depth, float truncation = 0.1f, TSDFVolumeBackend backend = TSDFVOLUME_CL );
+			~TSDFVolume();
 
 			void clear( float weight = 0.0f );
 			void addDepthMap( const Matrix4f& proj, const Image& depthmap, float scale );
@@ -48,13 +54,19 @@ namespace cvt
 			size_t width() const { return _width; }
 			size_t height() const { return _height; }
 			size_t depth() const { return _depth; }
+			TSDFVolumeBackend backend() const { return _backend; }
 
 			void toSceneMesh( SceneMesh& mesh ) const;
 
+			/* slices through the center of the volume */
 			void sliceX( Image& img ) const;
 			void sliceY( Image& img ) const;
 			void sliceZ( Image& img ) const;
 
+			void sliceX( Image& img, size_t x ) const;
+			void sliceY( Image& img, size_t y ) const;
+			void sliceZ( Image& img, size_t z ) const;
+
 			/*
 			   o save or map-data
 			   o to SceneMesh / GLMesh using MC
@@ -66,17 +78,31 @@ namespace cvt
 			void saveRaw( const String& path, bool weighted ) const;
 
 		private:
+			TSDFVolume( const TSDFVolume& );
+			TSDFVolume& operator=( const TSDFVolume& );
+
+			void	slice( Image& img, int axis, size_t v ) const;
+			float*	mapVolume() const;
+			void	unmapVolume( float* ptr ) const;
+
+			/* CPU implementation */
+			void clearCPU( float weight );
+			void addDepthMapCPU( const Matrix4f& projall, const Image& depthmap, float scale );
+			void rayCastDepthMapCPU( Image& depthmap, const Matrix4f& projall, float scale );
+
 			size_t	 _width;
 			size_t	 _height;
 			size_t	 _depth;
 			float	 _trunc;
 			Matrix4f _g2w;
-			CLBuffer _clvolume;
-			CLBuffer _clproj;
-			CLKernel _clvolclear;
-			CLKernel _clvoladd;
-			CLKernel _clsliceX, _clsliceY, _clsliceZ;
-			CLKernel _clraycastdepth;
+			TSDFVolumeBackend _backend;
+			/* interleaved tsdf and weight, same layout as the CL buffer */
+			float*	 _volume;
+			CLBuffer* _clvolume;
+			CLKernel* _clvolclear;
+			CLKernel* _clvoladd;
+			CLKernel* _clsliceX, *_clsliceY, *_clsliceZ;
+			CLKernel* _clraycastdepth;
 	};
 
 
@@ -0,0 +1,156 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/vision/TSDFVolume.h>
+#include <cvt/cl/OpenCL.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/geom/scene/SceneMesh.h>
+#include <cvt/util/CVTTest.h>
+
+using namespace cvt;
+
+/* grid equals world, camera 40 units in front of the volume looking along +z */
+static void _tsdfSetup( Matrix3f& K, Matrix4f& T )
+{
+	K.setIdentity();
+	K[ 0 ][ 0 ] = 50.0f;
+	K[ 1 ][ 1 ] = 50.0f;
+	K[ 0 ][ 2 ] = 32.0f;
+	K[ 1 ][ 2 ] = 32.0f;
+
+	T.setIdentity();
+	T[ 0 ][ 3 ] = -32.0f;
+	T[ 1 ][ 3 ] = -32.0f;
+	T[ 2 ][ 3 ] = 40.0f;
+}
+
+static bool _tsdfFusePlane( TSDFVolume& vol, Image& raycast, Image& slice )
+{
+	Matrix3f K;
+	Matrix4f T;
+	_tsdfSetup( K, T );
+
+	Image dmap( 64, 64, IFormat::GRAY_FLOAT );
+	dmap.fill( Color( 60.0f ) );
+
+	/* toSceneMesh only triangulates voxels with a weight above 20 */
+	vol.clear( 0.0f );
+	for( int i = 0; i < 21; i++ )
+		vol.addDepthMap( K, T, dmap, 1.0f );
+
+	raycast.reallocate( 64, 64, IFormat::GRAY_FLOAT );
+	vol.rayCastDepthMap( raycast, K, T, 1.0f );
+	vol.sliceZ( slice, 20 );
+
+	bool ret = true;
+	IMapScoped<const float> map( raycast );
+	for( size_t y = 16; y < 48; y++ ) {
+		const float* ptr = map.line( y );
+		for( size_t x = 16; x < 48; x++ )
+			ret &= Math::abs( ptr[ x ] - 60.0f ) < 0.5f;
+	}
+	return ret;
+}
+
+static bool _tsdfSlices( TSDFVolume& vol )
+{
+	Image img;
+	bool ret = true;
+
+	vol.sliceX( img );
+	ret &= img.width() == 48 && img.height() == 40 && img.format() == IFormat::RGBA_FLOAT;
+	vol.sliceY( img );
+	ret &= img.width() == 64 && img.height() == 40;
+	vol.sliceZ( img, 5 );
+	ret &= img.width() == 64 && img.height() == 48;
+
+	/* a cleared volume keeps its initial tsdf value of one */
+	IMapScoped<const float> map( img );
+	const float* ptr = map.line( 24 );
+	ret &= ptr[ 4 * 32 ] == 1.0f && ptr[ 4 * 32 + 3 ] == 1.0f;
+	return ret;
+}
+
+static bool _tsdfCompare( const Image& a, const Image& b, float eps )
+{
+	IMapScoped<const float> ma( a );
+	IMapScoped<const float> mb( b );
+	size_t n = a.width() * a.channels();
+	for( size_t y = 0; y < a.height(); y++ ) {
+		const float* pa = ma.line( y );
+		const float* pb = mb.line( y );
+		for( size_t x = 0; x < n; x++ ) {
+			if( Math::abs( pa[ x ] - pb[ x ] ) > eps )
+				return false;
+		}
+	}
+	return true;
+}
+
+BEGIN_CVTTEST( TSDFVolume )
+	bool ret = true;
+	bool b;
+
+	Matrix4f g2w;
+	g2w.setIdentity();
+
+	TSDFVolume cpuvol( g2w, 64, 64, 64, 4.0f, TSDFVOLUME_CPU );
+	Image cpuray, cpuslice;
+	b = _tsdfFusePlane( cpuvol, cpuray, cpuslice );
+	CVTTEST_PRINT( "CPU fusion and raycast", b );
+	ret &= b;
+
+	/* the surface is at z = 20, the slice holds tsdf + 0.5 */
+	{
+		IMapScoped<const float> map( cpuslice );
+		const float* ptr = map.line( 32 );
+		b = Math::abs( ptr[ 4 * 32 ] - 0.5f ) < 1e-4f;
+	}
+	CVTTEST_PRINT( "CPU slice at surface", b );
+	ret &= b;
+
+	TSDFVolume small( g2w, 64, 48, 40, 4.0f, TSDFVOLUME_CPU );
+	small.clear( 0.0f );
+	b = _tsdfSlices( small );
+	CVTTEST_PRINT( "CPU slice sizes", b );
+	ret &= b;
+
+	SceneMesh mesh( "tsdf" );
+	cpuvol.toSceneMesh( mesh );
+	b = mesh.vertexSize() > 0;
+	CVTTEST_PRINT( "CPU toSceneMesh", b );
+	ret &= b;
+
+	if( CL::defaultContext() ) {
+		TSDFVolume clvol( g2w, 64, 64, 64, 4.0f, TSDFVOLUME_CL );
+		Image clray, clslice;
+		b = _tsdfFusePlane( clvol, clray, clslice );
+		b &= _tsdfCompare( cpuray, clray, 1e-3f );
+		b &= _tsdfCompare( cpuslice, clslice, 1e-4f );
+		CVTTEST_PRINT( "CPU and CL equivalence", b );
+		ret &= b;
+	}
+
+	return ret;
+END_CVTTEST
@@ -23,6 +23,7 @@
 */
 
 #include <cvt/vision/features/AGAST.h>
+#include <cvt/vision/features/FeatureBands.h>
 
 #include <cvt/vision/features/agast/OAST9_16.h>
 #include <cvt/vision/features/agast/Agast5_8.h>
@@ -33,21 +34,28 @@ namespace cvt
 {
     AGAST::AGAST( ASTType astType, uint8_t threshold, size_t border ) :
         _astType( astType ),
-        _astDetector( 0 ),
         _threshold( threshold ),
-        _border( border )
+        _border( border ),
+        _nmsRadius( 0 )
     {
-        switch( _astType ){
-            case AGAST_5_8:   _astDetector = new Agast5_8();   break;
-            case AGAST_7_12d: _astDetector = new Agast7_12d(); break;
-            case AGAST_7_12s: _astDetector = new Agast7_12s(); break;
-            case OAST_9_16:   _astDetector = new OAST9_16();   break;
-            default: throw CVTException( "unkown AST Type for AGAST!" );
-        }
+        _astDetectors.push_back( createDetector( _astType ) );
     }
 
     AGAST::~AGAST()
     {
+        for( size_t i = 0; i < _astDetectors.size(); i++ )
+            delete _astDetectors[ i ];
+    }
+
+    ASTDetector* AGAST::createDetector( ASTType astType )
+    {
+        switch( astType ){
+            case AGAST_5_8:   return new Agast5_8();
+            case AGAST_7_12d: return new Agast7_12d();
+            case AGAST_7_12s: return new Agast7_12s();
+            case OAST_9_16:   return new OAST9_16();
+            default: throw CVTException( "unkown AST Type for AGAST!" );
+        }
     }
 
     void AGAST::detect( FeatureSet& features, const Image& img )
@@ -55,8 +63,11 @@ namespace cvt
         if( img.format() != IFormat::GRAY_UINT8 )
             throw CVTException( "Input Image format must be GRAY_UINT8" );
 
-        FeatureSetWrapper fset( features );
-        _astDetector->detect( img, _threshold, fset, _border );
+        _astDetectors[ 0 ]->prepare( img );
+
+        FeatureBands<AGAST> bands( *this, _nmsRadius );
+        bands.addOctave( img, 1.0f );
+        bands.detect( features );
     }
 
     void AGAST::detect( FeatureSet& featureSet, const ImagePyramid& imgpyr )
@@ -64,11 +75,20 @@ namespace cvt
         if( imgpyr[ 0 ].format() != IFormat::GRAY_UINT8 )
             throw CVTException( "Input Image format must be GRAY_UINT8" );
 
+        while( _astDetectors.size() < imgpyr.octaves() )
+            _astDetectors.push_back( createDetector( _astType ) );
+
+        FeatureBands<AGAST> bands( *this, _nmsRadius );
         for( size_t coctave = 0; coctave < imgpyr.octaves(); coctave++ ) {
-            float cscale = Math::pow( imgpyr.scaleFactor(), -( float )coctave );
-            FeatureSetWrapper features( featureSet, cscale, coctave );
-            _astDetector->detect( imgpyr[ coctave ], _threshold, features, _border );
+            _astDetectors[ coctave ]->prepare( imgpyr[ coctave ] );
+            bands.addOctave( imgpyr[ coctave ], Math::pow( imgpyr.scaleFactor(), -( float )coctave ) );
         }
+        bands.detect( featureSet );
+    }
+
+    void AGAST::detectRows( FeatureSetWrapper& features, const Image& img, size_t octave, size_t y0, size_t y1 ) const
+    {
+        _astDetectors[ octave ]->detect( img, _threshold, features, _border, y0, y1 );
     }
 
 }
@@ -26,6 +26,7 @@
 #define CVT_AGAST_H
 
 #include <cvt/vision/features/FeatureDetector.h>
+#include <vector>
 
 namespace cvt {
     class ASTDetector;
@@ -52,12 +53,26 @@ namespace cvt {
             void setBorder( size_t border )			{ _border = Math::max<size_t>( border, 3 ); }
             size_t border() const					{ return _border; }
 
+            /* suppress features with a stronger one within radius while detecting, 0 disables */
+            void setNMSRadius( size_t radius )		{ _nmsRadius = radius; }
+            size_t nmsRadius() const				{ return _nmsRadius; }
+
         private:
-            ASTType         _astType;
-            ASTDetector*    _astDetector;
+            template<class> friend class FeatureBands;
+
+            ASTType                     _astType;
+            /* the detectors keep the offsets for the stride, one per octave */
+            std::vector<ASTDetector*>   _astDetectors;
 
             uint8_t _threshold;
             size_t	_border;
+            size_t	_nmsRadius;
+
+            AGAST( const AGAST& );
+            AGAST& operator=( const AGAST& );
+
+            static ASTDetector* createDetector( ASTType astType );
+            void detectRows( FeatureSetWrapper& features, const Image& img, size_t octave, size_t y0, size_t y1 ) const;
     };
 }
 
@@ -28,6 +28,7 @@
 #include <cvt/gfx/Image.h>
 #include <cvt/gfx/IMapScoped.h>
 #include <cvt/vision/ImagePyramid.h>
+#include <cvt/util/Mutex.h>
 #include <cvt/vision/features/FeatureSet.h>
 #include <cvt/vision/features/FeatureDescriptor.h>
 #include <cvt/vision/features/FeatureDescriptorExtractor.h>
@@ -49,6 +50,7 @@ namespace cvt {
 			BRIEF<N>*					clone() const;
 			FeatureDescriptor&			operator[]( size_t i );
 			const FeatureDescriptor&	operator[]( size_t i ) const;
+			const DescriptorBlock&		descriptorBlock() const;
 
 			void clear();
 			void extract( const Image& img, const FeatureSet& features );
@@ -67,6 +69,17 @@ namespace cvt {
 								float maxFeatureDist,
 								float maxDescDistance ) const;
 
+			void matchInWindow( std::vector<MatchingIndices>& matches,
+								const DescriptorBlock& other,
+								float maxFeatureDist,
+								float maxDescDistance ) const;
+
+			void matchInWindow( std::vector<MatchingIndices>& matches,
+								const RowLookupTable& rlt,
+								const DescriptorBlock& other,
+								float maxFeatureDist,
+								float maxDescDistance ) const;
+
             void scanLineMatch( std::vector<FeatureMatch>& matches,
                                 const std::vector<const FeatureDescriptor*>& left,
                                 float minDisp,
@@ -83,19 +96,6 @@ namespace cvt {
                                 float maxLineDist ) const;
 
 		private:
-			struct DistFunc {
-				DistFunc() : _simd( SIMD::instance() )
-				{
-				}
-
-				float operator()( const Descriptor& a, const Descriptor& b ) const
-				{
-					return _simd->hammingDistance( a.desc, b.desc, N );
-				}
-
-				SIMD* _simd;
-			};
-
 
             template <class ImgT>
             void extractInternal( const ImagePyramid& pyr, const FeatureSet& features );
@@ -108,6 +108,14 @@ namespace cvt {
 
 			const size_t			_boxradius;
 			std::vector<Descriptor> _features;
+			/* packed copy of _features, rebuilt on demand after modifications */
+			mutable DescriptorBlock _block;
+			/* set atomically by modifications, tested and cleared under _blockMutex by the rebuild */
+			mutable bool			_blockDirty;
+			/* serialises the rebuild for concurrent const callers */
+			mutable Mutex			_blockMutex;
+
+			void					invalidateBlock();
 
 	};
 
@@ -119,14 +127,18 @@ namespace cvt {
 
 	template<size_t N>
 	inline BRIEF<N>::BRIEF( size_t boxradius ) :
-		_boxradius( boxradius )
+		_boxradius( boxradius ),
+		_block( N ),
+		_blockDirty( true )
 	{
 	}
 
 	template<size_t N>
 	inline BRIEF<N>::BRIEF( const BRIEF<N>& other ) :
 		_boxradius( other._boxradius ),
-		_features( other._features )
+		_features( other._features ),
+		_block( N ),
+		_blockDirty( true )
 	{
 	}
 
@@ -152,6 +164,7 @@ namespace cvt {
 	template<size_t N>
 	inline FeatureDescriptor& BRIEF<N>::operator[]( size_t i )
 	{
+		invalidateBlock();
 		return _features[ i ];
 	}
 
@@ -165,6 +178,7 @@ namespace cvt {
 	inline void BRIEF<N>::clear()
 	{
 		_features.clear();
+		invalidateBlock();
 	}
 
 	template<size_t N>
@@ -173,6 +187,7 @@ namespace cvt {
         if( pyr[ 0 ].channels() != 1 || ( pyr[ 0 ].format() != IFormat::GRAY_UINT8 && pyr[ 0 ].format() != IFormat::GRAY_FLOAT ) )
             throw CVTException( "Unimplemented" );
 
+        invalidateBlock();
         if( pyr[ 0 ].format() == IFormat::GRAY_FLOAT )
             extractInternal<const float>( pyr[ 0 ], features );
         else if( pyr[ 0 ].format() == IFormat::GRAY_UINT8 )
@@ -185,6 +200,7 @@ namespace cvt {
 		if( img.channels() != 1 || ( img.format() != IFormat::GRAY_UINT8 && img.format() != IFormat::GRAY_FLOAT ) )
 			throw CVTException( "Unimplemented" );
 
+		invalidateBlock();
 		if( img.format() == IFormat::GRAY_FLOAT )
             extractInternal<const float>( img, features );
 		else if( img.format() == IFormat::GRAY_UINT8 )
@@ -255,11 +271,30 @@ namespace cvt {
 
     }
 
+	template<size_t N>
+	inline void BRIEF<N>::invalidateBlock()
+	{
+		__atomic_store_n( &_blockDirty, true, __ATOMIC_RELEASE );
+	}
+
+	template<size_t N>
+	inline const DescriptorBlock& BRIEF<N>::descriptorBlock() const
+	{
+		ScopeLock lock( &_blockMutex );
+		if( __atomic_exchange_n( &_blockDirty, false, __ATOMIC_ACQ_REL ) ) {
+			_block.clear();
+			_block.reserve( _features.size() );
+			for( size_t i = 0; i < _features.size(); i++ )
+				_block.add( _features[ i ] );
+		}
+		return _block;
+	}
+
 	template<size_t N>
 	inline void BRIEF<N>::matchBruteForce( std::vector<FeatureMatch>& matches, const FeatureDescriptorExtractor& other, float distThresh ) const
 	{
-		DistFunc dfunc;
-		FeatureMatcher::matchBruteForce<Descriptor, typename BRIEF<N>::DistFunc>( matches, this->_features, ( ( const BRIEF<N>& ) other)._features, dfunc, distThresh );
+		const BRIEF<N>& o = ( const BRIEF<N>& ) other;
+		FeatureMatcher::matchBruteForce<Descriptor>( matches, this->_features, o._features, o.descriptorBlock(), distThresh );
 	}
 
 	template<size_t N>
@@ -268,13 +303,7 @@ namespace cvt {
 										 float maxFeatureDist,
 										 float maxDescDistance ) const
 	{
-		DistFunc dfunc;
-		FeatureMatcher::matchInWindow<Descriptor, DistFunc>( matches,
-															 other,
-															 this->_features,
-															 dfunc,
-															 maxFeatureDist,
-															 maxDescDistance );
+		FeatureMatcher::matchInWindow( matches, other, descriptorBlock(), maxFeatureDist, maxDescDistance );
 	}
 
     template<size_t N>
@@ -284,14 +313,26 @@ namespace cvt {
                                          float maxFeatureDist,
                                          float maxDescDistance ) const
 	{
-		DistFunc dfunc;
-		FeatureMatcher::matchInWindow<Descriptor, DistFunc>( matches,
-															 rlt,
-															 other,
-															 this->_features,
-															 dfunc,
-															 maxFeatureDist,
-															 maxDescDistance );
+		FeatureMatcher::matchInWindow( matches, rlt, other, descriptorBlock(), maxFeatureDist, maxDescDistance );
+	}
+
+	template<size_t N>
+	inline void BRIEF<N>::matchInWindow( std::vector<MatchingIndices>& matches,
+										 const DescriptorBlock& other,
+										 float maxFeatureDist,
+										 float maxDescDistance ) const
+	{
+		FeatureMatcher::matchInWindow( matches, other, descriptorBlock(), maxFeatureDist, maxDescDistance );
+	}
+
+	template<size_t N>
+	inline void BRIEF<N>::matchInWindow( std::vector<MatchingIndices>& matches,
+										 const RowLookupTable& rlt,
+										 const DescriptorBlock& other,
+										 float maxFeatureDist,
+										 float maxDescDistance ) const
+	{
+		FeatureMatcher::matchInWindow( matches, rlt, other, descriptorBlock(), maxFeatureDist, maxDescDistance );
 	}
 
 	template<size_t N>
@@ -302,11 +343,10 @@ namespace cvt {
 										 float maxDescDist,
 										 float maxLineDist ) const
 	{
-		DistFunc dfunc;
 		FeatureMatcher::scanLineMatch( matches,
 									   left,
 									   _features,
-									   dfunc,
+									   descriptorBlock(),
 									   minDisp,
 									   maxDisp,
 									   maxDescDist,
@@ -322,12 +362,11 @@ namespace cvt {
                                          float maxDescDist,
                                          float maxLineDist ) const
     {
-        DistFunc dfunc;
         FeatureMatcher::scanLineMatch( matches,
                                        rlt,
                                        left,
                                        _features,
-                                       dfunc,
+                                       descriptorBlock(),
                                        minDisp,
                                        maxDisp,
                                        maxDescDist,
@@ -0,0 +1,254 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_DESCRIPTORBLOCK_H
+#define CVT_DESCRIPTORBLOCK_H
+
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+#include <cvt/util/SIMD.h>
+#include <cvt/util/Exception.h>
+#include <cvt/math/Vector.h>
+#include <cvt/vision/features/FeatureDescriptor.h>
+
+namespace cvt {
+
+	/**
+	  Packed storage for binary descriptors.
+
+	  The descriptor bytes are stored in one 32-byte aligned block with rows padded
+	  to a multiple of 32 bytes, positions, octaves and scores live in separate arrays.
+	  Matching against a block streams over the descriptor rows only.
+	 */
+	class DescriptorBlock
+	{
+		public:
+			DescriptorBlock( size_t length = 32 );
+			DescriptorBlock( const DescriptorBlock& other );
+			~DescriptorBlock();
+
+			DescriptorBlock& operator=( const DescriptorBlock& other );
+
+			size_t			size() const;
+			size_t			length() const;
+			size_t			stride() const;
+
+			void			clear();
+			void			reserve( size_t n );
+
+			void			add( const FeatureDescriptor& desc );
+			void			set( size_t i, const FeatureDescriptor& desc );
+
+			uint8_t*		descriptor( size_t i );
+			const uint8_t*	descriptor( size_t i ) const;
+			Vector2f&		position( size_t i );
+			const Vector2f&	position( size_t i ) const;
+			int				octave( size_t i ) const;
+			float			score( size_t i ) const;
+
+			/* closest descriptor to query in [ start, start + num ), idx is start + num if there is none */
+			void			bestMatch( size_t& idx, size_t& dist, const uint8_t* query, size_t start, size_t num ) const;
+
+		private:
+			void			grow( size_t n );
+
+			size_t					_length;
+			size_t					_stride;
+			size_t					_size;
+			size_t					_capacity;
+			uint8_t*				_data;
+			std::vector<Vector2f>	_positions;
+			std::vector<int>		_octaves;
+			std::vector<float>		_scores;
+	};
+
+	inline DescriptorBlock::DescriptorBlock( size_t length ) :
+		_length( length ),
+		_stride( ( length + 31 ) & ~( ( size_t ) 31 ) ),
+		_size( 0 ),
+		_capacity( 0 ),
+		_data( 0 )
+	{
+	}
+
+	inline DescriptorBlock::DescriptorBlock( const DescriptorBlock& other ) :
+		_length( other._length ),
+		_stride( other._stride ),
+		_size( 0 ),
+		_capacity( 0 ),
+		_data( 0 )
+	{
+		*this = other;
+	}
+
+	inline DescriptorBlock::~DescriptorBlock()
+	{
+		free( _data );
+	}
+
+	inline DescriptorBlock& DescriptorBlock::operator=( const DescriptorBlock& other )
+	{
+		if( this == &other )
+			return *this;
+
+		/* the capacity counts rows of the old stride */
+		_size = 0;
+		if( _stride != other._stride ) {
+			free( _data );
+			_data = 0;
+			_capacity = 0;
+		}
+		_length = other._length;
+		_stride = other._stride;
+		grow( other._size );
+		if( other._size )
+			SIMD::instance()->Memcpy( _data, other._data, other._size * _stride );
+		_size = other._size;
+		_positions = other._positions;
+		_octaves = other._octaves;
+		_scores = other._scores;
+		return *this;
+	}
+
+	inline size_t DescriptorBlock::size() const
+	{
+		return _size;
+	}
+
+	inline size_t DescriptorBlock::length() const
+	{
+		return _length;
+	}
+
+	inline size_t DescriptorBlock::stride() const
+	{
+		return _stride;
+	}
+
+	inline void DescriptorBlock::clear()
+	{
+		_size = 0;
+		_positions.clear();
+		_octaves.clear();
+		_scores.clear();
+	}
+
+	inline void DescriptorBlock::reserve( size_t n )
+	{
+		grow( n );
+		_positions.reserve( n );
+		_octaves.reserve( n );
+		_scores.reserve( n );
+	}
+
+	inline void DescriptorBlock::grow( size_t n )
+	{
+		if( n <= _capacity )
+			return;
+
+		uint8_t* ndata;
+		if( posix_memalign( ( void** ) &ndata, 32, n * _stride ) )
+			throw CVTException( "Out of memory!" );
+		if( _size )
+			SIMD::instance()->Memcpy( ndata, _data, _size * _stride );
+		free( _data );
+		_data = ndata;
+		_capacity = n;
+	}
+
+	inline void DescriptorBlock::add( const FeatureDescriptor& desc )
+	{
+		/* an empty block adopts the length of the first descriptor */
+		if( !_size && desc.length() != _length ) {
+			free( _data );
+			_data = 0;
+			_capacity = 0;
+			_length = desc.length();
+			_stride = ( _length + 31 ) & ~( ( size_t ) 31 );
+		}
+
+		if( _size == _capacity )
+			grow( _capacity ? _capacity * 2 : 64 );
+
+		_positions.push_back( desc.pt );
+		_octaves.push_back( desc.octave );
+		_scores.push_back( desc.score );
+		_size++;
+		set( _size - 1, desc );
+	}
+
+	inline void DescriptorBlock::set( size_t i, const FeatureDescriptor& desc )
+	{
+		if( desc.length() != _length )
+			throw CVTException( "Descriptor length does not match block" );
+
+		uint8_t* dst = descriptor( i );
+		SIMD::instance()->Memcpy( dst, desc.ptr(), _length );
+		memset( dst + _length, 0, _stride - _length );
+		_positions[ i ] = desc.pt;
+		_octaves[ i ] = desc.octave;
+		_scores[ i ] = desc.score;
+	}
+
+	inline uint8_t* DescriptorBlock::descriptor( size_t i )
+	{
+		return _data + i * _stride;
+	}
+
+	inline const uint8_t* DescriptorBlock::descriptor( size_t i ) const
+	{
+		return _data + i * _stride;
+	}
+
+	inline Vector2f& DescriptorBlock::position( size_t i )
+	{
+		return _positions[ i ];
+	}
+
+	inline const Vector2f& DescriptorBlock::position( size_t i ) const
+	{
+		return _positions[ i ];
+	}
+
+	inline int DescriptorBlock::octave( size_t i ) const
+	{
+		return _octaves[ i ];
+	}
+
+	inline float DescriptorBlock::score( size_t i ) const
+	{
+		return _scores[ i ];
+	}
+
+	inline void DescriptorBlock::bestMatch( size_t& idx, size_t& dist, const uint8_t* query, size_t start, size_t num ) const
+	{
+		size_t second, secondDist;
+		SIMD::instance()->hammingDistanceBest( idx, dist, second, secondDist, query, descriptor( start ), _stride, num, _length );
+		idx += start;
+	}
+
+}
+
+#endif
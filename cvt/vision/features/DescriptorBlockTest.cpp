@@ -0,0 +1,156 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/vision/features/DescriptorBlock.h>
+#include <cvt/vision/features/MatchBruteForce.h>
+#include <cvt/vision/features/ORB.h>
+#include <cvt/util/CVTTest.h>
+
+using namespace cvt;
+
+typedef ORB::Descriptor TestDescriptor;
+
+static void _randomDescriptors( std::vector<TestDescriptor>& descs, size_t n )
+{
+	for( size_t i = 0; i < n; i++ ) {
+		TestDescriptor d( Math::rand( 0.0f, 100.0f ), Math::rand( 0.0f, 100.0f ), 0.0f, 0, Math::rand( 0.0f, 1.0f ) );
+		for( size_t k = 0; k < 32; k++ )
+			d.desc[ k ] = ( uint8_t ) Math::rand( 0, 256 );
+		descs.push_back( d );
+	}
+}
+
+static bool _packTest( const std::vector<TestDescriptor>& descs, const DescriptorBlock& block )
+{
+	bool b = true;
+
+	b &= block.size() == descs.size();
+	b &= block.stride() % 32 == 0;
+	b &= ( ( size_t ) block.descriptor( 0 ) & 31 ) == 0;
+	for( size_t i = 0; i < descs.size(); i++ ) {
+		b &= memcmp( block.descriptor( i ), descs[ i ].desc, 32 ) == 0;
+		b &= block.position( i ) == descs[ i ].pt;
+		b &= block.score( i ) == descs[ i ].score;
+	}
+	return b;
+}
+
+static bool _bestMatchTest( const std::vector<TestDescriptor>& descs, const DescriptorBlock& block )
+{
+	bool b = true;
+	SIMD* simd = SIMD::instance();
+
+	for( size_t q = 0; q < 20; q++ ) {
+		const uint8_t* query = descs[ q ].desc;
+		size_t start = q * 3;
+		size_t num = descs.size() - start;
+
+		size_t ref = start + num, refDist = ( size_t ) -1;
+		for( size_t i = start; i < start + num; i++ ) {
+			size_t d = simd->hammingDistance( query, descs[ i ].desc, 32 );
+			if( d < refDist ) {
+				ref = i;
+				refDist = d;
+			}
+		}
+
+		size_t idx, dist;
+		block.bestMatch( idx, dist, query, start, num );
+		b &= ( idx == ref && dist == refDist );
+	}
+	return b;
+}
+
+static bool _windowMatchTest( const std::vector<TestDescriptor>& descs, const DescriptorBlock& block )
+{
+	std::vector<FeatureDescriptor*> query;
+	DescriptorBlock queryBlock;
+	for( size_t i = 0; i < 30; i++ ) {
+		query.push_back( ( FeatureDescriptor* ) &descs[ i ] );
+		queryBlock.add( descs[ i ] );
+	}
+
+	std::vector<MatchingIndices> m0, m1;
+	FeatureMatcher::matchInWindow( m0, query, block, 20.0f, 100.0f );
+	FeatureMatcher::matchInWindow( m1, queryBlock, block, 20.0f, 100.0f );
+
+	bool b = m0.size() == m1.size() && m0.size() == query.size();
+	for( size_t i = 0; b && i < m0.size(); i++ ) {
+		b &= m0[ i ].srcIdx == m1[ i ].srcIdx;
+		b &= m0[ i ].dstIdx == m1[ i ].dstIdx;
+		/* every query is part of the block */
+		b &= m0[ i ].dstIdx == m0[ i ].srcIdx && m0[ i ].distance == 0.0f;
+	}
+	return b;
+}
+
+BEGIN_CVTTEST( DescriptorBlock )
+	bool testResult = true;
+	bool b;
+
+	std::vector<TestDescriptor> descs;
+	_randomDescriptors( descs, 300 );
+
+	DescriptorBlock block;
+	for( size_t i = 0; i < descs.size(); i++ )
+		block.add( descs[ i ] );
+
+	b = _packTest( descs, block );
+	CVTTEST_PRINT( "pack", b );
+	testResult &= b;
+
+	DescriptorBlock copy( block );
+	b = _packTest( descs, copy );
+	CVTTEST_PRINT( "copy", b );
+	testResult &= b;
+
+	/* assigning a wider block into a narrower one with enough rows must reallocate */
+	typedef FeatureDescriptorInternal<64, uint8_t, FEATUREDESC_CMP_HAMMING> WideDescriptor;
+	DescriptorBlock wide( 64 );
+	for( size_t i = 0; i < 50; i++ ) {
+		WideDescriptor d( descs[ i ] );
+		for( size_t k = 0; k < 64; k++ )
+			d.desc[ k ] = ( uint8_t ) ( i + k );
+		wide.add( d );
+	}
+	DescriptorBlock narrow;
+	for( size_t i = 0; i < 60; i++ )
+		narrow.add( descs[ i ] );
+	narrow = wide;
+	b = narrow.size() == 50 && narrow.stride() == 64;
+	for( size_t i = 0; b && i < 50; i++ )
+		b = memcmp( narrow.descriptor( i ), wide.descriptor( i ), 64 ) == 0;
+	CVTTEST_PRINT( "assign wider", b );
+	testResult &= b;
+
+	b = _bestMatchTest( descs, block );
+	CVTTEST_PRINT( "bestMatch", b );
+	testResult &= b;
+
+	b = _windowMatchTest( descs, block );
+	CVTTEST_PRINT( "matchInWindow", b );
+	testResult &= b;
+
+	return testResult;
+END_CVTTEST
@@ -23,6 +23,7 @@
 */
 
 #include <cvt/vision/features/FAST.h>
+#include <cvt/vision/features/FeatureBands.h>
 #include <cvt/gfx/IScaleFilter.h>
 
 namespace cvt
@@ -30,7 +31,8 @@ namespace cvt
 
 	FAST::FAST( FASTSize size, uint8_t threshold, size_t border ) :
         _fastSize( size ),
-		_threshold( threshold )
+		_threshold( threshold ),
+		_nmsRadius( 0 )
 	{
 		setBorder( border );
 	}
@@ -43,82 +45,70 @@ namespace cvt
 	{
 		if( img.format() != IFormat::GRAY_UINT8 )
 			throw CVTException( "Input Image format must be GRAY_UINT8" );
+		if( _fastSize > SEGMENT_12 )
+			throw CVTException( "Unkown FAST size" );
 
-		FeatureSetWrapper features( featureset );
+		FeatureBands<FAST> bands( *this, _nmsRadius );
+		bands.addOctave( img, 1.0f );
+		bands.detect( featureset );
+	}
+
+	void FAST::detect( FeatureSet& featureset, const ImagePyramid& imgpyr )
+	{
+		if( imgpyr[ 0 ].format() != IFormat::GRAY_UINT8 )
+			throw CVTException( "Input Image format must be GRAY_UINT8" );
+		if( _fastSize > SEGMENT_12 )
+			throw CVTException( "Unkown FAST size" );
+
+		FeatureBands<FAST> bands( *this, _nmsRadius );
+		for( size_t coctave = 0; coctave < imgpyr.octaves(); coctave++ )
+			bands.addOctave( imgpyr[ coctave ], Math::pow( imgpyr.scaleFactor(), -( float )coctave ) );
+		bands.detect( featureset );
+	}
 
+	void FAST::detectRows( FeatureSetWrapper& features, const Image& img, size_t, size_t y0, size_t y1 ) const
+	{
 		switch ( _fastSize ) {
 			case SEGMENT_9:
-				detect9( img, _threshold, features, _border );
+				detect9( img, _threshold, features, _border, y0, y1 );
 				break;
 			case SEGMENT_10:
-				detect10( img, _threshold, features, _border );
+				detect10( img, _threshold, features, _border, y0, y1 );
 				break;
 			case SEGMENT_11:
-				detect11( img, _threshold, features, _border );
+				detect11( img, _threshold, features, _border, y0, y1 );
 				break;
 			case SEGMENT_12:
-				detect12( img, _threshold, features, _border );
-				break;
-			default:
-				throw CVTException( "Unkown FAST size" );
+				detect12( img, _threshold, features, _border, y0, y1 );
 				break;
 		}
 	}
 
-	void FAST::detect( FeatureSet& featureset, const ImagePyramid& imgpyr )
-	{
-		if( imgpyr[ 0 ].format() != IFormat::GRAY_UINT8 )
-			throw CVTException( "Input Image format must be GRAY_UINT8" );
-
-		for( size_t coctave = 0; coctave < imgpyr.octaves(); coctave++ ) {
-			float cscale = Math::pow( imgpyr.scaleFactor(), -( float )coctave );
-			FeatureSetWrapper features( featureset, cscale, coctave );
-
-			switch ( _fastSize ) {
-				case SEGMENT_9:
-					detect9( imgpyr[ coctave ], _threshold, features, _border );
-					break;
-				case SEGMENT_10:
-					detect10( imgpyr[ coctave ], _threshold, features, _border );
-					break;
-				case SEGMENT_11:
-					detect11( imgpyr[ coctave ], _threshold, features, _border );
-					break;
-				case SEGMENT_12:
-					detect12( imgpyr[ coctave ], _threshold, features, _border );
-					break;
-				default:
-					throw CVTException( "Unkown FAST size" );
-					break;
-			}
-		}
-	}
-
-	inline void FAST::detect9( const Image& img, uint8_t threshold, FeatureSetWrapper& features, size_t border )
+	inline void FAST::detect9( const Image& img, uint8_t threshold, FeatureSetWrapper& features, size_t border, size_t y0, size_t y1 )
 	{
 		// check the cpu flags to determine the right version
 		CPUFeatures cpu = cpuFeatures();
 		if( cpu & CPU_SSE2 ){
-			detect9simd( img, threshold, features, border );
-			//detect9cpu( img, threshold, features, border );
+			detect9simd( img, threshold, features, border, y0, y1 );
+			//detect9cpu( img, threshold, features, border, y0, y1 );
 		} else {
-			detect9cpu( img, threshold, features, border );
+			detect9cpu( img, threshold, features, border, y0, y1 );
 		}
 	}
 
-	inline void FAST::detect9cpu( const Image& img, uint8_t threshold, FeatureSetWrapper& features, size_t border )
+	inline void FAST::detect9cpu( const Image& img, uint8_t threshold, FeatureSetWrapper& features, size_t border, size_t y0, size_t y1 )
 	{
 		size_t stride;
 		const uint8_t * im = img.map( &stride );
 
 		size_t x, y;
 		size_t xsize = img.width() - border;
-		size_t ysize = img.height() - border;
+		size_t ysize = Math::min( img.height() - border, y1 );
 
 		int offsets[ 16 ];
 		make_offsets( offsets, stride );
 
-		for( y=border; y < ysize; y++ ){
+		for( y = Math::max( border, y0 ); y < ysize; y++ ){
 			for( x=border; x < xsize; x++ ){
 				const uint8_t* p = im + y*stride + x;
 
@@ -129,7 +119,7 @@ namespace cvt
 		img.unmap( im );
 	}
 
-	inline void FAST::detect9simd( const Image& img, uint8_t threshold, FeatureSetWrapper& features, size_t border )
+	inline void FAST::detect9simd( const Image& img, uint8_t threshold, FeatureSetWrapper& features, size_t border, size_t y0, size_t y1 )
 	{
 	#define CHECK_BARRIER(lo, hi, other, flags)		\
 		{                                               \
@@ -159,11 +149,14 @@ namespace cvt
 		size_t aligned_start = ( (int)( border / 16 ) + 1 ) << 4;
 
 
+		const size_t ybegin = Math::max( border, y0 );
+		const size_t yend = Math::min( height - border, y1 );
+
 		const uint8_t* im = iptr;
-		im += ( border * stride );
+		im += ( ybegin * stride );
 		const uint8_t * ptr;
 
-		for ( size_t y = border; y < height - border; y++ ) {
+		for ( size_t y = ybegin; y < yend; y++ ) {
 			ptr = im + border;
 			for ( size_t x = border; x < aligned_start; x++ ){
 				if( isCorner9( ptr, offsets, threshold ) )
@@ -399,19 +392,19 @@ namespace cvt
 	#undef CHECK_BARRIER
 	}
 
-	inline void FAST::detect10( const Image& img, uint8_t threshold, FeatureSetWrapper& features, size_t border )
+	inline void FAST::detect10( const Image& img, uint8_t threshold, FeatureSetWrapper& features, size_t border, size_t y0, size_t y1 )
 	{
 		size_t stride;
 		const uint8_t * im = img.map( &stride );
 
 		size_t x, y;
 		size_t xsize = img.width() - border;
-		size_t ysize = img.height() - border;
+		size_t ysize = Math::min( img.height() - border, y1 );
 
 		int offsets[ 16 ];
 		make_offsets( offsets, stride );
 
-		for( y=border; y < ysize; y++ ){
+		for( y = Math::max( border, y0 ); y < ysize; y++ ){
 			for( x=border; x < xsize; x++ ){
 				const uint8_t* p = im + y*stride + x;
 
@@ -422,19 +415,19 @@ namespace cvt
 		img.unmap( im );
 	}
 
-	inline void FAST::detect11( const Image& img, uint8_t threshold, FeatureSetWrapper& features, size_t border )
+	inline void FAST::detect11( const Image& img, uint8_t threshold, FeatureSetWrapper& features, size_t border, size_t y0, size_t y1 )
 	{
 		size_t stride;
 		const uint8_t * im = img.map( &stride );
 
 		size_t x, y;
 		size_t xsize = img.width() - border;
-		size_t ysize = img.height() - border;
+		size_t ysize = Math::min( img.height() - border, y1 );
 
 		int offsets[ 16 ];
 		make_offsets( offsets, stride );
 
-		for( y=border; y < ysize; y++ ){
+		for( y = Math::max( border, y0 ); y < ysize; y++ ){
 			for( x=border; x < xsize; x++ ){
 				const uint8_t* p = im + y*stride + x;
 
@@ -445,19 +438,19 @@ namespace cvt
 		img.unmap( im );
 	}
 
-	inline void FAST::detect12( const Image& img, uint8_t threshold, FeatureSetWrapper& features, size_t border )
+	inline void FAST::detect12( const Image& img, uint8_t threshold, FeatureSetWrapper& features, size_t border, size_t y0, size_t y1 )
 	{
 		size_t stride;
 		const uint8_t * im = img.map( &stride );
 
 		size_t x, y;
 		size_t xsize = img.width() - border;
-		size_t ysize = img.height() - border;
+		size_t ysize = Math::min( img.height() - border, y1 );
 
 		int offsets[ 16 ];
 		make_offsets( offsets, stride );
 
-		for( y=border; y < ysize; y++ ){
+		for( y = Math::max( border, y0 ); y < ysize; y++ ){
 			for( x=border; x < xsize; x++ ){
 				const uint8_t* p = im + y*stride + x;
 
@@ -57,19 +57,29 @@ namespace cvt
 			void setBorder( size_t border )			{ _border = Math::max<size_t>( border, 3 ); }
 			size_t border() const					{ return _border; }
 
+			/* suppress features with a stronger one within radius while detecting, 0 disables */
+			void setNMSRadius( size_t radius )		{ _nmsRadius = radius; }
+			size_t nmsRadius() const				{ return _nmsRadius; }
+
 		private:
+			template<class> friend class FeatureBands;
+
             FASTSize    _fastSize;
 			uint8_t		_threshold;
             size_t		_border;
+			size_t		_nmsRadius;
 
             static void make_offsets( int * offsets, size_t row_stride );
 
-			static void detect9( const Image& img, uint8_t threshold, FeatureSetWrapper& features, size_t border = 3 );
-			static void detect9cpu( const Image& img, uint8_t threshold, FeatureSetWrapper& features, size_t border = 3 );
-			static void detect9simd( const Image& img, uint8_t threshold, FeatureSetWrapper& features, size_t border = 3 );
-			static void detect10( const Image& img, uint8_t threshold, FeatureSetWrapper& features, size_t border = 3 );
-			static void detect11( const Image& img, uint8_t threshold, FeatureSetWrapper& features, size_t border = 3 );
-			static void detect12( const Image& img, uint8_t threshold, FeatureSetWrapper& features, size_t border = 3 );
+			void detectRows( FeatureSetWrapper& features, const Image& img, size_t octave, size_t y0, size_t y1 ) const;
+
+			/* detect on the rows [ y0, y1 ) without the border */
+			static void detect9( const Image& img, uint8_t threshold, FeatureSetWrapper& features, size_t border, size_t y0, size_t y1 );
+			static void detect9cpu( const Image& img, uint8_t threshold, FeatureSetWrapper& features, size_t border, size_t y0, size_t y1 );
+			static void detect9simd( const Image& img, uint8_t threshold, FeatureSetWrapper& features, size_t border, size_t y0, size_t y1 );
+			static void detect10( const Image& img, uint8_t threshold, FeatureSetWrapper& features, size_t border, size_t y0, size_t y1 );
+			static void detect11( const Image& img, uint8_t threshold, FeatureSetWrapper& features, size_t border, size_t y0, size_t y1 );
+			static void detect12( const Image& img, uint8_t threshold, FeatureSetWrapper& features, size_t border, size_t y0, size_t y1 );
 
             static int score9Pixel( const uint8_t* p, const int * offsets, uint8_t threshold );
             static int score10Pixel( const uint8_t* p, const int * offsets, uint8_t threshold );
@@ -0,0 +1,151 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/vision/features/FAST.h>
+#include <cvt/vision/features/AGAST.h>
+#include <cvt/vision/features/agast/OAST9_16.h>
+#include <cvt/vision/ImagePyramid.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/util/CVTTest.h>
+
+#include <stdlib.h>
+
+using namespace cvt;
+
+/* random rectangles on noise */
+static void _fill( Image& img )
+{
+	IMapScoped<uint8_t> map( img );
+	for( size_t y = 0; y < img.height(); y++ ) {
+		for( size_t x = 0; x < img.width(); x++ )
+			map.ptr()[ x ] = 100 + rand() % 8;
+		map++;
+	}
+
+	for( size_t i = 0; i < 60; i++ ) {
+		size_t x0 = rand() % img.width();
+		size_t y0 = rand() % img.height();
+		size_t x1 = Math::min( img.width(), x0 + 4 + rand() % 30 );
+		size_t y1 = Math::min( img.height(), y0 + 4 + rand() % 30 );
+		uint8_t v = rand() % 256;
+		for( size_t y = y0; y < y1; y++ ) {
+			map.setLine( y );
+			for( size_t x = x0; x < x1; x++ )
+				map.ptr()[ x ] = v;
+		}
+	}
+}
+
+static bool _equal( const FeatureSet& a, const FeatureSet& b )
+{
+	if( a.size() != b.size() )
+		return false;
+	for( size_t i = 0; i < a.size(); i++ ) {
+		if( a[ i ].pt != b[ i ].pt || a[ i ].score != b[ i ].score || a[ i ].octave != b[ i ].octave )
+			return false;
+	}
+	return true;
+}
+
+/* features of every octave in row order, octaves in ascending order */
+static bool _ordered( const FeatureSet& set, const ImagePyramid& pyr )
+{
+	for( size_t i = 1; i < set.size(); i++ ) {
+		const Feature& p = set[ i - 1 ];
+		const Feature& c = set[ i ];
+		if( p.octave != c.octave ) {
+			if( p.octave > c.octave )
+				return false;
+			continue;
+		}
+		float s = Math::pow( pyr.scaleFactor(), ( float ) c.octave );
+		int py = Math::round( p.pt.y * s ), cy = Math::round( c.pt.y * s );
+		if( py > cy || ( py == cy && Math::round( p.pt.x * s ) >= Math::round( c.pt.x * s ) ) )
+			return false;
+	}
+	return set.size() > 0;
+}
+
+BEGIN_CVTTEST( FAST )
+	bool result = true;
+	bool b;
+
+	srand( 1 );
+	Image img( 320, 240, IFormat::GRAY_UINT8 );
+	_fill( img );
+	ImagePyramid pyr( 4, 0.7f );
+	pyr.update( img );
+
+	/* AGAST against the serial detector, octave by octave */
+	{
+		AGAST agast( AGAST::OAST_9_16, 20 );
+		FeatureSet banded, serial;
+		agast.detect( banded, pyr );
+
+		OAST9_16 oast;
+		for( size_t o = 0; o < pyr.octaves(); o++ ) {
+			FeatureSetWrapper wrap( serial, Math::pow( pyr.scaleFactor(), -( float ) o ), o );
+			oast.detect( pyr[ o ], 20, wrap, 3 );
+		}
+		b = _ordered( banded, pyr ) && _equal( banded, serial );
+		CVTTEST_PRINT( "AGAST pyramid", b );
+		result &= b;
+	}
+
+	{
+		FAST fast( SEGMENT_9, 20 );
+		FeatureSet first, second;
+		fast.detect( first, pyr );
+		fast.detect( second, pyr );
+		b = _ordered( first, pyr ) && _equal( first, second );
+		CVTTEST_PRINT( "FAST pyramid order", b );
+		result &= b;
+	}
+
+	{
+		FAST fast( SEGMENT_9, 20 );
+		FeatureSet all, nms;
+		fast.detect( all, img );
+		all.filterNMS( 3, true );
+		fast.setNMSRadius( 3 );
+		fast.detect( nms, img );
+		b = nms.size() > 0 && _equal( all, nms );
+		CVTTEST_PRINT( "FAST suppression", b );
+		result &= b;
+	}
+
+	{
+		AGAST agast( AGAST::AGAST_7_12d, 20 );
+		FeatureSet all, nms;
+		agast.detect( all, img );
+		all.filterNMS( 3, true );
+		agast.setNMSRadius( 3 );
+		agast.detect( nms, img );
+		b = nms.size() > 0 && _equal( all, nms );
+		CVTTEST_PRINT( "AGAST suppression", b );
+		result &= b;
+	}
+
+	return result;
+END_CVTTEST
@@ -0,0 +1,192 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_FEATUREBANDS_H
+#define CVT_FEATUREBANDS_H
+
+#include <cvt/vision/features/FeatureSet.h>
+#include <cvt/gfx/Image.h>
+#include <cvt/util/ParallelFor.h>
+#include <cvt/util/ThreadPool.h>
+#include <cvt/math/Math.h>
+
+#include <vector>
+#include <algorithm>
+
+namespace cvt {
+
+	/**
+	  \brief Concurrent detection on row bands of one or more octaves.
+
+	  Every band is detected into its own buffer. With a suppression radius a band also
+	  detects the rows within that radius around it and suppresses non-maxima in place,
+	  which gives the same result as FeatureSet::filterNMS on the whole octave. The
+	  buffers are appended in octave and row order, so the output does not depend on
+	  the scheduling.
+
+	  DETECTOR has to provide
+	  void detectRows( FeatureSetWrapper& features, const Image& img, size_t octave, size_t y0, size_t y1 ) const
+	 */
+	template<class DETECTOR>
+	class FeatureBands
+	{
+		public:
+			FeatureBands( const DETECTOR& detector, size_t nmsRadius = 0 );
+
+			/* octaves are numbered in the order they are added */
+			void addOctave( const Image& img, float scale );
+			void detect( FeatureSet& features ) const;
+
+		private:
+			struct Band {
+				size_t octave;
+				size_t y0;
+				size_t y1;
+			};
+
+			class Body
+			{
+				public:
+					Body( const FeatureBands& bands, std::vector<FeatureSet>& results ) : _bands( bands ), _results( results )
+					{
+					}
+
+					void operator()( const Range<size_t>& r ) const
+					{
+						for( size_t i = r.min; i < r.max; i++ )
+							_bands.detectBand( _results[ i ], _bands._bands[ i ] );
+					}
+
+				private:
+					const FeatureBands&			_bands;
+					std::vector<FeatureSet>&	_results;
+			};
+
+			void detectBand( FeatureSet& dst, const Band& band ) const;
+
+			const DETECTOR&				_detector;
+			size_t						_nmsRadius;
+			std::vector<const Image*>	_images;
+			std::vector<float>			_scales;
+			std::vector<Band>			_bands;
+	};
+
+	template<class DETECTOR>
+	inline FeatureBands<DETECTOR>::FeatureBands( const DETECTOR& detector, size_t nmsRadius ) :
+		_detector( detector ),
+		_nmsRadius( nmsRadius )
+	{
+	}
+
+	template<class DETECTOR>
+	inline void FeatureBands<DETECTOR>::addOctave( const Image& img, float scale )
+	{
+		const size_t h = img.height();
+		const size_t threads = ThreadPool::hardwareConcurrency();
+		/* the suppression halo is detected twice, keep the bands well above it */
+		const size_t rows = Math::max( 16 + 4 * _nmsRadius, ( h + 2 * threads - 1 ) / ( 2 * threads ) );
+
+		Band band;
+		band.octave = _images.size();
+		for( size_t y = 0; y < h; y += rows ) {
+			band.y0 = y;
+			band.y1 = Math::min( h, y + rows );
+			_bands.push_back( band );
+		}
+		_images.push_back( &img );
+		_scales.push_back( scale );
+	}
+
+	template<class DETECTOR>
+	inline void FeatureBands<DETECTOR>::detect( FeatureSet& features ) const
+	{
+		std::vector<FeatureSet> results( _bands.size() );
+		parallelFor( Range<size_t>( 0, _bands.size() ), Body( *this, results ), 1 );
+
+		for( size_t i = 0; i < results.size(); i++ ) {
+			for( size_t k = 0; k < results[ i ].size(); k++ )
+				features.add( results[ i ][ k ] );
+		}
+	}
+
+	template<class DETECTOR>
+	inline void FeatureBands<DETECTOR>::detectBand( FeatureSet& dst, const Band& band ) const
+	{
+		const Image& img = *_images[ band.octave ];
+		FeatureSetWrapper out( dst, _scales[ band.octave ], band.octave );
+
+		if( !_nmsRadius ) {
+			_detector.detectRows( out, img, band.octave, band.y0, band.y1 );
+			return;
+		}
+
+		const int r = ( int ) _nmsRadius;
+		const size_t ya = band.y0 > _nmsRadius ? band.y0 - _nmsRadius : 0;
+		const size_t yb = Math::min( img.height(), band.y1 + _nmsRadius );
+
+		FeatureSet local;
+		FeatureSetWrapper localwrap( local );
+		_detector.detectRows( localwrap, img, band.octave, ya, yb );
+
+		FeatureSet::CmpPosi cmppos;
+		std::sort( local.begin(), local.end(), cmppos );
+
+		/* first feature of every row of [ ya, yb ] */
+		std::vector<size_t> rowstart( yb - ya + 1 );
+		size_t i = 0;
+		for( size_t y = ya; y <= yb; y++ ) {
+			while( i < local.size() && ( size_t ) local[ i ].pt.y < y )
+				i++;
+			rowstart[ y - ya ] = i;
+		}
+
+		FeatureSet::CmpXi cmpx;
+		for( size_t y = band.y0; y < band.y1; y++ ) {
+			for( size_t k = rowstart[ y - ya ]; k < rowstart[ y + 1 - ya ]; k++ ) {
+				const Feature& f = local[ k ];
+				const int fx = ( int ) f.pt.x;
+				const size_t ny0 = Math::max<int>( ( int ) ya, ( int ) y - r );
+				const size_t ny1 = Math::min<int>( ( int ) yb, ( int ) y + r + 1 );
+				bool maximum = true;
+
+				Feature lower( fx - r, 0 );
+				for( size_t ny = ny0; ny < ny1 && maximum; ny++ ) {
+					FeatureSet::const_iterator it = std::lower_bound( local.begin() + rowstart[ ny - ya ], local.begin() + rowstart[ ny + 1 - ya ], lower, cmpx );
+					FeatureSet::const_iterator end = local.begin() + rowstart[ ny + 1 - ya ];
+					for( ; it != end && ( int ) it->pt.x <= fx + r; ++it ) {
+						if( it->score > f.score ) {
+							maximum = false;
+							break;
+						}
+					}
+				}
+
+				if( maximum )
+					out( f.pt.x, f.pt.y, f.score );
+			}
+		}
+	}
+}
+
+#endif
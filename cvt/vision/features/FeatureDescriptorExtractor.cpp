@@ -0,0 +1,56 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/vision/features/FeatureDescriptorExtractor.h>
+#include <cvt/vision/features/MatchBruteForce.h>
+
+namespace cvt {
+
+	const DescriptorBlock& FeatureDescriptorExtractor::descriptorBlock() const
+	{
+		_defaultBlock.clear();
+		_defaultBlock.reserve( size() );
+		for( size_t i = 0; i < size(); i++ )
+			_defaultBlock.add( ( *this )[ i ] );
+		return _defaultBlock;
+	}
+
+	void FeatureDescriptorExtractor::matchInWindow( std::vector<MatchingIndices>& matches,
+													const DescriptorBlock& other,
+													float maxFeatureDist,
+													float maxDescDistance ) const
+	{
+		FeatureMatcher::matchInWindow( matches, other, descriptorBlock(), maxFeatureDist, maxDescDistance );
+	}
+
+	void FeatureDescriptorExtractor::matchInWindow( std::vector<MatchingIndices>& matches,
+													const RowLookupTable& rlt,
+													const DescriptorBlock& other,
+													float maxFeatureDist,
+													float maxDescDistance ) const
+	{
+		FeatureMatcher::matchInWindow( matches, rlt, other, descriptorBlock(), maxFeatureDist, maxDescDistance );
+	}
+
+}
@@ -27,6 +27,8 @@
 
 #include <cvt/vision/features/FeatureMatch.h>
 #include <cvt/vision/features/FeatureDescriptor.h>
+#include <cvt/vision/features/FeatureSet.h>
+#include <cvt/vision/features/DescriptorBlock.h>
 #include <cvt/gfx/Image.h>
 #include <cvt/vision/ImagePyramid.h>
 
@@ -43,6 +45,14 @@ namespace cvt {
 			virtual FeatureDescriptor&			operator[]( size_t i ) = 0;
 			virtual const FeatureDescriptor&	operator[]( size_t i ) const = 0;
 
+			/*
+			   the descriptors packed into contiguous rows, same order as operator[]
+			   references returned by the non-const operator[] must not be modified after descriptorBlock()
+			   was called, request them again to make the modification visible in the next block
+			   the default implementation packs the descriptors on every call and is not safe for concurrent callers
+			 */
+			virtual const DescriptorBlock&		descriptorBlock() const;
+
 			virtual void clear() = 0;
 			virtual void extract( const Image& img, const FeatureSet& features ) = 0;
             virtual void extract( const ImagePyramid& pyr, const FeatureSet& features ) = 0;
@@ -62,6 +72,17 @@ namespace cvt {
 										float maxFeatureDist,
 										float maxDescDistance ) const = 0;
 
+			virtual void matchInWindow( std::vector<MatchingIndices>& matches,
+										const DescriptorBlock& other,
+										float maxFeatureDist,
+										float maxDescDistance ) const;
+
+			virtual void matchInWindow( std::vector<MatchingIndices>& matches,
+										const RowLookupTable& rlt,
+										const DescriptorBlock& other,
+										float maxFeatureDist,
+										float maxDescDistance ) const;
+
 			virtual void scanLineMatch( std::vector<FeatureMatch>& matches,
 										const std::vector<const FeatureDescriptor*>& left,
 										float minDisp,
@@ -94,6 +115,9 @@ namespace cvt {
 						return ( int )f1.pt.y < ( int )f2.pt.y;
 					}
 			};
+
+		private:
+			mutable DescriptorBlock				_defaultBlock;
 	};
 }
 
@@ -0,0 +1,398 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_MIHINDEX_H
+#define CVT_MIHINDEX_H
+
+#include <vector>
+#include <algorithm>
+#include <string.h>
+#include <cvt/util/SIMD.h>
+#include <cvt/util/Exception.h>
+#include <cvt/math/Math.h>
+#include <cvt/vision/features/FeatureDescriptor.h>
+
+namespace cvt {
+
+	/**
+	  Multi-index hashing of binary descriptors with N bytes (N even).
+
+	  Every descriptor is split into N / 2 substrings of 16 bits, each substring
+	  indexes a table of 65536 buckets. The tables are stored compressed, one offset
+	  array and one contiguous row array each, and are rebuilt by a counting pass
+	  before a query after removals or many insertions; the few rows inserted since
+	  the last rebuild are scanned directly. A descriptor within Hamming distance r
+	  of the query matches at least one substring within distance r / ( N / 2 ),
+	  so k-NN and radius queries only probe small neighbourhoods of the query
+	  substrings and verify the candidates with the full distance.
+
+	  MIHIndex<32> holds ORB descriptors, MIHIndex<N> the ones of BRIEF<N>.
+	  Queries use internal scratch space and must not run concurrently.
+	 */
+	template<size_t N>
+	class MIHIndex {
+		public:
+			typedef FeatureDescriptorInternal<N, uint8_t, FEATUREDESC_CMP_HAMMING> Descriptor;
+
+			struct Match {
+				size_t id;
+				size_t distance;
+			};
+
+			MIHIndex();
+			~MIHIndex();
+
+			size_t	size() const;
+			bool	contains( size_t id ) const;
+			void	clear();
+
+			/* insert or replace the descriptor with the given id */
+			void	insert( size_t id, const uint8_t* desc );
+			void	insert( size_t id, const Descriptor& desc );
+			void	insert( size_t id, const FeatureDescriptor& desc );
+			void	remove( size_t id );
+
+			/* the k nearest descriptors sorted by distance, ties by id */
+			void	knn( std::vector<Match>& matches, const uint8_t* query, size_t k ) const;
+			/* all descriptors within distance radius sorted by distance */
+			void	radius( std::vector<Match>& matches, const uint8_t* query, size_t radius ) const;
+
+		private:
+			MIHIndex( const MIHIndex& );
+			MIHIndex& operator=( const MIHIndex& );
+
+			enum { NUMTABLES = N / 2, SUBBITS = 16, NUMBUCKETS = 1 << SUBBITS };
+
+			static size_t	key( const uint8_t* desc, size_t table );
+			const uint8_t*	code( size_t row ) const;
+			void			nextStamp() const;
+			void			update() const;
+			template<typename VISITOR>
+			void			probePending( VISITOR& visitor ) const;
+			template<typename VISITOR>
+			void			probe( VISITOR& visitor, const uint8_t* query, size_t table, size_t subradius ) const;
+
+			struct KNNVisitor;
+			struct RadiusVisitor;
+
+			/* bucket b of table t holds _rows[ t ][ _offsets[ t ][ b ] ... _offsets[ t ][ b + 1 ] ) */
+			mutable std::vector<uint32_t> _offsets[ NUMTABLES ];
+			mutable std::vector<uint32_t> _rows[ NUMTABLES ];
+			/* rows in the tables, later rows are pending */
+			mutable size_t			_built;
+			mutable bool			_dirty;
+			std::vector<uint8_t>	_codes;
+			std::vector<size_t>		_ids;
+			std::vector<size_t>		_rowForId;
+			mutable std::vector<uint32_t> _stamps;
+			mutable uint32_t		_stamp;
+			SIMD*					_simd;
+	};
+
+	template<size_t N>
+	static inline bool _mihMatchCompare( const typename MIHIndex<N>::Match& a, const typename MIHIndex<N>::Match& b )
+	{
+		return a.distance < b.distance || ( a.distance == b.distance && a.id < b.id );
+	}
+
+	template<size_t N>
+	struct MIHIndex<N>::KNNVisitor {
+		KNNVisitor( const MIHIndex<N>& index, const uint8_t* query, std::vector<Match>& best, size_t k ) :
+			_index( index ), _query( query ), _best( best ), _k( k )
+		{
+		}
+
+		void operator()( uint32_t row )
+		{
+			Match m;
+			m.id = _index._ids[ row ];
+			m.distance = _index._simd->hammingDistance( _query, _index.code( row ), N );
+			if( _best.size() == _k && !_mihMatchCompare<N>( m, _best.back() ) )
+				return;
+
+			if( _best.size() < _k )
+				_best.push_back( m );
+			else
+				_best.back() = m;
+			/* keep the list sorted, insertion from the back */
+			for( size_t i = _best.size() - 1; i > 0 && _mihMatchCompare<N>( _best[ i ], _best[ i - 1 ] ); i-- )
+				std::swap( _best[ i - 1 ], _best[ i ] );
+		}
+
+		const MIHIndex<N>&	_index;
+		const uint8_t*		_query;
+		std::vector<Match>&	_best;
+		size_t				_k;
+	};
+
+	template<size_t N>
+	struct MIHIndex<N>::RadiusVisitor {
+		RadiusVisitor( const MIHIndex<N>& index, const uint8_t* query, std::vector<Match>& matches, size_t radius ) :
+			_index( index ), _query( query ), _matches( matches ), _radius( radius )
+		{
+		}
+
+		void operator()( uint32_t row )
+		{
+			size_t dist = _index._simd->hammingDistance( _query, _index.code( row ), N );
+			if( dist <= _radius ) {
+				Match m;
+				m.id = _index._ids[ row ];
+				m.distance = dist;
+				_matches.push_back( m );
+			}
+		}
+
+		const MIHIndex<N>&	_index;
+		const uint8_t*		_query;
+		std::vector<Match>&	_matches;
+		size_t				_radius;
+	};
+
+	template<size_t N>
+	inline MIHIndex<N>::MIHIndex() :
+		_built( 0 ),
+		_dirty( false ),
+		_stamp( 0 ),
+		_simd( SIMD::instance() )
+	{
+		if( N == 0 || ( N & 1 ) )
+			throw CVTException( "MIHIndex: descriptor length has to be a multiple of 2 bytes" );
+	}
+
+	template<size_t N>
+	inline MIHIndex<N>::~MIHIndex()
+	{
+	}
+
+	template<size_t N>
+	inline size_t MIHIndex<N>::size() const
+	{
+		return _ids.size();
+	}
+
+	template<size_t N>
+	inline bool MIHIndex<N>::contains( size_t id ) const
+	{
+		return id < _rowForId.size() && _rowForId[ id ] != ( size_t ) -1;
+	}
+
+	template<size_t N>
+	inline void MIHIndex<N>::clear()
+	{
+		for( size_t t = 0; t < NUMTABLES; t++ ) {
+			std::vector<uint32_t>().swap( _offsets[ t ] );
+			std::vector<uint32_t>().swap( _rows[ t ] );
+		}
+		_built = 0;
+		_dirty = false;
+		_codes.clear();
+		_ids.clear();
+		_rowForId.clear();
+		_stamps.clear();
+	}
+
+	template<size_t N>
+	inline size_t MIHIndex<N>::key( const uint8_t* desc, size_t table )
+	{
+		return ( size_t ) desc[ 2 * table ] | ( ( size_t ) desc[ 2 * table + 1 ] << 8 );
+	}
+
+	template<size_t N>
+	inline const uint8_t* MIHIndex<N>::code( size_t row ) const
+	{
+		return &_codes[ row * N ];
+	}
+
+	template<size_t N>
+	inline void MIHIndex<N>::insert( size_t id, const Descriptor& desc )
+	{
+		insert( id, desc.desc );
+	}
+
+	template<size_t N>
+	inline void MIHIndex<N>::insert( size_t id, const FeatureDescriptor& desc )
+	{
+		if( desc.length() != N || desc.compareType() != FEATUREDESC_CMP_HAMMING )
+			throw CVTException( "MIHIndex: descriptor type does not match index" );
+		insert( id, desc.ptr() );
+	}
+
+	template<size_t N>
+	inline void MIHIndex<N>::insert( size_t id, const uint8_t* desc )
+	{
+		if( contains( id ) )
+			remove( id );
+
+		uint32_t row = ( uint32_t ) _ids.size();
+		_codes.insert( _codes.end(), desc, desc + N );
+		_ids.push_back( id );
+		_stamps.push_back( 0 );
+		if( id >= _rowForId.size() )
+			_rowForId.resize( id + 1, ( size_t ) -1 );
+		_rowForId[ id ] = row;
+	}
+
+	template<size_t N>
+	inline void MIHIndex<N>::remove( size_t id )
+	{
+		if( !contains( id ) )
+			return;
+
+		uint32_t row = ( uint32_t ) _rowForId[ id ];
+		uint32_t last = ( uint32_t ) _ids.size() - 1;
+
+		/* move the last row into the hole, the tables are rebuilt on the next query */
+		_dirty = true;
+		if( row != last ) {
+			memcpy( &_codes[ row * N ], code( last ), N );
+			_ids[ row ] = _ids[ last ];
+			_rowForId[ _ids[ row ] ] = row;
+		}
+
+		_codes.resize( last * N );
+		_ids.pop_back();
+		_stamps.pop_back();
+		_rowForId[ id ] = ( size_t ) -1;
+	}
+
+	template<size_t N>
+	inline void MIHIndex<N>::nextStamp() const
+	{
+		if( ++_stamp == 0 ) {
+			std::fill( _stamps.begin(), _stamps.end(), 0 );
+			_stamp = 1;
+		}
+	}
+
+	template<size_t N>
+	inline void MIHIndex<N>::update() const
+	{
+		size_t rows = _ids.size();
+		if( !_dirty && ( rows - _built ) <= 256 + _built / 16 )
+			return;
+
+		std::vector<uint32_t> fill;
+		for( size_t t = 0; t < NUMTABLES; t++ ) {
+			std::vector<uint32_t>& offsets = _offsets[ t ];
+			offsets.assign( NUMBUCKETS + 1, 0 );
+			for( size_t row = 0; row < rows; row++ )
+				offsets[ key( code( row ), t ) + 1 ]++;
+			for( size_t b = 0; b < NUMBUCKETS; b++ )
+				offsets[ b + 1 ] += offsets[ b ];
+
+			fill.assign( offsets.begin(), offsets.end() - 1 );
+			_rows[ t ].resize( rows );
+			for( size_t row = 0; row < rows; row++ )
+				_rows[ t ][ fill[ key( code( row ), t ) ]++ ] = ( uint32_t ) row;
+		}
+		_built = rows;
+		_dirty = false;
+	}
+
+	template<size_t N>
+	template<typename VISITOR>
+	inline void MIHIndex<N>::probePending( VISITOR& visitor ) const
+	{
+		for( size_t row = _built; row < _ids.size(); row++ ) {
+			_stamps[ row ] = _stamp;
+			visitor( ( uint32_t ) row );
+		}
+	}
+
+	template<size_t N>
+	template<typename VISITOR>
+	inline void MIHIndex<N>::probe( VISITOR& visitor, const uint8_t* query, size_t table, size_t subradius ) const
+	{
+		if( !_built )
+			return;
+
+		const uint32_t* offsets = &_offsets[ table ][ 0 ];
+		const uint32_t* rows = &_rows[ table ][ 0 ];
+		size_t qkey = key( query, table );
+
+		/* enumerate all 16bit masks with subradius bits set */
+		size_t mask = ( ( size_t ) 1 << subradius ) - 1;
+		while( mask < NUMBUCKETS ) {
+			size_t bucket = qkey ^ mask;
+			for( size_t i = offsets[ bucket ]; i < offsets[ bucket + 1 ]; i++ ) {
+				uint32_t row = rows[ i ];
+				if( _stamps[ row ] != _stamp ) {
+					_stamps[ row ] = _stamp;
+					visitor( row );
+				}
+			}
+
+			if( !mask )
+				break;
+			size_t t = mask | ( mask - 1 );
+			mask = ( t + 1 ) | ( ( ( ~t & ( t + 1 ) ) - 1 ) >> ( __builtin_ctzl( mask ) + 1 ) );
+		}
+	}
+
+	template<size_t N>
+	inline void MIHIndex<N>::knn( std::vector<Match>& matches, const uint8_t* query, size_t k ) const
+	{
+		matches.clear();
+		k = Math::min( k, size() );
+		if( !k )
+			return;
+
+		update();
+		nextStamp();
+		KNNVisitor visitor( *this, query, matches, k );
+		probePending( visitor );
+		for( size_t s = 0; s <= SUBBITS; s++ ) {
+			for( size_t t = 0; t < NUMTABLES; t++ ) {
+				probe( visitor, query, t, s );
+				/* every descriptor not seen so far has at least this distance */
+				size_t bound = NUMTABLES * s + t + 1;
+				if( matches.size() == k && matches.back().distance < bound )
+					return;
+			}
+		}
+	}
+
+	template<size_t N>
+	inline void MIHIndex<N>::radius( std::vector<Match>& matches, const uint8_t* query, size_t radius ) const
+	{
+		matches.clear();
+		if( !size() )
+			return;
+
+		update();
+		nextStamp();
+		RadiusVisitor visitor( *this, query, matches, radius );
+		probePending( visitor );
+		size_t subradius = Math::min( radius / NUMTABLES, ( size_t ) SUBBITS );
+		for( size_t s = 0; s <= subradius; s++ ) {
+			for( size_t t = 0; t < NUMTABLES; t++ )
+				probe( visitor, query, t, s );
+		}
+		std::sort( matches.begin(), matches.end(), _mihMatchCompare<N> );
+	}
+
+}
+
+#endif
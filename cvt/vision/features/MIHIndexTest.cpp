@@ -0,0 +1,161 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/vision/features/MIHIndex.h>
+#include <cvt/util/CVTTest.h>
+
+using namespace cvt;
+
+#define NUMDESC 3000
+
+static void _randomCodes( std::vector<uint8_t>& codes )
+{
+	codes.resize( NUMDESC * 32 );
+	for( size_t i = 0; i < NUMDESC; i++ ) {
+		uint8_t* c = &codes[ i * 32 ];
+		if( i >= 100 && i % 3 == 0 ) {
+			/* perturbed copy of an earlier descriptor */
+			memcpy( c, &codes[ ( i / 7 ) * 32 ], 32 );
+			size_t flips = Math::rand( 0, 40 );
+			for( size_t f = 0; f < flips; f++ ) {
+				size_t bit = Math::rand( 0, 256 );
+				c[ bit >> 3 ] ^= 1 << ( bit & 7 );
+			}
+		} else {
+			for( size_t k = 0; k < 32; k++ )
+				c[ k ] = ( uint8_t ) Math::rand( 0, 256 );
+		}
+	}
+}
+
+static bool _knnTest( const MIHIndex<32>& index, const std::vector<uint8_t>& codes, const std::vector<bool>& present, size_t k )
+{
+	SIMD* simd = SIMD::instance();
+	std::vector<MIHIndex<32>::Match> matches;
+	bool b = true;
+
+	for( size_t q = 0; q < 50; q++ ) {
+		const uint8_t* query = &codes[ q * 61 * 32 ];
+
+		/* ties are broken by id */
+		std::vector<std::pair<size_t, size_t> > ref;
+		for( size_t i = 0; i < NUMDESC; i++ ) {
+			if( present[ i ] )
+				ref.push_back( std::make_pair( simd->hammingDistance( query, &codes[ i * 32 ], 32 ), i ) );
+		}
+		std::sort( ref.begin(), ref.end() );
+
+		index.knn( matches, query, k );
+		b &= matches.size() == Math::min( k, ref.size() );
+		for( size_t i = 0; b && i < matches.size(); i++ ) {
+			b &= matches[ i ].distance == ref[ i ].first;
+			b &= matches[ i ].id == ref[ i ].second;
+		}
+	}
+	return b;
+}
+
+static bool _radiusTest( const MIHIndex<32>& index, const std::vector<uint8_t>& codes, const std::vector<bool>& present, size_t radius )
+{
+	SIMD* simd = SIMD::instance();
+	std::vector<MIHIndex<32>::Match> matches;
+	bool b = true;
+
+	for( size_t q = 0; q < 50; q++ ) {
+		const uint8_t* query = &codes[ q * 59 * 32 ];
+
+		size_t num = 0;
+		for( size_t i = 0; i < NUMDESC; i++ ) {
+			if( present[ i ] && simd->hammingDistance( query, &codes[ i * 32 ], 32 ) <= radius )
+				num++;
+		}
+
+		index.radius( matches, query, radius );
+		b &= matches.size() == num;
+		for( size_t i = 0; b && i < matches.size(); i++ ) {
+			b &= matches[ i ].distance <= radius;
+			b &= present[ matches[ i ].id ];
+			if( i )
+				b &= matches[ i - 1 ].distance <= matches[ i ].distance;
+		}
+	}
+	return b;
+}
+
+BEGIN_CVTTEST( MIHIndex )
+	bool testResult = true;
+	bool b;
+
+	std::vector<uint8_t> codes;
+	_randomCodes( codes );
+
+	MIHIndex<32> index;
+	std::vector<bool> present( NUMDESC, true );
+	for( size_t i = 0; i < NUMDESC; i++ )
+		index.insert( i, &codes[ i * 32 ] );
+
+	b = index.size() == NUMDESC;
+	b &= _knnTest( index, codes, present, 1 );
+	b &= _knnTest( index, codes, present, 5 );
+	CVTTEST_PRINT( "knn", b );
+	testResult &= b;
+
+	b = _radiusTest( index, codes, present, 30 );
+	b &= _radiusTest( index, codes, present, 70 );
+	CVTTEST_PRINT( "radius", b );
+	testResult &= b;
+
+	/* remove every other descriptor and reinsert a few */
+	for( size_t i = 0; i < NUMDESC; i += 2 ) {
+		index.remove( i );
+		present[ i ] = false;
+	}
+	for( size_t i = 0; i < NUMDESC; i += 10 ) {
+		index.insert( i, &codes[ i * 32 ] );
+		present[ i ] = true;
+	}
+	index.insert( 1, &codes[ 1 * 32 ] );
+
+	size_t num = 0;
+	for( size_t i = 0; i < NUMDESC; i++ )
+		num += present[ i ] ? 1 : 0;
+	b = index.size() == num;
+	b &= !index.contains( 2 ) && index.contains( 10 );
+	b &= _knnTest( index, codes, present, 3 );
+	b &= _radiusTest( index, codes, present, 40 );
+	CVTTEST_PRINT( "remove/insert", b );
+	testResult &= b;
+
+	/* a few insertions after a query are not merged into the tables yet */
+	for( size_t i = 2; i < 100; i += 10 ) {
+		index.insert( i, &codes[ i * 32 ] );
+		present[ i ] = true;
+	}
+	b = _knnTest( index, codes, present, 3 );
+	b &= _radiusTest( index, codes, present, 40 );
+	CVTTEST_PRINT( "pending insert", b );
+	testResult &= b;
+
+	return testResult;
+END_CVTTEST
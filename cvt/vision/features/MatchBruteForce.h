@@ -26,60 +26,78 @@
 #define CVT_FEATURE_MATCHER_INL
 
 #include <cvt/vision/features/RowLookupTable.h>
+#include <cvt/vision/features/DescriptorBlock.h>
 
 namespace cvt {
 
 	namespace FeatureMatcher {
-		template<typename T, typename DFUNC>
-		static inline void matchBruteForce( std::vector<FeatureMatch>& matches, const std::vector<T>& seta, const std::vector<T>& setb, DFUNC dfunc, float distThreshold )
+		/* descriptor/position access for the different query containers */
+		static inline const uint8_t* queryDescriptor( const std::vector<FeatureDescriptor*>& set, size_t i )
+		{
+			return set[ i ]->ptr();
+		}
+
+		static inline const uint8_t* queryDescriptor( const DescriptorBlock& set, size_t i )
+		{
+			return set.descriptor( i );
+		}
+
+		static inline const Vector2f& queryPosition( const std::vector<FeatureDescriptor*>& set, size_t i )
+		{
+			return set[ i ]->pt;
+		}
+
+		static inline const Vector2f& queryPosition( const DescriptorBlock& set, size_t i )
+		{
+			return set.position( i );
+		}
+
+		template<typename T>
+		static inline void matchBruteForce( std::vector<FeatureMatch>& matches, const std::vector<T>& seta, const std::vector<T>& setb, const DescriptorBlock& blockb, float distThreshold )
 		{
 			matches.reserve( seta.size() );
+			if( !blockb.size() )
+				return;
+
 			for( size_t i = 0; i < seta.size(); i++ ) {
 				FeatureMatch m;
 				const T& d0 = seta[ i ];
+				size_t k, distance;
 
-				m.feature0 = &d0;
-				m.feature1 = 0;
-				m.distance = distThreshold;
-				for( size_t k = 0; k < setb.size(); k++ ) {
-					const T& d1 = setb[ k ];
-					float distance = dfunc( d0, d1 );
-
-					if( distance < m.distance ) {
-						m.feature1 = &d1;
-						m.distance = distance;
-					}
-				}
-
-				if( m.feature1 )
+				blockb.bestMatch( k, distance, d0.desc, 0, blockb.size() );
+				if( ( float ) distance < distThreshold ) {
+					m.feature0 = &d0;
+					m.feature1 = &setb[ k ];
+					m.distance = distance;
 					matches.push_back( m );
+				}
 			}
 		}
 
-		template<typename T, typename DFUNC>
+		template<typename QUERYSET>
 		static inline void matchInWindow( std::vector<MatchingIndices>& matches,
-										  const std::vector<FeatureDescriptor*>& setA,
-										  const std::vector<T>& setB,
-										  DFUNC dfunc,
+										  const QUERYSET& setA,
+										  const DescriptorBlock& setB,
 										  float maxFeatureDist,
 										  float maxDescDistance )
 		{
 			matches.reserve( setA.size() );
 			MatchingIndices m;
+			SIMD* simd = SIMD::instance();
 			float distanceSquare = Math::sqr( maxFeatureDist );
 			for( size_t i = 0; i < setA.size(); ++i ) {
-				const T& d0 = *( ( const T* )setA[ i ] );
+				const uint8_t* d0 = queryDescriptor( setA, i );
+				const Vector2f& pt0 = queryPosition( setA, i );
 				m.srcIdx = i;
 				m.dstIdx = 0;
 				m.distance = maxDescDistance;
 				for( size_t k = 0; k < setB.size(); ++k ) {
-					const T& d1 = setB[ k ];
 					// euclidean distance
-					float ptDist = ( d1.pt - d0.pt ).lengthSqr();
+					float ptDist = ( setB.position( k ) - pt0 ).lengthSqr();
 					if( ptDist > distanceSquare )
 						continue;
 					// descriptor distance
-					float distance = dfunc( d0, d1 );
+					float distance = simd->hammingDistance( d0, setB.descriptor( k ), setB.length() );
 
 					if( distance < m.distance ) {
 						m.dstIdx = k;
@@ -87,53 +105,60 @@ namespace cvt {
 					}
 				}
 
-				if( m.distance < maxDescDistance ){					
-
+				if( m.distance < maxDescDistance ){
 					matches.push_back( m );
 				}
 			}
 		}
 
-		template<typename T, typename DFUNC>
+		template<typename QUERYSET>
 		static inline void matchInWindow( std::vector<MatchingIndices>& matches,
 										  const RowLookupTable& rlt,
-										  const std::vector<FeatureDescriptor*>& setA,
-										  const std::vector<T>& setB,
-										  DFUNC dfunc,
+										  const QUERYSET& setA,
+										  const DescriptorBlock& setB,
 										  float maxFeatureDist,
 										  float maxDescDistance )
 		{
 			matches.reserve( setA.size() );
 			MatchingIndices m;
 			for( size_t i = 0; i < setA.size(); ++i ) {
-				const T& d0 = *( ( const T* )setA[ i ] );
+				const uint8_t* d0 = queryDescriptor( setA, i );
+				const Vector2f& pt0 = queryPosition( setA, i );
 				m.srcIdx = i;
 				m.dstIdx = 0;
 				m.distance = maxDescDistance;
 
-                float minX = d0.pt.x - maxFeatureDist;
-                float maxX = d0.pt.x + maxFeatureDist;
-                float minY = d0.pt.y - maxFeatureDist;
-				float maxY = d0.pt.y + maxFeatureDist;
+				float minX = pt0.x - maxFeatureDist;
+				float maxX = pt0.x + maxFeatureDist;
+				float minY = pt0.y - maxFeatureDist;
+				float maxY = pt0.y + maxFeatureDist;
 
 				for( int y = minY; y < maxY; ++y ){
 					if( rlt.isValidRow( y ) ){
 						// match all features of this row
 						const RowLookupTable::Row& row = rlt.row( y );
-						int k = row.start;
+						size_t k = row.start;
 						size_t rEnd = k + row.len;
-						for( size_t k = row.start; k < rEnd; ++k ){
-							const T& d1 = setB[ k ];
-							if( d1.pt.x < minX )
+						while( k < rEnd ){
+							if( setB.position( k ).x < minX ){
+								++k;
 								continue;
-							if( d1.pt.x > maxX )
+							}
+							if( setB.position( k ).x > maxX )
 								break;
-							// Match
-							float distance = dfunc( d0, d1 );
-							if( distance < m.distance ) {
-								m.dstIdx = k;
+
+							// match the whole run of features inside [minX, maxX] at once
+							size_t kEnd = k + 1;
+							while( kEnd < rEnd && setB.position( kEnd ).x >= minX && setB.position( kEnd ).x <= maxX )
+								++kEnd;
+
+							size_t idx, distance;
+							setB.bestMatch( idx, distance, d0, k, kEnd - k );
+							if( ( float ) distance < m.distance ) {
+								m.dstIdx = idx;
 								m.distance = distance;
 							}
+							k = kEnd;
 						}
 					}
 				}
@@ -144,11 +169,11 @@ namespace cvt {
 			}
 		}
 
-		template<typename T, typename DFUNC>
+		template<typename T>
 		static inline void scanLineMatch( std::vector<FeatureMatch>& matches,
 										  const std::vector<const FeatureDescriptor*>& left,
 										  const std::vector<T>& right,
-										  DFUNC dfunc,
+										  const DescriptorBlock& rightBlock,
 										  float minDisp,
 										  float maxDisp,
 										  float maxDescDist,
@@ -156,24 +181,24 @@ namespace cvt {
 		{
 			matches.reserve( left.size() );
 			FeatureMatch m;
+			SIMD* simd = SIMD::instance();
 			for( size_t i = 0; i < left.size(); ++i ){
-				const T* d = ( const T* )left[ i ];
+				const FeatureDescriptor* d = left[ i ];
 				m.distance = maxDescDist;
 				m.feature0 = d;
 				m.feature1 = 0;
 
-				for( size_t k = 0; k < right.size(); ++k ){
-					const T& dr = right[ k ];
-					float yDist = Math::abs( d->pt[ 1 ] - dr.pt[ 1 ] );
+				for( size_t k = 0; k < rightBlock.size(); ++k ){
+					const Vector2f& pr = rightBlock.position( k );
+					float yDist = Math::abs( d->pt[ 1 ] - pr[ 1 ] );
 					if( yDist < maxLineDist &&
-                        d->octave == dr.octave /*&&
-                        Math::abs( d->angle - dr.angle ) < 0.1f*/ ){
-						float disp = d->pt[ 0 ] - dr.pt[ 0 ];
+                        d->octave == rightBlock.octave( k ) ){
+						float disp = d->pt[ 0 ] - pr[ 0 ];
 						if( disp > minDisp && disp < maxDisp ){
-							float descDist = dfunc( *d, dr );
+							float descDist = simd->hammingDistance( d->ptr(), rightBlock.descriptor( k ), rightBlock.length() );
 							if( descDist < m.distance ){
 								m.distance = descDist;
-								m.feature1 = &dr;
+								m.feature1 = &right[ k ];
 							}
 						}
                     }
@@ -184,12 +209,12 @@ namespace cvt {
 			}
 		}
 
-        template<typename T, typename DFUNC>
+        template<typename T>
         static inline void scanLineMatch( std::vector<FeatureMatch>& matches,
                                           const RowLookupTable& rlt,
                                           const std::vector<const FeatureDescriptor*>& left,
                                           const std::vector<T>& right,
-                                          DFUNC dfunc,
+                                          const DescriptorBlock& rightBlock,
                                           float minDisp,
                                           float maxDisp,
                                           float maxDescDist,
@@ -198,7 +223,7 @@ namespace cvt {
             matches.reserve( left.size() );
             FeatureMatch m;
             for( size_t i = 0; i < left.size(); ++i ){
-                const T* d = ( const T* )left[ i ];
+                const FeatureDescriptor* d = left[ i ];
                 m.distance = maxDescDist;
                 m.feature0 = d;
                 m.feature1 = 0;
@@ -211,21 +236,28 @@ namespace cvt {
                 for( int y = minY; y < maxY; ++y ){
                     if( rlt.isValidRow( y ) ){
                         const RowLookupTable::Row& row = rlt.row( y );
-                        int k = row.start;
+                        size_t k = row.start;
                         size_t rEnd = k + row.len;
-                        for( size_t k = row.start; k < rEnd; ++k ){
-                            const T& dr = right[ k ];
-                            if( dr.pt.x < minX )
+                        while( k < rEnd ){
+                            if( rightBlock.position( k ).x < minX ){
+                                ++k;
                                 continue;
-                            if( dr.pt.x > maxX )
+                            }
+                            if( rightBlock.position( k ).x > maxX )
                                 break;
 
-                            // Match
-                            float distance = dfunc( *d, dr );
-                            if( distance < m.distance ) {
-                                m.feature1 = &dr;
+                            // match the whole run of features inside [minX, maxX] at once
+                            size_t kEnd = k + 1;
+                            while( kEnd < rEnd && rightBlock.position( kEnd ).x >= minX && rightBlock.position( kEnd ).x <= maxX )
+                                ++kEnd;
+
+                            size_t idx, distance;
+                            rightBlock.bestMatch( idx, distance, d->ptr(), k, kEnd - k );
+                            if( ( float ) distance < m.distance ) {
+                                m.feature1 = &right[ idx ];
                                 m.distance = distance;
                             }
+                            k = kEnd;
                         }
                     }
                 }
@@ -23,6 +23,8 @@
 */
 
 #include <cvt/vision/features/ORB.h>
+#include <cvt/util/ParallelFor.h>
+#include <cvt/util/SIMD.h>
 
 namespace cvt {
 
@@ -32,4 +34,149 @@ namespace cvt {
 	};
 
 	#include "ORBPattern.h"
+
+	class ORB::ExtractBody
+	{
+		public:
+			ExtractBody( std::vector<Descriptor>& dst, size_t offset, const FeatureSet& features, const IntegralPyramid& ipyr,
+						 const std::vector<const int32_t*>& patterns, const std::vector<float>& scales ) :
+				_dst( dst ),
+				_offset( offset ),
+				_features( features ),
+				_ipyr( ipyr ),
+				_patterns( patterns ),
+				_scales( scales )
+			{
+			}
+
+			void operator()( const Range<size_t>& r ) const
+			{
+				const SIMD* simd = SIMD::instance();
+
+				for( size_t i = r.min; i < r.max; i++ ) {
+					Descriptor& desc = _dst[ _offset + i ];
+					( Feature& ) desc = _features[ i ];
+
+					/* a single table is used for all features, as for a plain image */
+					size_t o = _ipyr.octaves() == 1 ? 0 : desc.octave;
+					size_t stride = _ipyr.stride( o );
+					int x = ( int ) ( desc.pt.x * _scales[ o ] );
+					int y = ( int ) ( desc.pt.y * _scales[ o ] );
+					const uint32_t* table = _ipyr.table( o ) + y * stride + x;
+
+					desc.angle = centroidAngle( table, stride );
+
+					size_t index = ( size_t ) ( desc.angle * 30.0f / Math::TWO_PI );
+					if( index >= 30 )
+						index = 0;
+
+					/* 5 x 5 boxes around the pattern points, see patternOffsets */
+					const int32_t* pattern = _patterns[ o ] + index * 512;
+					simd->boxTests_u32( desc.desc, table, pattern, pattern + 256, 256, 5, 5 * stride );
+				}
+			}
+
+		private:
+			std::vector<Descriptor>&			_dst;
+			size_t								_offset;
+			const FeatureSet&					_features;
+			const IntegralPyramid&				_ipyr;
+			const std::vector<const int32_t*>&	_patterns;
+			const std::vector<float>&			_scales;
+	};
+
+	void ORB::extract( const Image& img, const FeatureSet& features )
+	{
+		if( img.channels() != 1 ||
+			( img.format() != IFormat::GRAY_UINT8 && img.format() != IFormat::GRAY_FLOAT ) )
+			throw CVTException( "Unimplemented" );
+
+		_integral.update( img );
+		extract( _integral, features );
+	}
+
+	void ORB::extract( const ImagePyramid& pyr, const FeatureSet& features )
+	{
+		if( pyr[ 0 ].channels() != 1 ||
+			( pyr[ 0 ].format() != IFormat::GRAY_UINT8 && pyr[ 0 ].format() != IFormat::GRAY_FLOAT ) )
+			throw CVTException( "Unimplemented" );
+
+		_integral.update( pyr );
+		extract( _integral, features );
+	}
+
+	void ORB::extract( const IntegralPyramid& ipyr, const FeatureSet& features )
+	{
+		invalidateBlock();
+
+		/* keep the tables of the strides of this pyramid, the map does not move them on insertion */
+		std::map<size_t, std::vector<int32_t> > offsets;
+		for( size_t i = 0; i < ipyr.octaves(); ++i ){
+			size_t stride = ipyr.stride( i );
+			if( offsets.count( stride ) )
+				continue;
+			std::map<size_t, std::vector<int32_t> >::iterator it = _offsets.find( stride );
+			if( it != _offsets.end() )
+				offsets[ stride ].swap( it->second );
+			else
+				patternOffsets( offsets[ stride ], stride );
+		}
+		_offsets.swap( offsets );
+
+		std::vector<const int32_t*> patterns;
+		std::vector<float> scales;
+		for( size_t i = 0; i < ipyr.octaves(); ++i ){
+			patterns.push_back( &_offsets[ ipyr.stride( i ) ][ 0 ] );
+			scales.push_back( ipyr.octaves() == 1 ? 1.0f : Math::pow( ipyr.scaleFactor(), ( float )i ) );
+		}
+
+		size_t offset = _features.size();
+		_features.resize( offset + features.size(), Descriptor( Feature() ) );
+		parallelFor( Range<size_t>( 0, features.size() ), ExtractBody( _features, offset, features, ipyr, patterns, scales ), 64 );
+	}
+
+	/* sum of the box [ x0, x1 ) x [ y0, y1 ) relative to the table entry */
+	static inline int32_t _boxSum( const uint32_t* table, ssize_t stride, int x0, int y0, int x1, int y1 )
+	{
+		return ( int32_t ) ( table[ y0 * stride + x0 ] - table[ y0 * stride + x1 ] - table[ y1 * stride + x0 ] + table[ y1 * stride + x1 ] );
+	}
+
+	float ORB::centroidAngle( const uint32_t* table, size_t stride )
+	{
+		int32_t mx = 0;
+		int32_t my = 0;
+		float angle;
+
+		for( int i = 0; i < 15; i++ ) {
+			int r = _circularoffset[ i ];
+			mx += ( i - 15 ) * ( _boxSum( table, stride, -r, i - 15, r + 1, i - 14 )
+							   - _boxSum( table, stride, -r, 15 - i, r + 1, 16 - i ) );
+			my += ( i - 15 ) * ( _boxSum( table, stride, i - 15, -r, i - 14, r + 1 )
+							   - _boxSum( table, stride, 15 - i, -r, 16 - i, r + 1 ) );
+		}
+
+		angle = Math::atan2( ( float ) my, ( float ) mx );
+
+		if( angle < 0 )
+			angle += Math::TWO_PI;
+		angle = Math::TWO_PI - angle + Math::HALF_PI;
+
+		while( angle > Math::TWO_PI )
+			angle -= Math::TWO_PI;
+		return angle;
+	}
+
+	/* for every orientation the upper left table entries of the 5 x 5 boxes of the first and the second test points */
+	void ORB::patternOffsets( std::vector<int32_t>& offsets, size_t stride )
+	{
+		offsets.resize( 30 * 512 );
+		for( size_t index = 0; index < 30; index++ ) {
+			for( size_t n = 0; n < 256; n++ ) {
+				for( size_t k = 0; k < 2; k++ ) {
+					const int* pt = _patterns[ index ][ n * 2 + k ];
+					offsets[ index * 512 + k * 256 + n ] = ( pt[ 1 ] - 2 ) * ( int32_t ) stride + pt[ 0 ] - 2;
+				}
+			}
+		}
+	}
 }
@@ -29,11 +29,15 @@
 #include <cvt/gfx/IMapScoped.h>
 #include <cvt/vision/ImagePyramid.h>
 #include <cvt/vision/IntegralImage.h>
+#include <cvt/vision/IntegralPyramid.h>
+#include <cvt/util/Mutex.h>
 #include <cvt/vision/features/FeatureSet.h>
 #include <cvt/vision/features/FeatureDescriptor.h>
 #include <cvt/vision/features/FeatureDescriptorExtractor.h>
 #include <cvt/vision/features/MatchBruteForce.h>
 
+#include <map>
+
 namespace cvt {
 
 	class ORB : public FeatureDescriptorExtractor
@@ -49,10 +53,13 @@ namespace cvt {
 			ORB*					  clone() const;
 			FeatureDescriptor&		  operator[]( size_t i );
 			const FeatureDescriptor&  operator[]( size_t i ) const;
+			const DescriptorBlock&	  descriptorBlock() const;
 
 			void clear();
 			void extract( const Image& img, const FeatureSet& features );
 			void extract( const ImagePyramid& pyr, const FeatureSet& features );
+			/* with the tables of the pyramid the features were detected on, e.g. shared with other consumers */
+			void extract( const IntegralPyramid& ipyr, const FeatureSet& features );
 
 			void matchBruteForce( std::vector<FeatureMatch>& matches, const FeatureDescriptorExtractor& other, float distThresh ) const;
 
@@ -64,6 +71,17 @@ namespace cvt {
 								float maxFeatureDist,
 								float maxDescDistance ) const;
 
+			void matchInWindow( std::vector<MatchingIndices>& matches,
+								const DescriptorBlock& other,
+								float maxFeatureDist,
+								float maxDescDistance ) const;
+
+			void matchInWindow( std::vector<MatchingIndices>& matches,
+								const RowLookupTable& rlt,
+								const DescriptorBlock& other,
+								float maxFeatureDist,
+								float maxDescDistance ) const;
+
 			void scanLineMatch( std::vector<FeatureMatch>& matches,
 								const std::vector<const FeatureDescriptor*>& left,
 								float minDisp,
@@ -80,35 +98,40 @@ namespace cvt {
                                 float maxLineDist ) const;
 
 		private:
-			struct DistFunc {
-				DistFunc() : _simd( SIMD::instance() )
-				{
-				}
-
-				float operator()( const Descriptor& a, const Descriptor& b ) const
-				{
-					return _simd->hammingDistance( a.desc, b.desc, 32 );
-				}
+			class ExtractBody;
 
-				SIMD* _simd;
-			};
-
-			float centroidAngle( const Vector2f& pt, const IMapScoped<const float>& map );
-			void descriptor( Descriptor& feature, const Vector2f& pt, const IMapScoped<const float>& map );
+			static float			centroidAngle( const uint32_t* table, size_t stride );
+			static void				patternOffsets( std::vector<int32_t>& offsets, size_t stride );
 
 			static const int		_patterns[ 30 ][ 512 ][ 2 ];
 			static const int		_circularoffset[ 31 ];
 
 			std::vector<Descriptor> _features;
+			/* tables of the last extracted image or pyramid */
+			IntegralPyramid			_integral;
+			/* table offsets of the pattern points per stride, only the strides of the last pyramid are kept */
+			std::map<size_t, std::vector<int32_t> >	_offsets;
+			/* packed copy of _features, rebuilt on demand after modifications */
+			mutable DescriptorBlock _block;
+			/* set atomically by modifications, tested and cleared under _blockMutex by the rebuild */
+			mutable bool			_blockDirty;
+			/* serialises the rebuild for concurrent const callers */
+			mutable Mutex			_blockMutex;
+
+			void					invalidateBlock();
 	};
 
-	inline ORB::ORB()
+	inline ORB::ORB() :
+		_block( 32 ),
+		_blockDirty( true )
 	{
 	}
 
 	inline ORB::ORB( const ORB& orb ) :
 		FeatureDescriptorExtractor(),
-		_features( orb._features )
+		_features( orb._features ),
+		_block( 32 ),
+		_blockDirty( true )
 	{
 	}
 
@@ -130,6 +153,7 @@ namespace cvt {
 
 	inline FeatureDescriptor& ORB::operator[]( size_t i )
 	{
+		invalidateBlock();
 		return _features[ i ];
 	}
 
@@ -141,153 +165,64 @@ namespace cvt {
 	inline void ORB::clear()
 	{
 		_features.clear();
+		invalidateBlock();
 	}
 
-	inline void ORB::extract( const ImagePyramid& pyr, const FeatureSet& features )
+	inline void ORB::invalidateBlock()
 	{
-		if( pyr[ 0 ].channels() != 1 ||
-			( pyr[ 0 ].format() != IFormat::GRAY_UINT8 && pyr[ 0 ].format() != IFormat::GRAY_FLOAT ) )
-			throw CVTException( "Unimplemented" );
-
-		ImagePyramid integralPyr( pyr.octaves(), pyr.scaleFactor() );
-		pyr.integralImage( integralPyr );
-
-		size_t octaves = pyr.octaves();
-		std::vector<IMapScoped<const float>*> maps;
-		std::vector<float> scales;
-		for( size_t i = 0; i < octaves; ++i ){
-			maps.push_back( new IMapScoped<const float>( integralPyr[ i ] ) );
-			scales.push_back( Math::pow( integralPyr.scaleFactor(), ( float )i ) );
-		}
-
-		size_t iend = features.size();
-		Vector2f vs;
-		for( size_t i = 0; i < iend; ++i ) {
-			_features.push_back( Descriptor( features[ i ] ) );
-			Descriptor& desc = _features.back();
-			size_t o = desc.octave;
-			vs = desc.pt * scales[ o ];
-
-			desc.angle = centroidAngle( vs, *maps[ o ] );
-			descriptor( desc, vs, *maps[ o ] );
-		}
-
-		for( size_t i = 0; i < octaves; ++i ){
-			delete maps[ i ];
-		}
+		__atomic_store_n( &_blockDirty, true, __ATOMIC_RELEASE );
 	}
 
-	inline void ORB::extract( const Image& img, const FeatureSet& features )
+	inline const DescriptorBlock& ORB::descriptorBlock() const
 	{
-		if( img.channels() != 1 ||
-			( img.format() != IFormat::GRAY_UINT8 && img.format() != IFormat::GRAY_FLOAT ) )
-			throw CVTException( "Unimplemented" );
-
-		IntegralImage iimage( img );
-		IMapScoped<const float> map( iimage.sumImage() );
-
-		size_t iend = features.size();
-		for( size_t i = 0; i < iend; ++i ) {
-			_features.push_back( Descriptor( features[ i ] ) );
-			Descriptor& desc = _features.back();
-			desc.angle = centroidAngle( desc.pt, map );
-			descriptor( desc, desc.pt, map );
+		ScopeLock lock( &_blockMutex );
+		if( __atomic_exchange_n( &_blockDirty, false, __ATOMIC_ACQ_REL ) ) {
+			_block.clear();
+			_block.reserve( _features.size() );
+			for( size_t i = 0; i < _features.size(); i++ )
+				_block.add( _features[ i ] );
 		}
+		return _block;
 	}
 
-	inline float ORB::centroidAngle( const Vector2f& pt, const IMapScoped<const float>& map )
+	inline void ORB::matchBruteForce( std::vector<FeatureMatch>& matches, const FeatureDescriptorExtractor& other, float distThresh ) const
 	{
-		float mx = 0;
-		float my = 0;
-		float angle = 0.0f;
-
-		int cury = ( int ) pt.y - 15;
-		int curx = ( int ) pt.x;
-
-		for( int i = 0; i < 15; i++ ) {
-			mx +=( ( float ) i - 15.0f ) * ( IntegralImage::area( map, curx - _circularoffset[ i ], cury + i, 2 * _circularoffset[ i ] + 1, 1 )
-										   - IntegralImage::area( map, curx - _circularoffset[ i ], cury + 30 - i, 2 * _circularoffset[ i ] + 1, 1) );
-		}
-
-		cury = ( int ) pt.y;
-		curx = ( int ) pt.x - 15;
-		for( int i = 0; i < 15; i++ ) {
-			my += ( ( float ) i - 15.0f ) * ( IntegralImage::area( map, curx + i, cury - _circularoffset[ i ], 1, 2 * _circularoffset[ i ] + 1 )
-											- IntegralImage::area( map, curx + 30 - i, cury - _circularoffset[ i ], 1, 2 * _circularoffset[ i ] + 1 ) );
-		}
-
-		angle = Math::atan2( my, mx );
-
-		if( angle < 0 )
-			angle += Math::TWO_PI;
-		angle = Math::TWO_PI - angle + Math::HALF_PI;
-
-		while( angle > Math::TWO_PI )
-			angle -= Math::TWO_PI;
-		return angle;
+		const ORB& o = ( const ORB& ) other;
+		FeatureMatcher::matchBruteForce<Descriptor>( matches, this->_features, o._features, o.descriptorBlock(), distThresh );
 	}
 
-	inline void ORB::descriptor( Descriptor& feature, const Vector2f& pt, const IMapScoped<const float>& map )
+	inline void ORB::matchInWindow( std::vector<MatchingIndices>& matches,
+									const std::vector<FeatureDescriptor*>& other,
+									float maxFeatureDist,
+									float maxDescDistance ) const
 	{
-		size_t index = ( size_t ) ( feature.angle * 30.0f / Math::TWO_PI );
-		if( index >= 30 )
-			index = 0;
-		int x = ( int ) pt.x;
-		int y = ( int ) pt.y;
-
-
-#define ORBTEST( n ) ( IntegralImage::area( map, x + _patterns[ index ][ ( n ) * 2 ][ 0 ] - 2,\
-										         y + _patterns[ index ][ ( n ) * 2 ][ 1 ] - 2, 5, 5 ) < \
-					   IntegralImage::area( map, x + _patterns[ index ][ ( n ) * 2 + 1 ][ 0 ] - 2,\
-										         y + _patterns[ index ][ ( n ) * 2 + 1 ][ 1 ] - 2, 5, 5 ) )
-		int idx;
-		for( int i = 0; i < 32; i++ ) {
-			idx = i << 3;
-			feature.desc[ i ]  =   ORBTEST( idx );
-			feature.desc[ i ] |= ( ORBTEST( idx + 1 ) ) << 1;
-			feature.desc[ i ] |= ( ORBTEST( idx + 2 ) ) << 2;
-			feature.desc[ i ] |= ( ORBTEST( idx + 3 ) ) << 3;
-			feature.desc[ i ] |= ( ORBTEST( idx + 4 ) ) << 4;
-			feature.desc[ i ] |= ( ORBTEST( idx + 5 ) ) << 5;
-			feature.desc[ i ] |= ( ORBTEST( idx + 6 ) ) << 6;
-			feature.desc[ i ] |= ( ORBTEST( idx + 7 ) ) << 7;
-		}
+		FeatureMatcher::matchInWindow( matches, other, descriptorBlock(), maxFeatureDist, maxDescDistance );
 	}
 
-	inline void ORB::matchBruteForce( std::vector<FeatureMatch>& matches, const FeatureDescriptorExtractor& other, float distThresh ) const
+	inline void ORB::matchInWindow( std::vector<MatchingIndices>& matches,
+									const RowLookupTable& rlt,
+									const std::vector<FeatureDescriptor*>& other,
+									float maxFeatureDist,
+									float maxDescDistance ) const
 	{
-		DistFunc dfunc;
-		FeatureMatcher::matchBruteForce<Descriptor,DistFunc>( matches, this->_features, ( ( const ORB& ) other)._features, dfunc, distThresh );
+		FeatureMatcher::matchInWindow( matches, rlt, other, descriptorBlock(), maxFeatureDist, maxDescDistance );
 	}
 
 	inline void ORB::matchInWindow( std::vector<MatchingIndices>& matches,
-									const std::vector<FeatureDescriptor*>& other,
+									const DescriptorBlock& other,
 									float maxFeatureDist,
 									float maxDescDistance ) const
 	{
-		DistFunc dfunc;
-		FeatureMatcher::matchInWindow<Descriptor, DistFunc>( matches,
-															 other,
-															 this->_features,
-															 dfunc,
-															 maxFeatureDist,
-															 maxDescDistance );
+		FeatureMatcher::matchInWindow( matches, other, descriptorBlock(), maxFeatureDist, maxDescDistance );
 	}
 
 	inline void ORB::matchInWindow( std::vector<MatchingIndices>& matches,
 									const RowLookupTable& rlt,
-									const std::vector<FeatureDescriptor*>& other,
+									const DescriptorBlock& other,
 									float maxFeatureDist,
 									float maxDescDistance ) const
 	{
-		DistFunc dfunc;
-		FeatureMatcher::matchInWindow<Descriptor, DistFunc>( matches,
-															 rlt,
-															 other,
-															 this->_features,
-															 dfunc,
-															 maxFeatureDist,
-															 maxDescDistance );
+		FeatureMatcher::matchInWindow( matches, rlt, other, descriptorBlock(), maxFeatureDist, maxDescDistance );
 	}
 
 	inline void ORB::scanLineMatch( std::vector<FeatureMatch>& matches,
@@ -297,36 +232,34 @@ namespace cvt {
 									float maxDescDist,
 									float maxLineDist ) const
 	{
-		DistFunc dfunc;
 		FeatureMatcher::scanLineMatch( matches,
 									   left,
 									   _features,
-									   dfunc,
+									   descriptorBlock(),
 									   minDisp,
 									   maxDisp,
 									   maxDescDist,
 									   maxLineDist );
 	}
 
-    inline void ORB::scanLineMatch( std::vector<FeatureMatch>& matches,
-                                    const RowLookupTable& rlt,
-                                    const std::vector<const FeatureDescriptor*>& left,
-                                    float minDisp,
-                                    float maxDisp,
-                                    float maxDescDist,
-                                    float maxLineDist ) const
-    {
-        DistFunc dfunc;
-        FeatureMatcher::scanLineMatch( matches,
-                                       rlt,
-                                       left,
-                                       _features,
-                                       dfunc,
-                                       minDisp,
-                                       maxDisp,
-                                       maxDescDist,
-                                       maxLineDist );
-    }
+	inline void ORB::scanLineMatch( std::vector<FeatureMatch>& matches,
+									const RowLookupTable& rlt,
+									const std::vector<const FeatureDescriptor*>& left,
+									float minDisp,
+									float maxDisp,
+									float maxDescDist,
+									float maxLineDist ) const
+	{
+		FeatureMatcher::scanLineMatch( matches,
+									   rlt,
+									   left,
+									   _features,
+									   descriptorBlock(),
+									   minDisp,
+									   maxDisp,
+									   maxDescDist,
+									   maxLineDist );
+	}
 }
 
 #endif
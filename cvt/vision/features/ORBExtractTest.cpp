@@ -0,0 +1,232 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/vision/features/ORB.h>
+#include <cvt/vision/IntegralPyramid.h>
+#include <cvt/vision/ImagePyramid.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/util/SIMD.h>
+#include <cvt/util/CVTTest.h>
+
+#include <stdlib.h>
+
+using namespace cvt;
+
+static const int _circular[ 31 ] = {
+	3,  6,  8,  9, 10, 11, 12, 13, 13, 14, 14, 14, 15, 15, 15, 15,
+	15, 15, 15, 14, 14, 14, 13, 13, 12, 11, 10,  9,  8,  6,  3
+};
+
+static void _fill( Image& img )
+{
+	IMapScoped<uint8_t> map( img );
+	for( size_t y = 0; y < img.height(); y++ ) {
+		for( size_t x = 0; x < img.width(); x++ )
+			map.ptr()[ x ] = rand() % 256;
+		map++;
+	}
+}
+
+static bool _testArea( const Image& img, const IntegralPyramid& ipyr )
+{
+	IMapScoped<const uint8_t> map( img );
+	for( size_t i = 0; i < 200; i++ ) {
+		size_t x = rand() % img.width();
+		size_t y = rand() % img.height();
+		size_t w = rand() % ( img.width() - x + 1 );
+		size_t h = rand() % ( img.height() - y + 1 );
+
+		uint32_t sum = 0;
+		for( size_t yy = y; yy < y + h; yy++ ) {
+			map.setLine( yy );
+			for( size_t xx = x; xx < x + w; xx++ )
+				sum += map.ptr()[ xx ];
+		}
+		if( sum != ipyr.area( 0, x, y, w, h ) )
+			return false;
+	}
+	return ipyr.area( 0, 0, 0, img.width(), img.height() ) == ipyr.table( 0 )[ img.height() * ipyr.stride( 0 ) + img.width() ];
+}
+
+/* intensity centroid orientation directly on the pixels */
+static float _angle( const Image& img, int x, int y )
+{
+	IMapScoped<const uint8_t> map( img );
+	int mx = 0, my = 0;
+	for( int i = 0; i < 15; i++ ) {
+		int r = _circular[ i ];
+		for( int k = -r; k <= r; k++ ) {
+			map.setLine( y + i - 15 );
+			mx += ( i - 15 ) * map.ptr()[ x + k ];
+			map.setLine( y + 15 - i );
+			mx -= ( i - 15 ) * map.ptr()[ x + k ];
+			map.setLine( y + k );
+			my += ( i - 15 ) * ( map.ptr()[ x + i - 15 ] - map.ptr()[ x + 15 - i ] );
+		}
+	}
+
+	float angle = Math::atan2( ( float ) my, ( float ) mx );
+	if( angle < 0 )
+		angle += Math::TWO_PI;
+	angle = Math::TWO_PI - angle + Math::HALF_PI;
+	while( angle > Math::TWO_PI )
+		angle -= Math::TWO_PI;
+	return angle;
+}
+
+static bool _testBoxTests( SIMD* ref, SIMD* simd )
+{
+	const size_t stride = 107;
+	std::vector<uint32_t> table( stride * 90 );
+	for( size_t i = 0; i < table.size(); i++ )
+		table[ i ] = rand() | ( ( uint32_t ) rand() << 16 );
+
+	/* n not a multiple of the vector width to exercise the tail */
+	const size_t n = 253;
+	std::vector<int32_t> off0( n ), off1( n );
+	for( size_t i = 0; i < n; i++ ) {
+		off0[ i ] = ( rand() % 80 ) * stride + rand() % 100;
+		off1[ i ] = ( rand() % 80 ) * stride + rand() % 100;
+	}
+
+	uint8_t d0[ 32 ], d1[ 32 ];
+	ref->boxTests_u32( d0, &table[ 0 ], &off0[ 0 ], &off1[ 0 ], n, 5, 5 * stride );
+	simd->boxTests_u32( d1, &table[ 0 ], &off0[ 0 ], &off1[ 0 ], n, 5, 5 * stride );
+	return memcmp( d0, d1, ( n + 7 ) / 8 ) == 0;
+}
+
+static bool _testPrefixSum( SIMD* ref, SIMD* simd )
+{
+	const size_t w = 77, h = 13;
+	std::vector<uint8_t> src( w * h );
+	for( size_t i = 0; i < src.size(); i++ )
+		src[ i ] = rand() % 256;
+
+	/* leading zero row and column as in IntegralPyramid */
+	std::vector<uint32_t> t0( ( w + 1 ) * ( h + 1 ), 0 ), t1( ( w + 1 ) * ( h + 1 ), 0 );
+	ref->prefixSum1_u8_to_u32( &t0[ w + 2 ], w + 1, &src[ 0 ], w, w, h );
+	simd->prefixSum1_u8_to_u32( &t1[ w + 2 ], w + 1, &src[ 0 ], w, w, h );
+	return t0 == t1 && t0.back() == t1.back();
+}
+
+BEGIN_CVTTEST( ORBExtract )
+	bool result = true;
+	bool b;
+
+	srand( 7 );
+
+	Image img( 321, 243, IFormat::GRAY_UINT8 );
+	_fill( img );
+
+	IntegralPyramid ipyr;
+	ipyr.update( img );
+	b = _testArea( img, ipyr );
+	CVTTEST_PRINT( "IntegralPyramid area", b );
+	result &= b;
+
+	FeatureSet features;
+	for( size_t i = 0; i < 500; i++ )
+		features.add( Feature( 20 + rand() % ( img.width() - 40 ), 20 + rand() % ( img.height() - 40 ) ) );
+
+	ORB orb;
+	orb.extract( img, features );
+	b = orb.size() == features.size();
+	for( size_t i = 0; b && i < orb.size(); i++ ) {
+		b = orb[ i ].pt == features[ i ].pt &&
+			Math::abs( orb[ i ].angle - _angle( img, ( int ) features[ i ].pt.x, ( int ) features[ i ].pt.y ) ) < 1e-5f;
+	}
+	CVTTEST_PRINT( "ORB angle", b );
+	result &= b;
+
+	/* the same tables supplied by the caller */
+	ORB orb2;
+	orb2.extract( ipyr, features );
+	b = orb2.size() == orb.size();
+	for( size_t i = 0; b && i < orb.size(); i++ )
+		b = memcmp( ( ( ORB::Descriptor& ) orb[ i ] ).desc, ( ( ORB::Descriptor& ) orb2[ i ] ).desc, 32 ) == 0;
+	CVTTEST_PRINT( "ORB external integral pyramid", b );
+	result &= b;
+
+	ImagePyramid pyr( 3, 0.5f );
+	pyr.update( img );
+	FeatureSet pfeatures;
+	for( size_t i = 0; i < 300; i++ ) {
+		size_t o = rand() % 3;
+		float s = Math::pow( 0.5f, ( float ) o );
+		pfeatures.add( Feature( ( 20 + rand() % ( pyr[ o ].width() - 40 ) ) / s,
+								( 20 + rand() % ( pyr[ o ].height() - 40 ) ) / s, 0.0f, o ) );
+	}
+	ORB orb3;
+	orb3.extract( pyr, pfeatures );
+	b = orb3.size() == pfeatures.size();
+	for( size_t i = 0; b && i < orb3.size(); i++ ) {
+		size_t o = pfeatures[ i ].octave;
+		float s = Math::pow( 0.5f, ( float ) o );
+		b = Math::abs( orb3[ i ].angle - _angle( pyr[ o ], ( int ) ( pfeatures[ i ].pt.x * s ), ( int ) ( pfeatures[ i ].pt.y * s ) ) ) < 1e-5f;
+	}
+	CVTTEST_PRINT( "ORB pyramid angle", b );
+	result &= b;
+
+	/* every octave has to match the single level extraction on the octave image */
+	b = true;
+	for( size_t o = 0; o < 3; o++ ) {
+		float s = Math::pow( 0.5f, ( float ) o );
+		FeatureSet ofeatures;
+		std::vector<size_t> idx;
+		for( size_t i = 0; i < pfeatures.size(); i++ ) {
+			if( pfeatures[ i ].octave != ( int ) o )
+				continue;
+			ofeatures.add( Feature( pfeatures[ i ].pt.x * s, pfeatures[ i ].pt.y * s ) );
+			idx.push_back( i );
+		}
+		ORB orbo;
+		orbo.extract( pyr[ o ], ofeatures );
+		for( size_t i = 0; b && i < idx.size(); i++ )
+			b = memcmp( ( ( ORB::Descriptor& ) orbo[ i ] ).desc, ( ( ORB::Descriptor& ) orb3[ idx[ i ] ] ).desc, 32 ) == 0;
+	}
+	CVTTEST_PRINT( "ORB pyramid descriptors", b );
+	result &= b;
+
+	/* appending keeps the previous descriptors */
+	orb3.extract( img, features );
+	b = orb3.size() == pfeatures.size() + features.size();
+	for( size_t i = 0; b && i < features.size(); i++ )
+		b = memcmp( ( ( ORB::Descriptor& ) orb[ i ] ).desc, ( ( ORB::Descriptor& ) orb3[ pfeatures.size() + i ] ).desc, 32 ) == 0;
+	CVTTEST_PRINT( "ORB append", b );
+	result &= b;
+
+	SIMD* ref = SIMD::get( SIMD_BASE );
+	SIMD* simd = SIMD::get();
+	b = _testBoxTests( ref, simd );
+	CVTTEST_PRINT( "SIMD boxTests_u32", b );
+	result &= b;
+
+	b = _testPrefixSum( ref, simd );
+	CVTTEST_PRINT( "SIMD prefixSum1_u8_to_u32", b );
+	result &= b;
+	delete ref;
+	delete simd;
+
+	return result;
+END_CVTTEST
@@ -35,7 +35,16 @@ namespace cvt {
         public:
             ASTDetector(){}
             virtual ~ASTDetector(){}
-            virtual void detect( const Image& img, uint8_t threshold, FeatureSetWrapper& features, size_t border ) = 0;
+            void detect( const Image& img, uint8_t threshold, FeatureSetWrapper& features, size_t border )
+            {
+                detect( img, threshold, features, border, 0, img.height() );
+            }
+
+            /* only the rows [ y0, y1 ), concurrent calls need a prepare() for the image beforehand */
+            virtual void detect( const Image& img, uint8_t threshold, FeatureSetWrapper& features, size_t border, size_t y0, size_t y1 ) = 0;
+
+            /* update the pixel offsets to the stride of img */
+            virtual void prepare( const Image& img ) = 0;
     };
 
 }
@@ -72,7 +72,16 @@ namespace cvt
     //memory costs: cache=0.2
     //              same line=1
     //              memory=4
-    void Agast7_12s::detect( const Image& img, uint8_t threshold, FeatureSetWrapper& features, size_t border )
+    void Agast7_12s::prepare( const Image& img )
+    {
+        IMapScoped<const uint8_t> map( img );
+        if( map.stride() != _lastStride ){
+            _lastStride = map.stride();
+            updateOffsets();
+        }
+    }
+
+    void Agast7_12s::detect( const Image& img, uint8_t threshold, FeatureSetWrapper& features, size_t border, size_t y0, size_t y1 )
     {
         IMapScoped<const uint8_t> map( img );
         if( map.stride() != _lastStride ){
@@ -82,10 +91,10 @@ namespace cvt
 
         size_t x, y;
         size_t xsizeB = img.width() - border;
-        size_t ysizeB = img.height() - border;
+        size_t ysizeB = Math::min( img.height() - border, y1 );
 
         const uint8_t* im = map.ptr();
-        for( y = border; y < ysizeB; y++ ) {
+        for( y = Math::max( border, y0 ); y < ysizeB; y++ ) {
             x = border - 1;
             while(1)
             {
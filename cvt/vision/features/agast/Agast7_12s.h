@@ -35,7 +35,9 @@ namespace cvt
             Agast7_12s();
             virtual ~Agast7_12s();
 
-            void detect( const Image& img, uint8_t threshold, FeatureSetWrapper& features, size_t border );
+            using ASTDetector::detect;
+            void detect( const Image& img, uint8_t threshold, FeatureSetWrapper& features, size_t border, size_t y0, size_t y1 );
+            void prepare( const Image& img );
 
         private:
             ssize_t  _lastStride;
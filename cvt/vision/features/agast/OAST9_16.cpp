@@ -65,7 +65,16 @@ namespace cvt
     //    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
     //    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
-    void OAST9_16::detect( const Image& img, uint8_t threshold, FeatureSetWrapper& features, size_t border )
+    void OAST9_16::prepare( const Image& img )
+    {
+        IMapScoped<const uint8_t> map( img );
+        if( map.stride() != _lastStride ){
+            _lastStride = map.stride();
+            updateOffsets();
+        }
+    }
+
+    void OAST9_16::detect( const Image& img, uint8_t threshold, FeatureSetWrapper& features, size_t border, size_t y0, size_t y1 )
     {
         IMapScoped<const uint8_t> map( img );
         if( map.stride() != _lastStride ){
@@ -75,10 +84,10 @@ namespace cvt
 
         size_t x, y;
         size_t xsizeB = img.width() - border;
-        size_t ysizeB = img.height() - border;
+        size_t ysizeB = Math::min( img.height() - border, y1 );
 
         const uint8_t* im = map.ptr();
-        for( y = border; y < ysizeB; y++ ) {
+        for( y = Math::max( border, y0 ); y < ysizeB; y++ ) {
             x = border - 1;
             while( 1 ){
                 x++;
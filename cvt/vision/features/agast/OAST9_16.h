@@ -35,7 +35,9 @@ namespace cvt
             OAST9_16();
             virtual ~OAST9_16();
 
-            void detect( const Image& img, uint8_t threshold, FeatureSetWrapper& features, size_t border );
+            using ASTDetector::detect;
+            void detect( const Image& img, uint8_t threshold, FeatureSetWrapper& features, size_t border, size_t y0, size_t y1 );
+            void prepare( const Image& img );
 
         private:
             ssize_t  _lastStride;
@@ -27,6 +27,7 @@
 
 #include <vector>
 #include <cvt/vision/features/FeatureDescriptor.h>
+#include <cvt/vision/features/DescriptorBlock.h>
 #include <cvt/vision/KLTPatch.h>
 #include <cvt/math/GA2.h>
 
@@ -49,6 +50,10 @@ namespace cvt
 			void descriptorsForIds( std::vector<FeatureDescriptor*>& descriptors,
 									const std::vector<size_t>& ids );
 
+			/* packs the descriptors for the ids into block, the block is cleared first */
+			void descriptorsForIds( DescriptorBlock& block,
+									const std::vector<size_t>& ids ) const;
+
 			void patchesForIds( std::vector<PatchType*>& descriptors,
 									  const std::vector<size_t>& ids );
 
@@ -56,6 +61,10 @@ namespace cvt
 											  std::vector<PatchType*>& patches,
 											  const std::vector<size_t>& ids );
 
+			void descriptorsAndPatchesForIds( DescriptorBlock& block,
+											  std::vector<PatchType*>& patches,
+											  const std::vector<size_t>& ids ) const;
+
 		private:
 			std::vector<FeatureDescriptor*>	_descriptors;
 			std::vector<PatchType*>			_patches;
@@ -158,6 +167,16 @@ namespace cvt
 		}
 	}
 
+	inline void DescriptorDatabase::descriptorsForIds( DescriptorBlock& block,
+													   const std::vector<size_t>& ids ) const
+	{
+		block.clear();
+		block.reserve( ids.size() );
+		for( size_t i = 0; i < ids.size(); ++i ){
+			block.add( descriptor( ids[ i ] ) );
+		}
+	}
+
 	inline void DescriptorDatabase::patchesForIds( std::vector<PatchType*>& patches,
 												   const std::vector<size_t>& ids )
 	{
@@ -179,6 +198,20 @@ namespace cvt
 			descriptors[ i ] = _descriptors[ idx ];
 		}
 	}
+
+	inline void DescriptorDatabase::descriptorsAndPatchesForIds( DescriptorBlock& block,
+																 std::vector<PatchType*>& patches,
+																 const std::vector<size_t>& ids ) const
+	{
+		patches.resize( ids.size() );
+		block.clear();
+		block.reserve( ids.size() );
+		for( size_t i = 0; i < ids.size(); ++i ){
+			size_t idx = ids[ i ];
+			patches[ i ] = _patches[ idx ];
+			block.add( descriptor( idx ) );
+		}
+	}
 }
 
 #endif
@@ -85,7 +85,7 @@ namespace cvt
         // predict current visible features by projecting with current estimate of pose
         std::vector<Vector2f>           predictedPositions;
         std::vector<size_t>             predictedFeatureIds;
-        std::vector<FeatureDescriptor*> predictedDescriptors;
+        DescriptorBlock                 predictedDescriptors;
         std::vector<PatchType*>         predictedPatches;
 
         // predict visible features based on last pose
@@ -216,7 +216,7 @@ namespace cvt
 
    void StereoSLAM::predictVisibleFeatures( std::vector<Vector2f>& imgPositions,
 											std::vector<size_t>& ids,
-											std::vector<FeatureDescriptor*>& descriptors,
+											DescriptorBlock& descriptors,
 											std::vector<PatchType*>& patches,
 											const Eigen::Matrix4d& cameraPose )
    {
@@ -231,13 +231,13 @@ namespace cvt
 	   // get the corresponding descriptors
 	   _descriptorDatabase.descriptorsAndPatchesForIds( descriptors, patches, ids );
 	   for( size_t i = 0; i < descriptors.size(); ++i ){
-		   descriptors[ i ]->pt = imgPositions[ i ];
+		   descriptors.position( i ) = imgPositions[ i ];
 	   }
    }
 
     void StereoSLAM::trackPredictedFeatures( TrackedFeatures& tracked,
                                              std::vector<MatchingIndices>& matchedIndices,
-                                             const std::vector<FeatureDescriptor*>& predictedDescriptors,
+                                             const DescriptorBlock& predictedDescriptors,
                                              std::vector<StereoSLAM::PatchType*>& predictedPatches,
                                              const std::vector<size_t>& predictedIds )
     {
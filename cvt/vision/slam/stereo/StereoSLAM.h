@@ -208,13 +208,13 @@ namespace cvt
 
 		 void predictVisibleFeatures( std::vector<Vector2f>& imgPositions,
 									  std::vector<size_t>& ids,
-									  std::vector<FeatureDescriptor*>& descriptors,
+									  DescriptorBlock& descriptors,
 									  std::vector<PatchType*>& patches,
 									  const Eigen::Matrix4d& cameraPose );
 
 		 void trackPredictedFeatures( TrackedFeatures& tracked,
 									  std::vector<MatchingIndices> &matchedIndices,
-									  const std::vector<FeatureDescriptor*>& predictedDescriptors,
+									  const DescriptorBlock& predictedDescriptors,
 									  std::vector<StereoSLAM::PatchType*>& predictedPatches,
 									  const std::vector<size_t>& mapIds );
 
@@ -1,7 +1,16 @@
 #include "PlyLoader.h"
 
-#include <cvt/io/FileSystem.h>
 #include <cvt/util/DataIterator.h>
+#include <cvt/util/ParallelFor.h>
+#include <cvt/util/Util.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
 
 namespace cvt {
 
@@ -52,153 +61,52 @@ namespace cvt {
 		}
 	}
 
-	static bool PlyDiscardPropertyAscii( DataIterator& d, const PlyProperty& p )
-	{
-		String ws( " \r\n\t" ), dummy;
 
-		if( p.type != PLY_LIST ) {
-			/* discard single token */
-			if( !d.nextToken( dummy, ws ) )
-				return false;
-		} else {
-			/* discard list elements */
-			long nlist;
-
-			nlist = d.nextLong();
-			if( nlist < 0 )
-				return 0;
-			while( nlist-- ) {
-				if( !d.nextToken( dummy, ws ) )
-					return false;
-			}
-		}
-		return true;
-	}
-
-	static bool PlyDiscardElementAscii( DataIterator& d, const PlyElement& e )
+	static bool PlyParseType( const String& str, PlyPropertyType& type )
 	{
-		bool fastdiscard = true;
-		String ws( " \r\n\t" ), dummy;
-
-		for( std::vector<PlyProperty>::const_iterator it = e.properties.begin();
-			it != e.properties.end(); ++it ) {
-			if( ( *it ).type == PLY_LIST ) {
-				fastdiscard = false;
-				break;
-			}
-		}
-
-		if( fastdiscard ) {
-			size_t n = e.properties.size() * e.size;
-			while( n-- ) {
-				if( !d.nextToken( dummy, ws ) )
-					return false;
-			}
-		} else {
-			size_t n = e.size;
-			while( n-- ) {
-				for( std::vector<PlyProperty>::const_iterator it = e.properties.begin();
-					it != e.properties.end(); ++it )
-					if( !PlyDiscardPropertyAscii( d, *it ) )
-						return false;
-			}
-		}
+		if( str == "uchar" || str == "uint8" )
+			type = PLY_U8;
+		else if( str == "ushort" || str == "uint16" )
+			type = PLY_U16;
+		else if( str == "uint" || str == "uint32" )
+			type = PLY_U32;
+		else if( str == "char" || str == "int8" )
+			type = PLY_S8;
+		else if( str == "short" || str == "int16" )
+			type = PLY_S16;
+		else if( str == "int" || str == "int32" )
+			type = PLY_S32;
+		else if( str == "float" || str == "float32" )
+			type = PLY_FLOAT;
+		else if( str == "double" || str == "float64" )
+			type = PLY_DOUBLE;
+		else if( str == "list" )
+			type = PLY_LIST;
+		else
+			return false;
 		return true;
 	}
 
-
 	static bool PlyReadProperty( DataIterator& d, PlyProperty& p )
 	{
 		String strtype;
-		String strname;
 		String ws( " \r\n\t" );
 
-		if( !d.nextToken( strtype, ws ) )
-			return false;
-
-
-		/* type */
-		if( strtype == "uchar" )
-			p.type  = PLY_U8;
-		else if( strtype == "ushort" )
-			p.type  = PLY_U16;
-		else if( strtype == "uint" )
-			p.type  = PLY_U32;
-		else if( strtype == "char" )
-			p.type  = PLY_S8;
-		else if( strtype == "short" )
-			p.type  = PLY_S16;
-		else if( strtype == "int" )
-			p.type  = PLY_S32;
-		else if( strtype == "float" )
-			p.type  = PLY_FLOAT;
-		else if( strtype == "double" )
-			p.type  = PLY_DOUBLE;
-		else if( strtype == "list" )
-			p.type  = PLY_LIST;
-		else
+		if( !d.nextToken( strtype, ws ) || !PlyParseType( strtype, p.type ) )
 			return false;
 
-
-		if( p.type != PLY_LIST ) {
-			/* name */
-			if( !d.nextToken( p.name, ws ) )
-				return false;
-		} else {
-			/* list type and name */
-			PlyPropertyType type;
-
-			if( !d.nextToken( strtype, ws ) )
-				return false;
-
-			if( strtype == "uchar" )
-				type  = PLY_U8;
-			else if( strtype == "ushort" )
-				type  = PLY_U16;
-			else if( strtype == "uint" )
-				type  = PLY_U32;
-			else if( strtype == "char" )
-				type  = PLY_S8;
-			else if( strtype == "short" )
-				type  = PLY_S16;
-			else if( strtype == "int" )
-				type  = PLY_S32;
-			else
+		if( p.type == PLY_LIST ) {
+			/* list size type, element type */
+			if( !d.nextToken( strtype, ws ) || !PlyParseType( strtype, p.lsizetype ) ||
+			    p.lsizetype == PLY_LIST || p.lsizetype == PLY_FLOAT || p.lsizetype == PLY_DOUBLE )
 				return false;
 
-			p.lsizetype = type;
-
-			if( !d.nextToken( strtype, ws ) )
-				return false;
-
-			if( strtype == "uchar" )
-				type  = PLY_U8;
-			else if( strtype == "ushort" )
-				type  = PLY_U16;
-			else if( strtype == "uint" )
-				type  = PLY_U32;
-			else if( strtype == "char" )
-				type  = PLY_S8;
-			else if( strtype == "short" )
-				type  = PLY_S16;
-			else if( strtype == "int" )
-				type  = PLY_S32;
-			else if( strtype == "float" )
-				type  = PLY_FLOAT;
-			else if( strtype == "double" )
-				type  = PLY_DOUBLE;
-			else
-				return false;
-
-			p.ltype = type;
-
-			if( !d.nextToken( p.name, ws ) )
+			if( !d.nextToken( strtype, ws ) || !PlyParseType( strtype, p.ltype ) || p.ltype == PLY_LIST )
 				return false;
 		}
 
-		//std::cout << p.name << std::endl;
-
-		return true;
+		/* name */
+		return d.nextToken( p.name, ws );
 	}
 
 	static bool PlyReadElement( DataIterator& d, PlyElement& e )
@@ -218,7 +126,6 @@ namespace cvt {
 		e.name = name;
 		e.size = ( size_t ) size;
 
-		//std::cout << "Element: " << name << " " << size << std::endl;
 		while( 1 ) {
 			const uint8_t* cpos = d.pos();
 
@@ -275,7 +182,7 @@ namespace cvt {
 			if( !d.nextToken( str, ws ) )
 				return false;
 
-			if( str == "comment" ) {
+			if( str == "comment" || str == "obj_info" ) {
 				d.skipInverse( "\n" );
 			} else if( str == "element" ) {
 				elements.resize( elements.size() + 1 );
@@ -288,151 +195,827 @@ namespace cvt {
 		return true;
 	}
 
-	static bool PlyReadVertexAscii( DataIterator& d, std::vector<Vector3f>& vertices, std::vector<Vector3f>& normals, const PlyElement& e )
+
+	/* read-only, private mapping of the whole file - the loader never copies the raw file */
+	class PlyMappedFile {
+		public:
+			PlyMappedFile( const String& filename );
+			~PlyMappedFile();
+
+			const uint8_t*	ptr() const { return ( const uint8_t* ) _map; }
+			size_t			size() const { return _size; }
+
+		private:
+			PlyMappedFile( const PlyMappedFile& );
+			PlyMappedFile& operator=( const PlyMappedFile& );
+
+			int		_fd;
+			void*	_map;
+			size_t	_size;
+	};
+
+	PlyMappedFile::PlyMappedFile( const String& filename ) : _fd( -1 ), _map( 0 ), _size( 0 )
 	{
-		size_t n = e.size;
-		String dummy;
-		String ws( " \r\n\t" );
-		double x , y, z, nx, ny, nz;
-
-		x = y = z = nx = ny = nz = 0;
-
-		while( n-- ) {
-			for( std::vector<PlyProperty>::const_iterator it = e.properties.begin();
-				it != e.properties.end(); ++it ) {
-				if( it->name == "x" ) {
-					x = d.nextDouble();
-				} else if( it->name == "y" ) {
-					y = d.nextDouble();
-				} else if( it->name == "z" ) {
-					z = d.nextDouble();
-				} else	if( it->name == "nx" ) {
-					nx = d.nextDouble();
-				} else if( it->name == "ny" ) {
-					ny = d.nextDouble();
-				} else if( it->name == "nz" ) {
-					nz = d.nextDouble();
-				} else {
-					/* discard */
-					if( !d.nextToken( dummy, ws ) )
-						return false;
+		_fd = open( filename.c_str(), O_RDONLY, 0 );
+		if( _fd < 0 ) {
+			String msg( "Could not open file: " );
+			msg += strerror( errno );
+			throw CVTException( msg.c_str() );
+		}
+
+		struct stat fileInfo;
+		if( fstat( _fd, &fileInfo ) == -1 ) {
+			String msg( "fstat error: " );
+			msg += strerror( errno );
+			close( _fd );
+			throw CVTException( msg.c_str() );
+		}
+
+		_size = fileInfo.st_size;
+		if( !_size ) {
+			close( _fd );
+			throw CVTException( "Empty PLY file" );
+		}
+
+		_map = mmap( 0, _size, PROT_READ, MAP_PRIVATE, _fd, 0 );
+		if( _map == MAP_FAILED ) {
+			String msg( "Could not map file: " );
+			msg += strerror( errno );
+			close( _fd );
+			throw CVTException( msg.c_str() );
+		}
+	}
+
+	PlyMappedFile::~PlyMappedFile()
+	{
+		munmap( _map, _size );
+		close( _fd );
+	}
+
+	/* vertex record: position, normal, color (rgba), texcoord */
+	enum PlyVertexTarget { PLY_VX = 0, PLY_VY, PLY_VZ,
+		PLY_VNX, PLY_VNY, PLY_VNZ,
+		PLY_VR, PLY_VG, PLY_VB, PLY_VA,
+		PLY_VU, PLY_VV,
+		PLY_VRECORD, PLY_VSKIP = -1 };
+
+	struct PlyVertexLayout {
+		std::vector<int>	target;
+		std::vector<float>	scale;
+		size_t				stride; /* binary record size, 0 if the element contains lists */
+		bool				hasNormals;
+		bool				hasColors;
+		bool				hasTexcoords;
+	};
+
+	struct PlyVertexArrays {
+		Vector3f* vertices;
+		Vector3f* normals;
+		Vector4f* colors;
+		Vector2f* texcoords;
+	};
+
+	struct PlyFaces {
+		std::vector<unsigned int> indices;
+		std::vector<unsigned int> sizes;
+	};
+
+	static float PlyColorScale( PlyPropertyType type )
+	{
+		switch( type ) {
+			case PLY_U8:  return 1.0f / 255.0f;
+			case PLY_U16: return 1.0f / 65535.0f;
+			case PLY_U32: return 1.0f / 4294967295.0f;
+			case PLY_S8:  return 1.0f / 127.0f;
+			case PLY_S16: return 1.0f / 32767.0f;
+			case PLY_S32: return 1.0f / 2147483647.0f;
+			default:	  return 1.0f;
+		}
+	}
+
+	static void PlyVertexLayoutInit( PlyVertexLayout& layout, const PlyElement& e )
+	{
+		bool hasPosition[ 3 ] = { false, false, false };
+		bool hasNormal[ 3 ] = { false, false, false };
+		bool hasTexcoord[ 2 ] = { false, false };
+
+		layout.target.resize( e.properties.size() );
+		layout.scale.resize( e.properties.size() );
+		layout.stride = 0;
+		layout.hasColors = false;
+
+		for( size_t i = 0; i < e.properties.size(); i++ ) {
+			const PlyProperty& p = e.properties[ i ];
+			int t = PLY_VSKIP;
+
+			if( p.type != PLY_LIST ) {
+				if( p.name == "x" )
+					t = PLY_VX;
+				else if( p.name == "y" )
+					t = PLY_VY;
+				else if( p.name == "z" )
+					t = PLY_VZ;
+				else if( p.name == "nx" )
+					t = PLY_VNX;
+				else if( p.name == "ny" )
+					t = PLY_VNY;
+				else if( p.name == "nz" )
+					t = PLY_VNZ;
+				else if( p.name == "red" || p.name == "diffuse_red" )
+					t = PLY_VR;
+				else if( p.name == "green" || p.name == "diffuse_green" )
+					t = PLY_VG;
+				else if( p.name == "blue" || p.name == "diffuse_blue" )
+					t = PLY_VB;
+				else if( p.name == "alpha" || p.name == "diffuse_alpha" )
+					t = PLY_VA;
+				else if( p.name == "u" || p.name == "s" || p.name == "texture_u" || p.name == "texture_s" )
+					t = PLY_VU;
+				else if( p.name == "v" || p.name == "t" || p.name == "texture_v" || p.name == "texture_t" )
+					t = PLY_VV;
+			}
+
+			layout.target[ i ] = t;
+			layout.scale[ i ] = ( t >= PLY_VR && t <= PLY_VA ) ? PlyColorScale( p.type ) : 1.0f;
+
+			if( t >= PLY_VX && t <= PLY_VZ )
+				hasPosition[ t - PLY_VX ] = true;
+			else if( t >= PLY_VNX && t <= PLY_VNZ )
+				hasNormal[ t - PLY_VNX ] = true;
+			else if( t >= PLY_VR && t <= PLY_VA )
+				layout.hasColors = true;
+			else if( t >= PLY_VU )
+				hasTexcoord[ t - PLY_VU ] = true;
+		}
+
+		if( !hasPosition[ 0 ] || !hasPosition[ 1 ] || !hasPosition[ 2 ] )
+			throw CVTException( "PLY vertex element without x, y, z properties" );
+		layout.hasNormals = hasNormal[ 0 ] && hasNormal[ 1 ] && hasNormal[ 2 ];
+		layout.hasTexcoords = hasTexcoord[ 0 ] && hasTexcoord[ 1 ];
+
+		for( size_t i = 0; i < e.properties.size(); i++ ) {
+			if( e.properties[ i ].type == PLY_LIST ) {
+				layout.stride = 0;
+				break;
+			}
+			layout.stride += PlyTypeSize( e.properties[ i ].type );
+		}
+	}
+
+	static inline void PlyStoreVertex( const PlyVertexArrays& out, const PlyVertexLayout& layout, size_t i, const float* rec )
+	{
+		out.vertices[ i ].set( rec[ PLY_VX ], rec[ PLY_VY ], rec[ PLY_VZ ] );
+		if( layout.hasNormals )
+			out.normals[ i ].set( rec[ PLY_VNX ], rec[ PLY_VNY ], rec[ PLY_VNZ ] );
+		if( layout.hasColors )
+			out.colors[ i ].set( rec[ PLY_VR ], rec[ PLY_VG ], rec[ PLY_VB ], rec[ PLY_VA ] );
+		if( layout.hasTexcoords )
+			out.texcoords[ i ].set( rec[ PLY_VU ], rec[ PLY_VV ] );
+	}
+
+	static inline void PlyClearRecord( float* rec )
+	{
+		for( int i = 0; i < PLY_VRECORD; i++ )
+			rec[ i ] = 0.0f;
+		rec[ PLY_VA ] = 1.0f;
+	}
+
+	/*
+	   Binary parsing
+	 */
+
+	static inline double PlyBinaryValue( const uint8_t* p, PlyPropertyType type, bool swap )
+	{
+		switch( type ) {
+			case PLY_U8: return *p;
+			case PLY_S8: return *( ( const int8_t* ) p );
+			case PLY_U16:
+			case PLY_S16:
+				{
+					uint16_t v;
+					memcpy( &v, p, sizeof( v ) );
+					if( swap )
+						v = Util::bswap16( v );
+					return type == PLY_U16 ? ( double ) v : ( double ) ( int16_t ) v;
 				}
+			case PLY_U32:
+			case PLY_S32:
+			case PLY_FLOAT:
+				{
+					uint32_t v;
+					memcpy( &v, p, sizeof( v ) );
+					if( swap )
+						v = Util::bswap32( v );
+					if( type == PLY_FLOAT ) {
+						float f;
+						memcpy( &f, &v, sizeof( f ) );
+						return f;
+					}
+					return type == PLY_U32 ? ( double ) v : ( double ) ( int32_t ) v;
+				}
+			case PLY_DOUBLE:
+				{
+					uint64_t v;
+					double f;
+					memcpy( &v, p, sizeof( v ) );
+					if( swap )
+						v = Util::bswap64( v );
+					memcpy( &f, &v, sizeof( f ) );
+					return f;
+				}
+			default:
+				return 0;
+		}
+	}
+
+	/* read list size, return false if the data is truncated or the size is negative */
+	static inline bool PlyBinaryListSize( const uint8_t*& p, const uint8_t* end, const PlyProperty& prop, bool swap, size_t& n )
+	{
+		size_t ssize = PlyTypeSize( prop.lsizetype );
+		if( ( size_t ) ( end - p ) < ssize )
+			return false;
+		double v = PlyBinaryValue( p, prop.lsizetype, swap );
+		if( v < 0 )
+			return false;
+		p += ssize;
+		n = ( size_t ) v;
+		return ( size_t ) ( end - p ) / PlyTypeSize( prop.ltype ) >= n;
+	}
+
+	static bool PlyBinaryVertex( const uint8_t*& p, const uint8_t* end, const PlyElement& e,
+								 const PlyVertexLayout& layout, bool swap, float* rec )
+	{
+		PlyClearRecord( rec );
+		for( size_t i = 0; i < e.properties.size(); i++ ) {
+			const PlyProperty& prop = e.properties[ i ];
+			if( prop.type == PLY_LIST ) {
+				size_t n;
+				if( !PlyBinaryListSize( p, end, prop, swap, n ) )
+					return false;
+				p += n * PlyTypeSize( prop.ltype );
+			} else {
+				size_t psize = PlyTypeSize( prop.type );
+				if( ( size_t ) ( end - p ) < psize )
+					return false;
+				if( layout.target[ i ] != PLY_VSKIP )
+					rec[ layout.target[ i ] ] = ( float ) PlyBinaryValue( p, prop.type, swap ) * layout.scale[ i ];
+				p += psize;
+			}
+		}
+		return true;
+	}
+
+	class PlyBinaryVertexBody {
+		public:
+			PlyBinaryVertexBody( const uint8_t* base, const PlyElement& e, const PlyVertexLayout& layout,
+								 bool swap, const PlyVertexArrays& out ) :
+				_base( base ), _e( e ), _layout( layout ), _swap( swap ), _out( out )
+			{
+			}
+
+			void operator()( const Range<size_t>& r ) const
+			{
+				float rec[ PLY_VRECORD ];
+				for( size_t i = r.min; i < r.max; i++ ) {
+					const uint8_t* p = _base + i * _layout.stride;
+					/* bounds were checked for the whole element */
+					PlyBinaryVertex( p, p + _layout.stride, _e, _layout, _swap, rec );
+					PlyStoreVertex( _out, _layout, i, rec );
+				}
+			}
+
+		private:
+			const uint8_t*			_base;
+			const PlyElement&		_e;
+			const PlyVertexLayout&	_layout;
+			bool					_swap;
+			PlyVertexArrays			_out;
+	};
+
+	static bool PlyIsFaceIndexList( const PlyProperty& p )
+	{
+		return p.type == PLY_LIST && ( p.name == "vertex_indices" || p.name == "vertex_index" );
+	}
+
+	static bool PlyReadVertexBinary( const uint8_t*& p, const uint8_t* end, const PlyElement& e,
+									 bool swap, const PlyVertexLayout& layout, const PlyVertexArrays& out )
+	{
+		if( layout.stride ) {
+			if( ( size_t ) ( end - p ) / layout.stride < e.size )
+				return false;
+
+			/* layout matches Vector3f exactly - plain copy */
+			if( !swap && e.properties.size() == 3 && layout.stride == 3 * sizeof( float ) &&
+			    layout.target[ 0 ] == PLY_VX && layout.target[ 1 ] == PLY_VY && layout.target[ 2 ] == PLY_VZ &&
+			    e.properties[ 0 ].type == PLY_FLOAT && e.properties[ 1 ].type == PLY_FLOAT && e.properties[ 2 ].type == PLY_FLOAT ) {
+				memcpy( out.vertices, p, e.size * layout.stride );
+			} else {
+				PlyBinaryVertexBody body( p, e, layout, swap, out );
+				parallelFor( Range<size_t>( 0, e.size ), body, 4096 );
 			}
-			vertices.push_back( Vector3f( x, y, z ) );
-			normals.push_back( Vector3f( nx, ny, nz ) );
+			p += e.size * layout.stride;
+			return true;
 		}
 
+		float rec[ PLY_VRECORD ];
+		for( size_t i = 0; i < e.size; i++ ) {
+			if( !PlyBinaryVertex( p, end, e, layout, swap, rec ) )
+				return false;
+			PlyStoreVertex( out, layout, i, rec );
+		}
 		return true;
 	}
 
-	static bool PlyReadVertexAscii( DataIterator& d, std::vector<Vector3f>& vertices, const PlyElement& e )
+	/* the common face layout of a single uchar/char count and 32bit index list, copied straight into the index array */
+	static bool PlyReadFacesBinaryFixed( const uint8_t*& p, const uint8_t* end, const PlyElement& e, bool swap, PlyFaces& faces )
 	{
-		size_t n = e.size;
-		String dummy;
-		String ws( " \r\n\t" );
-		double x , y, z, nx, ny, nz;
-
-		x = y = z = nx = ny = nz = 0;
-
-		while( n-- ) {
-			for( std::vector<PlyProperty>::const_iterator it = e.properties.begin();
-				it != e.properties.end(); ++it ) {
-				if( it->name == "x" ) {
-					x = d.nextDouble();
-				} else if( it->name == "y" ) {
-					y = d.nextDouble();
-				} else if( it->name == "z" ) {
-					z = d.nextDouble();
+		bool sign = e.properties[ 0 ].ltype == PLY_S32;
+		size_t pos = faces.indices.size();
+
+		for( size_t f = 0; f < e.size; f++ ) {
+			if( p == end )
+				return false;
+			size_t n = *p++;
+			if( e.properties[ 0 ].lsizetype == PLY_S8 && n > 127 )
+				return false;
+			if( ( size_t ) ( end - p ) / sizeof( uint32_t ) < n )
+				return false;
+
+			faces.indices.resize( pos + n );
+			unsigned int* dst = &faces.indices[ pos ];
+			memcpy( dst, p, n * sizeof( uint32_t ) );
+			if( swap ) {
+				for( size_t k = 0; k < n; k++ )
+					dst[ k ] = Util::bswap32( dst[ k ] );
+			}
+			if( sign ) {
+				for( size_t k = 0; k < n; k++ )
+					if( dst[ k ] & 0x80000000 )
+						return false;
+			}
+			faces.sizes.push_back( n );
+			pos += n;
+			p += n * sizeof( uint32_t );
+		}
+		return true;
+	}
+
+	static bool PlyReadFacesBinary( const uint8_t*& p, const uint8_t* end, const PlyElement& e, bool swap, PlyFaces& faces )
+	{
+		faces.sizes.reserve( e.size );
+		faces.indices.reserve( e.size * 3 );
+
+		if( e.properties.size() == 1 && PlyIsFaceIndexList( e.properties[ 0 ] ) &&
+			( e.properties[ 0 ].lsizetype == PLY_U8 || e.properties[ 0 ].lsizetype == PLY_S8 ) &&
+			( e.properties[ 0 ].ltype == PLY_U32 || e.properties[ 0 ].ltype == PLY_S32 ) )
+			return PlyReadFacesBinaryFixed( p, end, e, swap, faces );
+
+		for( size_t f = 0; f < e.size; f++ ) {
+			for( std::vector<PlyProperty>::const_iterator it = e.properties.begin(); it != e.properties.end(); ++it ) {
+				if( it->type == PLY_LIST ) {
+					size_t n;
+					if( !PlyBinaryListSize( p, end, *it, swap, n ) )
+						return false;
+					size_t esize = PlyTypeSize( it->ltype );
+					if( PlyIsFaceIndexList( *it ) ) {
+						for( size_t k = 0; k < n; k++ ) {
+							double idx = PlyBinaryValue( p + k * esize, it->ltype, swap );
+							if( idx < 0 )
+								return false;
+							faces.indices.push_back( ( unsigned int ) idx );
+						}
+						faces.sizes.push_back( n );
+					}
+					p += n * esize;
 				} else {
-					/* discard */
-					if( !d.nextToken( dummy, ws ) )
+					size_t psize = PlyTypeSize( it->type );
+					if( ( size_t ) ( end - p ) < psize )
 						return false;
+					p += psize;
 				}
 			}
-			vertices.push_back( Vector3f( x, y, z ) );
 		}
+		return true;
+	}
 
+	static bool PlyDiscardElementBinary( const uint8_t*& p, const uint8_t* end, const PlyElement& e, bool swap )
+	{
+		for( size_t i = 0; i < e.size; i++ ) {
+			for( std::vector<PlyProperty>::const_iterator it = e.properties.begin(); it != e.properties.end(); ++it ) {
+				if( it->type == PLY_LIST ) {
+					size_t n;
+					if( !PlyBinaryListSize( p, end, *it, swap, n ) )
+						return false;
+					p += n * PlyTypeSize( it->ltype );
+				} else {
+					size_t psize = PlyTypeSize( it->type );
+					if( ( size_t ) ( end - p ) < psize )
+						return false;
+					p += psize;
+				}
+			}
+		}
 		return true;
 	}
 
+	/*
+	   ASCII parsing - every element instance is one line. The lines of an element are split
+	   into chunks of PLY_ASCII_CHUNK lines, which are then parsed in parallel.
+	 */
 
-	static bool PlyReadFacesAscii( DataIterator& d, std::vector<unsigned int>& faces, const PlyElement& e )
+	static const size_t PLY_ASCII_CHUNK = 4096;
+
+	static inline bool PlyIsSpace( char c )
 	{
-		size_t n = e.size;
-		String dummy;
-		String ws( " \r\n\t" );
+		return c == ' ' || c == '\t' || c == '\r';
+	}
 
+	/* find the lines of the next n element instances, skipping blank lines */
+	static bool PlyAsciiLines( const char*& p, const char* end, size_t n, std::vector<const char*>& chunks )
+	{
+		size_t lines = 0;
 
-		while( n-- ) {
-			//FIXME: check for only tris or quads
-			long nn = d.nextLong();
-			while( nn-- ) {
-				long i = d.nextLong();
-				if( i < 0 )
-					return false;
-				faces.push_back( ( unsigned int ) i );
-			}
+		chunks.clear();
+		while( lines < n ) {
+			while( p < end && ( PlyIsSpace( *p ) || *p == '\n' ) )
+				p++;
+			if( p == end )
+				return false;
+			if( lines % PLY_ASCII_CHUNK == 0 )
+				chunks.push_back( p );
+			const char* eol = ( const char* ) memchr( p, '\n', end - p );
+			p = eol ? eol + 1 : end;
+			lines++;
 		}
+		chunks.push_back( p );
 		return true;
 	}
 
-	void PlyLoader::load( Scene& scene, const String& filename )
+	static inline bool PlyAsciiToken( const char*& p, const char* end, const char*& tok, size_t& len )
 	{
-		std::vector<PlyElement> elements;
-		PlyFormat format;
-		std::vector<Vector3f> vertices;
-		std::vector<Vector3f> normals;
-		std::vector<unsigned int> faces;
+		while( p < end && PlyIsSpace( *p ) )
+			p++;
+		if( p == end || *p == '\n' )
+			return false;
+		tok = p;
+		while( p < end && !PlyIsSpace( *p ) && *p != '\n' )
+			p++;
+		len = p - tok;
+		return true;
+	}
 
+	static inline bool PlyAsciiValue( const char*& p, const char* end, PlyPropertyType type, double& value )
+	{
+		const char* tok;
+		size_t len;
 
-		scene.clear();
+		if( !PlyAsciiToken( p, end, tok, len ) )
+			return false;
 
-		Data data;
-		FileSystem::load( data, filename );
+		if( type == PLY_FLOAT || type == PLY_DOUBLE ) {
+			/* the mapping is not zero terminated */
+			char buf[ 64 ];
+			char* eptr;
+			if( len >= sizeof( buf ) )
+				return false;
+			memcpy( buf, tok, len );
+			buf[ len ] = '\0';
+			value = strtod( buf, &eptr );
+			return eptr == buf + len;
+		}
 
-		DataIterator d( data );
-		PlyReadHeader( d, elements, format );
+		const char* t = tok;
+		const char* tend = tok + len;
+		bool neg = false;
+		double v = 0;
 
-		// FIXME: add support for u,v and red, green, blue properties
-		switch( format )
-		{
-			case PLY_ASCII:
-				{
-					for( std::vector<PlyElement>::iterator it = elements.begin();it != elements.end(); ++it ) {
-						if( it->name == "vertex" ) {
-							if( it->hasProperty( "nx" ) && it->hasProperty( "ny" ) && it->hasProperty( "nz" ) ) {
-								if( !PlyReadVertexAscii( d, vertices, normals, *it ) )
+		if( *t == '-' || *t == '+' ) {
+			neg = *t == '-';
+			t++;
+		}
+		if( t == tend )
+			return false;
+		for( ; t != tend; t++ ) {
+			if( *t < '0' || *t > '9' )
+				return false;
+			v = v * 10 + ( *t - '0' );
+		}
+		value = neg ? -v : v;
+		return true;
+	}
+
+	static inline const char* PlyNextLine( const char* p, const char* end )
+	{
+		const char* eol = ( const char* ) memchr( p, '\n', end - p );
+		return eol ? eol + 1 : end;
+	}
+
+	class PlyAsciiVertexBody {
+		public:
+			PlyAsciiVertexBody( const std::vector<const char*>& chunks, size_t n, const PlyElement& e,
+								const PlyVertexLayout& layout, const PlyVertexArrays& out, bool* fail ) :
+				_chunks( chunks ), _n( n ), _e( e ), _layout( layout ), _out( out ), _fail( fail )
+			{
+			}
+
+			void operator()( const Range<size_t>& r ) const
+			{
+				float rec[ PLY_VRECORD ];
+				double v;
+
+				for( size_t c = r.min; c < r.max; c++ ) {
+					const char* p = _chunks[ c ];
+					const char* end = _chunks[ c + 1 ];
+					size_t iend = Math::min( _n, ( c + 1 ) * PLY_ASCII_CHUNK );
+
+					for( size_t i = c * PLY_ASCII_CHUNK; i < iend; i++ ) {
+						while( p < end && ( PlyIsSpace( *p ) || *p == '\n' ) )
+							p++;
+						PlyClearRecord( rec );
+						for( size_t k = 0; k < _e.properties.size(); k++ ) {
+							const PlyProperty& prop = _e.properties[ k ];
+							if( prop.type == PLY_LIST ) {
+								if( !PlyAsciiValue( p, end, prop.lsizetype, v ) || v < 0 ) {
+									_fail[ c ] = true;
 									return;
+								}
+								for( size_t l = ( size_t ) v; l--; ) {
+									if( !PlyAsciiValue( p, end, prop.ltype, v ) ) {
+										_fail[ c ] = true;
+										return;
+									}
+								}
 							} else {
-								if( !PlyReadVertexAscii( d, vertices, *it ) )
+								if( !PlyAsciiValue( p, end, prop.type, v ) ) {
+									_fail[ c ] = true;
 									return;
+								}
+								if( _layout.target[ k ] != PLY_VSKIP )
+									rec[ _layout.target[ k ] ] = ( float ) v * _layout.scale[ k ];
 							}
-						} else if( it->name == "face" ) {
-							if( !PlyReadFacesAscii( d, faces, *it ) )
-								return;
-						} else {
-							if( !PlyDiscardElementAscii( d, *it ) )
-								return;
 						}
+						PlyStoreVertex( _out, _layout, i, rec );
+						p = PlyNextLine( p, end );
 					}
 				}
-				break;
-			case PLY_BIN_LE:
-			case PLY_BIN_BE:
-				{
-					throw CVTException( "Only ASCII PLY supported" );
+			}
+
+		private:
+			const std::vector<const char*>& _chunks;
+			size_t							_n;
+			const PlyElement&				_e;
+			const PlyVertexLayout&			_layout;
+			PlyVertexArrays					_out;
+			bool*							_fail;
+	};
+
+	class PlyAsciiFaceBody {
+		public:
+			PlyAsciiFaceBody( const std::vector<const char*>& chunks, size_t n, const PlyElement& e,
+							  std::vector<PlyFaces>& faces, bool* fail ) :
+				_chunks( chunks ), _n( n ), _e( e ), _faces( faces ), _fail( fail )
+			{
+			}
+
+			void operator()( const Range<size_t>& r ) const
+			{
+				double v;
+
+				for( size_t c = r.min; c < r.max; c++ ) {
+					const char* p = _chunks[ c ];
+					const char* end = _chunks[ c + 1 ];
+					size_t iend = Math::min( _n, ( c + 1 ) * PLY_ASCII_CHUNK );
+					PlyFaces& faces = _faces[ c ];
+
+					faces.sizes.reserve( iend - c * PLY_ASCII_CHUNK );
+					faces.indices.reserve( 3 * ( iend - c * PLY_ASCII_CHUNK ) );
+
+					for( size_t i = c * PLY_ASCII_CHUNK; i < iend; i++ ) {
+						while( p < end && ( PlyIsSpace( *p ) || *p == '\n' ) )
+							p++;
+						for( std::vector<PlyProperty>::const_iterator it = _e.properties.begin(); it != _e.properties.end(); ++it ) {
+							if( it->type == PLY_LIST ) {
+								if( !PlyAsciiValue( p, end, it->lsizetype, v ) || v < 0 ) {
+									_fail[ c ] = true;
+									return;
+								}
+								size_t n = ( size_t ) v;
+								bool indices = PlyIsFaceIndexList( *it );
+								for( size_t l = 0; l < n; l++ ) {
+									if( !PlyAsciiValue( p, end, it->ltype, v ) || ( indices && v < 0 ) ) {
+										_fail[ c ] = true;
+										return;
+									}
+									if( indices )
+										faces.indices.push_back( ( unsigned int ) v );
+								}
+								if( indices )
+									faces.sizes.push_back( n );
+							} else {
+								if( !PlyAsciiValue( p, end, it->type, v ) ) {
+									_fail[ c ] = true;
+									return;
+								}
+							}
+						}
+						p = PlyNextLine( p, end );
+					}
 				}
-				break;
+			}
+
+		private:
+			const std::vector<const char*>& _chunks;
+			size_t							_n;
+			const PlyElement&				_e;
+			std::vector<PlyFaces>&			_faces;
+			bool*							_fail;
+	};
+
+	static bool PlyReadVertexAscii( const char*& p, const char* end, const PlyElement& e,
+									const PlyVertexLayout& layout, const PlyVertexArrays& out )
+	{
+		std::vector<const char*> chunks;
+
+		if( !PlyAsciiLines( p, end, e.size, chunks ) )
+			return false;
+
+		size_t nchunks = chunks.size() - 1;
+		bool* fail = new bool[ nchunks ];
+		for( size_t i = 0; i < nchunks; i++ )
+			fail[ i ] = false;
+
+		PlyAsciiVertexBody body( chunks, e.size, e, layout, out, fail );
+		parallelFor( Range<size_t>( 0, nchunks ), body, 1 );
+
+		bool ret = true;
+		for( size_t i = 0; i < nchunks; i++ )
+			ret = ret && !fail[ i ];
+		delete[] fail;
+		return ret;
+	}
+
+	static bool PlyReadFacesAscii( const char*& p, const char* end, const PlyElement& e, PlyFaces& faces )
+	{
+		std::vector<const char*> chunks;
+
+		if( !PlyAsciiLines( p, end, e.size, chunks ) )
+			return false;
+
+		size_t nchunks = chunks.size() - 1;
+		std::vector<PlyFaces> cfaces( nchunks );
+		bool* fail = new bool[ nchunks ];
+		for( size_t i = 0; i < nchunks; i++ )
+			fail[ i ] = false;
+
+		PlyAsciiFaceBody body( chunks, e.size, e, cfaces, fail );
+		parallelFor( Range<size_t>( 0, nchunks ), body, 1 );
+
+		bool ret = true;
+		for( size_t i = 0; i < nchunks; i++ )
+			ret = ret && !fail[ i ];
+		delete[] fail;
+		if( !ret )
+			return false;
+
+		size_t nidx = 0;
+		for( size_t i = 0; i < nchunks; i++ )
+			nidx += cfaces[ i ].indices.size();
+		faces.indices.reserve( faces.indices.size() + nidx );
+		faces.sizes.reserve( faces.sizes.size() + e.size );
+		for( size_t i = 0; i < nchunks; i++ ) {
+			faces.indices.insert( faces.indices.end(), cfaces[ i ].indices.begin(), cfaces[ i ].indices.end() );
+			faces.sizes.insert( faces.sizes.end(), cfaces[ i ].sizes.begin(), cfaces[ i ].sizes.end() );
+		}
+		return true;
+	}
+
+	/* quads are kept, everything else is fan-triangulated */
+	static void PlyFacesToMesh( SceneMesh& mesh, const PlyFaces& faces, size_t nvertices )
+	{
+		bool quads = faces.sizes.size() > 0;
+
+		for( size_t i = 0; i < faces.indices.size(); i++ ) {
+			if( faces.indices[ i ] >= nvertices )
+				throw CVTException( "PLY face index out of range" );
+		}
+
+		for( size_t i = 0; i < faces.sizes.size() && quads; i++ )
+			quads = faces.sizes[ i ] == 4;
+
+		if( quads ) {
+			mesh.setFaces( &faces.indices[ 0 ], faces.indices.size(), SCENEMESH_QUADS );
+			return;
+		}
+
+		std::vector<unsigned int> tris;
+		tris.reserve( faces.indices.size() * 3 / 2 );
+		const unsigned int* idx = faces.indices.empty() ? NULL : &faces.indices[ 0 ];
+		for( size_t i = 0; i < faces.sizes.size(); i++ ) {
+			for( size_t k = 2; k < faces.sizes[ i ]; k++ ) {
+				tris.push_back( idx[ 0 ] );
+				tris.push_back( idx[ k - 1 ] );
+				tris.push_back( idx[ k ] );
+			}
+			idx += faces.sizes[ i ];
+		}
+		if( tris.size() )
+			mesh.setFaces( &tris[ 0 ], tris.size(), SCENEMESH_TRIANGLES );
+	}
+
+	void PlyLoader::load( Scene& scene, const String& filename )
+	{
+		std::vector<PlyElement> elements;
+		PlyFormat format;
+		std::vector<Vector3f> vertices;
+		std::vector<Vector3f> normals;
+		std::vector<Vector4f> colors;
+		std::vector<Vector2f> texcoords;
+		PlyFaces faces;
+
+		scene.clear();
+
+		PlyMappedFile file( filename );
+
+		/* the header is text - parse it in place */
+		Data data( ( uint8_t* ) file.ptr(), file.size(), false );
+		DataIterator d( data );
+		if( !PlyReadHeader( d, elements, format ) )
+			throw CVTException( "Invalid PLY header" );
+
+		const uint8_t* end = file.ptr() + file.size();
+		const uint8_t* p = ( const uint8_t* ) memchr( d.pos(), '\n', end - d.pos() );
+		p = p ? p + 1 : end;
+
+		uint16_t one = 1;
+		bool hostle = *( ( uint8_t* ) &one ) == 1;
+		bool swap = ( format == PLY_BIN_LE && !hostle ) || ( format == PLY_BIN_BE && hostle );
+
+		for( std::vector<PlyElement>::iterator it = elements.begin(); it != elements.end(); ++it ) {
+			bool ok;
+
+			if( it->name == "vertex" && vertices.empty() ) {
+				PlyVertexLayout layout;
+				PlyVertexArrays out;
+
+				PlyVertexLayoutInit( layout, *it );
+
+				vertices.resize( it->size );
+				if( layout.hasNormals )
+					normals.resize( it->size );
+				if( layout.hasColors )
+					colors.resize( it->size );
+				if( layout.hasTexcoords )
+					texcoords.resize( it->size );
+				out.vertices = it->size ? &vertices[ 0 ] : NULL;
+				out.normals = normals.empty() ? NULL : &normals[ 0 ];
+				out.colors = colors.empty() ? NULL : &colors[ 0 ];
+				out.texcoords = texcoords.empty() ? NULL : &texcoords[ 0 ];
+
+				if( format == PLY_ASCII ) {
+					const char* cp = ( const char* ) p;
+					ok = PlyReadVertexAscii( cp, ( const char* ) end, *it, layout, out );
+					p = ( const uint8_t* ) cp;
+				} else
+					ok = PlyReadVertexBinary( p, end, *it, swap, layout, out );
+			} else if( it->name == "face" ) {
+				if( format == PLY_ASCII ) {
+					const char* cp = ( const char* ) p;
+					ok = PlyReadFacesAscii( cp, ( const char* ) end, *it, faces );
+					p = ( const uint8_t* ) cp;
+				} else
+					ok = PlyReadFacesBinary( p, end, *it, swap, faces );
+			} else {
+				if( format == PLY_ASCII ) {
+					std::vector<const char*> chunks;
+					const char* cp = ( const char* ) p;
+					ok = PlyAsciiLines( cp, ( const char* ) end, it->size, chunks );
+					p = ( const uint8_t* ) cp;
+				} else
+					ok = PlyDiscardElementBinary( p, end, *it, swap );
+			}
+
+			if( !ok ) {
+				String msg( "Malformed PLY element: " );
+				msg += it->name;
+				throw CVTException( msg.c_str() );
+			}
 		}
 
-		std::cout << vertices.size() << " " << faces.size() << std::endl;
-		if( vertices.size() && faces.size() ) {
+		if( vertices.size() && faces.sizes.size() ) {
 			SceneMesh* mesh = new SceneMesh( "PLY" );
 			mesh->setVertices( &vertices[ 0 ], vertices.size() );
-			// FIXME: correct mesh type - either tris or quads
-			mesh->setFaces( &faces[ 0 ], faces.size(), SCENEMESH_TRIANGLES );
 			if( normals.size() )
 				mesh->setNormals( &normals[ 0 ], normals.size() );
+			if( colors.size() )
+				mesh->setColors( &colors[ 0 ], colors.size() );
+			if( texcoords.size() )
+				mesh->setTexcoords( &texcoords[ 0 ], texcoords.size() );
+			try {
+				PlyFacesToMesh( *mesh, faces, vertices.size() );
+			} catch( ... ) {
+				delete mesh;
+				throw;
+			}
 			scene.addGeometry( mesh );
 		}
 	}